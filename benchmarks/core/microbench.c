@@ -0,0 +1,930 @@
+/**
+ * microbench.c - Microbenchmarks of the C core's hot paths
+ *
+ * Every benchmark loops over a fixed workload: the responses in the
+ * corpus directory (raw HTTP/1.1 responses, one per *.http file) and
+ * inputs generated from fixed seeds; any *.http file added to the corpus
+ * is benchmarked too. The iteration count grows until a run lasts
+ * --min-time, and that run is reported. Pool benchmarks also run on
+ * several threads at once to show lock contention.
+ *
+ * Results go to stdout as a table and, with --json, to a file in Google
+ * Benchmark's JSON format, so its compare.py and CI dashboards that read
+ * that format can track them.
+ *
+ * Usage: microbench [--filter=TEXT] [--min-time=SECONDS] [--corpus=DIR]
+ *                   [--threads=N] [--json=FILE]
+ */
+
+#include "internal/internal.h"
+#include "internal/compression.h"
+#include "internal/cookies.h"
+#include "internal/http1.h"
+#include "internal/response.h"
+#include "internal/tls.h"
+#include "buffer_pool.h"
+#include "connection_pool.h"
+#include "header_template.h"
+#include "http1_parser.h"
+#include "request_builder.h"
+
+#include <dirent.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <zlib.h>
+
+#define BENCH_MAX 128
+#define BENCH_MAX_CORPUS 32
+#define BENCH_MAX_THREADS 64
+
+/* Default shortest run reported */
+#define BENCH_DEFAULT_MIN_TIME 0.5
+
+typedef struct bench bench_t;
+
+/* Run `iterations` rounds of a benchmark on thread `thread` */
+typedef void (*bench_fn_t)(const bench_t *bench, uint64_t iterations, int thread);
+
+struct bench {
+    char name[128];
+    bench_fn_t run;
+    const void *arg;            /* Input (corpus entry) */
+    int threads;                /* Threads running the loop at once */
+    size_t bytes;               /* Input bytes per round (0: no throughput) */
+    void *state;                /* Shared by the threads (pools) */
+};
+
+typedef struct {
+    char name[64];
+    char *data;
+    size_t len;
+    size_t head_len;            /* Status line and headers */
+    bool chunked;
+} corpus_entry_t;
+
+typedef struct {
+    uint64_t iterations;        /* Rounds over all threads */
+    double real_ns;             /* Wall time */
+    double cpu_ns;              /* Process CPU time */
+} bench_result_t;
+
+static corpus_entry_t g_corpus[BENCH_MAX_CORPUS];
+static size_t g_corpus_count;
+static bench_t g_benches[BENCH_MAX];
+static size_t g_bench_count;
+
+/* Keeps results alive so loops aren't optimized away */
+static volatile uint64_t g_sink;
+
+/* === Clocks === */
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double cpu_ns(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (double)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e9 +
+           (double)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) * 1e3;
+}
+
+/* === Deterministic inputs === */
+
+/* xorshift64*: the same sequence on every platform */
+static uint64_t bench_rand(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+/* Text with a natural-language-like compression ratio */
+static void fill_text(char *buf, size_t len, uint64_t seed) {
+    static const char *words[] = {
+        "request", "response", "header", "the", "of", "connection", "and", "body",
+        "a", "to", "stream", "cookie", "in", "cache", "is", "server", "client", "data"
+    };
+    size_t n = 0;
+    while (n < len) {
+        const char *word = words[bench_rand(&seed) % (sizeof(words) / sizeof(words[0]))];
+        for (const char *p = word; *p && n < len; p++) {
+            buf[n++] = *p;
+        }
+        if (n < len) {
+            buf[n++] = ' ';
+        }
+    }
+}
+
+/* Chrome's navigation headers, in the order Chrome sends them */
+static const char *const g_chrome_headers[][2] = {
+    {"sec-ch-ua", "\"Chromium\";v=\"142\", \"Google Chrome\";v=\"142\", \"Not_A Brand\";v=\"99\""},
+    {"sec-ch-ua-mobile", "?0"},
+    {"sec-ch-ua-platform", "\"Windows\""},
+    {"upgrade-insecure-requests", "1"},
+    {"user-agent", "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 "
+                   "(KHTML, like Gecko) Chrome/142.0.0.0 Safari/537.36"},
+    {"accept", "text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,"
+               "image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7"},
+    {"sec-fetch-site", "none"},
+    {"sec-fetch-mode", "navigate"},
+    {"sec-fetch-user", "?1"},
+    {"sec-fetch-dest", "document"},
+    {"accept-encoding", "gzip, deflate, br, zstd"},
+    {"accept-language", "en-US,en;q=0.9"},
+    {"cookie", "AEC=AVh_V2h7bXk3YjQ0ZjE2NWE4MmU5OTg1YzBk; NID=519=Jq2Vx8k1Lm0bT4rYwE6uI9oP3aS5dF7g"},
+};
+#define CHROME_HEADER_COUNT (sizeof(g_chrome_headers) / sizeof(g_chrome_headers[0]))
+
+/* === Corpus === */
+
+static int corpus_compare(const void *a, const void *b) {
+    return strcmp(((const corpus_entry_t *)a)->name, ((const corpus_entry_t *)b)->name);
+}
+
+static int corpus_load(const char *dir_path) {
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        fprintf(stderr, "microbench: cannot open corpus %s\n", dir_path);
+        return -1;
+    }
+
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL && g_corpus_count < BENCH_MAX_CORPUS) {
+        size_t name_len = strlen(ent->d_name);
+        if (name_len <= 5 || strcmp(ent->d_name + name_len - 5, ".http") != 0 ||
+            name_len - 5 >= sizeof(g_corpus[0].name)) {
+            continue;
+        }
+
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir_path, ent->d_name);
+        FILE *f = fopen(path, "rb");
+        if (!f) {
+            continue;
+        }
+        fseek(f, 0, SEEK_END);
+        long size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        char *data = size > 0 ? malloc((size_t)size) : NULL;
+        if (!data || fread(data, 1, (size_t)size, f) != (size_t)size) {
+            free(data);
+            fclose(f);
+            continue;
+        }
+        fclose(f);
+
+        http1_parser_t parser;
+        http1_parser_init(&parser, NULL, 0);
+        if (http1_parser_feed(&parser, data, (size_t)size) != HTTP1_PARSE_COMPLETE) {
+            fprintf(stderr, "microbench: %s has no complete response head, skipped\n", path);
+            free(data);
+            continue;
+        }
+
+        corpus_entry_t *entry = &g_corpus[g_corpus_count++];
+        memcpy(entry->name, ent->d_name, name_len - 5);
+        entry->name[name_len - 5] = '\0';
+        entry->data = data;
+        entry->len = (size_t)size;
+        entry->head_len = parser.headers_end;
+        entry->chunked = parser.chunked;
+    }
+    closedir(dir);
+
+    qsort(g_corpus, g_corpus_count, sizeof(corpus_entry_t), corpus_compare);
+    return 0;
+}
+
+/* === HTTP/1.1 === */
+
+/* Response head scan, recording header spans */
+static void bench_parse_head(const bench_t *bench, uint64_t iterations, int thread) {
+    const corpus_entry_t *entry = bench->arg;
+    http1_header_span_t spans[HTTP1_MAX_HEADERS];
+    (void)thread;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        http1_parser_t parser;
+        http1_parser_init(&parser, spans, HTTP1_MAX_HEADERS);
+        http1_parser_feed(&parser, entry->data, entry->head_len);
+        g_sink += parser.header_count;
+    }
+}
+
+/* A whole response through the blocking reader; the readahead buffer
+ * stands in for the socket (its refill is the one copy a read would do) */
+static void bench_recv_response(const bench_t *bench, uint64_t iterations, int thread) {
+    const corpus_entry_t *entry = bench->arg;
+    httpmorph_buffer_pool_t *pool = buffer_pool_create();
+    httpmorph_request_t *request = httpmorph_request_create(HTTPMORPH_GET, "http://bench.test/");
+    http1_readahead_t readahead = {0};
+    readahead.data = malloc(entry->len);
+    readahead.capacity = entry->len;
+    (void)thread;
+
+    for (uint64_t i = 0; pool && request && readahead.data && i < iterations; i++) {
+        memcpy(readahead.data, entry->data, entry->len);
+        readahead.start = 0;
+        readahead.len = entry->len;
+
+        httpmorph_response_t *response = httpmorph_response_create(pool);
+        uint64_t first_byte_us = 0;
+        bool will_close = false;
+        if (response && httpmorph_recv_http_response(NULL, -1, response, &first_byte_us,
+                                                     &will_close, request, &readahead) == 0) {
+            g_sink += response->body_len + response->header_count;
+        }
+        httpmorph_response_destroy(response);
+    }
+
+    http1_readahead_free(&readahead);
+    httpmorph_request_destroy(request);
+    buffer_pool_destroy(pool);
+}
+
+/* Chunk framing stripped from a body (after copying it back in) */
+static void bench_chunked_decode(const bench_t *bench, uint64_t iterations, int thread) {
+    const corpus_entry_t *entry = bench->arg;
+    size_t body_len = entry->len - entry->head_len;
+    char *scratch = malloc(body_len);
+    (void)thread;
+
+    for (uint64_t i = 0; scratch && i < iterations; i++) {
+        memcpy(scratch, entry->data + entry->head_len, body_len);
+        http1_chunked_t decoder;
+        http1_chunked_init(&decoder);
+        size_t len = body_len;
+        size_t rest = 0;
+        if (http1_chunked_decode(&decoder, scratch, &len, &rest) == HTTP1_CHUNKED_DONE) {
+            g_sink += len;
+        }
+    }
+    free(scratch);
+}
+
+/* A navigation request head, built the way http1.c builds it */
+static void bench_request_builder(const bench_t *bench, uint64_t iterations, int thread) {
+    (void)bench;
+    (void)thread;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        request_builder_t *builder = request_builder_create(1024);
+        if (!builder) {
+            return;
+        }
+        request_builder_append_str(builder, "GET ");
+        request_builder_append_str(builder, "/search?q=connection+pooling&hl=en");
+        request_builder_append_str(builder, " HTTP/1.1\r\n");
+        request_builder_append_header(builder, "Host", 4, "www.example.com", 15);
+        for (size_t h = 0; h < CHROME_HEADER_COUNT; h++) {
+            request_builder_append_header(builder, g_chrome_headers[h][0], strlen(g_chrome_headers[h][0]),
+                                          g_chrome_headers[h][1], strlen(g_chrome_headers[h][1]));
+        }
+        request_builder_append_str(builder, "\r\n");
+
+        size_t len = 0;
+        request_builder_data(builder, &len);
+        g_sink += len;
+        request_builder_destroy(builder);
+    }
+}
+
+/* === Pools === */
+
+typedef struct {
+    httpmorph_buffer_pool_t *pool;
+    size_t size;
+} buffer_pool_bench_t;
+
+/* Get and put a buffer of one tier */
+static void bench_buffer_pool(const bench_t *bench, uint64_t iterations, int thread) {
+    const buffer_pool_bench_t *state = bench->state;
+    (void)thread;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        size_t actual = 0;
+        void *buf = buffer_pool_get(state->pool, state->size, &actual);
+        if (buf) {
+            ((volatile char *)buf)[0] = 1;
+            buffer_pool_put(state->pool, buf, actual);
+        }
+    }
+}
+
+typedef struct {
+    httpmorph_pool_t *pool;
+    char key[POOL_MAX_HOST_KEY_LEN];
+    int peers[POOL_MAX_CONNECTIONS_PER_HOST];   /* Other ends of the socket pairs */
+    int count;
+} connection_pool_bench_t;
+
+/* Check a connection to one origin out and back in; threads share the origin */
+static void bench_connection_pool(const bench_t *bench, uint64_t iterations, int thread) {
+    const connection_pool_bench_t *state = bench->state;
+    (void)thread;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        pooled_connection_t *conn = pool_get_connection_by_key(state->pool, state->key);
+        if (conn) {
+            pool_put_connection(state->pool, conn);
+            g_sink++;
+        }
+    }
+}
+
+static connection_pool_bench_t* connection_pool_bench_create(int connections) {
+    connection_pool_bench_t *state = calloc(1, sizeof(*state));
+    if (!state || !(state->pool = pool_create())) {
+        free(state);
+        return NULL;
+    }
+    pool_build_host_key("bench.test", 443, state->key);
+
+    if (connections > POOL_MAX_CONNECTIONS_PER_HOST) {
+        connections = POOL_MAX_CONNECTIONS_PER_HOST;
+    }
+    for (int i = 0; i < connections; i++) {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+            break;
+        }
+        pooled_connection_t *conn = pool_connection_create_with_key(state->key, fds[0], NULL, false);
+        if (!conn) {
+            close(fds[0]);
+            close(fds[1]);
+            break;
+        }
+        pool_put_connection(state->pool, conn);
+        state->peers[state->count++] = fds[1];
+    }
+    return state;
+}
+
+static void connection_pool_bench_destroy(connection_pool_bench_t *state) {
+    if (state) {
+        pool_destroy(state->pool);
+        for (int i = 0; i < state->count; i++) {
+            close(state->peers[i]);
+        }
+        free(state);
+    }
+}
+
+/* === Cookies === */
+
+typedef struct {
+    cookie_jar_t *jar;
+} cookie_bench_t;
+
+static cookie_bench_t g_cookies;
+
+/* A jar with 200 cookies over 20 domains, like a long browsing session */
+static void cookie_jar_fill(cookie_jar_t *jar) {
+    time_t now = 1792055564;
+    char header[256];
+    for (int d = 0; d < 20; d++) {
+        char host[64];
+        snprintf(host, sizeof(host), "www.site%d.example", d);
+        for (int c = 0; c < 10; c++) {
+            snprintf(header, sizeof(header),
+                     "c%d=%08x%08x; Domain=site%d.example; Path=%s; Max-Age=86400%s",
+                     c, (unsigned)(d * 7919 + c), (unsigned)(c * 104729 + d), d,
+                     c % 3 == 0 ? "/" : c % 3 == 1 ? "/search" : "/account",
+                     c % 2 ? "; Secure; HttpOnly" : "");
+            cookie_jar_set(jar, header, host, now);
+        }
+    }
+}
+
+/* Cookie header for a request to one of the domains */
+static void bench_cookie_header(const bench_t *bench, uint64_t iterations, int thread) {
+    (void)bench;
+    (void)thread;
+    time_t now = 1792055600;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        char *header = cookie_jar_header(g_cookies.jar, "www.site7.example", "/search/results",
+                                         true, now);
+        if (header) {
+            g_sink += strlen(header);
+            free(header);
+        }
+    }
+}
+
+/* Set-Cookie storage (replacing the same cookie each round) */
+static void bench_cookie_set(const bench_t *bench, uint64_t iterations, int thread) {
+    (void)bench;
+    (void)thread;
+    time_t now = 1792055600;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        g_sink += (uint64_t)cookie_jar_set(g_cookies.jar,
+            "NID=519=Jq2Vx8k1Lm0bT4rYwE6uI9oP3aS5dF7gH2jK8lZ1xC4vB6nM0qW3eR5tY7; "
+            "expires=Fri, 16-Apr-2027 09:12:44 GMT; path=/; domain=.site3.example; HttpOnly",
+            "www.site3.example", now);
+    }
+}
+
+/* === Decompression === */
+
+typedef struct {
+    uint8_t *gzip;
+    size_t gzip_len;
+    size_t plain_len;
+} gzip_bench_t;
+
+static gzip_bench_t g_gzip;
+
+static int gzip_bench_create(size_t plain_len) {
+    char *plain = malloc(plain_len);
+    if (!plain) {
+        return -1;
+    }
+    fill_text(plain, plain_len, 42);
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(plain);
+        return -1;
+    }
+    size_t bound = deflateBound(&zs, (uLong)plain_len);
+    g_gzip.gzip = malloc(bound);
+    zs.next_in = (Bytef *)plain;
+    zs.avail_in = (uInt)plain_len;
+    zs.next_out = g_gzip.gzip;
+    zs.avail_out = (uInt)bound;
+    int rc = g_gzip.gzip ? deflate(&zs, Z_FINISH) : Z_MEM_ERROR;
+    g_gzip.gzip_len = zs.total_out;
+    g_gzip.plain_len = plain_len;
+    deflateEnd(&zs);
+    free(plain);
+    return rc == Z_STREAM_END ? 0 : -1;
+}
+
+static int gzip_bench_output(void *ctx, const uint8_t *data, size_t len) {
+    (void)data;
+    *(size_t *)ctx += len;
+    return 0;
+}
+
+/* A gzip body decoded in 16 KB reads, as the response reader feeds it */
+static void bench_gzip_decode(const bench_t *bench, uint64_t iterations, int thread) {
+    (void)bench;
+    (void)thread;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        httpmorph_decoder_t *decoder = httpmorph_decoder_create("gzip", NULL);
+        if (!decoder) {
+            return;
+        }
+        size_t out = 0;
+        for (size_t pos = 0; pos < g_gzip.gzip_len; pos += 16384) {
+            size_t n = g_gzip.gzip_len - pos < 16384 ? g_gzip.gzip_len - pos : 16384;
+            httpmorph_decoder_write(decoder, g_gzip.gzip + pos, n, gzip_bench_output, &out);
+        }
+        httpmorph_decoder_finish(decoder, gzip_bench_output, &out);
+        httpmorph_decoder_destroy(decoder);
+        g_sink += out;
+    }
+}
+
+/* === HTTP/2 header compression === */
+
+#define HPACK_MAX_NV (HEADER_TEMPLATE_H2_PREFIX + CHROME_HEADER_COUNT)
+
+static size_t chrome_h2_headers(nghttp2_nv *nva) {
+    size_t n = (size_t)header_template_h2_prefix(nva, HTTPMORPH_GET,
+                                                 "/search?q=connection+pooling&hl=en",
+                                                 "www.example.com");
+    for (size_t h = 0; h < CHROME_HEADER_COUNT; h++) {
+        nghttp2_nv *nv = &nva[n++];
+        nv->name = (uint8_t *)g_chrome_headers[h][0];
+        nv->namelen = strlen(g_chrome_headers[h][0]);
+        nv->value = (uint8_t *)g_chrome_headers[h][1];
+        nv->valuelen = strlen(g_chrome_headers[h][1]);
+        nv->flags = NGHTTP2_NV_FLAG_NONE;
+    }
+    return n;
+}
+
+/* Request headers encoded on a connection that has sent them before */
+static void bench_hpack_deflate(const bench_t *bench, uint64_t iterations, int thread) {
+    (void)bench;
+    (void)thread;
+    nghttp2_nv nva[HPACK_MAX_NV];
+    size_t nvlen = chrome_h2_headers(nva);
+    uint8_t block[4096];
+    nghttp2_hd_deflater *deflater = NULL;
+    if (nghttp2_hd_deflate_new(&deflater, 4096) != 0) {
+        return;
+    }
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        ssize_t n = nghttp2_hd_deflate_hd(deflater, block, sizeof(block), nva, nvlen);
+        g_sink += (uint64_t)n;
+    }
+    nghttp2_hd_deflate_del(deflater);
+}
+
+/* Response headers from the corpus decoded (the block is encoded once) */
+static void bench_hpack_inflate(const bench_t *bench, uint64_t iterations, int thread) {
+    const corpus_entry_t *entry = bench->arg;
+    (void)thread;
+
+    http1_header_span_t spans[HTTP1_MAX_HEADERS];
+    http1_parser_t parser;
+    http1_parser_init(&parser, spans, HTTP1_MAX_HEADERS);
+    http1_parser_feed(&parser, entry->data, entry->head_len);
+
+    /* Lowercase names, as HTTP/2 requires */
+    char *names = malloc(entry->head_len);
+    nghttp2_nv *nva = calloc(parser.header_count + 1, sizeof(nghttp2_nv));
+    uint8_t *block = malloc(entry->head_len + 64);
+    nghttp2_hd_deflater *deflater = NULL;
+    nghttp2_hd_inflater *inflater = NULL;
+    if (!names || !nva || !block || nghttp2_hd_deflate_new(&deflater, 4096) != 0 ||
+        nghttp2_hd_inflate_new(&inflater) != 0) {
+        goto done;
+    }
+
+    nva[0].name = (uint8_t *)":status";
+    nva[0].namelen = 7;
+    nva[0].value = (uint8_t *)entry->data + 9;
+    nva[0].valuelen = 3;
+    for (size_t h = 0; h < parser.header_count; h++) {
+        for (uint32_t c = 0; c < spans[h].name_len; c++) {
+            char ch = entry->data[spans[h].name + c];
+            names[spans[h].name + c] = (char)(ch >= 'A' && ch <= 'Z' ? ch + 32 : ch);
+        }
+        nva[h + 1].name = (uint8_t *)names + spans[h].name;
+        nva[h + 1].namelen = spans[h].name_len;
+        nva[h + 1].value = (uint8_t *)entry->data + spans[h].value;
+        nva[h + 1].valuelen = spans[h].value_len;
+    }
+    ssize_t block_len = nghttp2_hd_deflate_hd(deflater, block, entry->head_len + 64, nva,
+                                                     parser.header_count + 1);
+    if (block_len < 0) {
+        goto done;
+    }
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        const uint8_t *in = block;
+        size_t left = (size_t)block_len;
+        for (;;) {
+            nghttp2_nv nv;
+            int flags = 0;
+            ssize_t n = nghttp2_hd_inflate_hd2(inflater, &nv, &flags, in, left, 1);
+            if (n < 0) {
+                goto done;
+            }
+            in += n;
+            left -= (size_t)n;
+            if (flags & NGHTTP2_HD_INFLATE_EMIT) {
+                g_sink += nv.valuelen;
+            }
+            if (flags & NGHTTP2_HD_INFLATE_FINAL) {
+                nghttp2_hd_inflate_end_headers(inflater);
+                break;
+            }
+            if (n == 0 && left == 0) {
+                break;
+            }
+        }
+    }
+
+done:
+    nghttp2_hd_inflate_del(inflater);
+    nghttp2_hd_deflate_del(deflater);
+    free(block);
+    free(nva);
+    free(names);
+}
+
+/* === TLS fingerprint === */
+
+typedef struct {
+    SSL_CTX *ctx;
+    SSL *ssl;
+    const browser_profile_t *profile;
+} ja3_bench_t;
+
+static ja3_bench_t g_ja3;
+
+/* JA3 string built from the profile (what every new connection used to pay) */
+static void bench_ja3_compute(const bench_t *bench, uint64_t iterations, int thread) {
+    (void)bench;
+    (void)thread;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        char *ja3 = httpmorph_calculate_ja3(g_ja3.ssl, g_ja3.profile);
+        if (ja3) {
+            g_sink += strlen(ja3);
+            free(ja3);
+        }
+    }
+}
+
+/* JA3 lookup in the per-profile cache */
+static void bench_ja3_cached(const bench_t *bench, uint64_t iterations, int thread) {
+    (void)bench;
+    (void)thread;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        const char *ja3 = httpmorph_tls_ja3(g_ja3.ssl, g_ja3.profile);
+        g_sink += ja3 ? (uint64_t)(uintptr_t)ja3 : 0;
+    }
+}
+
+/* === Harness === */
+
+static bench_t* bench_add(bench_fn_t run, const void *arg, size_t bytes, const char *fmt, ...) {
+    if (g_bench_count >= BENCH_MAX) {
+        return NULL;
+    }
+    bench_t *bench = &g_benches[g_bench_count++];
+    memset(bench, 0, sizeof(*bench));
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(bench->name, sizeof(bench->name), fmt, ap);
+    va_end(ap);
+    bench->run = run;
+    bench->arg = arg;
+    bench->bytes = bytes;
+    bench->threads = 1;
+    return bench;
+}
+
+typedef struct {
+    const bench_t *bench;
+    uint64_t iterations;
+    int thread;
+    atomic_int *ready;
+    atomic_int *go;
+} bench_thread_t;
+
+static void* bench_thread_main(void *arg) {
+    bench_thread_t *t = arg;
+    atomic_fetch_add(t->ready, 1);
+    while (!atomic_load(t->go)) {
+        /* Spin so every thread starts at once */
+    }
+    t->bench->run(t->bench, t->iterations, t->thread);
+    return NULL;
+}
+
+/* Run each thread's share of `iterations` rounds and time the whole */
+static bench_result_t bench_run_once(const bench_t *bench, uint64_t iterations) {
+    bench_result_t result = {iterations * (uint64_t)bench->threads, 0, 0};
+
+    if (bench->threads == 1) {
+        double cpu0 = cpu_ns();
+        double t0 = now_ns();
+        bench->run(bench, iterations, 0);
+        result.real_ns = now_ns() - t0;
+        result.cpu_ns = cpu_ns() - cpu0;
+        return result;
+    }
+
+    pthread_t threads[BENCH_MAX_THREADS];
+    bench_thread_t args[BENCH_MAX_THREADS];
+    atomic_int ready = 0;
+    atomic_int go = 0;
+    int started = 0;
+    for (int i = 0; i < bench->threads; i++) {
+        args[i] = (bench_thread_t){bench, iterations, i, &ready, &go};
+        if (pthread_create(&threads[i], NULL, bench_thread_main, &args[i]) != 0) {
+            break;
+        }
+        started++;
+    }
+    while (atomic_load(&ready) < started) {
+        /* Wait for every thread to be at the gate */
+    }
+    double cpu0 = cpu_ns();
+    double t0 = now_ns();
+    atomic_store(&go, 1);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    result.real_ns = now_ns() - t0;
+    result.cpu_ns = cpu_ns() - cpu0;
+    result.iterations = iterations * (uint64_t)started;
+    return result;
+}
+
+/* Grow the round count until a run lasts min_time */
+static bench_result_t bench_run(const bench_t *bench, double min_time_s) {
+    double min_ns = min_time_s * 1e9;
+    uint64_t iterations = 1;
+    for (;;) {
+        bench_result_t result = bench_run_once(bench, iterations);
+        if (result.real_ns >= min_ns || iterations >= 1000000000ULL) {
+            return result;
+        }
+        double scale = result.real_ns > 0 ? min_ns * 1.4 / result.real_ns : 10;
+        if (scale > 10) scale = 10;
+        if (scale < 2) scale = 2;
+        iterations = (uint64_t)((double)iterations * scale);
+    }
+}
+
+static void json_string(FILE *f, const char *s) {
+    fputc('"', f);
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\') {
+            fputc('\\', f);
+        }
+        fputc(*s, f);
+    }
+    fputc('"', f);
+}
+
+static void register_benchmarks(int max_threads) {
+    for (size_t i = 0; i < g_corpus_count; i++) {
+        const corpus_entry_t *entry = &g_corpus[i];
+        bench_add(bench_parse_head, entry, entry->head_len, "http1_parse_head/%s", entry->name);
+        bench_add(bench_recv_response, entry, entry->len, "http1_recv_response/%s", entry->name);
+        if (entry->chunked) {
+            bench_add(bench_chunked_decode, entry, entry->len - entry->head_len,
+                      "http1_chunked_decode/%s", entry->name);
+        }
+    }
+    bench_add(bench_request_builder, NULL, 0, "request_builder/chrome_navigation");
+
+    static buffer_pool_bench_t buffer_states[2];
+    static const size_t buffer_sizes[2] = {BUFFER_SIZE_16KB, BUFFER_SIZE_256KB};
+    httpmorph_buffer_pool_t *buffer_pool = buffer_pool_create();
+    static connection_pool_bench_t *connection_states[BENCH_MAX_THREADS + 1];
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        for (int s = 0; s < 2; s++) {
+            buffer_states[s].pool = buffer_pool;
+            buffer_states[s].size = buffer_sizes[s];
+            bench_t *bench = bench_add(bench_buffer_pool, NULL, 0, "buffer_pool/get_put/%zu/threads:%d",
+                                       buffer_sizes[s], threads);
+            if (bench) {
+                bench->state = &buffer_states[s];
+                bench->threads = threads;
+            }
+        }
+
+        connection_states[threads] = connection_pool_bench_create(threads);
+        bench_t *bench = bench_add(bench_connection_pool, NULL, 0, "connection_pool/checkout/threads:%d",
+                                   threads);
+        if (bench) {
+            bench->state = connection_states[threads];
+            bench->threads = threads;
+            if (!bench->state) {
+                g_bench_count--;
+            }
+        }
+    }
+
+    g_cookies.jar = cookie_jar_create(COOKIE_JAR_DEFAULT_MAX);
+    if (g_cookies.jar) {
+        cookie_jar_fill(g_cookies.jar);
+        bench_add(bench_cookie_header, NULL, 0, "cookies/header/200_cookies");
+        bench_add(bench_cookie_set, NULL, 0, "cookies/set/replace");
+    }
+
+    if (gzip_bench_create(256 * 1024) == 0) {
+        bench_add(bench_gzip_decode, NULL, g_gzip.gzip_len, "decompress/gzip/256k_text");
+    }
+
+    bench_add(bench_hpack_deflate, NULL, 0, "hpack/deflate/chrome_navigation");
+    for (size_t i = 0; i < g_corpus_count; i++) {
+        bench_add(bench_hpack_inflate, &g_corpus[i], g_corpus[i].head_len,
+                  "hpack/inflate/%s", g_corpus[i].name);
+    }
+
+    g_ja3.ctx = SSL_CTX_new(TLS_method());
+    g_ja3.ssl = g_ja3.ctx ? SSL_new(g_ja3.ctx) : NULL;
+    g_ja3.profile = browser_profile_by_type("chrome");
+    if (g_ja3.ssl && g_ja3.profile) {
+        bench_add(bench_ja3_compute, NULL, 0, "ja3/compute/chrome");
+        bench_add(bench_ja3_cached, NULL, 0, "ja3/cached/chrome");
+    }
+}
+
+int main(int argc, char **argv) {
+    const char *filter = NULL;
+    const char *corpus_dir = "benchmarks/core/corpus";
+    const char *json_path = NULL;
+    double min_time = BENCH_DEFAULT_MIN_TIME;
+    int max_threads = 8;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else if (strncmp(argv[i], "--min-time=", 11) == 0) {
+            min_time = atof(argv[i] + 11);
+        } else if (strncmp(argv[i], "--corpus=", 9) == 0) {
+            corpus_dir = argv[i] + 9;
+        } else if (strncmp(argv[i], "--json=", 7) == 0) {
+            json_path = argv[i] + 7;
+        } else if (strncmp(argv[i], "--threads=", 10) == 0) {
+            max_threads = atoi(argv[i] + 10);
+        } else {
+            fprintf(stderr, "usage: %s [--filter=TEXT] [--min-time=SECONDS] [--corpus=DIR] "
+                            "[--threads=N] [--json=FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (max_threads < 1) max_threads = 1;
+    if (max_threads > BENCH_MAX_THREADS) max_threads = BENCH_MAX_THREADS;
+    if (min_time <= 0) min_time = BENCH_DEFAULT_MIN_TIME;
+
+    if (httpmorph_init() != 0) {
+        fprintf(stderr, "microbench: httpmorph_init failed\n");
+        return 1;
+    }
+    if (corpus_load(corpus_dir) != 0) {
+        return 1;
+    }
+    register_benchmarks(max_threads);
+
+    FILE *json = NULL;
+    if (json_path) {
+        json = fopen(json_path, "w");
+        if (!json) {
+            fprintf(stderr, "microbench: cannot write %s\n", json_path);
+            return 1;
+        }
+        char date[64];
+        time_t now = time(NULL);
+        strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S%z", localtime(&now));
+        fprintf(json, "{\n  \"context\": {\n    \"date\": \"%s\",\n    \"executable\": ", date);
+        json_string(json, argv[0]);
+        fprintf(json, ",\n    \"num_cpus\": %ld,\n    \"library_version\": \"%s\",\n"
+                      "    \"library_build_type\": \"release\"\n  },\n  \"benchmarks\": [",
+                sysconf(_SC_NPROCESSORS_ONLN), httpmorph_version());
+    }
+
+    printf("%-56s %14s %14s %14s\n", "Benchmark", "Time (ns)", "CPU (ns)", "Iterations");
+    bool first = true;
+    for (size_t i = 0; i < g_bench_count; i++) {
+        const bench_t *bench = &g_benches[i];
+        if (filter && !strstr(bench->name, filter)) {
+            continue;
+        }
+
+        bench_result_t result = bench_run(bench, min_time);
+        /* Per round as one thread sees it; CPU is spread over the threads */
+        double real_per = result.real_ns * bench->threads / (double)result.iterations;
+        double cpu_per = result.cpu_ns / (double)result.iterations;
+        double items_per_second = (double)result.iterations / (result.real_ns / 1e9);
+        printf("%-56s %14.1f %14.1f %14llu", bench->name, real_per, cpu_per,
+               (unsigned long long)result.iterations);
+        if (bench->bytes) {
+            printf("  %.1f MB/s", items_per_second * (double)bench->bytes / 1e6);
+        }
+        printf("\n");
+        fflush(stdout);
+
+        if (json) {
+            fprintf(json, "%s\n    {\n      \"name\": ", first ? "" : ",");
+            json_string(json, bench->name);
+            fprintf(json, ",\n      \"run_name\": ");
+            json_string(json, bench->name);
+            fprintf(json, ",\n      \"run_type\": \"iteration\",\n      \"threads\": %d,\n"
+                          "      \"iterations\": %llu,\n      \"real_time\": %.3f,\n"
+                          "      \"cpu_time\": %.3f,\n      \"time_unit\": \"ns\",\n"
+                          "      \"items_per_second\": %.3f",
+                    bench->threads, (unsigned long long)result.iterations, real_per, cpu_per,
+                    items_per_second);
+            if (bench->bytes) {
+                fprintf(json, ",\n      \"bytes_per_second\": %.3f", items_per_second * (double)bench->bytes);
+            }
+            fprintf(json, "\n    }");
+            first = false;
+        }
+    }
+
+    if (json) {
+        fprintf(json, "\n  ]\n}\n");
+        fclose(json);
+    }
+
+    for (int threads = 1; threads <= BENCH_MAX_THREADS; threads++) {
+        for (size_t i = 0; i < g_bench_count; i++) {
+            if (g_benches[i].run == bench_connection_pool && g_benches[i].threads == threads) {
+                connection_pool_bench_destroy(g_benches[i].state);
+                break;
+            }
+        }
+    }
+    cookie_jar_destroy(g_cookies.jar);
+    free(g_gzip.gzip);
+    SSL_free(g_ja3.ssl);
+    SSL_CTX_free(g_ja3.ctx);
+    for (size_t i = 0; i < g_corpus_count; i++) {
+        free(g_corpus[i].data);
+    }
+    httpmorph_cleanup();
+    return 0;
+}
@@ -0,0 +1,766 @@
+#!/usr/bin/env python3
+"""
+Soak Benchmark
+
+Holds a steady load on a bundled local TLS server for minutes and reports
+what capacity planning needs: latency percentiles, throughput, RSS over
+time, connections and TLS handshakes, buffer pool hit rates and CPU per
+request. A leak shows as RSS growth per minute, a scaling cliff as
+intervals whose throughput drops or whose p99 climbs.
+
+Modes:
+    sync    one shared Client driven by worker threads (HTTP/1.1)
+    async   one AsyncClient driven by asyncio tasks (HTTP/1.1)
+    http2   one shared Client with HTTP/2, whose threads multiplex streams
+
+Load is either closed (--concurrency workers, each sending as soon as
+its last response arrived) or open (--rps requests per second spread over
+the workers). Open-loop latency is measured from when a request was due,
+so a stalled client shows up as latency rather than as fewer requests.
+
+The server runs in its own process (asyncio, self-signed certificate,
+ALPN h2 and http/1.1) so it doesn't compete with the client for the GIL.
+HTTP/2 needs the h2 package.
+
+Examples:
+    python benchmarks/soak.py --mode sync --concurrency 16 --duration 300
+    python benchmarks/soak.py --mode async --rps 2000 --concurrency 64
+    python benchmarks/soak.py --mode http2 --concurrency 32 --json soak.json
+"""
+
+import argparse
+import asyncio
+import itertools
+import json
+import math
+import multiprocessing
+import os
+import platform
+import ssl
+import sys
+import tempfile
+import threading
+import time
+from datetime import datetime
+
+import httpmorph
+
+# === Server ===
+
+
+def _create_certificate(directory):
+    """Write a self-signed certificate for 127.0.0.1; returns (cert, key) paths"""
+    import datetime as dt
+    import ipaddress
+
+    from cryptography import x509
+    from cryptography.hazmat.primitives import hashes, serialization
+    from cryptography.hazmat.primitives.asymmetric import ec
+    from cryptography.x509.oid import NameOID
+
+    key = ec.generate_private_key(ec.SECP256R1())
+    name = x509.Name([x509.NameAttribute(NameOID.COMMON_NAME, "localhost")])
+    now = dt.datetime.now(dt.timezone.utc)
+    cert = (
+        x509.CertificateBuilder()
+        .subject_name(name)
+        .issuer_name(name)
+        .public_key(key.public_key())
+        .serial_number(x509.random_serial_number())
+        .not_valid_before(now - dt.timedelta(days=1))
+        .not_valid_after(now + dt.timedelta(days=7))
+        .add_extension(
+            x509.SubjectAlternativeName(
+                [x509.DNSName("localhost"), x509.IPAddress(ipaddress.ip_address("127.0.0.1"))]
+            ),
+            critical=False,
+        )
+        .sign(key, hashes.SHA256())
+    )
+
+    cert_file = os.path.join(directory, "soak-cert.pem")
+    key_file = os.path.join(directory, "soak-key.pem")
+    with open(cert_file, "wb") as f:
+        f.write(cert.public_bytes(serialization.Encoding.PEM))
+    with open(key_file, "wb") as f:
+        f.write(
+            key.private_bytes(
+                serialization.Encoding.PEM,
+                serialization.PrivateFormat.PKCS8,
+                serialization.NoEncryption(),
+            )
+        )
+    return cert_file, key_file
+
+
+def _response_size(path, default):
+    """Body size for a path: /bytes/N asks for N bytes"""
+    if path.startswith("/bytes/"):
+        try:
+            return int(path[len("/bytes/") :].split("?")[0])
+        except ValueError:
+            pass
+    return default
+
+
+async def _serve_http1(reader, writer, payload, latency_s):
+    while True:
+        try:
+            head = await reader.readuntil(b"\r\n\r\n")
+        except (asyncio.IncompleteReadError, asyncio.LimitOverrunError, ConnectionError):
+            return
+        lines = head.decode("latin-1").split("\r\n")
+        path = lines[0].split(" ")[1] if lines[0].count(" ") >= 2 else "/"
+        length = 0
+        close = False
+        for line in lines[1:]:
+            name, _, value = line.partition(":")
+            name = name.strip().lower()
+            if name == "content-length":
+                length = int(value.strip() or 0)
+            elif name == "connection" and value.strip().lower() == "close":
+                close = True
+        if length:
+            await reader.readexactly(length)
+        if latency_s:
+            await asyncio.sleep(latency_s)
+
+        size = _response_size(path, len(payload))
+        body = payload[:size] if size <= len(payload) else b"x" * size
+        writer.write(
+            b"HTTP/1.1 200 OK\r\nContent-Type: application/octet-stream\r\n"
+            b"Content-Length: %d\r\n\r\n" % len(body) + body
+        )
+        try:
+            await writer.drain()
+        except ConnectionError:
+            return
+        if close:
+            return
+
+
+async def _serve_http2(reader, writer, payload, latency_s):
+    import h2.config
+    import h2.connection
+    import h2.events
+
+    conn = h2.connection.H2Connection(
+        config=h2.config.H2Configuration(client_side=False, header_encoding="utf-8")
+    )
+    conn.initiate_connection()
+    writer.write(conn.data_to_send())
+
+    paths = {}
+    pending = {}  # stream ID -> body bytes not yet sent
+
+    def flush():
+        for stream_id in list(pending):
+            body = pending[stream_id]
+            while body:
+                window = min(
+                    conn.local_flow_control_window(stream_id), conn.max_outbound_frame_size
+                )
+                if window <= 0:
+                    break
+                conn.send_data(stream_id, body[:window], end_stream=len(body) <= window)
+                body = body[window:]
+            if body:
+                pending[stream_id] = body
+            else:
+                del pending[stream_id]
+        writer.write(conn.data_to_send())
+
+    def respond(stream_id):
+        size = _response_size(paths.pop(stream_id, "/"), len(payload))
+        body = payload[:size] if size <= len(payload) else b"x" * size
+        conn.send_headers(
+            stream_id,
+            [
+                (":status", "200"),
+                ("content-type", "application/octet-stream"),
+                ("content-length", str(len(body))),
+            ],
+            end_stream=not body,
+        )
+        if body:
+            pending[stream_id] = body
+        flush()
+
+    async def respond_later(stream_id):
+        await asyncio.sleep(latency_s)
+        respond(stream_id)
+
+    while True:
+        try:
+            data = await reader.read(65536)
+        except ConnectionError:
+            return
+        if not data:
+            return
+        try:
+            events = conn.receive_data(data)
+        except Exception:
+            return
+        for event in events:
+            if isinstance(event, h2.events.RequestReceived):
+                paths[event.stream_id] = dict(event.headers).get(":path", "/")
+            elif isinstance(event, h2.events.StreamEnded):
+                if latency_s:
+                    asyncio.ensure_future(respond_later(event.stream_id))
+                else:
+                    respond(event.stream_id)
+            elif isinstance(event, h2.events.StreamReset):
+                paths.pop(event.stream_id, None)
+                pending.pop(event.stream_id, None)
+            elif isinstance(event, h2.events.ConnectionTerminated):
+                writer.write(conn.data_to_send())
+                return
+        flush()
+        try:
+            await writer.drain()
+        except ConnectionError:
+            return
+
+
+def _server_main(cert_file, key_file, payload_bytes, latency_ms, port_queue):
+    """Server process entry point"""
+    try:
+        import h2  # noqa: F401
+
+        alpn = ["h2", "http/1.1"]
+    except ImportError:
+        alpn = ["http/1.1"]
+
+    context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+    context.load_cert_chain(cert_file, key_file)
+    context.set_alpn_protocols(alpn)
+    payload = b"x" * payload_bytes
+    latency_s = latency_ms / 1000.0
+
+    async def handle(reader, writer):
+        ssl_object = writer.get_extra_info("ssl_object")
+        try:
+            if ssl_object is not None and ssl_object.selected_alpn_protocol() == "h2":
+                await _serve_http2(reader, writer, payload, latency_s)
+            else:
+                await _serve_http1(reader, writer, payload, latency_s)
+        finally:
+            writer.close()
+
+    async def main():
+        server = await asyncio.start_server(handle, "127.0.0.1", 0, ssl=context, backlog=1024)
+        port_queue.put((server.sockets[0].getsockname()[1], alpn))
+        async with server:
+            await server.serve_forever()
+
+    asyncio.run(main())
+
+
+class SoakServer:
+    """Local HTTPS server (HTTP/1.1 and, with h2 installed, HTTP/2) in a child process"""
+
+    def __init__(self, payload_bytes, latency_ms):
+        self.payload_bytes = payload_bytes
+        self.latency_ms = latency_ms
+        self.process = None
+        self.port = None
+        self.alpn = []
+        self._tmpdir = None
+
+    @property
+    def url(self):
+        return f"https://127.0.0.1:{self.port}/"
+
+    def start(self):
+        self._tmpdir = tempfile.TemporaryDirectory(prefix="httpmorph-soak-")
+        cert_file, key_file = _create_certificate(self._tmpdir.name)
+        ctx = multiprocessing.get_context("spawn")
+        port_queue = ctx.Queue()
+        self.process = ctx.Process(
+            target=_server_main,
+            args=(cert_file, key_file, self.payload_bytes, self.latency_ms, port_queue),
+            daemon=True,
+        )
+        self.process.start()
+        self.port, self.alpn = port_queue.get(timeout=30)
+
+    def stop(self):
+        if self.process:
+            self.process.terminate()
+            self.process.join(timeout=5)
+        if self._tmpdir:
+            self._tmpdir.cleanup()
+
+
+# === Measurement ===
+
+
+def rss_bytes():
+    """Current resident set size (peak RSS where the current one isn't available)"""
+    try:
+        with open("/proc/self/statm") as f:
+            return int(f.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+    except (OSError, ValueError, IndexError):
+        pass
+    try:
+        import resource
+
+        peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        return peak if sys.platform == "darwin" else peak * 1024
+    except (ImportError, OSError):
+        return 0
+
+
+def percentile(sorted_values, pct):
+    """Nearest-rank percentile of an ascending list"""
+    if not sorted_values:
+        return 0.0
+    rank = math.ceil(pct / 100.0 * len(sorted_values)) - 1
+    return sorted_values[max(0, min(len(sorted_values) - 1, rank))]
+
+
+class LatencyHistogram:
+    """Latencies in log-spaced buckets 1% apart: fixed memory for any run length"""
+
+    RATIO = 1.01
+
+    def __init__(self):
+        self.counts = {}
+        self.total = 0
+        self.max_s = 0.0
+
+    def add(self, latency_s):
+        bucket = int(math.log(max(latency_s * 1e6, 1.0)) / math.log(self.RATIO))
+        self.counts[bucket] = self.counts.get(bucket, 0) + 1
+        self.total += 1
+        self.max_s = max(self.max_s, latency_s)
+
+    def percentile(self, pct):
+        """Nearest-rank percentile (bucket middle), in seconds"""
+        target = max(1, math.ceil(pct / 100.0 * self.total))
+        seen = 0
+        for bucket in sorted(self.counts):
+            seen += self.counts[bucket]
+            if seen >= target:
+                return min(self.RATIO ** (bucket + 0.5) / 1e6, self.max_s)
+        return 0.0
+
+    def summary(self):
+        return {
+            "p50_ms": self.percentile(50) * 1000,
+            "p90_ms": self.percentile(90) * 1000,
+            "p99_ms": self.percentile(99) * 1000,
+            "p99_9_ms": self.percentile(99.9) * 1000,
+            "max_ms": self.max_s * 1000,
+        }
+
+
+class Recorder:
+    """Collects one record per request until the sampler takes them"""
+
+    def __init__(self):
+        self.recording = False
+        self.records = []  # (latency_s, ok, new_connection, tls_handshake)
+
+    def add(self, latency_s, response):
+        if not self.recording:
+            return
+        if response is None:
+            self.records.append((latency_s, False, False, False))
+            return
+        ok = 200 <= response.status_code < 400
+        self.records.append(
+            (latency_s, ok, response.connect_time_us > 0, response.tls_time_us > 0)
+        )
+
+    def take(self):
+        """Records since the last call (the swap is atomic under the GIL)"""
+        records, self.records = self.records, []
+        return records
+
+
+class Sampler(threading.Thread):
+    """Folds records into totals and reports an interval row every `interval` seconds
+
+    Records are dropped once counted, so the benchmark's own memory stays
+    flat and RSS growth is the client's.
+    """
+
+    def __init__(self, recorder, interval, quiet=False):
+        super().__init__(daemon=True)
+        self.recorder = recorder
+        self.interval = interval
+        self.quiet = quiet
+        self.rows = []
+        self.latency = LatencyHistogram()
+        self.requests = 0
+        self.errors = 0
+        self.opened = 0
+        self.handshakes = 0
+        self.stopped = threading.Event()
+        self._start = None
+        self._last_time = None
+        self._last_cpu = None
+
+    def begin(self):
+        self.recorder.take()
+        self._start = self._last_time = time.perf_counter()
+        self._last_cpu = time.process_time()
+        if not self.quiet:
+            print(
+                f"{'elapsed':>8} {'req/s':>9} {'p50 ms':>8} {'p99 ms':>8} "
+                f"{'errors':>7} {'conns':>6} {'rss MB':>8} {'cpu %':>6}"
+            )
+        self.start()
+
+    def sample(self):
+        now = time.perf_counter()
+        cpu = time.process_time()
+        window = self.recorder.take()
+        elapsed = now - self._last_time
+        latencies = sorted(r[0] for r in window if r[1])
+        errors = sum(1 for r in window if not r[1])
+        opened = sum(1 for r in window if r[2])
+        for latency in latencies:
+            self.latency.add(latency)
+        self.requests += len(window)
+        self.errors += errors
+        self.opened += opened
+        self.handshakes += sum(1 for r in window if r[3])
+
+        row = {
+            "elapsed_s": now - self._start,
+            "requests": len(window),
+            "rps": len(window) / elapsed if elapsed > 0 else 0.0,
+            "p50_ms": percentile(latencies, 50) * 1000,
+            "p99_ms": percentile(latencies, 99) * 1000,
+            "errors": errors,
+            "new_connections": opened,
+            "rss_bytes": rss_bytes(),
+            "cpu_percent": (cpu - self._last_cpu) / elapsed * 100 if elapsed > 0 else 0.0,
+        }
+        self._last_time = now
+        self._last_cpu = cpu
+        self.rows.append(row)
+        if not self.quiet:
+            print(
+                f"{row['elapsed_s']:>7.0f}s {row['rps']:>9.1f} {row['p50_ms']:>8.2f} "
+                f"{row['p99_ms']:>8.2f} {row['errors']:>7} {row['new_connections']:>6} "
+                f"{row['rss_bytes'] / 1e6:>8.1f} {row['cpu_percent']:>6.1f}",
+                flush=True,
+            )
+
+    def run(self):
+        while not self.stopped.wait(self.interval):
+            self.sample()
+
+    def finish(self):
+        self.stopped.set()
+        self.join()
+        if self.recorder.records:
+            self.sample()
+
+
+def rss_growth_per_minute(rows):
+    """Least-squares RSS slope over the second half of the run (bytes/minute)
+
+    The first half is left out so pools, caches and allocator arenas can
+    reach their working size first.
+    """
+    half = rows[len(rows) // 2 :]
+    if len(half) < 2:
+        return 0.0
+    xs = [r["elapsed_s"] for r in half]
+    ys = [r["rss_bytes"] for r in half]
+    mean_x = sum(xs) / len(xs)
+    mean_y = sum(ys) / len(ys)
+    var = sum((x - mean_x) ** 2 for x in xs)
+    if var == 0:
+        return 0.0
+    slope = sum((x - mean_x) * (y - mean_y) for x, y in zip(xs, ys)) / var
+    return slope * 60
+
+
+def buffer_pool_summary(tiers):
+    if not tiers:
+        return None
+    hits = sum(t["hits"] for t in tiers)
+    misses = sum(t["misses"] for t in tiers)
+    return {
+        "hits": hits,
+        "misses": misses,
+        "hit_rate": hits / (hits + misses) if hits + misses else 0.0,
+        "tiers": tiers,
+    }
+
+
+# === Load ===
+
+
+class Schedule:
+    """Due times for open-loop load; None for closed-loop"""
+
+    def __init__(self, rps):
+        self.rps = rps
+        self._counter = itertools.count()
+        self.start = None
+
+    def restart(self):
+        self.start = time.perf_counter()
+        self._counter = itertools.count()
+
+    def next_due(self):
+        if not self.rps:
+            return None
+        return self.start + next(self._counter) / self.rps
+
+
+def run_sync(client, url, args, recorder, schedule, deadline):
+    def worker():
+        while True:
+            due = schedule.next_due()
+            if due is not None:
+                delay = due - time.perf_counter()
+                if delay > 0:
+                    time.sleep(delay)
+            begin = time.perf_counter()
+            if begin >= deadline():
+                return
+            try:
+                response = client.get(url, verify=False, timeout=args.timeout)
+            except Exception:
+                response = None
+            recorder.add(time.perf_counter() - (due if due is not None else begin), response)
+
+    threads = [threading.Thread(target=worker, daemon=True) for _ in range(args.concurrency)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+
+async def run_async(client, url, args, recorder, schedule, deadline):
+    async def worker():
+        while True:
+            due = schedule.next_due()
+            if due is not None:
+                delay = due - time.perf_counter()
+                if delay > 0:
+                    await asyncio.sleep(delay)
+            begin = time.perf_counter()
+            if begin >= deadline():
+                return
+            try:
+                response = await client.get(url, verify=False, timeout=args.timeout)
+            except Exception:
+                response = None
+            recorder.add(time.perf_counter() - (due if due is not None else begin), response)
+
+    await asyncio.gather(*(worker() for _ in range(args.concurrency)))
+
+
+def run(args, url):
+    recorder = Recorder()
+    sampler = Sampler(recorder, args.interval, quiet=args.quiet)
+    schedule = Schedule(args.rps)
+    phase = {"deadline": 0.0}
+
+    def deadline():
+        return phase["deadline"]
+
+    def phases(drive):
+        """Warm up (unrecorded), then the measured run"""
+        schedule.restart()
+        phase["deadline"] = schedule.start + args.warmup
+        drive()
+        schedule.restart()
+        phase["deadline"] = schedule.start + args.duration
+        recorder.recording = True
+        cpu_before = time.process_time()
+        start = time.perf_counter()
+        sampler.begin()
+        drive()
+        elapsed = time.perf_counter() - start
+        sampler.finish()
+        recorder.recording = False
+        return elapsed, time.process_time() - cpu_before
+
+    extra = {}
+    if args.mode == "async":
+
+        async def main():
+            async with httpmorph.AsyncClient() as client:
+                loop = asyncio.get_running_loop()
+
+                def drive():
+                    asyncio.run_coroutine_threadsafe(
+                        run_async(client, url, args, recorder, schedule, deadline), loop
+                    ).result()
+
+                result = await loop.run_in_executor(None, phases, drive)
+                extra["io"] = client.io_stats()
+                return result
+
+        elapsed, cpu_s = asyncio.run(main())
+    else:
+        client = httpmorph.Client(http2=args.mode == "http2")
+        elapsed, cpu_s = phases(lambda: run_sync(client, url, args, recorder, schedule, deadline))
+        extra["tls_sessions"] = client.tls_session_stats()
+        extra["buffer_pool"] = buffer_pool_summary(client.buffer_pool_stats())
+
+    rows = sampler.rows
+    interval_rps = [r["rps"] for r in rows[:-1]] or [r["rps"] for r in rows]
+    rss = [r["rss_bytes"] for r in rows]
+    tls_sessions = extra.get("tls_sessions") or {}
+
+    return {
+        "mode": args.mode,
+        "url": url,
+        "duration_s": elapsed,
+        "concurrency": args.concurrency,
+        "target_rps": args.rps or None,
+        "requests": sampler.requests,
+        "errors": sampler.errors,
+        "throughput_rps": sampler.requests / elapsed if elapsed > 0 else 0.0,
+        "latency": sampler.latency.summary(),
+        "connections": {
+            "opened": sampler.opened,
+            "tls_handshakes": sampler.handshakes,
+            "tls_resumptions": tls_sessions.get("resumptions"),
+        },
+        "buffer_pool": extra.get("buffer_pool"),
+        "io": extra.get("io"),
+        "cpu": {
+            "seconds": cpu_s,
+            "us_per_request": cpu_s / sampler.requests * 1e6 if sampler.requests else 0.0,
+        },
+        "rss": {
+            "start_bytes": rss[0] if rss else 0,
+            "end_bytes": rss[-1] if rss else 0,
+            "peak_bytes": max(rss) if rss else 0,
+            "growth_bytes_per_minute": rss_growth_per_minute(rows),
+        },
+        "throughput_stability": {
+            "min_interval_rps": min(interval_rps) if interval_rps else 0.0,
+            "max_interval_rps": max(interval_rps) if interval_rps else 0.0,
+        },
+        "intervals": rows,
+    }
+
+
+def print_summary(result):
+    lat = result["latency"]
+    conns = result["connections"]
+    rss = result["rss"]
+    stability = result["throughput_stability"]
+    print()
+    print(f"Mode:          {result['mode']}")
+    print(
+        f"Requests:      {result['requests']} ({result['errors']} failed) "
+        f"in {result['duration_s']:.1f}s"
+    )
+    print(
+        f"Throughput:    {result['throughput_rps']:.1f} req/s "
+        f"(intervals {stability['min_interval_rps']:.1f}..{stability['max_interval_rps']:.1f})"
+    )
+    print(
+        f"Latency (ms):  p50 {lat['p50_ms']:.2f}  p90 {lat['p90_ms']:.2f}  "
+        f"p99 {lat['p99_ms']:.2f}  p99.9 {lat['p99_9_ms']:.2f}  max {lat['max_ms']:.2f}"
+    )
+    resumed = conns["tls_resumptions"]
+    print(
+        f"Connections:   {conns['opened']} opened, {conns['tls_handshakes']} TLS handshakes"
+        + (f" ({resumed} resumed)" if resumed is not None else "")
+    )
+    if result["buffer_pool"]:
+        pool = result["buffer_pool"]
+        print(
+            f"Buffer pool:   {pool['hit_rate'] * 100:.1f}% hits "
+            f"({pool['hits']} reused, {pool['misses']} allocated)"
+        )
+    print(f"CPU:           {result['cpu']['us_per_request']:.1f} us/request")
+    print(
+        f"RSS (MB):      start {rss['start_bytes'] / 1e6:.1f}  end {rss['end_bytes'] / 1e6:.1f}  "
+        f"peak {rss['peak_bytes'] / 1e6:.1f}  "
+        f"growth {rss['growth_bytes_per_minute'] / 1e6:+.2f}/min"
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Sustained-load soak benchmark for httpmorph")
+    parser.add_argument(
+        "--mode",
+        choices=["sync", "async", "http2"],
+        default="sync",
+        help="Client to drive (default: sync)",
+    )
+    parser.add_argument(
+        "-c", "--concurrency", type=int, default=16, help="Worker threads or tasks (default: 16)"
+    )
+    parser.add_argument(
+        "--rps",
+        type=float,
+        default=0,
+        help="Target requests per second (default: 0, as fast as workers go)",
+    )
+    parser.add_argument(
+        "-d", "--duration", type=float, default=120, help="Measured seconds (default: 120)"
+    )
+    parser.add_argument(
+        "--warmup", type=float, default=5, help="Unrecorded seconds first (default: 5)"
+    )
+    parser.add_argument(
+        "--interval", type=float, default=5, help="Seconds per reported interval (default: 5)"
+    )
+    parser.add_argument(
+        "--payload", type=int, default=4096, help="Response body size in bytes (default: 4096)"
+    )
+    parser.add_argument(
+        "--latency-ms", type=float, default=0, help="Server delay per request (default: 0)"
+    )
+    parser.add_argument(
+        "--timeout", type=float, default=10, help="Request timeout in seconds (default: 10)"
+    )
+    parser.add_argument(
+        "--url", type=str, default=None, help="Load this URL instead of the bundled server"
+    )
+    parser.add_argument("--json", type=str, default=None, help="Write the results to this file")
+    parser.add_argument("--quiet", action="store_true", help="Only print the summary")
+    args = parser.parse_args()
+
+    server = None
+    url = args.url
+    if url is None:
+        server = SoakServer(args.payload, args.latency_ms)
+        server.start()
+        url = server.url
+        if args.mode == "http2" and "h2" not in server.alpn:
+            server.stop()
+            sys.exit("HTTP/2 mode needs the h2 package for the bundled server (pip install h2)")
+
+    httpmorph.init()
+    try:
+        print(
+            f"URL: {url}  mode: {args.mode}  concurrency: {args.concurrency}"
+            + (f"  target: {args.rps:g} req/s" if args.rps else "")
+        )
+        result = run(args, url)
+        print_summary(result)
+        if args.json:
+            result["system"] = {
+                "platform": platform.platform(),
+                "python": platform.python_version(),
+                "httpmorph": httpmorph.__version__,
+                "date": datetime.now().isoformat(timespec="seconds"),
+            }
+            with open(args.json, "w") as f:
+                json.dump(result, f, indent=2)
+            print(f"Results written to {args.json}")
+    finally:
+        httpmorph.cleanup()
+        if server:
+            server.stop()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""
+Threaded Scaling Benchmark
+
+Measures how sync httpmorph requests scale across Python threads. The GIL
+is released for request construction, execution (DNS, connect, TLS, body
+read) and the body handoff, so N threads should drive close to N requests
+at once against a server with per-request latency.
+
+Each run sends the same number of requests through one shared Client with
+1, 2, 4, ... worker threads and reports throughput and speedup over the
+single-threaded run.
+"""
+
+import argparse
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+import httpmorph
+
+
+class LatencyHTTPHandler(BaseHTTPRequestHandler):
+    """Answers every GET after a fixed delay, like a remote server would"""
+
+    protocol_version = "HTTP/1.1"
+    latency_s = 0.02
+    payload = b"x" * 1024
+
+    def do_GET(self):
+        time.sleep(self.latency_s)
+        self.send_response(200)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(len(self.payload)))
+        self.end_headers()
+        self.wfile.write(self.payload)
+
+    def log_message(self, _format, *_args):
+        pass
+
+
+class LatencyServer:
+    def __init__(self, latency_ms, payload_bytes):
+        LatencyHTTPHandler.latency_s = latency_ms / 1000.0
+        LatencyHTTPHandler.payload = b"x" * payload_bytes
+        self.server = ThreadingHTTPServer(("127.0.0.1", 0), LatencyHTTPHandler)
+        self.server.daemon_threads = True
+        self.thread = None
+
+    @property
+    def url(self):
+        return f"http://127.0.0.1:{self.server.server_port}/"
+
+    def start(self):
+        self.thread = threading.Thread(target=self.server.serve_forever, daemon=True)
+        self.thread.start()
+
+    def stop(self):
+        self.server.shutdown()
+        if self.thread:
+            self.thread.join(timeout=2)
+
+
+def run_threads(client, url, num_requests, num_threads):
+    """Send num_requests through num_threads workers; returns (seconds, failures)"""
+
+    def one(_):
+        response = client.get(url)
+        return response.status_code == 200
+
+    start = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=num_threads) as pool:
+        results = list(pool.map(one, range(num_requests)))
+    elapsed = time.perf_counter() - start
+    return elapsed, results.count(False)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Sync httpmorph scaling across Python threads")
+    parser.add_argument(
+        "-n", "--requests", type=int, default=200, help="Requests per run (default: 200)"
+    )
+    parser.add_argument(
+        "-t",
+        "--threads",
+        type=str,
+        default="1,2,4,8,16",
+        help="Comma-separated thread counts (default: 1,2,4,8,16)",
+    )
+    parser.add_argument(
+        "--latency-ms", type=float, default=20, help="Server delay per request (default: 20)"
+    )
+    parser.add_argument(
+        "--payload", type=int, default=1024, help="Response body size in bytes (default: 1024)"
+    )
+    parser.add_argument(
+        "--url", type=str, default=None, help="Benchmark this URL instead of the local server"
+    )
+    args = parser.parse_args()
+
+    thread_counts = [int(t) for t in args.threads.split(",") if t.strip()]
+
+    server = None
+    url = args.url
+    if url is None:
+        server = LatencyServer(args.latency_ms, args.payload)
+        server.start()
+        url = server.url
+
+    httpmorph.init()
+    try:
+        client = httpmorph.Client(http2=False)
+        for _ in range(5):
+            client.get(url)  # Warm up pool and caches
+
+        print(f"URL: {url}")
+        print(f"Requests per run: {args.requests}")
+        print()
+        print(f"{'threads':>8} {'seconds':>9} {'req/s':>9} {'speedup':>8} {'failed':>7}")
+
+        baseline = None
+        for threads in thread_counts:
+            elapsed, failed = run_threads(client, url, args.requests, threads)
+            rate = args.requests / elapsed if elapsed > 0 else 0.0
+            if baseline is None:
+                baseline = rate
+            speedup = rate / baseline if baseline else 0.0
+            print(f"{threads:>8} {elapsed:>9.3f} {rate:>9.1f} {speedup:>7.2f}x {failed:>7}")
+    finally:
+        httpmorph.cleanup()
+        if server:
+            server.stop()
+
+
+if __name__ == "__main__":
+    main()
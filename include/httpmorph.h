@@ -53,6 +53,8 @@ typedef enum {
     HTTPMORPH_ERROR_TIMEOUT = -5,
     HTTPMORPH_ERROR_PARSE = -6,
     HTTPMORPH_ERROR_PROTOCOL = -7,
+    HTTPMORPH_ERROR_ABORTED = -8,
+    HTTPMORPH_ERROR_TOO_MANY_REDIRECTS = -9,
 } httpmorph_error_t;
 
 /* HTTP methods */
@@ -91,6 +93,8 @@ typedef struct httpmorph_request httpmorph_request_t;
 typedef struct httpmorph_response httpmorph_response_t;
 typedef struct httpmorph_session httpmorph_session_t;
 typedef struct httpmorph_pool httpmorph_pool_t;
+typedef struct httpmorph_cache httpmorph_cache_t;
+typedef struct httpmorph_proxy_set httpmorph_proxy_set_t;
 
 /* Header structure - stores key-value pairs together for better cache locality */
 typedef struct {
@@ -98,6 +102,46 @@ typedef struct {
     char *value;
 } httpmorph_header_t;
 
+/* Default chunk size for streamed response bodies */
+#define HTTPMORPH_DEFAULT_BODY_CHUNK_SIZE 65536
+
+/* Default cap on an HTTP/1.x response head (status line and headers) */
+#define HTTPMORPH_DEFAULT_MAX_HEADER_SIZE (256 * 1024)
+
+/* Body callback return value: stop reading until resumed (async requests only) */
+#define HTTPMORPH_BODY_PAUSE 1
+
+/**
+ * Streaming response body callback
+ *
+ * Called once with data == NULL and len == 0 when the status line and
+ * headers have been parsed, then once per body chunk (at most the
+ * configured chunk size). Return 0 to continue or a negative value to
+ * abort the transfer (the response then carries HTTPMORPH_ERROR_ABORTED).
+ * Blocking in the callback applies backpressure to the connection.
+ */
+typedef int (*httpmorph_body_callback_t)(httpmorph_response_t *response,
+                                         const uint8_t *data, size_t len,
+                                         void *userdata);
+
+/* Body source length for a body of unknown size (sent chunked on HTTP/1.1) */
+#define HTTPMORPH_BODY_LENGTH_UNKNOWN (-1)
+
+/* Body source return value: no data yet, stop sending until resumed (async requests only) */
+#define HTTPMORPH_BODY_SOURCE_PAUSE (-2)
+
+/**
+ * Streaming request body source
+ *
+ * Fills buf with up to len bytes of the body and returns how many it
+ * wrote, 0 at the end of the body or -1 to abort the request. Async
+ * requests may also return HTTPMORPH_BODY_SOURCE_PAUSE and resume the
+ * request with async_manager_resume_request() once data is available.
+ * Called as the connection can take more data, so a slow source holds
+ * the upload back rather than buffering it.
+ */
+typedef int64_t (*httpmorph_body_source_t)(uint8_t *buf, size_t len, void *userdata);
+
 /* Request structure */
 struct httpmorph_request {
     httpmorph_method_t method;
@@ -114,9 +158,18 @@ struct httpmorph_request {
     /* Body */
     uint8_t *body;
     size_t body_len;
+    bool body_is_file;                /* Body is body_len bytes of body_fd from body_file_offset */
+    int body_fd;
+    uint64_t body_file_offset;
+    httpmorph_body_source_t body_source;  /* Body is pulled from this callback */
+    void *body_source_userdata;
+    bool body_chunked;                /* Source of unknown length */
 
     /* Configuration */
     uint32_t timeout_ms;
+    uint32_t connect_timeout_ms;      /* Per-phase limits for async requests (0 = none) */
+    uint32_t tls_timeout_ms;
+    uint32_t first_byte_timeout_ms;   /* Request sent -> first response byte */
     httpmorph_version_t http_version;
     httpmorph_browser_t browser_type;
     char *browser_version;
@@ -134,6 +187,7 @@ struct httpmorph_request {
     int32_t http2_stream_dependency;  /* Parent stream ID (0 = no dependency) */
     int32_t http2_priority_weight;    /* Priority weight: 1-256 (default: 16) */
     bool http2_priority_exclusive;    /* Exclusive dependency flag */
+    bool http2_adaptive_window;       /* Grow receive windows from BDP estimates */
 
     /* TLS fingerprinting */
     char *ja3_string;
@@ -143,8 +197,38 @@ struct httpmorph_request {
     bool verify_ssl;              /* Verify SSL certificates (default: true) */
     uint16_t min_tls_version;     /* Minimum TLS version (0 = default) */
     uint16_t max_tls_version;     /* Maximum TLS version (0 = default) */
+
+    /* Streaming response body (NULL = buffer the whole body) */
+    httpmorph_body_callback_t body_callback;
+    void *body_callback_userdata;
+    size_t body_chunk_size;
+
+    /* Largest HTTP/1.x response head accepted, in bytes */
+    size_t max_header_size;
+
+    /* Redirects (defaults from the client; never followed with a body callback) */
+    bool follow_redirects;
+    uint32_t max_redirects;
+
+    /* Zero round trip setup (defaults from the client; only where the profile allows it) */
+    bool early_data;              /* Send a safe request as TLS 1.3 early data */
+    bool tcp_fast_open;           /* Put the first flight in the SYN */
+
+    /* Let the kernel decrypt large HTTPS bodies (async engine, Linux) */
+    bool ktls;
+
+    /* Internal: Arena backing this request's strings (do not access directly) */
+    struct httpmorph_arena *_arena;
 };
 
+/* How a response relates to the HTTP cache */
+typedef enum {
+    HTTPMORPH_CACHE_NONE = 0,       /* No cache attached, or the request bypassed it */
+    HTTPMORPH_CACHE_MISS,           /* Fetched from the network (stored if cacheable) */
+    HTTPMORPH_CACHE_HIT,            /* Served from the cache without a request */
+    HTTPMORPH_CACHE_REVALIDATED,    /* Stored response confirmed by a 304 */
+} httpmorph_cache_status_t;
+
 /* Response structure */
 struct httpmorph_response {
     uint16_t status_code;
@@ -155,6 +239,14 @@ struct httpmorph_response {
     size_t header_count;
     size_t header_capacity;  /* Pre-allocated header capacity */
 
+    /* Internal: Header storage and name index (do not access directly) */
+    char *_header_arena;                      /* Values and non-interned names */
+    size_t _header_arena_len;
+    size_t _header_arena_cap;
+    struct httpmorph_header_link *_header_links;  /* Per header: name hash, same-name chain */
+    uint32_t *_header_index;                  /* Open addressing: header + 1, 0 = empty */
+    size_t _header_index_cap;
+
     /* Body */
     uint8_t *body;
     size_t body_len;
@@ -163,17 +255,38 @@ struct httpmorph_response {
     /* Internal: Buffer pool tracking (do not access directly) */
     void *_buffer_pool;  /* httpmorph_buffer_pool_t* */
     size_t _body_actual_size;  /* Actual allocated size (for pool return) */
+    struct httpmorph_arena *_arena;  /* Shared with the request it answers, if any */
+    void *_body_owner;                 /* Holder of a shared body (NULL = body is ours) */
+    void (*_body_release)(void *owner);
 
     /* Timing */
+    uint64_t queue_time_us;       /* Waiting to be started (async scheduler queue) */
+    uint64_t dns_time_us;         /* Name resolution (part of connect_time_us) */
     uint64_t connect_time_us;
     uint64_t tls_time_us;
     uint64_t first_byte_time_us;
     uint64_t total_time_us;
+    uint64_t http2_rtt_us;        /* HTTP/2 PING round trip (adaptive windows only) */
+    uint32_t http2_window_size;   /* HTTP/2 receive window in effect (adaptive windows only) */
+
+    /* Connection */
+    bool connection_reused;       /* Taken from the pool (no connect or handshake) */
+    bool tls_resumed;             /* New TLS connection that resumed a cached session */
+    size_t body_wire_len;         /* Body bytes as received, before Content-Encoding decoding */
 
-    /* TLS info */
+    /* TLS info (library-owned strings, valid for the life of the process) */
     char *tls_version;
     char *tls_cipher;
-    char *ja3_fingerprint;
+    char *ja3_fingerprint;        /* NULL when the client disables fingerprinting */
+
+    /* HTTP cache */
+    httpmorph_cache_status_t cache_status;
+    uint64_t cache_entry_id;      /* Stored response served (0 = none); new after each update */
+
+    /* Redirects followed to get here (oldest hop at the end of the chain) */
+    char *url;                    /* Final URL (NULL: no redirect was followed) */
+    uint32_t redirect_count;
+    struct httpmorph_response *redirect_from;  /* Response that redirected here (owned) */
 
     /* Error */
     httpmorph_error_t error;
@@ -198,6 +311,120 @@ void httpmorph_cleanup(void);
  */
 const char* httpmorph_version(void);
 
+/**
+ * Send DNS queries straight to the given name servers
+ * Lookups run on resolver threads either way; this only replaces the
+ * system resolver (and hosts file) for names that aren't IP literals.
+ *
+ * @param servers Comma-separated "ip", "ip:port" or "[ipv6]:port" list
+ *                (at most 4); NULL or "" restores the system resolver
+ * @param timeout_ms Per-server query timeout (0 for the 2s default)
+ * @return 0 on success, -1 if a server address is invalid
+ */
+int httpmorph_set_dns_servers(const char *servers, uint32_t timeout_ms);
+
+/**
+ * DNS cache statistics (process-wide)
+ */
+typedef struct {
+    uint64_t hits;          /* Lookups answered with cached addresses */
+    uint64_t misses;        /* Lookups that had to resolve */
+    uint64_t negative_hits; /* Lookups answered with a cached NXDOMAIN */
+    uint64_t insertions;    /* Results stored (positive and negative) */
+    uint64_t evictions;     /* Entries evicted by the LRU */
+    uint64_t expirations;   /* Entries dropped after their TTL */
+    size_t entries;         /* Entries currently cached */
+} httpmorph_dns_cache_stats_t;
+
+/**
+ * Get DNS cache statistics
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_dns_get_cache_stats(httpmorph_dns_cache_stats_t *stats);
+
+/**
+ * Share DNS results and TLS sessions with other processes through a file
+ * Every process opening the same file (a path on tmpfs such as /dev/shm
+ * keeps it in memory) sees the others' lookups and sessions, on top of its
+ * own caches; the file outlives the processes, so restarted workers start
+ * warm. Open it before forking and children share it too. The table sizes
+ * are fixed when the file is created: a process asking for different
+ * sizes fails, and the file must be removed to resize. A file whose
+ * creator died while laying it out is taken over after a few seconds.
+ *
+ * @param path File to map (created if missing)
+ * @param dns_entries DNS slots (0 for 1024)
+ * @param tls_entries TLS session slots (0 for 1024)
+ * @return 0 on success, -1 on error or if a shared cache is already open
+ */
+int httpmorph_shared_cache_open(const char *path, size_t dns_entries, size_t tls_entries);
+
+/**
+ * Shared cache statistics (summed over every process using the file)
+ */
+typedef struct {
+    uint64_t dns_hits;      /* Lookups answered by the shared cache */
+    uint64_t dns_misses;
+    uint64_t dns_stores;
+    uint64_t tls_hits;      /* Sessions handed out */
+    uint64_t tls_misses;
+    uint64_t tls_stores;
+    uint64_t busy;          /* Stores skipped: another process was writing the slot */
+    size_t dns_entries;     /* Slots */
+    size_t tls_entries;
+} httpmorph_shared_cache_stats_t;
+
+/**
+ * Get shared cache statistics
+ * @return 0 on success, -1 if no shared cache is open
+ */
+int httpmorph_shared_cache_get_stats(httpmorph_shared_cache_stats_t *stats);
+
+/* Tracing */
+
+/**
+ * A finished span, laid out like an OpenTelemetry span
+ * Each request gets a root span named after its method ("GET") and one
+ * child per phase it went through: "queue", "dns", "connect", "tls",
+ * "wait" (request sent until the first response byte) and "body". The
+ * request attributes are set on the root span only.
+ */
+typedef struct {
+    uint8_t trace_id[16];
+    uint8_t span_id[8];
+    uint8_t parent_span_id[8];  /* All zero for the root span */
+    const char *name;
+    uint64_t start_unix_ns;
+    uint64_t end_unix_ns;
+    uint64_t request_id;        /* Same id the USDT probes carry */
+
+    /* Root span attributes */
+    const char *method;
+    const char *url;
+    int status_code;            /* 0 if the request failed */
+    int error;                  /* httpmorph_error_t */
+    httpmorph_version_t http_version;
+    bool connection_reused;
+    bool tls_resumed;
+    size_t body_len;
+} httpmorph_span_t;
+
+/**
+ * Span callback
+ * Called on the thread that finished the request; span and its strings
+ * are only valid during the call.
+ */
+typedef void (*httpmorph_span_callback_t)(const httpmorph_span_t *span, void *user_data);
+
+/**
+ * Emit spans for every request to a callback (process-wide)
+ * With no callback set tracing costs one atomic load per request.
+ *
+ * @param callback Span callback, or NULL to stop tracing
+ * @param user_data Passed to each call
+ */
+void httpmorph_set_tracer(httpmorph_span_callback_t callback, void *user_data);
+
 /* Client API */
 
 /**
@@ -218,6 +445,380 @@ int httpmorph_client_load_ca_file(httpmorph_client_t *client, const char *ca_fil
  */
 httpmorph_pool_t* httpmorph_client_get_pool(httpmorph_client_t *client);
 
+/**
+ * TLS session resumption statistics
+ */
+typedef struct {
+    uint64_t hits;          /* Handshakes that offered a cached session */
+    uint64_t misses;        /* Handshakes with no cached session */
+    uint64_t stores;        /* Sessions/tickets received from servers */
+    uint64_t evictions;     /* Origins evicted by the LRU */
+    uint64_t expirations;   /* Sessions dropped after their lifetime */
+    uint64_t resumptions;   /* Handshakes the server resumed */
+    size_t entries;         /* Origins currently cached */
+} httpmorph_tls_session_stats_t;
+
+/**
+ * Get TLS session resumption statistics for a client
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_client_get_tls_session_stats(httpmorph_client_t *client,
+                                           httpmorph_tls_session_stats_t *stats);
+
+/**
+ * Drop all cached TLS sessions for a client
+ */
+void httpmorph_client_clear_tls_sessions(httpmorph_client_t *client);
+
+/**
+ * Find an alternative service an origin advertised (Alt-Svc, RFC 7838)
+ *
+ * The client remembers the Alt-Svc headers of HTTPS responses until their
+ * max-age passes. HTTP/3 is advertised as protocol "h3"; this library
+ * doesn't speak it itself, so the lookup is for callers that do.
+ *
+ * @param url Any URL on the origin
+ * @param protocol ALPN protocol ID (e.g. "h3")
+ * @param host Output: alternative host, empty for the origin's own (may be NULL)
+ * @param host_size Size of host
+ * @param port Output: alternative port (may be NULL)
+ * @return 0 if one is known, -1 otherwise
+ */
+int httpmorph_client_get_alt_svc(httpmorph_client_t *client, const char *url,
+                                 const char *protocol, char *host, size_t host_size,
+                                 uint16_t *port);
+
+/**
+ * Report that an origin's alternative service didn't work
+ * It isn't offered again for 5 minutes, doubling with every failure up to 48 hours.
+ */
+void httpmorph_client_mark_alt_svc_broken(httpmorph_client_t *client, const char *url);
+
+/**
+ * Forget all alternative services a client has seen advertised
+ */
+void httpmorph_client_clear_alt_svc(httpmorph_client_t *client);
+
+/* Maximum number of response buffer pool tiers */
+#define HTTPMORPH_MAX_BUFFER_TIERS 8
+
+/**
+ * Response buffer pool configuration
+ */
+typedef struct {
+    size_t tier_sizes[HTTPMORPH_MAX_BUFFER_TIERS];  /* Strictly ascending buffer sizes */
+    int tier_capacity[HTTPMORPH_MAX_BUFFER_TIERS];  /* Shared buffers kept per tier */
+    int num_tiers;
+    int magazine_size;      /* Per-thread buffers per tier (0 disables) */
+    size_t mmap_threshold;  /* Tiers this size or larger are mmap-backed (0 = never) */
+} httpmorph_buffer_pool_config_t;
+
+/**
+ * Response buffer pool statistics for one tier
+ */
+typedef struct {
+    size_t buffer_size;
+    bool mmap_backed;
+    uint64_t hits;          /* Buffers reused */
+    uint64_t magazine_hits; /* Reused from the calling thread's cache */
+    uint64_t misses;        /* Buffers newly allocated */
+    uint64_t returns;       /* Buffers kept for reuse */
+    size_t pooled;          /* Buffers in the shared depot */
+} httpmorph_buffer_tier_stats_t;
+
+/**
+ * Replace a client's response buffer pool
+ * Must be called before the client performs its first request.
+ * @return 0 on success, -1 on invalid config or if the pool is in use
+ */
+int httpmorph_client_configure_buffer_pool(httpmorph_client_t *client,
+                                           const httpmorph_buffer_pool_config_t *config);
+
+/**
+ * Get response buffer pool statistics per tier
+ * @return Number of tiers (may exceed max_tiers), -1 on failure
+ */
+int httpmorph_client_get_buffer_pool_stats(httpmorph_client_t *client,
+                                           httpmorph_buffer_tier_stats_t *stats,
+                                           int max_tiers);
+
+/**
+ * Request arena statistics
+ */
+typedef struct {
+    uint64_t reused;        /* Requests that got a recycled arena */
+    uint64_t created;       /* Requests that allocated a new arena */
+    size_t cached;          /* Reset arenas waiting for reuse */
+} httpmorph_arena_stats_t;
+
+/**
+ * Back requests made with httpmorph_request_create_for_client() (and their
+ * responses) with per-request arenas, recycled through a per-client freelist
+ * Must be called before the client is used from several threads.
+ * @param max_cached Reset arenas to keep (0 disables arenas)
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_client_enable_request_arenas(httpmorph_client_t *client, size_t max_cached);
+
+/**
+ * Get request arena statistics
+ * @return 0 on success, -1 if arenas are disabled
+ */
+int httpmorph_client_get_arena_stats(httpmorph_client_t *client,
+                                     httpmorph_arena_stats_t *stats);
+
+/* Longest origin ("scheme://host:port") reported by origin metrics */
+#define HTTPMORPH_MAX_ORIGIN_LEN 288
+
+/* Origins with metrics of their own (the first ones seen) */
+#define HTTPMORPH_MAX_METRICS_ORIGINS 64
+
+/**
+ * Client-wide request metrics
+ * Counters run from client creation or the last reset; pool figures are
+ * current.
+ */
+typedef struct {
+    uint64_t requests;            /* Requests answered or failed (each redirect hop counts) */
+    uint64_t errors;              /* Requests that failed */
+    uint64_t connections_opened;  /* Requests that connected */
+    uint64_t connections_reused;  /* Requests sent on a pooled connection */
+    uint64_t tls_handshakes;      /* TLS handshakes, full or resumed */
+    uint64_t tls_resumed;         /* Handshakes that resumed a session */
+    uint64_t http2_streams;       /* Requests sent as HTTP/2 streams */
+    uint64_t body_wire_bytes;     /* Body bytes received */
+    uint64_t body_bytes;          /* Body bytes after Content-Encoding decoding */
+    int pool_idle;                /* Connections waiting in the pool */
+    int pool_active;              /* Pooled connections in use */
+    uint64_t memory_limit;        /* Async managers: response buffer budget (0 = unlimited) */
+    uint64_t memory_in_use;       /* Response buffer bytes held now */
+    uint64_t memory_peak;         /* Most held at once */
+    uint64_t memory_stalls;       /* Times a request paused its reads for budget */
+} httpmorph_metrics_t;
+
+/**
+ * Request metrics for one origin
+ * Percentiles come from a log-linear histogram of total times and are
+ * within 3% of the exact value; phase times are sums, so divide by
+ * requests for a mean.
+ */
+typedef struct {
+    char origin[HTTPMORPH_MAX_ORIGIN_LEN];
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t p50_us;
+    uint64_t p90_us;
+    uint64_t p99_us;
+    uint64_t p999_us;
+    uint64_t max_us;
+    uint64_t total_us;            /* Sum of total times */
+    uint64_t queue_us;            /* Sums of the phase times */
+    uint64_t dns_us;
+    uint64_t connect_us;
+    uint64_t tls_us;
+    uint64_t first_byte_us;
+} httpmorph_origin_metrics_t;
+
+/**
+ * Get client-wide request metrics
+ * Recording is a handful of atomic increments per request and always on.
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_client_get_metrics(httpmorph_client_t *client, httpmorph_metrics_t *metrics);
+
+/**
+ * Get request metrics per origin, in the order origins were first seen
+ * Origins after the first HTTPMORPH_MAX_METRICS_ORIGINS count in the
+ * client-wide metrics only.
+ * @return Number of origins (may exceed max_origins), -1 on failure
+ */
+int httpmorph_client_get_origin_metrics(httpmorph_client_t *client,
+                                        httpmorph_origin_metrics_t *origins,
+                                        int max_origins);
+
+/**
+ * Zero a client's request metrics (origins stay tracked)
+ */
+void httpmorph_client_reset_metrics(httpmorph_client_t *client);
+
+/**
+ * Compute the JA3 fingerprint of new TLS connections (on by default)
+ * Responses report ja3_fingerprint as NULL while disabled.
+ */
+void httpmorph_client_set_tls_fingerprint(httpmorph_client_t *client, bool enabled);
+
+/**
+ * Follow redirects for the client's new requests (off by default)
+ * Same-origin hops reuse the pooled connection; 301, 302 and 303 turn a
+ * POST into a GET without a body, 307 and 308 repeat the request as is.
+ *
+ * @param follow Follow 301, 302, 303, 307 and 308 responses
+ * @param max_redirects Hops before failing with HTTPMORPH_ERROR_TOO_MANY_REDIRECTS
+ */
+void httpmorph_client_set_redirects(httpmorph_client_t *client, bool follow,
+                                    uint32_t max_redirects);
+
+/**
+ * Save round trips to origins seen before (both off by default)
+ * See httpmorph_request_set_zero_rtt() for when each one applies.
+ *
+ * @param early_data Send safe requests as TLS 1.3 early data
+ * @param tcp_fast_open Use TCP Fast Open for direct connections
+ */
+void httpmorph_client_set_zero_rtt(httpmorph_client_t *client, bool early_data,
+                                   bool tcp_fast_open);
+
+/* Most requests pipelined on one connection */
+#define HTTPMORPH_MAX_PIPELINE_DEPTH 16
+
+/**
+ * Allow HTTP/1.1 pipelining to an origin (no origin is by default)
+ *
+ * Batches (httpmorph_batch_start()) then send consecutive GET, HEAD and
+ * OPTIONS requests without a body to the origin back to back on one
+ * pooled HTTP/1.1 connection, and read the responses in order. After an
+ * error or a response that closes the connection, the rest of those
+ * requests run one at a time. Only allow origins known to answer
+ * pipelined requests correctly; set this up before requests run.
+ *
+ * @param url Any URL on the origin
+ * @param depth Requests sent at once (0 disallows the origin again;
+ *              capped at HTTPMORPH_MAX_PIPELINE_DEPTH)
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_client_allow_pipelining(httpmorph_client_t *client, const char *url,
+                                      uint32_t depth);
+
+/**
+ * HTTP cache configuration (0 / NULL fields take the defaults)
+ */
+typedef struct {
+    size_t max_memory;        /* Headers and in-memory bodies (default 64 MiB) */
+    const char *spill_dir;    /* Directory for memory-mapped bodies (NULL = memory only) */
+    size_t spill_threshold;   /* Bodies this size or larger are spilled (default 64 KiB) */
+    size_t max_disk;          /* Spilled bodies (default 1 GiB) */
+} httpmorph_cache_config_t;
+
+/**
+ * HTTP cache statistics
+ */
+typedef struct {
+    uint64_t hits;            /* Requests answered without the network */
+    uint64_t misses;          /* Requests with nothing usable stored */
+    uint64_t revalidations;   /* Stale responses confirmed by a 304 */
+    uint64_t stores;          /* Responses stored */
+    uint64_t evictions;       /* Entries evicted by the LRU */
+    uint64_t invalidations;   /* Entries dropped after unsafe requests */
+    size_t entries;           /* Responses currently stored */
+    size_t memory_bytes;      /* Charged against max_memory */
+    size_t disk_bytes;        /* Charged against max_disk */
+} httpmorph_cache_stats_t;
+
+/**
+ * Create an HTTP response cache (RFC 9111, private)
+ * One cache can be shared by any number of clients and sessions.
+ * @param config Configuration (NULL for defaults)
+ * @return Cache, or NULL on failure
+ */
+httpmorph_cache_t* httpmorph_cache_create(const httpmorph_cache_config_t *config);
+
+/**
+ * Release the caller's reference to a cache
+ * Clients and sessions it is attached to keep it alive.
+ */
+void httpmorph_cache_destroy(httpmorph_cache_t *cache);
+
+/**
+ * Drop every stored response
+ */
+void httpmorph_cache_clear(httpmorph_cache_t *cache);
+
+/**
+ * Get HTTP cache statistics
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_cache_get_stats(httpmorph_cache_t *cache, httpmorph_cache_stats_t *stats);
+
+/**
+ * Answer a client's GET requests from a cache when possible
+ * Must not be called while the client has requests in flight.
+ * @param cache Cache to use (NULL detaches the current one)
+ */
+void httpmorph_client_set_cache(httpmorph_client_t *client, httpmorph_cache_t *cache);
+
+/**
+ * Proxy set configuration (0 fields take the defaults)
+ */
+typedef struct {
+    uint32_t eject_failures;  /* Consecutive failures that eject a proxy (default 3) */
+    uint32_t eject_ms;        /* First ejection (default 30 s); doubles on each repeat, up to 32x */
+    bool sticky_hosts;        /* Keep each host on one proxy while that proxy is healthy */
+} httpmorph_proxy_set_config_t;
+
+/**
+ * Health of one proxy in a set
+ */
+typedef struct {
+    uint64_t requests;        /* Requests routed through it */
+    uint64_t failures;        /* Requests that failed at or before the proxy */
+    uint64_t ejections;       /* Times it was taken out of rotation */
+    double latency_us;        /* EWMA of connect + TLS time on new connections (0 = unmeasured) */
+    double error_rate;        /* EWMA of failures, 0..1 */
+    bool ejected;             /* Currently out of rotation */
+    uint32_t ejected_ms_left; /* Until it is back */
+} httpmorph_proxy_stats_t;
+
+/**
+ * Create a proxy set
+ * Requests without their own proxy pick one, weighted towards low latency
+ * and error rate; failing proxies are ejected for a while. One set can be
+ * shared by any number of clients and sessions.
+ * @param config Configuration (NULL for defaults)
+ * @return Proxy set, or NULL on failure
+ */
+httpmorph_proxy_set_t* httpmorph_proxy_set_create(const httpmorph_proxy_set_config_t *config);
+
+/**
+ * Release the caller's reference to a proxy set
+ * Clients and sessions it is attached to keep it alive.
+ */
+void httpmorph_proxy_set_destroy(httpmorph_proxy_set_t *set);
+
+/**
+ * Add a proxy (an existing one keeps its health and takes the new credentials)
+ * @param proxy_url Proxy URL (http://, https://, socks5:// or socks5h://)
+ * @param username Proxy username (NULL for none or the URL's own)
+ * @param password Proxy password (NULL for none or the URL's own)
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_proxy_set_add(httpmorph_proxy_set_t *set, const char *proxy_url,
+                            const char *username, const char *password);
+
+/**
+ * Remove a proxy (requests already using it finish normally)
+ * @return 0 on success, -1 if it is not in the set
+ */
+int httpmorph_proxy_set_remove(httpmorph_proxy_set_t *set, const char *proxy_url);
+
+/**
+ * Get the number of proxies in a set
+ */
+size_t httpmorph_proxy_set_count(httpmorph_proxy_set_t *set);
+
+/**
+ * Get the health of one proxy
+ * @return 0 on success, -1 if it is not in the set
+ */
+int httpmorph_proxy_set_get_stats(httpmorph_proxy_set_t *set, const char *proxy_url,
+                                  httpmorph_proxy_stats_t *stats);
+
+/**
+ * Route a client's requests that have no proxy of their own through a set
+ * Must not be called while the client has requests in flight.
+ * @param set Proxy set to use (NULL detaches the current one)
+ */
+void httpmorph_client_set_proxy_set(httpmorph_client_t *client, httpmorph_proxy_set_t *set);
+
 /**
  * Destroy an HTTP client
  */
@@ -243,6 +844,19 @@ httpmorph_request_t* httpmorph_request_create(
     const char *url
 );
 
+/**
+ * Create a new request for a client
+ * Uses one of the client's arenas when they are enabled, so the request's
+ * strings, headers and body (and its response's headers and TLS info)
+ * are released together; otherwise the same as httpmorph_request_create().
+ * An arena-backed request must not be executed on several threads at once.
+ */
+httpmorph_request_t* httpmorph_request_create_for_client(
+    httpmorph_client_t *client,
+    httpmorph_method_t method,
+    const char *url
+);
+
 /**
  * Destroy a request
  */
@@ -266,6 +880,45 @@ int httpmorph_request_set_body(
     size_t body_len
 );
 
+/**
+ * Send part of a file as the request body (not copied into memory)
+ * Plain HTTP/1.1 bodies go out with sendfile(); the descriptor stays owned
+ * by the caller and must remain open until the request has been executed.
+ * @param fd Open, readable file descriptor
+ * @param offset Byte offset of the body in the file
+ * @param length Body length in bytes
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_request_set_body_file(
+    httpmorph_request_t *request,
+    int fd,
+    uint64_t offset,
+    size_t length
+);
+
+/**
+ * Stream the request body from a callback instead of holding it in memory
+ * A known length is sent as Content-Length; HTTPMORPH_BODY_LENGTH_UNKNOWN
+ * sends the body chunked on HTTP/1.1 and as DATA frames until the source
+ * ends on HTTP/2. A streamed body is read once, so the request is not
+ * retried on another connection after a failure.
+ * @param source Body source (userdata stays owned by the caller)
+ * @param length Body length in bytes, or HTTPMORPH_BODY_LENGTH_UNKNOWN
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_request_set_body_source(
+    httpmorph_request_t *request,
+    httpmorph_body_source_t source,
+    void *userdata,
+    int64_t length
+);
+
+/**
+ * Body source reading a file descriptor (pipe, socket or file) until EOF
+ * Pass the descriptor as userdata: (void *)(intptr_t)fd.
+ */
+int64_t httpmorph_body_source_fd(uint8_t *buf, size_t len, void *userdata);
+
 /**
  * Set request timeout in milliseconds
  */
@@ -274,6 +927,17 @@ void httpmorph_request_set_timeout(
     uint32_t timeout_ms
 );
 
+/**
+ * Set per-phase timeouts in milliseconds (0 disables a phase's limit)
+ * Enforced by the async engine on top of the total timeout.
+ */
+void httpmorph_request_set_phase_timeouts(
+    httpmorph_request_t *request,
+    uint32_t connect_timeout_ms,
+    uint32_t tls_timeout_ms,
+    uint32_t first_byte_timeout_ms
+);
+
 /**
  * Set proxy for request
  */
@@ -292,6 +956,23 @@ void httpmorph_request_set_http2(
     bool enabled
 );
 
+/**
+ * Enable adaptive HTTP/2 flow-control windows for request
+ *
+ * The initial SETTINGS frame stays exactly as the browser profile sends
+ * it. While the response downloads, PING round trips estimate the
+ * bandwidth-delay product, and the connection and stream windows are
+ * raised with WINDOW_UPDATE whenever the transfer is window-limited.
+ * The estimate is reported in http2_rtt_us and http2_window_size.
+ *
+ * @param request Request to configure
+ * @param enabled Whether to adapt the windows (default: false)
+ */
+void httpmorph_request_set_http2_adaptive_window(
+    httpmorph_request_t *request,
+    bool enabled
+);
+
 /**
  * Set HTTP/2 priority for request (RFC 7540 Section 5.3)
  *
@@ -342,6 +1023,108 @@ void httpmorph_request_set_tls_version(
     uint16_t max_version
 );
 
+/**
+ * Stream the response body to a callback instead of buffering it
+ *
+ * The response's body stays empty. Chunks are delivered decoded according
+ * to Content-Encoding (async requests pass them through as received).
+ *
+ * @param request Request to configure
+ * @param callback Body callback (NULL to buffer the body again)
+ * @param userdata Passed through to the callback
+ * @param chunk_size Maximum bytes per callback (0 for default)
+ */
+void httpmorph_request_set_body_callback(
+    httpmorph_request_t *request,
+    httpmorph_body_callback_t callback,
+    void *userdata,
+    size_t chunk_size
+);
+
+/**
+ * Set the largest HTTP/1.x response head to accept
+ *
+ * The head buffer starts small and grows as needed up to this size;
+ * responses with a larger head fail with HTTPMORPH_ERROR_PARSE.
+ *
+ * @param request Request to configure
+ * @param max_size Cap in bytes (0 for default)
+ */
+void httpmorph_request_set_max_header_size(
+    httpmorph_request_t *request,
+    size_t max_size
+);
+
+/**
+ * Follow redirects for one request (overrides the client's setting)
+ *
+ * The final response carries the URL it came from and, through
+ * redirect_from, the responses of the earlier hops. A request whose body
+ * comes from a source can't be sent twice, so a 307 or 308 for it is
+ * returned as is.
+ *
+ * @param request Request to configure
+ * @param follow Follow 301, 302, 303, 307 and 308 responses
+ * @param max_redirects Hops before failing with HTTPMORPH_ERROR_TOO_MANY_REDIRECTS
+ */
+void httpmorph_request_set_redirects(
+    httpmorph_request_t *request,
+    bool follow,
+    uint32_t max_redirects
+);
+
+/**
+ * Save round trips to origins seen before (overrides the client's setting)
+ *
+ * Early data sends a GET, HEAD or OPTIONS without a body together with
+ * the ClientHello of a resumed TLS 1.3 session, on the async engine. If
+ * the server turns it down the request is sent again once the handshake
+ * completes. TCP Fast Open carries the first flight in the SYN of a
+ * direct connection once the kernel holds a cookie for the server
+ * (Linux); for plain HTTP only safe requests without a body use it.
+ * Both are skipped when the client's browser profile doesn't do the same.
+ *
+ * @param request Request to configure
+ * @param early_data Send the request as TLS 1.3 early data
+ * @param tcp_fast_open Use TCP Fast Open
+ */
+void httpmorph_request_set_zero_rtt(
+    httpmorph_request_t *request,
+    bool early_data,
+    bool tcp_fast_open
+);
+
+/**
+ * Rotate the TLS fingerprint per connection (off by default)
+ *
+ * Each new HTTPS connection picks one of BROWSER_PROFILE_VARIANTS variants
+ * of the client's browser profile: the profile itself or a copy with its
+ * GREASE values and some cipher and extension order changed, generated
+ * once per process. Every variant keeps its own SSL context and its own
+ * pooled connections, so rotating costs neither a context setup nor a
+ * reused connection with the wrong fingerprint. Variant connections are
+ * not coalesced across origins or pipelined. Synchronous requests only.
+ *
+ * @param request Request to configure
+ * @param rotate Pick a fingerprint variant per connection
+ */
+void httpmorph_request_set_rotate_fingerprint(httpmorph_request_t *request, bool rotate);
+
+/**
+ * Offload decryption of a large HTTPS body to the kernel (off by default)
+ *
+ * On Linux with kernel TLS, once the head of a response is read and at
+ * least KTLS_MIN_BODY (128 KB) of body is still to come, or the body is
+ * chunked, the async engine hands the server's keys to the kernel and
+ * reads the rest with plain recv(). Suites other than AES-GCM and
+ * ChaCha20-Poly1305, or a kernel without TLS support, keep SSL_read().
+ * The connection is closed afterwards rather than reused.
+ *
+ * @param request Request to configure
+ * @param enabled Offload when it applies
+ */
+void httpmorph_request_set_ktls(httpmorph_request_t *request, bool enabled);
+
 /* Response helpers */
 
 /**
@@ -350,13 +1133,42 @@ void httpmorph_request_set_tls_version(
 void httpmorph_response_destroy(httpmorph_response_t *response);
 
 /**
- * Get response header value
+ * Move a response's body into a response of its own
+ * The new response carries only body and body_len and frees the buffer
+ * the way the original would have; the original is left without a body.
+ * Lets a binding hand the body out without copying it and still release
+ * the response (and the request holding it) right away.
+ *
+ * @param response Response to take the body from
+ * @return Body-only response (free with httpmorph_response_destroy()),
+ *         NULL if there is no body or on allocation failure
+ */
+httpmorph_response_t* httpmorph_response_detach_body(httpmorph_response_t *response);
+
+/**
+ * Get response header value (first one if the header repeats)
  */
 const char* httpmorph_response_get_header(
     const httpmorph_response_t *response,
     const char *key
 );
 
+/**
+ * Get every value of a repeated response header (e.g. Set-Cookie)
+ *
+ * @param response Response
+ * @param key Header name (case-insensitive)
+ * @param values Output: values in arrival order (may be NULL to count only)
+ * @param max Entries in values
+ * @return Number of values the header has (may exceed max)
+ */
+size_t httpmorph_response_get_header_values(
+    const httpmorph_response_t *response,
+    const char *key,
+    const char **values,
+    size_t max
+);
+
 /* Session API (for persistent connections and fingerprints) */
 
 /**
@@ -384,6 +1196,171 @@ httpmorph_response_t* httpmorph_session_request(
  */
 size_t httpmorph_session_cookie_count(httpmorph_session_t *session);
 
+/**
+ * Get TLS session resumption statistics for session
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_session_get_tls_session_stats(httpmorph_session_t *session,
+                                            httpmorph_tls_session_stats_t *stats);
+
+/**
+ * Get request metrics for a session, with its connection pool's occupancy
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_session_get_metrics(httpmorph_session_t *session, httpmorph_metrics_t *metrics);
+
+/**
+ * Get a session's request metrics per origin
+ * @return Number of origins (may exceed max_origins), -1 on failure
+ */
+int httpmorph_session_get_origin_metrics(httpmorph_session_t *session,
+                                         httpmorph_origin_metrics_t *origins,
+                                         int max_origins);
+
+/**
+ * Zero a session's request metrics
+ */
+void httpmorph_session_reset_metrics(httpmorph_session_t *session);
+
+/**
+ * Find an alternative service an origin advertised to a session
+ * (see httpmorph_client_get_alt_svc())
+ */
+int httpmorph_session_get_alt_svc(httpmorph_session_t *session, const char *url,
+                                  const char *protocol, char *host, size_t host_size,
+                                  uint16_t *port);
+
+/**
+ * Answer a session's GET requests from a cache when possible
+ * @param cache Cache to use (NULL detaches the current one)
+ */
+void httpmorph_session_set_cache(httpmorph_session_t *session, httpmorph_cache_t *cache);
+
+/**
+ * Route a session's requests that have no proxy of their own through a set
+ * @param set Proxy set to use (NULL detaches the current one)
+ */
+void httpmorph_session_set_proxy_set(httpmorph_session_t *session, httpmorph_proxy_set_t *set);
+
+/**
+ * Start a background thread that reaps idle/peer-closed pooled connections
+ * and refills hosts registered with httpmorph_session_set_min_idle()
+ * Stopped automatically when the session is destroyed
+ * @param interval_ms Maintenance period (0 for default of 1000ms)
+ * @return 0 on success, -1 on failure (or if already running)
+ */
+int httpmorph_session_start_pool_maintenance(httpmorph_session_t *session, uint32_t interval_ms);
+
+/**
+ * Keep at least min_idle idle connections open to host:port
+ * Requires pool maintenance to be running; 0 removes the target
+ * @return 0 on success, -1 on failure
+ */
+int httpmorph_session_set_min_idle(httpmorph_session_t *session, const char *host,
+                                   uint16_t port, bool use_tls, int min_idle);
+
+/* Batch API (many requests from one call) */
+
+/* Requests in flight when httpmorph_batch_start() is given 0 */
+#define HTTPMORPH_BATCH_DEFAULT_CONCURRENCY 8
+
+/* httpmorph_batch_next() results other than a request index */
+#define HTTPMORPH_BATCH_DONE (-1)       /* Every response has been taken */
+#define HTTPMORPH_BATCH_TIMEOUT (-2)    /* Nothing finished within the timeout */
+
+typedef struct httpmorph_batch httpmorph_batch_t;
+
+/**
+ * Start running a batch of requests on background threads
+ *
+ * Requests share the pool's keep-alive connections; HTTPS requests to one
+ * origin are multiplexed over a single HTTP/2 connection when negotiated.
+ * The requests must stay alive until httpmorph_batch_destroy().
+ *
+ * @param client HTTP client
+ * @param pool Connection pool (NULL for no reuse)
+ * @param requests Requests to run
+ * @param count Number of requests
+ * @param concurrency Maximum requests in flight (0 for default)
+ * @return Batch, or NULL on failure
+ */
+httpmorph_batch_t* httpmorph_batch_start(
+    httpmorph_client_t *client,
+    httpmorph_pool_t *pool,
+    httpmorph_request_t *const *requests,
+    size_t count,
+    int concurrency
+);
+
+/**
+ * Take the next finished response, in completion order
+ *
+ * @param batch Batch
+ * @param timeout_ms Wait limit (0 waits until one finishes)
+ * @param response Output: the response (owned by the caller)
+ * @return Index of the finished request, HTTPMORPH_BATCH_DONE or HTTPMORPH_BATCH_TIMEOUT
+ */
+int httpmorph_batch_next(
+    httpmorph_batch_t *batch,
+    uint32_t timeout_ms,
+    httpmorph_response_t **response
+);
+
+/**
+ * Destroy a batch
+ *
+ * Requests already running are finished, the rest are skipped; responses
+ * not taken with httpmorph_batch_next() are freed.
+ */
+void httpmorph_batch_destroy(httpmorph_batch_t *batch);
+
+/* Preconnect API (open connections ahead of requests) */
+
+/* Connections opened at once by httpmorph_session_preconnect() */
+#define HTTPMORPH_PRECONNECT_MAX_THREADS 16
+
+/**
+ * Outcome of preconnecting to one origin
+ * Timings are those of the first connection opened.
+ */
+typedef struct {
+    httpmorph_error_t error;    /* HTTPMORPH_OK if at least one connection was opened */
+    int connections;            /* Connections opened and pooled */
+    bool http2;                 /* HTTP/2 negotiated (its session is already open) */
+    bool tls_resumed;           /* A handshake resumed a cached TLS session */
+    uint64_t dns_time_us;
+    uint64_t connect_time_us;   /* Includes DNS */
+    uint64_t tls_time_us;
+    uint64_t total_time_us;     /* Until the origin's last connection was pooled */
+} httpmorph_preconnect_result_t;
+
+/**
+ * Open connections to origins before any request needs them
+ *
+ * Every origin is resolved, connected and (for https) handshaken at once
+ * on background threads, exactly as a request would be - same fingerprint,
+ * same TLS session cache, whose tickets are read in - and the connections
+ * go into the session's pool. When HTTP/2 may be negotiated, an origin's
+ * extra connections wait for its first: if that one gets HTTP/2, its
+ * session is opened and it serves every request, so no more are opened.
+ * Connections are direct (requests through a proxy don't use them).
+ *
+ * @param session Session whose pool receives the connections
+ * @param urls Origins ("https://host[:port]"; any path is ignored)
+ * @param count Number of URLs
+ * @param per_host Connections per origin (at least 1)
+ * @param http2 Offer HTTP/2 in ALPN (as requests do by default)
+ * @param verify_ssl Verify certificates (as the requests will)
+ * @param timeout_ms Connect timeout per connection (0 for the client's)
+ * @param results Output: an outcome per URL, in order
+ * @return Number of origins with at least one connection, -1 on invalid arguments
+ */
+int httpmorph_session_preconnect(httpmorph_session_t *session,
+                                 const char *const *urls, size_t count,
+                                 int per_host, bool http2, bool verify_ssl,
+                                 uint32_t timeout_ms,
+                                 httpmorph_preconnect_result_t *results);
+
 /* Async I/O API */
 
 /**
@@ -397,7 +1374,7 @@ size_t httpmorph_session_cookie_count(httpmorph_session_t *session);
  * @param pool Connection pool
  * @param host Target host
  * @param port Target port
- * @return File descriptor (>= 0) on success, -1 if no active connection found
+ * @return File descriptor (>= 0) on success, -1 if no pooled connection found
  */
 int httpmorph_pool_get_connection_fd(
     httpmorph_pool_t *pool,
@@ -72,8 +72,29 @@ if IS_LINUX:
     except (ValueError, IndexError):
         pass
 
+
+
+def pkg_config(*args):
+    """Run pkg-config, returning its output or None if unavailable"""
+    import subprocess
+    try:
+        return subprocess.check_output(["pkg-config", *args], stderr=subprocess.DEVNULL).decode().strip()
+    except (subprocess.CalledProcessError, FileNotFoundError):
+        return None
+
+
+# Optional Content-Encoding decoders (system libraries, found via pkg-config)
+HAS_BROTLI = not IS_WINDOWS and pkg_config("--exists", "libbrotlidec") is not None
+HAS_ZSTD = not IS_WINDOWS and pkg_config("--exists", "libzstd") is not None
+
+# USDT probes need systemtap's <sys/sdt.h> (header only, no library)
+HAS_SDT = IS_LINUX and Path("/usr/include/sys/sdt.h").exists()
+
 print(f"Building for platform: {platform.system()}")
 print(f"io_uring support: {HAS_IO_URING}")
+print(f"brotli decoding: {HAS_BROTLI}")
+print(f"zstd decoding: {HAS_ZSTD}")
+print(f"USDT probes: {HAS_SDT}")
 
 # Base directories
 SRC_DIR = Path("src")
@@ -516,6 +537,22 @@ if not ON_READTHEDOCS:
             # Other Unix - use library names (will find .a or .so)
             EXT_LIBRARIES = ["ssl", "crypto", "nghttp2", "z"]
 
+        # Optional content codings, linked dynamically like zlib
+        if HAS_BROTLI:
+            EXT_COMPILE_ARGS.append("-DHAVE_BROTLI")
+            EXT_LIBRARIES.append("brotlidec")
+        if HAS_ZSTD:
+            EXT_COMPILE_ARGS.append("-DHAVE_ZSTD")
+            EXT_LIBRARIES.append("zstd")
+        if HAS_SDT:
+            EXT_COMPILE_ARGS.append("-DHAVE_SYS_SDT")
+
+        # io_uring engine (opt-in at runtime); vendor liburing is linked statically below
+        if IS_LINUX and HAS_IO_URING:
+            EXT_COMPILE_ARGS.append("-DHAVE_IO_URING")
+            if not LIB_PATHS.get("liburing_lib"):
+                EXT_LIBRARIES.append("uring")
+
     # Define C extension modules
     # Build library directories list
     BORINGSSL_LIB_DIRS = [LIB_PATHS["openssl_lib"]]
@@ -537,6 +574,14 @@ if not ON_READTHEDOCS:
 
     LIBRARY_DIRS = BORINGSSL_LIB_DIRS + [LIB_PATHS["nghttp2_lib"]]
 
+    # Add brotli/zstd paths when they live outside the default search paths
+    for pkg, enabled in (("libbrotlidec", HAS_BROTLI), ("libzstd", HAS_ZSTD)):
+        if enabled:
+            for variable, dirs in (("includedir", INCLUDE_DIRS), ("libdir", LIBRARY_DIRS)):
+                path = pkg_config(f"--variable={variable}", pkg)
+                if path and path not in dirs:
+                    dirs.append(path)
+
     # Add zlib paths on Windows if available
     if IS_WINDOWS and LIB_PATHS.get("zlib_include"):
         zlib_inc = LIB_PATHS["zlib_include"]
@@ -605,8 +650,15 @@ if not ON_READTHEDOCS:
                 str(CORE_DIR / "util.c"),
                 str(CORE_DIR / "url.c"),
                 str(CORE_DIR / "network.c"),
+                str(CORE_DIR / "happy_eyeballs.c"),
+                str(CORE_DIR / "dns_resolver.c"),
                 str(CORE_DIR / "proxy.c"),
                 str(CORE_DIR / "tls.c"),
+                str(CORE_DIR / "tls_session_cache.c"),
+                str(CORE_DIR / "shared_cache.c"),
+                str(CORE_DIR / "ktls.c"),
+                str(CORE_DIR / "alt_svc.c"),
+                str(CORE_DIR / "ssl_ctx_cache.c"),
                 str(CORE_DIR / "boringssl_wrapper.cc"),  # C++ wrapper for BoringSSL C++ functions
                 str(CORE_DIR / "compression.c"),
                 str(CORE_DIR / "cookies.c"),
@@ -615,18 +667,32 @@ if not ON_READTHEDOCS:
                 str(CORE_DIR / "client.c"),
                 str(CORE_DIR / "session.c"),
                 str(CORE_DIR / "http1.c"),
+                str(CORE_DIR / "http1_parser.c"),
                 str(CORE_DIR / "http2_logic.c"),
                 str(CORE_DIR / "http2_session_manager.c"),
+                str(CORE_DIR / "http2_reactor.c"),
                 str(CORE_DIR / "core.c"),
+                str(CORE_DIR / "http_cache.c"),
+                str(CORE_DIR / "proxy_set.c"),
+                str(CORE_DIR / "batch.c"),
+                str(CORE_DIR / "preconnect.c"),
                 # Supporting modules
                 str(CORE_DIR / "connection_pool.c"),
                 str(CORE_DIR / "buffer_pool.c"),
                 str(CORE_DIR / "request_builder.c"),
+                str(CORE_DIR / "header_template.c"),
                 str(CORE_DIR / "string_intern.c"),
+                str(CORE_DIR / "arena.c"),
+                str(CORE_DIR / "timer_wheel.c"),
                 str(CORE_DIR / "io_engine.c"),
                 str(CORE_DIR / "iocp_dispatcher.c"),  # Windows IOCP dispatcher
                 str(CORE_DIR / "async_request.c"),
                 str(CORE_DIR / "async_request_manager.c"),
+                str(CORE_DIR / "request_scheduler.c"),
+                str(CORE_DIR / "hedge_policy.c"),
+                str(CORE_DIR / "mem_budget.c"),
+                str(CORE_DIR / "metrics.c"),
+                str(CORE_DIR / "trace.c"),
                 str(TLS_DIR / "browser_profiles.c"),
             ],
             include_dirs=INCLUDE_DIRS,
@@ -662,17 +728,31 @@ if not ON_READTHEDOCS:
                 str(CORE_DIR / "iocp_dispatcher.c"),  # Windows IOCP dispatcher
                 str(CORE_DIR / "async_request.c"),
                 str(CORE_DIR / "async_request_manager.c"),
+                str(CORE_DIR / "request_scheduler.c"),  # Admission control for async
+                str(CORE_DIR / "hedge_policy.c"),  # Hedged requests for async
+                str(CORE_DIR / "mem_budget.c"),  # Response buffer budget for async
+                str(CORE_DIR / "metrics.c"),  # Request metrics for async
+                str(CORE_DIR / "trace.c"),  # Span tracing for async
                 # Dependencies needed by async modules
+                str(CORE_DIR / "http1_parser.c"),  # Response head parser for async
+                str(CORE_DIR / "timer_wheel.c"),  # Request timeouts for async
                 str(CORE_DIR / "util.c"),
                 str(CORE_DIR / "url.c"),
                 str(CORE_DIR / "network.c"),
+                str(CORE_DIR / "happy_eyeballs.c"),  # Connection racing for network.c and async
+                str(CORE_DIR / "dns_resolver.c"),  # Resolver threads for network.c and async
                 str(CORE_DIR / "proxy.c"),  # Proxy support for async
                 str(CORE_DIR / "tls.c"),
+                str(CORE_DIR / "tls_session_cache.c"),
+                str(CORE_DIR / "shared_cache.c"),  # Cross-process DNS/TLS cache for network.c and tls_session_cache.c
+                str(CORE_DIR / "ktls.c"),
+                str(CORE_DIR / "ssl_ctx_cache.c"),
                 str(CORE_DIR / "boringssl_wrapper.cc"),  # C++ wrapper for BoringSSL C++ functions
                 str(CORE_DIR / "request.c"),
                 str(CORE_DIR / "response.c"),
                 str(CORE_DIR / "buffer_pool.c"),
                 str(CORE_DIR / "string_intern.c"),
+                str(CORE_DIR / "arena.c"),  # Request arenas for request.c/response.c
                 str(TLS_DIR / "browser_profiles.c"),
             ],
             include_dirs=INCLUDE_DIRS,
@@ -6,10 +6,12 @@ _async.pyx - Cython bindings for httpmorph async I/O APIs
 Provides Python asyncio integration for the C-level async request engine.
 """
 
-from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t
+from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t, int64_t
 from libc.stdlib cimport malloc, free
-from libc.string cimport strdup
+from libc.string cimport strdup, memcpy, memset
 from libc.stdio cimport printf
+from cpython.bytes cimport PyBytes_FromStringAndSize
+from cpython.buffer cimport PyBuffer_FillInfo
 
 import asyncio
 import select
@@ -39,6 +41,7 @@ cdef extern from "../core/async_request.h":
         ASYNC_STATUS_ERROR
         ASYNC_STATUS_NEED_READ
         ASYNC_STATUS_NEED_WRITE
+        ASYNC_STATUS_PAUSED
 
     # Forward declarations
     ctypedef struct async_request_t
@@ -62,6 +65,7 @@ cdef extern from "../core/async_request.h":
     void async_request_ref(async_request_t *req) nogil
     void async_request_unref(async_request_t *req) nogil
     int async_request_step(async_request_t *req) nogil
+    uint64_t async_request_get_id(const async_request_t *req) nogil
     async_request_state_t async_request_get_state(const async_request_t *req) nogil
     const char* async_request_state_name(async_request_state_t state) nogil
     int async_request_get_fd(const async_request_t *req) nogil
@@ -71,12 +75,153 @@ cdef extern from "../core/async_request.h":
     const char* async_request_get_error_message(const async_request_t *req) nogil
 
 
+cdef extern from "../core/io_engine.h":
+    ctypedef struct io_engine_t
+
+    enum:
+        IO_ENGINE_OPT_URING
+        IO_ENGINE_OPT_SQPOLL
+        IO_ENGINE_OPT_ZERO_COPY
+        IO_ENGINE_OPT_FIXED_FILES
+
+    ctypedef struct io_engine_stats_t:
+        uint64_t ops_submitted
+        uint64_t ops_completed
+        uint64_t ops_failed
+        uint64_t zero_copy_sends
+        uint64_t ring_buffer_recvs
+
+    io_engine_t* io_engine_create(uint32_t queue_depth) nogil
+    void io_engine_destroy(io_engine_t *engine) nogil
+
+
+cdef extern from "../core/request_scheduler.h":
+    enum:
+        REQUEST_PRIORITY_HIGH
+        REQUEST_PRIORITY_NORMAL
+        REQUEST_PRIORITY_LOW
+
+    ctypedef struct request_scheduler_config_t:
+        uint32_t max_per_origin
+        uint32_t max_total
+        double rate
+        uint32_t burst
+
+    ctypedef struct request_scheduler_stats_t:
+        size_t queued
+        size_t in_flight
+        size_t origins
+        uint64_t admitted
+        uint64_t deferred
+
+
+cdef extern from "../core/hedge_policy.h":
+    ctypedef struct hedge_policy_config_t:
+        double percentile
+        uint32_t min_delay_ms
+        uint32_t min_samples
+        double budget
+        uint32_t max_in_flight
+
+    ctypedef struct hedge_policy_stats_t:
+        uint64_t planned
+        uint64_t launched
+        uint64_t won
+        uint64_t denied
+        size_t in_flight
+
+
+cdef extern from "../include/httpmorph.h":
+    # Tracing
+    ctypedef struct httpmorph_span_t:
+        uint8_t trace_id[16]
+        uint8_t span_id[8]
+        uint8_t parent_span_id[8]
+        const char *name
+        uint64_t start_unix_ns
+        uint64_t end_unix_ns
+        uint64_t request_id
+        const char *method
+        const char *url
+        int status_code
+        int error
+        int http_version
+        bint connection_reused
+        bint tls_resumed
+        size_t body_len
+
+    ctypedef void (*httpmorph_span_callback_t)(const httpmorph_span_t *span, void *user_data)
+    void httpmorph_set_tracer(httpmorph_span_callback_t callback, void *user_data)
+
+    # Name servers for this module's copy of the resolver
+    int httpmorph_set_dns_servers(const char *servers, uint32_t timeout_ms)
+
+    # Cross-process DNS and TLS session cache
+    int httpmorph_shared_cache_open(const char *path, size_t dns_entries, size_t tls_entries)
+
+    # Request metrics
+    enum: HTTPMORPH_MAX_METRICS_ORIGINS
+    ctypedef struct httpmorph_metrics_t:
+        uint64_t requests
+        uint64_t errors
+        uint64_t connections_opened
+        uint64_t connections_reused
+        uint64_t tls_handshakes
+        uint64_t tls_resumed
+        uint64_t http2_streams
+        uint64_t body_wire_bytes
+        uint64_t body_bytes
+        uint64_t memory_limit
+        uint64_t memory_in_use
+        uint64_t memory_peak
+        uint64_t memory_stalls
+
+    ctypedef struct httpmorph_origin_metrics_t:
+        char origin[288]
+        uint64_t requests
+        uint64_t errors
+        uint64_t p50_us
+        uint64_t p90_us
+        uint64_t p99_us
+        uint64_t p999_us
+        uint64_t max_us
+        uint64_t total_us
+        uint64_t queue_us
+        uint64_t dns_us
+        uint64_t connect_us
+        uint64_t tls_us
+        uint64_t first_byte_us
+
+
+cdef extern from "../core/timer_wheel.h":
+    ctypedef struct timer_wheel_timer_t:
+        uint64_t expires_ms
+        void *data
+
+    ctypedef struct timer_wheel_t:
+        uint64_t now_ms
+        size_t count
+
+    ctypedef void (*timer_wheel_expire_cb)(timer_wheel_timer_t *timer, void *ctx) noexcept
+
+    void timer_wheel_init(timer_wheel_t *wheel, uint64_t now_ms) nogil
+    void timer_wheel_arm(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint64_t expires_ms) nogil
+    size_t timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_ms,
+                               timer_wheel_expire_cb cb, void *ctx) nogil
+
+
 cdef extern from "../core/async_request_manager.h":
     # Request manager structure
     ctypedef struct async_request_manager_t
 
     # Manager functions
     async_request_manager_t* async_manager_create() nogil
+    async_request_manager_t* async_manager_create_ex(uint32_t io_options) nogil
+    async_request_manager_t* async_manager_create_sharded(uint32_t shard_count, uint32_t io_options) nogil
+    const char* async_manager_get_io_stats(const async_request_manager_t *mgr, io_engine_stats_t *stats) nogil
+    uint32_t async_manager_get_shard_count(const async_request_manager_t *mgr) nogil
+    int async_manager_get_shard_stats(const async_request_manager_t *mgr, uint32_t shard,
+                                      size_t *owned, uint64_t *steals) nogil
     void async_manager_destroy(async_request_manager_t *mgr) nogil
     uint64_t async_manager_submit_request(
         async_request_manager_t *mgr,
@@ -85,6 +230,37 @@ cdef extern from "../core/async_request_manager.h":
         async_request_callback_t callback,
         void *user_data
     ) nogil
+    uint64_t async_manager_submit_request_ex(
+        async_request_manager_t *mgr,
+        const httpmorph_request_t *request,
+        uint32_t timeout_ms,
+        int priority,
+        async_request_callback_t callback,
+        void *user_data
+    ) nogil
+    uint64_t async_manager_preconnect(
+        async_request_manager_t *mgr,
+        const char *url,
+        bint verify_ssl,
+        uint32_t timeout_ms,
+        async_request_callback_t callback,
+        void *user_data
+    ) nogil
+    int async_manager_set_scheduler(async_request_manager_t *mgr,
+                                    const request_scheduler_config_t *config) nogil
+    int async_manager_set_origin_limits(async_request_manager_t *mgr, const char *url,
+                                        uint32_t max_concurrent, double rate, uint32_t burst) nogil
+    int async_manager_get_scheduler_stats(async_request_manager_t *mgr,
+                                          request_scheduler_stats_t *stats) nogil
+    int async_manager_set_hedging(async_request_manager_t *mgr,
+                                  const hedge_policy_config_t *config) nogil
+    int async_manager_set_memory_budget(async_request_manager_t *mgr, uint64_t max_bytes) nogil
+    int async_manager_get_hedge_stats(async_request_manager_t *mgr,
+                                      hedge_policy_stats_t *stats) nogil
+    int async_manager_get_metrics(async_request_manager_t *mgr, httpmorph_metrics_t *metrics) nogil
+    int async_manager_get_origin_metrics(async_request_manager_t *mgr,
+                                         httpmorph_origin_metrics_t *origins, int max_origins) nogil
+    void async_manager_reset_metrics(async_request_manager_t *mgr) nogil
     async_request_t* async_manager_get_request(
         async_request_manager_t *mgr,
         uint64_t request_id
@@ -93,6 +269,10 @@ cdef extern from "../core/async_request_manager.h":
         async_request_manager_t *mgr,
         uint64_t request_id
     ) nogil
+    int async_manager_resume_request(
+        async_request_manager_t *mgr,
+        uint64_t request_id
+    ) nogil
     int async_manager_poll(
         async_request_manager_t *mgr,
         uint32_t timeout_ms
@@ -101,13 +281,14 @@ cdef extern from "../core/async_request_manager.h":
     size_t async_manager_get_active_count(const async_request_manager_t *mgr) nogil
     int async_manager_start_event_loop(async_request_manager_t *mgr) nogil
     int async_manager_stop_event_loop(async_request_manager_t *mgr) nogil
+    int async_manager_get_completion_fd(const async_request_manager_t *mgr) nogil
+    size_t async_manager_drain_completions(
+        async_request_manager_t *mgr,
+        async_request_t **out,
+        size_t max
+    ) nogil
 
 
-cdef extern from "../core/io_engine.h":
-    ctypedef struct io_engine_t
-
-    io_engine_t* io_engine_create(uint32_t queue_depth) nogil
-    void io_engine_destroy(io_engine_t *engine) nogil
 
 
 cdef extern from "../include/httpmorph.h":
@@ -138,6 +319,14 @@ cdef extern from "../include/httpmorph.h":
         HTTPMORPH_ERROR_TIMEOUT
         HTTPMORPH_ERROR_PARSE
         HTTPMORPH_ERROR_PROTOCOL
+        HTTPMORPH_ERROR_ABORTED
+        HTTPMORPH_ERROR_TOO_MANY_REDIRECTS
+
+    # Streaming body delivery
+    enum:
+        HTTPMORPH_BODY_PAUSE
+        HTTPMORPH_BODY_LENGTH_UNKNOWN
+        HTTPMORPH_BODY_SOURCE_PAUSE
 
     # Header structure
     ctypedef struct httpmorph_header_t:
@@ -152,13 +341,20 @@ cdef extern from "../include/httpmorph.h":
         size_t header_count
         uint8_t *body
         size_t body_len
+        uint64_t queue_time_us
+        uint64_t dns_time_us
         uint64_t connect_time_us
         uint64_t tls_time_us
         uint64_t first_byte_time_us
         uint64_t total_time_us
+        bint connection_reused
+        bint tls_resumed
+        size_t body_wire_len
         char *tls_version
         char *tls_cipher
         char *ja3_fingerprint
+        char *url
+        httpmorph_response_t *redirect_from
         httpmorph_error_t error
         char *error_message
 
@@ -168,11 +364,161 @@ cdef extern from "../include/httpmorph.h":
     int httpmorph_request_add_header(httpmorph_request_t *request, const char *key, const char *value) nogil
     int httpmorph_request_set_body(httpmorph_request_t *request, const uint8_t *body, size_t body_len) nogil
     void httpmorph_request_set_timeout(httpmorph_request_t *request, uint32_t timeout_ms) nogil
+    void httpmorph_request_set_phase_timeouts(httpmorph_request_t *request, uint32_t connect_timeout_ms,
+                                              uint32_t tls_timeout_ms, uint32_t first_byte_timeout_ms) nogil
     void httpmorph_request_set_verify_ssl(httpmorph_request_t *request, bint verify) nogil
     void httpmorph_request_set_proxy(httpmorph_request_t *request, const char *proxy_url, const char *username, const char *password) nogil
+    ctypedef int (*httpmorph_body_callback_t)(httpmorph_response_t *response, const uint8_t *data, size_t len, void *userdata)
+    void httpmorph_request_set_body_callback(httpmorph_request_t *request, httpmorph_body_callback_t callback, void *userdata, size_t chunk_size) nogil
+    ctypedef int64_t (*httpmorph_body_source_t)(uint8_t *buf, size_t len, void *userdata)
+    int httpmorph_request_set_body_source(httpmorph_request_t *request, httpmorph_body_source_t source, void *userdata, int64_t length) nogil
+    void httpmorph_request_set_redirects(httpmorph_request_t *request, bint follow, uint32_t max_redirects) nogil
+    void httpmorph_request_set_zero_rtt(httpmorph_request_t *request, bint early_data, bint tcp_fast_open) nogil
+    void httpmorph_request_set_ktls(httpmorph_request_t *request, bint enabled) nogil
 
     # Response functions
     void httpmorph_response_destroy(httpmorph_response_t *response) nogil
+    httpmorph_response_t* httpmorph_response_detach_body(httpmorph_response_t *response) nogil
+
+
+# Max completions pulled from the C queue per drain call
+cdef enum:
+    COMPLETION_BATCH = 64
+
+
+# Exposed so Python sinks can ask the engine to stop reading
+BODY_PAUSE = HTTPMORPH_BODY_PAUSE
+
+
+cdef dict _response_head(httpmorph_response_t *resp):
+    """Status line and headers of a response whose body is still streaming"""
+    headers = {}
+    for i in range(resp.header_count):
+        headers[resp.headers[i].key.decode('latin-1')] = resp.headers[i].value.decode('latin-1')
+    return {
+        'status_code': resp.status_code,
+        'headers': headers,
+        'http_version': resp.http_version,
+    }
+
+
+cdef class ResponseBody:
+    """Response body exposed through the buffer protocol without copying
+
+    Owns a body detached from its response, so the request can be released
+    while the body lives on; the buffer is freed with this object.
+    """
+    cdef httpmorph_response_t *_resp
+
+    def __len__(self):
+        return <Py_ssize_t>self._resp.body_len
+
+    def __getbuffer__(self, Py_buffer *buffer, int flags):
+        PyBuffer_FillInfo(buffer, self, <void*>self._resp.body,
+                          <Py_ssize_t>self._resp.body_len, 1, flags)
+
+    def __releasebuffer__(self, Py_buffer *buffer):
+        pass
+
+    def __bytes__(self):
+        return PyBytes_FromStringAndSize(<char*>self._resp.body, <Py_ssize_t>self._resp.body_len)
+
+    def __dealloc__(self):
+        if self._resp is not NULL:
+            httpmorph_response_destroy(self._resp)
+
+
+cdef object _take_body(httpmorph_response_t *resp):
+    """Detach a response's body for Python (b'' if empty; a copy if detaching fails)"""
+    if resp.body is NULL or resp.body_len == 0:
+        return b''
+    cdef httpmorph_response_t *detached = httpmorph_response_detach_body(resp)
+    if detached is NULL:
+        return PyBytes_FromStringAndSize(<char*>resp.body, <Py_ssize_t>resp.body_len)
+    cdef ResponseBody body = ResponseBody.__new__(ResponseBody)
+    body._resp = detached
+    return body
+
+
+cdef dict _response_to_dict(httpmorph_response_t *resp):
+    """Convert a finished response to the result dict (the request keeps it, minus the body)"""
+    # Build response dict
+    result = {
+        'status_code': resp.status_code,
+        'headers': {},
+        'body': _take_body(resp),
+        'http_version': resp.http_version,
+        'queue_time_us': resp.queue_time_us,
+        'dns_time_us': resp.dns_time_us,
+        'connect_time_us': resp.connect_time_us,
+        'tls_time_us': resp.tls_time_us,
+        'first_byte_time_us': resp.first_byte_time_us,
+        'total_time_us': resp.total_time_us,
+        'connection_reused': resp.connection_reused,
+        'tls_resumed': resp.tls_resumed,
+        'body_wire_len': resp.body_wire_len,
+        'tls_version': resp.tls_version.decode('utf-8') if resp.tls_version else None,
+        'tls_cipher': resp.tls_cipher.decode('utf-8') if resp.tls_cipher else None,
+        'ja3_fingerprint': resp.ja3_fingerprint.decode('utf-8') if resp.ja3_fingerprint else None,
+        'error': resp.error,
+        'error_message': resp.error_message.decode('utf-8') if resp.error_message else None,
+        'url': resp.url.decode('utf-8') if resp.url else None,
+    }
+
+    # Convert headers
+    for i in range(resp.header_count):
+        key = resp.headers[i].key.decode('latin-1')
+        try:
+            value = resp.headers[i].value.decode('latin-1')
+        except:
+            value = resp.headers[i].value.decode('utf-8', errors='replace')
+        result['headers'][key] = value
+
+    return result
+
+
+cdef int _body_trampoline(httpmorph_response_t *resp, const uint8_t *data, size_t length,
+                          void *userdata) noexcept with gil:
+    """Body callback: forwards the head and each chunk to a Python sink
+
+    Runs on the manager's event thread (or inside the polling step). The
+    sink returns 0 to continue, BODY_PAUSE to stop reading until
+    resume_request(), or a negative value to abort.
+    """
+    sink = <object>userdata
+    try:
+        if data is NULL:
+            rc = sink.on_head(_response_head(resp))
+        else:
+            rc = sink.on_chunk(PyBytes_FromStringAndSize(<const char*>data, <Py_ssize_t>length))
+    except BaseException as e:
+        sink.exception = e
+        return -1
+    return <int>rc if rc else 0
+
+
+cdef int64_t _body_source_trampoline(uint8_t *buf, size_t length, void *userdata) noexcept with gil:
+    """Body source: copies the next piece of a streamed request body into buf
+
+    Runs on the manager's event thread. The source's read(n) returns at
+    most n bytes, b"" at the end of the body, or None to pause sending
+    until resume_request(); an exception aborts the request.
+    """
+    source = <object>userdata
+    cdef const uint8_t[:] view
+    try:
+        data = source.read(length)
+        if data is None:
+            return HTTPMORPH_BODY_SOURCE_PAUSE
+        view = memoryview(data).cast('B')
+    except BaseException as e:
+        source.exception = e
+        return -1
+    if <size_t>view.shape[0] > length:
+        return -1
+    if view.shape[0]:
+        memcpy(buf, &view[0], view.shape[0])
+    return view.shape[0]
 
 
 # Python wrapper classes
@@ -182,24 +528,139 @@ cdef class AsyncRequestManager:
     cdef async_request_manager_t *_manager
     cdef object _loop  # asyncio event loop
     cdef dict _pending_requests  # request_id -> Future mapping
-
-    def __cinit__(self):
+    cdef bint _event_driven  # C event thread steps requests, we only collect completions
+    cdef int _completion_fd
+
+    def __cinit__(self, int shards=1, bint io_uring=False, bint sqpoll=False, bint zero_copy=False,
+                  bint fixed_files=False):
+        cdef uint32_t io_options = 0
+        cdef uint32_t shard_count = <uint32_t>shards if shards > 0 else 0
+        if io_uring:
+            io_options |= IO_ENGINE_OPT_URING
+            if sqpoll:
+                io_options |= IO_ENGINE_OPT_SQPOLL
+            if zero_copy:
+                io_options |= IO_ENGINE_OPT_ZERO_COPY
+            if fixed_files:
+                io_options |= IO_ENGINE_OPT_FIXED_FILES
         with nogil:
-            self._manager = async_manager_create()
+            self._manager = async_manager_create_sharded(shard_count, io_options)
         if self._manager is NULL:
             raise MemoryError("Failed to create async request manager")
         self._pending_requests = {}
         self._loop = None
+        self._event_driven = False
+        self._completion_fd = -1
 
     def __dealloc__(self):
         if self._manager is not NULL:
+            self._disable_event_driven()
             with nogil:
                 async_manager_destroy(self._manager)
             self._manager = NULL
 
-    def set_event_loop(self, loop):
-        """Set the asyncio event loop to use"""
+    def set_event_loop(self, loop, bint event_driven=True):
+        """Set the asyncio event loop to use
+
+        Args:
+            loop: asyncio event loop
+            event_driven: Let the C event thread drive requests through the
+                I/O engine and deliver completions through a single fd.
+                Falls back to per-request polling where the loop can't watch
+                raw fds (e.g. Windows ProactorEventLoop).
+        """
+        if self._event_driven and (not event_driven or loop is not self._loop):
+            self._disable_event_driven()
         self._loop = loop
+        if event_driven and not self._event_driven and loop is not None:
+            self._enable_event_driven()
+
+    @property
+    def event_driven(self):
+        """True if completions are delivered by the C event thread"""
+        return self._event_driven
+
+    cdef _enable_event_driven(self):
+        cdef int fd = async_manager_get_completion_fd(self._manager)
+        cdef int rc
+        if fd < 0:
+            return
+
+        try:
+            self._loop.add_reader(fd, self._on_completions)
+        except NotImplementedError:
+            return
+
+        with nogil:
+            rc = async_manager_start_event_loop(self._manager)
+        if rc != 0:
+            self._loop.remove_reader(fd)
+            return
+
+        self._completion_fd = fd
+        self._event_driven = True
+
+    cdef _disable_event_driven(self):
+        if not self._event_driven:
+            return
+        self._event_driven = False
+        with nogil:
+            async_manager_stop_event_loop(self._manager)
+        try:
+            self._loop.remove_reader(self._completion_fd)
+        except Exception:
+            pass  # Loop may already be closed
+        self._completion_fd = -1
+        # Collect anything finished between the last drain and the stop
+        # (whatever is left is released by async_manager_destroy)
+        try:
+            self._on_completions()
+        except Exception:
+            pass
+
+    def _on_completions(self):
+        """Resolve futures for every request the event thread finished"""
+        cdef async_request_t *batch[COMPLETION_BATCH]
+        cdef size_t count
+        cdef size_t i
+
+        while True:
+            with nogil:
+                count = async_manager_drain_completions(self._manager, batch, COMPLETION_BATCH)
+            if count == 0:
+                break
+
+            for i in range(count):
+                future = self._pending_requests.pop(async_request_get_id(batch[i]), None)
+                try:
+                    if future is not None and not future.done():
+                        self._resolve_future(batch[i], future)
+                except Exception as e:
+                    if not future.done():
+                        future.set_exception(e)
+                finally:
+                    async_request_unref(batch[i])
+
+            if count < COMPLETION_BATCH:
+                break
+
+    cdef _resolve_future(self, async_request_t *req, future):
+        """Set result or exception on future from a finished request"""
+        cdef async_request_state_t state = async_request_get_state(req)
+        cdef const char *error_msg_ptr
+
+        if state == ASYNC_STATE_COMPLETE:
+            future.set_result(self._extract_response(req))
+            return
+
+        if async_request_is_timeout(req):
+            future.set_exception(TimeoutError("Request timed out"))
+            return
+
+        state_name = async_request_state_name(state).decode('utf-8')
+        error_msg_ptr = async_request_get_error_message(req)
+        error_msg = error_msg_ptr.decode('utf-8') if error_msg_ptr is not NULL else "Unknown error"
+        future.set_exception(RuntimeError(f"Request failed in state {state_name}: {error_msg}"))
 
     async def submit_request(
         self,
@@ -210,7 +671,20 @@ cdef class AsyncRequestManager:
         uint32_t timeout_ms=30000,
         bint verify=True,
         proxy=None,
-        proxy_auth=None
+        proxy_auth=None,
+        body_sink=None,
+        size_t chunk_size=0,
+        body_source=None,
+        body_length=None,
+        uint32_t connect_timeout_ms=0,
+        uint32_t tls_timeout_ms=0,
+        uint32_t first_byte_timeout_ms=0,
+        int priority=REQUEST_PRIORITY_NORMAL,
+        bint follow_redirects=False,
+        uint32_t max_redirects=10,
+        bint early_data=False,
+        bint tcp_fast_open=False,
+        bint ktls=False
     ):
         """Submit an async HTTP request and return a Future
 
@@ -223,6 +697,28 @@ cdef class AsyncRequestManager:
             verify: Whether to verify SSL certificates (default: True)
             proxy: Proxy URL or dict
             proxy_auth: (username, password) tuple
+            body_sink: Object with on_head(dict) and on_chunk(bytes) that
+                receives the body as it arrives instead of buffering it
+            chunk_size: Maximum bytes per on_chunk() call (0 for default)
+            body_source: Object whose read(n) streams the request body
+                (None from read() pauses until resume_request(); bind()
+                and close() are called around the request)
+            body_length: Length of body_source (None sends it chunked)
+            connect_timeout_ms: Limit for the TCP connect (0 for none)
+            tls_timeout_ms: Limit for the TLS handshake (0 for none)
+            first_byte_timeout_ms: Limit from the request being sent to the
+                first response byte (0 for none)
+            priority: Scheduler class, 0 (high) to 2 (low); waiting
+                requests of a higher class start first
+            follow_redirects: Follow redirects in the event thread (same
+                ID throughout; the result gets 'url' and 'history')
+            max_redirects: Hops before the result carries
+                HTTPMORPH_ERROR_TOO_MANY_REDIRECTS
+            early_data: Send a GET, HEAD or OPTIONS without a body as TLS
+                1.3 early data when a session to the origin is cached
+            tcp_fast_open: Put the first flight in the SYN (Linux, once
+                the kernel holds a cookie for the server)
+            ktls: Let the kernel decrypt a large HTTPS body (Linux)
 
         Returns:
             dict: Response dictionary with status_code, headers, body, etc.
@@ -261,12 +757,22 @@ cdef class AsyncRequestManager:
             raise MemoryError("Failed to create request")
 
         try:
-            # Set timeout
+            # Set timeouts
             httpmorph_request_set_timeout(req, timeout_ms)
+            httpmorph_request_set_phase_timeouts(req, connect_timeout_ms, tls_timeout_ms,
+                                                 first_byte_timeout_ms)
 
             # Set SSL verification
             httpmorph_request_set_verify_ssl(req, verify)
 
+            # Redirects are followed by the event thread only
+            if follow_redirects:
+                httpmorph_request_set_redirects(req, True, max_redirects)
+
+            # 0-RTT setup to origins seen before
+            httpmorph_request_set_zero_rtt(req, early_data, tcp_fast_open)
+            httpmorph_request_set_ktls(req, ktls)
+
             # Set proxy if provided
             # WARNING: Proxy support is NOT implemented in the async I/O engine yet.
             # The proxy will be set on the request object but IGNORED during execution.
@@ -307,35 +813,109 @@ cdef class AsyncRequestManager:
             if body:
                 httpmorph_request_set_body(req, <const uint8_t*>body, len(body))
 
+            # Stream the response body (body_sink outlives req in this frame)
+            if body_sink is not None:
+                httpmorph_request_set_body_callback(req, _body_trampoline, <void*>body_sink, chunk_size)
+
+            # Stream the request body (body_source outlives req in this frame)
+            if body_source is not None:
+                if httpmorph_request_set_body_source(
+                        req, _body_source_trampoline, <void*>body_source,
+                        HTTPMORPH_BODY_LENGTH_UNKNOWN if body_length is None else body_length) != 0:
+                    raise ValueError("Invalid streamed request body")
+
             # Create a Future for this request
-            future = asyncio.Future()
+            future = self._loop.create_future() if self._loop is not None else asyncio.Future()
 
             # Submit to manager
-            # Note: We can't use callbacks from C to Python easily,
-            # so we'll poll the request instead
-            request_id = async_manager_submit_request(
-                self._manager,
-                req,
-                timeout_ms,
-                NULL,  # No callback for now
-                NULL   # No user data
-            )
+            # Note: We can't use callbacks from C to Python easily, so either
+            # the C event thread queues the completion for _on_completions,
+            # or we poll the request ourselves. The event thread may hold the
+            # slot lock while waiting for the GIL (a sink or source callback)
+            with nogil:
+                request_id = async_manager_submit_request_ex(
+                    self._manager,
+                    req,
+                    timeout_ms,
+                    priority,
+                    NULL,  # No callback for now
+                    NULL   # No user data
+                )
 
             if request_id == 0:
                 raise RuntimeError("Failed to submit request")
 
-            # Store the future
+            if body_sink is not None:
+                body_sink.request_id = request_id
+            if body_source is not None:
+                body_source.bind(self, request_id)
+
+            # Store the future (before yielding, so the completion can't be missed)
             self._pending_requests[request_id] = future
 
+            if self._event_driven:
+                try:
+                    return await future
+                except asyncio.CancelledError:
+                    self._pending_requests.pop(request_id, None)
+                    # The event thread may hold the slot lock while waiting for the GIL
+                    with nogil:
+                        async_manager_cancel_request(self._manager, request_id)
+                    raise
+
             # Start polling for this request
             await self._poll_request(request_id, future)
+            self._pending_requests.pop(request_id, None)
 
             # Wait for completion
             return await future
 
         finally:
+            if body_source is not None:
+                body_source.close()
             httpmorph_request_destroy(req)
 
+    async def submit_preconnect(self, str url, uint32_t timeout_ms=30000, bint verify=True):
+        """Open a connection to url's origin for a later request
+
+        DNS, connect and the TLS handshake run in the async engine; the
+        connection is then kept for a request to the origin.
+
+        Args:
+            url: Any URL on the origin
+            timeout_ms: Timeout in milliseconds
+            verify: Whether to verify SSL certificates (requests that verify
+                differently don't take the connection)
+
+        Returns:
+            dict: Response dictionary with status_code 0 and the
+            connection's dns/connect/tls timings
+        """
+        cdef uint64_t request_id
+        url_bytes = url.encode('utf-8')
+
+        with nogil:
+            request_id = async_manager_preconnect(self._manager, <const char*>url_bytes, verify,
+                                                  timeout_ms, NULL, NULL)
+        if request_id == 0:
+            raise RuntimeError("Failed to submit preconnect")
+
+        future = self._loop.create_future() if self._loop is not None else asyncio.Future()
+        self._pending_requests[request_id] = future
+
+        if self._event_driven:
+            try:
+                return await future
+            except asyncio.CancelledError:
+                self._pending_requests.pop(request_id, None)
+                with nogil:
+                    async_manager_cancel_request(self._manager, request_id)
+                raise
+
+        await self._poll_request(request_id, future)
+        self._pending_requests.pop(request_id, None)
+        return await future
+
     async def _poll_request(self, uint64_t request_id, future):
         """Poll a request until it completes"""
         # Declare all cdef variables at the top
@@ -346,8 +926,9 @@ cdef class AsyncRequestManager:
         cdef bint is_timeout
 
         while not future.done():
-            # Get request (adds a reference)
-            req = async_manager_get_request(self._manager, request_id)
+            # Get request (adds a reference; takes the slot lock)
+            with nogil:
+                req = async_manager_get_request(self._manager, request_id)
 
             if req is NULL:
                 future.set_exception(RuntimeError("Request not found"))
@@ -431,6 +1012,7 @@ cdef class AsyncRequestManager:
     cdef dict _extract_response(self, async_request_t *req):
         """Extract response from completed request"""
         cdef httpmorph_response_t *resp
+        cdef httpmorph_response_t *hop
 
         resp = async_request_get_response(req)
 
@@ -443,34 +1025,26 @@ cdef class AsyncRequestManager:
                 'error_message': 'No response'
             }
 
-        # Build response dict
-        result = {
-            'status_code': resp.status_code,
-            'headers': {},
-            'body': bytes(resp.body[:resp.body_len]) if resp.body else b'',
-            'http_version': resp.http_version,
-            'connect_time_us': resp.connect_time_us,
-            'tls_time_us': resp.tls_time_us,
-            'first_byte_time_us': resp.first_byte_time_us,
-            'total_time_us': resp.total_time_us,
-            'tls_version': resp.tls_version.decode('utf-8') if resp.tls_version else None,
-            'tls_cipher': resp.tls_cipher.decode('utf-8') if resp.tls_cipher else None,
-            'ja3_fingerprint': resp.ja3_fingerprint.decode('utf-8') if resp.ja3_fingerprint else None,
-            'error': resp.error,
-            'error_message': resp.error_message.decode('utf-8') if resp.error_message else None,
-        }
+        result = _response_to_dict(resp)
 
-        # Convert headers
-        for i in range(resp.header_count):
-            key = resp.headers[i].key.decode('latin-1')
-            try:
-                value = resp.headers[i].value.decode('latin-1')
-            except:
-                value = resp.headers[i].value.decode('utf-8', errors='replace')
-            result['headers'][key] = value
+        # Earlier hops of a followed redirect, oldest first
+        history = []
+        hop = resp.redirect_from
+        while hop is not NULL:
+            history.append(_response_to_dict(hop))
+            hop = hop.redirect_from
+        history.reverse()
+        result['history'] = history
 
         return result
 
+    def resume_request(self, uint64_t request_id):
+        """Resume a streamed request whose sink returned BODY_PAUSE"""
+        cdef int result
+        with nogil:
+            result = async_manager_resume_request(self._manager, request_id)
+        return result == 0
+
     def get_active_count(self):
         """Get number of active requests"""
         cdef size_t count
@@ -478,16 +1052,362 @@ cdef class AsyncRequestManager:
             count = async_manager_get_active_count(self._manager)
         return count
 
+    def io_stats(self):
+        """I/O engine statistics
+
+        Returns a dict with the engine name, its ops_submitted,
+        ops_completed, ops_failed, zero_copy_sends and ring_buffer_recvs
+        counters (summed over shards), the shard count and the number of
+        requests shards took from each other (steals).
+        """
+        cdef io_engine_stats_t stats
+        cdef const char *engine
+        cdef uint32_t shard_count
+        cdef uint64_t steals = 0
+        cdef uint64_t shard_steals
+        cdef uint32_t i
+        with nogil:
+            engine = async_manager_get_io_stats(self._manager, &stats)
+            shard_count = async_manager_get_shard_count(self._manager)
+            for i in range(shard_count):
+                if async_manager_get_shard_stats(self._manager, i, NULL, &shard_steals) == 0:
+                    steals += shard_steals
+        return {
+            'engine': engine.decode('ascii') if engine is not NULL else None,
+            'ops_submitted': stats.ops_submitted,
+            'ops_completed': stats.ops_completed,
+            'ops_failed': stats.ops_failed,
+            'zero_copy_sends': stats.zero_copy_sends,
+            'ring_buffer_recvs': stats.ring_buffer_recvs,
+            'shards': shard_count,
+            'steals': steals,
+        }
+
+    def set_scheduler(self, uint32_t max_per_origin=0, uint32_t max_total=0, double rate=0,
+                      uint32_t burst=0):
+        """Hold requests until their origin's limits let them start
+
+        Args:
+            max_per_origin: Requests in flight per origin (0 for 6)
+            max_total: Requests in flight overall (0 for no limit)
+            rate: Requests started per second per origin (0 for no limit)
+            burst: Requests an idle origin may start at once (0 for the
+                rate rounded up)
+        """
+        cdef request_scheduler_config_t config
+        cdef int result
+        config.max_per_origin = max_per_origin
+        config.max_total = max_total
+        config.rate = rate
+        config.burst = burst
+        with nogil:
+            result = async_manager_set_scheduler(self._manager, &config)
+        if result != 0:
+            raise MemoryError("Failed to create request scheduler")
+
+    def set_origin_limits(self, str origin, uint32_t max_concurrent=0, double rate=0,
+                          uint32_t burst=0):
+        """Give one origin its own limits (0 keeps the scheduler default)"""
+        cdef int result
+        origin_bytes = origin.encode('utf-8')
+        cdef const char *c_origin = origin_bytes
+        with nogil:
+            result = async_manager_set_origin_limits(self._manager, c_origin, max_concurrent,
+                                                     rate, burst)
+        if result != 0:
+            raise ValueError(f"Invalid origin: {origin}")
+
+    def scheduler_stats(self):
+        """Scheduler counters
+
+        Returns a dict with queued, in_flight, origins, admitted and
+        deferred (requests that had to wait), or None without a scheduler.
+        """
+        cdef request_scheduler_stats_t stats
+        cdef int result
+        with nogil:
+            result = async_manager_get_scheduler_stats(self._manager, &stats)
+        if result != 0:
+            return None
+        return {
+            'queued': stats.queued,
+            'in_flight': stats.in_flight,
+            'origins': stats.origins,
+            'admitted': stats.admitted,
+            'deferred': stats.deferred,
+        }
+
+    def set_memory_budget(self, uint64_t max_bytes):
+        """Cap the bytes requests may buffer for responses
+
+        A request whose receive buffer would take the total past the budget
+        stops reading its socket until others finish; one request at a time
+        may go over so that something always completes.
+
+        Args:
+            max_bytes: Budget in bytes (0 for no limit)
+        """
+        with nogil:
+            async_manager_set_memory_budget(self._manager, max_bytes)
+
+    def set_hedging(self, double percentile=0, uint32_t min_delay_ms=0, uint32_t min_samples=0,
+                    double budget=0, uint32_t max_in_flight=0):
+        """Send slow GET, HEAD and OPTIONS requests a second time
+
+        A request with no response byte once its origin's first-byte
+        percentile has passed is duplicated; the first copy to answer wins.
+        Only applies in event-driven mode.
+
+        Args:
+            percentile: First-byte percentile to wait for (0 for 95)
+            min_delay_ms: Never hedge sooner (0 for 10)
+            min_samples: Requests an origin needs before it is hedged (0 for 20)
+            budget: Hedges per hedgeable request (0 for 0.05)
+            max_in_flight: Hedges running at once (0 for no limit)
+        """
+        cdef hedge_policy_config_t config
+        cdef int result
+        config.percentile = percentile
+        config.min_delay_ms = min_delay_ms
+        config.min_samples = min_samples
+        config.budget = budget
+        config.max_in_flight = max_in_flight
+        with nogil:
+            result = async_manager_set_hedging(self._manager, &config)
+        if result != 0:
+            raise MemoryError("Failed to create hedge policy")
+
+    def hedge_stats(self):
+        """Hedging counters
+
+        Returns a dict with planned (requests given a hedge delay), launched,
+        won (hedges that answered first), denied (refused by the budget) and
+        in_flight, or None without hedging.
+        """
+        cdef hedge_policy_stats_t stats
+        cdef int result
+        with nogil:
+            result = async_manager_get_hedge_stats(self._manager, &stats)
+        if result != 0:
+            return None
+        return {
+            'planned': stats.planned,
+            'launched': stats.launched,
+            'won': stats.won,
+            'denied': stats.denied,
+            'in_flight': stats.in_flight,
+        }
+
+    def metrics(self):
+        """Request metrics
+
+        Returns a dict with requests, errors, connections_opened,
+        connections_reused, tls_handshakes, tls_resumed, http2_streams,
+        body_wire_bytes, body_bytes, the response buffer budget
+        (memory_limit, memory_in_use, memory_peak and memory_stalls, the
+        times a request paused for room), and under 'origins' a dict per origin
+        (in the order first seen) with requests, errors, latency percentiles
+        (p50_us, p90_us, p99_us, p999_us, max_us) and summed phase times.
+        """
+        cdef httpmorph_metrics_t metrics
+        cdef httpmorph_origin_metrics_t *origins = <httpmorph_origin_metrics_t *>malloc(
+            HTTPMORPH_MAX_METRICS_ORIGINS * sizeof(httpmorph_origin_metrics_t))
+        cdef int count
+        cdef int i
+        if origins is NULL:
+            raise MemoryError()
+        try:
+            with nogil:
+                async_manager_get_metrics(self._manager, &metrics)
+                count = async_manager_get_origin_metrics(self._manager, origins,
+                                                         HTTPMORPH_MAX_METRICS_ORIGINS)
+            origin_list = []
+            for i in range(min(count, HTTPMORPH_MAX_METRICS_ORIGINS)):
+                origin_list.append({
+                    'origin': origins[i].origin.decode('utf-8', 'replace'),
+                    'requests': origins[i].requests,
+                    'errors': origins[i].errors,
+                    'p50_us': origins[i].p50_us,
+                    'p90_us': origins[i].p90_us,
+                    'p99_us': origins[i].p99_us,
+                    'p999_us': origins[i].p999_us,
+                    'max_us': origins[i].max_us,
+                    'total_us': origins[i].total_us,
+                    'queue_us': origins[i].queue_us,
+                    'dns_us': origins[i].dns_us,
+                    'connect_us': origins[i].connect_us,
+                    'tls_us': origins[i].tls_us,
+                    'first_byte_us': origins[i].first_byte_us,
+                })
+        finally:
+            free(origins)
+        return {
+            'requests': metrics.requests,
+            'errors': metrics.errors,
+            'connections_opened': metrics.connections_opened,
+            'connections_reused': metrics.connections_reused,
+            'tls_handshakes': metrics.tls_handshakes,
+            'tls_resumed': metrics.tls_resumed,
+            'http2_streams': metrics.http2_streams,
+            'body_wire_bytes': metrics.body_wire_bytes,
+            'body_bytes': metrics.body_bytes,
+            'memory_limit': metrics.memory_limit,
+            'memory_in_use': metrics.memory_in_use,
+            'memory_peak': metrics.memory_peak,
+            'memory_stalls': metrics.memory_stalls,
+            'origins': origin_list,
+        }
+
+    def reset_metrics(self):
+        """Zero the request metrics"""
+        with nogil:
+            async_manager_reset_metrics(self._manager)
+
     def cleanup(self):
         """Trigger cleanup of completed requests"""
         cdef int result
+        if self._event_driven:
+            # The event thread retires requests itself
+            return 0
         with nogil:
             # Poll with 0 timeout just triggers cleanup without waiting
             result = async_manager_poll(self._manager, 0)
         return result
 
 
+_tracer = None
+_PROTOCOL_VERSIONS = ('1.0', '1.1', '2', '3')
+
+
+cdef object _span_to_dict(const httpmorph_span_t *span):
+    """Convert a span to an OpenTelemetry-style dict"""
+    cdef int i
+    cdef bint root = True
+    for i in range(8):
+        if span.parent_span_id[i]:
+            root = False
+    attributes = {'httpmorph.request_id': span.request_id}
+    if root:
+        attributes['http.request.method'] = span.method.decode('ascii')
+        attributes['url.full'] = span.url.decode('utf-8', 'replace')
+        if span.status_code:
+            attributes['http.response.status_code'] = span.status_code
+            if 0 <= span.http_version < 4:
+                attributes['network.protocol.version'] = _PROTOCOL_VERSIONS[span.http_version]
+        if span.error:
+            attributes['error.type'] = str(span.error)
+        attributes['httpmorph.connection_reused'] = bool(span.connection_reused)
+        attributes['httpmorph.tls_resumed'] = bool(span.tls_resumed)
+        attributes['httpmorph.body_len'] = span.body_len
+    return {
+        'trace_id': bytes(span.trace_id[:16]).hex(),
+        'span_id': bytes(span.span_id[:8]).hex(),
+        'parent_span_id': None if root else bytes(span.parent_span_id[:8]).hex(),
+        'name': span.name.decode('ascii'),
+        'start_time_unix_nano': span.start_unix_ns,
+        'end_time_unix_nano': span.end_unix_ns,
+        'attributes': attributes,
+    }
+
+
+cdef void _span_trampoline(const httpmorph_span_t *span, void *user_data) noexcept with gil:
+    """Span callback: hands each span to the Python tracer as a dict"""
+    tracer = _tracer
+    if tracer is None:
+        return
+    try:
+        tracer(_span_to_dict(span))
+    except BaseException:
+        pass  # A tracer must never fail the request
+
+
+def set_tracer(tracer):
+    """Call tracer(span_dict) for every span of every request (None stops)
+
+    Spans are dicts shaped like OpenTelemetry spans: trace_id, span_id,
+    parent_span_id (None for a request's root span), name,
+    start_time_unix_nano, end_time_unix_nano and attributes.
+    """
+    global _tracer
+    _tracer = tracer
+    if tracer is None:
+        httpmorph_set_tracer(NULL, NULL)
+    else:
+        httpmorph_set_tracer(_span_trampoline, NULL)
+
+
+def set_dns_servers(servers=None, timeout=None):
+    """Send async DNS queries to the given name servers (see _httpmorph.set_dns_servers)"""
+    cdef uint32_t timeout_ms = int(timeout * 1000) if timeout else 0
+    cdef bytes servers_bytes
+    cdef int result
+
+    if not servers:
+        result = httpmorph_set_dns_servers(NULL, timeout_ms)
+    else:
+        servers_bytes = ",".join(servers).encode('ascii')
+        result = httpmorph_set_dns_servers(servers_bytes, timeout_ms)
+
+    if result != 0:
+        raise ValueError(f"Invalid DNS server list: {servers!r}")
+
+
+def open_shared_cache(path, size_t dns_entries=0, size_t tls_entries=0):
+    """Share DNS results and TLS sessions through a file (see _httpmorph.open_shared_cache)
+
+    Returns:
+        True if opened, False if it failed or one is already open
+    """
+    cdef bytes path_bytes = str(path).encode('utf-8')
+    return httpmorph_shared_cache_open(path_bytes, dns_entries, tls_entries) == 0
+
+
+cdef void _record_fire_time(timer_wheel_timer_t *timer, void *ctx) noexcept:
+    (<uint64_t*>timer.data)[0] = (<timer_wheel_t*>ctx).now_ms
+
+
+def _timer_wheel_fire_times(uint64_t start_ms, expiries, uint64_t step_ms=1):
+    """Arm a timer per expiry on a fresh wheel, advance it step_ms at a time
+    and return the time each fired at (for tests of the request timers)"""
+    cdef timer_wheel_t *wheel = <timer_wheel_t*>malloc(sizeof(timer_wheel_t))
+    cdef size_t count = len(expiries)
+    cdef timer_wheel_timer_t *timers = <timer_wheel_timer_t*>malloc(count * sizeof(timer_wheel_timer_t) + 1)
+    cdef uint64_t *fired = <uint64_t*>malloc(count * sizeof(uint64_t) + 1)
+    cdef uint64_t now = start_ms
+    cdef size_t i
+    if wheel is NULL or timers is NULL or fired is NULL:
+        free(wheel)
+        free(timers)
+        free(fired)
+        raise MemoryError()
+    try:
+        memset(timers, 0, count * sizeof(timer_wheel_timer_t))
+        timer_wheel_init(wheel, start_ms)
+        for i in range(count):
+            fired[i] = 0
+            timers[i].data = &fired[i]
+            timer_wheel_arm(wheel, &timers[i], expiries[i])
+        while wheel.count:
+            now += step_ms
+            timer_wheel_advance(wheel, now, _record_fire_time, wheel)
+        return [fired[i] for i in range(count)]
+    finally:
+        free(wheel)
+        free(timers)
+        free(fired)
+
+
 # Expose the manager to Python
-def create_async_manager():
-    """Create a new async request manager"""
-    return AsyncRequestManager()
+def create_async_manager(**io_options):
+    """Create a new async request manager
+
+    Args:
+        shards: Event threads, each with its own I/O engine (0 for one
+            per CPU)
+        io_uring: Drive sockets with io_uring instead of epoll (Linux,
+            falls back to epoll when unavailable)
+        sqpoll: Let a kernel thread poll the io_uring submission queue
+        zero_copy: Send large buffers with zero-copy sends
+        fixed_files: Register socket fds with the ring
+    """
+    return AsyncRequestManager(**io_options)
@@ -7,11 +7,13 @@ Provides Python interface to the high-performance C HTTP client
 with dynamic browser fingerprinting.
 """
 
-from libc.stdint cimport uint8_t, uint16_t, uint32_t, uint64_t
-from libc.stdlib cimport malloc, free
-from libc.string cimport strdup
+from libc.stdint cimport uint8_t, uint16_t, int32_t, uint32_t, uint64_t, int64_t
+from libc.stdlib cimport malloc, calloc, free
+from libc.string cimport strdup, strlen, memcpy
 from libc.stdio cimport printf
 from cpython.bytes cimport PyBytes_FromStringAndSize
+from cpython.buffer cimport PyBuffer_FillInfo
+from cpython.exc cimport PyErr_CheckSignals
 
 # Helper to get version for User-Agent strings
 def _get_httpmorph_version():
@@ -34,6 +36,8 @@ cdef extern from "../include/httpmorph.h":
         HTTPMORPH_ERROR_TIMEOUT
         HTTPMORPH_ERROR_PARSE
         HTTPMORPH_ERROR_PROTOCOL
+        HTTPMORPH_ERROR_ABORTED
+        HTTPMORPH_ERROR_TOO_MANY_REDIRECTS
 
     # HTTP methods
     ctypedef enum httpmorph_method_t:
@@ -64,6 +68,8 @@ cdef extern from "../include/httpmorph.h":
     ctypedef struct httpmorph_client_t
     ctypedef struct httpmorph_session_t
     ctypedef struct httpmorph_pool_t
+    ctypedef struct httpmorph_cache_t
+    ctypedef struct httpmorph_proxy_set_t
 
     # Forward declarations
     ctypedef struct httpmorph_request_t
@@ -87,36 +93,233 @@ cdef extern from "../include/httpmorph.h":
         size_t body_capacity
         void *_buffer_pool
         size_t _body_actual_size
+        uint64_t queue_time_us
+        uint64_t dns_time_us
         uint64_t connect_time_us
         uint64_t tls_time_us
         uint64_t first_byte_time_us
         uint64_t total_time_us
+        uint64_t http2_rtt_us
+        uint32_t http2_window_size
+        bint connection_reused
+        bint tls_resumed
+        size_t body_wire_len
         char *tls_version
         char *tls_cipher
         char *ja3_fingerprint
+        int cache_status
+        uint64_t cache_entry_id
+        char *url
+        uint32_t redirect_count
+        httpmorph_response *redirect_from
         httpmorph_error_t error
         char *error_message
 
+    # HTTP cache
+    enum: HTTPMORPH_CACHE_NONE
+    enum: HTTPMORPH_CACHE_MISS
+    enum: HTTPMORPH_CACHE_HIT
+    enum: HTTPMORPH_CACHE_REVALIDATED
+
+    ctypedef struct httpmorph_cache_config_t:
+        size_t max_memory
+        const char *spill_dir
+        size_t spill_threshold
+        size_t max_disk
+
+    ctypedef struct httpmorph_cache_stats_t:
+        uint64_t hits
+        uint64_t misses
+        uint64_t revalidations
+        uint64_t stores
+        uint64_t evictions
+        uint64_t invalidations
+        size_t entries
+        size_t memory_bytes
+        size_t disk_bytes
+
+    httpmorph_cache_t* httpmorph_cache_create(const httpmorph_cache_config_t *config)
+    void httpmorph_cache_destroy(httpmorph_cache_t *cache)
+    void httpmorph_cache_clear(httpmorph_cache_t *cache) nogil
+    int httpmorph_cache_get_stats(httpmorph_cache_t *cache, httpmorph_cache_stats_t *stats) nogil
+
+    # Proxy sets
+    ctypedef struct httpmorph_proxy_set_config_t:
+        uint32_t eject_failures
+        uint32_t eject_ms
+        bint sticky_hosts
+
+    ctypedef struct httpmorph_proxy_stats_t:
+        uint64_t requests
+        uint64_t failures
+        uint64_t ejections
+        double latency_us
+        double error_rate
+        bint ejected
+        uint32_t ejected_ms_left
+
+    httpmorph_proxy_set_t* httpmorph_proxy_set_create(const httpmorph_proxy_set_config_t *config)
+    void httpmorph_proxy_set_destroy(httpmorph_proxy_set_t *set)
+    int httpmorph_proxy_set_add(httpmorph_proxy_set_t *set, const char *proxy_url,
+                                const char *username, const char *password) nogil
+    int httpmorph_proxy_set_remove(httpmorph_proxy_set_t *set, const char *proxy_url) nogil
+    size_t httpmorph_proxy_set_count(httpmorph_proxy_set_t *set) nogil
+    int httpmorph_proxy_set_get_stats(httpmorph_proxy_set_t *set, const char *proxy_url,
+                                      httpmorph_proxy_stats_t *stats) nogil
+
+    # TLS session resumption statistics
+    ctypedef struct httpmorph_tls_session_stats_t:
+        uint64_t hits
+        uint64_t misses
+        uint64_t stores
+        uint64_t evictions
+        uint64_t expirations
+        uint64_t resumptions
+        size_t entries
+
+    # Response buffer pool statistics (one tier)
+    ctypedef struct httpmorph_buffer_tier_stats_t:
+        size_t buffer_size
+        bint mmap_backed
+        uint64_t hits
+        uint64_t magazine_hits
+        uint64_t misses
+        uint64_t returns
+        size_t pooled
+
+    # Request arena statistics
+    ctypedef struct httpmorph_arena_stats_t:
+        uint64_t reused
+        uint64_t created
+        size_t cached
+
+    # Request metrics
+    enum: HTTPMORPH_MAX_METRICS_ORIGINS
+    ctypedef struct httpmorph_metrics_t:
+        uint64_t requests
+        uint64_t errors
+        uint64_t connections_opened
+        uint64_t connections_reused
+        uint64_t tls_handshakes
+        uint64_t tls_resumed
+        uint64_t http2_streams
+        uint64_t body_wire_bytes
+        uint64_t body_bytes
+        int pool_idle
+        int pool_active
+
+    ctypedef struct httpmorph_origin_metrics_t:
+        char origin[288]
+        uint64_t requests
+        uint64_t errors
+        uint64_t p50_us
+        uint64_t p90_us
+        uint64_t p99_us
+        uint64_t p999_us
+        uint64_t max_us
+        uint64_t total_us
+        uint64_t queue_us
+        uint64_t dns_us
+        uint64_t connect_us
+        uint64_t tls_us
+        uint64_t first_byte_us
+
+    # DNS cache statistics
+    ctypedef struct httpmorph_dns_cache_stats_t:
+        uint64_t hits
+        uint64_t misses
+        uint64_t negative_hits
+        uint64_t insertions
+        uint64_t evictions
+        uint64_t expirations
+        size_t entries
+
     # Core API
     int httpmorph_init()
     void httpmorph_cleanup()
     const char* httpmorph_version()
+    int httpmorph_set_dns_servers(const char *servers, uint32_t timeout_ms)
+    int httpmorph_dns_get_cache_stats(httpmorph_dns_cache_stats_t *stats) nogil
+
+    # Cross-process DNS and TLS session cache
+    ctypedef struct httpmorph_shared_cache_stats_t:
+        uint64_t dns_hits
+        uint64_t dns_misses
+        uint64_t dns_stores
+        uint64_t tls_hits
+        uint64_t tls_misses
+        uint64_t tls_stores
+        uint64_t busy
+        size_t dns_entries
+        size_t tls_entries
+
+    int httpmorph_shared_cache_open(const char *path, size_t dns_entries, size_t tls_entries)
+    int httpmorph_shared_cache_get_stats(httpmorph_shared_cache_stats_t *stats) nogil
+
+    # Tracing
+    ctypedef struct httpmorph_span_t:
+        uint8_t trace_id[16]
+        uint8_t span_id[8]
+        uint8_t parent_span_id[8]
+        const char *name
+        uint64_t start_unix_ns
+        uint64_t end_unix_ns
+        uint64_t request_id
+        const char *method
+        const char *url
+        int status_code
+        int error
+        int http_version
+        bint connection_reused
+        bint tls_resumed
+        size_t body_len
+
+    ctypedef void (*httpmorph_span_callback_t)(const httpmorph_span_t *span, void *user_data)
+    void httpmorph_set_tracer(httpmorph_span_callback_t callback, void *user_data)
 
     # Client API
     httpmorph_client_t* httpmorph_client_create()
     int httpmorph_client_load_ca_file(httpmorph_client_t *client, const char *ca_file)
     void httpmorph_client_destroy(httpmorph_client_t *client)
+    int httpmorph_client_get_tls_session_stats(httpmorph_client_t *client, httpmorph_tls_session_stats_t *stats) nogil
+    void httpmorph_client_clear_tls_sessions(httpmorph_client_t *client) nogil
+    int httpmorph_client_get_alt_svc(httpmorph_client_t *client, const char *url, const char *protocol, char *host, size_t host_size, uint16_t *port) nogil
+    void httpmorph_client_clear_alt_svc(httpmorph_client_t *client) nogil
+    int httpmorph_client_allow_pipelining(httpmorph_client_t *client, const char *url, uint32_t depth)
+    int httpmorph_client_enable_request_arenas(httpmorph_client_t *client, size_t max_cached)
+    int httpmorph_client_get_arena_stats(httpmorph_client_t *client, httpmorph_arena_stats_t *stats) nogil
+    int httpmorph_client_get_buffer_pool_stats(httpmorph_client_t *client,
+                                               httpmorph_buffer_tier_stats_t *stats, int max_tiers) nogil
+    int httpmorph_client_get_metrics(httpmorph_client_t *client, httpmorph_metrics_t *metrics) nogil
+    int httpmorph_client_get_origin_metrics(httpmorph_client_t *client,
+                                            httpmorph_origin_metrics_t *origins, int max_origins) nogil
+    void httpmorph_client_reset_metrics(httpmorph_client_t *client) nogil
+    void httpmorph_client_set_tls_fingerprint(httpmorph_client_t *client, bint enabled)
+    void httpmorph_client_set_cache(httpmorph_client_t *client, httpmorph_cache_t *cache)
+    void httpmorph_client_set_proxy_set(httpmorph_client_t *client, httpmorph_proxy_set_t *set)
 
     # Request API
     httpmorph_request_t* httpmorph_request_create(httpmorph_method_t method, const char *url) nogil
+    httpmorph_request_t* httpmorph_request_create_for_client(httpmorph_client_t *client, httpmorph_method_t method, const char *url) nogil
     void httpmorph_request_destroy(httpmorph_request_t *request) nogil
     int httpmorph_request_add_header(httpmorph_request_t *request, const char *key, const char *value) nogil
     int httpmorph_request_set_body(httpmorph_request_t *request, const uint8_t *body, size_t body_len) nogil
+    int httpmorph_request_set_body_file(httpmorph_request_t *request, int fd, uint64_t offset, size_t length) nogil
+    enum: HTTPMORPH_BODY_LENGTH_UNKNOWN
+    ctypedef int64_t (*httpmorph_body_source_t)(uint8_t *buf, size_t len, void *userdata)
+    int httpmorph_request_set_body_source(httpmorph_request_t *request, httpmorph_body_source_t source, void *userdata, int64_t length) nogil
     void httpmorph_request_set_timeout(httpmorph_request_t *request, uint32_t timeout_ms) nogil
     void httpmorph_request_set_proxy(httpmorph_request_t *request, const char *proxy_url, const char *username, const char *password) nogil
     void httpmorph_request_set_http2(httpmorph_request_t *request, bint enabled) nogil
+    void httpmorph_request_set_http2_adaptive_window(httpmorph_request_t *request, bint enabled) nogil
     void httpmorph_request_set_verify_ssl(httpmorph_request_t *request, bint verify) nogil
     void httpmorph_request_set_tls_version(httpmorph_request_t *request, uint16_t min_version, uint16_t max_version) nogil
+    ctypedef int (*httpmorph_body_callback_t)(httpmorph_response *response, const uint8_t *data, size_t len, void *userdata)
+    void httpmorph_request_set_body_callback(httpmorph_request_t *request, httpmorph_body_callback_t callback, void *userdata, size_t chunk_size) nogil
+    void httpmorph_request_set_max_header_size(httpmorph_request_t *request, size_t max_size) nogil
+    void httpmorph_request_set_redirects(httpmorph_request_t *request, bint follow, uint32_t max_redirects) nogil
+    void httpmorph_request_set_zero_rtt(httpmorph_request_t *request, bint early_data, bint tcp_fast_open) nogil
+    void httpmorph_request_set_rotate_fingerprint(httpmorph_request_t *request, bint rotate) nogil
     httpmorph_response* httpmorph_request_execute(httpmorph_client_t *client, const httpmorph_request_t *request, httpmorph_pool_t *pool) nogil
     httpmorph_pool_t* httpmorph_client_get_pool(httpmorph_client_t *client) nogil
 
@@ -129,14 +332,489 @@ cdef extern from "../include/httpmorph.h":
     void httpmorph_session_destroy(httpmorph_session_t *session) nogil
     httpmorph_response* httpmorph_session_request(httpmorph_session_t *session, const httpmorph_request_t *request) nogil
     size_t httpmorph_session_cookie_count(httpmorph_session_t *session) nogil
+    int httpmorph_session_get_tls_session_stats(httpmorph_session_t *session, httpmorph_tls_session_stats_t *stats) nogil
+    int httpmorph_session_get_metrics(httpmorph_session_t *session, httpmorph_metrics_t *metrics) nogil
+    int httpmorph_session_get_origin_metrics(httpmorph_session_t *session,
+                                             httpmorph_origin_metrics_t *origins, int max_origins) nogil
+    void httpmorph_session_reset_metrics(httpmorph_session_t *session) nogil
+    int httpmorph_session_get_alt_svc(httpmorph_session_t *session, const char *url, const char *protocol, char *host, size_t host_size, uint16_t *port) nogil
+    int httpmorph_session_start_pool_maintenance(httpmorph_session_t *session, uint32_t interval_ms) nogil
+    int httpmorph_session_set_min_idle(httpmorph_session_t *session, const char *host, uint16_t port, bint use_tls, int min_idle) nogil
+    void httpmorph_session_set_cache(httpmorph_session_t *session, httpmorph_cache_t *cache)
+    void httpmorph_session_set_proxy_set(httpmorph_session_t *session, httpmorph_proxy_set_t *set)
+
+    # Batch API
+    ctypedef struct httpmorph_batch_t
+    enum: HTTPMORPH_BATCH_TIMEOUT
+    httpmorph_batch_t* httpmorph_batch_start(httpmorph_client_t *client, httpmorph_pool_t *pool, httpmorph_request_t **requests, size_t count, int concurrency) nogil
+    int httpmorph_batch_next(httpmorph_batch_t *batch, uint32_t timeout_ms, httpmorph_response **response) nogil
+    void httpmorph_batch_destroy(httpmorph_batch_t *batch) nogil
+
+    # Preconnect API
+    ctypedef struct httpmorph_preconnect_result_t:
+        int error
+        int connections
+        bint http2
+        bint tls_resumed
+        uint64_t dns_time_us
+        uint64_t connect_time_us
+        uint64_t tls_time_us
+        uint64_t total_time_us
+    int httpmorph_session_preconnect(httpmorph_session_t *session, const char **urls, size_t count,
+                                     int per_host, bint http2, bint verify_ssl, uint32_t timeout_ms,
+                                     httpmorph_preconnect_result_t *results) nogil
 
     # Async I/O API
     int httpmorph_pool_get_connection_fd(httpmorph_pool_t *pool, const char *host, uint16_t port) nogil
 
 
+# HTTP/2 session manager (stream queue tests)
+
+cdef extern from "<stdbool.h>":
+    ctypedef bint _c_bool "bool"
+
+cdef extern from "../core/internal/internal.h":
+    int send(int sockfd, const char *buf, int length, int flags) nogil
+    int recv(int sockfd, char *buf, int length, int flags) nogil
+
+cdef extern from "../core/http2_session_manager.h":
+    enum: HTTP2_SESSION_QUEUE_SPILL
+
+    enum:
+        NGHTTP2_FLAG_NONE
+        NGHTTP2_FLAG_END_STREAM
+        NGHTTP2_NV_FLAG_NONE
+        NGHTTP2_DATA
+        NGHTTP2_HEADERS
+        NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS
+        NGHTTP2_ERR_WOULDBLOCK
+        NGHTTP2_ERR_EOF
+
+    ctypedef struct SSL_METHOD
+    ctypedef struct SSL_CTX
+    ctypedef struct SSL
+    const SSL_METHOD *TLS_method() nogil
+    SSL_CTX *SSL_CTX_new(const SSL_METHOD *method) nogil
+    void SSL_CTX_free(SSL_CTX *ctx) nogil
+    SSL *SSL_new(SSL_CTX *ctx) nogil
+    void SSL_free(SSL *ssl) nogil
+
+    ctypedef struct pthread_mutex_t
+    int pthread_mutex_lock(pthread_mutex_t *mutex) nogil
+    int pthread_mutex_unlock(pthread_mutex_t *mutex) nogil
+
+    ctypedef struct nghttp2_session
+    ctypedef struct nghttp2_session_callbacks
+    ctypedef struct nghttp2_data_provider
+
+    ctypedef struct nghttp2_nv:
+        uint8_t *name
+        uint8_t *value
+        size_t namelen
+        size_t valuelen
+        uint8_t flags
+
+    ctypedef struct nghttp2_priority_spec:
+        int32_t weight
+
+    ctypedef struct nghttp2_settings_entry:
+        int32_t settings_id
+        uint32_t value
+
+    ctypedef struct nghttp2_frame_hd:
+        int32_t stream_id
+        uint8_t type
+        uint8_t flags
+
+    ctypedef union nghttp2_frame:
+        nghttp2_frame_hd hd
+
+    ctypedef ssize_t (*nghttp2_send_callback)(nghttp2_session *session, const uint8_t *data, size_t length,
+                                              int flags, void *user_data) noexcept nogil
+    ctypedef ssize_t (*nghttp2_recv_callback)(nghttp2_session *session, uint8_t *buf, size_t length,
+                                              int flags, void *user_data) noexcept nogil
+    ctypedef int (*nghttp2_on_frame_recv_callback)(nghttp2_session *session, const nghttp2_frame *frame,
+                                                   void *user_data) noexcept nogil
+
+    int nghttp2_session_callbacks_new(nghttp2_session_callbacks **callbacks_ptr) nogil
+    void nghttp2_session_callbacks_del(nghttp2_session_callbacks *callbacks) nogil
+    void nghttp2_session_callbacks_set_send_callback(nghttp2_session_callbacks *callbacks,
+                                                     nghttp2_send_callback cb) nogil
+    void nghttp2_session_callbacks_set_recv_callback(nghttp2_session_callbacks *callbacks,
+                                                     nghttp2_recv_callback cb) nogil
+    void nghttp2_session_callbacks_set_on_frame_recv_callback(nghttp2_session_callbacks *callbacks,
+                                                              nghttp2_on_frame_recv_callback cb) nogil
+    int nghttp2_session_client_new(nghttp2_session **session_ptr, const nghttp2_session_callbacks *callbacks,
+                                   void *user_data) nogil
+    int nghttp2_session_server_new(nghttp2_session **session_ptr, const nghttp2_session_callbacks *callbacks,
+                                   void *user_data) nogil
+    void nghttp2_session_del(nghttp2_session *session) nogil
+    int nghttp2_session_send(nghttp2_session *session) nogil
+    ssize_t nghttp2_session_mem_send(nghttp2_session *session, const uint8_t **data_ptr) nogil
+    ssize_t nghttp2_session_mem_recv(nghttp2_session *session, const uint8_t *data, size_t length) nogil
+    uint32_t nghttp2_session_get_remote_settings(nghttp2_session *session, int settings_id) nogil
+    int nghttp2_submit_settings(nghttp2_session *session, uint8_t flags, const nghttp2_settings_entry *iv,
+                                size_t niv) nogil
+    int nghttp2_submit_response(nghttp2_session *session, int32_t stream_id, const nghttp2_nv *nva,
+                                size_t nvlen, const nghttp2_data_provider *data_prd) nogil
+    void nghttp2_priority_spec_init(nghttp2_priority_spec *pri_spec, int32_t stream_id, int32_t weight,
+                                    int exclusive) nogil
+
+    ctypedef void (*http2_stream_complete_cb_t)(void *ctx, int32_t stream_id, _c_bool has_error) noexcept nogil
+
+    ctypedef struct http2_session_manager_t:
+        nghttp2_session *session
+        pthread_mutex_t mutex
+        int queued_stream_count
+        int open_stream_count
+        uint64_t total_streams_queued
+
+    http2_session_manager_t *http2_session_manager_create(nghttp2_session *session,
+                                                          nghttp2_session_callbacks *callbacks,
+                                                          SSL *ssl, int sockfd, void *session_data) nogil
+    void http2_session_manager_destroy(http2_session_manager_t *mgr) nogil
+    int http2_session_manager_start(http2_session_manager_t *mgr) nogil
+    _c_bool http2_session_manager_is_saturated(http2_session_manager_t *mgr) nogil
+    int http2_session_manager_submit_stream(http2_session_manager_t *mgr, void *stream_data,
+                                            const nghttp2_priority_spec *pri_spec, const nghttp2_nv *hdrs,
+                                            size_t hdr_count, nghttp2_data_provider *data_prd,
+                                            http2_stream_complete_cb_t on_complete, void *on_complete_ctx,
+                                            int32_t *stream_id_out) nogil
+    void http2_session_manager_mark_stream_complete(http2_session_manager_t *mgr, int32_t stream_id,
+                                                    _c_bool has_error) nogil
+
+
+# Streaming body delivery
+
+cdef dict _response_head(httpmorph_response *resp):
+    """Status line and headers of a response whose body is still streaming"""
+    headers = {}
+    for i in range(resp.header_count):
+        headers[resp.headers[i].key.decode('latin-1')] = resp.headers[i].value.decode('latin-1')
+    return {
+        'status_code': resp.status_code,
+        'headers': headers,
+        'http_version': resp.http_version,
+    }
+
+
+cdef int _body_trampoline(httpmorph_response *resp, const uint8_t *data, size_t length,
+                          void *userdata) noexcept with gil:
+    """Body callback: forwards the head and each chunk to a Python sink
+
+    The sink's on_head(dict) is called once before any on_chunk(bytes);
+    a negative return value or an exception aborts the transfer.
+    """
+    sink = <object>userdata
+    try:
+        if data is NULL:
+            rc = sink.on_head(_response_head(resp))
+        else:
+            rc = sink.on_chunk(PyBytes_FromStringAndSize(<const char*>data, <Py_ssize_t>length))
+    except BaseException as e:
+        sink.exception = e
+        return -1
+    return <int>rc if rc else 0
+
+
+cdef int64_t _body_source_trampoline(uint8_t *buf, size_t length, void *userdata) noexcept with gil:
+    """Body source: copies the next piece of a streamed request body into buf
+
+    The source's read(n) returns at most n bytes, b"" at the end of the
+    body; an exception aborts the request.
+    """
+    source = <object>userdata
+    cdef const uint8_t[:] view
+    try:
+        data = source.read(length)
+        view = memoryview(data).cast('B')
+    except BaseException as e:
+        source.exception = e
+        return -1
+    if <size_t>view.shape[0] > length:
+        return -1
+    if view.shape[0]:
+        memcpy(buf, &view[0], view.shape[0])
+    return view.shape[0]
+
+
+# Request construction
+
+cdef int _set_body_stream(httpmorph_request_t *req, dict kwargs) except -1:
+    """Attach a file range (body_file) or a streaming source (body_source)
+
+    Both stay referenced from kwargs for as long as the request runs.
+    """
+    cdef int rc = 0
+    body_file = kwargs.get('body_file')
+    body_source = kwargs.get('body_source')
+    if body_file is not None:
+        rc = httpmorph_request_set_body_file(req, body_file[0], body_file[1], body_file[2])
+    elif body_source is not None:
+        length = kwargs.get('body_length')
+        rc = httpmorph_request_set_body_source(
+            req, _body_source_trampoline, <void*>body_source,
+            HTTPMORPH_BODY_LENGTH_UNKNOWN if length is None else length)
+    if rc != 0:
+        raise ValueError("Invalid streamed request body")
+    return 0
+
+
+cdef _raise_body_error(httpmorph_response *resp, dict kwargs):
+    """Re-raise an exception the body source hit, freeing the response"""
+    source = kwargs.get('body_source')
+    error = getattr(source, 'exception', None)
+    if error is not None:
+        httpmorph_response_destroy(resp)
+        raise error
+
+
+cdef int _fill_request(httpmorph_request_t *req, list headers, bytes body) except -1:
+    """Copy encoded headers and the body into the request with the GIL released
+
+    headers is a flat [key, value, ...] list of bytes; it and body keep the
+    buffers alive while the copies run.
+    """
+    cdef Py_ssize_t count = len(headers)
+    cdef Py_ssize_t i
+    cdef bytes field
+    cdef const char **fields = NULL
+    cdef const uint8_t *body_ptr = NULL
+    cdef size_t body_len = 0
+
+    if count:
+        fields = <const char**>malloc(count * sizeof(const char*))
+        if fields is NULL:
+            raise MemoryError("Failed to build request headers")
+        for i in range(count):
+            field = headers[i]
+            fields[i] = field
+    if body:
+        body_ptr = <const uint8_t*>body
+        body_len = len(body)
+
+    with nogil:
+        i = 0
+        while i + 1 < count:
+            httpmorph_request_add_header(req, fields[i], fields[i + 1])
+            i += 2
+        if body_len:
+            httpmorph_request_set_body(req, body_ptr, body_len)
+
+    free(fields)
+    return 0
+
+
+# Response bodies
+
+cdef class ResponseBody:
+    """Response body exposed through the buffer protocol without copying
+
+    Owns the C response; the pooled body buffer goes back to the client's
+    buffer pool once this object (and every view of it) is released.
+    """
+    cdef httpmorph_response *_resp
+    cdef object _owner  # Client or Session whose buffer pool holds the body
+
+    def __len__(self):
+        return <Py_ssize_t>self._resp.body_len
+
+    def __getbuffer__(self, Py_buffer *buffer, int flags):
+        PyBuffer_FillInfo(buffer, self, <void*>self._resp.body,
+                          <Py_ssize_t>self._resp.body_len, 1, flags)
+
+    def __releasebuffer__(self, Py_buffer *buffer):
+        pass
+
+    def __bytes__(self):
+        return PyBytes_FromStringAndSize(<char*>self._resp.body, <Py_ssize_t>self._resp.body_len)
+
+    def __dealloc__(self):
+        if self._resp is not NULL:
+            httpmorph_response_destroy(self._resp)
+
+
+cdef ResponseBody _take_body(httpmorph_response *resp, object owner):
+    """Wrap a response's body, taking ownership of the response (None if empty)"""
+    if resp.body is NULL or resp.body_len == 0:
+        return None
+    cdef ResponseBody body = ResponseBody.__new__(ResponseBody)
+    body._resp = resp
+    body._owner = owner
+    return body
+
+
+# TLS version, cipher and JA3 strings are owned by the library for the life
+# of the process, so each one is decoded once and shared by every response
+cdef dict _tls_strings = {}
+
+cdef object _tls_str(const char *s):
+    if s is NULL:
+        return None
+    cdef size_t key = <size_t>s
+    value = _tls_strings.get(key)
+    if value is None:
+        value = s.decode('utf-8')
+        _tls_strings[key] = value
+    return value
+
+
+# Header dicts of stored responses by cache entry id (dropped wholesale when full)
+cdef dict _cached_heads = {}
+cdef size_t _CACHED_HEADS_MAX = 1024
+
+_CACHE_STATUS_NAMES = {
+    HTTPMORPH_CACHE_NONE: None,
+    HTTPMORPH_CACHE_MISS: 'miss',
+    HTTPMORPH_CACHE_HIT: 'hit',
+    HTTPMORPH_CACHE_REVALIDATED: 'revalidated',
+}
+
+
 # Python classes
 
 # Simple cookie jar wrapper
+cdef dict _response_to_dict(httpmorph_response *resp, object owner, dict request_headers):
+    """Convert a finished response to the result dict (takes ownership of resp)"""
+    # Earlier hops of a followed redirect, oldest first; detached so each
+    # hop's body can outlive the others
+    cdef httpmorph_response *hop = resp.redirect_from
+    cdef httpmorph_response *hop_from
+    resp.redirect_from = NULL
+    history = []
+    while hop is not NULL:
+        hop_from = hop.redirect_from
+        hop.redirect_from = NULL
+        history.append(_response_to_dict(hop, owner, request_headers))
+        hop = hop_from
+    history.reverse()
+
+    # Hand the body over without copying; it keeps the response alive
+    body_obj = _take_body(resp, owner)
+
+    result = {
+        'status_code': resp.status_code,
+        'headers': {},
+        'body': body_obj if body_obj is not None else b'',
+        'http_version': resp.http_version,
+        'queue_time_us': resp.queue_time_us,
+        'dns_time_us': resp.dns_time_us,
+        'connect_time_us': resp.connect_time_us,
+        'tls_time_us': resp.tls_time_us,
+        'first_byte_time_us': resp.first_byte_time_us,
+        'total_time_us': resp.total_time_us,
+        'connection_reused': resp.connection_reused,
+        'tls_resumed': resp.tls_resumed,
+        'body_wire_len': resp.body_wire_len,
+        'http2_rtt_us': resp.http2_rtt_us,
+        'http2_window_size': resp.http2_window_size,
+        'cache_status': _CACHE_STATUS_NAMES.get(resp.cache_status),
+        'tls_version': _tls_str(resp.tls_version),
+        'tls_cipher': _tls_str(resp.tls_cipher),
+        'ja3_fingerprint': _tls_str(resp.ja3_fingerprint),
+        'error': resp.error,
+        'error_message': resp.error_message.decode('utf-8') if resp.error_message else None,
+        'request_headers': request_headers,
+        'url': resp.url.decode('utf-8') if resp.url else None,
+        'history': history,
+    }
+
+    # Stored responses are served with the same headers every time (apart
+    # from Age), so a hit copies the dict built the first time
+    cdef const char *age
+    cached_headers = _cached_heads.get(resp.cache_entry_id) if resp.cache_entry_id else None
+    if cached_headers is not None:
+        headers = dict(cached_headers)
+        age = httpmorph_response_get_header(resp, "Age")
+        if age is not NULL:
+            headers['Age'] = age.decode('latin-1')
+        result['headers'] = headers
+    else:
+        # Convert headers (use latin-1 per HTTP spec, fallback to utf-8)
+        for i in range(resp.header_count):
+            key = resp.headers[i].key.decode('latin-1')
+            try:
+                value = resp.headers[i].value.decode('latin-1')
+            except:
+                value = resp.headers[i].value.decode('utf-8', errors='replace')
+            result['headers'][key] = value
+        if resp.cache_entry_id:
+            if len(_cached_heads) >= _CACHED_HEADS_MAX:
+                _cached_heads.clear()
+            _cached_heads[resp.cache_entry_id] = dict(result['headers'])
+
+    # Cleanup response (unless its body is still in use)
+    if body_obj is None:
+        httpmorph_response_destroy(resp)
+
+    return result
+
+
+cdef dict _tls_session_stats_to_dict(httpmorph_tls_session_stats_t *stats):
+    return {
+        'hits': stats.hits,
+        'misses': stats.misses,
+        'stores': stats.stores,
+        'evictions': stats.evictions,
+        'expirations': stats.expirations,
+        'resumptions': stats.resumptions,
+        'entries': stats.entries,
+    }
+
+
+cdef dict _metrics_to_dict(httpmorph_metrics_t *metrics):
+    return {
+        'requests': metrics.requests,
+        'errors': metrics.errors,
+        'connections_opened': metrics.connections_opened,
+        'connections_reused': metrics.connections_reused,
+        'tls_handshakes': metrics.tls_handshakes,
+        'tls_resumed': metrics.tls_resumed,
+        'http2_streams': metrics.http2_streams,
+        'body_wire_bytes': metrics.body_wire_bytes,
+        'body_bytes': metrics.body_bytes,
+        'pool_idle': metrics.pool_idle,
+        'pool_active': metrics.pool_active,
+    }
+
+
+cdef dict _preconnect_result_to_dict(httpmorph_preconnect_result_t *result):
+    return {
+        'ok': result.connections > 0,
+        'error': result.error,
+        'connections': result.connections,
+        'http2': result.http2,
+        'tls_resumed': result.tls_resumed,
+        'dns_us': result.dns_time_us,
+        'connect_us': result.connect_time_us,
+        'tls_us': result.tls_time_us,
+        'total_us': result.total_time_us,
+    }
+
+
+cdef list _origin_metrics_to_list(httpmorph_origin_metrics_t *origins, int count):
+    cdef int i
+    result = []
+    for i in range(min(count, HTTPMORPH_MAX_METRICS_ORIGINS)):
+        result.append({
+            'origin': origins[i].origin.decode('utf-8', 'replace'),
+            'requests': origins[i].requests,
+            'errors': origins[i].errors,
+            'p50_us': origins[i].p50_us,
+            'p90_us': origins[i].p90_us,
+            'p99_us': origins[i].p99_us,
+            'p999_us': origins[i].p999_us,
+            'max_us': origins[i].max_us,
+            'total_us': origins[i].total_us,
+            'queue_us': origins[i].queue_us,
+            'dns_us': origins[i].dns_us,
+            'connect_us': origins[i].connect_us,
+            'tls_us': origins[i].tls_us,
+            'first_byte_us': origins[i].first_byte_us,
+        })
+    return result
+
+
 class CookieJar:
     """Simulates a cookie jar with length"""
     def __init__(self, count):
@@ -149,6 +827,139 @@ class CookieJar:
         return f"<CookieJar with {self._count} cookies>"
 
 
+cdef class Cache:
+    """HTTP response cache (RFC 9111) shared by the clients and sessions using it"""
+    cdef httpmorph_cache_t *_cache
+
+    def __cinit__(self, size_t max_memory=0, spill_dir=None, size_t spill_threshold=0,
+                  size_t max_disk=0):
+        cdef httpmorph_cache_config_t config
+        config.max_memory = max_memory
+        config.spill_threshold = spill_threshold
+        config.max_disk = max_disk
+        config.spill_dir = NULL
+        spill_bytes = None
+        if spill_dir is not None:
+            spill_bytes = str(spill_dir).encode('utf-8')
+            config.spill_dir = spill_bytes
+        self._cache = httpmorph_cache_create(&config)
+        if self._cache is NULL:
+            raise MemoryError("Failed to create HTTP cache")
+
+    def __dealloc__(self):
+        if self._cache is not NULL:
+            httpmorph_cache_destroy(self._cache)
+
+    def clear(self):
+        """Drop every stored response"""
+        with nogil:
+            httpmorph_cache_clear(self._cache)
+
+    def stats(self):
+        """Get cache statistics
+
+        Returns:
+            dict with hits, misses, revalidations, stores, evictions,
+            invalidations, entries, memory_bytes and disk_bytes
+        """
+        cdef httpmorph_cache_stats_t stats
+        if httpmorph_cache_get_stats(self._cache, &stats) != 0:
+            return None
+        return {
+            'hits': stats.hits,
+            'misses': stats.misses,
+            'revalidations': stats.revalidations,
+            'stores': stats.stores,
+            'evictions': stats.evictions,
+            'invalidations': stats.invalidations,
+            'entries': stats.entries,
+            'memory_bytes': stats.memory_bytes,
+            'disk_bytes': stats.disk_bytes,
+        }
+
+
+cdef httpmorph_cache_t* _cache_ptr(cache) except? NULL:
+    if cache is None:
+        return NULL
+    if not isinstance(cache, Cache):
+        raise TypeError("cache must be a Cache or None")
+    return (<Cache>cache)._cache
+
+
+cdef class ProxySet:
+    """Proxies to rotate through, weighted by health, shared by the clients and sessions using it"""
+    cdef httpmorph_proxy_set_t *_set
+
+    def __cinit__(self, proxies=None, uint32_t eject_failures=0, float eject_for=0,
+                  bint sticky_hosts=False):
+        cdef httpmorph_proxy_set_config_t config
+        config.eject_failures = eject_failures
+        config.eject_ms = <uint32_t>(eject_for * 1000)
+        config.sticky_hosts = sticky_hosts
+        self._set = httpmorph_proxy_set_create(&config)
+        if self._set is NULL:
+            raise MemoryError("Failed to create proxy set")
+        for proxy in proxies or ():
+            if isinstance(proxy, (tuple, list)):
+                self.add(*proxy)
+            else:
+                self.add(proxy)
+
+    def __dealloc__(self):
+        if self._set is not NULL:
+            httpmorph_proxy_set_destroy(self._set)
+
+    def __len__(self):
+        return httpmorph_proxy_set_count(self._set)
+
+    def add(self, url, username=None, password=None):
+        """Add a proxy (an existing one keeps its health and takes the new credentials)"""
+        url_bytes = url.encode('utf-8')
+        user_bytes = username.encode('utf-8') if username is not None else None
+        pass_bytes = password.encode('utf-8') if password is not None else None
+        cdef const char *user_ptr = NULL
+        cdef const char *pass_ptr = NULL
+        if user_bytes is not None:
+            user_ptr = user_bytes
+        if pass_bytes is not None:
+            pass_ptr = pass_bytes
+        if httpmorph_proxy_set_add(self._set, url_bytes, user_ptr, pass_ptr) != 0:
+            raise MemoryError("Failed to add proxy")
+
+    def remove(self, url):
+        """Remove a proxy (requests already using it finish normally)"""
+        if httpmorph_proxy_set_remove(self._set, url.encode('utf-8')) != 0:
+            raise KeyError(url)
+
+    def stats(self, url):
+        """Get the health of one proxy
+
+        Returns:
+            dict with requests, failures, ejections, latency (seconds, None
+            until measured), error_rate, ejected and ejected_for (seconds)
+        """
+        cdef httpmorph_proxy_stats_t stats
+        if httpmorph_proxy_set_get_stats(self._set, url.encode('utf-8'), &stats) != 0:
+            raise KeyError(url)
+        return {
+            'requests': stats.requests,
+            'failures': stats.failures,
+            'ejections': stats.ejections,
+            'latency': stats.latency_us / 1e6 if stats.latency_us > 0 else None,
+            'error_rate': stats.error_rate,
+            'ejected': stats.ejected,
+            'ejected_for': stats.ejected_ms_left / 1000.0,
+        }
+
+
+cdef httpmorph_proxy_set_t* _proxy_set_ptr(proxy_set) except? NULL:
+    if proxy_set is None:
+        return NULL
+    if not isinstance(proxy_set, ProxySet):
+        raise TypeError("proxy_set must be a ProxySet or None")
+    return (<ProxySet>proxy_set)._set
+
+
 cdef class Client:
     """High-performance HTTP client with anti-fingerprinting"""
     cdef httpmorph_client_t *_client
@@ -175,25 +986,16 @@ cdef class Client:
         cdef int result = httpmorph_client_load_ca_file(self._client, ca_file_bytes)
         return result == 0
 
-    def request(self, str method, str url, dict headers=None, bytes body=None, **kwargs):
-        """Execute an HTTP request
+    cdef httpmorph_request_t* _build_request(self, str method, str url, dict headers, bytes body,
+                                             dict kwargs, dict request_headers) except NULL:
+        """Create a C request from request() arguments
 
-        Args:
-            method: HTTP method (GET, POST, etc.)
-            url: URL to request
-            headers: Optional dict of headers
-            body: Optional request body
-            **kwargs: Optional parameters including:
-                - timeout: Timeout in seconds (default: 30)
-                - proxy: Proxy URL or dict
-                - proxy_auth: (username, password) tuple
+        request_headers receives the headers the request will be sent with.
         """
         cdef httpmorph_method_t c_method
         cdef httpmorph_request_t *req
-        cdef httpmorph_response *resp
         cdef const char* c_username
         cdef const char* c_password
-        cdef httpmorph_pool_t* client_pool
 
         # Convert method string to enum
         method_upper = method.upper()
@@ -216,11 +1018,10 @@ cdef class Client:
 
         # Create request
         url_bytes = url.encode('utf-8')
-        req = httpmorph_request_create(c_method, url_bytes)
+        req = httpmorph_request_create_for_client(self._client, c_method, url_bytes)
         if req is NULL:
             raise MemoryError("Failed to create request")
 
-        cdef bytes body_bytes = b''
         try:
             # Set timeout if provided (default is 30 seconds in C code)
             timeout = kwargs.get('timeout')
@@ -233,6 +1034,28 @@ cdef class Client:
             http2 = kwargs.get('http2', True)
             httpmorph_request_set_http2(req, http2)
 
+            # Grow HTTP/2 flow-control windows from BDP estimates (opt-in)
+            if kwargs.get('http2_adaptive_window'):
+                httpmorph_request_set_http2_adaptive_window(req, True)
+
+            # Cap on the HTTP/1.x response head (default 256 KB)
+            max_header_size = kwargs.get('max_header_size')
+            if max_header_size:
+                httpmorph_request_set_max_header_size(req, max_header_size)
+
+            # Follow redirects in C (max_redirects hops, default 10)
+            if kwargs.get('follow_redirects'):
+                httpmorph_request_set_redirects(req, True, kwargs.get('max_redirects', 10))
+
+            # 0-RTT setup to known origins, where the browser profile does it too
+            if kwargs.get('early_data') or kwargs.get('tcp_fast_open'):
+                httpmorph_request_set_zero_rtt(req, bool(kwargs.get('early_data')),
+                                               bool(kwargs.get('tcp_fast_open')))
+
+            # Pick a fingerprint variant per connection
+            if kwargs.get('rotate_fingerprint'):
+                httpmorph_request_set_rotate_fingerprint(req, True)
+
             # Set SSL verification (default is True)
             verify_ssl = kwargs.get('verify', kwargs.get('verify_ssl', True))
             httpmorph_request_set_verify_ssl(req, verify_ssl)
@@ -284,16 +1107,18 @@ cdef class Client:
                     httpmorph_request_set_proxy(req, <const char*>proxy_bytes, c_username, c_password)
 
             # Build request headers dict for tracking
-            request_headers = {}
             if headers:
                 request_headers.update(headers)
 
+            # Encoded headers, copied into the request without the GIL
+            header_fields = []
+
             # Add default headers that will be added by C code if not present
             if 'User-Agent' not in request_headers:
                 # Use Chrome 142 User-Agent by default
                 request_headers['User-Agent'] = 'Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/142.0.0.0 Safari/537.36'
                 # Add the User-Agent header to the C request
-                httpmorph_request_add_header(req, b'User-Agent', request_headers['User-Agent'].encode('utf-8'))
+                header_fields += (b'User-Agent', request_headers['User-Agent'].encode('utf-8'))
             if 'Accept' not in request_headers:
                 request_headers['Accept'] = '*/*'
             if 'Connection' not in request_headers:
@@ -302,61 +1127,139 @@ cdef class Client:
             # Add headers
             if headers:
                 for key, value in headers.items():
-                    key_bytes = key.encode('utf-8')
-                    value_bytes = value.encode('utf-8')
-                    httpmorph_request_add_header(req, key_bytes, value_bytes)
+                    header_fields += (key.encode('utf-8'), value.encode('utf-8'))
 
-            # Set body if present
-            if body:
-                httpmorph_request_set_body(req, <const uint8_t*>body, len(body))
+            # Set headers and body (if present)
+            _fill_request(req, header_fields, body)
+        except BaseException:
+            httpmorph_request_destroy(req)
+            raise
+        return req
 
+    def request(self, str method, str url, dict headers=None, bytes body=None, **kwargs):
+        """Execute an HTTP request
+
+        Args:
+            method: HTTP method (GET, POST, etc.)
+            url: URL to request
+            headers: Optional dict of headers
+            body: Optional request body
+            **kwargs: Optional parameters including:
+                - timeout: Timeout in seconds (default: 30)
+                - proxy: Proxy URL or dict
+                - proxy_auth: (username, password) tuple
+                - body_sink: Object with on_head(dict)/on_chunk(bytes) that
+                  receives the body as it arrives (result body is then empty)
+                - chunk_size: Maximum bytes per on_chunk() call
+                - body_file: (fd, offset, length) to send a file range as the body
+                - body_source: Object whose read(n) streams the body
+                - body_length: Length of body_source (None sends it chunked)
+                - follow_redirects: Follow redirects in C (result gets
+                  'url' and 'history'); max_redirects caps the hops
+                - early_data, tcp_fast_open: Save round trips to origins seen
+                  before (see httpmorph_request_set_zero_rtt())
+                - rotate_fingerprint: Pick one of the browser profile's cached
+                  fingerprint variants per connection
+        """
+        cdef httpmorph_request_t *req
+        cdef httpmorph_response *resp
+        cdef httpmorph_pool_t* client_pool
+
+        request_headers = {}
+        req = self._build_request(method, url, headers, body, kwargs, request_headers)
+
+        try:
             # Execute request (release GIL to allow other Python threads to run)
             # Use client's connection pool for reuse
             client_pool = httpmorph_client_get_pool(self._client)
+
+            # Stream the body to the sink (kept alive by this frame)
+            body_sink = kwargs.get('body_sink')
+            if body_sink is not None:
+                httpmorph_request_set_body_callback(req, _body_trampoline, <void*>body_sink,
+                                                    kwargs.get('chunk_size') or 0)
+
+            # Stream the request body from a file or source
+            _set_body_stream(req, kwargs)
+
             with nogil:
                 resp = httpmorph_request_execute(self._client, req, client_pool)
             if resp is NULL:
                 raise RuntimeError("Failed to execute request")
+            _raise_body_error(resp, kwargs)
 
-            # Copy body BEFORE destroying response (important for memory safety)
-            body_bytes = b''
-            if resp.body and resp.body_len > 0:
-                body_bytes = PyBytes_FromStringAndSize(<char*>resp.body, <Py_ssize_t>resp.body_len)
-
-            # Convert response to Python dict
-            result = {
-                'status_code': resp.status_code,
-                'headers': {},
-                'body': body_bytes,
-                'http_version': resp.http_version,
-                'connect_time_us': resp.connect_time_us,
-                'tls_time_us': resp.tls_time_us,
-                'first_byte_time_us': resp.first_byte_time_us,
-                'total_time_us': resp.total_time_us,
-                'tls_version': resp.tls_version.decode('utf-8') if resp.tls_version else None,
-                'tls_cipher': resp.tls_cipher.decode('utf-8') if resp.tls_cipher else None,
-                'ja3_fingerprint': resp.ja3_fingerprint.decode('utf-8') if resp.ja3_fingerprint else None,
-                'error': resp.error,
-                'error_message': resp.error_message.decode('utf-8') if resp.error_message else None,
-                'request_headers': request_headers,
-            }
+            return _response_to_dict(resp, self, request_headers)
 
-            # Convert headers (use latin-1 per HTTP spec, fallback to utf-8)
-            for i in range(resp.header_count):
-                key = resp.headers[i].key.decode('latin-1')
-                try:
-                    value = resp.headers[i].value.decode('latin-1')
-                except:
-                    value = resp.headers[i].value.decode('utf-8', errors='replace')
-                result['headers'][key] = value
+        finally:
+            httpmorph_request_destroy(req)
 
-            # Cleanup response
-            httpmorph_response_destroy(resp)
+    def request_many(self, list requests, int concurrency=0):
+        """Execute many requests from one call, yielding results as they finish
 
-            return result
+        The batch runs on C worker threads over the client's connection
+        pool; HTTPS requests to one origin share an HTTP/2 connection.
+
+        Args:
+            requests: List of (method, url, headers, body, kwargs) tuples
+            concurrency: Maximum requests in flight (0 for the C default)
+
+        Yields:
+            (index, result) pairs in completion order; result is the dict
+            request() returns, or None if the request could not be run
+        """
+        cdef Py_ssize_t count = len(requests)
+        cdef Py_ssize_t built = 0
+        cdef Py_ssize_t i
+        cdef int index
+        cdef httpmorph_request_t **reqs = NULL
+        cdef httpmorph_batch_t *batch = NULL
+        cdef httpmorph_response *resp = NULL
+        cdef httpmorph_pool_t *client_pool = httpmorph_client_get_pool(self._client)
+
+        if count == 0:
+            return
+
+        reqs = <httpmorph_request_t**>calloc(count, sizeof(httpmorph_request_t*))
+        if reqs is NULL:
+            raise MemoryError("Failed to create batch")
+
+        try:
+            # Build every request up front; the C side never touches Python objects
+            all_request_headers = []
+            for method, url, headers, body, kwargs in requests:
+                if kwargs.get('body_sink') is not None:
+                    raise ValueError("body_sink is not supported by request_many()")
+                request_headers = {}
+                reqs[built] = self._build_request(method, url, headers, body, kwargs, request_headers)
+                built += 1
+                all_request_headers.append(request_headers)
+
+            with nogil:
+                batch = httpmorph_batch_start(self._client, client_pool, reqs, <size_t>count, concurrency)
+            if batch is NULL:
+                raise RuntimeError("Failed to start batch")
+
+            while True:
+                # Wake up periodically so Ctrl-C is not held off by a slow batch
+                with nogil:
+                    index = httpmorph_batch_next(batch, 100, &resp)
+                if index == HTTPMORPH_BATCH_TIMEOUT:
+                    PyErr_CheckSignals()
+                    continue
+                if index < 0:
+                    break
+                if resp is NULL:
+                    yield index, None
+                else:
+                    yield index, _response_to_dict(resp, self, all_request_headers[index])
 
         finally:
-            httpmorph_request_destroy(req)
+            if batch is not NULL:
+                with nogil:
+                    httpmorph_batch_destroy(batch)
+            for i in range(built):
+                httpmorph_request_destroy(reqs[i])
+            free(reqs)
 
     def get_connection_fd(self, str host, int port):
         """Get file descriptor from connection pool for event loop integration
@@ -369,7 +1272,7 @@ cdef class Client:
             port: Target port number
 
         Returns:
-            int: File descriptor (>= 0) on success, -1 if no active connection found
+            int: File descriptor (>= 0) on success, -1 if no pooled connection found
 
         Example:
             >>> client = Client()
@@ -386,6 +1289,148 @@ cdef class Client:
         cdef int fd = httpmorph_pool_get_connection_fd(pool, <const char*>host_bytes, port)
         return fd
 
+    def tls_session_stats(self):
+        """Get TLS session resumption cache statistics
+
+        Returns:
+            dict with hits, misses, stores, evictions, expirations,
+            resumptions and entries
+        """
+        cdef httpmorph_tls_session_stats_t stats
+        if httpmorph_client_get_tls_session_stats(self._client, &stats) != 0:
+            return None
+        return _tls_session_stats_to_dict(&stats)
+
+    def clear_tls_sessions(self):
+        """Drop all cached TLS sessions (forces full handshakes)"""
+        httpmorph_client_clear_tls_sessions(self._client)
+
+    def alt_svc(self, url, protocol="h3"):
+        """Get the alternative service an origin advertised for a protocol
+
+        Returns:
+            (host, port) tuple (host is "" for the origin's own), or None
+        """
+        url_bytes = url.encode('utf-8')
+        protocol_bytes = protocol.encode('utf-8')
+        cdef char host[256]
+        cdef uint16_t port = 0
+        if httpmorph_client_get_alt_svc(self._client, url_bytes, protocol_bytes, host, sizeof(host), &port) != 0:
+            return None
+        return (host.decode('utf-8'), port)
+
+    def clear_alt_svc(self):
+        """Forget all advertised alternative services"""
+        httpmorph_client_clear_alt_svc(self._client)
+
+    def allow_pipelining(self, url, uint32_t depth=8):
+        """Pipeline batched HTTP/1.1 requests to an origin (depth 0 stops it)"""
+        url_bytes = url.encode('utf-8')
+        return httpmorph_client_allow_pipelining(self._client, url_bytes, depth) == 0
+
+    def enable_request_arenas(self, int max_cached=64):
+        """Allocate each request and its response from a recycled arena
+
+        Args:
+            max_cached: Reset arenas kept for reuse (0 disables arenas)
+
+        Returns:
+            True on success, False on failure
+        """
+        if max_cached < 0:
+            raise ValueError("max_cached must be >= 0")
+        return httpmorph_client_enable_request_arenas(self._client, max_cached) == 0
+
+    def arena_stats(self):
+        """Get request arena statistics
+
+        Returns:
+            dict with reused, created and cached, or None if arenas are disabled
+        """
+        cdef httpmorph_arena_stats_t stats
+        if httpmorph_client_get_arena_stats(self._client, &stats) != 0:
+            return None
+        return {
+            'reused': stats.reused,
+            'created': stats.created,
+            'cached': stats.cached,
+        }
+
+    def buffer_pool_stats(self):
+        """Get response buffer pool statistics
+
+        Returns:
+            list with a dict per tier (buffer_size, mmap_backed, hits,
+            magazine_hits, misses, returns and pooled)
+        """
+        cdef httpmorph_buffer_tier_stats_t stats[16]
+        cdef int count
+        cdef int i
+        with nogil:
+            count = httpmorph_client_get_buffer_pool_stats(self._client, stats, 16)
+        if count < 0:
+            return None
+        tiers = []
+        for i in range(min(count, 16)):
+            tiers.append({
+                'buffer_size': stats[i].buffer_size,
+                'mmap_backed': stats[i].mmap_backed,
+                'hits': stats[i].hits,
+                'magazine_hits': stats[i].magazine_hits,
+                'misses': stats[i].misses,
+                'returns': stats[i].returns,
+                'pooled': stats[i].pooled,
+            })
+        return tiers
+
+    def metrics(self):
+        """Get client-wide request metrics
+
+        Returns:
+            dict with requests, errors, connections_opened,
+            connections_reused, tls_handshakes, tls_resumed, http2_streams,
+            body_wire_bytes, body_bytes, pool_idle and pool_active
+        """
+        cdef httpmorph_metrics_t metrics
+        if httpmorph_client_get_metrics(self._client, &metrics) != 0:
+            return None
+        return _metrics_to_dict(&metrics)
+
+    def origin_metrics(self):
+        """Get request metrics per origin (latency percentiles and phase sums)
+
+        Returns:
+            list with a dict per origin, in the order they were first seen
+        """
+        cdef httpmorph_origin_metrics_t *origins = <httpmorph_origin_metrics_t *>malloc(
+            HTTPMORPH_MAX_METRICS_ORIGINS * sizeof(httpmorph_origin_metrics_t))
+        cdef int count
+        if origins is NULL:
+            raise MemoryError()
+        try:
+            with nogil:
+                count = httpmorph_client_get_origin_metrics(self._client, origins,
+                                                            HTTPMORPH_MAX_METRICS_ORIGINS)
+            return _origin_metrics_to_list(origins, count) if count >= 0 else None
+        finally:
+            free(origins)
+
+    def reset_metrics(self):
+        """Zero the request metrics"""
+        httpmorph_client_reset_metrics(self._client)
+
+    def set_tls_fingerprint(self, bint enabled):
+        """Compute the JA3 fingerprint of new TLS connections (on by default)"""
+        httpmorph_client_set_tls_fingerprint(self._client, enabled)
+
+    def set_cache(self, cache):
+        """Answer GET requests from a Cache when possible (None detaches it)"""
+        httpmorph_client_set_cache(self._client, _cache_ptr(cache))
+
+    def set_proxy_set(self, proxy_set):
+        """Route requests without their own proxy through a ProxySet (None detaches it)"""
+        httpmorph_client_set_proxy_set(self._client, _proxy_set_ptr(proxy_set))
+
 
 cdef class Session:
     """HTTP session with persistent fingerprint"""
@@ -440,6 +1485,161 @@ cdef class Session:
         # Return a list-like object with length for compatibility
         return CookieJar(count)
 
+    def tls_session_stats(self):
+        """Get TLS session resumption cache statistics
+
+        Returns:
+            dict with hits, misses, stores, evictions, expirations,
+            resumptions and entries
+        """
+        cdef httpmorph_tls_session_stats_t stats
+        if self._session is NULL:
+            return None
+        if httpmorph_session_get_tls_session_stats(self._session, &stats) != 0:
+            return None
+        return _tls_session_stats_to_dict(&stats)
+
+    def metrics(self):
+        """Get request metrics, with the session's connection pool occupancy"""
+        cdef httpmorph_metrics_t metrics
+        if self._session is NULL:
+            return None
+        if httpmorph_session_get_metrics(self._session, &metrics) != 0:
+            return None
+        return _metrics_to_dict(&metrics)
+
+    def origin_metrics(self):
+        """Get request metrics per origin"""
+        if self._session is NULL:
+            return None
+        cdef httpmorph_origin_metrics_t *origins = <httpmorph_origin_metrics_t *>malloc(
+            HTTPMORPH_MAX_METRICS_ORIGINS * sizeof(httpmorph_origin_metrics_t))
+        cdef int count
+        if origins is NULL:
+            raise MemoryError()
+        try:
+            with nogil:
+                count = httpmorph_session_get_origin_metrics(self._session, origins,
+                                                             HTTPMORPH_MAX_METRICS_ORIGINS)
+            return _origin_metrics_to_list(origins, count) if count >= 0 else None
+        finally:
+            free(origins)
+
+    def reset_metrics(self):
+        """Zero the request metrics"""
+        if self._session is not NULL:
+            httpmorph_session_reset_metrics(self._session)
+
+    def alt_svc(self, url, protocol="h3"):
+        """Get the alternative service an origin advertised for a protocol
+
+        Returns:
+            (host, port) tuple (host is "" for the origin's own), or None
+        """
+        if self._session is NULL:
+            return None
+        url_bytes = url.encode('utf-8')
+        protocol_bytes = protocol.encode('utf-8')
+        cdef char host[256]
+        cdef uint16_t port = 0
+        if httpmorph_session_get_alt_svc(self._session, url_bytes, protocol_bytes, host, sizeof(host), &port) != 0:
+            return None
+        return (host.decode('utf-8'), port)
+
+    def set_cache(self, cache):
+        """Answer GET requests from a Cache when possible (None detaches it)"""
+        if self._session is not NULL:
+            httpmorph_session_set_cache(self._session, _cache_ptr(cache))
+
+    def set_proxy_set(self, proxy_set):
+        """Route requests without their own proxy through a ProxySet (None detaches it)"""
+        if self._session is not NULL:
+            httpmorph_session_set_proxy_set(self._session, _proxy_set_ptr(proxy_set))
+
+    def start_pool_maintenance(self, float interval=1.0):
+        """Start background maintenance of pooled connections
+
+        Reaps idle-expired and peer-closed connections off the request path
+        and refills hosts registered with set_min_idle().
+
+        Args:
+            interval: Maintenance period in seconds
+
+        Returns:
+            True on success, False if already running or on failure
+        """
+        if self._session is NULL:
+            return False
+        cdef uint32_t interval_ms = <uint32_t>(interval * 1000) if interval > 0 else 0
+        return httpmorph_session_start_pool_maintenance(self._session, interval_ms) == 0
+
+    def set_min_idle(self, str host, int port, int count, bint tls=True):
+        """Keep at least `count` idle connections open to host:port
+
+        Requires start_pool_maintenance(); count=0 removes the target.
+
+        Returns:
+            True on success, False on failure
+        """
+        if self._session is NULL:
+            return False
+        host_bytes = host.encode('utf-8')
+        return httpmorph_session_set_min_idle(self._session, <const char*>host_bytes, port, tls, count) == 0
+
+    def preconnect(self, list urls, int per_host=1, bint http2=True, bint verify=True, timeout=None):
+        """Open connections to origins before requests need them
+
+        Origins are connected in parallel on C worker threads: DNS, TCP,
+        the TLS handshake with the session's profile and, when negotiated,
+        the HTTP/2 session. Connections land in the session pool.
+
+        Args:
+            urls: URLs whose origins (scheme, host, port) to connect to
+            per_host: Connections per origin (one when HTTP/2 is negotiated)
+            http2: Offer HTTP/2 over TLS
+            verify: Verify certificates
+            timeout: Connect timeout per connection in seconds (None for the client default)
+
+        Returns:
+            List of dicts in urls order with ok, error, connections, http2,
+            tls_resumed and the first connection's dns/connect/tls/total_us
+        """
+        cdef Py_ssize_t count = len(urls)
+        cdef Py_ssize_t i
+        cdef const char **c_urls = NULL
+        cdef httpmorph_preconnect_result_t *results = NULL
+        cdef uint32_t timeout_ms = <uint32_t>(timeout * 1000) if timeout else 0
+        cdef int rc
+
+        if self._session is NULL:
+            raise RuntimeError("Session is closed")
+        if count == 0:
+            return []
+
+        encoded = [url.encode('utf-8') for url in urls]
+        c_urls = <const char**>malloc(count * sizeof(const char*))
+        results = <httpmorph_preconnect_result_t*>calloc(count, sizeof(httpmorph_preconnect_result_t))
+        if c_urls is NULL or results is NULL:
+            free(c_urls)
+            free(results)
+            raise MemoryError("Failed to start preconnect")
+
+        try:
+            for i in range(count):
+                c_urls[i] = <const char*>encoded[i]
+            with nogil:
+                rc = httpmorph_session_preconnect(self._session, c_urls, <size_t>count,
+                                                  per_host, http2, verify, timeout_ms, results)
+            if rc < 0:
+                raise RuntimeError("Failed to preconnect")
+            out = []
+            for i in range(count):
+                out.append(_preconnect_result_to_dict(&results[i]))
+            return out
+        finally:
+            free(c_urls)
+            free(results)
+
     def request(self, str method, str url, **kwargs):
         """Execute an HTTP request within this session
 
@@ -451,6 +1651,18 @@ cdef class Session:
                 - headers: Dict of headers
                 - json: Dict to send as JSON
                 - data/body: Request body
+                - body_sink: Object with on_head(dict)/on_chunk(bytes) that
+                  receives the body as it arrives (result body is then empty)
+                - chunk_size: Maximum bytes per on_chunk() call
+                - body_file: (fd, offset, length) to send a file range as the body
+                - body_source: Object whose read(n) streams the body
+                - body_length: Length of body_source (None sends it chunked)
+                - follow_redirects: Follow redirects in C (result gets
+                  'url' and 'history'); max_redirects caps the hops
+                - early_data, tcp_fast_open: Save round trips to origins seen
+                  before (see httpmorph_request_set_zero_rtt())
+                - rotate_fingerprint: Pick one of the browser profile's cached
+                  fingerprint variants per connection
         """
         cdef httpmorph_method_t c_method
         cdef httpmorph_request_t *req
@@ -483,7 +1695,6 @@ cdef class Session:
         if req is NULL:
             raise MemoryError("Failed to create request")
 
-        cdef bytes body_bytes = b''
         try:
             # Set timeout if provided (default is 30 seconds in C code)
             timeout = kwargs.get('timeout')
@@ -496,6 +1707,28 @@ cdef class Session:
             http2 = kwargs.get('http2', True)
             httpmorph_request_set_http2(req, http2)
 
+            # Grow HTTP/2 flow-control windows from BDP estimates (opt-in)
+            if kwargs.get('http2_adaptive_window'):
+                httpmorph_request_set_http2_adaptive_window(req, True)
+
+            # Cap on the HTTP/1.x response head (default 256 KB)
+            max_header_size = kwargs.get('max_header_size')
+            if max_header_size:
+                httpmorph_request_set_max_header_size(req, max_header_size)
+
+            # Follow redirects in C (max_redirects hops, default 10)
+            if kwargs.get('follow_redirects'):
+                httpmorph_request_set_redirects(req, True, kwargs.get('max_redirects', 10))
+
+            # 0-RTT setup to known origins, where the browser profile does it too
+            if kwargs.get('early_data') or kwargs.get('tcp_fast_open'):
+                httpmorph_request_set_zero_rtt(req, bool(kwargs.get('early_data')),
+                                               bool(kwargs.get('tcp_fast_open')))
+
+            # Pick a fingerprint variant per connection
+            if kwargs.get('rotate_fingerprint'):
+                httpmorph_request_set_rotate_fingerprint(req, True)
+
             # Set SSL verification (default is True)
             verify_ssl = kwargs.get('verify', kwargs.get('verify_ssl', True))
             httpmorph_request_set_verify_ssl(req, verify_ssl)
@@ -546,13 +1779,12 @@ cdef class Session:
 
                     httpmorph_request_set_proxy(req, <const char*>proxy_bytes, c_username, c_password)
 
-            # Add headers
+            # Add headers (encoded here, copied into the request without the GIL)
+            header_fields = []
             headers = kwargs.get('headers')
             if headers:
                 for key, value in headers.items():
-                    key_bytes = key.encode('utf-8')
-                    value_bytes = value.encode('utf-8')
-                    httpmorph_request_add_header(req, key_bytes, value_bytes)
+                    header_fields += (key.encode('utf-8'), value.encode('utf-8'))
 
             # Set body if present
             body = kwargs.get('data') or kwargs.get('body')
@@ -564,7 +1796,7 @@ cdef class Session:
                 body = json.dumps(json_data).encode('utf-8')
                 # Add Content-Type header if not already present
                 if headers is None or 'Content-Type' not in headers:
-                    httpmorph_request_add_header(req, b'Content-Type', b'application/json')
+                    header_fields += (b'Content-Type', b'application/json')
 
             # Handle form data (dict)
             if body and isinstance(body, dict):
@@ -572,12 +1804,15 @@ cdef class Session:
                 body = urlencode(body).encode('utf-8')
                 # Add Content-Type header if not already present
                 if headers is None or 'Content-Type' not in headers:
-                    httpmorph_request_add_header(req, b'Content-Type', b'application/x-www-form-urlencoded')
+                    header_fields += (b'Content-Type', b'application/x-www-form-urlencoded')
 
             if body:
                 if isinstance(body, str):
                     body = body.encode('utf-8')
-                httpmorph_request_set_body(req, <const uint8_t*>body, len(body))
+                elif not isinstance(body, bytes):
+                    body = bytes(body)
+            else:
+                body = None
 
             # Build request headers dict for tracking
             request_headers = {}
@@ -618,7 +1853,7 @@ cdef class Session:
                         break
 
             if not has_user_agent:
-                httpmorph_request_add_header(req, b'User-Agent', default_ua.encode('utf-8'))
+                header_fields += (b'User-Agent', default_ua.encode('utf-8'))
                 request_headers['User-Agent'] = default_ua
 
             # Add default headers that will be added by C code if not present
@@ -627,48 +1862,26 @@ cdef class Session:
             if 'Connection' not in request_headers:
                 request_headers['Connection'] = 'close'
 
+            # Set headers and body (if present)
+            _fill_request(req, header_fields, body)
+
+            # Stream the body to the sink (kept alive by this frame)
+            body_sink = kwargs.get('body_sink')
+            if body_sink is not None:
+                httpmorph_request_set_body_callback(req, _body_trampoline, <void*>body_sink,
+                                                    kwargs.get('chunk_size') or 0)
+
+            # Stream the request body from a file or source
+            _set_body_stream(req, kwargs)
+
             # Execute request via session (release GIL to allow other Python threads to run)
             with nogil:
                 resp = httpmorph_session_request(self._session, req)
             if resp is NULL:
                 raise RuntimeError("Failed to execute request")
+            _raise_body_error(resp, kwargs)
 
-            # Copy body BEFORE destroying response (important for memory safety)
-            body_bytes = b''
-            if resp.body and resp.body_len > 0:
-                body_bytes = PyBytes_FromStringAndSize(<char*>resp.body, <Py_ssize_t>resp.body_len)
-
-            # Convert response to Python dict
-            result = {
-                'status_code': resp.status_code,
-                'headers': {},
-                'body': body_bytes,
-                'http_version': resp.http_version,
-                'connect_time_us': resp.connect_time_us,
-                'tls_time_us': resp.tls_time_us,
-                'first_byte_time_us': resp.first_byte_time_us,
-                'total_time_us': resp.total_time_us,
-                'tls_version': resp.tls_version.decode('utf-8') if resp.tls_version else None,
-                'tls_cipher': resp.tls_cipher.decode('utf-8') if resp.tls_cipher else None,
-                'ja3_fingerprint': resp.ja3_fingerprint.decode('utf-8') if resp.ja3_fingerprint else None,
-                'error': resp.error,
-                'error_message': resp.error_message.decode('utf-8') if resp.error_message else None,
-                'request_headers': request_headers,
-            }
-
-            # Convert headers (use latin-1 per HTTP spec, fallback to utf-8)
-            for i in range(resp.header_count):
-                key = resp.headers[i].key.decode('latin-1')
-                try:
-                    value = resp.headers[i].value.decode('latin-1')
-                except:
-                    value = resp.headers[i].value.decode('utf-8', errors='replace')
-                result['headers'][key] = value
-
-            # Cleanup response
-            httpmorph_response_destroy(resp)
-
-            return result
+            return _response_to_dict(resp, self, request_headers)
 
         finally:
             httpmorph_request_destroy(req)
@@ -687,6 +1900,430 @@ def cleanup():
     httpmorph_cleanup()
 
 
+def set_dns_servers(servers=None, timeout=None):
+    """Send DNS queries to the given name servers (None restores the system resolver)
+
+    Args:
+        servers: List of "ip", "ip:port" or "[ipv6]:port" strings (at most 4)
+        timeout: Per-server query timeout in seconds
+    """
+    cdef uint32_t timeout_ms = int(timeout * 1000) if timeout else 0
+    cdef bytes servers_bytes
+    cdef int result
+
+    if not servers:
+        result = httpmorph_set_dns_servers(NULL, timeout_ms)
+    else:
+        servers_bytes = ",".join(servers).encode('ascii')
+        result = httpmorph_set_dns_servers(servers_bytes, timeout_ms)
+
+    if result != 0:
+        raise ValueError(f"Invalid DNS server list: {servers!r}")
+
+
+def dns_cache_stats():
+    """Get process-wide DNS cache statistics
+
+    Returns:
+        dict with hits, misses, negative_hits, insertions, evictions,
+        expirations and entries, or None if unavailable
+    """
+    cdef httpmorph_dns_cache_stats_t stats
+    if httpmorph_dns_get_cache_stats(&stats) != 0:
+        return None
+    return {
+        'hits': stats.hits,
+        'misses': stats.misses,
+        'negative_hits': stats.negative_hits,
+        'insertions': stats.insertions,
+        'evictions': stats.evictions,
+        'expirations': stats.expirations,
+        'entries': stats.entries,
+    }
+
+
+def open_shared_cache(path, size_t dns_entries=0, size_t tls_entries=0):
+    """Share DNS results and TLS sessions with other processes through a file
+
+    Args:
+        path: File to map, created if missing (use tmpfs, e.g. /dev/shm)
+        dns_entries: DNS slots (0 for 1024)
+        tls_entries: TLS session slots (0 for 1024)
+
+    Returns:
+        True if opened, False if it failed or one is already open
+    """
+    cdef bytes path_bytes = str(path).encode('utf-8')
+    return httpmorph_shared_cache_open(path_bytes, dns_entries, tls_entries) == 0
+
+
+def shared_cache_stats():
+    """Get statistics of the shared cache, summed over every process using it
+
+    Returns:
+        dict with dns_hits, dns_misses, dns_stores, tls_hits, tls_misses,
+        tls_stores, busy, dns_entries and tls_entries, or None if no
+        shared cache is open
+    """
+    cdef httpmorph_shared_cache_stats_t stats
+    if httpmorph_shared_cache_get_stats(&stats) != 0:
+        return None
+    return {
+        'dns_hits': stats.dns_hits,
+        'dns_misses': stats.dns_misses,
+        'dns_stores': stats.dns_stores,
+        'tls_hits': stats.tls_hits,
+        'tls_misses': stats.tls_misses,
+        'tls_stores': stats.tls_stores,
+        'busy': stats.busy,
+        'dns_entries': stats.dns_entries,
+        'tls_entries': stats.tls_entries,
+    }
+
+
+_tracer = None
+_PROTOCOL_VERSIONS = ('1.0', '1.1', '2', '3')
+
+
+cdef object _span_to_dict(const httpmorph_span_t *span):
+    """Convert a span to an OpenTelemetry-style dict"""
+    cdef int i
+    cdef bint root = True
+    for i in range(8):
+        if span.parent_span_id[i]:
+            root = False
+    attributes = {'httpmorph.request_id': span.request_id}
+    if root:
+        attributes['http.request.method'] = span.method.decode('ascii')
+        attributes['url.full'] = span.url.decode('utf-8', 'replace')
+        if span.status_code:
+            attributes['http.response.status_code'] = span.status_code
+            if 0 <= span.http_version < 4:
+                attributes['network.protocol.version'] = _PROTOCOL_VERSIONS[span.http_version]
+        if span.error:
+            attributes['error.type'] = str(span.error)
+        attributes['httpmorph.connection_reused'] = bool(span.connection_reused)
+        attributes['httpmorph.tls_resumed'] = bool(span.tls_resumed)
+        attributes['httpmorph.body_len'] = span.body_len
+    return {
+        'trace_id': bytes(span.trace_id[:16]).hex(),
+        'span_id': bytes(span.span_id[:8]).hex(),
+        'parent_span_id': None if root else bytes(span.parent_span_id[:8]).hex(),
+        'name': span.name.decode('ascii'),
+        'start_time_unix_nano': span.start_unix_ns,
+        'end_time_unix_nano': span.end_unix_ns,
+        'attributes': attributes,
+    }
+
+
+cdef void _span_trampoline(const httpmorph_span_t *span, void *user_data) noexcept with gil:
+    """Span callback: hands each span to the Python tracer as a dict"""
+    tracer = _tracer
+    if tracer is None:
+        return
+    try:
+        tracer(_span_to_dict(span))
+    except BaseException:
+        pass  # A tracer must never fail the request
+
+
+def set_tracer(tracer):
+    """Call tracer(span_dict) for every span of every request (None stops)
+
+    Spans are dicts shaped like OpenTelemetry spans: trace_id, span_id,
+    parent_span_id (None for a request's root span), name,
+    start_time_unix_nano, end_time_unix_nano and attributes.
+    """
+    global _tracer
+    _tracer = tracer
+    if tracer is None:
+        httpmorph_set_tracer(NULL, NULL)
+    else:
+        httpmorph_set_tracer(_span_trampoline, NULL)
+
+
+# In-process HTTP/2 peer for tests of the session manager's stream queue
+
+cdef struct _h2_probe_state
+
+cdef struct _h2_probe_stream:
+    _h2_probe_state *state
+    int index
+
+cdef struct _h2_probe_state:
+    int client_fd
+    http2_session_manager_t *mgr
+    nghttp2_session *server
+    _h2_probe_stream streams[64]
+    int32_t opened[64]            # Streams the peer saw, in order (peer side only)
+    int opened_count
+    int completed_index[64]       # Submissions in completion order (under mgr->mutex)
+    int32_t completed_stream[64]
+    int completed_count
+
+cdef nghttp2_nv _h2_probe_request[4]
+cdef nghttp2_nv _h2_probe_status[1]
+
+
+cdef void _h2_probe_nv(nghttp2_nv *nv, const char *name, const char *value) noexcept:
+    nv.name = <uint8_t*>name
+    nv.namelen = strlen(name)
+    nv.value = <uint8_t*>value
+    nv.valuelen = strlen(value)
+    nv.flags = NGHTTP2_NV_FLAG_NONE
+
+
+cdef ssize_t _h2_probe_send(nghttp2_session *session, const uint8_t *data, size_t length,
+                            int flags, void *user_data) noexcept nogil:
+    cdef int n = send((<_h2_probe_state*>user_data).client_fd, <const char*>data, <int>length, 0)
+    if n < 0:
+        return NGHTTP2_ERR_WOULDBLOCK  # Non-blocking socket; a broken pair times the test out
+    return n
+
+
+cdef ssize_t _h2_probe_recv(nghttp2_session *session, uint8_t *buf, size_t length,
+                            int flags, void *user_data) noexcept nogil:
+    cdef int n = recv((<_h2_probe_state*>user_data).client_fd, <char*>buf, <int>length, 0)
+    if n == 0:
+        return NGHTTP2_ERR_EOF
+    if n < 0:
+        return NGHTTP2_ERR_WOULDBLOCK
+    return n
+
+
+cdef int _h2_probe_client_frame(nghttp2_session *session, const nghttp2_frame *frame,
+                                void *user_data) noexcept nogil:
+    """Client side: a response ending its stream completes it"""
+    if ((frame.hd.type == NGHTTP2_HEADERS or frame.hd.type == NGHTTP2_DATA) and
+            frame.hd.flags & NGHTTP2_FLAG_END_STREAM and frame.hd.stream_id > 0):
+        http2_session_manager_mark_stream_complete((<_h2_probe_state*>user_data).mgr,
+                                                   frame.hd.stream_id, False)
+    return 0
+
+
+cdef int _h2_probe_server_frame(nghttp2_session *session, const nghttp2_frame *frame,
+                                void *user_data) noexcept nogil:
+    """Peer side: record each request as it arrives"""
+    cdef _h2_probe_state *state = <_h2_probe_state*>user_data
+    if frame.hd.type == NGHTTP2_HEADERS and state.opened_count < 64:
+        state.opened[state.opened_count] = frame.hd.stream_id
+        state.opened_count += 1
+    return 0
+
+
+cdef void _h2_probe_complete(void *ctx, int32_t stream_id, _c_bool has_error) noexcept nogil:
+    cdef _h2_probe_stream *stream = <_h2_probe_stream*>ctx
+    cdef _h2_probe_state *state = stream.state
+    if state.completed_count < 64:
+        state.completed_index[state.completed_count] = stream.index
+        state.completed_stream[state.completed_count] = -1 if has_error else stream_id
+        state.completed_count += 1
+
+
+cdef class _Http2QueueProbe:
+    """A session manager on one end of a socket pair, an HTTP/2 peer allowing
+    max_streams concurrent streams on the other (for tests of the stream queue)
+
+    The peer only reads, and answers a stream, when told to: call pump()
+    to let it read and respond(stream_id) to end a stream.
+    """
+    cdef _h2_probe_state *state
+    cdef nghttp2_session *client
+    cdef nghttp2_session_callbacks *client_callbacks
+    cdef nghttp2_session_callbacks *server_callbacks
+    cdef SSL_CTX *ssl_ctx
+    cdef SSL *ssl
+    cdef int submitted
+    cdef object client_sock
+    cdef object server_sock
+
+    def __cinit__(self, uint32_t max_streams):
+        import socket
+        cdef nghttp2_settings_entry limit
+        self.client_sock, self.server_sock = socket.socketpair()
+        self.server_sock.setblocking(False)
+
+        _h2_probe_nv(&_h2_probe_request[0], b":method", b"GET")
+        _h2_probe_nv(&_h2_probe_request[1], b":scheme", b"https")
+        _h2_probe_nv(&_h2_probe_request[2], b":authority", b"localhost")
+        _h2_probe_nv(&_h2_probe_request[3], b":path", b"/")
+        _h2_probe_nv(&_h2_probe_status[0], b":status", b"200")
+
+        self.state = <_h2_probe_state*>calloc(1, sizeof(_h2_probe_state))
+        if self.state is NULL:
+            raise MemoryError()
+        self.state.client_fd = self.client_sock.fileno()
+
+        if (nghttp2_session_callbacks_new(&self.client_callbacks) != 0 or
+                nghttp2_session_callbacks_new(&self.server_callbacks) != 0):
+            raise MemoryError()
+        nghttp2_session_callbacks_set_send_callback(self.client_callbacks, _h2_probe_send)
+        nghttp2_session_callbacks_set_recv_callback(self.client_callbacks, _h2_probe_recv)
+        nghttp2_session_callbacks_set_on_frame_recv_callback(self.client_callbacks, _h2_probe_client_frame)
+        nghttp2_session_callbacks_set_on_frame_recv_callback(self.server_callbacks, _h2_probe_server_frame)
+
+        if (nghttp2_session_client_new(&self.client, self.client_callbacks, self.state) != 0 or
+                nghttp2_session_server_new(&self.state.server, self.server_callbacks, self.state) != 0):
+            raise MemoryError()
+        limit.settings_id = NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS
+        limit.value = max_streams
+        nghttp2_submit_settings(self.client, NGHTTP2_FLAG_NONE, NULL, 0)
+        nghttp2_submit_settings(self.state.server, NGHTTP2_FLAG_NONE, &limit, 1)
+
+        # The manager only needs an SSL handle to set modes on; I/O goes through the callbacks
+        self.ssl_ctx = SSL_CTX_new(TLS_method())
+        if self.ssl_ctx is not NULL:
+            self.ssl = SSL_new(self.ssl_ctx)
+        if self.ssl is NULL:
+            raise MemoryError()
+
+        # The preface goes out while the socket is still blocking
+        if nghttp2_session_send(self.client) != 0:
+            raise RuntimeError("Failed to send the HTTP/2 preface")
+        self.state.mgr = http2_session_manager_create(self.client, self.client_callbacks,
+                                                      self.ssl, self.state.client_fd, NULL)
+        if self.state.mgr is NULL:
+            raise MemoryError()
+        if http2_session_manager_start(self.state.mgr) != 0:
+            raise RuntimeError("Failed to attach to the HTTP/2 reactor")
+
+    def __dealloc__(self):
+        self._release()
+
+    def close(self):
+        """Detach from the reactor and free everything (idempotent)"""
+        self._release()
+
+    cdef _release(self):
+        if self.state is not NULL:
+            if self.state.mgr is not NULL:
+                with nogil:
+                    http2_session_manager_destroy(self.state.mgr)
+            if self.state.server is not NULL:
+                nghttp2_session_del(self.state.server)
+            free(self.state)
+            self.state = NULL
+        if self.client is not NULL:
+            nghttp2_session_del(self.client)
+            self.client = NULL
+        if self.client_callbacks is not NULL:
+            nghttp2_session_callbacks_del(self.client_callbacks)
+            self.client_callbacks = NULL
+        if self.server_callbacks is not NULL:
+            nghttp2_session_callbacks_del(self.server_callbacks)
+            self.server_callbacks = NULL
+        SSL_free(self.ssl)
+        self.ssl = NULL
+        SSL_CTX_free(self.ssl_ctx)
+        self.ssl_ctx = NULL
+        if self.client_sock is not None:
+            self.client_sock.close()
+            self.server_sock.close()
+            self.client_sock = self.server_sock = None
+
+    cdef _h2_probe_state* _live(self) except NULL:
+        if self.state is NULL:
+            raise RuntimeError("Probe is closed")
+        return self.state
+
+    def submit(self, int32_t weight=16):
+        """Submit a GET with the given priority weight
+
+        Returns:
+            Its stream ID, or 0 if it was queued
+        """
+        cdef _h2_probe_state *state = self._live()
+        cdef _h2_probe_stream *stream
+        cdef nghttp2_priority_spec spec
+        cdef int32_t stream_id = 0
+        cdef int rc
+        if self.submitted >= 64:
+            raise RuntimeError("Too many streams")
+        stream = &state.streams[self.submitted]
+        stream.state = state
+        stream.index = self.submitted
+        nghttp2_priority_spec_init(&spec, 0, weight, 0)
+        with nogil:
+            rc = http2_session_manager_submit_stream(state.mgr, stream, &spec, _h2_probe_request, 4, NULL,
+                                                     _h2_probe_complete, stream, &stream_id)
+        if rc != 0:
+            raise RuntimeError("Failed to submit stream")
+        self.submitted += 1
+        return stream_id
+
+    def pump(self):
+        """Let the peer read what has arrived and send what it has queued"""
+        cdef _h2_probe_state *state = self._live()
+        cdef const uint8_t *out
+        cdef ssize_t n
+        cdef bytes data
+        while True:
+            try:
+                data = self.server_sock.recv(65536)
+            except BlockingIOError:
+                break
+            if not data:
+                break
+            if nghttp2_session_mem_recv(state.server, <const uint8_t*><const char*>data, len(data)) < 0:
+                raise RuntimeError("HTTP/2 peer rejected the client's frames")
+        while True:
+            n = nghttp2_session_mem_send(state.server, &out)
+            if n < 0:
+                raise RuntimeError("HTTP/2 peer failed to send")
+            if n == 0:
+                break
+            self.server_sock.sendall(PyBytes_FromStringAndSize(<const char*>out, n))
+
+    def respond(self, int32_t stream_id):
+        """End a stream with an empty 200 response"""
+        cdef _h2_probe_state *state = self._live()
+        if nghttp2_submit_response(state.server, stream_id, _h2_probe_status, 1, NULL) != 0:
+            raise ValueError(f"Cannot respond on stream {stream_id}")
+        self.pump()
+
+    @property
+    def opened(self):
+        """Stream IDs of the requests the peer has received, in order"""
+        cdef _h2_probe_state *state = self._live()
+        return [state.opened[i] for i in range(state.opened_count)]
+
+    @property
+    def completed(self):
+        """(submission index, stream ID) in completion order; -1 for failed streams"""
+        cdef _h2_probe_state *state = self._live()
+        with nogil:
+            pthread_mutex_lock(&state.mgr.mutex)
+        done = [(state.completed_index[i], state.completed_stream[i]) for i in range(state.completed_count)]
+        pthread_mutex_unlock(&state.mgr.mutex)
+        return done
+
+    @property
+    def stats(self):
+        """dict with remote_limit (the peer's limit as the client sees it),
+        open, queued, total_queued and saturated"""
+        cdef _h2_probe_state *state = self._live()
+        cdef uint32_t remote_limit
+        cdef int open_count, queued
+        cdef uint64_t total_queued
+        cdef _c_bool saturated
+        with nogil:
+            saturated = http2_session_manager_is_saturated(state.mgr)
+            pthread_mutex_lock(&state.mgr.mutex)
+            remote_limit = nghttp2_session_get_remote_settings(
+                state.mgr.session, NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS)
+            open_count = state.mgr.open_stream_count
+            queued = state.mgr.queued_stream_count
+            total_queued = state.mgr.total_streams_queued
+            pthread_mutex_unlock(&state.mgr.mutex)
+        return {
+            'remote_limit': remote_limit,
+            'open': open_count,
+            'queued': queued,
+            'total_queued': total_queued,
+            'saturated': bool(saturated),
+        }
+
+
 def version():
     """Get library version string"""
     cdef const char* ver = httpmorph_version()
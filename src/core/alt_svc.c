@@ -0,0 +1,516 @@
+/**
+ * alt_svc.c - Alternative services advertised by origins (RFC 7838)
+ *
+ * Origins sit in a direct-mapped table keyed by the hash of their
+ * "scheme://host:port", allocated when an origin first advertises
+ * something; an origin that lands on an occupied slot takes it over. A
+ * header replaces an origin's alternatives but not its failure backoff,
+ * since servers keep advertising an alternative that doesn't work.
+ */
+
+#include "alt_svc.h"
+#include "request_scheduler.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define ALT_SVC_LOCK(c)   EnterCriticalSection(&(c)->mutex)
+    #define ALT_SVC_UNLOCK(c) LeaveCriticalSection(&(c)->mutex)
+#else
+    #include <pthread.h>
+    #define ALT_SVC_LOCK(c)   pthread_mutex_lock(&(c)->mutex)
+    #define ALT_SVC_UNLOCK(c) pthread_mutex_unlock(&(c)->mutex)
+#endif
+
+/* Largest ma= honoured, in seconds */
+#define ALT_SVC_MAX_MAX_AGE (10ULL * 365 * 86400)
+
+typedef struct {
+    char key[REQUEST_SCHEDULER_MAX_KEY];
+    uint64_t hash;
+    alt_svc_entry_t entries[ALT_SVC_MAX_ALTERNATIVES];  /* Preference order */
+    size_t count;
+    uint64_t broken_until_s;         /* No alternative before this */
+    uint32_t broken_count;           /* Failures so far (sets the next backoff) */
+} alt_svc_origin_t;
+
+struct alt_svc_cache {
+    alt_svc_origin_t *origins[ALT_SVC_SLOTS];
+    alt_svc_stats_t stats;
+
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+};
+
+/* ------------------------------------------------------------------
+ * Header parsing
+ * ------------------------------------------------------------------ */
+
+static const char* skip_ows(const char *p) {
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+static bool is_tchar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+           (c != '\0' && strchr("!#$%&'*+-.^_`|~", c) != NULL);
+}
+
+/**
+ * Read a token
+ * @return Its length (0 if there is none)
+ */
+static size_t read_token(const char **pp) {
+    const char *start = *pp;
+    while (is_tchar(**pp)) {
+        (*pp)++;
+    }
+    return (size_t)(*pp - start);
+}
+
+/**
+ * Read a quoted-string, unescaped into out (NULL to skip it)
+ * @return false if it is malformed or doesn't fit
+ */
+static bool read_quoted(const char **pp, char *out, size_t size) {
+    const char *p = *pp;
+    if (*p != '"') {
+        return false;
+    }
+    p++;
+
+    size_t n = 0;
+    while (*p && *p != '"') {
+        if (*p == '\\' && p[1]) {
+            p++;
+        }
+        if (out) {
+            if (n + 1 >= size) {
+                return false;
+            }
+            out[n++] = *p;
+        }
+        p++;
+    }
+    if (*p != '"') {
+        return false;
+    }
+    if (out) {
+        out[n] = '\0';
+    }
+    *pp = p + 1;
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+/**
+ * Percent-decode a protocol-id (RFC 7838 section 3)
+ */
+static bool decode_protocol(const char *id, size_t len, char *out, size_t size) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        char c = id[i];
+        if (c == '%') {
+            int hi = i + 2 < len ? hex_value(id[i + 1]) : -1;
+            int lo = hi >= 0 ? hex_value(id[i + 2]) : -1;
+            if (lo < 0) {
+                return false;
+            }
+            c = (char)(hi * 16 + lo);
+            i += 2;
+        }
+        if (c == '\0' || n + 1 >= size) {
+            return false;
+        }
+        out[n++] = c;
+    }
+    out[n] = '\0';
+    return n > 0;
+}
+
+/**
+ * Split an alt-authority ("[host]:port") into an entry
+ */
+static bool parse_authority(const char *authority, alt_svc_entry_t *entry) {
+    const char *colon = strrchr(authority, ':');
+    if (!colon || colon[1] == '\0') {
+        return false;
+    }
+
+    unsigned long port = 0;
+    for (const char *p = colon + 1; *p; p++) {
+        if (*p < '0' || *p > '9' || port > 65535) {
+            return false;
+        }
+        port = port * 10 + (unsigned long)(*p - '0');
+    }
+    if (port == 0 || port > 65535) {
+        return false;
+    }
+
+    /* IPv6 literals are kept without their brackets */
+    const char *host = authority;
+    size_t host_len = (size_t)(colon - authority);
+    if (host_len > 0 && host[0] == '[') {
+        if (host_len < 2 || host[host_len - 1] != ']') {
+            return false;
+        }
+        host++;
+        host_len -= 2;
+    }
+    if (host_len >= sizeof(entry->host)) {
+        return false;
+    }
+    for (size_t i = 0; i < host_len; i++) {
+        char c = host[i];
+        entry->host[i] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+    entry->host[host_len] = '\0';
+    entry->port = (uint16_t)port;
+    return true;
+}
+
+/**
+ * Parse one alt-value, leaving *pp where parsing stopped
+ */
+static bool parse_alternative(const char **pp, alt_svc_entry_t *entry, uint64_t now_s) {
+    const char *p = *pp;
+    bool ok = false;
+    memset(entry, 0, sizeof(*entry));
+
+    const char *id = p;
+    size_t id_len = read_token(&p);
+    char authority[ALT_SVC_MAX_HOST + 8];
+    if (id_len == 0 || *p != '=' ||
+        !decode_protocol(id, id_len, entry->protocol, sizeof(entry->protocol))) {
+        goto done;
+    }
+    p++;
+    if (!read_quoted(&p, authority, sizeof(authority)) || !parse_authority(authority, entry)) {
+        goto done;
+    }
+
+    uint64_t max_age = ALT_SVC_DEFAULT_MAX_AGE;
+    for (;;) {
+        p = skip_ows(p);
+        if (*p != ';') {
+            break;
+        }
+        p = skip_ows(p + 1);
+
+        const char *name = p;
+        size_t name_len = read_token(&p);
+        if (name_len == 0 || *p != '=') {
+            goto done;
+        }
+        p++;
+
+        /* Only ma= matters here; persist= and unknown parameters are skipped */
+        bool is_ma = name_len == 2 && (name[0] | 0x20) == 'm' && (name[1] | 0x20) == 'a';
+        char value[24];
+        const char *v = p;
+        size_t v_len;
+        if (*p == '"') {
+            if (!read_quoted(&p, is_ma ? value : NULL, sizeof(value))) {
+                goto done;
+            }
+            v = value;
+            v_len = is_ma ? strlen(value) : 1;
+        } else {
+            v_len = read_token(&p);
+        }
+        if (v_len == 0) {
+            goto done;
+        }
+        if (is_ma) {
+            max_age = 0;
+            for (size_t i = 0; i < v_len; i++) {
+                if (v[i] < '0' || v[i] > '9') {
+                    goto done;
+                }
+                if (max_age < ALT_SVC_MAX_MAX_AGE) {
+                    max_age = max_age * 10 + (uint64_t)(v[i] - '0');
+                }
+            }
+            if (max_age > ALT_SVC_MAX_MAX_AGE) {
+                max_age = ALT_SVC_MAX_MAX_AGE;
+            }
+        }
+    }
+
+    if (*p == '\0' || *p == ',') {
+        entry->expires_s = now_s + max_age;
+        ok = max_age > 0;
+    }
+
+done:
+    *pp = p;
+    return ok;
+}
+
+/**
+ * Skip to the ',' ending the current alt-value (or the end)
+ */
+static const char* skip_value(const char *p) {
+    bool quoted = false;
+    for (; *p; p++) {
+        if (quoted) {
+            if (*p == '\\' && p[1]) {
+                p++;
+            } else if (*p == '"') {
+                quoted = false;
+            }
+        } else if (*p == '"') {
+            quoted = true;
+        } else if (*p == ',') {
+            break;
+        }
+    }
+    return p;
+}
+
+size_t alt_svc_parse(const char *value, alt_svc_entry_t *entries, size_t max,
+                     uint64_t now_s, bool *clear) {
+    if (clear) {
+        *clear = false;
+    }
+    if (!value) {
+        return 0;
+    }
+
+    const char *p = skip_ows(value);
+    if (strncmp(p, "clear", 5) == 0 && *skip_ows(p + 5) == '\0') {
+        if (clear) {
+            *clear = true;
+        }
+        return 0;
+    }
+
+    /* A malformed alt-value is dropped on its own; the rest still count */
+    size_t count = 0;
+    while (*p) {
+        alt_svc_entry_t entry;
+        if (parse_alternative(&p, &entry, now_s) && count < max) {
+            entries[count++] = entry;
+        }
+        p = skip_value(p);
+        if (*p == ',') {
+            p++;
+        }
+        p = skip_ows(p);
+    }
+    return count;
+}
+
+/* ------------------------------------------------------------------
+ * Cache
+ * ------------------------------------------------------------------ */
+
+/**
+ * Build the key and hash of a URL's origin (hash 0 if it has none that fits)
+ */
+static uint64_t origin_hash(const char *url, char *key) {
+    if (!url || !request_scheduler_origin_key(url, key, REQUEST_SCHEDULER_MAX_KEY)) {
+        return 0;
+    }
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+/**
+ * Find a tracked origin (mutex must be held)
+ */
+static alt_svc_origin_t* origin_find(alt_svc_cache_t *cache, uint64_t hash, const char *key) {
+    alt_svc_origin_t *origin = cache->origins[hash & (ALT_SVC_SLOTS - 1)];
+    if (!origin || origin->hash != hash || strcmp(origin->key, key) != 0) {
+        return NULL;
+    }
+    return origin;
+}
+
+/**
+ * Stop tracking the origin in a slot (mutex must be held)
+ */
+static void slot_free(alt_svc_cache_t *cache, size_t slot) {
+    if (cache->origins[slot]) {
+        free(cache->origins[slot]);
+        cache->origins[slot] = NULL;
+        cache->stats.origins--;
+    }
+}
+
+alt_svc_cache_t* alt_svc_cache_create(void) {
+    alt_svc_cache_t *cache = calloc(1, sizeof(alt_svc_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+#ifdef _WIN32
+    InitializeCriticalSection(&cache->mutex);
+#else
+    pthread_mutex_init(&cache->mutex, NULL);
+#endif
+    return cache;
+}
+
+void alt_svc_cache_destroy(alt_svc_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    alt_svc_cache_clear(cache);
+#ifdef _WIN32
+    DeleteCriticalSection(&cache->mutex);
+#else
+    pthread_mutex_destroy(&cache->mutex);
+#endif
+    free(cache);
+}
+
+void alt_svc_cache_update(alt_svc_cache_t *cache, const char *url,
+                          const char *const *values, size_t count, uint64_t now_s) {
+    char key[REQUEST_SCHEDULER_MAX_KEY];
+    uint64_t hash = origin_hash(url, key);
+    if (!cache || !values || hash == 0 || strncmp(key, "https://", 8) != 0) {
+        return;
+    }
+
+    /* Repeated header lines are one list */
+    alt_svc_entry_t entries[ALT_SVC_MAX_ALTERNATIVES];
+    size_t found = 0;
+    bool clear = false;
+    for (size_t i = 0; i < count; i++) {
+        bool value_clear;
+        found += alt_svc_parse(values[i], entries + found, ALT_SVC_MAX_ALTERNATIVES - found,
+                               now_s, &value_clear);
+        clear = clear || value_clear;
+    }
+    if (!clear && found == 0) {
+        return;
+    }
+
+    size_t slot = hash & (ALT_SVC_SLOTS - 1);
+    ALT_SVC_LOCK(cache);
+    alt_svc_origin_t *origin = origin_find(cache, hash, key);
+    if (clear) {
+        cache->stats.clears++;
+        if (origin) {
+            origin->count = 0;
+            if (origin->broken_count == 0) {
+                slot_free(cache, slot);
+            }
+        }
+        ALT_SVC_UNLOCK(cache);
+        return;
+    }
+
+    if (!origin) {
+        origin = calloc(1, sizeof(alt_svc_origin_t));
+        if (!origin) {
+            ALT_SVC_UNLOCK(cache);
+            return;
+        }
+        slot_free(cache, slot);
+        memcpy(origin->key, key, strlen(key) + 1);
+        origin->hash = hash;
+        cache->origins[slot] = origin;
+        cache->stats.origins++;
+    }
+    memcpy(origin->entries, entries, found * sizeof(alt_svc_entry_t));
+    origin->count = found;
+    cache->stats.updates++;
+    ALT_SVC_UNLOCK(cache);
+}
+
+bool alt_svc_cache_lookup(alt_svc_cache_t *cache, const char *url, const char *protocol,
+                          uint64_t now_s, alt_svc_entry_t *entry) {
+    char key[REQUEST_SCHEDULER_MAX_KEY];
+    uint64_t hash = origin_hash(url, key);
+    if (!cache || !protocol || hash == 0) {
+        return false;
+    }
+
+    bool found = false;
+    ALT_SVC_LOCK(cache);
+    alt_svc_origin_t *origin = origin_find(cache, hash, key);
+    if (origin && now_s >= origin->broken_until_s) {
+        for (size_t i = 0; i < origin->count; i++) {
+            const alt_svc_entry_t *candidate = &origin->entries[i];
+            if (candidate->expires_s > now_s && strcmp(candidate->protocol, protocol) == 0) {
+                if (entry) {
+                    *entry = *candidate;
+                }
+                found = true;
+                break;
+            }
+        }
+    }
+    if (found) {
+        cache->stats.hits++;
+    } else {
+        cache->stats.misses++;
+    }
+    ALT_SVC_UNLOCK(cache);
+    return found;
+}
+
+void alt_svc_cache_mark_broken(alt_svc_cache_t *cache, const char *url, uint64_t now_s) {
+    char key[REQUEST_SCHEDULER_MAX_KEY];
+    uint64_t hash = origin_hash(url, key);
+    if (!cache || hash == 0) {
+        return;
+    }
+
+    ALT_SVC_LOCK(cache);
+    alt_svc_origin_t *origin = origin_find(cache, hash, key);
+    if (origin) {
+        uint64_t backoff = ALT_SVC_BROKEN_BACKOFF;
+        for (uint32_t i = 0; i < origin->broken_count && backoff < ALT_SVC_BROKEN_MAX_BACKOFF; i++) {
+            backoff *= 2;
+        }
+        if (backoff > ALT_SVC_BROKEN_MAX_BACKOFF) {
+            backoff = ALT_SVC_BROKEN_MAX_BACKOFF;
+        }
+        origin->broken_until_s = now_s + backoff;
+        origin->broken_count++;
+        cache->stats.broken++;
+    }
+    ALT_SVC_UNLOCK(cache);
+}
+
+void alt_svc_cache_clear(alt_svc_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+    ALT_SVC_LOCK(cache);
+    for (size_t i = 0; i < ALT_SVC_SLOTS; i++) {
+        slot_free(cache, i);
+    }
+    ALT_SVC_UNLOCK(cache);
+}
+
+void alt_svc_cache_get_stats(alt_svc_cache_t *cache, alt_svc_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!cache) {
+        return;
+    }
+    ALT_SVC_LOCK(cache);
+    *stats = cache->stats;
+    ALT_SVC_UNLOCK(cache);
+}
@@ -0,0 +1,130 @@
+/**
+ * alt_svc.h - Alternative services advertised by origins (RFC 7838)
+ *
+ * Remembers the Alt-Svc header of HTTPS responses per origin (scheme,
+ * host and port), so a transport that can speak an advertised protocol,
+ * such as HTTP/3 ("h3"), knows where to find it. Each header replaces what
+ * was known about its origin, "clear" forgets it, and every alternative
+ * expires after its max-age. An origin whose alternative failed is not
+ * offered one again until a backoff has passed, which doubles with every
+ * failure. Thread-safe; the cache does no I/O and reads no clock of its
+ * own.
+ *
+ * Nothing in this library connects to an alternative: there is no QUIC
+ * transport, so the cache only answers the client and session alt_svc()
+ * lookups for callers that have one.
+ */
+
+#ifndef HTTPMORPH_ALT_SVC_H
+#define HTTPMORPH_ALT_SVC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Alternatives kept per origin (the first ones advertised) */
+#define ALT_SVC_MAX_ALTERNATIVES 4
+
+/* Origins tracked at once (power of 2; colliding origins replace each other) */
+#define ALT_SVC_SLOTS 256
+
+/* Longest ALPN protocol ID and alternative host kept */
+#define ALT_SVC_MAX_PROTOCOL 16
+#define ALT_SVC_MAX_HOST 256
+
+/* Lifetime of an alternative without ma= (RFC 7838 section 3.1) */
+#define ALT_SVC_DEFAULT_MAX_AGE 86400
+
+/* First backoff after a failure, and the most it doubles to */
+#define ALT_SVC_BROKEN_BACKOFF 300
+#define ALT_SVC_BROKEN_MAX_BACKOFF (48 * 3600)
+
+typedef struct {
+    char protocol[ALT_SVC_MAX_PROTOCOL];  /* ALPN protocol ID, e.g. "h3" */
+    char host[ALT_SVC_MAX_HOST];          /* Empty: the origin's own host */
+    uint16_t port;
+    uint64_t expires_s;                   /* On the caller's clock */
+} alt_svc_entry_t;
+
+typedef struct {
+    uint64_t updates;                /* Headers that replaced an origin's alternatives */
+    uint64_t clears;                 /* "clear" headers */
+    uint64_t hits;                   /* Lookups that found an alternative */
+    uint64_t misses;                 /* Lookups that didn't */
+    uint64_t broken;                 /* Failures reported */
+    size_t origins;                  /* Origins tracked */
+} alt_svc_stats_t;
+
+typedef struct alt_svc_cache alt_svc_cache_t;
+
+/**
+ * Create an empty cache
+ */
+alt_svc_cache_t* alt_svc_cache_create(void);
+
+/**
+ * Destroy a cache
+ */
+void alt_svc_cache_destroy(alt_svc_cache_t *cache);
+
+/**
+ * Record the Alt-Svc header of a response
+ *
+ * Headers from non-HTTPS origins and headers without a single valid
+ * alternative are ignored.
+ *
+ * @param url URL the response came from (selects the origin)
+ * @param values Values of the Alt-Svc header, in arrival order
+ * @param count Entries in values
+ * @param now_s Current time in seconds
+ */
+void alt_svc_cache_update(alt_svc_cache_t *cache, const char *url,
+                          const char *const *values, size_t count, uint64_t now_s);
+
+/**
+ * Find an origin's preferred alternative for a protocol
+ *
+ * @param protocol ALPN protocol ID (e.g. "h3")
+ * @param entry Output: the alternative (may be NULL to test only)
+ * @return true if one is known, unexpired and not in a failure backoff
+ */
+bool alt_svc_cache_lookup(alt_svc_cache_t *cache, const char *url, const char *protocol,
+                          uint64_t now_s, alt_svc_entry_t *entry);
+
+/**
+ * Report that connecting to an origin's alternative failed
+ */
+void alt_svc_cache_mark_broken(alt_svc_cache_t *cache, const char *url, uint64_t now_s);
+
+/**
+ * Forget every origin, failures included
+ */
+void alt_svc_cache_clear(alt_svc_cache_t *cache);
+
+/**
+ * Parse one Alt-Svc header value
+ *
+ * @param value Header value
+ * @param entries Output: alternatives in preference order
+ * @param max Entries in entries
+ * @param now_s Current time, for expires_s
+ * @param clear Output: true if the value is "clear"
+ * @return Alternatives written to entries
+ */
+size_t alt_svc_parse(const char *value, alt_svc_entry_t *entries, size_t max,
+                     uint64_t now_s, bool *clear);
+
+/**
+ * Get counters
+ */
+void alt_svc_cache_get_stats(alt_svc_cache_t *cache, alt_svc_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_ALT_SVC_H */
@@ -0,0 +1,356 @@
+/**
+ * arena.c - Per-request arena allocator
+ */
+
+#include "arena.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+/* Largest block grown on demand; bigger requests get a block of their own */
+#define ARENA_MAX_BLOCK_SIZE 65536
+
+#define ARENA_ALIGN(n) (((n) + 7) & ~(size_t)7)
+
+#ifdef _WIN32
+    #define ARENA_INC(p) InterlockedIncrementSizeT((volatile SIZE_T*)(p))
+    #define ARENA_DEC(p) InterlockedDecrementSizeT((volatile SIZE_T*)(p))
+    #define POOL_LOCK(p)   EnterCriticalSection(&(p)->mutex)
+    #define POOL_UNLOCK(p) LeaveCriticalSection(&(p)->mutex)
+#else
+    #define ARENA_INC(p) __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define ARENA_DEC(p) __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define POOL_LOCK(p)   pthread_mutex_lock(&(p)->mutex)
+    #define POOL_UNLOCK(p) pthread_mutex_unlock(&(p)->mutex)
+#endif
+
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    size_t pad;                  /* Keeps data 8-byte aligned on 32-bit targets */
+    char data[];
+} arena_block_t;
+
+struct httpmorph_arena {
+    arena_block_t *head;         /* Block allocations bump from, then older ones */
+    arena_block_t *first;        /* Allocated with the arena; survives resets */
+    size_t next_block_size;
+    size_t refs;
+    httpmorph_arena_pool_t *pool;
+    struct httpmorph_arena *next_free;
+};
+
+struct httpmorph_arena_pool {
+    httpmorph_arena_t *free_list;
+    size_t cached;
+    size_t max_cached;
+    size_t outstanding;          /* Arenas acquired and not yet released */
+    bool closed;                 /* Owner released the pool */
+    arena_pool_stats_t stats;
+
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+};
+
+/* Helper: Free an arena and every block it holds */
+static void arena_free(httpmorph_arena_t *arena) {
+    arena_reset(arena);
+    free(arena);
+}
+
+/* Helper: Destroy a pool (no arenas outstanding, freelist empty) */
+static void arena_pool_destroy(httpmorph_arena_pool_t *pool) {
+#ifdef _WIN32
+    DeleteCriticalSection(&pool->mutex);
+#else
+    pthread_mutex_destroy(&pool->mutex);
+#endif
+    free(pool);
+}
+
+/* Helper: Add a block with room for size bytes */
+static void* arena_alloc_slow(httpmorph_arena_t *arena, size_t size) {
+    size_t block_size = arena->next_block_size;
+    bool dedicated = size > block_size / 2;
+    if (dedicated) {
+        block_size = size;
+    } else if (arena->next_block_size < ARENA_MAX_BLOCK_SIZE) {
+        arena->next_block_size *= 2;
+    }
+    if (block_size > SIZE_MAX - sizeof(arena_block_t)) {
+        return NULL;
+    }
+
+    arena_block_t *block = malloc(sizeof(arena_block_t) + block_size);
+    if (!block) {
+        return NULL;
+    }
+    block->size = block_size;
+    block->used = size;
+
+    /* A dedicated block goes behind the head so the head keeps its free space */
+    if (dedicated) {
+        block->next = arena->head->next;
+        arena->head->next = block;
+    } else {
+        block->next = arena->head;
+        arena->head = block;
+    }
+    return block->data;
+}
+
+/**
+ * Create an arena pool
+ */
+httpmorph_arena_pool_t* arena_pool_create(size_t max_cached) {
+    httpmorph_arena_pool_t *pool = calloc(1, sizeof(httpmorph_arena_pool_t));
+    if (!pool) {
+        return NULL;
+    }
+    pool->max_cached = max_cached;
+#ifdef _WIN32
+    InitializeCriticalSection(&pool->mutex);
+#else
+    pthread_mutex_init(&pool->mutex, NULL);
+#endif
+    return pool;
+}
+
+/**
+ * Drop the owner's reference to a pool
+ */
+void arena_pool_release(httpmorph_arena_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
+
+    POOL_LOCK(pool);
+    pool->closed = true;
+    httpmorph_arena_t *list = pool->free_list;
+    pool->free_list = NULL;
+    pool->cached = 0;
+    bool destroy = pool->outstanding == 0;
+    POOL_UNLOCK(pool);
+
+    while (list) {
+        httpmorph_arena_t *next = list->next_free;
+        arena_free(list);
+        list = next;
+    }
+    if (destroy) {
+        arena_pool_destroy(pool);
+    }
+}
+
+/**
+ * Take an arena from a pool
+ */
+httpmorph_arena_t* arena_pool_acquire(httpmorph_arena_pool_t *pool) {
+    if (!pool) {
+        return NULL;
+    }
+
+    POOL_LOCK(pool);
+    httpmorph_arena_t *arena = pool->free_list;
+    if (arena) {
+        pool->free_list = arena->next_free;
+        pool->cached--;
+        pool->stats.reused++;
+    } else {
+        pool->stats.created++;
+    }
+    pool->outstanding++;
+    POOL_UNLOCK(pool);
+
+    if (!arena) {
+        arena = arena_create();
+        if (!arena) {
+            POOL_LOCK(pool);
+            pool->outstanding--;
+            POOL_UNLOCK(pool);
+            return NULL;
+        }
+    }
+    arena->next_free = NULL;
+    arena->refs = 1;
+    arena->pool = pool;
+    return arena;
+}
+
+/**
+ * Get pool statistics
+ */
+void arena_pool_stats(httpmorph_arena_pool_t *pool, arena_pool_stats_t *stats) {
+    if (!pool || !stats) {
+        return;
+    }
+    POOL_LOCK(pool);
+    *stats = pool->stats;
+    stats->cached = pool->cached;
+    POOL_UNLOCK(pool);
+}
+
+/**
+ * Create an arena outside any pool
+ */
+httpmorph_arena_t* arena_create(void) {
+    httpmorph_arena_t *arena = malloc(sizeof(httpmorph_arena_t) + sizeof(arena_block_t) + ARENA_BLOCK_SIZE);
+    if (!arena) {
+        return NULL;
+    }
+    arena->first = (arena_block_t*)(arena + 1);
+    arena->first->next = NULL;
+    arena->first->size = ARENA_BLOCK_SIZE;
+    arena->first->used = 0;
+    arena->head = arena->first;
+    arena->next_block_size = ARENA_BLOCK_SIZE * 2;
+    arena->refs = 1;
+    arena->pool = NULL;
+    arena->next_free = NULL;
+    return arena;
+}
+
+/**
+ * Add a reference
+ */
+void arena_retain(httpmorph_arena_t *arena) {
+    if (arena) {
+        ARENA_INC(&arena->refs);
+    }
+}
+
+/**
+ * Drop a reference
+ */
+void arena_release(httpmorph_arena_t *arena) {
+    if (!arena || ARENA_DEC(&arena->refs) != 0) {
+        return;
+    }
+
+    httpmorph_arena_pool_t *pool = arena->pool;
+    if (!pool) {
+        arena_free(arena);
+        return;
+    }
+
+    arena_reset(arena);
+
+    POOL_LOCK(pool);
+    pool->outstanding--;
+    bool keep = !pool->closed && pool->cached < pool->max_cached;
+    if (keep) {
+        arena->next_free = pool->free_list;
+        pool->free_list = arena;
+        pool->cached++;
+    }
+    bool destroy = pool->closed && pool->outstanding == 0;
+    POOL_UNLOCK(pool);
+
+    if (!keep) {
+        free(arena);
+    }
+    if (destroy) {
+        arena_pool_destroy(pool);
+    }
+}
+
+/**
+ * Allocate from an arena
+ */
+void* arena_alloc(httpmorph_arena_t *arena, size_t size) {
+    if (!arena || size > SIZE_MAX - 8) {
+        return NULL;
+    }
+    size = ARENA_ALIGN(size > 0 ? size : 1);
+
+    arena_block_t *block = arena->head;
+    if (block->size - block->used >= size) {
+        void *ptr = block->data + block->used;
+        block->used += size;
+        return ptr;
+    }
+    return arena_alloc_slow(arena, size);
+}
+
+/**
+ * Copy a string into an arena
+ */
+char* arena_strdup(httpmorph_arena_t *arena, const char *str) {
+    if (!str) {
+        return NULL;
+    }
+    return arena_strndup(arena, str, strlen(str));
+}
+
+/**
+ * Copy len bytes of a string into an arena and NUL-terminate it
+ */
+char* arena_strndup(httpmorph_arena_t *arena, const char *str, size_t len) {
+    if (!str || len == SIZE_MAX) {
+        return NULL;
+    }
+    char *copy = arena_alloc(arena, len + 1);
+    if (copy) {
+        memcpy(copy, str, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
+
+/**
+ * Copy a buffer into an arena
+ */
+void* arena_memdup(httpmorph_arena_t *arena, const void *data, size_t len) {
+    void *copy = arena_alloc(arena, len);
+    if (copy && len > 0) {
+        memcpy(copy, data, len);
+    }
+    return copy;
+}
+
+/**
+ * Whether ptr points into memory handed out by this arena
+ */
+bool arena_owns(const httpmorph_arena_t *arena, const void *ptr) {
+    if (!arena || !ptr) {
+        return false;
+    }
+    uintptr_t p = (uintptr_t)ptr;
+    for (const arena_block_t *block = arena->head; block; block = block->next) {
+        uintptr_t start = (uintptr_t)block->data;
+        if (p >= start && p < start + block->used) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Release everything allocated from an arena, keeping its first block
+ */
+void arena_reset(httpmorph_arena_t *arena) {
+    if (!arena) {
+        return;
+    }
+    arena_block_t *block = arena->head;
+    while (block) {
+        arena_block_t *next = block->next;
+        if (block != arena->first) {
+            free(block);
+        }
+        block = next;
+    }
+    arena->first->next = NULL;
+    arena->first->used = 0;
+    arena->head = arena->first;
+    arena->next_block_size = ARENA_BLOCK_SIZE * 2;
+}
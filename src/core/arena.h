@@ -0,0 +1,123 @@
+/**
+ * arena.h - Per-request arena allocator
+ *
+ * A bump allocator over a chain of blocks that lives as long as one
+ * request/response pair. The request and its response each hold a
+ * reference; dropping the last one resets the arena in one step and hands
+ * it back to the pool it came from, which keeps a few reset arenas (with
+ * their first block) for the next request. Allocation is not locked: an
+ * arena is filled by one thread at a time; references and the pool are
+ * thread-safe.
+ */
+
+#ifndef HTTPMORPH_ARENA_H
+#define HTTPMORPH_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Size of an arena's first block (kept across resets) */
+#define ARENA_BLOCK_SIZE 8192
+
+/* Default number of reset arenas a pool keeps */
+#define ARENA_POOL_DEFAULT_CACHED 64
+
+typedef struct httpmorph_arena httpmorph_arena_t;
+typedef struct httpmorph_arena_pool httpmorph_arena_pool_t;
+
+/**
+ * Arena pool statistics
+ */
+typedef struct {
+    uint64_t reused;         /* Acquires served from the freelist */
+    uint64_t created;        /* Acquires that allocated a new arena */
+    size_t cached;           /* Arenas on the freelist now */
+} arena_pool_stats_t;
+
+/**
+ * Create an arena pool
+ *
+ * @param max_cached Reset arenas to keep for reuse
+ * @return Pool or NULL on error
+ */
+httpmorph_arena_pool_t* arena_pool_create(size_t max_cached);
+
+/**
+ * Drop the owner's reference to a pool
+ *
+ * Cached arenas are freed now; arenas still in use keep the pool alive
+ * and are freed when released.
+ */
+void arena_pool_release(httpmorph_arena_pool_t *pool);
+
+/**
+ * Take an arena from a pool (reference count 1)
+ *
+ * @return Arena or NULL on error
+ */
+httpmorph_arena_t* arena_pool_acquire(httpmorph_arena_pool_t *pool);
+
+/**
+ * Get pool statistics
+ */
+void arena_pool_stats(httpmorph_arena_pool_t *pool, arena_pool_stats_t *stats);
+
+/**
+ * Create an arena outside any pool (reference count 1)
+ *
+ * @return Arena or NULL on error
+ */
+httpmorph_arena_t* arena_create(void);
+
+/**
+ * Add a reference
+ */
+void arena_retain(httpmorph_arena_t *arena);
+
+/**
+ * Drop a reference; the last one resets the arena and returns it to its pool
+ */
+void arena_release(httpmorph_arena_t *arena);
+
+/**
+ * Allocate from an arena (8-byte aligned, uninitialized)
+ *
+ * @return Memory valid until the arena is reset, or NULL on error
+ */
+void* arena_alloc(httpmorph_arena_t *arena, size_t size);
+
+/**
+ * Copy a string into an arena
+ */
+char* arena_strdup(httpmorph_arena_t *arena, const char *str);
+
+/**
+ * Copy len bytes of a string into an arena and NUL-terminate it
+ */
+char* arena_strndup(httpmorph_arena_t *arena, const char *str, size_t len);
+
+/**
+ * Copy a buffer into an arena
+ */
+void* arena_memdup(httpmorph_arena_t *arena, const void *data, size_t len);
+
+/**
+ * Whether ptr points into memory handed out by this arena
+ */
+bool arena_owns(const httpmorph_arena_t *arena, const void *ptr);
+
+/**
+ * Release everything allocated from an arena, keeping its first block
+ */
+void arena_reset(httpmorph_arena_t *arena);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_ARENA_H */
@@ -10,7 +10,12 @@
 
 #include "async_request.h"
 #include "io_engine.h"
+#include "ktls.h"
+#include "trace.h"
+#include "internal/network.h"
 #include "internal/proxy.h"
+#include "internal/request.h"
+#include "internal/response.h"
 #include "internal/util.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,6 +38,7 @@
     #include <winsock2.h>
     #include <ws2tcpip.h>
     #include <mswsock.h>   /* For ConnectEx, AcceptEx, etc. */
+    #include "iocp_dispatcher.h"
 
     /* Extension function pointers (loaded dynamically) */
     static LPFN_CONNECTEX pfnConnectEx = NULL;
@@ -41,6 +47,7 @@
     #include <unistd.h>
     #include <errno.h>
     #include <sys/socket.h>
+    #include <sys/uio.h>
     #include <netinet/in.h>
     #include <netdb.h>
     #include <sys/time.h>
@@ -48,8 +55,18 @@
 
 /* Default buffer sizes */
 #define SEND_BUFFER_SIZE (64 * 1024)      /* 64KB */
+#define TLS_RECORD_SIZE 16384             /* Max TLS plaintext per record */
+
+/* async_next_send() result: the body source asked to pause */
+#define ASYNC_SEND_PAUSED 2
 #define RECV_BUFFER_SIZE (256 * 1024)     /* 256KB */
 
+/* Longest a preconnect waits for TLS 1.3 session tickets after its handshake */
+#define PRECONNECT_TICKET_WAIT_MAX_US 500000
+
+/* How often a request with its reads paused checks the memory budget again */
+#define BUDGET_RETRY_US 5000
+
 /* ID generation */
 static uint64_t next_request_id = 1;
 
@@ -113,19 +130,15 @@ static int init_wsa_extensions(int sockfd) {
  * Note: For IOCP, hEvent should be NULL as IOCP uses completion ports
  */
 static void* alloc_overlapped(void) {
-    OVERLAPPED *ov = (OVERLAPPED*)calloc(1, sizeof(OVERLAPPED));
-    /* For IOCP, don't create an event - IOCP uses the completion port */
-    /* hEvent is already NULL from calloc */
-    return ov;
+    /* Reused from the dispatcher's cache when one is free, already zeroed */
+    return iocp_overlapped_get();
 }
 
 /**
  * Free OVERLAPPED structure
  */
 static void free_overlapped(void *overlapped) {
-    if (overlapped) {
-        free(overlapped);
-    }
+    iocp_overlapped_put(overlapped);
 }
 #endif
 
@@ -138,6 +151,7 @@ const char* async_request_state_name(async_request_state_t state) {
         case ASYNC_STATE_DNS_LOOKUP:        return "DNS_LOOKUP";
         case ASYNC_STATE_CONNECTING:        return "CONNECTING";
         case ASYNC_STATE_PROXY_CONNECT:     return "PROXY_CONNECT";
+        case ASYNC_STATE_PROXY_SOCKS5:      return "PROXY_SOCKS5";
         case ASYNC_STATE_TLS_HANDSHAKE:     return "TLS_HANDSHAKE";
         case ASYNC_STATE_SENDING_REQUEST:   return "SENDING_REQUEST";
         case ASYNC_STATE_RECEIVING_HEADERS: return "RECEIVING_HEADERS";
@@ -155,6 +169,7 @@ async_request_t* async_request_create(
     const httpmorph_request_t *request,
     io_engine_t *io_engine,
     SSL_CTX *ssl_ctx,
+    tls_session_cache_t *session_cache,
     uint32_t timeout_ms,
     async_request_callback_t callback,
     void *user_data)
@@ -177,6 +192,8 @@ async_request_t* async_request_create(
     req->ssl = NULL;
     req->refcount = 1;
     req->dns_resolved = false;
+    req->dns_notify_fd = -1;
+    http1_parser_init(&req->header_parser, NULL, 0);
 
     /* Determine if HTTPS first (needed before creating SSL) */
     req->is_https = request->use_tls;
@@ -216,6 +233,7 @@ async_request_t* async_request_create(
     req->overlapped_send = NULL;
     req->overlapped_recv = NULL;
     req->iocp_operation_pending = false;
+    req->iocp_skip_on_success = false;
     req->iocp_last_error = 0;
     req->iocp_bytes_transferred = 0;
     req->iocp_completion_callback = NULL;
@@ -276,6 +294,11 @@ async_request_t* async_request_create(
 
             req->using_proxy = true;
 
+            httpmorph_proxy_type_t proxy_type = httpmorph_proxy_type(request->proxy_url);
+            req->proxy_socks5 = proxy_type == HTTPMORPH_PROXY_SOCKS5 ||
+                                proxy_type == HTTPMORPH_PROXY_SOCKS5H;
+            req->proxy_remote_dns = proxy_type == HTTPMORPH_PROXY_SOCKS5H;
+
             /* Override with explicit proxy credentials if provided */
             if (request->proxy_username) {
                 free(req->proxy_username);
@@ -336,6 +359,18 @@ async_request_t* async_request_create(
             SSL_set_tlsext_host_name(req->ssl, request->host);
         }
 
+        /* Offer a cached session; a resumed one can carry a safe request
+         * as early data (the manager's context has no browser profile) */
+        if (request->host &&
+            tls_session_cache_prepare(session_cache, req->ssl, request->host, request->port,
+                                      NULL, request->verify_ssl) &&
+            request->early_data && httpmorph_request_is_replayable(request)) {
+#ifdef OPENSSL_IS_BORINGSSL
+            SSL_set_early_data_enabled(req->ssl, 1);
+            req->early_data = true;
+#endif
+        }
+
         /* Set SSL to non-blocking mode (will be done when socket is created) */
         DEBUG_PRINT("[async_request] Created SSL object for HTTPS (id=%lu)\n",
                (unsigned long)req->id);
@@ -358,6 +393,14 @@ void async_request_destroy(async_request_t *req) {
         req->current_op = NULL;
     }
 
+    /* Abandon an unfinished lookup and connection race */
+    httpmorph_dns_lookup_release(req->dns_lookup);
+    req->dns_lookup = NULL;
+    happy_eyeballs_destroy(req->he);
+    req->he = NULL;
+    httpmorph_dns_free(req->addrs);
+    req->addrs = NULL;
+
     /* Clean up Windows OVERLAPPED structures and event */
 #ifdef _WIN32
     free_overlapped(req->overlapped_connect);
@@ -393,6 +436,10 @@ void async_request_destroy(async_request_t *req) {
     /* Free buffers */
     free(req->send_buf);
     free(req->recv_buf);
+    mem_budget_release(req->budget, req->budget_charged);
+    mem_budget_finish(req->budget, req);
+    mem_budget_unref(req->budget);
+    req->budget = NULL;
 
     /* Free proxy buffers and strings */
     free(req->proxy_host);
@@ -400,6 +447,8 @@ void async_request_destroy(async_request_t *req) {
     free(req->proxy_password);
     free(req->target_host);
     free(req->proxy_recv_buf);
+    free(req->socks5);
+    httpmorph_dns_free(req->socks5_target);
 
     /* Free response if allocated */
     if (req->response) {
@@ -407,27 +456,49 @@ void async_request_destroy(async_request_t *req) {
         req->response = NULL;
     }
 
+    /* Earlier redirect hops never handed over, and this hop's own request */
+    httpmorph_response_destroy(req->redirect_from);
+    req->redirect_from = NULL;
+    httpmorph_request_destroy(req->owned_request);
+    req->owned_request = NULL;
+
     free(req);
 }
 
 /**
  * Reference counting
+ * Atomic because the manager's event thread and the Python thread both
+ * hold references to completed requests.
  */
+#ifdef _WIN32
+    #define REFCOUNT_INC(p) InterlockedIncrement((volatile LONG*)(p))
+    #define REFCOUNT_DEC(p) InterlockedDecrement((volatile LONG*)(p))
+#else
+    #define REFCOUNT_INC(p) __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define REFCOUNT_DEC(p) __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+#endif
+
 void async_request_ref(async_request_t *req) {
     if (req) {
-        req->refcount++;
+        REFCOUNT_INC(&req->refcount);
     }
 }
 
 void async_request_unref(async_request_t *req) {
     if (req) {
-        req->refcount--;
-        if (req->refcount <= 0) {
+        if (REFCOUNT_DEC(&req->refcount) <= 0) {
             async_request_destroy(req);
         }
     }
 }
 
+/**
+ * Get request ID
+ */
+uint64_t async_request_get_id(const async_request_t *req) {
+    return req ? req->id : 0;
+}
+
 /**
  * Get current state
  */
@@ -439,17 +510,197 @@ async_request_state_t async_request_get_state(const async_request_t *req) {
  * Get file descriptor
  */
 int async_request_get_fd(const async_request_t *req) {
-    return req ? req->sockfd : -1;
+    if (!req) {
+        return -1;
+    }
+    if (req->sockfd < 0 && req->he) {
+        /* Older attempts stay registered from when they were the newest */
+        for (size_t i = happy_eyeballs_attempt_count(req->he); i > 0; i--) {
+            int fd = happy_eyeballs_attempt_fd(req->he, i - 1);
+            if (fd >= 0) {
+                return fd;
+            }
+        }
+    }
+    return req->sockfd;
 }
 
 /**
  * Check timeout
  */
 bool async_request_is_timeout(const async_request_t *req) {
-    if (!req || req->deadline_us == 0) {
+    if (!req || (req->deadline_us == 0 && req->phase_deadline_us == 0)) {
         return false;
     }
-    return get_time_us() >= req->deadline_us;
+    uint64_t now = get_time_us();
+    return (req->deadline_us != 0 && now >= req->deadline_us) ||
+           (req->phase_deadline_us != 0 && now >= req->phase_deadline_us);
+}
+
+/**
+ * Get the next time the request must be stepped without I/O readiness
+ */
+uint64_t async_request_next_due_us(const async_request_t *req) {
+    uint64_t due = 0;
+    const uint64_t times[3] = { req->deadline_us, req->phase_deadline_us, req->wake_at_us };
+    for (int i = 0; i < 3; i++) {
+        if (times[i] != 0 && (due == 0 || times[i] < due)) {
+            due = times[i];
+        }
+    }
+    return due;
+}
+
+/**
+ * Get the clock used for request deadlines
+ */
+uint64_t async_request_now_us(void) {
+    return get_time_us();
+}
+
+/**
+ * Note when the request reached each phase
+ * Phases skipped (a reused connection, plain HTTP) start with the next
+ * one, so they take no time.
+ */
+static void async_request_track_timings(async_request_t *req) {
+    if (req->state == ASYNC_STATE_ERROR) {
+        return;
+    }
+    uint64_t now = get_time_us();
+    uint64_t *starts[4] = { &req->dns_start_us, &req->connect_start_us,
+                            &req->tls_start_us, &req->send_start_us };
+    const async_request_state_t phases[4] = { ASYNC_STATE_DNS_LOOKUP, ASYNC_STATE_CONNECTING,
+                                              ASYNC_STATE_TLS_HANDSHAKE,
+                                              ASYNC_STATE_SENDING_REQUEST };
+    for (int i = 0; i < 4; i++) {
+        if (req->state >= phases[i] && *starts[i] == 0) {
+            *starts[i] = now;
+        }
+    }
+
+    httpmorph_response_t *response = req->response;
+    if (req->state != ASYNC_STATE_COMPLETE || !response) {
+        return;
+    }
+    response->queue_time_us = req->started_us - req->start_time_us;
+    response->dns_time_us = req->connect_start_us - req->dns_start_us;
+    response->connect_time_us = req->connection_reused ? 0 : req->tls_start_us - req->dns_start_us;
+    response->tls_time_us = req->send_start_us - req->tls_start_us;
+    response->first_byte_time_us = req->first_byte_us ? req->first_byte_us - req->started_us : 0;
+    response->total_time_us = now - req->started_us;
+    response->connection_reused = req->connection_reused;
+    response->tls_resumed = req->tls_resumed;
+    response->body_wire_len = req->body_received;
+}
+
+/**
+ * Start the limit for the phase the request just entered
+ * Connect and TLS limits cover their state; the first-byte limit runs
+ * from the request being sent until response bytes arrive.
+ */
+static void async_request_track_phase(async_request_t *req) {
+    const httpmorph_request_t *request = req->request;
+
+    if (req->first_byte_us == 0 &&
+        ((req->state == ASYNC_STATE_RECEIVING_HEADERS && req->recv_len > 0) ||
+         req->state == ASYNC_STATE_RECEIVING_BODY || req->state == ASYNC_STATE_COMPLETE)) {
+        req->first_byte_us = get_time_us();
+    }
+
+    if (req->state == req->phase_state) {
+        if (req->state == ASYNC_STATE_RECEIVING_HEADERS && req->recv_len > 0) {
+            req->phase_deadline_us = 0;  /* First byte is in */
+        }
+        return;
+    }
+    HTTPMORPH_PROBE3(request__state, req->id, (int)req->phase_state, (int)req->state);
+    req->phase_state = req->state;
+    async_request_track_timings(req);
+
+    uint32_t limit_ms = 0;
+    switch (req->state) {
+        case ASYNC_STATE_CONNECTING:
+            limit_ms = request->connect_timeout_ms;
+            break;
+        case ASYNC_STATE_TLS_HANDSHAKE:
+            limit_ms = request->tls_timeout_ms;
+            break;
+        case ASYNC_STATE_RECEIVING_HEADERS:
+            limit_ms = request->first_byte_timeout_ms;
+            break;
+        default:
+            break;
+    }
+    req->phase_deadline_us = limit_ms ? get_time_us() + (uint64_t)limit_ms * 1000 : 0;
+}
+
+/**
+ * Error message for an expired limit
+ */
+static const char* async_request_timeout_reason(const async_request_t *req) {
+    if (req->phase_deadline_us == 0 || get_time_us() < req->phase_deadline_us) {
+        return "Request timeout";
+    }
+    switch (req->phase_state) {
+        case ASYNC_STATE_CONNECTING:
+            return "Connect timeout";
+        case ASYNC_STATE_TLS_HANDSHAKE:
+            return "TLS handshake timeout";
+        case ASYNC_STATE_RECEIVING_HEADERS:
+            return "Timed out waiting for the first response byte";
+        default:
+            return "Request timeout";
+    }
+}
+
+/**
+ * Charge the request's receive buffer to a memory budget
+ */
+void async_request_set_memory_budget(async_request_t *req, mem_budget_t *budget) {
+    if (!req || req->budget) {
+        return;
+    }
+    mem_budget_ref(budget);
+    req->budget = budget;
+}
+
+/* Helper: Charge the receive buffer at a new capacity to the memory budget
+ * Returns false with reads paused when the budget has no room; the request
+ * tries again at its next wake. */
+static bool async_budget_charge(async_request_t *req, size_t capacity) {
+    if (!req->budget || capacity <= req->budget_charged) {
+        return true;
+    }
+    if (!mem_budget_try_charge(req->budget, capacity - req->budget_charged, req,
+                               &req->budget_stalled)) {
+        req->budget_wait = true;
+        req->wake_at_us = get_time_us() + BUDGET_RETRY_US;
+        return false;
+    }
+    req->budget_charged = capacity;
+    if (req->budget_wait) {
+        req->budget_wait = false;
+        req->wake_at_us = 0;
+    }
+    return true;
+}
+
+/**
+ * Check if the request is waiting for its DNS lookup
+ */
+bool async_request_dns_pending(const async_request_t *req) {
+    return req && req->dns_lookup && !httpmorph_dns_lookup_done(req->dns_lookup);
+}
+
+/**
+ * Check if the next connection attempt is due
+ */
+bool async_request_wake_due(const async_request_t *req) {
+    if (!req || req->wake_at_us == 0) {
+        return false;
+    }
+    return get_time_us() >= req->wake_at_us;
 }
 
 /**
@@ -487,6 +738,172 @@ const char* async_request_get_error_message(const async_request_t *req) {
     return req->error_msg;
 }
 
+/**
+ * Complete a request with the response of a duplicate that finished first
+ */
+void async_request_adopt(async_request_t *req, async_request_t *winner) {
+    if (!req || !winner) {
+        return;
+    }
+
+    httpmorph_response_t *response = req->response;
+    req->response = winner->response;
+    winner->response = response;
+
+    req->first_byte_us = winner->first_byte_us;
+    req->phase_deadline_us = 0;
+    req->error_code = 0;
+    req->error_msg[0] = '\0';
+    req->state = ASYNC_STATE_COMPLETE;
+    if (req->on_complete) {
+        req->on_complete(req, ASYNC_STATUS_COMPLETE);
+    }
+}
+
+/**
+ * Find a header in a finished request's received head
+ * Returns the value (not terminated) and sets *len, or NULL if absent.
+ */
+static const char* async_head_header(const async_request_t *req, const char *name, size_t *len) {
+    if (!req->headers_complete || !req->recv_buf) {
+        return NULL;
+    }
+
+    http1_header_span_t spans[HTTP1_MAX_HEADERS];
+    http1_parser_t parser;
+    http1_parser_init(&parser, spans, HTTP1_MAX_HEADERS);
+    const char *head = (const char *)req->recv_buf;
+    if (http1_parser_feed(&parser, head, req->headers_end_pos) != HTTP1_PARSE_COMPLETE) {
+        return NULL;
+    }
+
+    size_t name_len = strlen(name);
+    for (size_t i = 0; i < parser.header_count; i++) {
+        if (spans[i].name_len == name_len && strncasecmp(head + spans[i].name, name, name_len) == 0) {
+            *len = spans[i].value_len;
+            return head + spans[i].value;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Get where a finished response redirects to
+ */
+char* async_request_redirect_location(const async_request_t *req) {
+    if (!req || req->state != ASYNC_STATE_COMPLETE) {
+        return NULL;
+    }
+    switch (req->header_parser.status_code) {
+        case 301: case 302: case 303: case 307: case 308:
+            break;
+        default:
+            return NULL;
+    }
+
+    size_t len;
+    const char *value = async_head_header(req, "Location", &len);
+    if (!value || len == 0) {
+        return NULL;
+    }
+    char *location = malloc(len + 1);
+    if (location) {
+        memcpy(location, value, len);
+        location[len] = '\0';
+    }
+    return location;
+}
+
+/**
+ * Check that a connection left idle since its handshake is still usable
+ * EOF or an error means the server closed it. Bytes waiting on a TLS
+ * connection are session tickets the next read takes; plaintext HTTP/1.1
+ * must be quiet until a request is sent.
+ */
+static bool async_idle_connection_open(const async_request_t *from) {
+    char byte;
+    int n = (int)recv(from->sockfd, &byte, 1, MSG_PEEK);
+    if (n > 0) {
+        return from->ssl != NULL;
+    }
+    if (n == 0) {
+        return false;
+    }
+#ifdef _WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+/**
+ * Check that a finished response left its connection ready for another
+ * The response must have ended exactly where its framing says, on an
+ * HTTP/1.1 connection the server keeps open.
+ */
+static bool async_response_left_open(const async_request_t *from) {
+    if (from->request->method == HTTPMORPH_HEAD || !from->header_parser.has_content_length ||
+        from->chunked_encoding || from->body_received != from->content_length ||
+        from->headers_end_pos < 8 || memcmp(from->recv_buf, "HTTP/1.1", 8) != 0) {
+        return false;
+    }
+    size_t len;
+    const char *connection = async_head_header(from, "Connection", &len);
+    for (size_t i = 0; connection && i + 5 <= len; i++) {
+        if (strncasecmp(connection + i, "close", 5) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Move a finished request's connection to a request that hasn't started
+ */
+bool async_request_take_connection(async_request_t *req, async_request_t *from) {
+    if (!req || !from || req->state != ASYNC_STATE_INIT || from->state != ASYNC_STATE_COMPLETE ||
+        from->sockfd < 0 || from->ktls_rx || req->using_proxy || from->using_proxy ||
+        req->is_https != from->is_https || (from->is_https && !from->ssl)) {
+        return false;
+    }
+
+    /* Same origin */
+    const httpmorph_request_t *a = req->request;
+    const httpmorph_request_t *b = from->request;
+    if (!a->host || !b->host || a->port != b->port || strcasecmp(a->host, b->host) != 0) {
+        return false;
+    }
+
+    /* A preconnect carried nothing: the connection only has to be open */
+    if (from->connect_only ? !async_idle_connection_open(from) : !async_response_left_open(from)) {
+        return false;
+    }
+
+    if (req->ssl) {
+        SSL_free(req->ssl);
+    }
+    req->ssl = from->ssl;
+    from->ssl = NULL;
+    req->sockfd = from->sockfd;
+    from->sockfd = -1;
+    req->dns_resolved = true;
+    req->connection_reused = true;
+    req->state = ASYNC_STATE_SENDING_REQUEST;
+    return true;
+}
+
+/**
+ * Get the host the socket connects to (the proxy when using one)
+ */
+static const char* connect_host(const async_request_t *req, uint16_t *port) {
+    if (req->using_proxy) {
+        *port = req->proxy_port;
+        return req->proxy_host;
+    }
+    *port = req->request->port;
+    return req->request->host;
+}
+
 /**
  * State: DNS lookup
  */
@@ -497,21 +914,28 @@ static int step_dns_lookup(async_request_t *req) {
         return ASYNC_STATUS_IN_PROGRESS;
     }
 
-    /* Perform blocking DNS lookup (for now) */
-    /* Note: In production, this should use async DNS (getaddrinfo_a or thread pool) */
-
-    /* If using proxy, resolve proxy hostname instead of target hostname */
-    const char *hostname;
+    /* If using proxy, resolve proxy hostname instead of target hostname;
+     * socks5:// resolves the target first, to hand the proxy an address */
     uint16_t port;
-
-    if (req->using_proxy) {
-        hostname = req->proxy_host;
-        port = req->proxy_port;
+    const char *hostname = connect_host(req, &port);
+    int target_family = AF_UNSPEC;
+    int *preferred_family = &req->preferred_family;
+    bool target_lookup = req->proxy_socks5 && !req->proxy_remote_dns && !req->socks5_target;
+    if (target_lookup) {
+        hostname = req->target_host;
+        port = req->target_port;
+        preferred_family = &target_family;
+    }
+
+    if (req->dns_lookup) {
+        /* Woken by the resolver (or polled) - still waiting? */
+        if (!httpmorph_dns_lookup_done(req->dns_lookup)) {
+            return ASYNC_STATUS_NEED_DNS;
+        }
+    } else if (req->using_proxy) {
         DEBUG_PRINT("[async_request] Resolving proxy %s:%u (target: %s:%u) (id=%lu)\n",
                hostname, port, req->target_host, req->target_port, (unsigned long)req->id);
     } else {
-        hostname = req->request->host;
-        port = req->request->port;
         DEBUG_PRINT("[async_request] Resolving %s:%u (id=%lu)\n",
                hostname, port, (unsigned long)req->id);
     }
@@ -521,49 +945,166 @@ static int step_dns_lookup(async_request_t *req) {
         return ASYNC_STATUS_ERROR;
     }
 
-    /* Setup hints for getaddrinfo */
-    struct addrinfo hints;
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_UNSPEC;     /* Allow IPv4 or IPv6 */
-    hints.ai_socktype = SOCK_STREAM; /* TCP socket */
-    hints.ai_flags = AI_ADDRCONFIG;  /* Only return addresses we can use */
-
-    /* Convert port to string */
-    char port_str[16];
-    snprintf(port_str, sizeof(port_str), "%u", port);
-
-    /* Perform DNS lookup */
+    /* Shared DNS cache first, then the resolver threads (never blocks this thread) */
+    int gai_error = 0;
     struct addrinfo *result = NULL;
-    int ret = getaddrinfo(hostname, port_str, &hints, &result);
+    if (req->dns_lookup) {
+        result = httpmorph_dns_lookup_result(req->dns_lookup, &gai_error);
+        httpmorph_dns_lookup_release(req->dns_lookup);
+        req->dns_lookup = NULL;
+    } else {
+        result = httpmorph_dns_cache_get(hostname, port, preferred_family, &gai_error);
+        if (!result && gai_error == 0) {
+            req->dns_lookup = httpmorph_resolver_start(hostname, port, req->dns_notify_fd);
+            if (!req->dns_lookup) {
+                async_request_set_error(req, -1, "Failed to start DNS lookup");
+                return ASYNC_STATUS_ERROR;
+            }
+            return ASYNC_STATUS_NEED_DNS;
+        }
+    }
 
-    if (ret != 0) {
+    if (!result) {
         char error_buf[256];
-        snprintf(error_buf, sizeof(error_buf), "DNS lookup failed: %s", gai_strerror(ret));
-        async_request_set_error(req, ret, error_buf);
+        if (gai_error != 0) {
+            snprintf(error_buf, sizeof(error_buf), "DNS lookup failed: %s", gai_strerror(gai_error));
+            async_request_set_error(req, gai_error, error_buf);
+        } else {
+            async_request_set_error(req, -1, "DNS lookup returned no results");
+        }
         return ASYNC_STATUS_ERROR;
     }
 
-    if (!result) {
-        async_request_set_error(req, -1, "DNS lookup returned no results");
-        return ASYNC_STATUS_ERROR;
+    if (target_lookup) {
+        /* Now resolve the proxy itself */
+        req->socks5_target = result;
+        return ASYNC_STATUS_IN_PROGRESS;
     }
 
-    /* Store the first result */
+    /* Keep every address for the connection race, and the first one for ConnectEx */
     memcpy(&req->addr, result->ai_addr, result->ai_addrlen);
     req->addr_len = result->ai_addrlen;
+    req->addrs = result;
     req->dns_resolved = true;
 
     DEBUG_PRINT("[async_request] DNS resolved for %s:%u (id=%lu)\n",
            hostname, port, (unsigned long)req->id);
 
-    /* Free the result */
-    freeaddrinfo(result);
-
     /* Move to connecting state */
     req->state = ASYNC_STATE_CONNECTING;
     return ASYNC_STATUS_IN_PROGRESS;
 }
 
+/**
+ * Move on from a connected socket
+ */
+static int step_connected(async_request_t *req) {
+    DEBUG_PRINT("[async_request] Connected successfully on fd=%d (id=%lu)\n",
+           req->sockfd, (unsigned long)req->id);
+
+    /* Move to next state */
+    if (req->proxy_socks5) {
+        /* SOCKS5 proxy: tunnel both HTTP and HTTPS */
+        req->state = ASYNC_STATE_PROXY_SOCKS5;
+    } else if (req->using_proxy && req->is_https) {
+        /* HTTPS via proxy: establish tunnel with CONNECT */
+        req->state = ASYNC_STATE_PROXY_CONNECT;
+    } else if (req->using_proxy && !req->is_https) {
+        /* HTTP via proxy: send request directly to proxy (no CONNECT needed) */
+        req->state = ASYNC_STATE_SENDING_REQUEST;
+        /* For HTTP proxy, wait for socket to be writable before sending */
+        return ASYNC_STATUS_NEED_WRITE;
+    } else if (req->is_https) {
+        /* Direct HTTPS connection, do TLS handshake */
+        req->state = ASYNC_STATE_TLS_HANDSHAKE;
+    } else {
+        /* Direct HTTP connection, send request */
+        req->state = ASYNC_STATE_SENDING_REQUEST;
+        /* For plain HTTP, wait for socket to be writable before sending */
+        return ASYNC_STATUS_NEED_WRITE;
+    }
+    return ASYNC_STATUS_IN_PROGRESS;
+}
+
+/* Helper: Socket options for each connection attempt */
+static void connect_attempt_setup(int sockfd) {
+    io_socket_set_performance_opts(sockfd);
+}
+
+/* Helper: Socket options for each connection attempt, with TCP Fast Open */
+static void connect_attempt_setup_fast_open(int sockfd) {
+    io_socket_set_performance_opts(sockfd);
+    httpmorph_socket_enable_fast_open(sockfd);
+}
+
+/* Helper: Check if the connection may use TCP Fast Open (direct only; over
+ * plain HTTP the SYN carries the request itself, so it must be replayable) */
+static bool connect_fast_open(const async_request_t *req) {
+    const httpmorph_request_t *request = req->request;
+    if (!request->tcp_fast_open || req->using_proxy) {
+        return false;
+    }
+    return req->is_https || httpmorph_request_is_replayable(request);
+}
+
+/**
+ * Race non-blocking connects across all resolved addresses (Happy Eyeballs)
+ */
+static int step_connect_race(async_request_t *req) {
+    if (!req->he) {
+        req->he = happy_eyeballs_create(req->addrs, req->preferred_family, 0,
+                                        connect_fast_open(req) ? connect_attempt_setup_fast_open
+                                                               : connect_attempt_setup);
+        if (!req->he) {
+            async_request_set_error(req, -1, "Failed to create socket");
+            return ASYNC_STATUS_ERROR;
+        }
+
+        DEBUG_PRINT("[async_request] Connecting to %s:%u across %zu addresses (id=%lu)\n",
+               req->request->host, req->request->port,
+               happy_eyeballs_attempt_count(req->he), (unsigned long)req->id);
+    }
+
+    int rc = happy_eyeballs_step(req->he, get_time_us());
+    if (rc == HAPPY_EYEBALLS_IN_PROGRESS) {
+        /* Wait for an attempt to finish, or step again when the next one is due */
+        req->wake_at_us = happy_eyeballs_next_attempt_us(req->he);
+        return ASYNC_STATUS_NEED_WRITE;
+    }
+    req->wake_at_us = 0;
+
+    if (rc == HAPPY_EYEBALLS_FAILED) {
+        int error = happy_eyeballs_last_error(req->he);
+        char error_buf[256];
+#ifdef _WIN32
+        snprintf(error_buf, sizeof(error_buf), "Connection failed: %d", error);
+#else
+        snprintf(error_buf, sizeof(error_buf), "Connection failed: %s", strerror(error));
+#endif
+        async_request_set_error(req, error, error_buf);
+        return ASYNC_STATUS_ERROR;
+    }
+
+    int family = AF_UNSPEC;
+    req->sockfd = happy_eyeballs_take_winner(req->he, &family);
+    happy_eyeballs_destroy(req->he);  /* Closes the losing attempts */
+    req->he = NULL;
+
+    /* The I/O operation may still name a closed attempt socket */
+    if (req->current_op) {
+        req->current_op->fd = req->sockfd;
+    }
+
+    if (family != req->preferred_family) {
+        uint16_t port;
+        const char *host = connect_host(req, &port);
+        httpmorph_dns_set_preferred_family(host, port, family);
+        req->preferred_family = family;
+    }
+
+    return step_connected(req);
+}
+
 /**
  * State: Connecting
  */
@@ -576,25 +1117,25 @@ static int step_connecting(async_request_t *req) {
 
     /* If socket not created yet, create it and initiate connection */
     if (req->sockfd < 0) {
-        /* Get address family from resolved address */
-        int af = ((struct sockaddr*)&req->addr)->sa_family;
+#ifdef _WIN32
+        /* Windows IOCP path with ConnectEx (first address only) - skip for SSL sockets */
+        if (req->io_engine && req->io_engine->type == IO_ENGINE_IOCP && !req->is_https) {
+            /* Get address family from resolved address */
+            int af = ((struct sockaddr*)&req->addr)->sa_family;
 
-        /* Create non-blocking socket */
-        req->sockfd = io_socket_create_nonblocking(af, SOCK_STREAM, 0);
-        if (req->sockfd < 0) {
-            async_request_set_error(req, errno, "Failed to create socket");
-            return ASYNC_STATUS_ERROR;
-        }
+            /* Create non-blocking socket */
+            req->sockfd = io_socket_create_nonblocking(af, SOCK_STREAM, 0);
+            if (req->sockfd < 0) {
+                async_request_set_error(req, errno, "Failed to create socket");
+                return ASYNC_STATUS_ERROR;
+            }
 
-        /* Set performance options */
-        io_socket_set_performance_opts(req->sockfd);
+            /* Set performance options */
+            io_socket_set_performance_opts(req->sockfd);
 
-        DEBUG_PRINT("[async_request] Connecting to %s:%u on fd=%d (id=%lu)\n",
-               req->request->host, req->request->port, req->sockfd, (unsigned long)req->id);
+            DEBUG_PRINT("[async_request] Connecting to %s:%u on fd=%d (id=%lu)\n",
+                   req->request->host, req->request->port, req->sockfd, (unsigned long)req->id);
 
-#ifdef _WIN32
-        /* Windows IOCP path with ConnectEx - skip for SSL sockets */
-        if (req->io_engine && req->io_engine->type == IO_ENGINE_IOCP && !req->is_https) {
             /* Initialize WSA extensions if needed */
             if (init_wsa_extensions(req->sockfd) < 0) {
                 async_request_set_error(req, -1, "Failed to load WSA extensions");
@@ -627,6 +1168,8 @@ static int step_connecting(async_request_t *req) {
                     async_request_set_error(req, req->iocp_last_error, error_buf);
                     return ASYNC_STATUS_ERROR;
                 }
+                /* Inline successes then queue nothing that could signal a later operation */
+                req->iocp_skip_on_success = iocp_skip_completion_on_success(req->sockfd);
                 DEBUG_PRINT("[async_request] Socket fd=%d associated with IOCP, completion_key=%p (id=%lu)\n",
                        req->sockfd, (void*)req, (unsigned long)req->id);
             } else {
@@ -670,37 +1213,20 @@ static int step_connecting(async_request_t *req) {
             req->iocp_operation_pending = false;
             DEBUG_PRINT("[async_request] ConnectEx completed immediately (id=%lu)\n", (unsigned long)req->id);
 
-            /* Update socket context (required after ConnectEx) */
-            setsockopt(req->sockfd, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, NULL, 0);
-
-            /* Move to next state */
-            if (req->using_proxy && req->is_https) {
-                /* HTTPS via proxy: establish tunnel with CONNECT */
-                req->state = ASYNC_STATE_PROXY_CONNECT;
-            } else if (req->using_proxy && !req->is_https) {
-                /* HTTP via proxy: send request directly to proxy (no CONNECT needed) */
-                req->state = ASYNC_STATE_SENDING_REQUEST;
-            } else if (req->is_https) {
-                /* Direct HTTPS connection, do TLS handshake */
-                req->state = ASYNC_STATE_TLS_HANDSHAKE;
-            } else {
-                /* Direct HTTP connection, send request */
-                req->state = ASYNC_STATE_SENDING_REQUEST;
+            /* No packet is coming for it, so the OVERLAPPED is free again */
+            if (req->iocp_skip_on_success) {
+                free_overlapped(req->overlapped_connect);
+                req->overlapped_connect = NULL;
             }
-            return ASYNC_STATUS_IN_PROGRESS;
-        }
-#endif
 
-        /* Non-Windows or non-IOCP path: standard non-blocking connect */
-        int ret = connect(req->sockfd, (struct sockaddr*)&req->addr, req->addr_len);
-
-        if (ret == 0) {
-            /* Connected immediately (rare for non-blocking) */
-            DEBUG_PRINT("[async_request] Connected immediately (id=%lu)\n",
-                   (unsigned long)req->id);
+            /* Update socket context (required after ConnectEx) */
+            setsockopt(req->sockfd, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, NULL, 0);
 
             /* Move to next state */
-            if (req->using_proxy && req->is_https) {
+            if (req->proxy_socks5) {
+                /* SOCKS5 proxy: tunnel both HTTP and HTTPS */
+                req->state = ASYNC_STATE_PROXY_SOCKS5;
+            } else if (req->using_proxy && req->is_https) {
                 /* HTTPS via proxy: establish tunnel with CONNECT */
                 req->state = ASYNC_STATE_PROXY_CONNECT;
             } else if (req->using_proxy && !req->is_https) {
@@ -715,22 +1241,10 @@ static int step_connecting(async_request_t *req) {
             }
             return ASYNC_STATUS_IN_PROGRESS;
         }
-
-#ifndef _WIN32
-        if (errno == EINPROGRESS) {
-            /* Connection in progress, wait for writable */
-            return ASYNC_STATUS_NEED_WRITE;
-        }
-#else
-        if (WSAGetLastError() == WSAEWOULDBLOCK) {
-            /* Connection in progress, wait for writable */
-            return ASYNC_STATUS_NEED_WRITE;
-        }
 #endif
 
-        /* Connect failed immediately */
-        async_request_set_error(req, errno, "Connection failed");
-        return ASYNC_STATUS_ERROR;
+        /* Non-Windows or non-IOCP path: race every resolved address */
+        return step_connect_race(req);
     }
 
     /* Socket already exists, check if connect completed */
@@ -749,6 +1263,10 @@ static int step_connecting(async_request_t *req) {
             /* Reset event for next operation */
             ResetEvent((HANDLE)req->iocp_completion_event);
 
+            /* The packet has been dequeued: nothing references the OVERLAPPED now */
+            free_overlapped(req->overlapped_connect);
+            req->overlapped_connect = NULL;
+
             /* Check socket error to get actual connection result */
             int sock_error = 0;
             socklen_t len = sizeof(sock_error);
@@ -759,7 +1277,10 @@ static int step_connecting(async_request_t *req) {
                     setsockopt(req->sockfd, SOL_SOCKET, SO_UPDATE_CONNECT_CONTEXT, NULL, 0);
 
                     /* Move to next state */
-                    if (req->using_proxy && req->is_https) {
+                    if (req->proxy_socks5) {
+                        /* SOCKS5 proxy: tunnel both HTTP and HTTPS */
+                        req->state = ASYNC_STATE_PROXY_SOCKS5;
+                    } else if (req->using_proxy && req->is_https) {
                         /* HTTPS via proxy: establish tunnel with CONNECT */
                         req->state = ASYNC_STATE_PROXY_CONNECT;
                         /* Wait one more cycle to ensure socket is fully ready */
@@ -835,7 +1356,10 @@ static int step_connecting(async_request_t *req) {
                            (unsigned long)req->id);
 
                     /* Move to next state */
-                    if (req->using_proxy && req->is_https) {
+                    if (req->proxy_socks5) {
+                        /* SOCKS5 proxy: tunnel both HTTP and HTTPS */
+                        req->state = ASYNC_STATE_PROXY_SOCKS5;
+                    } else if (req->using_proxy && req->is_https) {
                         /* HTTPS via proxy: establish tunnel with CONNECT */
                         req->state = ASYNC_STATE_PROXY_CONNECT;
                         /* Wait one more cycle to ensure socket is fully ready */
@@ -875,29 +1399,7 @@ static int step_connecting(async_request_t *req) {
     socklen_t len = sizeof(error);
     if (getsockopt(req->sockfd, SOL_SOCKET, SO_ERROR, &error, &len) == 0) {
         if (error == 0) {
-            /* Connection successful */
-            DEBUG_PRINT("[async_request] Connected successfully (id=%lu)\n",
-                   (unsigned long)req->id);
-
-            /* Move to next state */
-            if (req->using_proxy && req->is_https) {
-                /* HTTPS via proxy: establish tunnel with CONNECT */
-                req->state = ASYNC_STATE_PROXY_CONNECT;
-            } else if (req->using_proxy && !req->is_https) {
-                /* HTTP via proxy: send request directly to proxy (no CONNECT needed) */
-                req->state = ASYNC_STATE_SENDING_REQUEST;
-                /* For HTTP proxy, wait for socket to be writable before sending */
-                return ASYNC_STATUS_NEED_WRITE;
-            } else if (req->is_https) {
-                /* Direct HTTPS connection, do TLS handshake */
-                req->state = ASYNC_STATE_TLS_HANDSHAKE;
-            } else {
-                /* Direct HTTP connection, send request */
-                req->state = ASYNC_STATE_SENDING_REQUEST;
-                /* For plain HTTP, wait for socket to be writable before sending */
-                return ASYNC_STATUS_NEED_WRITE;
-            }
-            return ASYNC_STATUS_IN_PROGRESS;
+            return step_connected(req);
         } else if (error == EINPROGRESS || error == EALREADY) {
             /* Still connecting, need to wait */
             return ASYNC_STATUS_NEED_WRITE;
@@ -941,9 +1443,12 @@ static int step_tls_handshake(async_request_t *req) {
     int ret = SSL_do_handshake(req->ssl);
 
     if (ret == 1) {
-        /* Handshake complete */
+        /* Handshake complete, or far enough along to send early data (the
+         * rest completes under SSL_write/SSL_read) */
         DEBUG_PRINT("[async_request] TLS handshake complete (id=%lu)\n",
                (unsigned long)req->id);
+        tls_session_cache_handshake_done(req->ssl);
+        req->tls_resumed = SSL_session_reused(req->ssl) == 1;
 
         req->state = ASYNC_STATE_SENDING_REQUEST;
         /* Continue immediately to sending */
@@ -991,6 +1496,16 @@ static int step_tls_handshake(async_request_t *req) {
     }
 }
 
+/* Helper: Append to the send buffer (keeps one byte spare, as snprintf did); -1 if full */
+static int send_buf_append(char *buf, size_t *len, const char *data, size_t n) {
+    if (n >= SEND_BUFFER_SIZE - *len) {
+        return -1;
+    }
+    memcpy(buf + *len, data, n);
+    *len += n;
+    return 0;
+}
+
 /**
  * Build HTTP request from httpmorph_request_t structure
  */
@@ -1012,7 +1527,7 @@ static int build_http_request(async_request_t *req) {
 
     /* For HTTP through proxy, use absolute URI. For HTTPS or direct, use path only. */
     const char *request_target;
-    bool use_absolute_uri = (req->proxy_host && !req->is_https);
+    bool use_absolute_uri = (req->proxy_host && !req->is_https && !req->proxy_socks5);
 
     if (use_absolute_uri) {
         /* HTTP through proxy: use full URL as request target */
@@ -1032,16 +1547,18 @@ static int build_http_request(async_request_t *req) {
 
     /* Build request line: METHOD request-target HTTP/1.1\r\n */
     char *buf = (char *)req->send_buf;
-    int written = snprintf(buf, SEND_BUFFER_SIZE,
-                          "%s %s HTTP/1.1\r\n", method_str, request_target);
-    if (written < 0 || written >= (int)SEND_BUFFER_SIZE) {
+    size_t written = 0;
+    if (send_buf_append(buf, &written, method_str, strlen(method_str)) < 0 ||
+        send_buf_append(buf, &written, " ", 1) < 0 ||
+        send_buf_append(buf, &written, request_target, strlen(request_target)) < 0 ||
+        send_buf_append(buf, &written, " HTTP/1.1\r\nHost: ", 17) < 0) {
         return -1;
     }
 
     /* Add Host header */
-    written += snprintf(buf + written, SEND_BUFFER_SIZE - written,
-                       "Host: %s\r\n", request->host ? request->host : "localhost");
-    if (written >= (int)SEND_BUFFER_SIZE) {
+    const char *host = request->host ? request->host : "localhost";
+    if (send_buf_append(buf, &written, host, strlen(host)) < 0 ||
+        send_buf_append(buf, &written, "\r\n", 2) < 0) {
         return -1;
     }
 
@@ -1055,62 +1572,264 @@ static int build_http_request(async_request_t *req) {
 
         char *encoded = httpmorph_base64_encode(credentials, strlen(credentials));
         if (encoded) {
-            written += snprintf(buf + written, SEND_BUFFER_SIZE - written,
-                              "Proxy-Authorization: Basic %s\r\n", encoded);
+            int rc = send_buf_append(buf, &written, "Proxy-Authorization: Basic ", 27);
+            if (rc == 0) rc = send_buf_append(buf, &written, encoded, strlen(encoded));
+            if (rc == 0) rc = send_buf_append(buf, &written, "\r\n", 2);
             free(encoded);
-            if (written >= (int)SEND_BUFFER_SIZE) {
+            if (rc < 0) {
                 return -1;
             }
         }
     }
 
-    /* Add custom headers */
-    for (size_t i = 0; i < request->header_count; i++) {
-        written += snprintf(buf + written, SEND_BUFFER_SIZE - written,
-                           "%s: %s\r\n",
-                           request->headers[i].key,
-                           request->headers[i].value);
-        if (written >= (int)SEND_BUFFER_SIZE) {
-            return -1;
+    /* Add custom headers */
+    for (size_t i = 0; i < request->header_count; i++) {
+        const char *key = request->headers[i].key;
+        const char *value = request->headers[i].value;
+        if (send_buf_append(buf, &written, key, strlen(key)) < 0 ||
+            send_buf_append(buf, &written, ": ", 2) < 0 ||
+            send_buf_append(buf, &written, value, strlen(value)) < 0 ||
+            send_buf_append(buf, &written, "\r\n", 2) < 0) {
+            return -1;
+        }
+    }
+
+    /* Add Content-Length if body present (a source of unknown length is chunked) */
+    if (request->body_source && request->body_chunked) {
+        if (send_buf_append(buf, &written, "Transfer-Encoding: chunked\r\n", 28) < 0) {
+            return -1;
+        }
+    } else if (httpmorph_request_has_body(request)) {
+        char length_line[48];
+        int n = snprintf(length_line, sizeof(length_line), "Content-Length: %zu\r\n", request->body_len);
+        if (send_buf_append(buf, &written, length_line, (size_t)n) < 0) {
+            return -1;
+        }
+    }
+
+    /* End of headers */
+    if (send_buf_append(buf, &written, "\r\n", 2) < 0) {
+        return -1;
+    }
+
+    /* Over TLS, fill the first record with the start of the body; the
+     * rest is sent from the caller's buffer (or the file) as is */
+    req->body_sent = 0;
+    if (req->ssl && !request->body_source && httpmorph_request_has_body(request) &&
+        written < TLS_RECORD_SIZE) {
+        size_t fill = TLS_RECORD_SIZE - written;
+        if (fill > request->body_len) {
+            fill = request->body_len;
+        }
+        if (request->body_is_file) {
+            int64_t got = httpmorph_file_read_at(request->body_fd, buf + written, fill,
+                                                 request->body_file_offset);
+            if (got != (int64_t)fill) {
+                return -1;
+            }
+        } else {
+            memcpy(buf + written, request->body, fill);
+        }
+        written += fill;
+        req->body_sent = fill;
+    }
+
+    req->send_len = written;
+    req->send_pos = 0;
+    req->send_built = true;
+
+    return 0;
+}
+
+/* Helper: Refill send_buf from the body source (framing chunks if needed)
+ * Returns 1 with data queued, 0 at the end, -1 on error or ASYNC_SEND_PAUSED */
+static int async_fill_from_source(async_request_t *req) {
+    httpmorph_request_t *request = req->request;
+    if (req->body_done) {
+        return 0;
+    }
+
+    int64_t n = httpmorph_request_read_body(request, req->send_buf + HTTPMORPH_CHUNK_PREFIX,
+                                            SEND_BUFFER_SIZE - HTTPMORPH_CHUNK_PREFIX - HTTPMORPH_CHUNK_SUFFIX,
+                                            req->body_sent);
+    if (n == HTTPMORPH_BODY_SOURCE_PAUSE) {
+        return ASYNC_SEND_PAUSED;
+    }
+    if (n < 0) {
+        return -1;
+    }
+
+    if (n == 0) {
+        req->body_done = true;
+        if (!request->body_chunked) {
+            return 0;
         }
-    }
+        memcpy(req->send_buf, HTTPMORPH_CHUNK_LAST, sizeof(HTTPMORPH_CHUNK_LAST) - 1);
+        req->send_pos = 0;
+        req->send_len = sizeof(HTTPMORPH_CHUNK_LAST) - 1;
+        return 1;
+    }
+
+    req->body_sent += (size_t)n;
+    req->send_pos = request->body_chunked ? httpmorph_request_frame_chunk(req->send_buf, (size_t)n)
+                                          : HTTPMORPH_CHUNK_PREFIX;
+    req->send_len = HTTPMORPH_CHUNK_PREFIX + (size_t)n +
+                    (request->body_chunked ? HTTPMORPH_CHUNK_SUFFIX : 0);
+    return 1;
+}
 
-    /* Add Content-Length if body present */
-    if (request->body && request->body_len > 0) {
-        written += snprintf(buf + written, SEND_BUFFER_SIZE - written,
-                           "Content-Length: %zu\r\n", request->body_len);
-        if (written >= (int)SEND_BUFFER_SIZE) {
-            return -1;
+/* Helper: Next bytes to send - the rest of send_buf, then the body.
+ * File and source bodies are read into send_buf a buffer at a time.
+ * Returns 1 with data/len set, 0 when everything is sent, -1 on read
+ * error or ASYNC_SEND_PAUSED while the body source has nothing yet */
+static int async_next_send(async_request_t *req, const uint8_t **data, size_t *len) {
+    httpmorph_request_t *request = req->request;
+
+    if (req->send_pos >= req->send_len && request->body_source) {
+        int rc = async_fill_from_source(req);
+        if (rc != 1) {
+            return rc;
         }
     }
 
-    /* End of headers */
-    written += snprintf(buf + written, SEND_BUFFER_SIZE - written, "\r\n");
-    if (written >= (int)SEND_BUFFER_SIZE) {
-        return -1;
+    if (req->send_pos < req->send_len) {
+        *data = req->send_buf + req->send_pos;
+        *len = req->send_len - req->send_pos;
+        return 1;
+    }
+    if (request->body_source) {
+        return 0;
+    }
+    if (!httpmorph_request_has_body(request) || req->body_sent >= request->body_len) {
+        return 0;
     }
 
-    /* Add body if present */
-    if (request->body && request->body_len > 0) {
-        if (written + request->body_len >= SEND_BUFFER_SIZE) {
-            return -1;  /* Body too large */
-        }
-        memcpy(buf + written, request->body, request->body_len);
-        written += request->body_len;
+    size_t remaining = request->body_len - req->body_sent;
+    if (!request->body_is_file) {
+        *data = request->body + req->body_sent;
+        *len = remaining;
+        return 1;
     }
 
-    req->send_len = written;
+    size_t want = remaining < SEND_BUFFER_SIZE ? remaining : SEND_BUFFER_SIZE;
+    int64_t got = httpmorph_file_read_at(request->body_fd, req->send_buf, want,
+                                         request->body_file_offset + req->body_sent);
+    if (got <= 0) {
+        return -1;  /* Read error or file shorter than the body */
+    }
+    req->body_sent += (size_t)got;
+    req->send_len = (size_t)got;
     req->send_pos = 0;
+    *data = req->send_buf;
+    *len = (size_t)got;
+    return 1;
+}
 
-    return 0;
+/* Helper: Account for sent bytes - send_buf first, then a memory body */
+static void async_send_advance(async_request_t *req, size_t n) {
+    size_t from_buf = req->send_len - req->send_pos;
+    if (from_buf > n) {
+        from_buf = n;
+    }
+    req->send_pos += from_buf;
+    req->body_sent += n - from_buf;
+}
+
+#ifndef _WIN32
+/* Helper: Plain send of the next segment, gathering a memory body behind
+ * the head so both leave in one call */
+static ssize_t async_send_gather(async_request_t *req, const uint8_t *data, size_t len) {
+    httpmorph_request_t *request = req->request;
+    struct iovec iov[2] = {{(void *)data, len}, {NULL, 0}};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 1;
+
+    if (req->send_pos < req->send_len && !request->body_is_file && !request->body_source &&
+        httpmorph_request_has_body(request) && req->body_sent < request->body_len) {
+        iov[1].iov_base = request->body + req->body_sent;
+        iov[1].iov_len = request->body_len - req->body_sent;
+        msg.msg_iovlen = 2;
+    }
+#ifdef MSG_NOSIGNAL
+    return sendmsg(req->sockfd, &msg, MSG_NOSIGNAL);
+#else
+    return sendmsg(req->sockfd, &msg, 0);
+#endif
+}
+#endif
+
+#ifdef OPENSSL_IS_BORINGSSL
+/* Helper: The server turned the early data down - send the request again
+ * once the handshake is done */
+static int async_early_data_retry(async_request_t *req) {
+    DEBUG_PRINT("[async_request] Early data rejected, resending (id=%lu)\n",
+           (unsigned long)req->id);
+    SSL_reset_early_data_reject(req->ssl);
+    req->early_data = false;
+    req->send_pos = 0;   /* Replayable requests are the head alone */
+    req->recv_len = 0;
+    req->state = ASYNC_STATE_SENDING_REQUEST;
+    return ASYNC_STATUS_IN_PROGRESS;
+}
+#endif
+
+/**
+ * State: Connected for a preconnect - finish without sending anything
+ * A TLS 1.3 server sends its session tickets after the handshake; the
+ * request waits about as long as the handshake took for them and reads
+ * them, so the session cache can resume the origin even if this
+ * connection is never used.
+ */
+static int step_preconnected(async_request_t *req) {
+    if (req->ssl && SSL_version(req->ssl) == TLS1_3_VERSION) {
+        uint64_t now = get_time_us();
+        uint64_t bytes_read = BIO_number_read(SSL_get_rbio(req->ssl));
+        if (req->ticket_wait_read == 0) {
+            uint64_t wait_us = req->tls_start_us ? now - req->tls_start_us : 0;
+            req->ticket_wait_read = bytes_read;
+            req->wake_at_us = now + (wait_us < PRECONNECT_TICKET_WAIT_MAX_US ? wait_us : PRECONNECT_TICKET_WAIT_MAX_US);
+        }
+
+        /* Process whatever arrived; a request's first read takes the rest */
+        char byte;
+        int peeked = SSL_peek(req->ssl, &byte, 1);
+        if (peeked <= 0) {
+            int err = SSL_get_error(req->ssl, peeked);
+            ERR_clear_error();
+            if (err == SSL_ERROR_WANT_READ && now < req->wake_at_us &&
+                BIO_number_read(SSL_get_rbio(req->ssl)) == req->ticket_wait_read) {
+                return ASYNC_STATUS_NEED_READ;
+            }
+        }
+        req->wake_at_us = 0;
+    }
+
+    if (!req->response) {
+        req->response = calloc(1, sizeof(httpmorph_response_t));
+        if (!req->response) {
+            async_request_set_error(req, HTTPMORPH_ERROR_MEMORY, "Failed to allocate response");
+            req->state = ASYNC_STATE_ERROR;
+            return ASYNC_STATUS_ERROR;
+        }
+    }
+    req->response->http_version = HTTPMORPH_VERSION_1_1;
+    req->response->error = HTTPMORPH_OK;
+    req->state = ASYNC_STATE_COMPLETE;
+    return ASYNC_STATUS_COMPLETE;
 }
 
 /**
  * State: Sending request
  */
 static int step_sending_request(async_request_t *req) {
+    if (req->connect_only) {
+        return step_preconnected(req);
+    }
+
     /* Build request if not already done */
-    if (req->send_len == 0) {
+    if (!req->send_built) {
         DEBUG_PRINT("[async_request] Building HTTP request (id=%lu)\n",
                (unsigned long)req->id);
 
@@ -1123,17 +1842,34 @@ static int step_sending_request(async_request_t *req) {
     }
 
     /* Send data */
-    while (req->send_pos < req->send_len) {
+    while (true) {
+        const uint8_t *data;
+        size_t len;
         ssize_t sent;
 
+        int more = async_next_send(req, &data, &len);
+        if (more == ASYNC_SEND_PAUSED) {
+            req->body_paused = true;  /* Until async_manager_resume_request() */
+            return ASYNC_STATUS_PAUSED;
+        }
+        if (more < 0) {
+            async_request_set_error(req, HTTPMORPH_ERROR_ABORTED, "Failed to read request body");
+            return ASYNC_STATUS_ERROR;
+        }
+        if (more == 0) {
+            break;
+        }
+
         if (req->ssl) {
+            /* One record per write; a retry after WANT_WRITE repeats the same slice */
+            if (len > TLS_RECORD_SIZE) {
+                len = TLS_RECORD_SIZE;
+            }
             /* Clear any pending errors before SSL operation */
             ERR_clear_error();
 
             /* SSL send - SSL layer handles non-blocking I/O internally */
-            sent = SSL_write(req->ssl,
-                           req->send_buf + req->send_pos,
-                           (int)(req->send_len - req->send_pos));
+            sent = SSL_write(req->ssl, data, (int)len);
 
             if (sent <= 0) {
                 int err = SSL_get_error(req->ssl, (int)sent);
@@ -1143,6 +1879,10 @@ static int step_sending_request(async_request_t *req) {
                 } else if (err == SSL_ERROR_WANT_READ) {
                     DEBUG_PRINT("[async_request] SSL_write wants read (id=%lu)\n", (unsigned long)req->id);
                     return ASYNC_STATUS_NEED_READ;
+#ifdef OPENSSL_IS_BORINGSSL
+                } else if (err == SSL_ERROR_EARLY_DATA_REJECTED) {
+                    return async_early_data_retry(req);
+#endif
                 } else {
                     /* Get detailed SSL error */
                     char err_buf[256];
@@ -1183,7 +1923,7 @@ static int step_sending_request(async_request_t *req) {
             }
 
             DEBUG_PRINT("[async_request] SSL_write sent %zd bytes (id=%lu)\n", sent, (unsigned long)req->id);
-            req->send_pos += sent;
+            async_send_advance(req, (size_t)sent);
         } else {
 #ifdef _WIN32
             /* Windows: Skip IOCP for async requests - use regular non-blocking I/O */
@@ -1197,7 +1937,7 @@ static int step_sending_request(async_request_t *req) {
                     if (WSAGetOverlappedResult(req->sockfd, ov, &bytes_transferred, FALSE, &flags)) {
                         /* Send completed */
                         req->iocp_operation_pending = false;
-                        req->send_pos += bytes_transferred;
+                        async_send_advance(req, bytes_transferred);
                         DEBUG_PRINT("[async_request] WSASend completed: %lu bytes (id=%lu)\n",
                                (unsigned long)bytes_transferred, (unsigned long)req->id);
                         continue;  /* Try to send more */
@@ -1233,15 +1973,15 @@ static int step_sending_request(async_request_t *req) {
                 ResetEvent((HANDLE)req->iocp_completion_event);
 
                 WSABUF buf;
-                buf.buf = (char*)(req->send_buf + req->send_pos);
-                buf.len = req->send_len - req->send_pos;
+                buf.buf = (char*)data;
+                buf.len = (ULONG)len;
 
                 DWORD bytes_sent = 0;
                 int result = WSASend(req->sockfd, &buf, 1, &bytes_sent, 0, ov, NULL);
 
                 if (result == 0) {
                     /* Completed immediately */
-                    req->send_pos += bytes_sent;
+                    async_send_advance(req, bytes_sent);
                     DEBUG_PRINT("[async_request] WSASend completed immediately: %lu bytes (id=%lu)\n",
                            (unsigned long)bytes_sent, (unsigned long)req->id);
                     continue;  /* Try to send more */
@@ -1264,10 +2004,11 @@ static int step_sending_request(async_request_t *req) {
 #endif
             {
                 /* Plain TCP send (non-IOCP) */
-                sent = send(req->sockfd,
-                           (const char*)(req->send_buf + req->send_pos),
-                           req->send_len - req->send_pos,
-                           0);
+#ifdef _WIN32
+                sent = send(req->sockfd, (const char*)data, (int)len, 0);
+#else
+                sent = async_send_gather(req, data, len);
+#endif
 
                 if (sent < 0) {
 #ifdef _WIN32
@@ -1289,25 +2030,169 @@ static int step_sending_request(async_request_t *req) {
                     return ASYNC_STATUS_ERROR;
                 }
 
-                req->send_pos += sent;
+                async_send_advance(req, (size_t)sent);
             }
         }
     }
 
     /* All data sent */
-    DEBUG_PRINT("[async_request] Request sent (%zu bytes) (id=%lu)\n",
-           req->send_len, (unsigned long)req->id);
+    DEBUG_PRINT("[async_request] Request sent (%zu body bytes) (id=%lu)\n",
+           req->body_sent, (unsigned long)req->id);
 
     req->state = ASYNC_STATE_RECEIVING_HEADERS;
     return ASYNC_STATUS_IN_PROGRESS;
 }
 
+/**
+ * Build the response head for a streamed body from the received headers
+ */
+static int async_stream_parse_head(async_request_t *req) {
+    httpmorph_response_t *resp = httpmorph_response_create(NULL);
+    if (!resp) {
+        return -1;
+    }
+
+    /* The body goes to the callback - drop the preallocated buffer */
+    free(resp->body);
+    resp->body = NULL;
+    resp->body_capacity = 0;
+    resp->_body_actual_size = 0;
+    resp->http_version = HTTPMORPH_VERSION_1_1;
+    req->response = resp;
+
+    /* Re-scan the head with span recording; names and values stay in recv_buf */
+    http1_header_span_t spans[HTTP1_MAX_HEADERS];
+    http1_parser_t parser;
+    http1_parser_init(&parser, spans, HTTP1_MAX_HEADERS);
+    char *head = (char *)req->recv_buf;
+    if (http1_parser_feed(&parser, head, req->headers_end_pos) != HTTP1_PARSE_COMPLETE) {
+        return -1;
+    }
+
+    char line[256];
+    size_t line_len = parser.status_line_len;
+    if (line_len >= sizeof(line)) {
+        line_len = sizeof(line) - 1;
+    }
+    memcpy(line, head, line_len);
+    line[line_len] = '\0';
+    if (httpmorph_parse_response_line(line, resp) != 0) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < parser.header_count; i++) {
+        if (httpmorph_response_add_header_internal(resp, head + spans[i].name, spans[i].name_len,
+                                                   head + spans[i].value, spans[i].value_len) != 0) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Hand a callback result to the state machine
+ * Returns ASYNC_STATUS_IN_PROGRESS to continue, ASYNC_STATUS_PAUSED or ASYNC_STATUS_ERROR.
+ */
+static int async_stream_result(async_request_t *req, int rc) {
+    if (rc < 0) {
+        async_request_set_error(req, HTTPMORPH_ERROR_ABORTED, "Response body transfer aborted");
+        return ASYNC_STATUS_ERROR;
+    }
+    if (rc == HTTPMORPH_BODY_PAUSE) {
+        req->body_paused = true;
+        return ASYNC_STATUS_PAUSED;
+    }
+    return ASYNC_STATUS_IN_PROGRESS;
+}
+
+/**
+ * Deliver the response head to the body callback
+ */
+static int async_stream_head(async_request_t *req) {
+    const httpmorph_request_t *request = req->request;
+
+    if (async_stream_parse_head(req) != 0) {
+        async_request_set_error(req, HTTPMORPH_ERROR_PARSE, "Failed to parse response headers");
+        return ASYNC_STATUS_ERROR;
+    }
+
+    req->body_head_delivered = true;
+    return async_stream_result(req, request->body_callback(req->response, NULL, 0,
+                                                             request->body_callback_userdata));
+}
+
+/**
+ * Deliver body bytes buffered after the headers and drop them from recv_buf
+ */
+static int async_stream_deliver(async_request_t *req) {
+    const httpmorph_request_t *request = req->request;
+    size_t len = req->recv_len - req->headers_end_pos;
+
+    if (len == 0) {
+        return ASYNC_STATUS_IN_PROGRESS;
+    }
+
+    req->recv_len = req->headers_end_pos;
+    int status = async_stream_result(req, request->body_callback(req->response,
+                                                                 req->recv_buf + req->headers_end_pos, len,
+                                                                 request->body_callback_userdata));
+
+    /* Nothing left to hold back once the last byte went out */
+    if (status == ASYNC_STATUS_PAUSED && !req->chunked_encoding &&
+        req->body_received >= req->content_length) {
+        status = ASYNC_STATUS_IN_PROGRESS;
+    }
+    return status;
+}
+
+/**
+ * Take `len` body bytes just received at recv_buf + pos
+ * Chunk framing is stripped in place; once the last chunk is in, the body
+ * is handled as one of known length. Returns false (error set) on
+ * malformed framing.
+ */
+static bool async_take_body(async_request_t *req, size_t pos, size_t len) {
+    if (req->chunked_encoding) {
+        size_t rest = 0;
+        int rc = http1_chunked_decode(&req->chunked_decoder, (char *)req->recv_buf + pos, &len, &rest);
+        if (rc == HTTP1_CHUNKED_ERROR) {
+            async_request_set_error(req, HTTPMORPH_ERROR_PROTOCOL, "Malformed chunked response body");
+            return false;
+        }
+        if (rc == HTTP1_CHUNKED_DONE) {
+            req->chunked_encoding = false;
+            req->content_length = req->body_received + len;
+        }
+    }
+    req->recv_len = pos + len;
+    req->body_received += len;
+    return true;
+}
+
+/* Helper: Whether the connection closed before the whole body arrived */
+static bool async_body_truncated(const async_request_t *req) {
+    return req->chunked_encoding ||
+           (req->content_length > 0 && req->body_received < req->content_length);
+}
+
+/* Helper: Feed the receive buffer to the response head parser */
+static int async_scan_headers(async_request_t *req) {
+    return http1_parser_feed(&req->header_parser, (const char *)req->recv_buf, req->recv_len);
+}
+
 /**
  * State: Receiving headers
  */
 static int step_receiving_headers(async_request_t *req) {
     /* Receive data */
     ssize_t received;
+    int parse_rc;
+
+    /* The receive buffer counts against the memory budget from the first read */
+    if (!async_budget_charge(req, req->recv_capacity)) {
+        return ASYNC_STATUS_PAUSED;
+    }
 
     if (req->ssl) {
         /* SSL receive - SSL layer handles non-blocking I/O internally */
@@ -1321,21 +2206,16 @@ static int step_receiving_headers(async_request_t *req) {
                 return ASYNC_STATUS_NEED_READ;
             } else if (err == SSL_ERROR_WANT_WRITE) {
                 return ASYNC_STATUS_NEED_WRITE;
+#ifdef OPENSSL_IS_BORINGSSL
+            } else if (err == SSL_ERROR_EARLY_DATA_REJECTED) {
+                return async_early_data_retry(req);
+#endif
             } else if (err == SSL_ERROR_ZERO_RETURN) {
                 /* SSL connection closed - check if we have complete headers */
-                if (req->recv_len >= 4) {
-                    bool has_complete_headers = false;
-                    for (size_t i = 0; i <= req->recv_len - 4; i++) {
-                        if (memcmp(req->recv_buf + i, "\r\n\r\n", 4) == 0) {
-                            has_complete_headers = true;
-                            break;
-                        }
-                    }
-                    if (has_complete_headers) {
-                        /* Have complete headers, process them */
-                        received = 0;  /* Set to 0 to skip recv_len increment below */
-                        goto ssl_process_headers;
-                    }
+                if (async_scan_headers(req) == HTTP1_PARSE_COMPLETE) {
+                    /* Have complete headers, process them */
+                    received = 0;  /* Set to 0 to skip recv_len increment below */
+                    goto ssl_process_headers;
                 }
                 async_request_set_error(req, -1, "SSL connection closed before complete headers");
                 return ASYNC_STATUS_ERROR;
@@ -1350,19 +2230,10 @@ static int step_receiving_headers(async_request_t *req) {
 
                 if (is_eof) {
                     /* Connection closed cleanly - treat like SSL_ERROR_ZERO_RETURN */
-                    if (req->recv_len >= 4) {
-                        bool has_complete_headers = false;
-                        for (size_t i = 0; i <= req->recv_len - 4; i++) {
-                            if (memcmp(req->recv_buf + i, "\r\n\r\n", 4) == 0) {
-                                has_complete_headers = true;
-                                break;
-                            }
-                        }
-                        if (has_complete_headers) {
-                            /* Have complete headers, process them */
-                            received = 0;  /* Set to 0 to skip recv_len increment below */
-                            goto ssl_process_headers;
-                        }
+                    if (async_scan_headers(req) == HTTP1_PARSE_COMPLETE) {
+                        /* Have complete headers, process them */
+                        received = 0;  /* Set to 0 to skip recv_len increment below */
+                        goto ssl_process_headers;
                     }
                     async_request_set_error(req, -1, "Connection closed by peer before complete headers");
                     return ASYNC_STATUS_ERROR;
@@ -1433,18 +2304,9 @@ ssl_process_headers:
 
                         if (received == 0) {
                             /* Connection closed - check if we have complete headers already */
-                            if (req->recv_len >= 4) {
-                                bool has_complete_headers = false;
-                                for (size_t i = 0; i <= req->recv_len - 4; i++) {
-                                    if (memcmp(req->recv_buf + i, "\r\n\r\n", 4) == 0) {
-                                        has_complete_headers = true;
-                                        break;
-                                    }
-                                }
-                                if (has_complete_headers) {
-                                    /* Have complete headers, don't increment recv_len, continue to header processing */
-                                    goto iocp_process_headers;
-                                }
+                            if (async_scan_headers(req) == HTTP1_PARSE_COMPLETE) {
+                                /* Have complete headers, don't increment recv_len, continue to header processing */
+                                goto iocp_process_headers;
                             }
                             async_request_set_error(req, -1, "Connection closed before complete headers (IOCP)");
                             return ASYNC_STATUS_ERROR;
@@ -1500,18 +2362,9 @@ ssl_process_headers:
 
                     if (received == 0) {
                         /* Connection closed (or closing) - check if we have complete headers already */
-                        if (req->recv_len >= 4) {
-                            bool has_complete_headers = false;
-                            for (size_t i = 0; i <= req->recv_len - 4; i++) {
-                                if (memcmp(req->recv_buf + i, "\r\n\r\n", 4) == 0) {
-                                    has_complete_headers = true;
-                                    break;
-                                }
-                            }
-                            if (has_complete_headers) {
-                                /* Have complete headers, continue to header processing */
-                                goto iocp_process_headers;
-                            }
+                        if (async_scan_headers(req) == HTTP1_PARSE_COMPLETE) {
+                            /* Have complete headers, continue to header processing */
+                            goto iocp_process_headers;
                         }
                         /* If this is the first receive (recv_len == 0), give it another chance */
                         /* Server might be closing connection but data could still arrive */
@@ -1571,14 +2424,7 @@ ssl_process_headers:
                     return ASYNC_STATUS_ERROR;
                 }
                 /* Check if we have complete headers */
-                bool has_complete_headers = false;
-                for (size_t i = 0; i <= req->recv_len - 4; i++) {
-                    if (memcmp(req->recv_buf + i, "\r\n\r\n", 4) == 0) {
-                        has_complete_headers = true;
-                        break;
-                    }
-                }
-                if (!has_complete_headers) {
+                if (async_scan_headers(req) != HTTP1_PARSE_COMPLETE) {
                     async_request_set_error(req, -1, "Connection closed before complete headers");
                     return ASYNC_STATUS_ERROR;
                 }
@@ -1592,111 +2438,47 @@ ssl_process_headers:
     }
 
 iocp_process_headers:
-    /* Look for end of headers (\r\n\r\n) */
-    if (req->recv_len >= 4) {
-        for (size_t i = 0; i <= req->recv_len - 4; i++) {
-            if (memcmp(req->recv_buf + i, "\r\n\r\n", 4) == 0) {
-                /* Found end of headers */
-                req->headers_complete = true;
-                req->headers_end_pos = i + 4;
-
-                DEBUG_PRINT("[async_request] Headers received (%zu bytes) (id=%lu)\n",
-                       req->headers_end_pos, (unsigned long)req->id);
-
-                /* Parse headers for Content-Length and Transfer-Encoding */
-                req->content_length = 0;
-                req->chunked_encoding = false;
-
-                /* Search for Content-Length header (case-insensitive) */
-                char *headers_start = (char *)req->recv_buf;
-                char *headers_end = headers_start + req->headers_end_pos;
-
-                /* Look for "Content-Length:" */
-                for (char *p = headers_start; p < headers_end - 16; p++) {
-                    if ((p[0] == 'C' || p[0] == 'c') &&
-                        (p[1] == 'o' || p[1] == 'O') &&
-                        (p[2] == 'n' || p[2] == 'N') &&
-                        (p[3] == 't' || p[3] == 'T') &&
-                        (p[4] == 'e' || p[4] == 'E') &&
-                        (p[5] == 'n' || p[5] == 'N') &&
-                        (p[6] == 't' || p[6] == 'T') &&
-                        p[7] == '-' &&
-                        (p[8] == 'L' || p[8] == 'l') &&
-                        (p[9] == 'e' || p[9] == 'E') &&
-                        (p[10] == 'n' || p[10] == 'N') &&
-                        (p[11] == 'g' || p[11] == 'G') &&
-                        (p[12] == 't' || p[12] == 'T') &&
-                        (p[13] == 'h' || p[13] == 'H') &&
-                        p[14] == ':') {
-                        /* Found Content-Length header */
-                        p += 15;
-                        /* Skip whitespace */
-                        while (p < headers_end && (*p == ' ' || *p == '\t')) p++;
-                        /* Parse number */
-                        req->content_length = 0;
-                        while (p < headers_end && *p >= '0' && *p <= '9') {
-                            req->content_length = req->content_length * 10 + (*p - '0');
-                            p++;
-                        }
-                        break;
-                    }
-                }
+    /* Scans only the bytes added since the last pass */
+    parse_rc = async_scan_headers(req);
+    if (parse_rc == HTTP1_PARSE_ERROR) {
+        async_request_set_error(req, HTTPMORPH_ERROR_PROTOCOL, "Malformed response headers");
+        return ASYNC_STATUS_ERROR;
+    }
+    if (parse_rc == HTTP1_PARSE_COMPLETE) {
+        /* Found end of headers */
+        req->headers_complete = true;
+        req->headers_end_pos = req->header_parser.headers_end;
 
-                /* Look for "Transfer-Encoding: chunked" */
-                for (char *p = headers_start; p < headers_end - 25; p++) {
-                    if ((p[0] == 'T' || p[0] == 't') &&
-                        (p[1] == 'r' || p[1] == 'R') &&
-                        (p[2] == 'a' || p[2] == 'A') &&
-                        (p[3] == 'n' || p[3] == 'N') &&
-                        (p[4] == 's' || p[4] == 'S') &&
-                        (p[5] == 'f' || p[5] == 'F') &&
-                        (p[6] == 'e' || p[6] == 'E') &&
-                        (p[7] == 'r' || p[7] == 'R') &&
-                        p[8] == '-' &&
-                        (p[9] == 'E' || p[9] == 'e') &&
-                        (p[10] == 'n' || p[10] == 'N') &&
-                        (p[11] == 'c' || p[11] == 'C') &&
-                        (p[12] == 'o' || p[12] == 'O') &&
-                        (p[13] == 'd' || p[13] == 'D') &&
-                        (p[14] == 'i' || p[14] == 'I') &&
-                        (p[15] == 'n' || p[15] == 'N') &&
-                        (p[16] == 'g' || p[16] == 'G') &&
-                        p[17] == ':') {
-                        /* Found Transfer-Encoding header, check if chunked */
-                        p += 18;
-                        /* Skip whitespace */
-                        while (p < headers_end && (*p == ' ' || *p == '\t')) p++;
-                        /* Check for "chunked" */
-                        if (p < headers_end - 7 &&
-                            (p[0] == 'c' || p[0] == 'C') &&
-                            (p[1] == 'h' || p[1] == 'H') &&
-                            (p[2] == 'u' || p[2] == 'U') &&
-                            (p[3] == 'n' || p[3] == 'N') &&
-                            (p[4] == 'k' || p[4] == 'K') &&
-                            (p[5] == 'e' || p[5] == 'E') &&
-                            (p[6] == 'd' || p[6] == 'D')) {
-                            req->chunked_encoding = true;
-                        }
-                        break;
-                    }
-                }
+        DEBUG_PRINT("[async_request] Headers received (%zu bytes) (id=%lu)\n",
+               req->headers_end_pos, (unsigned long)req->id);
 
-                DEBUG_PRINT("[async_request] Content-Length: %zu, Chunked: %d (id=%lu)\n",
-                       req->content_length, req->chunked_encoding, (unsigned long)req->id);
+        /* Framing picked up by the parser */
+        req->content_length = (size_t)req->header_parser.content_length;
+        req->chunked_encoding = req->header_parser.chunked;
 
-                /* Check if we already have body data in the buffer */
-                size_t body_start = req->headers_end_pos;
-                if (body_start < req->recv_len) {
-                    /* We have some body data already */
-                    req->body_received = req->recv_len - body_start;
-                    DEBUG_PRINT("[async_request] Already received %zu bytes of body with headers (id=%lu)\n",
-                           req->body_received, (unsigned long)req->id);
-                }
+        DEBUG_PRINT("[async_request] Content-Length: %zu, Chunked: %d (id=%lu)\n",
+               req->content_length, req->chunked_encoding, (unsigned long)req->id);
 
-                req->state = ASYNC_STATE_RECEIVING_BODY;
-                return ASYNC_STATUS_IN_PROGRESS;
+        /* Check if we already have body data in the buffer */
+        size_t body_start = req->headers_end_pos;
+        http1_chunked_init(&req->chunked_decoder);
+        if (body_start < req->recv_len) {
+            /* We have some body data already */
+            if (!async_take_body(req, body_start, req->recv_len - body_start)) {
+                return ASYNC_STATUS_ERROR;
             }
+            DEBUG_PRINT("[async_request] Already received %zu bytes of body with headers (id=%lu)\n",
+                   req->body_received, (unsigned long)req->id);
+        }
+
+        req->state = ASYNC_STATE_RECEIVING_BODY;
+
+        if (req->request->body_callback) {
+            /* Body bytes that came with the headers go out from the body state */
+            return async_stream_head(req);
         }
+
+        return ASYNC_STATUS_IN_PROGRESS;
     }
 
     /* Need more data */
@@ -1707,6 +2489,20 @@ iocp_process_headers:
  * State: Receiving body
  */
 static int step_receiving_body(async_request_t *req) {
+    bool streaming = req->request->body_callback != NULL;
+
+    if (streaming) {
+        if (req->body_paused) {
+            return ASYNC_STATUS_PAUSED;
+        }
+
+        /* Flush body bytes received along with the headers */
+        int status = async_stream_deliver(req);
+        if (status != ASYNC_STATUS_IN_PROGRESS) {
+            return status;
+        }
+    }
+
     /* If no body expected, complete immediately */
     if (req->content_length == 0 && !req->chunked_encoding) {
         DEBUG_PRINT("[async_request] No body to receive (id=%lu)\n",
@@ -1718,7 +2514,7 @@ static int step_receiving_body(async_request_t *req) {
             if (req->response) {
                 req->response->body = NULL;
                 req->response->body_len = 0;
-                req->response->status_code = 200;  /* TODO: Parse from headers */
+                req->response->status_code = req->header_parser.status_code;
                 req->response->http_version = HTTPMORPH_VERSION_1_1;
                 req->response->error = HTTPMORPH_OK;
             }
@@ -1747,7 +2543,7 @@ static int step_receiving_body(async_request_t *req) {
                         req->response->_body_actual_size = req->content_length;  /* Track allocated size */
                     }
                 }
-                req->response->status_code = 200;  // TODO: Parse from headers
+                req->response->status_code = req->header_parser.status_code;
                 req->response->http_version = HTTPMORPH_VERSION_1_1;
                 req->response->error = HTTPMORPH_OK;
             }
@@ -1757,14 +2553,63 @@ static int step_receiving_body(async_request_t *req) {
         return ASYNC_STATUS_COMPLETE;
     }
 
-    /* Receive body data */
+    /* A large body is decrypted by the kernel; the switch happens once,
+     * between records, and only if SSL holds nothing unread */
+    if (req->ssl && req->request->ktls && !req->ktls_checked) {
+        req->ktls_checked = true;
+        if ((req->chunked_encoding || req->content_length - req->body_received >= KTLS_MIN_BODY) &&
+            ktls_enable_rx(req->ssl, req->sockfd) == 0) {
+            DEBUG_PRINT("[async_request] Kernel TLS receive enabled (id=%lu)\n",
+                   (unsigned long)req->id);
+            req->ktls_rx = true;
+        }
+    }
+
+    /* Receive body data (one chunk at a time when streaming) */
     ssize_t received;
+    size_t room = req->recv_capacity - req->recv_len;
+    if (streaming && room > req->request->body_chunk_size) {
+        room = req->request->body_chunk_size;
+    }
+    if (room == 0 && !streaming) {
+        /* A buffered body of unknown length (chunked) outgrew the buffer;
+         * without budget for twice the size, stop reading until there is */
+        if (!async_budget_charge(req, req->recv_capacity * 2)) {
+            return ASYNC_STATUS_PAUSED;
+        }
+        uint8_t *grown = realloc(req->recv_buf, req->recv_capacity * 2);
+        if (!grown) {
+            async_request_set_error(req, HTTPMORPH_ERROR_MEMORY, "Out of memory for response body");
+            return ASYNC_STATUS_ERROR;
+        }
+        req->recv_buf = grown;
+        req->recv_capacity *= 2;
+        room = req->recv_capacity - req->recv_len;
+    }
 
-    if (req->ssl) {
+    if (req->ktls_rx) {
+        received = ktls_recv(req->sockfd, req->recv_buf + req->recv_len, room);
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return ASYNC_STATUS_NEED_READ;
+            }
+            async_request_set_error(req, errno, "Kernel TLS receive failed");
+            return ASYNC_STATUS_ERROR;
+        }
+        if (received == 0) {
+            /* Connection closed - check if we got all data */
+            if (async_body_truncated(req)) {
+                async_request_set_error(req, -1, "Incomplete body");
+                return ASYNC_STATUS_ERROR;
+            }
+            req->state = ASYNC_STATE_COMPLETE;
+            return ASYNC_STATUS_COMPLETE;
+        }
+    } else if (req->ssl) {
         /* SSL receive - SSL layer handles non-blocking I/O internally */
         received = SSL_read(req->ssl,
                           req->recv_buf + req->recv_len,
-                          (int)(req->recv_capacity - req->recv_len));
+                          (int)room);
 
         if (received <= 0) {
             int err = SSL_get_error(req->ssl, (int)received);
@@ -1774,8 +2619,7 @@ static int step_receiving_body(async_request_t *req) {
                 return ASYNC_STATUS_NEED_WRITE;
             } else if (err == SSL_ERROR_ZERO_RETURN) {
                 /* Connection closed - check if we got all data */
-                if (req->content_length > 0 &&
-                    req->body_received < req->content_length) {
+                if (async_body_truncated(req)) {
                     async_request_set_error(req, -1, "Incomplete body");
                     return ASYNC_STATUS_ERROR;
                 }
@@ -1815,7 +2659,7 @@ static int step_receiving_body(async_request_t *req) {
 
                         if (received == 0) {
                             /* Connection closed - check if we got all data */
-                            if (req->content_length > 0 && req->body_received < req->content_length) {
+                            if (async_body_truncated(req)) {
                                 async_request_set_error(req, -1, "Incomplete body");
                                 return ASYNC_STATUS_ERROR;
                             }
@@ -1859,7 +2703,7 @@ static int step_receiving_body(async_request_t *req) {
 
                 WSABUF buf;
                 buf.buf = (char*)(req->recv_buf + req->recv_len);
-                buf.len = req->recv_capacity - req->recv_len;
+                buf.len = (ULONG)room;
 
                 DWORD bytes_received = 0;
                 DWORD flags = 0;
@@ -1873,7 +2717,7 @@ static int step_receiving_body(async_request_t *req) {
 
                     if (received == 0) {
                         /* Connection closed - check if we got all data */
-                        if (req->content_length > 0 && req->body_received < req->content_length) {
+                        if (async_body_truncated(req)) {
                             async_request_set_error(req, -1, "Incomplete body");
                             return ASYNC_STATUS_ERROR;
                         }
@@ -1902,7 +2746,7 @@ static int step_receiving_body(async_request_t *req) {
             /* Plain TCP receive (non-IOCP) */
             received = recv(req->sockfd,
                            (char*)(req->recv_buf + req->recv_len),
-                           req->recv_capacity - req->recv_len,
+                           room,
                            0);
 
             if (received < 0) {
@@ -1922,8 +2766,7 @@ static int step_receiving_body(async_request_t *req) {
 
             if (received == 0) {
                 /* Connection closed - check if we got all data */
-                if (req->content_length > 0 &&
-                    req->body_received < req->content_length) {
+                if (async_body_truncated(req)) {
                     async_request_set_error(req, -1, "Incomplete body");
                     return ASYNC_STATUS_ERROR;
                 }
@@ -1933,11 +2776,19 @@ static int step_receiving_body(async_request_t *req) {
         }
     }
 
-    req->recv_len += received;
-    req->body_received += received;
+    if (!async_take_body(req, req->recv_len, (size_t)received)) {
+        return ASYNC_STATUS_ERROR;
+    }
+
+    if (streaming) {
+        int status = async_stream_deliver(req);
+        if (status != ASYNC_STATUS_IN_PROGRESS) {
+            return status;
+        }
+    }
 
     /* Check if we received all data */
-    if (req->content_length > 0 && req->body_received >= req->content_length) {
+    if (!req->chunked_encoding && req->body_received >= req->content_length) {
         DEBUG_PRINT("[async_request] Body received (%zu bytes) (id=%lu)\n",
                req->body_received, (unsigned long)req->id);
 
@@ -1955,7 +2806,7 @@ static int step_receiving_body(async_request_t *req) {
                         req->response->_body_actual_size = req->content_length;  /* Track allocated size */
                     }
                 }
-                req->response->status_code = 200;  // TODO: Parse from headers
+                req->response->status_code = req->header_parser.status_code;
                 req->response->http_version = HTTPMORPH_VERSION_1_1;
                 req->response->error = HTTPMORPH_OK;
             }
@@ -2110,23 +2961,94 @@ static int step_proxy_connect(async_request_t *req) {
 }
 
 /**
- * Step the async request state machine
+ * Handle SOCKS5 proxy state (handshake and CONNECT through the proxy)
  */
-int async_request_step(async_request_t *req) {
-    if (!req) {
-        return ASYNC_STATUS_ERROR;
+static int step_proxy_socks5(async_request_t *req) {
+    if (!req->socks5) {
+        req->socks5 = malloc(sizeof(httpmorph_socks5_t));
+        if (!req->socks5) {
+            async_request_set_error(req, -1, "Failed to allocate SOCKS5 state");
+            return ASYNC_STATUS_ERROR;
+        }
+        const struct sockaddr *addr = req->socks5_target ? req->socks5_target->ai_addr : NULL;
+        if (httpmorph_socks5_init(req->socks5, req->target_host, req->target_port, addr,
+                                  req->proxy_username, req->proxy_password) != 0) {
+            async_request_set_error(req, -1, "SOCKS5 target or credentials too long");
+            return ASYNC_STATUS_ERROR;
+        }
     }
 
-    /* Check timeout */
-    if (async_request_is_timeout(req)) {
-        async_request_set_error(req, -1, "Request timeout");
-        if (req->on_complete) {
-            req->on_complete(req, ASYNC_STATUS_ERROR);
+    for (;;) {
+        size_t len = 0;
+        const uint8_t *out = httpmorph_socks5_output(req->socks5, &len);
+        if (len > 0) {
+            ssize_t sent = send(req->sockfd, (const char*)out, len, 0);
+#ifdef _WIN32
+            if (sent < 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
+                return ASYNC_STATUS_NEED_WRITE;
+            }
+#else
+            if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOTCONN)) {
+                return ASYNC_STATUS_NEED_WRITE;
+            }
+#endif
+            if (sent < 0) {
+                async_request_set_error(req, errno, "Failed to send SOCKS5 request to proxy");
+                return ASYNC_STATUS_ERROR;
+            }
+            httpmorph_socks5_sent(req->socks5, (size_t)sent);
+            continue;
+        }
+
+        /* Read exactly the reply, leaving tunnel bytes on the socket */
+        uint8_t *in = httpmorph_socks5_input(req->socks5, &len);
+        ssize_t received = recv(req->sockfd, (char*)in, len, 0);
+#ifdef _WIN32
+        if (received < 0 && WSAGetLastError() == WSAEWOULDBLOCK) {
+            return ASYNC_STATUS_NEED_READ;
+        }
+#else
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return ASYNC_STATUS_NEED_READ;
+        }
+#endif
+        if (received < 0) {
+            async_request_set_error(req, errno, "Failed to receive SOCKS5 reply from proxy");
+            return ASYNC_STATUS_ERROR;
+        }
+        if (received == 0) {
+            async_request_set_error(req, -1, "Proxy closed connection during SOCKS5 handshake");
+            return ASYNC_STATUS_ERROR;
+        }
+
+        int rc = httpmorph_socks5_received(req->socks5, (size_t)received);
+        if (rc < 0) {
+            async_request_set_error(req, -1, req->socks5->error);
+            return ASYNC_STATUS_ERROR;
+        }
+        if (rc > 0) {
+            break;
         }
-        return ASYNC_STATUS_ERROR;
     }
 
-    /* State machine */
+    free(req->socks5);
+    req->socks5 = NULL;
+
+    DEBUG_PRINT("[async_request] SOCKS5 tunnel to %s:%u established (id=%lu)\n",
+           req->target_host, req->target_port, (unsigned long)req->id);
+
+    if (req->is_https) {
+        req->state = ASYNC_STATE_TLS_HANDSHAKE;
+    } else {
+        req->state = ASYNC_STATE_SENDING_REQUEST;
+    }
+    return ASYNC_STATUS_IN_PROGRESS;
+}
+
+/**
+ * Run the handler for the current state
+ */
+static int async_request_step_state(async_request_t *req) {
     switch (req->state) {
         case ASYNC_STATE_INIT:
             /* Start with DNS lookup */
@@ -2142,6 +3064,9 @@ int async_request_step(async_request_t *req) {
         case ASYNC_STATE_PROXY_CONNECT:
             return step_proxy_connect(req);
 
+        case ASYNC_STATE_PROXY_SOCKS5:
+            return step_proxy_socks5(req);
+
         case ASYNC_STATE_TLS_HANDSHAKE:
             return step_tls_handshake(req);
 
@@ -2173,3 +3098,32 @@ int async_request_step(async_request_t *req) {
             return ASYNC_STATUS_ERROR;
     }
 }
+
+/**
+ * Step the async request state machine
+ */
+int async_request_step(async_request_t *req) {
+    if (!req) {
+        return ASYNC_STATUS_ERROR;
+    }
+
+    /* Check timeout (total and current phase) */
+    if (async_request_is_timeout(req)) {
+        async_request_set_error(req, -1, async_request_timeout_reason(req));
+        if (req->on_complete) {
+            req->on_complete(req, ASYNC_STATUS_ERROR);
+        }
+        return ASYNC_STATUS_ERROR;
+    }
+
+    if (req->started_us == 0) {
+        req->started_us = get_time_us();
+        HTTPMORPH_PROBE2(request__start, req->id, req->request->url);
+    }
+    int status = async_request_step_state(req);
+    async_request_track_phase(req);
+    if (req->state == ASYNC_STATE_COMPLETE || req->state == ASYNC_STATE_ERROR) {
+        mem_budget_finish(req->budget, req);  /* Done reading: let another overdraw */
+    }
+    return status;
+}
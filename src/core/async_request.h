@@ -7,6 +7,12 @@
 
 #include "httpmorph.h"
 #include "io_engine.h"
+#include "happy_eyeballs.h"
+#include "dns_resolver.h"
+#include "http1_parser.h"
+#include "timer_wheel.h"
+#include "tls_session_cache.h"
+#include "mem_budget.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -29,6 +35,7 @@ typedef enum {
     ASYNC_STATE_DNS_LOOKUP,          /* DNS resolution in progress */
     ASYNC_STATE_CONNECTING,          /* TCP connection in progress */
     ASYNC_STATE_PROXY_CONNECT,       /* Proxy CONNECT tunnel establishment */
+    ASYNC_STATE_PROXY_SOCKS5,        /* SOCKS5 proxy handshake */
     ASYNC_STATE_TLS_HANDSHAKE,       /* TLS handshake in progress */
     ASYNC_STATE_SENDING_REQUEST,     /* Sending HTTP request */
     ASYNC_STATE_RECEIVING_HEADERS,   /* Receiving response headers */
@@ -45,7 +52,9 @@ typedef enum {
     ASYNC_STATUS_COMPLETE = 1,       /* Operation completed successfully */
     ASYNC_STATUS_ERROR = -1,         /* Operation failed */
     ASYNC_STATUS_NEED_READ = 2,      /* Needs to wait for read event */
-    ASYNC_STATUS_NEED_WRITE = 3      /* Needs to wait for write event */
+    ASYNC_STATUS_NEED_WRITE = 3,     /* Needs to wait for write event */
+    ASYNC_STATUS_PAUSED = 4,         /* Body callback asked to pause delivery, or no memory budget left */
+    ASYNC_STATUS_NEED_DNS = 5        /* Waiting for the resolver threads */
 } async_request_status_t;
 
 /**
@@ -76,20 +85,35 @@ struct async_request {
     int sockfd;
     SSL *ssl;
     bool is_https;
+    bool early_data;                 /* Request may go out as TLS early data */
+    bool ktls_checked;               /* Kernel TLS considered for this body */
+    bool ktls_rx;                    /* Kernel decrypts the server's records (SSL reads unused) */
 
     /* DNS resolution result */
-    struct sockaddr_storage addr;
+    struct sockaddr_storage addr;    /* First address (IOCP ConnectEx path) */
     socklen_t addr_len;
+    struct addrinfo *addrs;          /* All addresses, raced while connecting */
+    int preferred_family;            /* Family that connected first last time */
     bool dns_resolved;
+    httpmorph_dns_lookup_t *dns_lookup;  /* Resolver lookup in flight */
+    int dns_notify_fd;               /* Signalled when the lookup finishes (-1: none) */
+
+    /* Connection race (Happy Eyeballs) */
+    happy_eyeballs_t *he;
+    uint64_t wake_at_us;             /* Next attempt due - step even without readiness */
 
     /* I/O operation tracking */
     io_operation_t *current_op;
     io_engine_t *io_engine;
+    bool io_pending;                 /* Armed in io_engine, waiting for readiness */
 
     /* Send buffer state */
     uint8_t *send_buf;
     size_t send_len;
     size_t send_pos;
+    size_t body_sent;                /* Request body bytes taken from the caller */
+    bool send_built;                 /* Head built into send_buf */
+    bool body_done;                  /* Body source ended (last chunk queued) */
 
     /* Receive buffer state */
     uint8_t *recv_buf;
@@ -99,11 +123,23 @@ struct async_request {
     /* Header parsing state */
     bool headers_complete;
     size_t headers_end_pos;
+    http1_parser_t header_parser;   /* Resumes where the previous read stopped */
 
     /* Body receiving state */
     size_t content_length;
-    size_t body_received;
-    bool chunked_encoding;
+    size_t body_received;            /* Payload bytes (chunk framing stripped) */
+    bool chunked_encoding;           /* Cleared once the last chunk is in */
+    http1_chunked_t chunked_decoder;
+
+    /* Streaming body state (request->body_callback set) */
+    bool body_head_delivered;
+    bool body_paused;                /* Waiting for async_manager_resume_request() */
+
+    /* Memory budget (NULL: none) */
+    mem_budget_t *budget;
+    size_t budget_charged;           /* Receive buffer bytes charged to it */
+    bool budget_wait;                /* Reads paused until the budget has room */
+    bool budget_stalled;             /* Counted as a stall (see mem_budget_try_charge()) */
 
     /* Proxy configuration */
     bool using_proxy;                /* True if request uses a proxy */
@@ -117,11 +153,29 @@ struct async_request {
     bool proxy_connect_sent;         /* True if CONNECT request was sent */
     uint8_t *proxy_recv_buf;         /* Buffer for proxy CONNECT response */
     size_t proxy_recv_len;           /* Length of received proxy response */
+    bool proxy_socks5;               /* SOCKS5 proxy (tunnels plain HTTP too) */
+    bool proxy_remote_dns;           /* socks5h: the proxy resolves the target */
+    struct addrinfo *socks5_target;  /* Target resolved locally for socks5 */
+    struct httpmorph_socks5 *socks5; /* Handshake in progress */
 
     /* Timing and timeout */
     uint64_t start_time_us;
     uint64_t deadline_us;
     uint32_t timeout_ms;
+    uint64_t phase_deadline_us;      /* Connect, TLS or first-byte limit (0: none) */
+    async_request_state_t phase_state;  /* State phase_deadline_us was set for */
+    uint64_t first_byte_us;          /* First response byte arrived (0: not yet) */
+    uint64_t started_us;             /* First stepped (0: still queued) */
+    uint64_t dns_start_us;           /* Phases reached, for the response's timings */
+    uint64_t connect_start_us;
+    uint64_t tls_start_us;
+    uint64_t send_start_us;
+    bool connection_reused;          /* Took over the previous hop's connection */
+    bool connect_only;               /* Preconnect: complete once connected, keep the connection */
+    uint64_t ticket_wait_read;       /* Preconnect: TLS bytes read when it began waiting for tickets */
+    bool tls_resumed;                /* Handshake resumed a cached session */
+    timer_wheel_timer_t timer;       /* Armed by the manager for async_request_next_due_us() */
+    bool timer_due;                  /* Timer fired - step even without readiness */
 
     /* Error tracking */
     int error_code;
@@ -131,7 +185,12 @@ struct async_request {
     async_request_callback_t on_complete;
     void *user_data;
 
-    /* Reference counting */
+    /* Redirect hops (followed by the manager) */
+    httpmorph_request_t *owned_request;  /* Hop built by the manager, freed with us (NULL: caller's) */
+    httpmorph_response_t *redirect_from; /* Earlier hops' responses, until our response takes them */
+    uint32_t redirect_count;         /* Hops followed before this one */
+
+    /* Reference counting (atomic - shared between event thread and Python) */
     int refcount;
 
     /* Windows IOCP support */
@@ -140,6 +199,7 @@ struct async_request {
     void *overlapped_send;      /* OVERLAPPED* for WSASend */
     void *overlapped_recv;      /* OVERLAPPED* for WSARecv */
     bool iocp_operation_pending; /* True if an IOCP operation is in progress */
+    bool iocp_skip_on_success;  /* Inline successes queue no completion packet */
     int iocp_last_error;        /* Last Windows error code */
     uint32_t iocp_bytes_transferred; /* Bytes transferred in last completion */
     void *iocp_completion_event; /* HANDLE to event signaled on completion */
@@ -152,11 +212,14 @@ typedef struct ssl_ctx_st SSL_CTX;
 
 /**
  * Create a new async request
+ * HTTPS requests resume from session_cache (may be NULL) and store the
+ * sessions they receive in it.
  */
 async_request_t* async_request_create(
     const httpmorph_request_t *request,
     io_engine_t *io_engine,
     SSL_CTX *ssl_ctx,
+    tls_session_cache_t *session_cache,
     uint32_t timeout_ms,
     async_request_callback_t callback,
     void *user_data
@@ -177,6 +240,13 @@ void async_request_ref(async_request_t *req);
  */
 void async_request_unref(async_request_t *req);
 
+/**
+ * Charge the request's receive buffer to a memory budget
+ * Takes a reference; the charge is given back when the request is freed.
+ * Call before the request is first stepped.
+ */
+void async_request_set_memory_budget(async_request_t *req, mem_budget_t *budget);
+
 /**
  * Step the async request state machine
  * Returns:
@@ -185,9 +255,17 @@ void async_request_unref(async_request_t *req);
  *   ASYNC_STATUS_ERROR - Request failed
  *   ASYNC_STATUS_NEED_READ - Waiting for socket to be readable
  *   ASYNC_STATUS_NEED_WRITE - Waiting for socket to be writable
+ *   ASYNC_STATUS_PAUSED - Streaming body paused until resumed, or reads
+ *                         paused until the memory budget has room
+ *   ASYNC_STATUS_NEED_DNS - Host is being resolved off-thread
  */
 int async_request_step(async_request_t *req);
 
+/**
+ * Get request ID
+ */
+uint64_t async_request_get_id(const async_request_t *req);
+
 /**
  * Get current state
  */
@@ -200,6 +278,7 @@ const char* async_request_state_name(async_request_state_t state);
 
 /**
  * Get file descriptor for event loop integration
+ * While connecting this is the newest in-flight connection attempt.
  */
 int async_request_get_fd(const async_request_t *req);
 
@@ -208,6 +287,28 @@ int async_request_get_fd(const async_request_t *req);
  */
 bool async_request_is_timeout(const async_request_t *req);
 
+/**
+ * Check if the request must be stepped even without I/O readiness
+ * (the next connection attempt is due)
+ */
+bool async_request_wake_due(const async_request_t *req);
+
+/**
+ * Get the next time the request must be stepped without I/O readiness
+ * (timeout, phase timeout or connection attempt), 0 if there is none
+ */
+uint64_t async_request_next_due_us(const async_request_t *req);
+
+/**
+ * Get the clock used for request deadlines, in microseconds
+ */
+uint64_t async_request_now_us(void);
+
+/**
+ * Check if the request is waiting for its DNS lookup
+ */
+bool async_request_dns_pending(const async_request_t *req);
+
 /**
  * Set error state
  */
@@ -223,6 +324,31 @@ httpmorph_response_t* async_request_get_response(async_request_t *req);
  */
 const char* async_request_get_error_message(const async_request_t *req);
 
+/**
+ * Complete a request with the response of a duplicate that finished first
+ * (hedging). The responses are swapped, so the winner's destroy frees the
+ * one the request had so far.
+ */
+void async_request_adopt(async_request_t *req, async_request_t *winner);
+
+/**
+ * Get where a finished response redirects to
+ * @return Location header value (caller must free), NULL if the response
+ *         isn't a redirect or has no Location
+ */
+char* async_request_redirect_location(const async_request_t *req);
+
+/**
+ * Move the connection of a finished request to a request for the same
+ * origin that hasn't started (redirects, preconnects)
+ * Only a direct HTTP/1.1 connection whose response ended at its framing
+ * and wasn't marked "Connection: close" is moved, or a connect_only
+ * request's connection the server hasn't closed meanwhile. The caller
+ * unregisters from's socket from the I/O engine first.
+ * @return true if req now starts by sending on the moved connection
+ */
+bool async_request_take_connection(async_request_t *req, async_request_t *from);
+
 #ifdef __cplusplus
 }
 #endif
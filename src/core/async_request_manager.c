@@ -1,9 +1,25 @@
 /**
  * async_request_manager.c - Implementation of async request manager
+ *
+ * Requests live in one slot table but are stepped by shards: each shard
+ * has its own I/O engine, poller lock and (in event-driven mode) event
+ * thread. A request goes to the shard its origin hashes to, so one
+ * host's connections stay on one thread. A shard that has no queued
+ * work takes half of the busiest shard's requests that haven't started
+ * yet; once a request has a socket it stays where it is.
+ *
+ * With a scheduler, a submitted request is installed held: it has its
+ * slot and ID but isn't stepped until the scheduler admits it. Each
+ * finished request returns its place and admits whatever may start next.
  */
 
 #include "async_request_manager.h"
 #include "internal/tls.h"
+#include "internal/request.h"
+#include "internal/response.h"
+#include "internal/url.h"
+#include "ssl_ctx_cache.h"
+#include "trace.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,6 +29,16 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
+#ifndef _WIN32
+    #include <unistd.h>
+    #include <fcntl.h>
+    #include <errno.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/eventfd.h>
+#endif
+
 /* Debug output control */
 #ifdef HTTPMORPH_DEBUG
     #define DEBUG_PRINT(...) printf(__VA_ARGS__)
@@ -20,63 +46,1377 @@
     #define DEBUG_PRINT(...) ((void)0)
 #endif
 
-/* Initial capacity for request array */
-#define INITIAL_CAPACITY 16
+/* Initial capacity for completion queue */
+#define INITIAL_CAPACITY 16
+
+/* Max state transitions per request per poll before yielding to other requests */
+#define MAX_STEPS_PER_POLL 8
+
+/* Event thread wait timeout when nothing is runnable */
+#define EVENT_LOOP_TIMEOUT_MS 100
+
+/* Requests looked at per steal */
+#define STEAL_BATCH 32
+
+/* Atomics for fields read outside the locks that guard them */
+#ifdef _WIN32
+    #define ATOMIC_LOAD_U32(p)     ((uint32_t)InterlockedCompareExchange((volatile LONG*)(p), 0, 0))
+    #define ATOMIC_STORE_U32(p, v) InterlockedExchange((volatile LONG*)(p), (LONG)(v))
+    #define ATOMIC_LOAD_SIZE(p)    ((size_t)InterlockedCompareExchangePointer((PVOID volatile*)(p), NULL, NULL))
+    #define ATOMIC_STORE_SIZE(p, v) InterlockedExchangePointer((PVOID volatile*)(p), (PVOID)(size_t)(v))
+    #define ATOMIC_INC_SIZE(p)     InterlockedIncrementSizeT((volatile SIZE_T*)(p))
+    #define ATOMIC_DEC_SIZE(p)     InterlockedDecrementSizeT((volatile SIZE_T*)(p))
+    #define ATOMIC_INC_U32(p)      ((uint32_t)InterlockedIncrement((volatile LONG*)(p)))
+    #define ATOMIC_LOAD_U64(p)     ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0))
+    #define ATOMIC_STORE_U64(p, v) InterlockedExchange64((volatile LONG64*)(p), (LONG64)(v))
+#else
+    #define ATOMIC_LOAD_U32(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define ATOMIC_STORE_U32(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define ATOMIC_LOAD_SIZE(p)    __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define ATOMIC_STORE_SIZE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define ATOMIC_INC_SIZE(p)     __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define ATOMIC_DEC_SIZE(p)     __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define ATOMIC_INC_U32(p)      __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define ATOMIC_LOAD_U64(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define ATOMIC_STORE_U64(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+/**
+ * Create a notification fd pair (eventfd on Linux, pipe elsewhere)
+ * Returns 0 on success, -1 on error (fds left at -1)
+ */
+static int notify_fd_create(int *read_fd, int *write_fd) {
+    *read_fd = -1;
+    *write_fd = -1;
+#if defined(__linux__)
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd < 0) {
+        return -1;
+    }
+    *read_fd = fd;
+    *write_fd = fd;
+    return 0;
+#elif !defined(_WIN32)
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        int flags = fcntl(fds[i], F_GETFL, 0);
+        fcntl(fds[i], F_SETFL, flags | O_NONBLOCK);
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+    }
+    *read_fd = fds[0];
+    *write_fd = fds[1];
+    return 0;
+#else
+    /* Windows: ProactorEventLoop can't watch raw fds, Python side polls instead */
+    return -1;
+#endif
+}
+
+/**
+ * Close a notification fd pair
+ */
+static void notify_fd_close(int read_fd, int write_fd) {
+#ifndef _WIN32
+    if (read_fd >= 0) {
+        close(read_fd);
+    }
+    if (write_fd >= 0 && write_fd != read_fd) {
+        close(write_fd);
+    }
+#else
+    (void)read_fd;
+    (void)write_fd;
+#endif
+}
+
+/**
+ * Make the read end of a notification fd readable
+ */
+static void notify_fd_signal(int write_fd) {
+#ifndef _WIN32
+    if (write_fd < 0) {
+        return;
+    }
+    uint64_t one = 1;
+    ssize_t n;
+    do {
+        n = write(write_fd, &one, sizeof(one));
+    } while (n < 0 && errno == EINTR);
+    /* EAGAIN means it is already signalled - nothing to do */
+#else
+    (void)write_fd;
+#endif
+}
+
+/**
+ * Reset a notification fd to non-readable
+ */
+static void notify_fd_clear(int read_fd) {
+#ifndef _WIN32
+    if (read_fd < 0) {
+        return;
+    }
+    uint64_t buf[8];
+    while (read(read_fd, buf, sizeof(buf)) > 0) {
+        /* Drain */
+    }
+#else
+    (void)read_fd;
+#endif
+}
+
+/**
+ * I/O readiness callback for request operations
+ */
+static void on_request_io_ready(io_operation_t *op) {
+    async_request_t *req = (async_request_t*)op->user_data;
+    if (req) {
+        req->io_pending = false;
+    }
+}
+
+/**
+ * Timer wheel callback: a request's deadline or next attempt is due
+ */
+static void on_request_timer(timer_wheel_timer_t *timer, void *ctx) {
+    (void)ctx;
+    async_request_t *req = (async_request_t*)timer->data;
+    req->timer_due = true;
+}
+
+/**
+ * Arm a request's timer for its next due time (shard poller lock held)
+ * extra_due_us is a manager-side due time to honour as well (0: none).
+ */
+static void schedule_request_timer(async_manager_shard_t *shard, async_request_t *req,
+                                   uint64_t extra_due_us) {
+    uint64_t due_us = async_request_next_due_us(req);
+    if (extra_due_us && (due_us == 0 || extra_due_us < due_us)) {
+        due_us = extra_due_us;
+    }
+    if (due_us == 0) {
+        timer_wheel_cancel(&shard->timers, &req->timer);
+        return;
+    }
+    req->timer.data = req;
+    timer_wheel_arm(&shard->timers, &req->timer, (due_us + 999) / 1000);
+}
+
+/**
+ * I/O readiness callback for a shard's wakeup fd
+ */
+static void on_wakeup_ready(io_operation_t *op) {
+    async_manager_shard_t *shard = (async_manager_shard_t*)op->user_data;
+    if (shard) {
+        shard->wakeup_pending = true;
+    }
+}
+
+/**
+ * Register request's socket with the I/O engine for the event it waits on
+ * The operation is owned by the request (req->current_op) and reused.
+ */
+static void arm_request_io(async_manager_shard_t *shard, async_request_t *req, int status) {
+    int fd = async_request_get_fd(req);
+    if (fd < 0) {
+        return;
+    }
+
+    io_operation_t *op = req->current_op;
+    if (!op) {
+        op = io_op_recv_create(fd, NULL, 0, on_request_io_ready, req);
+        if (!op) {
+            return;
+        }
+        req->current_op = op;
+    }
+
+    op->type = (status == ASYNC_STATUS_NEED_READ) ? IO_OP_RECV : IO_OP_SEND;
+    op->fd = fd;
+
+    /* IOCP submission is readiness-less for now - keep stepping every poll */
+    if (io_engine_submit(shard->io_engine, op) == 0 &&
+        shard->io_engine->type != IO_ENGINE_IOCP) {
+        req->io_pending = true;
+    }
+}
+
+/**
+ * Unregister a finished request from the I/O engine
+ */
+static void disarm_request_io(async_manager_shard_t *shard, async_request_t *req) {
+    if (req->current_op) {
+        io_engine_remove(shard->io_engine, req->current_op->fd);
+    }
+    req->io_pending = false;
+}
+
+/**
+ * Queue a finished request for the Python side (takes a reference)
+ */
+static void push_completion(async_request_manager_t *mgr, async_request_t *req) {
+    pthread_mutex_lock(&mgr->completion_mutex);
+
+    if (mgr->completed_count >= mgr->completed_capacity) {
+        size_t new_capacity = mgr->completed_capacity ? mgr->completed_capacity * 2 : INITIAL_CAPACITY;
+        async_request_t **new_queue = realloc(mgr->completed,
+                                              new_capacity * sizeof(async_request_t*));
+        if (!new_queue) {
+            /* Can't notify - the Python side will see a timeout instead */
+            pthread_mutex_unlock(&mgr->completion_mutex);
+            return;
+        }
+        mgr->completed = new_queue;
+        mgr->completed_capacity = new_capacity;
+    }
+
+    async_request_ref(req);  /* Queue holds a reference until drained */
+    mgr->completed[mgr->completed_count++] = req;
+
+    /* Only the empty -> non-empty transition needs a wakeup */
+    if (mgr->completed_count == 1) {
+        notify_fd_signal(mgr->completion_fd_write);
+    }
+
+    pthread_mutex_unlock(&mgr->completion_mutex);
+}
+
+/* ====================================================================
+ * SLOT TABLE
+ * ==================================================================== */
+
+/**
+ * Get slot by index (index must be below slot_high_water)
+ */
+static inline async_request_slot_t* slot_at(async_request_manager_t *mgr, uint32_t index) {
+    return &mgr->slot_pages[index >> ASYNC_SLOT_PAGE_SHIFT][index & (ASYNC_SLOT_PAGE_SIZE - 1)];
+}
+
+/**
+ * Get the stripe lock guarding a slot
+ */
+static inline pthread_mutex_t* slot_lock(async_request_manager_t *mgr, uint32_t index) {
+    return &mgr->stripe_locks[index % ASYNC_LOCK_STRIPES];
+}
+
+/**
+ * Build request ID from slot index and generation
+ */
+static inline uint64_t slot_make_id(uint32_t index, uint32_t generation) {
+    return ((uint64_t)generation << 32) | ((uint64_t)index + 1);
+}
+
+/**
+ * Decode request ID into slot index
+ * Returns 0 on success, -1 if the ID can't refer to an allocated slot
+ */
+static int slot_index_from_id(async_request_manager_t *mgr, uint64_t request_id, uint32_t *index) {
+    uint32_t low = (uint32_t)(request_id & 0xFFFFFFFFu);
+    if (low == 0 || low > ATOMIC_LOAD_U32(&mgr->slot_high_water)) {
+        return -1;
+    }
+    *index = low - 1;
+    return 0;
+}
+
+/**
+ * Reserve a free slot (free list first, then grow the high-water mark)
+ * Returns 0 on success, -1 if the table is full or out of memory
+ */
+static int slot_alloc(async_request_manager_t *mgr, uint32_t *index) {
+    pthread_mutex_lock(&mgr->slot_alloc_mutex);
+
+    if (mgr->free_head != 0) {
+        *index = mgr->free_head - 1;
+        mgr->free_head = slot_at(mgr, *index)->next_free;
+        pthread_mutex_unlock(&mgr->slot_alloc_mutex);
+        return 0;
+    }
+
+    uint32_t next = mgr->slot_high_water;
+    uint32_t page = next >> ASYNC_SLOT_PAGE_SHIFT;
+    if (page >= ASYNC_SLOT_MAX_PAGES) {
+        pthread_mutex_unlock(&mgr->slot_alloc_mutex);
+        return -1;
+    }
+
+    if (!mgr->slot_pages[page]) {
+        async_request_slot_t *slots = calloc(ASYNC_SLOT_PAGE_SIZE, sizeof(async_request_slot_t));
+        if (!slots) {
+            pthread_mutex_unlock(&mgr->slot_alloc_mutex);
+            return -1;
+        }
+        mgr->slot_pages[page] = slots;
+    }
+
+    /* Publish after the page exists - pollers read high water without this lock */
+    ATOMIC_STORE_U32(&mgr->slot_high_water, next + 1);
+    *index = next;
+
+    pthread_mutex_unlock(&mgr->slot_alloc_mutex);
+    return 0;
+}
+
+/**
+ * Return a slot to the free list (slot must already be cleared)
+ */
+static void slot_free(async_request_manager_t *mgr, uint32_t index) {
+    pthread_mutex_lock(&mgr->slot_alloc_mutex);
+    slot_at(mgr, index)->next_free = mgr->free_head;
+    mgr->free_head = index + 1;
+    pthread_mutex_unlock(&mgr->slot_alloc_mutex);
+}
+
+/* ====================================================================
+ * SHARDS
+ * ==================================================================== */
+
+/**
+ * Pick the home shard for a URL by hashing its authority (FNV-1a)
+ */
+static uint32_t shard_for_url(const async_request_manager_t *mgr, const char *url) {
+    if (mgr->shard_count <= 1 || !url) {
+        return 0;
+    }
+
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+
+    uint32_t hash = 2166136261u;
+    for (; *p && *p != '/' && *p != '?' && *p != '#'; p++) {
+        char c = *p;
+        if (c >= 'A' && c <= 'Z') c = (char)(c + ('a' - 'A'));
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    return hash % mgr->shard_count;
+}
+
+/**
+ * Make room for `extra` more owned slots (owned_mutex held)
+ * Returns 0 on success, -1 if the list can't grow
+ */
+static int shard_reserve_locked(async_manager_shard_t *shard, size_t extra) {
+    if (shard->owned_count + extra <= shard->owned_capacity) {
+        return 0;
+    }
+
+    size_t new_capacity = shard->owned_capacity ? shard->owned_capacity : INITIAL_CAPACITY;
+    while (new_capacity < shard->owned_count + extra) {
+        new_capacity *= 2;
+    }
+    uint32_t *owned = realloc(shard->owned, new_capacity * sizeof(uint32_t));
+    if (!owned) {
+        return -1;
+    }
+    shard->owned = owned;
+    shard->owned_capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * Add a slot to a shard's owned list (caller holds the slot's stripe lock)
+ * Returns 0 on success, -1 if the list can't grow
+ */
+static int shard_own(async_manager_shard_t *shard, async_request_slot_t *slot, uint32_t index) {
+    pthread_mutex_lock(&shard->owned_mutex);
+
+    if (shard_reserve_locked(shard, 1) < 0) {
+        pthread_mutex_unlock(&shard->owned_mutex);
+        return -1;
+    }
+
+    slot->owned_pos = (uint32_t)shard->owned_count;
+    shard->owned[shard->owned_count++] = index;
+
+    pthread_mutex_unlock(&shard->owned_mutex);
+    return 0;
+}
+
+/**
+ * Unlink a slot from a shard's owned list (owned_mutex held)
+ * The last entry moves into the hole, so walkers go from the end.
+ */
+static void shard_unlink_locked(async_request_manager_t *mgr, async_manager_shard_t *shard,
+                                async_request_slot_t *slot) {
+    uint32_t pos = slot->owned_pos;
+    if (pos < shard->owned_count) {
+        uint32_t last = shard->owned[--shard->owned_count];
+        if (pos < shard->owned_count) {
+            shard->owned[pos] = last;
+            slot_at(mgr, last)->owned_pos = pos;
+        }
+    }
+}
+
+/**
+ * Remove a slot from a shard's owned list (caller holds the slot's stripe lock)
+ */
+static void shard_disown(async_request_manager_t *mgr, async_manager_shard_t *shard,
+                         async_request_slot_t *slot) {
+    pthread_mutex_lock(&shard->owned_mutex);
+    shard_unlink_locked(mgr, shard, slot);
+    pthread_mutex_unlock(&shard->owned_mutex);
+}
+
+/**
+ * Move a slot between owned lists (caller holds the slot's stripe lock)
+ * Both list locks are held for the move, taken in shard order.
+ * Returns 0 on success, -1 if the target list can't grow
+ */
+static int shard_move(async_request_manager_t *mgr, async_manager_shard_t *from,
+                      async_manager_shard_t *to, async_request_slot_t *slot, uint32_t index) {
+    async_manager_shard_t *first = from->index < to->index ? from : to;
+    async_manager_shard_t *second = from->index < to->index ? to : from;
+    pthread_mutex_lock(&first->owned_mutex);
+    pthread_mutex_lock(&second->owned_mutex);
+
+    int result = shard_reserve_locked(to, 1);
+    if (result == 0) {
+        shard_unlink_locked(mgr, from, slot);
+        slot->owned_pos = (uint32_t)to->owned_count;
+        to->owned[to->owned_count++] = index;
+    }
+
+    pthread_mutex_unlock(&second->owned_mutex);
+    pthread_mutex_unlock(&first->owned_mutex);
+    return result;
+}
+
+/* ====================================================================
+ * SCHEDULING
+ * ==================================================================== */
+
+/**
+ * Wake a shard's event thread
+ */
+static void shard_signal(async_manager_shard_t *shard) {
+    if (shard->mgr->event_driven) {
+        notify_fd_signal(shard->wakeup_fd_write);
+    }
+}
+
+/**
+ * Start a held request the scheduler admitted
+ * It may have finished meanwhile (cancelled or timed out while held); its
+ * retirement already returned the place.
+ */
+static void sched_release_hold(async_request_manager_t *mgr, uint64_t request_id) {
+    uint32_t index;
+    if (slot_index_from_id(mgr, request_id, &index) < 0) {
+        return;
+    }
+
+    async_request_slot_t *slot = slot_at(mgr, index);
+    async_manager_shard_t *shard = NULL;
+
+    pthread_mutex_lock(slot_lock(mgr, index));
+    if (slot->req && slot->generation == (uint32_t)(request_id >> 32) && slot->held) {
+        shard = &mgr->shards[slot->shard];
+        slot->held = false;
+        slot->queued = true;  /* Now a candidate for stealing */
+        ATOMIC_INC_SIZE(&shard->queued);
+    }
+    pthread_mutex_unlock(slot_lock(mgr, index));
+
+    if (shard) {
+        shard_signal(shard);
+    }
+}
+
+/**
+ * Let the requests the scheduler admits now start (no locks held)
+ */
+static void sched_dispatch(async_request_manager_t *mgr) {
+    uint64_t ids[ASYNC_SCHED_BATCH];
+    size_t count;
+    do {
+        uint64_t now = async_request_now_us();
+        pthread_mutex_lock(&mgr->sched_mutex);
+        count = request_scheduler_next(mgr->scheduler, now, ids, ASYNC_SCHED_BATCH);
+        ATOMIC_STORE_U64(&mgr->sched_due_us, request_scheduler_next_due_us(mgr->scheduler, now));
+        pthread_mutex_unlock(&mgr->sched_mutex);
+
+        for (size_t i = 0; i < count; i++) {
+            sched_release_hold(mgr, ids[i]);
+        }
+    } while (count == ASYNC_SCHED_BATCH);
+}
+
+/* ====================================================================
+ * HEDGING
+ * ==================================================================== */
+
+/**
+ * Check if a request may be sent twice: safe methods only, and no body or
+ * response stream the two copies would have to share
+ */
+static bool hedge_eligible(const httpmorph_request_t *request) {
+    switch (request->method) {
+        case HTTPMORPH_GET:
+        case HTTPMORPH_HEAD:
+        case HTTPMORPH_OPTIONS:
+            break;
+        default:
+            return false;
+    }
+    return !request->body_source && !request->body_is_file && !request->body_callback;
+}
+
+/**
+ * Feed a copy's time to first byte into the origin's history
+ */
+static void hedge_record(async_request_manager_t *mgr, const async_request_t *req,
+                         uint64_t started_us) {
+    if (req->first_byte_us == 0 || started_us == 0 || req->first_byte_us < started_us) {
+        return;
+    }
+    pthread_mutex_lock(&mgr->hedge_mutex);
+    hedge_policy_record(mgr->hedging, req->request->url, req->first_byte_us - started_us);
+    pthread_mutex_unlock(&mgr->hedge_mutex);
+}
+
+/**
+ * Note that a slot's request starts now and plan its hedge (stripe lock held)
+ */
+static void hedge_plan(async_request_manager_t *mgr, async_request_slot_t *slot) {
+    slot->started_us = async_request_now_us();
+    slot->hedge_at_us = 0;
+    if (!ATOMIC_LOAD_U32(&mgr->hedging_on) || !mgr->event_driven ||
+        !hedge_eligible(slot->req->request)) {
+        return;
+    }
+
+    pthread_mutex_lock(&mgr->hedge_mutex);
+    uint64_t delay_us = hedge_policy_plan(mgr->hedging, slot->req->request->url);
+    pthread_mutex_unlock(&mgr->hedge_mutex);
+    if (delay_us) {
+        slot->hedge_at_us = slot->started_us + delay_us;
+    }
+}
+
+/**
+ * Drop a slot's duplicate (stripe lock and shard poller lock held)
+ */
+static void hedge_drop(async_manager_shard_t *shard, async_request_slot_t *slot, bool won) {
+    async_request_manager_t *mgr = shard->mgr;
+    async_request_t *hedge = slot->hedge;
+
+    disarm_request_io(shard, hedge);
+    timer_wheel_cancel(&shard->timers, &hedge->timer);
+    hedge_record(mgr, hedge, hedge->start_time_us);
+
+    pthread_mutex_lock(&mgr->hedge_mutex);
+    hedge_policy_release(mgr->hedging, won);
+    pthread_mutex_unlock(&mgr->hedge_mutex);
+
+    slot->hedge = NULL;
+    async_request_unref(hedge);
+}
+
+/* ====================================================================
+ * REDIRECTS
+ * ==================================================================== */
+
+/**
+ * Hand a finished hop the responses of the hops before it
+ */
+static void redirect_link(async_request_t *req) {
+    httpmorph_response_t *response = req->response;
+    if (!response || req->redirect_count == 0) {
+        return;
+    }
+    response->redirect_from = req->redirect_from;
+    response->redirect_count = req->redirect_count;
+    response->url = httpmorph_response_strdup(response, req->request->url);
+    req->redirect_from = NULL;
+}
+
+/**
+ * A redirect hop waiting to be reported once the stripe lock is dropped
+ * (a tracer may need the GIL, which a submitting thread holds while it
+ * waits for the stripe lock)
+ */
+typedef struct async_hop_report {
+    struct async_hop_report *next;
+    uint64_t id;
+    httpmorph_request_t request;     /* Copies of the fields reported; the */
+    httpmorph_response_t response;   /* caller may free the originals first */
+} async_hop_report_t;
+
+/**
+ * Report redirect hops in the order they were followed and free them
+ * (no locks held)
+ */
+static void hops_report(async_request_manager_t *mgr, async_hop_report_t *hops) {
+    async_hop_report_t *oldest = NULL;
+    while (hops) {
+        async_hop_report_t *next = hops->next;
+        hops->next = oldest;
+        oldest = hops;
+        hops = next;
+    }
+
+    hops = oldest;
+    while (hops) {
+        async_hop_report_t *next = hops->next;
+        metrics_record(mgr->metrics, hops->request.url, &hops->response);
+        trace_request(hops->id, &hops->request, &hops->response);
+        free(hops->request.url);
+        free(hops);
+        hops = next;
+    }
+}
+
+/**
+ * Replace a slot's finished request with the next hop of its redirect
+ * (stripe lock and shard poller lock held)
+ * The hop keeps the request's ID, so the caller still sees one request,
+ * and takes over its connection when it stays on the same origin. The
+ * finished hop goes on *hops, for hops_report() after the lock.
+ * Returns true if the slot now holds the hop.
+ */
+static bool redirect_follow(async_manager_shard_t *shard, async_request_slot_t *slot,
+                            async_hop_report_t **hops) {
+    async_request_manager_t *mgr = shard->mgr;
+    async_request_t *req = slot->req;
+    const httpmorph_request_t *request = req->request;
+
+    if (async_request_get_state(req) != ASYNC_STATE_COMPLETE) {
+        return false;
+    }
+    redirect_link(req);
+    if (!request->follow_redirects || request->body_callback || !req->response) {
+        return false;
+    }
+
+    char *location = async_request_redirect_location(req);
+    if (!location) {
+        return false;
+    }
+    httpmorph_response_t *response = req->response;
+    if (req->redirect_count >= request->max_redirects) {
+        char message[64];
+        snprintf(message, sizeof(message), "Exceeded %u redirects", request->max_redirects);
+        response->error = HTTPMORPH_ERROR_TOO_MANY_REDIRECTS;
+        response->error_message = httpmorph_response_strdup(response, message);
+        free(location);
+        return false;
+    }
+
+    char *url = httpmorph_resolve_url(request->url, location);
+    free(location);
+    httpmorph_request_t *next_request = url ? httpmorph_request_redirect(request, (uint16_t)response->status_code, url) : NULL;
+    free(url);
+    if (!next_request) {
+        return false;  /* Can't be replayed: the redirect is the answer */
+    }
+
+    /* All hops share the request's timeout */
+    uint64_t now = async_request_now_us();
+    uint32_t timeout_ms = req->timeout_ms;
+    if (req->deadline_us) {
+        timeout_ms = req->deadline_us > now ? (uint32_t)((req->deadline_us - now + 999) / 1000) : 1;
+    }
+    next_request->timeout_ms = timeout_ms;
+
+    async_hop_report_t *report = calloc(1, sizeof(async_hop_report_t));
+    if (report) {
+        report->request.url = strdup(request->url);
+    }
+    async_request_t *next = report && report->request.url ?
+        async_request_create(next_request, shard->io_engine, mgr->ssl_ctx, mgr->session_cache,
+                             timeout_ms, req->on_complete, req->user_data) : NULL;
+    if (!next) {
+        if (report) {
+            free(report->request.url);
+            free(report);
+        }
+        httpmorph_request_destroy(next_request);
+        return false;
+    }
+    async_request_set_memory_budget(next, mgr->budget);
+    next->id = req->id;
+    next->dns_notify_fd = shard->wakeup_fd_write;
+    next->owned_request = next_request;
+    next->redirect_count = req->redirect_count + 1;
+    next->redirect_from = response;
+    req->response = NULL;
+    report->id = req->id;
+    report->request.method = request->method;
+    report->response = *response;
+    report->next = *hops;
+    *hops = report;
+
+    /* Hops aren't hedged; a duplicate still racing the redirect loses */
+    if (slot->hedge) {
+        hedge_drop(shard, slot, false);
+    }
+    if (ATOMIC_LOAD_U32(&mgr->hedging_on)) {
+        hedge_record(mgr, req, slot->started_us);
+    }
+    slot->started_us = 0;
+    slot->hedge_at_us = 0;
+
+    disarm_request_io(shard, req);
+    timer_wheel_cancel(&shard->timers, &req->timer);
+    async_request_take_connection(next, req);
+
+    slot->req = next;
+    async_request_unref(req);  /* Release manager's reference */
+    return true;
+}
+
+/* ====================================================================
+ * PRECONNECTED CONNECTIONS
+ * ==================================================================== */
+
+/**
+ * Keep a finished preconnect's connection for a later request (stripe
+ * lock held, request disarmed)
+ * A full list makes room by closing its oldest connection.
+ */
+static void warm_park(async_request_manager_t *mgr, uint32_t shard, async_request_t *req) {
+    async_request_t *closed = NULL;
+
+    async_request_ref(req);
+    pthread_mutex_lock(&mgr->warm_mutex);
+    if (mgr->warm_count == ASYNC_WARM_MAX) {
+        closed = mgr->warm[0].req;
+        memmove(&mgr->warm[0], &mgr->warm[1], (ASYNC_WARM_MAX - 1) * sizeof(mgr->warm[0]));
+        mgr->warm_count--;
+    }
+    async_warm_connection_t *warm = &mgr->warm[mgr->warm_count];
+    warm->req = req;
+    warm->shard = shard;
+    warm->parked_us = async_request_now_us();
+    ATOMIC_STORE_SIZE(&mgr->warm_count, mgr->warm_count + 1);
+    pthread_mutex_unlock(&mgr->warm_mutex);
+
+    async_request_unref(closed);
+}
+
+/**
+ * Start a request on a preconnected connection to its origin, if the
+ * shard has one (stripe lock held, request not stepped yet)
+ * Connections kept longer than ASYNC_WARM_IDLE_MS are closed on the way,
+ * as is one the server closed meanwhile.
+ */
+static void warm_take(async_request_manager_t *mgr, async_manager_shard_t *shard,
+                      async_request_t *req) {
+    if (ATOMIC_LOAD_SIZE(&mgr->warm_count) == 0 || req->connect_only ||
+        async_request_get_state(req) != ASYNC_STATE_INIT) {
+        return;
+    }
+
+    async_request_t *closed[ASYNC_WARM_MAX];
+    size_t closed_count = 0;
+    uint64_t expired_us = async_request_now_us() - (uint64_t)ASYNC_WARM_IDLE_MS * 1000;
+
+    pthread_mutex_lock(&mgr->warm_mutex);
+    size_t kept = 0;
+    bool taken = false;
+    for (size_t i = 0; i < mgr->warm_count; i++) {
+        async_warm_connection_t *warm = &mgr->warm[i];
+        bool drop = warm->parked_us < expired_us;
+        if (!drop && !taken && warm->shard == shard->index &&
+            warm->req->request->verify_ssl == req->request->verify_ssl) {
+            const httpmorph_request_t *a = req->request;
+            const httpmorph_request_t *b = warm->req->request;
+            bool same_origin = a->host && b->host && a->port == b->port &&
+                               a->use_tls == b->use_tls && strcasecmp(a->host, b->host) == 0;
+            if (same_origin) {
+                /* Taken, or found closed: either way it leaves the list */
+                taken = async_request_take_connection(req, warm->req);
+                drop = true;
+            }
+        }
+        if (drop) {
+            closed[closed_count++] = warm->req;
+        } else {
+            mgr->warm[kept++] = *warm;
+        }
+    }
+    ATOMIC_STORE_SIZE(&mgr->warm_count, kept);
+    pthread_mutex_unlock(&mgr->warm_mutex);
+
+    for (size_t i = 0; i < closed_count; i++) {
+        async_request_unref(closed[i]);
+    }
+}
+
+/* ====================================================================
+ * STEPPING
+ * ==================================================================== */
+
+/**
+ * Retire a finished request held in a slot (stripe lock must be held)
+ * Returns the request; the caller reports it and releases the manager's
+ * reference and the slot after dropping the stripe lock.
+ */
+static async_request_t* slot_retire_locked(async_request_manager_t *mgr, async_request_slot_t *slot) {
+    async_request_t *req = slot->req;
+    async_manager_shard_t *shard = &mgr->shards[slot->shard];
+
+    disarm_request_io(shard, req);
+    timer_wheel_cancel(&shard->timers, &req->timer);
+    shard_disown(mgr, shard, slot);
+    if (slot->queued) {
+        slot->queued = false;
+        ATOMIC_DEC_SIZE(&shard->queued);
+    }
+
+    /* Give back its place (or its spot in the queue) */
+    if (slot->sched_origin) {
+        pthread_mutex_lock(&mgr->sched_mutex);
+        request_scheduler_finish(mgr->scheduler, slot->sched_origin, req->id);
+        pthread_mutex_unlock(&mgr->sched_mutex);
+        slot->sched_origin = NULL;
+        slot->held = false;
+    }
+
+    /* The original answered first (or gave up): the duplicate loses */
+    if (slot->hedge) {
+        hedge_drop(shard, slot, false);
+    }
+    if (ATOMIC_LOAD_U32(&mgr->hedging_on)) {
+        hedge_record(mgr, req, slot->started_us);
+    }
+    slot->started_us = 0;
+    slot->hedge_at_us = 0;
+    if (req->connect_only && async_request_get_state(req) == ASYNC_STATE_COMPLETE) {
+        warm_park(mgr, slot->shard, req);  /* A preconnect isn't a request: its connection is the result */
+    }
+
+    slot->req = NULL;
+    slot->generation++;  /* Invalidate outstanding IDs */
+    return req;
+}
+
+/**
+ * Report and release what slot_retire_locked() handed back (no locks held)
+ * The request is reported before the completion queue gets it: once the
+ * caller has the response it may free its request.
+ */
+static void slot_release(async_request_manager_t *mgr, uint32_t index, async_request_t *req) {
+    if (!req->connect_only) {
+        metrics_record(mgr->metrics, req->request->url, async_request_get_response(req));
+    }
+    trace_request(req->id, req->request, async_request_get_response(req));
+
+    /* Hand over to the completion queue in event-driven mode */
+    if (mgr->event_driven) {
+        push_completion(mgr, req);
+    }
+
+    slot_free(mgr, index);
+    ATOMIC_DEC_SIZE(&mgr->request_count);
+    async_request_unref(req);  /* Release manager's reference */
+
+    /* Its place may let a queued request start */
+    if (ATOMIC_LOAD_U32(&mgr->scheduling)) {
+        sched_dispatch(mgr);
+    }
+}
+
+/**
+ * Step a started request unless it waits on I/O, then park it (stripe
+ * lock and shard poller lock held)
+ * Sets *armed when the request is parked in the I/O engine; extra_due_us
+ * is passed on to its timer.
+ */
+static int request_advance(async_manager_shard_t *shard, async_request_t *req,
+                           uint64_t extra_due_us, bool *armed) {
+    int status = ASYNC_STATUS_IN_PROGRESS;
+
+    *armed = false;
+
+    /* Still waiting for readiness, for the consumer to resume or for memory
+     * budget (the timer wheel flags deadlines, connection attempts and
+     * budget retries that come due) */
+    if ((req->io_pending || req->body_paused || req->budget_wait || async_request_dns_pending(req)) &&
+        !req->timer_due) {
+        *armed = true;
+        return status;
+    }
+    req->io_pending = false;
+    req->timer_due = false;
+
+    /* Step the state machine through non-blocking transitions */
+    int steps = 0;
+    do {
+        status = async_request_step(req);
+    } while (status == ASYNC_STATUS_IN_PROGRESS && ++steps < MAX_STEPS_PER_POLL);
+
+    /* Register for events based on status */
+    if (status == ASYNC_STATUS_NEED_READ || status == ASYNC_STATUS_NEED_WRITE) {
+        arm_request_io(shard, req, status);
+        *armed = req->io_pending;
+    } else if (status == ASYNC_STATUS_PAUSED) {
+        *armed = true;  /* Parked until async_manager_resume_request() or a budget retry */
+    } else if (status == ASYNC_STATUS_NEED_DNS) {
+        *armed = true;  /* Parked until the resolver signals the wakeup fd */
+    }
+
+    async_request_state_t state = async_request_get_state(req);
+    if (state != ASYNC_STATE_COMPLETE && state != ASYNC_STATE_ERROR) {
+        schedule_request_timer(shard, req, extra_due_us);
+    }
+    return status;
+}
+
+/**
+ * Race a slow request against a duplicate (stripe lock and shard poller
+ * lock held, request not finished)
+ * Sends the duplicate once the hedge delay passes without a response byte
+ * and settles the race when either copy finishes. Clears *armed if the
+ * duplicate needs polling. Returns true if the request finished with the
+ * duplicate's response.
+ */
+static bool hedge_update(async_manager_shard_t *shard, async_request_slot_t *slot, bool *armed) {
+    async_request_manager_t *mgr = shard->mgr;
+    async_request_t *req = slot->req;
+    async_request_t *hedge = slot->hedge;
+
+    if (hedge) {
+        async_request_state_t state = async_request_get_state(hedge);
+        if (state == ASYNC_STATE_COMPLETE) {
+            async_request_adopt(req, hedge);
+            hedge_drop(shard, slot, true);
+            slot->started_us = 0;  /* Never answered: no sample of its own */
+            return true;
+        }
+        if (state == ASYNC_STATE_ERROR) {
+            hedge_drop(shard, slot, false);  /* The original may still answer */
+        }
+        return false;
+    }
+
+    uint64_t now = async_request_now_us();
+    if (slot->hedge_at_us == 0 || now < slot->hedge_at_us) {
+        return false;
+    }
+    slot->hedge_at_us = 0;
+    schedule_request_timer(shard, req, 0);
+    if (req->first_byte_us) {
+        return false;  /* Already answering */
+    }
+
+    pthread_mutex_lock(&mgr->hedge_mutex);
+    bool allowed = hedge_policy_acquire(mgr->hedging);
+    pthread_mutex_unlock(&mgr->hedge_mutex);
+    if (!allowed) {
+        return false;
+    }
+
+    /* The duplicate gets whatever is left of the original's time */
+    uint32_t timeout_ms = req->timeout_ms;
+    if (req->deadline_us) {
+        timeout_ms = req->deadline_us > now ? (uint32_t)((req->deadline_us - now + 999) / 1000) : 1;
+    }
+    hedge = async_request_create(req->request, shard->io_engine, mgr->ssl_ctx, mgr->session_cache,
+                                 timeout_ms, NULL, NULL);
+    if (!hedge) {
+        pthread_mutex_lock(&mgr->hedge_mutex);
+        hedge_policy_release(mgr->hedging, false);
+        pthread_mutex_unlock(&mgr->hedge_mutex);
+        return false;
+    }
+    async_request_set_memory_budget(hedge, mgr->budget);
+    hedge->id = req->id;
+    hedge->dns_notify_fd = shard->wakeup_fd_write;
+    slot->hedge = hedge;
+
+    bool hedge_armed;
+    request_advance(shard, hedge, 0, &hedge_armed);
+    if (!hedge_armed) {
+        *armed = false;
+    }
+    return hedge_update(shard, slot, armed);  /* It may have failed straight away */
+}
+
+/**
+ * Visit one slot on behalf of a shard: step it unless it waits on I/O,
+ * retire it if finished
+ * Sets *armed when the request (and its duplicate, if hedged) is parked in
+ * the I/O engine. Returns the step status, or ASYNC_STATUS_COMPLETE if the
+ * slot is empty, retired or now belongs to another shard.
+ */
+static int slot_process(async_manager_shard_t *shard, uint32_t index, bool *armed) {
+    async_request_manager_t *mgr = shard->mgr;
+    pthread_mutex_t *lock = slot_lock(mgr, index);
+    async_request_slot_t *slot = slot_at(mgr, index);
+    async_hop_report_t *hops = NULL;
+    int status = ASYNC_STATUS_COMPLETE;
+
+    *armed = false;
+
+    pthread_mutex_lock(lock);
+    async_request_t *req = slot->req;
+    if (!req || slot->shard != shard->index) {
+        pthread_mutex_unlock(lock);  /* Freed or stolen since the caller read the index */
+        return status;
+    }
+
+    async_request_state_t state = async_request_get_state(req);
+    bool finished = (state == ASYNC_STATE_COMPLETE || state == ASYNC_STATE_ERROR);
+
+    /* Not admitted yet: only its deadline can end the wait */
+    if (!finished && slot->held) {
+        if (!async_request_is_timeout(req)) {
+            req->timer_due = false;
+            if (!req->timer.armed) {
+                schedule_request_timer(shard, req, 0);
+            }
+            pthread_mutex_unlock(lock);
+            *armed = true;
+            return ASYNC_STATUS_IN_PROGRESS;
+        }
+        async_request_step(req);  /* Fails it with the timeout */
+        finished = true;
+    }
+
+    if (!finished) {
+        /* Started: no longer a candidate for stealing */
+        if (slot->queued) {
+            slot->queued = false;
+            ATOMIC_DEC_SIZE(&shard->queued);
+            hedge_plan(mgr, slot);
+            warm_take(mgr, shard, req);
+        }
+
+        status = request_advance(shard, req, slot->hedge_at_us, armed);
+        if (slot->hedge) {
+            bool hedge_armed;
+            request_advance(shard, slot->hedge, 0, &hedge_armed);
+            if (!hedge_armed) {
+                *armed = false;
+                status = ASYNC_STATUS_IN_PROGRESS;
+            }
+        }
+
+        state = async_request_get_state(req);
+        finished = (state == ASYNC_STATE_COMPLETE || state == ASYNC_STATE_ERROR);
+        if (!finished && (slot->hedge || slot->hedge_at_us)) {
+            finished = hedge_update(shard, slot, armed);
+            if (!finished && slot->hedge && !*armed) {
+                status = ASYNC_STATUS_IN_PROGRESS;
+            }
+        }
+    }
+
+    /* A redirect carries on in the same slot */
+    while (finished && redirect_follow(shard, slot, &hops)) {
+        status = request_advance(shard, slot->req, 0, armed);
+        state = async_request_get_state(slot->req);
+        finished = (state == ASYNC_STATE_COMPLETE || state == ASYNC_STATE_ERROR);
+    }
+
+    if (!finished) {
+        pthread_mutex_unlock(lock);
+        hops_report(mgr, hops);
+        return status;
+    }
+
+    req = slot_retire_locked(mgr, slot);
+    pthread_mutex_unlock(lock);
+
+    hops_report(mgr, hops);
+    slot_release(mgr, index, req);
+    return ASYNC_STATUS_COMPLETE;
+}
+
+/**
+ * Take queued requests from the busiest shard (thief's poller lock held)
+ * Only requests that haven't been stepped move: they have no socket,
+ * DNS lookup or engine registration yet. Returns the number taken.
+ */
+static size_t shard_steal(async_manager_shard_t *thief) {
+    async_request_manager_t *mgr = thief->mgr;
+    async_manager_shard_t *victim = NULL;
+    size_t most = 1;  /* A single queued request is about to be started anyway */
+
+    for (uint32_t s = 0; s < mgr->shard_count; s++) {
+        size_t queued = ATOMIC_LOAD_SIZE(&mgr->shards[s].queued);
+        if (s != thief->index && queued > most) {
+            victim = &mgr->shards[s];
+            most = queued;
+        }
+    }
+    if (!victim) {
+        return 0;
+    }
+
+    size_t want = most / 2;
+    if (want > STEAL_BATCH) {
+        want = STEAL_BATCH;
+    }
+
+    /* Queued requests are the newest, so they sit at the end of the list */
+    uint32_t candidates[STEAL_BATCH * 2];
+    size_t count = 0;
+    pthread_mutex_lock(&victim->owned_mutex);
+    for (size_t i = victim->owned_count; i-- > 0 && count < STEAL_BATCH * 2;) {
+        candidates[count++] = victim->owned[i];
+    }
+    pthread_mutex_unlock(&victim->owned_mutex);
+
+    size_t taken = 0;
+    for (size_t i = 0; i < count && taken < want; i++) {
+        uint32_t index = candidates[i];
+        async_request_slot_t *slot = slot_at(mgr, index);
+
+        /* Re-check under the stripe lock: it may have started, finished or moved */
+        pthread_mutex_lock(slot_lock(mgr, index));
+        if (slot->req && slot->queued && slot->shard == victim->index &&
+            shard_move(mgr, victim, thief, slot, index) == 0) {
+            slot->shard = (uint16_t)thief->index;
+            slot->req->io_engine = thief->io_engine;
+            slot->req->dns_notify_fd = thief->wakeup_fd_write;
+            ATOMIC_DEC_SIZE(&victim->queued);
+            ATOMIC_INC_SIZE(&thief->queued);
+            taken++;
+        }
+        pthread_mutex_unlock(slot_lock(mgr, index));
+    }
+
+    thief->steals += taken;
+    return taken;
+}
+
+/**
+ * Poll one shard's engine and step the requests it owns
+ * Stores the number of requests that are runnable without waiting for
+ * I/O in *runnable if non-NULL.
+ */
+static int shard_poll(async_manager_shard_t *shard, uint32_t timeout_ms, size_t *runnable) {
+    async_request_manager_t *mgr = shard->mgr;
+    size_t ready = 0;
+
+    pthread_mutex_lock(&shard->mutex);
+
+    /* Sleep no longer than the next timer */
+    uint64_t next = timer_wheel_next_expiry(&shard->timers);
+    if (next != TIMER_WHEEL_NONE) {
+        uint64_t now_ms = async_request_now_us() / 1000;
+        uint64_t until = next > now_ms ? next - now_ms : 0;
+        if (until < timeout_ms) {
+            timeout_ms = (uint32_t)until;
+        }
+    }
+
+    /* ...nor past the next rate-limited admission */
+    uint64_t sched_due = ATOMIC_LOAD_U64(&mgr->sched_due_us);
+    if (sched_due) {
+        uint64_t now_us = async_request_now_us();
+        uint64_t until = sched_due > now_us ? (sched_due - now_us + 999) / 1000 : 0;
+        if (until < timeout_ms) {
+            timeout_ms = (uint32_t)until;
+        }
+    }
+
+    /* Wait for I/O events (callbacks clear req->io_pending) */
+    int events = io_engine_wait(shard->io_engine, timeout_ms);
+
+    /* Flag requests whose deadline or next attempt came due */
+    timer_wheel_advance(&shard->timers, async_request_now_us() / 1000, on_request_timer, NULL);
+
+    /* Re-arm wakeup fd (one-shot on kqueue) */
+    if (shard->wakeup_pending) {
+        shard->wakeup_pending = false;
+        notify_fd_clear(shard->wakeup_fd);
+        if (shard->wakeup_op) {
+            io_engine_submit(shard->io_engine, shard->wakeup_op);
+        }
+    }
+
+    /* A rate limit let queued requests start */
+    sched_due = ATOMIC_LOAD_U64(&mgr->sched_due_us);
+    if (sched_due && async_request_now_us() >= sched_due) {
+        sched_dispatch(mgr);
+    }
+
+    /* Nothing of our own waiting to start: help the busiest shard */
+    if (mgr->shard_count > 1 && ATOMIC_LOAD_SIZE(&shard->queued) == 0) {
+        shard_steal(shard);
+    }
+
+    /* Walk owned slots from the end - retiring swaps the last entry into the hole */
+    pthread_mutex_lock(&shard->owned_mutex);
+    size_t i = shard->owned_count;
+    pthread_mutex_unlock(&shard->owned_mutex);
+
+    while (i-- > 0) {
+        pthread_mutex_lock(&shard->owned_mutex);
+        if (i >= shard->owned_count) {
+            pthread_mutex_unlock(&shard->owned_mutex);
+            continue;  /* Shrunk by a steal */
+        }
+        uint32_t index = shard->owned[i];
+        pthread_mutex_unlock(&shard->owned_mutex);
+
+        bool armed;
+        int status = slot_process(shard, index, &armed);
+        if (!armed && (status == ASYNC_STATUS_IN_PROGRESS ||
+                       status == ASYNC_STATUS_NEED_READ ||
+                       status == ASYNC_STATUS_NEED_WRITE)) {
+            ready++;  /* Engine can't wait on it - poll again soon */
+        }
+    }
+
+    pthread_mutex_unlock(&shard->mutex);
+
+    if (runnable) {
+        *runnable = ready;
+    }
+    return events;
+}
+
+/**
+ * Set up a shard
+ * Returns 0 on success, -1 if its I/O engine can't be created
+ */
+static int shard_init(async_request_manager_t *mgr, async_manager_shard_t *shard,
+                      uint32_t index, uint32_t io_options) {
+    shard->mgr = mgr;
+    shard->index = index;
+    shard->io_engine = io_engine_create_ex(256, io_options);  /* Queue depth 256 */
+    if (!shard->io_engine) {
+        return -1;
+    }
+
+    pthread_mutex_init(&shard->mutex, NULL);
+    pthread_mutex_init(&shard->owned_mutex, NULL);
+    timer_wheel_init(&shard->timers, async_request_now_us() / 1000);
+
+    /* Wakeup fd for event-driven mode (optional - -1 if unsupported) */
+    notify_fd_create(&shard->wakeup_fd, &shard->wakeup_fd_write);
+    return 0;
+}
+
+/**
+ * Tear down a shard set up by shard_init()
+ */
+static void shard_cleanup(async_manager_shard_t *shard) {
+    if (!shard->io_engine) {
+        return;
+    }
+
+    if (shard->wakeup_op) {
+        io_engine_remove(shard->io_engine, shard->wakeup_fd);
+        io_op_destroy(shard->wakeup_op);
+        shard->wakeup_op = NULL;
+    }
+    notify_fd_close(shard->wakeup_fd, shard->wakeup_fd_write);
+
+    io_engine_destroy(shard->io_engine);
+    shard->io_engine = NULL;
 
-/* Forward declarations */
-static void cleanup_completed_requests(async_request_manager_t *mgr);
+    free(shard->owned);
+    shard->owned = NULL;
+    shard->owned_count = 0;
+
+    pthread_mutex_destroy(&shard->mutex);
+    pthread_mutex_destroy(&shard->owned_mutex);
+}
+
+/**
+ * Number of online CPUs (at least 1)
+ */
+static uint32_t cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    long n = (long)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    return n > 0 ? (uint32_t)n : 1;
+}
 
 /**
  * Create a new async request manager
  */
 async_request_manager_t* async_manager_create(void) {
+    return async_manager_create_sharded(1, 0);
+}
+
+/**
+ * Create a new async request manager with I/O engine options
+ */
+async_request_manager_t* async_manager_create_ex(uint32_t io_options) {
+    return async_manager_create_sharded(1, io_options);
+}
+
+/**
+ * Create a new async request manager with several shards
+ */
+async_request_manager_t* async_manager_create_sharded(uint32_t shard_count, uint32_t io_options) {
+    if (shard_count == 0) {
+        shard_count = cpu_count();
+    }
+    if (shard_count > ASYNC_MAX_SHARDS) {
+        shard_count = ASYNC_MAX_SHARDS;
+    }
+
     async_request_manager_t *mgr = calloc(1, sizeof(async_request_manager_t));
     if (!mgr) {
         return NULL;
     }
-
-    /* Create I/O engine */
-    mgr->io_engine = io_engine_create(256);  /* Queue depth 256 */
-    if (!mgr->io_engine) {
+    mgr->shards = calloc(shard_count, sizeof(async_manager_shard_t));
+    if (!mgr->shards) {
         free(mgr);
         return NULL;
     }
 
-    /* Create SSL context */
-    mgr->ssl_ctx = SSL_CTX_new(TLS_client_method());
-    if (!mgr->ssl_ctx) {
-        io_engine_destroy(mgr->io_engine);
-        free(mgr);
-        return NULL;
+    /* Create each shard's I/O engine */
+    for (uint32_t i = 0; i < shard_count; i++) {
+        if (shard_init(mgr, &mgr->shards[i], i, io_options) < 0) {
+            while (i-- > 0) {
+                shard_cleanup(&mgr->shards[i]);
+            }
+            free(mgr->shards);
+            free(mgr);
+            return NULL;
+        }
     }
-
-    /* Configure SSL context */
-    SSL_CTX_set_verify(mgr->ssl_ctx, SSL_VERIFY_PEER, NULL);
-#ifdef _WIN32
-    /* On Windows, load certificates from Windows Certificate Store */
-    httpmorph_load_windows_ca_certs(mgr->ssl_ctx);
-#else
-    /* On Unix-like systems, use default paths */
-    SSL_CTX_set_default_verify_paths(mgr->ssl_ctx);
-#endif
-
-    /* Allocate request array */
-    mgr->request_capacity = INITIAL_CAPACITY;
-    mgr->requests = calloc(mgr->request_capacity, sizeof(async_request_t*));
-    if (!mgr->requests) {
-        SSL_CTX_free(mgr->ssl_ctx);
-        io_engine_destroy(mgr->io_engine);
+    mgr->shard_count = shard_count;
+
+    /* Shared SSL context (library defaults, verification on) */
+    ssl_ctx_key_t ctx_key = { NULL, true, 0, 0, NULL };
+    mgr->ssl_ctx = ssl_ctx_cache_acquire(&ctx_key);
+    mgr->session_cache = tls_session_cache_create(0);
+    mgr->metrics = metrics_create();
+    mgr->budget = mem_budget_create(0);  /* Counts only until async_manager_set_memory_budget() */
+    if (!mgr->ssl_ctx || !mgr->session_cache || !mgr->metrics || !mgr->budget) {
+        ssl_ctx_cache_release(mgr->ssl_ctx);
+        tls_session_cache_destroy(mgr->session_cache);
+        metrics_destroy(mgr->metrics);
+        mem_budget_unref(mgr->budget);
+        for (uint32_t i = 0; i < shard_count; i++) {
+            shard_cleanup(&mgr->shards[i]);
+        }
+        free(mgr->shards);
         free(mgr);
         return NULL;
     }
 
-    /* Initialize mutex */
-    pthread_mutex_init(&mgr->mutex, NULL);
+    /* Initialize mutexes (slot pages are allocated on demand) */
+    pthread_mutex_init(&mgr->slot_alloc_mutex, NULL);
+    for (int i = 0; i < ASYNC_LOCK_STRIPES; i++) {
+        pthread_mutex_init(&mgr->stripe_locks[i], NULL);
+    }
+    pthread_mutex_init(&mgr->completion_mutex, NULL);
+    pthread_mutex_init(&mgr->sched_mutex, NULL);
+    pthread_mutex_init(&mgr->hedge_mutex, NULL);
+    pthread_mutex_init(&mgr->warm_mutex, NULL);
 
-    /* Initialize ID counter */
-    mgr->next_request_id = 1;
+    /* Completion fd for event-driven mode (optional - -1 if unsupported) */
+    notify_fd_create(&mgr->completion_fd, &mgr->completion_fd_write);
 
-    DEBUG_PRINT("[async_manager] Created with I/O engine and SSL context\n");
+    DEBUG_PRINT("[async_manager] Created with %u shard(s) and SSL context\n", shard_count);
     return mgr;
 }
 
@@ -93,101 +1433,115 @@ void async_manager_destroy(async_request_manager_t *mgr) {
         async_manager_stop_event_loop(mgr);
     }
 
-    DEBUG_PRINT("[async_manager] Graceful shutdown: waiting for %zu active requests\n", mgr->request_count);
+    DEBUG_PRINT("[async_manager] Graceful shutdown: waiting for %zu active requests\n",
+                ATOMIC_LOAD_SIZE(&mgr->request_count));
 
     /* Graceful shutdown: Wait for all active requests to complete or timeout */
-    pthread_mutex_lock(&mgr->mutex);
     int wait_iterations = 0;
     const int max_wait_iterations = 100;  /* 10 seconds max (100 * 100ms) */
 
-    while (mgr->request_count > 0 && wait_iterations < max_wait_iterations) {
-        pthread_mutex_unlock(&mgr->mutex);
-
+    while (ATOMIC_LOAD_SIZE(&mgr->request_count) > 0 && wait_iterations < max_wait_iterations) {
         /* Give requests time to complete */
         struct timespec ts = {0, 100000000};  /* 100ms */
         nanosleep(&ts, NULL);
 
-        /* Step all requests to allow them to complete */
-        pthread_mutex_lock(&mgr->mutex);
-        for (size_t i = 0; i < mgr->request_count; i++) {
-            if (mgr->requests[i]) {
-                async_request_state_t state = async_request_get_state(mgr->requests[i]);
-
-                /* For requests still in progress, step them */
-                if (state != ASYNC_STATE_COMPLETE && state != ASYNC_STATE_ERROR) {
-                    async_request_step(mgr->requests[i]);
-                }
+        /* Step all requests to allow them to complete, retire finished ones */
+        uint32_t high_water = ATOMIC_LOAD_U32(&mgr->slot_high_water);
+        for (uint32_t i = 0; i < high_water; i++) {
+            async_request_slot_t *slot = slot_at(mgr, i);
+            pthread_mutex_lock(slot_lock(mgr, i));
+            async_manager_shard_t *shard = &mgr->shards[slot->shard];
+            if (slot->req) {
+                slot->req->io_pending = false;  /* Not waiting on the engine here */
             }
-        }
+            pthread_mutex_unlock(slot_lock(mgr, i));
 
-        /* Clean up completed requests */
-        cleanup_completed_requests(mgr);
+            bool armed;
+            pthread_mutex_lock(&shard->mutex);
+            slot_process(shard, i, &armed);
+            pthread_mutex_unlock(&shard->mutex);
+        }
 
         wait_iterations++;
 
-        if (mgr->request_count > 0 && wait_iterations % 10 == 0) {
+        if (ATOMIC_LOAD_SIZE(&mgr->request_count) > 0 && wait_iterations % 10 == 0) {
             DEBUG_PRINT("[async_manager] Still waiting for %zu requests (iteration %d)\n",
-                   mgr->request_count, wait_iterations);
+                   ATOMIC_LOAD_SIZE(&mgr->request_count), wait_iterations);
         }
     }
 
     /* Force cleanup of any remaining requests */
-    if (mgr->request_count > 0) {
-        DEBUG_PRINT("[async_manager] Force cleanup of %zu remaining requests\n", mgr->request_count);
-        for (size_t i = 0; i < mgr->request_count; i++) {
-            if (mgr->requests[i]) {
-                /* Set error state for incomplete requests */
-                async_request_state_t state = async_request_get_state(mgr->requests[i]);
-                if (state != ASYNC_STATE_COMPLETE && state != ASYNC_STATE_ERROR) {
-                    async_request_set_error(mgr->requests[i], -1, "Manager shutdown");
-                }
-                async_request_unref(mgr->requests[i]);
+    uint32_t high_water = ATOMIC_LOAD_U32(&mgr->slot_high_water);
+    for (uint32_t i = 0; i < high_water; i++) {
+        async_request_slot_t *slot = slot_at(mgr, i);
+        if (slot->req) {
+            /* Set error state for incomplete requests */
+            async_request_state_t state = async_request_get_state(slot->req);
+            if (state != ASYNC_STATE_COMPLETE && state != ASYNC_STATE_ERROR) {
+                async_request_set_error(slot->req, -1, "Manager shutdown");
             }
+            if (slot->hedge) {
+                disarm_request_io(&mgr->shards[slot->shard], slot->hedge);
+                async_request_unref(slot->hedge);
+                slot->hedge = NULL;
+            }
+            disarm_request_io(&mgr->shards[slot->shard], slot->req);
+            async_request_unref(slot->req);
+            slot->req = NULL;
         }
     }
 
-    free(mgr->requests);
-    pthread_mutex_unlock(&mgr->mutex);
+    for (uint32_t p = 0; p < ASYNC_SLOT_MAX_PAGES && mgr->slot_pages[p]; p++) {
+        free(mgr->slot_pages[p]);
+        mgr->slot_pages[p] = NULL;
+    }
+    mgr->request_count = 0;
 
-    /* Destroy SSL context */
-    if (mgr->ssl_ctx) {
-        SSL_CTX_free(mgr->ssl_ctx);
+    /* Release completions nobody drained */
+    pthread_mutex_lock(&mgr->completion_mutex);
+    for (size_t i = 0; i < mgr->completed_count; i++) {
+        async_request_unref(mgr->completed[i]);
     }
+    free(mgr->completed);
+    mgr->completed = NULL;
+    mgr->completed_count = 0;
+    pthread_mutex_unlock(&mgr->completion_mutex);
 
-    /* Destroy I/O engine */
-    io_engine_destroy(mgr->io_engine);
+    notify_fd_close(mgr->completion_fd, mgr->completion_fd_write);
 
-    /* Destroy mutex */
-    pthread_mutex_destroy(&mgr->mutex);
+    /* Close preconnected connections nobody used */
+    for (size_t i = 0; i < mgr->warm_count; i++) {
+        async_request_unref(mgr->warm[i].req);
+    }
+    mgr->warm_count = 0;
 
-    DEBUG_PRINT("[async_manager] Destroyed\n");
-    free(mgr);
-}
+    /* Release the shared SSL context */
+    ssl_ctx_cache_release(mgr->ssl_ctx);
+    tls_session_cache_destroy(mgr->session_cache);
 
-/**
- * Grow request array if needed
- */
-static int grow_request_array(async_request_manager_t *mgr) {
-    /* Check for integer overflow before doubling */
-    if (mgr->request_capacity > SIZE_MAX / 2 / sizeof(async_request_t*)) {
-        /* Would overflow - reject new request */
-        return -1;
+    /* Destroy shards and their I/O engines */
+    for (uint32_t i = 0; i < mgr->shard_count; i++) {
+        shard_cleanup(&mgr->shards[i]);
     }
+    free(mgr->shards);
 
-    size_t new_capacity = mgr->request_capacity * 2;
-    async_request_t **new_array = realloc(mgr->requests,
-                                          new_capacity * sizeof(async_request_t*));
-    if (!new_array) {
-        return -1;
+    /* Destroy mutexes */
+    pthread_mutex_destroy(&mgr->slot_alloc_mutex);
+    for (int i = 0; i < ASYNC_LOCK_STRIPES; i++) {
+        pthread_mutex_destroy(&mgr->stripe_locks[i]);
     }
+    pthread_mutex_destroy(&mgr->completion_mutex);
 
-    /* Zero new entries */
-    memset(new_array + mgr->request_capacity, 0,
-           (new_capacity - mgr->request_capacity) * sizeof(async_request_t*));
+    request_scheduler_destroy(mgr->scheduler);
+    pthread_mutex_destroy(&mgr->sched_mutex);
+    hedge_policy_destroy(mgr->hedging);
+    pthread_mutex_destroy(&mgr->hedge_mutex);
+    pthread_mutex_destroy(&mgr->warm_mutex);
+    metrics_destroy(mgr->metrics);
+    mem_budget_unref(mgr->budget);  /* Requests still alive keep their own reference */
 
-    mgr->requests = new_array;
-    mgr->request_capacity = new_capacity;
-    return 0;
+    DEBUG_PRINT("[async_manager] Destroyed\n");
+    free(mgr);
 }
 
 /**
@@ -200,50 +1554,157 @@ uint64_t async_manager_submit_request(
     async_request_callback_t callback,
     void *user_data)
 {
-    if (!mgr || !request) {
-        return 0;
-    }
+    return async_manager_submit_request_ex(mgr, request, timeout_ms, REQUEST_PRIORITY_NORMAL,
+                                           callback, user_data);
+}
 
-    pthread_mutex_lock(&mgr->mutex);
+/**
+ * Install a request in a slot and hand it to its origin's shard
+ * An owned request (a preconnect's) is freed with the async request, or
+ * here if it can't be created.
+ */
+static uint64_t manager_submit(
+    async_request_manager_t *mgr,
+    httpmorph_request_t *request,
+    bool owned,
+    bool connect_only,
+    uint32_t timeout_ms,
+    int priority,
+    async_request_callback_t callback,
+    void *user_data)
+{
+    /* Place by origin so one host's connections stay on one shard */
+    async_manager_shard_t *shard = &mgr->shards[shard_for_url(mgr, request->url)];
 
-    /* Create async request */
+    /* Create async request (no manager lock needed) */
     async_request_t *req = async_request_create(
         request,
-        mgr->io_engine,
+        shard->io_engine,
         mgr->ssl_ctx,
+        mgr->session_cache,
         timeout_ms,
         callback,
         user_data
     );
 
     if (!req) {
-        pthread_mutex_unlock(&mgr->mutex);
+        if (owned) {
+            httpmorph_request_destroy(request);
+        }
+        return 0;
+    }
+    if (owned) {
+        req->owned_request = request;
+    }
+    req->connect_only = connect_only;
+    async_request_set_memory_budget(req, mgr->budget);
+
+    /* Reserve a slot */
+    uint32_t index;
+    if (slot_alloc(mgr, &index) < 0) {
+        async_request_unref(req);
         return 0;
     }
 
-    /* Assign ID */
-    uint64_t request_id = mgr->next_request_id++;
+    /* Install under the slot's stripe lock; the ID encodes slot + generation */
+    pthread_mutex_t *lock = slot_lock(mgr, index);
+    async_request_slot_t *slot = slot_at(mgr, index);
+
+    /* DNS completions wake the shard's event thread through its wakeup fd */
+    req->dns_notify_fd = shard->wakeup_fd_write;
+
+    pthread_mutex_lock(lock);
+    if (shard_own(shard, slot, index) < 0) {
+        pthread_mutex_unlock(lock);
+        slot_free(mgr, index);
+        async_request_unref(req);
+        return 0;
+    }
+    uint64_t request_id = slot_make_id(index, slot->generation);
     req->id = request_id;
 
-    /* Grow array if needed */
-    if (mgr->request_count >= mgr->request_capacity) {
-        if (grow_request_array(mgr) < 0) {
-            async_request_unref(req);
-            pthread_mutex_unlock(&mgr->mutex);
-            return 0;
+    /* Ask for admission while the slot is still ours: an admission racing
+     * with the install waits on the stripe lock */
+    request_scheduler_origin_t *origin = NULL;
+    bool held = false;
+    if (ATOMIC_LOAD_U32(&mgr->scheduling)) {
+        pthread_mutex_lock(&mgr->sched_mutex);
+        int admit = request_scheduler_submit(mgr->scheduler, request->url, priority, request_id,
+                                             async_request_now_us(), &origin);
+        pthread_mutex_unlock(&mgr->sched_mutex);
+        if (admit < 0) {
+            origin = NULL;  /* Unschedulable URL: run it uncounted */
         }
+        held = (admit == 0);
     }
 
-    /* Add to array */
-    mgr->requests[mgr->request_count++] = req;
-    async_request_ref(req);  /* Manager holds a reference */
-
-    pthread_mutex_unlock(&mgr->mutex);
+    slot->req = req;  /* Manager holds the creation reference */
+    slot->shard = (uint16_t)shard->index;
+    slot->sched_origin = origin;
+    slot->held = held;
+    slot->queued = !held;
+    size_t queued = held ? 0 : ATOMIC_INC_SIZE(&shard->queued);
+    ATOMIC_INC_SIZE(&mgr->request_count);
+    pthread_mutex_unlock(lock);
+
+    /* Kick the event thread so the request starts without waiting for a timeout
+     * (a held one arms its deadline) */
+    shard_signal(shard);
+
+    /* Backlog building up: wake another shard so it can steal */
+    if (queued > ASYNC_STEAL_THRESHOLD && mgr->shard_count > 1) {
+        uint32_t other = ATOMIC_INC_U32(&mgr->steal_wake_next) % (mgr->shard_count - 1);
+        shard_signal(&mgr->shards[other >= shard->index ? other + 1 : other]);
+    }
 
-    DEBUG_PRINT("[async_manager] Submitted request id=%lu\n", (unsigned long)request_id);
+    DEBUG_PRINT("[async_manager] Submitted request id=%llx\n", (unsigned long long)request_id);
     return request_id;
 }
 
+/**
+ * Submit a new async request with a priority class
+ */
+uint64_t async_manager_submit_request_ex(
+    async_request_manager_t *mgr,
+    const httpmorph_request_t *request,
+    uint32_t timeout_ms,
+    int priority,
+    async_request_callback_t callback,
+    void *user_data)
+{
+    if (!mgr || !request) {
+        return 0;
+    }
+    return manager_submit(mgr, (httpmorph_request_t*)request, false, false, timeout_ms, priority,
+                          callback, user_data);
+}
+
+/**
+ * Open a connection to a URL's origin for a later request
+ */
+uint64_t async_manager_preconnect(
+    async_request_manager_t *mgr,
+    const char *url,
+    bool verify_ssl,
+    uint32_t timeout_ms,
+    async_request_callback_t callback,
+    void *user_data)
+{
+    if (!mgr || !url) {
+        return 0;
+    }
+
+    /* Outlives the caller's call: kept with the connection until a request takes it */
+    httpmorph_request_t *request = httpmorph_request_create(HTTPMORPH_GET, url);
+    if (!request) {
+        return 0;
+    }
+    request->timeout_ms = timeout_ms;
+    request->verify_ssl = verify_ssl;
+    return manager_submit(mgr, request, true, true, timeout_ms, REQUEST_PRIORITY_NORMAL,
+                          callback, user_data);
+}
+
 /**
  * Get request by ID
  */
@@ -251,115 +1712,303 @@ async_request_t* async_manager_get_request(
     async_request_manager_t *mgr,
     uint64_t request_id)
 {
-    if (!mgr) {
+    uint32_t index;
+    if (!mgr || slot_index_from_id(mgr, request_id, &index) < 0) {
         return NULL;
     }
 
-    pthread_mutex_lock(&mgr->mutex);
-    for (size_t i = 0; i < mgr->request_count; i++) {
-        if (mgr->requests[i] && mgr->requests[i]->id == request_id) {
-            async_request_t *req = mgr->requests[i];
-            async_request_ref(req);  /* Caller gets a reference */
-            pthread_mutex_unlock(&mgr->mutex);
-            return req;
-        }
+    async_request_t *req = NULL;
+    async_request_slot_t *slot = slot_at(mgr, index);
+
+    pthread_mutex_lock(slot_lock(mgr, index));
+    if (slot->req && slot->generation == (uint32_t)(request_id >> 32)) {
+        req = slot->req;
+        async_request_ref(req);  /* Caller gets a reference */
     }
-    pthread_mutex_unlock(&mgr->mutex);
-    return NULL;
+    pthread_mutex_unlock(slot_lock(mgr, index));
+
+    return req;
 }
 
 /**
- * Remove completed/failed requests
+ * Cancel a request
  */
-static void cleanup_completed_requests(async_request_manager_t *mgr) {
-    size_t write_pos = 0;
+int async_manager_cancel_request(
+    async_request_manager_t *mgr,
+    uint64_t request_id)
+{
+    uint32_t index;
+    if (!mgr || slot_index_from_id(mgr, request_id, &index) < 0) {
+        return -1;
+    }
 
-    for (size_t i = 0; i < mgr->request_count; i++) {
-        async_request_t *req = mgr->requests[i];
-        async_request_state_t state = async_request_get_state(req);
+    int result = -1;
+    async_request_slot_t *slot = slot_at(mgr, index);
 
-        if (state == ASYNC_STATE_COMPLETE || state == ASYNC_STATE_ERROR) {
-            /* Release manager's reference */
-            async_request_unref(req);
-        } else {
-            /* Keep this request */
-            mgr->requests[write_pos++] = req;
-        }
+    uint16_t shard = 0;
+
+    pthread_mutex_lock(slot_lock(mgr, index));
+    if (slot->req && slot->generation == (uint32_t)(request_id >> 32)) {
+        async_request_set_error(slot->req, -1, "Cancelled");
+        shard = slot->shard;
+        result = 0;
     }
+    pthread_mutex_unlock(slot_lock(mgr, index));
 
-    mgr->request_count = write_pos;
+    /* Let the event thread retire it without waiting for a timeout */
+    if (result == 0) {
+        shard_signal(&mgr->shards[shard]);
+    }
+    return result;
 }
 
 /**
- * Cancel a request
+ * Resume a request whose body callback returned HTTPMORPH_BODY_PAUSE
  */
-int async_manager_cancel_request(
+int async_manager_resume_request(
     async_request_manager_t *mgr,
     uint64_t request_id)
 {
+    uint32_t index;
+    if (!mgr || slot_index_from_id(mgr, request_id, &index) < 0) {
+        return -1;
+    }
+
+    int result = -1;
+    async_request_slot_t *slot = slot_at(mgr, index);
+
+    uint16_t shard = 0;
+
+    pthread_mutex_lock(slot_lock(mgr, index));
+    if (slot->req && slot->generation == (uint32_t)(request_id >> 32)) {
+        slot->req->body_paused = false;
+        shard = slot->shard;
+        result = 0;
+    }
+    pthread_mutex_unlock(slot_lock(mgr, index));
+
+    if (result == 0) {
+        shard_signal(&mgr->shards[shard]);
+    }
+    return result;
+}
+
+/**
+ * Enable admission control, or change its defaults
+ */
+int async_manager_set_scheduler(async_request_manager_t *mgr, const request_scheduler_config_t *config) {
     if (!mgr) {
         return -1;
     }
 
-    pthread_mutex_lock(&mgr->mutex);
-    for (size_t i = 0; i < mgr->request_count; i++) {
-        if (mgr->requests[i] && mgr->requests[i]->id == request_id) {
-            async_request_set_error(mgr->requests[i], -1, "Cancelled");
-            pthread_mutex_unlock(&mgr->mutex);
-            return 0;
+    int result = 0;
+    pthread_mutex_lock(&mgr->sched_mutex);
+    if (mgr->scheduler) {
+        request_scheduler_configure(mgr->scheduler, config);
+    } else {
+        mgr->scheduler = request_scheduler_create(config);
+        if (mgr->scheduler) {
+            ATOMIC_STORE_U32(&mgr->scheduling, 1);
+        } else {
+            result = -1;
         }
     }
-    pthread_mutex_unlock(&mgr->mutex);
-    return -1;
+    pthread_mutex_unlock(&mgr->sched_mutex);
+
+    /* Raised limits may let queued requests start */
+    if (result == 0) {
+        sched_dispatch(mgr);
+    }
+    return result;
 }
 
 /**
- * Poll for events
+ * Give one origin its own limits
  */
-int async_manager_poll(async_request_manager_t *mgr, uint32_t timeout_ms) {
-    if (!mgr) {
+int async_manager_set_origin_limits(async_request_manager_t *mgr, const char *url,
+                                    uint32_t max_concurrent, double rate, uint32_t burst) {
+    if (!mgr || !url) {
+        return -1;
+    }
+    if (!ATOMIC_LOAD_U32(&mgr->scheduling) && async_manager_set_scheduler(mgr, NULL) < 0) {
         return -1;
     }
 
-    /* Wait for I/O events */
-    int events = io_engine_wait(mgr->io_engine, timeout_ms);
+    pthread_mutex_lock(&mgr->sched_mutex);
+    int result = request_scheduler_set_origin(mgr->scheduler, url, max_concurrent, rate, burst);
+    pthread_mutex_unlock(&mgr->sched_mutex);
 
-    pthread_mutex_lock(&mgr->mutex);
+    if (result == 0) {
+        sched_dispatch(mgr);
+    }
+    return result;
+}
 
-    /* Process all active requests */
-    for (size_t i = 0; i < mgr->request_count; i++) {
-        async_request_t *req = mgr->requests[i];
-        if (!req) {
-            continue;
-        }
+/**
+ * Get scheduler counters
+ */
+int async_manager_get_scheduler_stats(async_request_manager_t *mgr, request_scheduler_stats_t *stats) {
+    if (!mgr || !stats || !ATOMIC_LOAD_U32(&mgr->scheduling)) {
+        return -1;
+    }
+    pthread_mutex_lock(&mgr->sched_mutex);
+    request_scheduler_get_stats(mgr->scheduler, stats);
+    pthread_mutex_unlock(&mgr->sched_mutex);
+    return 0;
+}
 
-        /* Step the state machine */
-        int status = async_request_step(req);
+/**
+ * Cap the bytes requests may buffer for responses
+ */
+int async_manager_set_memory_budget(async_request_manager_t *mgr, uint64_t max_bytes) {
+    if (!mgr) {
+        return -1;
+    }
+    mem_budget_set_limit(mgr->budget, max_bytes);
+    return 0;
+}
 
-        /* Register for events based on status */
-        if (status == ASYNC_STATUS_NEED_READ || status == ASYNC_STATUS_NEED_WRITE) {
-            int fd = async_request_get_fd(req);
-            if (fd >= 0) {
-                /* Create I/O operation */
-                io_operation_t *op = NULL;
-                if (status == ASYNC_STATUS_NEED_READ) {
-                    op = io_op_recv_create(fd, NULL, 0, NULL, req);
-                } else {
-                    op = io_op_send_create(fd, NULL, 0, NULL, req);
-                }
+/**
+ * Enable hedged requests, or change their settings
+ */
+int async_manager_set_hedging(async_request_manager_t *mgr, const hedge_policy_config_t *config) {
+    if (!mgr) {
+        return -1;
+    }
 
-                if (op) {
-                    io_engine_submit(mgr->io_engine, op);
-                }
-            }
+    int result = 0;
+    pthread_mutex_lock(&mgr->hedge_mutex);
+    if (mgr->hedging) {
+        hedge_policy_configure(mgr->hedging, config);
+    } else {
+        mgr->hedging = hedge_policy_create(config);
+        if (mgr->hedging) {
+            ATOMIC_STORE_U32(&mgr->hedging_on, 1);
+        } else {
+            result = -1;
         }
     }
+    pthread_mutex_unlock(&mgr->hedge_mutex);
+    return result;
+}
+
+/**
+ * Get hedging counters
+ */
+int async_manager_get_hedge_stats(async_request_manager_t *mgr, hedge_policy_stats_t *stats) {
+    if (!mgr || !stats || !ATOMIC_LOAD_U32(&mgr->hedging_on)) {
+        return -1;
+    }
+    pthread_mutex_lock(&mgr->hedge_mutex);
+    hedge_policy_get_stats(mgr->hedging, stats);
+    pthread_mutex_unlock(&mgr->hedge_mutex);
+    return 0;
+}
+
+/**
+ * Get request metrics
+ */
+int async_manager_get_metrics(async_request_manager_t *mgr, httpmorph_metrics_t *metrics) {
+    if (!mgr || !metrics) {
+        return -1;
+    }
+    metrics_get(mgr->metrics, metrics);
+
+    mem_budget_stats_t budget;
+    mem_budget_get_stats(mgr->budget, &budget);
+    metrics->memory_limit = budget.limit;
+    metrics->memory_in_use = budget.in_use;
+    metrics->memory_peak = budget.peak;
+    metrics->memory_stalls = budget.stalls;
+    return 0;
+}
+
+/**
+ * Get request metrics per origin
+ */
+int async_manager_get_origin_metrics(async_request_manager_t *mgr,
+                                     httpmorph_origin_metrics_t *origins, int max_origins) {
+    if (!mgr) {
+        return -1;
+    }
+    return metrics_get_origins(mgr->metrics, origins, max_origins);
+}
+
+/**
+ * Zero the request metrics
+ */
+void async_manager_reset_metrics(async_request_manager_t *mgr) {
+    if (mgr) {
+        metrics_reset(mgr->metrics);
+    }
+}
+
+/**
+ * Get I/O engine statistics, summed over all shards
+ */
+const char* async_manager_get_io_stats(const async_request_manager_t *mgr, io_engine_stats_t *stats) {
+    if (!mgr || mgr->shard_count == 0) {
+        io_engine_get_stats(NULL, stats);
+        return NULL;
+    }
+
+    io_engine_get_stats(mgr->shards[0].io_engine, stats);
+    for (uint32_t i = 1; stats && i < mgr->shard_count; i++) {
+        io_engine_stats_t shard_stats;
+        io_engine_get_stats(mgr->shards[i].io_engine, &shard_stats);
+        stats->ops_submitted += shard_stats.ops_submitted;
+        stats->ops_completed += shard_stats.ops_completed;
+        stats->ops_failed += shard_stats.ops_failed;
+        stats->zero_copy_sends += shard_stats.zero_copy_sends;
+        stats->ring_buffer_recvs += shard_stats.ring_buffer_recvs;
+    }
+    return io_engine_type_name(mgr->shards[0].io_engine->type);
+}
+
+/**
+ * Get the number of shards
+ */
+uint32_t async_manager_get_shard_count(const async_request_manager_t *mgr) {
+    return mgr ? mgr->shard_count : 0;
+}
+
+/**
+ * Get one shard's load
+ */
+int async_manager_get_shard_stats(const async_request_manager_t *mgr, uint32_t shard,
+                                  size_t *owned, uint64_t *steals) {
+    if (!mgr || shard >= mgr->shard_count) {
+        return -1;
+    }
 
-    /* Clean up completed requests */
-    cleanup_completed_requests(mgr);
+    async_manager_shard_t *s = &mgr->shards[shard];
+    if (owned) {
+        pthread_mutex_lock(&s->owned_mutex);
+        *owned = s->owned_count;
+        pthread_mutex_unlock(&s->owned_mutex);
+    }
+    if (steals) {
+        *steals = s->steals;
+    }
+    return 0;
+}
 
-    pthread_mutex_unlock(&mgr->mutex);
+/**
+ * Poll for events
+ * Every shard is polled; only the first waits up to timeout_ms.
+ */
+int async_manager_poll(async_request_manager_t *mgr, uint32_t timeout_ms) {
+    if (!mgr) {
+        return -1;
+    }
 
+    int events = 0;
+    for (uint32_t i = 0; i < mgr->shard_count; i++) {
+        int n = shard_poll(&mgr->shards[i], i == 0 ? timeout_ms : 0, NULL);
+        if (n > 0) {
+            events += n;
+        }
+    }
     return events;
 }
 
@@ -373,7 +2022,7 @@ int async_manager_process(async_request_manager_t *mgr) {
 
     int processed = 0;
 
-    while (mgr->request_count > 0) {
+    while (ATOMIC_LOAD_SIZE(&mgr->request_count) > 0) {
         /* Poll with 100ms timeout */
         int events = async_manager_poll(mgr, 100);
         if (events > 0) {
@@ -391,25 +2040,44 @@ size_t async_manager_get_active_count(const async_request_manager_t *mgr) {
     if (!mgr) {
         return 0;
     }
-    return mgr->request_count;
+    return ATOMIC_LOAD_SIZE(&((async_request_manager_t*)mgr)->request_count);
 }
 
 /**
  * Event loop thread function
  */
 static void* event_loop_thread(void *arg) {
-    async_request_manager_t *mgr = (async_request_manager_t*)arg;
+    async_manager_shard_t *shard = (async_manager_shard_t*)arg;
+    async_request_manager_t *mgr = shard->mgr;
 
-    DEBUG_PRINT("[async_manager] Event loop thread started\n");
+    DEBUG_PRINT("[async_manager] Event loop thread %u started\n", shard->index);
 
+    size_t runnable = 0;
     while (!mgr->shutdown) {
-        async_manager_poll(mgr, 100);  /* 100ms timeout */
+        /* Don't sleep in the engine while some request can still make progress */
+        shard_poll(shard, runnable > 0 ? 0 : EVENT_LOOP_TIMEOUT_MS, &runnable);
     }
 
-    DEBUG_PRINT("[async_manager] Event loop thread stopped\n");
+    DEBUG_PRINT("[async_manager] Event loop thread %u stopped\n", shard->index);
     return NULL;
 }
 
+/**
+ * Stop and join the first `count` shards' event threads
+ */
+static void stop_shard_threads(async_request_manager_t *mgr, uint32_t count) {
+    mgr->shutdown = true;
+    for (uint32_t i = 0; i < count; i++) {
+        notify_fd_signal(mgr->shards[i].wakeup_fd_write);  /* Interrupt engine wait */
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        if (mgr->shards[i].event_thread_running) {
+            pthread_join(mgr->shards[i].event_thread, NULL);
+            mgr->shards[i].event_thread_running = false;
+        }
+    }
+}
+
 /**
  * Start event loop thread
  */
@@ -419,8 +2087,29 @@ int async_manager_start_event_loop(async_request_manager_t *mgr) {
     }
 
     mgr->shutdown = false;
-    if (pthread_create(&mgr->event_thread, NULL, event_loop_thread, mgr) != 0) {
-        return -1;
+
+    /* Watch the wakeup fds so submissions interrupt the engine waits */
+    for (uint32_t i = 0; i < mgr->shard_count; i++) {
+        async_manager_shard_t *shard = &mgr->shards[i];
+        if (shard->wakeup_fd >= 0 && !shard->wakeup_op) {
+            shard->wakeup_op = io_op_recv_create(shard->wakeup_fd, NULL, 0, on_wakeup_ready, shard);
+            if (shard->wakeup_op) {
+                io_engine_submit(shard->io_engine, shard->wakeup_op);
+            }
+        }
+    }
+
+    /* From now on the event threads own stepping and queue completions */
+    mgr->event_driven = true;
+
+    for (uint32_t i = 0; i < mgr->shard_count; i++) {
+        async_manager_shard_t *shard = &mgr->shards[i];
+        if (pthread_create(&shard->event_thread, NULL, event_loop_thread, shard) != 0) {
+            stop_shard_threads(mgr, i);
+            mgr->event_driven = false;
+            return -1;
+        }
+        shard->event_thread_running = true;
     }
 
     mgr->event_thread_running = true;
@@ -435,8 +2124,46 @@ int async_manager_stop_event_loop(async_request_manager_t *mgr) {
         return -1;
     }
 
-    mgr->shutdown = true;
-    pthread_join(mgr->event_thread, NULL);
+    stop_shard_threads(mgr, mgr->shard_count);
     mgr->event_thread_running = false;
+    mgr->event_driven = false;
     return 0;
 }
+
+/**
+ * Get completion notification fd
+ */
+int async_manager_get_completion_fd(const async_request_manager_t *mgr) {
+    return mgr ? mgr->completion_fd : -1;
+}
+
+/**
+ * Drain finished requests from the completion queue
+ */
+size_t async_manager_drain_completions(
+    async_request_manager_t *mgr,
+    async_request_t **out,
+    size_t max)
+{
+    if (!mgr || !out || max == 0) {
+        return 0;
+    }
+
+    pthread_mutex_lock(&mgr->completion_mutex);
+
+    size_t n = mgr->completed_count < max ? mgr->completed_count : max;
+    if (n > 0) {
+        memcpy(out, mgr->completed, n * sizeof(async_request_t*));
+        memmove(mgr->completed, mgr->completed + n,
+                (mgr->completed_count - n) * sizeof(async_request_t*));
+        mgr->completed_count -= n;
+    }
+
+    /* Leave the fd readable while entries remain so the reader fires again */
+    if (mgr->completed_count == 0) {
+        notify_fd_clear(mgr->completion_fd);
+    }
+
+    pthread_mutex_unlock(&mgr->completion_mutex);
+    return n;
+}
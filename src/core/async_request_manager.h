@@ -6,7 +6,10 @@
 #define ASYNC_REQUEST_MANAGER_H
 
 #include "async_request.h"
+#include "hedge_policy.h"
 #include "io_engine.h"
+#include "metrics.h"
+#include "request_scheduler.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -21,32 +24,148 @@ extern "C" {
 /* Forward declaration for SSL_CTX */
 typedef struct ssl_ctx_st SSL_CTX;
 
+/* Slot table geometry: pages never move, so slots can be used without a global lock */
+#define ASYNC_SLOT_PAGE_SHIFT 10
+#define ASYNC_SLOT_PAGE_SIZE (1u << ASYNC_SLOT_PAGE_SHIFT)  /* 1024 slots per page */
+#define ASYNC_SLOT_MAX_PAGES 1024                           /* ~1M requests in flight */
+
+/* Number of locks striped over the slot table */
+#define ASYNC_LOCK_STRIPES 64
+
+/* Upper bound on shards (event threads) per manager */
+#define ASYNC_MAX_SHARDS 64
+
+/* Queued requests on one shard before other shards are woken to steal */
+#define ASYNC_STEAL_THRESHOLD 4
+
+/* Requests the scheduler admits per dispatch batch */
+#define ASYNC_SCHED_BATCH 64
+
+/* Preconnected connections waiting for a request, and how long they may wait */
+#define ASYNC_WARM_MAX 64
+#define ASYNC_WARM_IDLE_MS 30000
+
+/**
+ * Request slot
+ * A request ID encodes (generation << 32) | (slot index + 1), so a stale ID
+ * never matches a recycled slot.
+ */
+typedef struct async_request_slot {
+    async_request_t *req;            /* NULL when free */
+    uint32_t generation;             /* Bumped each time the slot is released */
+    uint32_t next_free;              /* Free list link (index + 1, 0 = end) */
+    uint32_t owned_pos;              /* Position in the owning shard's list (its owned_mutex) */
+    uint16_t shard;                  /* Shard that steps this request */
+    bool queued;                     /* Not stepped yet - other shards may steal it */
+    bool held;                       /* Waiting for the scheduler to admit it */
+    request_scheduler_origin_t *sched_origin;  /* NULL when submitted unscheduled */
+    uint64_t started_us;             /* First stepped (first-byte samples count from here) */
+    uint64_t hedge_at_us;            /* Send a duplicate if no response byte by then (0: never) */
+    async_request_t *hedge;          /* Duplicate racing req, stepped alongside it */
+} async_request_slot_t;
+
+/**
+ * Preconnected connection, kept by its finished request until a request
+ * to the same origin on the same shard starts
+ */
+typedef struct {
+    async_request_t *req;            /* Holds a reference */
+    uint32_t shard;                  /* Shard whose I/O engine the socket was used with */
+    uint64_t parked_us;
+} async_warm_connection_t;
+
+struct async_request_manager;
+
+/**
+ * Shard: an I/O engine and event thread stepping the requests it owns
+ * Requests are placed by origin; a shard with nothing to do takes queued
+ * (not yet started) requests from the busiest shard.
+ */
+typedef struct async_manager_shard {
+    struct async_request_manager *mgr;
+    uint32_t index;
+    io_engine_t *io_engine;
+    pthread_mutex_t mutex;           /* Serializes this shard's pollers (engine wait + stepping) */
+    timer_wheel_t timers;            /* Owned requests' next due times (mutex) */
+
+    /* Owned requests (slot indices) */
+    uint32_t *owned;
+    size_t owned_count;
+    size_t owned_capacity;
+    pthread_mutex_t owned_mutex;     /* After a slot's stripe lock; two shards' in index order */
+    size_t queued;                   /* Owned requests not stepped yet (atomic) */
+    uint64_t steals;                 /* Requests taken from other shards */
+
+    /* Event thread */
+    pthread_t event_thread;
+    bool event_thread_running;
+    int wakeup_fd;                   /* Read end, registered with io_engine */
+    int wakeup_fd_write;             /* Write end (same fd for eventfd) */
+    io_operation_t *wakeup_op;
+    bool wakeup_pending;
+} async_manager_shard_t;
+
 /**
  * Request manager structure
  */
 typedef struct async_request_manager {
-    /* I/O engine for event-driven I/O */
-    io_engine_t *io_engine;
+    /* Shards, each with its own I/O engine and event thread */
+    async_manager_shard_t *shards;
+    uint32_t shard_count;
+    uint32_t steal_wake_next;        /* Round-robin target for steal wakeups (atomic) */
 
     /* SSL/TLS context */
     SSL_CTX *ssl_ctx;
+    tls_session_cache_t *session_cache;  /* Sessions resumed across requests */
 
-    /* Request tracking */
-    async_request_t **requests;
-    size_t request_count;
-    size_t request_capacity;
-
-    /* Request ID generation */
-    uint64_t next_request_id;
+    /* Request tracking (generation-tagged slot table) */
+    async_request_slot_t *slot_pages[ASYNC_SLOT_MAX_PAGES];
+    uint32_t slot_high_water;        /* Slots ever handed out (atomic) */
+    uint32_t free_head;              /* Free list head (index + 1, 0 = empty) */
+    size_t request_count;            /* Active requests (atomic) */
 
     /* Thread safety */
-    pthread_mutex_t mutex;
+    pthread_mutex_t slot_alloc_mutex;                  /* Free list and page allocation */
+    pthread_mutex_t stripe_locks[ASYNC_LOCK_STRIPES];  /* Slot contents, by index % stripes */
 
     /* Event loop (optional - for standalone mode) */
-    pthread_t event_thread;
     bool event_thread_running;
     bool shutdown;
 
+    /* Event-driven mode: event threads own stepping, completions are queued */
+    bool event_driven;
+
+    /* Completion queue (drained by the Python side in batches) */
+    async_request_t **completed;
+    size_t completed_count;
+    size_t completed_capacity;
+    pthread_mutex_t completion_mutex;
+    int completion_fd;               /* Read end, becomes readable when queue is non-empty */
+    int completion_fd_write;         /* Write end (same fd for eventfd) */
+
+    /* Admission control (NULL until async_manager_set_scheduler()) */
+    request_scheduler_t *scheduler;
+    pthread_mutex_t sched_mutex;     /* After a slot's stripe lock, never before one */
+    uint32_t scheduling;             /* Scheduler exists (atomic) */
+    uint64_t sched_due_us;           /* Next rate-limited admission, 0 = none (atomic) */
+
+    /* Hedged requests (NULL until async_manager_set_hedging()) */
+    hedge_policy_t *hedging;
+    pthread_mutex_t hedge_mutex;     /* After a slot's stripe lock, never before one */
+    uint32_t hedging_on;             /* Policy exists (atomic) */
+
+    /* Request metrics (each redirect hop counts) */
+    metrics_t *metrics;
+
+    /* Bytes of response buffers, shared with requests (unlimited until
+     * async_manager_set_memory_budget()) */
+    mem_budget_t *budget;
+
+    /* Preconnected connections, oldest first */
+    async_warm_connection_t warm[ASYNC_WARM_MAX];
+    size_t warm_count;               /* Atomic outside warm_mutex */
+    pthread_mutex_t warm_mutex;      /* After a slot's stripe lock, never before one */
+
 } async_request_manager_t;
 
 /**
@@ -54,6 +173,20 @@ typedef struct async_request_manager {
  */
 async_request_manager_t* async_manager_create(void);
 
+/**
+ * Create a new async request manager with I/O engine options
+ * io_options are IO_ENGINE_OPT_* flags (e.g. IO_ENGINE_OPT_URING)
+ */
+async_request_manager_t* async_manager_create_ex(uint32_t io_options);
+
+/**
+ * Create a new async request manager with several shards
+ *
+ * @param shard_count Event threads / I/O engines (0 for one per CPU)
+ * @param io_options IO_ENGINE_OPT_* flags for every shard's engine
+ */
+async_request_manager_t* async_manager_create_sharded(uint32_t shard_count, uint32_t io_options);
+
 /**
  * Destroy an async request manager
  */
@@ -71,6 +204,118 @@ uint64_t async_manager_submit_request(
     void *user_data
 );
 
+/**
+ * Submit a new async request with a priority class
+ * With a scheduler the request waits, held, until its origin's limits let
+ * it start; without one the priority is ignored.
+ *
+ * @param priority REQUEST_PRIORITY_* (lower starts first)
+ * Returns request ID (>0 on success, 0 on failure)
+ */
+uint64_t async_manager_submit_request_ex(
+    async_request_manager_t *mgr,
+    const httpmorph_request_t *request,
+    uint32_t timeout_ms,
+    int priority,
+    async_request_callback_t callback,
+    void *user_data
+);
+
+/**
+ * Open a connection to a URL's origin for a later request
+ * The request does DNS, connect and the TLS handshake (reading TLS 1.3
+ * session tickets into the session cache), then completes with status 0
+ * and the phase timings. Its connection is then kept for up to
+ * ASYNC_WARM_IDLE_MS, and a request to the origin that starts on the
+ * same shard sends on it instead of connecting.
+ *
+ * @param verify_ssl Verify the certificate (only requests that verify
+ *                   alike take the connection)
+ * Returns request ID (>0 on success, 0 on failure)
+ */
+uint64_t async_manager_preconnect(
+    async_request_manager_t *mgr,
+    const char *url,
+    bool verify_ssl,
+    uint32_t timeout_ms,
+    async_request_callback_t callback,
+    void *user_data
+);
+
+/**
+ * Enable admission control, or change its defaults
+ * Requests submitted before the scheduler existed are not counted.
+ *
+ * @param config Limits (NULL for defaults)
+ * @return 0 on success, -1 on failure
+ */
+int async_manager_set_scheduler(async_request_manager_t *mgr, const request_scheduler_config_t *config);
+
+/**
+ * Give one origin its own limits, enabling the scheduler if needed
+ *
+ * @param url Any URL on the origin
+ * @return 0 on success, -1 on failure
+ */
+int async_manager_set_origin_limits(async_request_manager_t *mgr, const char *url,
+                                    uint32_t max_concurrent, double rate, uint32_t burst);
+
+/**
+ * Get scheduler counters
+ * @return 0 on success, -1 without a scheduler
+ */
+int async_manager_get_scheduler_stats(async_request_manager_t *mgr, request_scheduler_stats_t *stats);
+
+/**
+ * Cap the bytes requests may buffer for responses
+ * Receive buffers (response heads and buffered bodies) are charged to the
+ * budget as they grow; a request that would pass it stops reading its
+ * socket until other requests finish and free theirs, so the server is
+ * held back by TCP flow control. One request at a time may go over, so
+ * some request can always finish. Streamed bodies only hold their chunk.
+ *
+ * @param max_bytes Budget (0: unlimited, usage is still reported)
+ * @return 0 on success, -1 on failure
+ */
+int async_manager_set_memory_budget(async_request_manager_t *mgr, uint64_t max_bytes);
+
+/**
+ * Enable hedged requests, or change their settings
+ * A GET, HEAD or OPTIONS request without a streamed body that has seen no
+ * response byte once its origin's first-byte percentile has passed is
+ * sent again on a new connection; the first copy to answer completes the
+ * request and the other is dropped. Only the event-driven mode hedges.
+ *
+ * @param config Settings (NULL for defaults)
+ * @return 0 on success, -1 on failure
+ */
+int async_manager_set_hedging(async_request_manager_t *mgr, const hedge_policy_config_t *config);
+
+/**
+ * Get hedging counters
+ * @return 0 on success, -1 without hedging
+ */
+int async_manager_get_hedge_stats(async_request_manager_t *mgr, hedge_policy_stats_t *stats);
+
+/**
+ * Get request metrics (pool fields stay 0: async requests aren't pooled; memory
+ * fields report the budget of async_manager_set_memory_budget())
+ * @return 0 on success, -1 on failure
+ */
+int async_manager_get_metrics(async_request_manager_t *mgr, httpmorph_metrics_t *metrics);
+
+/**
+ * Get request metrics per origin
+ * @return Number of origins (may exceed max_origins), -1 on failure
+ */
+int async_manager_get_origin_metrics(async_request_manager_t *mgr,
+                                     httpmorph_origin_metrics_t *origins, int max_origins);
+
+/**
+ * Zero the request metrics
+ */
+void async_manager_reset_metrics(async_request_manager_t *mgr);
+
 /**
  * Get request by ID
  */
@@ -87,6 +332,35 @@ int async_manager_cancel_request(
     uint64_t request_id
 );
 
+/**
+ * Resume a request paused by its body callback (HTTPMORPH_BODY_PAUSE)
+ */
+int async_manager_resume_request(
+    async_request_manager_t *mgr,
+    uint64_t request_id
+);
+
+/**
+ * Get I/O engine statistics, summed over all shards
+ * Returns the engine name ("io_uring", "epoll", ...), NULL without an engine
+ */
+const char* async_manager_get_io_stats(const async_request_manager_t *mgr, io_engine_stats_t *stats);
+
+/**
+ * Get the number of shards
+ */
+uint32_t async_manager_get_shard_count(const async_request_manager_t *mgr);
+
+/**
+ * Get one shard's load
+ *
+ * @param owned Output: requests the shard steps (may be NULL)
+ * @param steals Output: requests it took from other shards (may be NULL)
+ * @return 0 on success, -1 if the shard doesn't exist
+ */
+int async_manager_get_shard_stats(const async_request_manager_t *mgr, uint32_t shard,
+                                  size_t *owned, uint64_t *steals);
+
 /**
  * Poll for events (non-blocking)
  * Returns number of events processed
@@ -117,6 +391,24 @@ int async_manager_start_event_loop(async_request_manager_t *mgr);
  */
 int async_manager_stop_event_loop(async_request_manager_t *mgr);
 
+/**
+ * Get completion notification fd (event-driven mode)
+ * The fd becomes readable when finished requests are queued.
+ * Returns -1 if not supported on this platform.
+ */
+int async_manager_get_completion_fd(const async_request_manager_t *mgr);
+
+/**
+ * Drain finished requests from the completion queue
+ * Each returned request carries a reference the caller must release
+ * with async_request_unref(). Returns number of requests written to out.
+ */
+size_t async_manager_drain_completions(
+    async_request_manager_t *mgr,
+    async_request_t **out,
+    size_t max
+);
+
 #ifdef __cplusplus
 }
 #endif
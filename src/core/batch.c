@@ -0,0 +1,290 @@
+/**
+ * batch.c - Run many requests from one call
+ *
+ * A batch runs its requests on a few worker threads (at most `concurrency`
+ * in flight). Each worker goes through httpmorph_request_execute(), so
+ * keep-alive connections come from the pool and HTTPS requests to one
+ * origin share its HTTP/2 connection. To let them share it, the first
+ * HTTP/2 request to an origin runs alone; the rest of that origin's
+ * requests wait until its connection is in the pool. Consecutive requests
+ * to an origin the client allows HTTP/1.1 pipelining to are taken by one
+ * worker as a run and pipelined on one connection. Finished responses
+ * are queued in completion order for httpmorph_batch_next().
+ */
+
+#include "internal/core.h"
+#include "internal/url.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* An origin the batch has sent HTTP/2 requests to */
+typedef struct batch_origin {
+    char *host;
+    uint16_t port;
+    bool ready;                 /* First request finished; its connection is pooled */
+    struct batch_origin *next;
+} batch_origin_t;
+
+struct httpmorph_batch {
+    httpmorph_client_t *client;
+    httpmorph_pool_t *pool;
+    httpmorph_request_t *const *requests;
+    size_t count;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* Signals completions and ready origins */
+    size_t next_request;        /* Next request a worker picks up */
+    bool cancelled;             /* Destroyed early: start nothing new */
+
+    /* Results, in completion order */
+    httpmorph_response_t **responses;   /* Indexed by request */
+    size_t *completed;                  /* Request indices */
+    size_t completed_count;
+    size_t delivered_count;
+
+    batch_origin_t *origins;
+
+    pthread_t *workers;
+    int worker_count;
+};
+
+/* Helper: Find or add the origin of an HTTP/2 request (mutex held) */
+static batch_origin_t* batch_origin_get(httpmorph_batch_t *batch, const char *host,
+                                        uint16_t port, bool *created) {
+    *created = false;
+    for (batch_origin_t *origin = batch->origins; origin; origin = origin->next) {
+        if (origin->port == port && strcasecmp(origin->host, host) == 0) {
+            return origin;
+        }
+    }
+
+    batch_origin_t *origin = calloc(1, sizeof(batch_origin_t));
+    if (!origin) {
+        return NULL;
+    }
+    origin->host = strdup(host);
+    if (!origin->host) {
+        free(origin);
+        return NULL;
+    }
+    origin->port = port;
+    origin->next = batch->origins;
+    batch->origins = origin;
+    *created = true;
+    return origin;
+}
+
+/* Helper: Hold back requests to an origin whose first HTTP/2 connection is
+ * still being set up; returns the origin to mark ready (mutex held) */
+static batch_origin_t* batch_wait_for_origin(httpmorph_batch_t *batch,
+                                             const httpmorph_request_t *request) {
+    if (!request->http2_enabled) {
+        return NULL;
+    }
+
+    char *scheme = NULL, *host = NULL, *path = NULL;
+    uint16_t port = 0;
+    batch_origin_t *origin = NULL;
+    bool created = false;
+
+    if (httpmorph_parse_url(request->url, &scheme, &host, &port, &path) == 0 &&
+        scheme && strcmp(scheme, "https") == 0) {
+        origin = batch_origin_get(batch, host, port, &created);
+    }
+    free(scheme);
+    free(host);
+    free(path);
+
+    if (!origin || created) {
+        return origin;  /* Primer (or untracked): runs right away */
+    }
+    while (!origin->ready && !batch->cancelled) {
+        pthread_cond_wait(&batch->cond, &batch->mutex);
+    }
+    return NULL;
+}
+
+/* Worker: run requests until the batch is drained */
+static void* batch_worker(void *arg) {
+    httpmorph_batch_t *batch = (httpmorph_batch_t*)arg;
+
+    pthread_mutex_lock(&batch->mutex);
+    while (!batch->cancelled && batch->next_request < batch->count) {
+        size_t index = batch->next_request;
+        size_t run = httpmorph_pipeline_run(batch->client, batch->requests + index,
+                                            batch->count - index);
+        if (run == 0) {
+            run = 1;
+        }
+        batch->next_request += run;
+        const httpmorph_request_t *request = batch->requests[index];
+        batch_origin_t *primer = batch_wait_for_origin(batch, request);
+        if (batch->cancelled) {
+            break;
+        }
+        pthread_mutex_unlock(&batch->mutex);
+
+        httpmorph_response_t *responses[HTTPMORPH_MAX_PIPELINE_DEPTH];
+        if (run > 1) {
+            httpmorph_request_execute_pipelined(batch->client, batch->requests + index, run,
+                                                batch->pool, responses);
+        } else {
+            responses[0] = httpmorph_request_execute(batch->client, request, batch->pool);
+        }
+
+        pthread_mutex_lock(&batch->mutex);
+        if (primer) {
+            primer->ready = true;
+        }
+        for (size_t i = 0; i < run; i++) {
+            batch->responses[index + i] = responses[i];
+            batch->completed[batch->completed_count++] = index + i;
+        }
+        pthread_cond_broadcast(&batch->cond);
+    }
+    pthread_mutex_unlock(&batch->mutex);
+    return NULL;
+}
+
+/**
+ * Start running a batch of requests
+ */
+httpmorph_batch_t* httpmorph_batch_start(httpmorph_client_t *client, httpmorph_pool_t *pool,
+                                         httpmorph_request_t *const *requests, size_t count,
+                                         int concurrency) {
+    if (!client || (!requests && count > 0)) {
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (!requests[i]) {
+            return NULL;
+        }
+    }
+
+    httpmorph_batch_t *batch = calloc(1, sizeof(httpmorph_batch_t));
+    if (!batch) {
+        return NULL;
+    }
+    batch->client = client;
+    batch->pool = pool;
+    batch->requests = requests;
+    batch->count = count;
+
+    size_t slots = count > 0 ? count : 1;
+    batch->responses = calloc(slots, sizeof(httpmorph_response_t*));
+    batch->completed = calloc(slots, sizeof(size_t));
+    if (concurrency <= 0) {
+        concurrency = HTTPMORPH_BATCH_DEFAULT_CONCURRENCY;
+    }
+    if ((size_t)concurrency > count) {
+        concurrency = (int)count;
+    }
+    batch->workers = calloc(concurrency > 0 ? (size_t)concurrency : 1, sizeof(pthread_t));
+    if (!batch->responses || !batch->completed || !batch->workers) {
+        free(batch->responses);
+        free(batch->completed);
+        free(batch->workers);
+        free(batch);
+        return NULL;
+    }
+
+    pthread_mutex_init(&batch->mutex, NULL);
+    pthread_cond_init(&batch->cond, NULL);
+
+    for (int i = 0; i < concurrency; i++) {
+        if (pthread_create(&batch->workers[batch->worker_count], NULL, batch_worker, batch) != 0) {
+            break;
+        }
+        batch->worker_count++;
+    }
+
+    if (batch->worker_count == 0 && count > 0) {
+        httpmorph_batch_destroy(batch);
+        return NULL;
+    }
+    return batch;
+}
+
+/**
+ * Take the next finished response
+ */
+int httpmorph_batch_next(httpmorph_batch_t *batch, uint32_t timeout_ms,
+                         httpmorph_response_t **response) {
+    if (!batch || !response) {
+        return HTTPMORPH_BATCH_DONE;
+    }
+    *response = NULL;
+
+    pthread_mutex_lock(&batch->mutex);
+    if (batch->delivered_count >= batch->count) {
+        pthread_mutex_unlock(&batch->mutex);
+        return HTTPMORPH_BATCH_DONE;
+    }
+
+    if (timeout_ms > 0) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        while (batch->delivered_count == batch->completed_count) {
+            if (pthread_cond_timedwait(&batch->cond, &batch->mutex, &deadline) != 0 &&
+                batch->delivered_count == batch->completed_count) {
+                pthread_mutex_unlock(&batch->mutex);
+                return HTTPMORPH_BATCH_TIMEOUT;
+            }
+        }
+    } else {
+        while (batch->delivered_count == batch->completed_count) {
+            pthread_cond_wait(&batch->cond, &batch->mutex);
+        }
+    }
+
+    size_t index = batch->completed[batch->delivered_count++];
+    *response = batch->responses[index];
+    batch->responses[index] = NULL;
+    pthread_mutex_unlock(&batch->mutex);
+    return (int)index;
+}
+
+/**
+ * Stop a batch and free it
+ */
+void httpmorph_batch_destroy(httpmorph_batch_t *batch) {
+    if (!batch) {
+        return;
+    }
+
+    /* Requests already running finish; the rest never start */
+    pthread_mutex_lock(&batch->mutex);
+    batch->cancelled = true;
+    pthread_cond_broadcast(&batch->cond);
+    pthread_mutex_unlock(&batch->mutex);
+
+    for (int i = 0; i < batch->worker_count; i++) {
+        pthread_join(batch->workers[i], NULL);
+    }
+
+    for (size_t i = 0; i < batch->count; i++) {
+        httpmorph_response_destroy(batch->responses[i]);
+    }
+
+    batch_origin_t *origin = batch->origins;
+    while (origin) {
+        batch_origin_t *next = origin->next;
+        free(origin->host);
+        free(origin);
+        origin = next;
+    }
+
+    pthread_cond_destroy(&batch->cond);
+    pthread_mutex_destroy(&batch->mutex);
+    free(batch->workers);
+    free(batch->completed);
+    free(batch->responses);
+    free(batch);
+}
@@ -2,13 +2,21 @@
  * boringssl_wrapper.cc - C++ wrapper for BoringSSL C++ functions
  */
 
+#include <stddef.h>
+#include <stdint.h>
+#include <openssl/span.h>
+
 /* Forward declare BoringSSL types */
 struct ssl_ctx_st;
 typedef struct ssl_ctx_st SSL_CTX;
+struct ssl_st;
+typedef struct ssl_st SSL;
 
-/* Forward declare BoringSSL C++ function */
+/* Forward declare BoringSSL C++ functions */
 namespace bssl {
     extern void SSL_CTX_set_aes_hw_override_for_testing(SSL_CTX *ctx, bool override_value);
+    extern bool SSL_get_traffic_secrets(const SSL *ssl, Span<const uint8_t> *out_read_traffic_secret,
+                                        Span<const uint8_t> *out_write_traffic_secret);
 }
 
 extern "C" {
@@ -18,4 +26,15 @@ void httpmorph_set_aes_hw_override(SSL_CTX *ctx, int override_value) {
     bssl::SSL_CTX_set_aes_hw_override_for_testing(ctx, override_value != 0);
 }
 
+/* C wrapper for bssl::SSL_get_traffic_secrets, read direction only (TLS 1.3) */
+int httpmorph_get_read_traffic_secret(const SSL *ssl, const uint8_t **secret, size_t *len) {
+    bssl::Span<const uint8_t> read_secret, write_secret;
+    if (!bssl::SSL_get_traffic_secrets(ssl, &read_secret, &write_secret)) {
+        return 0;
+    }
+    *secret = read_secret.data();
+    *len = read_secret.size();
+    return 1;
+}
+
 }
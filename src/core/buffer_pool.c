@@ -1,36 +1,76 @@
 /**
  * buffer_pool.c - Buffer pooling implementation
  *
- * Slab allocator for common response buffer sizes.
+ * Slab allocator for common response buffer sizes, with per-thread
+ * magazines in front of a shared, mutex-protected depot.
  */
 
 #include "buffer_pool.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #ifdef _WIN32
     #include <windows.h>
 #else
     #include <pthread.h>
+    #include <sys/mman.h>
 #endif
 
-/* Buffer tier structure */
+/* Per-thread, per-tier magazine */
+typedef struct buffer_magazine {
+    void *buffers[BUFFER_POOL_MAGAZINE_SIZE * 4];
+    int count;
+
+    /* Statistics (written by the owning thread only) */
+    size_t hits;
+    size_t magazine_hits;
+    size_t misses;
+    size_t returns;
+} buffer_magazine_t;
+
+/* Per-thread cache for one pool */
+typedef struct thread_cache {
+    httpmorph_buffer_pool_t *pool;
+    uint64_t pool_id;              /* Detects a new pool reusing a freed address */
+    bool orphaned;                 /* Pool destroyed; buffers already released */
+    unsigned long thread_id;
+    buffer_magazine_t magazines[BUFFER_POOL_MAX_TIERS];
+    size_t untiered_misses;
+
+    struct thread_cache *thread_next;  /* This thread's caches */
+    struct thread_cache *pool_next;    /* Pool's registered caches */
+} thread_cache_t;
+
+/* Buffer tier structure (shared depot) */
 typedef struct buffer_tier {
     size_t buffer_size;           /* Size of buffers in this tier */
-    void *buffers[BUFFERS_PER_TIER];  /* Array of available buffers */
+    bool use_mmap;                /* Backed by anonymous mappings */
+    void **buffers;               /* Array of available buffers */
+    int capacity;                 /* Depot capacity */
     int available_count;          /* Number of available buffers */
+
+    /* Statistics for gets/puts not attributed to a live thread cache */
+    size_t hits;
+    size_t magazine_hits;
+    size_t misses;
+    size_t returns;
 } buffer_tier_t;
 
 /* Buffer pool structure */
 struct httpmorph_buffer_pool {
-    buffer_tier_t tiers[NUM_TIERS];  /* 4KB, 16KB, 64KB, 256KB */
+    buffer_tier_t tiers[BUFFER_POOL_MAX_TIERS];
+    int num_tiers;
+    int magazine_size;
+    uint64_t id;
+
+    /* Statistics for oversized requests */
+    size_t untiered_misses;
 
-    /* Statistics */
-    size_t hits;       /* Pool retrievals */
-    size_t misses;     /* New allocations */
-    size_t returns;    /* Buffers returned */
+    /* Registered thread caches (protected by cache_registry_lock) */
+    thread_cache_t *caches;
 
-    /* Thread safety */
+    /* Thread safety (depot) */
 #ifdef _WIN32
     CRITICAL_SECTION mutex;
 #else
@@ -38,62 +78,372 @@ struct httpmorph_buffer_pool {
 #endif
 };
 
+/* Registry lock: guards pool->caches and thread_cache->orphaned.
+ * Lock order: registry, then pool mutex. */
+#ifdef _WIN32
+static SRWLOCK cache_registry_lock = SRWLOCK_INIT;
+#define REGISTRY_LOCK()   AcquireSRWLockExclusive(&cache_registry_lock)
+#define REGISTRY_UNLOCK() ReleaseSRWLockExclusive(&cache_registry_lock)
+#define POOL_LOCK(p)      EnterCriticalSection(&(p)->mutex)
+#define POOL_UNLOCK(p)    LeaveCriticalSection(&(p)->mutex)
+static INIT_ONCE cache_key_once = INIT_ONCE_STATIC_INIT;
+static DWORD cache_key = FLS_OUT_OF_INDEXES;
+#else
+static pthread_mutex_t cache_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+#define REGISTRY_LOCK()   pthread_mutex_lock(&cache_registry_lock)
+#define REGISTRY_UNLOCK() pthread_mutex_unlock(&cache_registry_lock)
+#define POOL_LOCK(p)      pthread_mutex_lock(&(p)->mutex)
+#define POOL_UNLOCK(p)    pthread_mutex_unlock(&(p)->mutex)
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static bool cache_key_valid = false;
+#endif
+
+static uint64_t next_pool_id = 1;
+
+/* === Raw allocation === */
+
+static void* tier_alloc(const buffer_tier_t *tier) {
+    if (!tier->use_mmap) {
+        return malloc(tier->buffer_size);
+    }
+#ifdef _WIN32
+    return VirtualAlloc(NULL, tier->buffer_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+    void *p = mmap(NULL, tier->buffer_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return (p == MAP_FAILED) ? NULL : p;
+#endif
+}
+
+static void tier_release(const buffer_tier_t *tier, void *buffer) {
+    if (!tier->use_mmap) {
+        free(buffer);
+        return;
+    }
+#ifdef _WIN32
+    VirtualFree(buffer, 0, MEM_RELEASE);
+#else
+    munmap(buffer, tier->buffer_size);
+#endif
+}
+
+/**
+ * Let the OS reclaim pages of an idle mmap-backed buffer
+ * The mapping stays valid; pages fault back in zeroed (or intact) on reuse
+ */
+static void tier_discard_pages(const buffer_tier_t *tier, void *buffer) {
+    if (!tier->use_mmap) {
+        return;
+    }
+#ifdef _WIN32
+    VirtualAlloc(buffer, tier->buffer_size, MEM_RESET, PAGE_READWRITE);
+#elif defined(MADV_FREE)
+    madvise(buffer, tier->buffer_size, MADV_FREE);
+#else
+    madvise(buffer, tier->buffer_size, MADV_DONTNEED);
+#endif
+}
+
 /**
  * Get tier index for a given size
  * Returns the smallest tier that can fit the requested size
  */
-static int get_tier_index(size_t size) {
-    if (size <= BUFFER_SIZE_4KB) return 0;
-    if (size <= BUFFER_SIZE_16KB) return 1;
-    if (size <= BUFFER_SIZE_64KB) return 2;
-    if (size <= BUFFER_SIZE_256KB) return 3;
+static int get_tier_index(const httpmorph_buffer_pool_t *pool, size_t size) {
+    for (int i = 0; i < pool->num_tiers; i++) {
+        if (size <= pool->tiers[i].buffer_size) {
+            return i;
+        }
+    }
     return -1;  /* Too large for pooling */
 }
 
 /**
- * Get buffer size for a tier index
+ * Get tier index for a returned buffer (exact size match only)
+ */
+static int get_tier_index_exact(const httpmorph_buffer_pool_t *pool, size_t size) {
+    for (int i = 0; i < pool->num_tiers; i++) {
+        if (size == pool->tiers[i].buffer_size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* === Depot (caller holds pool mutex) === */
+
+static void depot_push_or_release(buffer_tier_t *tier, void *buffer) {
+    if (tier->available_count < tier->capacity) {
+        tier_discard_pages(tier, buffer);
+        tier->buffers[tier->available_count++] = buffer;
+    } else {
+        tier_release(tier, buffer);
+    }
+}
+
+/* === Thread caches === */
+
+/**
+ * Move a cache's buffers to the depot and fold its counters into the tiers
+ * Caller holds registry lock and pool mutex
+ */
+static void cache_retire_locked(thread_cache_t *cache) {
+    httpmorph_buffer_pool_t *pool = cache->pool;
+
+    for (int i = 0; i < pool->num_tiers; i++) {
+        buffer_magazine_t *mag = &cache->magazines[i];
+        buffer_tier_t *tier = &pool->tiers[i];
+
+        while (mag->count > 0) {
+            depot_push_or_release(tier, mag->buffers[--mag->count]);
+        }
+        tier->hits += mag->hits;
+        tier->magazine_hits += mag->magazine_hits;
+        tier->misses += mag->misses;
+        tier->returns += mag->returns;
+    }
+    pool->untiered_misses += cache->untiered_misses;
+
+    /* Unlink from pool */
+    thread_cache_t **pp = &pool->caches;
+    while (*pp && *pp != cache) {
+        pp = &(*pp)->pool_next;
+    }
+    if (*pp) {
+        *pp = cache->pool_next;
+    }
+}
+
+/**
+ * Thread exit: hand every cache of this thread back to its pool
+ */
+#ifdef _WIN32
+static VOID NTAPI cache_thread_exit(PVOID value) {
+#else
+static void cache_thread_exit(void *value) {
+#endif
+    thread_cache_t *cache = (thread_cache_t*)value;
+
+    REGISTRY_LOCK();
+    while (cache) {
+        thread_cache_t *next = cache->thread_next;
+        if (!cache->orphaned) {
+            POOL_LOCK(cache->pool);
+            cache_retire_locked(cache);
+            POOL_UNLOCK(cache->pool);
+        }
+        free(cache);
+        cache = next;
+    }
+    REGISTRY_UNLOCK();
+}
+
+#ifdef _WIN32
+static BOOL CALLBACK cache_key_init(PINIT_ONCE InitOnce, PVOID Parameter, PVOID *Context) {
+    (void)InitOnce; (void)Parameter; (void)Context;
+    cache_key = FlsAlloc(cache_thread_exit);
+    return TRUE;
+}
+
+static thread_cache_t* cache_list_get(void) {
+    InitOnceExecuteOnce(&cache_key_once, cache_key_init, NULL, NULL);
+    if (cache_key == FLS_OUT_OF_INDEXES) {
+        return NULL;
+    }
+    return (thread_cache_t*)FlsGetValue(cache_key);
+}
+
+static bool cache_list_set(thread_cache_t *head) {
+    return cache_key != FLS_OUT_OF_INDEXES && FlsSetValue(cache_key, head);
+}
+
+static unsigned long current_thread_id(void) {
+    return (unsigned long)GetCurrentThreadId();
+}
+#else
+static void cache_key_init(void) {
+    cache_key_valid = (pthread_key_create(&cache_key, cache_thread_exit) == 0);
+}
+
+static thread_cache_t* cache_list_get(void) {
+    pthread_once(&cache_key_once, cache_key_init);
+    if (!cache_key_valid) {
+        return NULL;
+    }
+    return (thread_cache_t*)pthread_getspecific(cache_key);
+}
+
+static bool cache_list_set(thread_cache_t *head) {
+    return cache_key_valid && pthread_setspecific(cache_key, head) == 0;
+}
+
+static unsigned long current_thread_id(void) {
+    return (unsigned long)(uintptr_t)pthread_self();
+}
+#endif
+
+/**
+ * Drop caches whose pool has been destroyed from this thread's list
+ */
+static thread_cache_t* cache_list_prune(thread_cache_t *head) {
+    REGISTRY_LOCK();
+    thread_cache_t **pp = &head;
+    while (*pp) {
+        thread_cache_t *cache = *pp;
+        if (cache->orphaned) {
+            *pp = cache->thread_next;
+            free(cache);
+        } else {
+            pp = &cache->thread_next;
+        }
+    }
+    REGISTRY_UNLOCK();
+    return head;
+}
+
+/**
+ * Find (or create) the calling thread's cache for a pool
+ * Returns NULL if magazines are disabled or allocation fails
+ */
+static thread_cache_t* get_thread_cache(httpmorph_buffer_pool_t *pool) {
+    if (pool->magazine_size <= 0) {
+        return NULL;
+    }
+
+    thread_cache_t *head = cache_list_get();
+    for (thread_cache_t *c = head; c; c = c->thread_next) {
+        if (c->pool == pool && c->pool_id == pool->id) {
+            return c;
+        }
+    }
+
+    /* Slow path: drop caches of destroyed pools before adding one */
+    head = cache_list_prune(head);
+
+    thread_cache_t *cache = (thread_cache_t*)calloc(1, sizeof(thread_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+    cache->pool = pool;
+    cache->pool_id = pool->id;
+    cache->thread_id = current_thread_id();
+    cache->thread_next = head;
+    if (!cache_list_set(cache)) {
+        free(cache);
+        return NULL;
+    }
+
+    REGISTRY_LOCK();
+    cache->pool_next = pool->caches;
+    pool->caches = cache;
+    REGISTRY_UNLOCK();
+
+    return cache;
+}
+
+/* === Public API === */
+
+/**
+ * Fill a configuration with the default tiers
  */
-static size_t get_tier_size(int tier_index) {
-    switch (tier_index) {
-        case 0: return BUFFER_SIZE_4KB;
-        case 1: return BUFFER_SIZE_16KB;
-        case 2: return BUFFER_SIZE_64KB;
-        case 3: return BUFFER_SIZE_256KB;
-        default: return 0;
+void buffer_pool_default_config(buffer_pool_config_t *config) {
+    if (!config) {
+        return;
+    }
+
+    static const size_t sizes[NUM_TIERS] = {
+        BUFFER_SIZE_4KB, BUFFER_SIZE_16KB, BUFFER_SIZE_64KB,
+        BUFFER_SIZE_256KB, BUFFER_SIZE_1MB, BUFFER_SIZE_4MB
+    };
+    /* Fewer large buffers: they dominate retained memory */
+    static const int capacity[NUM_TIERS] = {
+        BUFFERS_PER_TIER, BUFFERS_PER_TIER, BUFFERS_PER_TIER,
+        BUFFERS_PER_TIER / 4, 4, 2
+    };
+
+    memset(config, 0, sizeof(*config));
+    for (int i = 0; i < NUM_TIERS; i++) {
+        config->tier_sizes[i] = sizes[i];
+        config->tier_capacity[i] = capacity[i];
     }
+    config->num_tiers = NUM_TIERS;
+    config->magazine_size = BUFFER_POOL_MAGAZINE_SIZE;
+    config->mmap_threshold = BUFFER_POOL_MMAP_THRESHOLD;
 }
 
 /**
  * Create a new buffer pool
  */
 httpmorph_buffer_pool_t* buffer_pool_create(void) {
+    return buffer_pool_create_with_config(NULL);
+}
+
+/**
+ * Create a new buffer pool with an explicit configuration
+ */
+httpmorph_buffer_pool_t* buffer_pool_create_with_config(const buffer_pool_config_t *config) {
+    buffer_pool_config_t defaults;
+    if (!config) {
+        buffer_pool_default_config(&defaults);
+        config = &defaults;
+    }
+
+    /* Validate configuration */
+    if (config->num_tiers < 0 || config->num_tiers > BUFFER_POOL_MAX_TIERS ||
+        config->magazine_size < 0 ||
+        config->magazine_size > (int)(sizeof(((buffer_magazine_t*)0)->buffers) / sizeof(void*))) {
+        return NULL;
+    }
+    for (int i = 0; i < config->num_tiers; i++) {
+        if (config->tier_sizes[i] == 0 || config->tier_capacity[i] < 0 ||
+            (i > 0 && config->tier_sizes[i] <= config->tier_sizes[i - 1])) {
+            return NULL;
+        }
+    }
+
     httpmorph_buffer_pool_t *pool = (httpmorph_buffer_pool_t*)calloc(1, sizeof(httpmorph_buffer_pool_t));
     if (!pool) {
         return NULL;
     }
 
     /* Initialize tiers */
-    for (int i = 0; i < NUM_TIERS; i++) {
-        pool->tiers[i].buffer_size = get_tier_size(i);
-        pool->tiers[i].available_count = 0;
-        memset(pool->tiers[i].buffers, 0, sizeof(pool->tiers[i].buffers));
+    pool->num_tiers = config->num_tiers;
+    pool->magazine_size = config->magazine_size;
+    for (int i = 0; i < pool->num_tiers; i++) {
+        buffer_tier_t *tier = &pool->tiers[i];
+        tier->buffer_size = config->tier_sizes[i];
+        tier->use_mmap = config->mmap_threshold > 0 && tier->buffer_size >= config->mmap_threshold;
+        tier->capacity = config->tier_capacity[i];
+        tier->available_count = 0;
+        if (tier->capacity > 0) {
+            tier->buffers = (void**)calloc((size_t)tier->capacity, sizeof(void*));
+            if (!tier->buffers) {
+                while (--i >= 0) {
+                    free(pool->tiers[i].buffers);
+                }
+                free(pool);
+                return NULL;
+            }
+        }
     }
 
-    /* Initialize statistics */
-    pool->hits = 0;
-    pool->misses = 0;
-    pool->returns = 0;
-
     /* Initialize mutex */
 #ifdef _WIN32
     InitializeCriticalSection(&pool->mutex);
 #else
     if (pthread_mutex_init(&pool->mutex, NULL) != 0) {
+        for (int i = 0; i < pool->num_tiers; i++) {
+            free(pool->tiers[i].buffers);
+        }
         free(pool);
         return NULL;
     }
 #endif
 
+    REGISTRY_LOCK();
+    pool->id = next_pool_id++;
+    REGISTRY_UNLOCK();
+
     return pool;
 }
 
@@ -105,18 +455,30 @@ void buffer_pool_destroy(httpmorph_buffer_pool_t *pool) {
         return;
     }
 
+    /* Release buffers cached by any thread; the caches themselves are
+     * freed by their threads once they notice the pool is gone */
+    REGISTRY_LOCK();
+    for (thread_cache_t *cache = pool->caches; cache; cache = cache->pool_next) {
+        for (int i = 0; i < pool->num_tiers; i++) {
+            buffer_magazine_t *mag = &cache->magazines[i];
+            while (mag->count > 0) {
+                tier_release(&pool->tiers[i], mag->buffers[--mag->count]);
+            }
+        }
+        cache->orphaned = true;
+    }
+    pool->caches = NULL;
+    REGISTRY_UNLOCK();
+
     /* Lock mutex before destroying to prevent concurrent access */
-#ifdef _WIN32
-    EnterCriticalSection(&pool->mutex);
-#else
-    pthread_mutex_lock(&pool->mutex);
-#endif
+    POOL_LOCK(pool);
 
     /* Free all pooled buffers while holding lock */
-    for (int i = 0; i < NUM_TIERS; i++) {
+    for (int i = 0; i < pool->num_tiers; i++) {
         for (int j = 0; j < pool->tiers[i].available_count; j++) {
-            free(pool->tiers[i].buffers[j]);
+            tier_release(&pool->tiers[i], pool->tiers[i].buffers[j]);
         }
+        free(pool->tiers[i].buffers);
     }
 
     /* Unlock before destroying mutex */
@@ -139,47 +501,72 @@ void* buffer_pool_get(httpmorph_buffer_pool_t *pool, size_t size, size_t *actual
         return NULL;
     }
 
-    int tier_index = get_tier_index(size);
-    void *buffer = NULL;
-
-    /* Lock pool */
-#ifdef _WIN32
-    EnterCriticalSection(&pool->mutex);
-#else
-    pthread_mutex_lock(&pool->mutex);
-#endif
-
-    /* Try to get buffer from pool */
-    if (tier_index >= 0 && pool->tiers[tier_index].available_count > 0) {
-        /* Get buffer from pool */
-        pool->tiers[tier_index].available_count--;
-        buffer = pool->tiers[tier_index].buffers[pool->tiers[tier_index].available_count];
-        pool->tiers[tier_index].buffers[pool->tiers[tier_index].available_count] = NULL;
+    int tier_index = get_tier_index(pool, size);
+    thread_cache_t *cache = get_thread_cache(pool);
+
+    if (tier_index < 0) {
+        /* Too large for pooling - plain allocation */
+        if (cache) {
+            cache->untiered_misses++;
+        } else {
+            POOL_LOCK(pool);
+            pool->untiered_misses++;
+            POOL_UNLOCK(pool);
+        }
+        if (actual_size) {
+            *actual_size = size;
+        }
+        return malloc(size);
+    }
 
-        pool->hits++;
+    buffer_tier_t *tier = &pool->tiers[tier_index];
+    void *buffer = NULL;
 
-        if (actual_size) {
-            *actual_size = pool->tiers[tier_index].buffer_size;
+    /* mmap tiers skip the magazines: a buffer parked there stays resident,
+     * one in the depot has had its pages handed back */
+    if (cache && !tier->use_mmap) {
+        buffer_magazine_t *mag = &cache->magazines[tier_index];
+
+        /* Fast path: own magazine, no lock */
+        if (mag->count > 0) {
+            buffer = mag->buffers[--mag->count];
+            mag->hits++;
+            mag->magazine_hits++;
+        } else {
+            /* Refill half a magazine from the depot */
+            POOL_LOCK(pool);
+            int want = pool->magazine_size / 2 + 1;
+            while (want-- > 0 && tier->available_count > 0) {
+                mag->buffers[mag->count++] = tier->buffers[--tier->available_count];
+            }
+            POOL_UNLOCK(pool);
+
+            if (mag->count > 0) {
+                buffer = mag->buffers[--mag->count];
+                mag->hits++;
+            } else {
+                buffer = tier_alloc(tier);
+                mag->misses++;
+            }
         }
     } else {
-        /* Allocate new buffer */
-        size_t alloc_size = (tier_index >= 0) ? get_tier_size(tier_index) : size;
-        buffer = malloc(alloc_size);
-
-        pool->misses++;
+        POOL_LOCK(pool);
+        if (tier->available_count > 0) {
+            buffer = tier->buffers[--tier->available_count];
+            tier->hits++;
+        } else {
+            tier->misses++;
+        }
+        POOL_UNLOCK(pool);
 
-        if (actual_size) {
-            *actual_size = alloc_size;
+        if (!buffer) {
+            buffer = tier_alloc(tier);
         }
     }
 
-    /* Unlock pool */
-#ifdef _WIN32
-    LeaveCriticalSection(&pool->mutex);
-#else
-    pthread_mutex_unlock(&pool->mutex);
-#endif
-
+    if (actual_size) {
+        *actual_size = buffer ? tier->buffer_size : 0;
+    }
     return buffer;
 }
 
@@ -191,33 +578,47 @@ void buffer_pool_put(httpmorph_buffer_pool_t *pool, void *buffer, size_t size) {
         return;
     }
 
-    int tier_index = get_tier_index(size);
+    int tier_index = get_tier_index_exact(pool, size);
+    if (tier_index < 0) {
+        /* Oversized (or not a tier size) - plain allocation */
+        free(buffer);
+        return;
+    }
 
-    /* Lock pool */
-#ifdef _WIN32
-    EnterCriticalSection(&pool->mutex);
-#else
-    pthread_mutex_lock(&pool->mutex);
-#endif
+    buffer_tier_t *tier = &pool->tiers[tier_index];
+    thread_cache_t *cache = get_thread_cache(pool);
 
-    /* Try to return buffer to pool */
-    if (tier_index >= 0 && pool->tiers[tier_index].available_count < BUFFERS_PER_TIER) {
-        /* Add buffer to pool */
-        pool->tiers[tier_index].buffers[pool->tiers[tier_index].available_count] = buffer;
-        pool->tiers[tier_index].available_count++;
+    if (cache && !tier->use_mmap) {
+        buffer_magazine_t *mag = &cache->magazines[tier_index];
 
-        pool->returns++;
-    } else {
-        /* Pool full or buffer too large - free it */
-        free(buffer);
+        if (mag->count >= pool->magazine_size) {
+            /* Spill half the magazine to the depot */
+            POOL_LOCK(pool);
+            int spill = pool->magazine_size / 2 + 1;
+            while (spill-- > 0 && mag->count > 0) {
+                depot_push_or_release(tier, mag->buffers[--mag->count]);
+            }
+            POOL_UNLOCK(pool);
+        }
+
+        mag->buffers[mag->count++] = buffer;
+        mag->returns++;
+        return;
     }
 
-    /* Unlock pool */
-#ifdef _WIN32
-    LeaveCriticalSection(&pool->mutex);
-#else
-    pthread_mutex_unlock(&pool->mutex);
-#endif
+    POOL_LOCK(pool);
+    if (tier->available_count < tier->capacity) {
+        tier_discard_pages(tier, buffer);
+        tier->buffers[tier->available_count++] = buffer;
+        tier->returns++;
+        buffer = NULL;
+    }
+    POOL_UNLOCK(pool);
+
+    /* Pool full - free it */
+    if (buffer) {
+        tier_release(tier, buffer);
+    }
 }
 
 /**
@@ -229,21 +630,100 @@ void buffer_pool_stats(httpmorph_buffer_pool_t *pool,
         return;
     }
 
-    /* Lock pool */
-#ifdef _WIN32
-    EnterCriticalSection(&pool->mutex);
-#else
-    pthread_mutex_lock(&pool->mutex);
-#endif
+    size_t total_hits = 0, total_misses = 0, total_returns = 0;
+    for (int i = 0; i < pool->num_tiers; i++) {
+        buffer_tier_stats_t tier_stats;
+        if (buffer_pool_tier_stats(pool, i, &tier_stats) == 0) {
+            total_hits += tier_stats.hits;
+            total_misses += tier_stats.misses;
+            total_returns += tier_stats.returns;
+        }
+    }
 
-    if (hits) *hits = pool->hits;
-    if (misses) *misses = pool->misses;
-    if (returns) *returns = pool->returns;
+    REGISTRY_LOCK();
+    POOL_LOCK(pool);
+    total_misses += pool->untiered_misses;
+    for (thread_cache_t *c = pool->caches; c; c = c->pool_next) {
+        total_misses += c->untiered_misses;
+    }
+    POOL_UNLOCK(pool);
+    REGISTRY_UNLOCK();
 
-    /* Unlock pool */
-#ifdef _WIN32
-    LeaveCriticalSection(&pool->mutex);
-#else
-    pthread_mutex_unlock(&pool->mutex);
-#endif
+    if (hits) *hits = total_hits;
+    if (misses) *misses = total_misses;
+    if (returns) *returns = total_returns;
+}
+
+/**
+ * Get the number of configured tiers
+ */
+int buffer_pool_tier_count(httpmorph_buffer_pool_t *pool) {
+    return pool ? pool->num_tiers : 0;
+}
+
+/**
+ * Get statistics for one tier
+ */
+int buffer_pool_tier_stats(httpmorph_buffer_pool_t *pool, int tier, buffer_tier_stats_t *stats) {
+    if (!pool || !stats || tier < 0 || tier >= pool->num_tiers) {
+        return -1;
+    }
+
+    REGISTRY_LOCK();
+    POOL_LOCK(pool);
+
+    const buffer_tier_t *t = &pool->tiers[tier];
+    stats->buffer_size = t->buffer_size;
+    stats->mmap_backed = t->use_mmap;
+    stats->hits = t->hits;
+    stats->magazine_hits = t->magazine_hits;
+    stats->misses = t->misses;
+    stats->returns = t->returns;
+    stats->depot_count = (size_t)t->available_count;
+
+    /* Live thread counters are read without their owner's cooperation;
+     * values may lag by a few operations */
+    for (thread_cache_t *c = pool->caches; c; c = c->pool_next) {
+        const buffer_magazine_t *mag = &c->magazines[tier];
+        stats->hits += mag->hits;
+        stats->magazine_hits += mag->magazine_hits;
+        stats->misses += mag->misses;
+        stats->returns += mag->returns;
+    }
+
+    POOL_UNLOCK(pool);
+    REGISTRY_UNLOCK();
+    return 0;
+}
+
+/**
+ * Get per-thread statistics
+ */
+size_t buffer_pool_thread_stats(httpmorph_buffer_pool_t *pool,
+                                buffer_thread_stats_t *stats, size_t max_threads) {
+    if (!pool) {
+        return 0;
+    }
+
+    size_t count = 0;
+
+    REGISTRY_LOCK();
+    for (thread_cache_t *c = pool->caches; c; c = c->pool_next) {
+        if (stats && count < max_threads) {
+            buffer_thread_stats_t *out = &stats[count];
+            memset(out, 0, sizeof(*out));
+            out->thread_id = c->thread_id;
+            out->misses = c->untiered_misses;
+            for (int i = 0; i < pool->num_tiers; i++) {
+                out->hits += c->magazines[i].hits;
+                out->misses += c->magazines[i].misses;
+                out->returns += c->magazines[i].returns;
+                out->cached += (size_t)c->magazines[i].count;
+            }
+        }
+        count++;
+    }
+    REGISTRY_UNLOCK();
+
+    return count;
 }
@@ -3,6 +3,12 @@
  *
  * Implements a slab allocator for common response buffer sizes.
  * Reuses buffers across requests to minimize malloc/free calls.
+ *
+ * Each thread keeps a small magazine of buffers per tier that it can use
+ * without locking; magazines refill from and spill to a shared depot.
+ * Large tiers can be backed by anonymous mappings so multi-MB bodies are
+ * pooled too without holding resident memory while idle; those tiers go
+ * straight to the depot, never through a magazine.
  */
 
 #ifndef HTTPMORPH_BUFFER_POOL_H
@@ -11,17 +17,28 @@
 #include <stddef.h>
 #include <stdbool.h>
 
-/* Buffer size tiers (powers of 2 for efficient allocation) */
+/* Default buffer size tiers (powers of 2 for efficient allocation) */
 #define BUFFER_SIZE_4KB    4096
 #define BUFFER_SIZE_16KB   16384
 #define BUFFER_SIZE_64KB   65536
 #define BUFFER_SIZE_256KB  262144
+#define BUFFER_SIZE_1MB    1048576
+#define BUFFER_SIZE_4MB    4194304
+
+/* Default number of buffers kept in the shared depot per tier */
+#define BUFFERS_PER_TIER   32
+
+/* Default number of tiers */
+#define NUM_TIERS          6
 
-/* Number of buffers to keep per size tier */
-#define BUFFERS_PER_TIER   8
+/* Upper bound on configurable tiers */
+#define BUFFER_POOL_MAX_TIERS 8
 
-/* Total number of size tiers */
-#define NUM_TIERS          4
+/* Default per-thread magazine size (buffers per tier) */
+#define BUFFER_POOL_MAGAZINE_SIZE 4
+
+/* Default size from which tiers are mmap-backed */
+#define BUFFER_POOL_MMAP_THRESHOLD BUFFER_SIZE_1MB
 
 /**
  * Buffer pool structure
@@ -30,15 +47,68 @@
 typedef struct httpmorph_buffer_pool httpmorph_buffer_pool_t;
 
 /**
- * Create a new buffer pool
+ * Buffer pool configuration
+ */
+typedef struct {
+    size_t tier_sizes[BUFFER_POOL_MAX_TIERS];    /* Strictly ascending buffer sizes */
+    int tier_capacity[BUFFER_POOL_MAX_TIERS];    /* Depot capacity per tier */
+    int num_tiers;
+    int magazine_size;                           /* Per-thread buffers per tier, 0 disables */
+    size_t mmap_threshold;                       /* Tiers this size or larger use mmap (0 = never) */
+} buffer_pool_config_t;
+
+/**
+ * Per-tier statistics
+ */
+typedef struct {
+    size_t buffer_size;
+    bool mmap_backed;
+    size_t hits;             /* Gets served from a magazine or the depot */
+    size_t magazine_hits;    /* Gets served without taking the depot lock */
+    size_t misses;           /* Gets that allocated a new buffer */
+    size_t returns;          /* Puts kept for reuse */
+    size_t depot_count;      /* Buffers currently in the depot */
+} buffer_tier_stats_t;
+
+/**
+ * Per-thread statistics
+ */
+typedef struct {
+    unsigned long thread_id;
+    size_t hits;
+    size_t misses;
+    size_t returns;
+    size_t cached;           /* Buffers currently held in this thread's magazines */
+} buffer_thread_stats_t;
+
+/**
+ * Fill a configuration with the default tiers
+ *
+ * @param config Output configuration
+ */
+void buffer_pool_default_config(buffer_pool_config_t *config);
+
+/**
+ * Create a new buffer pool with the default configuration
  *
  * @return Initialized buffer pool or NULL on error
  */
 httpmorph_buffer_pool_t* buffer_pool_create(void);
 
+/**
+ * Create a new buffer pool
+ *
+ * @param config Tier configuration (NULL for defaults)
+ * @return Initialized buffer pool or NULL on error (including invalid config)
+ */
+httpmorph_buffer_pool_t* buffer_pool_create_with_config(const buffer_pool_config_t *config);
+
 /**
  * Destroy a buffer pool and free all resources
  *
+ * Buffers still cached by other threads are released as well; the pool
+ * must not be in use concurrently.
+ *
  * @param pool Buffer pool to destroy
  */
 void buffer_pool_destroy(httpmorph_buffer_pool_t *pool);
@@ -60,11 +130,12 @@ void* buffer_pool_get(httpmorph_buffer_pool_t *pool, size_t size, size_t *actual
  * Return a buffer to the pool
  *
  * Returns the buffer to the pool for reuse. If the pool for this size
- * is full, the buffer is freed instead.
+ * is full, the buffer is freed instead. Only buffers obtained from
+ * buffer_pool_get() may be returned.
  *
  * @param pool Buffer pool
  * @param buffer Buffer to return
- * @param size Size of the buffer (must match size used in buffer_pool_get)
+ * @param size Actual size reported by buffer_pool_get()
  */
 void buffer_pool_put(httpmorph_buffer_pool_t *pool, void *buffer, size_t size);
 
@@ -79,4 +150,33 @@ void buffer_pool_put(httpmorph_buffer_pool_t *pool, void *buffer, size_t size);
 void buffer_pool_stats(httpmorph_buffer_pool_t *pool,
                        size_t *hits, size_t *misses, size_t *returns);
 
+/**
+ * Get the number of configured tiers
+ *
+ * @param pool Buffer pool
+ * @return Tier count (0 if pool is NULL)
+ */
+int buffer_pool_tier_count(httpmorph_buffer_pool_t *pool);
+
+/**
+ * Get statistics for one tier
+ *
+ * @param pool Buffer pool
+ * @param tier Tier index (0 .. buffer_pool_tier_count() - 1)
+ * @param stats Output statistics
+ * @return 0 on success, -1 on error
+ */
+int buffer_pool_tier_stats(httpmorph_buffer_pool_t *pool, int tier, buffer_tier_stats_t *stats);
+
+/**
+ * Get per-thread statistics for threads with a live magazine cache
+ *
+ * @param pool Buffer pool
+ * @param stats Output array (may be NULL to only count)
+ * @param max_threads Capacity of stats
+ * @return Number of live thread caches (may exceed max_threads)
+ */
+size_t buffer_pool_thread_stats(httpmorph_buffer_pool_t *pool,
+                                buffer_thread_stats_t *stats, size_t max_threads);
+
 #endif /* HTTPMORPH_BUFFER_POOL_H */
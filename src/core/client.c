@@ -5,7 +5,14 @@
 #include "internal/client.h"
 #include "internal/tls.h"
 #include "internal/network.h"
+#include "internal/util.h"
 #include "buffer_pool.h"
+#include "dns_resolver.h"
+#include "http2_reactor.h"
+#include "ssl_ctx_cache.h"
+#include "http_cache.h"
+#include "proxy_set.h"
+#include "request_scheduler.h"
 
 #ifndef _WIN32
 #include <pthread.h>
@@ -13,6 +20,16 @@
 #include <windows.h>
 #endif
 
+#ifdef _WIN32
+    #define CLIENT_LOAD_PTR(p) InterlockedCompareExchangePointer((PVOID volatile *)(p), NULL, NULL)
+    #define CLIENT_CAS_PTR(p, expected, desired) \
+        (InterlockedCompareExchangePointer((PVOID volatile *)(p), (desired), (expected)) == (expected))
+#else
+    #define CLIENT_LOAD_PTR(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define CLIENT_CAS_PTR(p, expected, desired) \
+        __atomic_compare_exchange_n((p), &(expected), (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#endif
+
 /* Library state - protected by pthread_once for thread-safe initialization */
 #ifndef _WIN32
 static pthread_once_t init_once_control = PTHREAD_ONCE_INIT;
@@ -24,13 +41,12 @@ static bool httpmorph_init_status = false;
 static bool httpmorph_ever_initialized = false;  /* Track if init ever succeeded */
 static io_engine_t *default_io_engine = NULL;
 
-/* Mutex for SSL_CTX configuration (BoringSSL SSL_CTX_* functions are not thread-safe) */
-/* Non-static so it can be accessed from session.c via extern declaration */
+/* Serializes library cleanup (contexts are configured inside ssl_ctx_cache) */
 #ifndef _WIN32
-pthread_mutex_t ssl_ctx_config_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t ssl_ctx_config_mutex = PTHREAD_MUTEX_INITIALIZER;
 #else
-CRITICAL_SECTION ssl_ctx_config_mutex;
-bool ssl_ctx_mutex_initialized = false;
+static CRITICAL_SECTION ssl_ctx_config_mutex;
+static bool ssl_ctx_mutex_initialized = false;
 #endif
 
 /**
@@ -133,9 +149,16 @@ void httpmorph_cleanup(void) {
 
     cleanup_in_progress = true;
 
-    /* Clear DNS cache first */
+    /* Stop the HTTP/2 reactor threads before their io_engines go away */
+    http2_reactor_shutdown();
+
+    /* Stop resolver threads, then clear the DNS cache they fill */
+    httpmorph_resolver_shutdown();
     dns_cache_clear();
 
+    /* Contexts held by live clients stay valid until those are destroyed */
+    ssl_ctx_cache_clear();
+
     /* Destroy I/O engine last to ensure no pending operations */
     if (default_io_engine) {
         io_engine_destroy(default_io_engine);
@@ -180,6 +203,20 @@ const char* httpmorph_version(void) {
     return version;
 }
 
+/* Helper: Shared context for a profile and CA file */
+static SSL_CTX* client_ssl_ctx_acquire(const browser_profile_t *profile, const char *ca_file) {
+    ssl_ctx_key_t key = { profile, true, 0, 0, ca_file };
+    return ssl_ctx_cache_acquire(&key);
+}
+
+/* Helper: Release the rotation contexts (the profile or CA file changed) */
+static void client_release_variants(httpmorph_client_t *client) {
+    for (int i = 1; i < BROWSER_PROFILE_VARIANTS; i++) {
+        ssl_ctx_cache_release(client->variant_ctx[i]);
+        client->variant_ctx[i] = NULL;
+    }
+}
+
 /**
  * Create a new HTTP client
  */
@@ -192,67 +229,54 @@ httpmorph_client_t* httpmorph_client_create(void) {
         return NULL;
     }
 
-    /* Create SSL context */
-    client->ssl_ctx = SSL_CTX_new(TLS_client_method());
-    if (!client->ssl_ctx) {
-        free(client);
-        return NULL;
-    }
-
-    /* Load system CA certificates for verify=True support */
-#ifdef _WIN32
-    /* On Windows, load certificates from Windows Certificate Store */
-    httpmorph_load_windows_ca_certs(client->ssl_ctx);
-#else
-    /* On Unix-like systems, use default paths */
-    SSL_CTX_set_default_verify_paths(client->ssl_ctx);
-#endif
-
-    /* Disable SSL session caching to avoid BoringSSL state issues */
-    SSL_CTX_set_session_cache_mode(client->ssl_ctx, SSL_SESS_CACHE_OFF);
-
-    /* Set session timeout (5 minutes = 300 seconds) - still set even if caching is off */
-    SSL_CTX_set_timeout(client->ssl_ctx, 300);
-
-    /* Enable session ticket support for TLS 1.3 and better TLS 1.2 resumption */
-    #ifndef SSL_OP_NO_TICKET
-    /* BoringSSL doesn't have SSL_OP_NO_TICKET, session tickets are enabled by default */
-    #else
-    /* For other SSL libraries, ensure tickets are NOT disabled */
-    SSL_CTX_clear_options(client->ssl_ctx, SSL_OP_NO_TICKET);
-    #endif
-
     /* Default configuration */
     client->timeout_ms = 30000;  /* 30 seconds */
-    client->follow_redirects = false;  /* Python layer handles redirects for better control */
+    client->follow_redirects = false;  /* Opt in per client or per request */
     client->max_redirects = 10;
     client->io_engine = default_io_engine;
+    client->tls_fingerprint = true;
 
-    /* Default to Chrome browser profile - protected by mutex since SSL_CTX_* functions are not thread-safe */
+    /* Default to Chrome browser profile; the configured context is shared */
     client->browser_profile = &PROFILE_CHROME_142;
+    client->ssl_ctx = client_ssl_ctx_acquire(client->browser_profile, NULL);
+    if (!client->ssl_ctx) {
+        free(client);
+        return NULL;
+    }
 
-#ifndef _WIN32
-    pthread_mutex_lock(&ssl_ctx_config_mutex);
-#else
-    if (ssl_ctx_mutex_initialized) {
-        EnterCriticalSection(&ssl_ctx_config_mutex);
+    /* Resume sessions per origin through a keyed cache of this client's own,
+     * so sessions never cross hosts, profiles or clients */
+    client->session_cache = tls_session_cache_create(TLS_SESSION_CACHE_DEFAULT_ENTRIES);
+    if (!client->session_cache) {
+        ssl_ctx_cache_release(client->ssl_ctx);
+        free(client);
+        return NULL;
     }
-#endif
 
-    httpmorph_configure_ssl_ctx(client->ssl_ctx, client->browser_profile);
+    client->alt_svc = alt_svc_cache_create();
+    if (!client->alt_svc) {
+        tls_session_cache_destroy(client->session_cache);
+        ssl_ctx_cache_release(client->ssl_ctx);
+        free(client);
+        return NULL;
+    }
 
-#ifndef _WIN32
-    pthread_mutex_unlock(&ssl_ctx_config_mutex);
-#else
-    if (ssl_ctx_mutex_initialized) {
-        LeaveCriticalSection(&ssl_ctx_config_mutex);
+    client->metrics = metrics_create();
+    if (!client->metrics) {
+        alt_svc_cache_destroy(client->alt_svc);
+        tls_session_cache_destroy(client->session_cache);
+        ssl_ctx_cache_release(client->ssl_ctx);
+        free(client);
+        return NULL;
     }
-#endif
 
     /* Create buffer pool for response bodies */
     client->buffer_pool = buffer_pool_create();
     if (!client->buffer_pool) {
-        SSL_CTX_free(client->ssl_ctx);
+        metrics_destroy(client->metrics);
+        alt_svc_cache_destroy(client->alt_svc);
+        tls_session_cache_destroy(client->session_cache);
+        ssl_ctx_cache_release(client->ssl_ctx);
         free(client);
         return NULL;
     }
@@ -260,6 +284,125 @@ httpmorph_client_t* httpmorph_client_create(void) {
     return client;
 }
 
+/**
+ * Compute the JA3 fingerprint of new TLS connections
+ */
+void httpmorph_client_set_tls_fingerprint(httpmorph_client_t *client, bool enabled) {
+    if (client) {
+        client->tls_fingerprint = enabled;
+    }
+}
+
+/**
+ * Follow redirects for the client's new requests
+ */
+void httpmorph_client_set_redirects(httpmorph_client_t *client, bool follow,
+                                    uint32_t max_redirects) {
+    if (client) {
+        client->follow_redirects = follow;
+        client->max_redirects = max_redirects;
+    }
+}
+
+/**
+ * Save round trips to origins seen before
+ */
+void httpmorph_client_set_zero_rtt(httpmorph_client_t *client, bool early_data,
+                                   bool tcp_fast_open) {
+    if (client) {
+        client->early_data = early_data;
+        client->tcp_fast_open = tcp_fast_open;
+    }
+}
+
+/**
+ * Allow HTTP/1.1 pipelining to an origin
+ */
+int httpmorph_client_allow_pipelining(httpmorph_client_t *client, const char *url,
+                                      uint32_t depth) {
+    char origin[REQUEST_SCHEDULER_MAX_KEY];
+    if (!client || !url || !request_scheduler_origin_key(url, origin, sizeof(origin))) {
+        return -1;
+    }
+    if (depth > HTTPMORPH_MAX_PIPELINE_DEPTH) {
+        depth = HTTPMORPH_MAX_PIPELINE_DEPTH;
+    }
+
+    for (size_t i = 0; i < client->pipeline_origin_count; i++) {
+        pipeline_origin_t *entry = &client->pipeline_origins[i];
+        if (strcmp(entry->origin, origin) != 0) {
+            continue;
+        }
+        if (depth > 0) {
+            entry->depth = depth;
+        } else {
+            free(entry->origin);
+            *entry = client->pipeline_origins[--client->pipeline_origin_count];
+        }
+        return 0;
+    }
+    if (depth == 0) {
+        return 0;
+    }
+
+    pipeline_origin_t *origins = realloc(client->pipeline_origins,
+                                         (client->pipeline_origin_count + 1) * sizeof(pipeline_origin_t));
+    if (!origins) {
+        return -1;
+    }
+    client->pipeline_origins = origins;
+    char *copy = strdup(origin);
+    if (!copy) {
+        return -1;
+    }
+    origins[client->pipeline_origin_count].origin = copy;
+    origins[client->pipeline_origin_count].depth = depth;
+    client->pipeline_origin_count++;
+    return 0;
+}
+
+/**
+ * Get how many requests may be pipelined to a URL's origin
+ */
+uint32_t httpmorph_client_pipeline_depth(const httpmorph_client_t *client, const char *url,
+                                         char *origin) {
+    if (!client || client->pipeline_origin_count == 0 || !url ||
+        !request_scheduler_origin_key(url, origin, REQUEST_SCHEDULER_MAX_KEY)) {
+        return 0;
+    }
+    for (size_t i = 0; i < client->pipeline_origin_count; i++) {
+        if (strcmp(client->pipeline_origins[i].origin, origin) == 0) {
+            return client->pipeline_origins[i].depth;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Answer a client's GET requests from a cache when possible
+ */
+void httpmorph_client_set_cache(httpmorph_client_t *client, httpmorph_cache_t *cache) {
+    if (!client || client->http_cache == cache) {
+        return;
+    }
+    http_cache_retain(cache);
+    httpmorph_cache_destroy(client->http_cache);
+    httpmorph_proxy_set_destroy(client->proxy_set);
+    client->http_cache = cache;
+}
+
+/**
+ * Route requests without their own proxy through a proxy set
+ */
+void httpmorph_client_set_proxy_set(httpmorph_client_t *client, httpmorph_proxy_set_t *set) {
+    if (!client || client->proxy_set == set) {
+        return;
+    }
+    proxy_set_retain(set);
+    httpmorph_proxy_set_destroy(client->proxy_set);
+    client->proxy_set = set;
+}
+
 /**
  * Load CA certificates from a file
  */
@@ -268,11 +411,82 @@ int httpmorph_client_load_ca_file(httpmorph_client_t *client, const char *ca_fil
         return -1;
     }
 
-    /* Load CA file */
-    if (SSL_CTX_load_verify_locations(client->ssl_ctx, ca_file, NULL) != 1) {
+    /* Contexts are shared, so switch to the one trusting this file */
+    char *copy = strdup(ca_file);
+    if (!copy) {
+        return -1;
+    }
+    SSL_CTX *ctx = client_ssl_ctx_acquire(client->browser_profile, copy);
+    if (!ctx) {
+        free(copy);
+        return -1;
+    }
+
+    ssl_ctx_cache_release(client->ssl_ctx);
+    client->ssl_ctx = ctx;
+    client_release_variants(client);
+    free(client->ca_file);
+    client->ca_file = copy;
+    return 0;
+}
+
+/**
+ * Switch a client to another browser profile
+ */
+int httpmorph_client_set_browser_profile(httpmorph_client_t *client,
+                                         const browser_profile_t *profile) {
+    if (!client || !profile) {
+        return -1;
+    }
+    if (profile == client->browser_profile) {
+        return 0;
+    }
+
+    SSL_CTX *ctx = client_ssl_ctx_acquire(profile, client->ca_file);
+    if (!ctx) {
+        return -1;
+    }
+    ssl_ctx_cache_release(client->ssl_ctx);
+    client->ssl_ctx = ctx;
+    client->browser_profile = profile;
+    client_release_variants(client);
+    return 0;
+}
+
+/**
+ * Get one of the client profile's fingerprint variants and its SSL context
+ * Concurrent first uses may both acquire; the loser releases its copy.
+ */
+int httpmorph_client_variant(httpmorph_client_t *client, unsigned int index,
+                             const browser_profile_t **profile, SSL_CTX **ssl_ctx) {
+    if (!client || !profile || !ssl_ctx) {
         return -1;
     }
 
+    index %= BROWSER_PROFILE_VARIANTS;
+    const browser_profile_t *variant = browser_profile_variant(client->browser_profile, index);
+    if (index == 0 || variant == client->browser_profile) {
+        *profile = client->browser_profile;
+        *ssl_ctx = client->ssl_ctx;
+        return 0;
+    }
+
+    SSL_CTX *ctx = CLIENT_LOAD_PTR(&client->variant_ctx[index]);
+    if (!ctx) {
+        SSL_CTX *fresh = client_ssl_ctx_acquire(variant, client->ca_file);
+        if (!fresh) {
+            return -1;
+        }
+        if (CLIENT_CAS_PTR(&client->variant_ctx[index], ctx, fresh)) {
+            ctx = fresh;
+        } else {
+            ssl_ctx_cache_release(fresh);
+            ctx = CLIENT_LOAD_PTR(&client->variant_ctx[index]);
+        }
+    }
+
+    *profile = variant;
+    *ssl_ctx = ctx;
     return 0;
 }
 
@@ -286,6 +500,224 @@ httpmorph_pool_t* httpmorph_client_get_pool(httpmorph_client_t *client) {
     return client->pool;
 }
 
+/**
+ * Get TLS session resumption statistics
+ */
+int httpmorph_client_get_tls_session_stats(httpmorph_client_t *client,
+                                           httpmorph_tls_session_stats_t *stats) {
+    if (!client || !client->session_cache || !stats) {
+        return -1;
+    }
+
+    tls_session_cache_stats_t cache_stats;
+    tls_session_cache_stats(client->session_cache, &cache_stats);
+
+    stats->hits = cache_stats.hits;
+    stats->misses = cache_stats.misses;
+    stats->stores = cache_stats.stores;
+    stats->evictions = cache_stats.evictions;
+    stats->expirations = cache_stats.expirations;
+    stats->resumptions = cache_stats.resumptions;
+    stats->entries = cache_stats.entries;
+    return 0;
+}
+
+/**
+ * Drop all cached TLS sessions
+ */
+void httpmorph_client_clear_tls_sessions(httpmorph_client_t *client) {
+    if (!client) {
+        return;
+    }
+    tls_session_cache_clear(client->session_cache);
+}
+
+/**
+ * Find an alternative service an origin advertised
+ */
+int httpmorph_client_get_alt_svc(httpmorph_client_t *client, const char *url,
+                                 const char *protocol, char *host, size_t host_size,
+                                 uint16_t *port) {
+    if (!client || !url || !protocol) {
+        return -1;
+    }
+
+    alt_svc_entry_t entry;
+    uint64_t now_s = httpmorph_get_time_us() / 1000000;
+    if (!alt_svc_cache_lookup(client->alt_svc, url, protocol, now_s, &entry)) {
+        return -1;
+    }
+    if (host && host_size > 0) {
+        if (strlen(entry.host) >= host_size) {
+            return -1;
+        }
+        strcpy(host, entry.host);
+    }
+    if (port) {
+        *port = entry.port;
+    }
+    return 0;
+}
+
+/**
+ * Report that an origin's alternative service didn't work
+ */
+void httpmorph_client_mark_alt_svc_broken(httpmorph_client_t *client, const char *url) {
+    if (!client) {
+        return;
+    }
+    alt_svc_cache_mark_broken(client->alt_svc, url, httpmorph_get_time_us() / 1000000);
+}
+
+/**
+ * Forget all advertised alternative services
+ */
+void httpmorph_client_clear_alt_svc(httpmorph_client_t *client) {
+    if (!client) {
+        return;
+    }
+    alt_svc_cache_clear(client->alt_svc);
+}
+
+/**
+ * Replace the response buffer pool
+ */
+int httpmorph_client_configure_buffer_pool(httpmorph_client_t *client,
+                                           const httpmorph_buffer_pool_config_t *config) {
+    if (!client || !config || config->num_tiers > BUFFER_POOL_MAX_TIERS) {
+        return -1;
+    }
+
+    /* Responses hold buffers from the current pool once it has been used */
+    size_t hits = 0, misses = 0, returns = 0;
+    buffer_pool_stats(client->buffer_pool, &hits, &misses, &returns);
+    if (hits + misses > 0) {
+        return -1;
+    }
+
+    buffer_pool_config_t pool_config;
+    memset(&pool_config, 0, sizeof(pool_config));
+    for (int i = 0; i < config->num_tiers; i++) {
+        pool_config.tier_sizes[i] = config->tier_sizes[i];
+        pool_config.tier_capacity[i] = config->tier_capacity[i];
+    }
+    pool_config.num_tiers = config->num_tiers;
+    pool_config.magazine_size = config->magazine_size;
+    pool_config.mmap_threshold = config->mmap_threshold;
+
+    httpmorph_buffer_pool_t *pool = buffer_pool_create_with_config(&pool_config);
+    if (!pool) {
+        return -1;
+    }
+
+    buffer_pool_destroy(client->buffer_pool);
+    client->buffer_pool = pool;
+    return 0;
+}
+
+/**
+ * Get response buffer pool statistics per tier
+ */
+int httpmorph_client_get_buffer_pool_stats(httpmorph_client_t *client,
+                                           httpmorph_buffer_tier_stats_t *stats,
+                                           int max_tiers) {
+    if (!client || !client->buffer_pool) {
+        return -1;
+    }
+
+    int num_tiers = buffer_pool_tier_count(client->buffer_pool);
+    for (int i = 0; stats && i < num_tiers && i < max_tiers; i++) {
+        buffer_tier_stats_t tier_stats;
+        if (buffer_pool_tier_stats(client->buffer_pool, i, &tier_stats) != 0) {
+            return -1;
+        }
+        stats[i].buffer_size = tier_stats.buffer_size;
+        stats[i].mmap_backed = tier_stats.mmap_backed;
+        stats[i].hits = tier_stats.hits;
+        stats[i].magazine_hits = tier_stats.magazine_hits;
+        stats[i].misses = tier_stats.misses;
+        stats[i].returns = tier_stats.returns;
+        stats[i].pooled = tier_stats.depot_count;
+    }
+    return num_tiers;
+}
+
+/**
+ * Enable per-request arenas
+ */
+int httpmorph_client_enable_request_arenas(httpmorph_client_t *client, size_t max_cached) {
+    if (!client) {
+        return -1;
+    }
+
+    httpmorph_arena_pool_t *pool = NULL;
+    if (max_cached > 0) {
+        pool = arena_pool_create(max_cached);
+        if (!pool) {
+            return -1;
+        }
+    }
+
+    /* Arenas still held by requests keep the old pool alive */
+    arena_pool_release(client->arena_pool);
+    client->arena_pool = pool;
+    return 0;
+}
+
+/**
+ * Get request arena statistics
+ */
+int httpmorph_client_get_arena_stats(httpmorph_client_t *client,
+                                     httpmorph_arena_stats_t *stats) {
+    if (!client || !client->arena_pool || !stats) {
+        return -1;
+    }
+
+    arena_pool_stats_t pool_stats;
+    arena_pool_stats(client->arena_pool, &pool_stats);
+    stats->reused = pool_stats.reused;
+    stats->created = pool_stats.created;
+    stats->cached = pool_stats.cached;
+    return 0;
+}
+
+/**
+ * Get client-wide request metrics
+ */
+int httpmorph_client_get_metrics(httpmorph_client_t *client, httpmorph_metrics_t *metrics) {
+    if (!client || !metrics) {
+        return -1;
+    }
+
+    metrics_get(client->metrics, metrics);
+    pool_stats_t pool_stats;
+    pool_get_stats(client->pool, &pool_stats);
+    metrics->pool_idle = pool_stats.idle;
+    metrics->pool_active = pool_stats.active;
+    return 0;
+}
+
+/**
+ * Get request metrics per origin
+ */
+int httpmorph_client_get_origin_metrics(httpmorph_client_t *client,
+                                        httpmorph_origin_metrics_t *origins,
+                                        int max_origins) {
+    if (!client) {
+        return -1;
+    }
+    return metrics_get_origins(client->metrics, origins, max_origins);
+}
+
+/**
+ * Zero a client's request metrics
+ */
+void httpmorph_client_reset_metrics(httpmorph_client_t *client) {
+    if (client) {
+        metrics_reset(client->metrics);
+    }
+}
+
 /**
  * Destroy an HTTP client
  */
@@ -294,13 +726,27 @@ void httpmorph_client_destroy(httpmorph_client_t *client) {
         return;
     }
 
-    if (client->ssl_ctx) {
-        SSL_CTX_free(client->ssl_ctx);
-    }
+    /* Pooled connections keep their own references to the context and
+     * the session cache; tickets they receive afterwards are dropped */
+    ssl_ctx_cache_release(client->ssl_ctx);
+    client_release_variants(client);
+    tls_session_cache_destroy(client->session_cache);
+    alt_svc_cache_destroy(client->alt_svc);
+    metrics_destroy(client->metrics);
+    free(client->ca_file);
 
     if (client->buffer_pool) {
         buffer_pool_destroy(client->buffer_pool);
     }
 
+    arena_pool_release(client->arena_pool);
+    httpmorph_cache_destroy(client->http_cache);
+    httpmorph_proxy_set_destroy(client->proxy_set);
+
+    for (size_t i = 0; i < client->pipeline_origin_count; i++) {
+        free(client->pipeline_origins[i].origin);
+    }
+    free(client->pipeline_origins);
+
     free(client);
 }
@@ -1,141 +1,494 @@
 /**
  * compression.c - Content decompression
+ *
+ * Bodies are decoded incrementally as they arrive: the HTTP/1.1 and HTTP/2
+ * readers feed each received piece to a decoder, which inflates it into a
+ * pooled scratch buffer and hands the output on. Brotli and zstd are
+ * available when built with HAVE_BROTLI / HAVE_ZSTD.
  */
 
 #include "internal/compression.h"
 #include "buffer_pool.h"
 #include <zlib.h>
 
+#ifdef HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/* Scratch buffer sizes (both are pool tiers) */
+#define DECODER_OUTPUT_SIZE  BUFFER_SIZE_64KB
+#define DECODER_INPUT_SIZE   BUFFER_SIZE_16KB
+
+struct httpmorph_decoder {
+    httpmorph_encoding_t encoding;
+    httpmorph_buffer_pool_t *pool;
+
+    uint8_t *out;              /* Decoded output scratch */
+    size_t out_actual;
+    uint8_t *in;               /* Optional input staging (lazy) */
+    size_t in_actual;
+
+    bool started;              /* Backend initialized */
+    bool stream_end;           /* Compressed stream completed */
+
+    z_stream zs;
+#ifdef HAVE_BROTLI
+    BrotliDecoderState *br;
+#endif
+#ifdef HAVE_ZSTD
+    ZSTD_DStream *zstd;
+#endif
+};
+
+/* Helper: Get a scratch buffer from the pool or the heap */
+static uint8_t* decoder_buffer_get(httpmorph_buffer_pool_t *pool, size_t size, size_t *actual) {
+    if (pool) {
+        return buffer_pool_get(pool, size, actual);
+    }
+    *actual = size;
+    return malloc(size);
+}
+
+/* Helper: Release a buffer from decoder_buffer_get() */
+static void decoder_buffer_put(httpmorph_buffer_pool_t *pool, uint8_t *buf, size_t actual) {
+    if (!buf) {
+        return;
+    }
+    if (pool) {
+        buffer_pool_put(pool, buf, actual);
+    } else {
+        free(buf);
+    }
+}
+
 /**
- * Internal helper to decompress data using zlib
+ * Map a Content-Encoding header value to a coding
  */
-static int decompress_zlib(httpmorph_response_t *response, int windowBits) {
-    if (!response || !response->body || response->body_len == 0) {
-        return -1;
+httpmorph_encoding_t httpmorph_encoding_from_header(const char *value) {
+    if (!value) {
+        return HTTPMORPH_ENCODING_IDENTITY;
     }
 
-    /* Allocate decompressed buffer (assume 10x compression ratio) */
-    size_t decompressed_capacity = response->body_len * 10;
-    if (decompressed_capacity < 16384) decompressed_capacity = 16384;
+    /* Trim surrounding whitespace */
+    while (*value == ' ' || *value == '\t') value++;
+    size_t len = strlen(value);
+    while (len > 0 && (value[len - 1] == ' ' || value[len - 1] == '\t')) len--;
 
-    /* Get buffer from pool if available, otherwise malloc */
-    uint8_t *decompressed = NULL;
-    size_t decompressed_actual_size = 0;
-    if (response->_buffer_pool) {
-        decompressed = buffer_pool_get((httpmorph_buffer_pool_t*)response->_buffer_pool,
-                                      decompressed_capacity, &decompressed_actual_size);
-    } else {
-        decompressed = malloc(decompressed_capacity);
-        decompressed_actual_size = decompressed_capacity;
+    if (len == 0 || (len == 8 && strncasecmp(value, "identity", 8) == 0)) {
+        return HTTPMORPH_ENCODING_IDENTITY;
+    }
+    if ((len == 4 && strncasecmp(value, "gzip", 4) == 0) ||
+        (len == 6 && strncasecmp(value, "x-gzip", 6) == 0)) {
+        return HTTPMORPH_ENCODING_GZIP;
+    }
+    if (len == 7 && strncasecmp(value, "deflate", 7) == 0) {
+        return HTTPMORPH_ENCODING_DEFLATE;
+    }
+    if (len == 2 && strncasecmp(value, "br", 2) == 0) {
+        return HTTPMORPH_ENCODING_BROTLI;
+    }
+    if (len == 4 && strncasecmp(value, "zstd", 4) == 0) {
+        return HTTPMORPH_ENCODING_ZSTD;
     }
 
-    if (!decompressed) {
-        return -1;
+    /* Stacked codings ("gzip, br") and anything else are passed through */
+    return HTTPMORPH_ENCODING_UNKNOWN;
+}
+
+/* Helper: Create a decoder for a known coding */
+static httpmorph_decoder_t* decoder_create(httpmorph_encoding_t encoding,
+                                           httpmorph_buffer_pool_t *pool) {
+    switch (encoding) {
+        case HTTPMORPH_ENCODING_GZIP:
+        case HTTPMORPH_ENCODING_DEFLATE:
+            break;
+#ifdef HAVE_BROTLI
+        case HTTPMORPH_ENCODING_BROTLI:
+            break;
+#endif
+#ifdef HAVE_ZSTD
+        case HTTPMORPH_ENCODING_ZSTD:
+            break;
+#endif
+        default:
+            return NULL;
+    }
+
+    httpmorph_decoder_t *decoder = calloc(1, sizeof(httpmorph_decoder_t));
+    if (!decoder) {
+        return NULL;
+    }
+
+    decoder->encoding = encoding;
+    decoder->pool = pool;
+    decoder->out = decoder_buffer_get(pool, DECODER_OUTPUT_SIZE, &decoder->out_actual);
+    if (!decoder->out) {
+        free(decoder);
+        return NULL;
+    }
+
+    /* zlib waits for the first bytes to tell zlib-wrapped from raw deflate */
+#ifdef HAVE_BROTLI
+    if (encoding == HTTPMORPH_ENCODING_BROTLI) {
+        decoder->br = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+        decoder->started = decoder->br != NULL;
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (encoding == HTTPMORPH_ENCODING_ZSTD) {
+        decoder->zstd = ZSTD_createDStream();
+        decoder->started = decoder->zstd && !ZSTD_isError(ZSTD_initDStream(decoder->zstd));
+    }
+#endif
+    if ((encoding == HTTPMORPH_ENCODING_BROTLI || encoding == HTTPMORPH_ENCODING_ZSTD) &&
+        !decoder->started) {
+        httpmorph_decoder_destroy(decoder);
+        return NULL;
     }
 
-    /* Initialize zlib */
-    z_stream stream;
-    memset(&stream, 0, sizeof(stream));
-    stream.next_in = response->body;
-    stream.avail_in = (uInt)response->body_len;
-    stream.next_out = decompressed;
-    stream.avail_out = (uInt)decompressed_capacity;
+    return decoder;
+}
+
+/**
+ * Create a decoder for a Content-Encoding header value
+ */
+httpmorph_decoder_t* httpmorph_decoder_create(const char *content_encoding,
+                                              httpmorph_buffer_pool_t *buffer_pool) {
+    return decoder_create(httpmorph_encoding_from_header(content_encoding), buffer_pool);
+}
 
-    int ret = inflateInit2(&stream, windowBits);
-    if (ret != Z_OK) {
-        free(decompressed);
+/**
+ * Get the decoder's input staging buffer
+ */
+uint8_t* httpmorph_decoder_input_buffer(httpmorph_decoder_t *decoder, size_t *size) {
+    if (!decoder->in) {
+        decoder->in = decoder_buffer_get(decoder->pool, DECODER_INPUT_SIZE, &decoder->in_actual);
+        if (!decoder->in) {
+            *size = 0;
+            return NULL;
+        }
+    }
+    *size = DECODER_INPUT_SIZE;
+    return decoder->in;
+}
+
+/* Helper: Start zlib once the first compressed bytes are known */
+static int decoder_zlib_start(httpmorph_decoder_t *decoder, const uint8_t *data, size_t len) {
+    int window_bits;
+
+    if (decoder->encoding == HTTPMORPH_ENCODING_GZIP) {
+        window_bits = 15 + 32;  /* gzip, or zlib from servers that mislabel it */
+    } else {
+        /* "deflate" should be zlib-wrapped (RFC 9110) but raw deflate is common */
+        bool zlib_header = (data[0] & 0x0f) == 8 && (data[0] >> 4) <= 7 &&
+                           (len < 2 || ((data[0] << 8) | data[1]) % 31 == 0);
+        window_bits = zlib_header ? 15 : -15;
+    }
+
+    if (inflateInit2(&decoder->zs, window_bits) != Z_OK) {
         return -1;
     }
+    decoder->started = true;
+    return 0;
+}
+
+/* Helper: zlib backend */
+static int decoder_zlib_write(httpmorph_decoder_t *decoder, const uint8_t *data, size_t len,
+                              httpmorph_decoder_output_t output, void *ctx) {
+    z_stream *zs = &decoder->zs;
 
-    /* Decompress */
-    ret = inflate(&stream, Z_FINISH);
-
-    /* Handle need for more output space */
-    while (ret == Z_BUF_ERROR || ret == Z_OK) {
-        /* Check for integer overflow before doubling */
-        if (decompressed_capacity > SIZE_MAX / 2) {
-            /* Would overflow - fail decompression */
-            inflateEnd(&stream);
-            if (response->_buffer_pool) {
-                buffer_pool_put((httpmorph_buffer_pool_t*)response->_buffer_pool,
-                              decompressed, decompressed_actual_size);
-            } else {
-                free(decompressed);
+    while (len > 0) {
+        if (decoder->stream_end) {
+            /* gzip bodies may hold several members; ignore trailing junk otherwise */
+            if (decoder->encoding != HTTPMORPH_ENCODING_GZIP || data[0] != 0x1f) {
+                return 0;
             }
-            return -1;
+            if (inflateReset(zs) != Z_OK) {
+                return -1;
+            }
+            decoder->stream_end = false;
         }
 
-        size_t new_capacity = decompressed_capacity * 2;
-        size_t new_actual_size = 0;
-        uint8_t *new_decompressed = NULL;
-
-        /* Get new buffer from pool if available */
-        if (response->_buffer_pool) {
-            new_decompressed = buffer_pool_get((httpmorph_buffer_pool_t*)response->_buffer_pool,
-                                              new_capacity, &new_actual_size);
-            if (new_decompressed) {
-                /* Copy existing data to new buffer */
-                memcpy(new_decompressed, decompressed, decompressed_capacity);
-                /* Return old buffer to pool */
-                buffer_pool_put((httpmorph_buffer_pool_t*)response->_buffer_pool,
-                              decompressed, decompressed_actual_size);
+        uInt piece = len > UINT_MAX ? UINT_MAX : (uInt)len;
+        zs->next_in = (Bytef *)data;
+        zs->avail_in = piece;
+
+        int ret;
+        do {
+            zs->next_out = decoder->out;
+            zs->avail_out = DECODER_OUTPUT_SIZE;
+
+            ret = inflate(zs, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                return -1;
+            }
+
+            size_t produced = DECODER_OUTPUT_SIZE - zs->avail_out;
+            if (produced > 0 && output(ctx, decoder->out, produced) != 0) {
+                return -1;
             }
-        } else {
-            new_decompressed = realloc(decompressed, new_capacity);
-            new_actual_size = new_capacity;
-        }
-
-        if (!new_decompressed) {
-            inflateEnd(&stream);
-            /* Return buffer to pool or free */
-            if (response->_buffer_pool) {
-                buffer_pool_put((httpmorph_buffer_pool_t*)response->_buffer_pool,
-                              decompressed, decompressed_actual_size);
-            } else {
-                free(decompressed);
+            if (ret == Z_BUF_ERROR && produced == 0) {
+                break;  /* No progress possible without more input */
             }
+        } while (ret != Z_STREAM_END && (zs->avail_in > 0 || zs->avail_out == 0));
+
+        size_t consumed = piece - zs->avail_in;
+        data += consumed;
+        len -= consumed;
+
+        if (ret == Z_STREAM_END) {
+            decoder->stream_end = true;
+        } else if (consumed == 0) {
+            break;
+        }
+    }
+
+    return 0;
+}
+
+#ifdef HAVE_BROTLI
+/* Helper: brotli backend */
+static int decoder_brotli_write(httpmorph_decoder_t *decoder, const uint8_t *data, size_t len,
+                                httpmorph_decoder_output_t output, void *ctx) {
+    size_t avail_in = len;
+    const uint8_t *next_in = data;
+
+    for (;;) {
+        size_t avail_out = DECODER_OUTPUT_SIZE;
+        uint8_t *next_out = decoder->out;
+
+        BrotliDecoderResult ret = BrotliDecoderDecompressStream(decoder->br, &avail_in, &next_in,
+                                                                &avail_out, &next_out, NULL);
+        if (ret == BROTLI_DECODER_RESULT_ERROR) {
             return -1;
         }
 
-        decompressed = new_decompressed;
-        decompressed_actual_size = new_actual_size;
-        stream.next_out = decompressed + decompressed_capacity;
-        stream.avail_out = (uInt)(new_capacity - decompressed_capacity);
-        decompressed_capacity = new_capacity;
+        size_t produced = DECODER_OUTPUT_SIZE - avail_out;
+        if (produced > 0 && output(ctx, decoder->out, produced) != 0) {
+            return -1;
+        }
 
-        ret = inflate(&stream, Z_FINISH);
+        if (ret == BROTLI_DECODER_RESULT_SUCCESS) {
+            decoder->stream_end = true;
+            return 0;
+        }
+        if (ret == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT) {
+            return 0;
+        }
+        /* BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT - go round again */
     }
+}
+#endif
+
+#ifdef HAVE_ZSTD
+/* Helper: zstd backend */
+static int decoder_zstd_write(httpmorph_decoder_t *decoder, const uint8_t *data, size_t len,
+                              httpmorph_decoder_output_t output, void *ctx) {
+    ZSTD_inBuffer in = { data, len, 0 };
+
+    for (;;) {
+        ZSTD_outBuffer out = { decoder->out, DECODER_OUTPUT_SIZE, 0 };
+
+        size_t ret = ZSTD_decompressStream(decoder->zstd, &out, &in);
+        if (ZSTD_isError(ret)) {
+            return -1;
+        }
+
+        if (out.pos > 0 && output(ctx, decoder->out, out.pos) != 0) {
+            return -1;
+        }
+
+        /* 0 means a frame ended and everything was flushed; more frames may follow */
+        decoder->stream_end = (ret == 0);
 
-    if (ret != Z_STREAM_END) {
-        inflateEnd(&stream);
-        /* Return buffer to pool or free */
-        if (response->_buffer_pool) {
-            buffer_pool_put((httpmorph_buffer_pool_t*)response->_buffer_pool,
-                          decompressed, decompressed_actual_size);
-        } else {
-            free(decompressed);
+        if (in.pos == in.size && (ret == 0 || out.pos < out.size)) {
+            return 0;
         }
+    }
+}
+#endif
+
+/**
+ * Decode a chunk of compressed input
+ */
+int httpmorph_decoder_write(httpmorph_decoder_t *decoder, const uint8_t *data, size_t len,
+                            httpmorph_decoder_output_t output, void *ctx) {
+    if (!decoder || !output) {
+        return -1;
+    }
+    if (len == 0) {
+        return 0;
+    }
+
+    switch (decoder->encoding) {
+        case HTTPMORPH_ENCODING_GZIP:
+        case HTTPMORPH_ENCODING_DEFLATE:
+            if (!decoder->started && decoder_zlib_start(decoder, data, len) != 0) {
+                return -1;
+            }
+            return decoder_zlib_write(decoder, data, len, output, ctx);
+#ifdef HAVE_BROTLI
+        case HTTPMORPH_ENCODING_BROTLI:
+            return decoder_brotli_write(decoder, data, len, output, ctx);
+#endif
+#ifdef HAVE_ZSTD
+        case HTTPMORPH_ENCODING_ZSTD:
+            return decoder_zstd_write(decoder, data, len, output, ctx);
+#endif
+        default:
+            return -1;
+    }
+}
+
+/**
+ * Check that the compressed stream ended cleanly
+ */
+int httpmorph_decoder_finish(httpmorph_decoder_t *decoder,
+                             httpmorph_decoder_output_t output, void *ctx) {
+    if (!decoder) {
         return -1;
     }
 
-    size_t decompressed_size = stream.total_out;
-    inflateEnd(&stream);
+#ifdef HAVE_ZSTD
+    /* zstd may hold back the end of a frame until called again with no input */
+    while (decoder->encoding == HTTPMORPH_ENCODING_ZSTD && decoder->started &&
+           !decoder->stream_end) {
+        ZSTD_inBuffer in = { NULL, 0, 0 };
+        ZSTD_outBuffer out = { decoder->out, DECODER_OUTPUT_SIZE, 0 };
 
-    /* Replace compressed body with decompressed */
-    /* Return old buffer to pool if available, otherwise free */
-    if (response->body) {
-        if (response->_buffer_pool) {
-            buffer_pool_put((httpmorph_buffer_pool_t*)response->_buffer_pool,
-                          response->body, response->_body_actual_size);
-        } else {
-            free(response->body);
+        size_t ret = ZSTD_decompressStream(decoder->zstd, &out, &in);
+        if (ZSTD_isError(ret)) {
+            return -1;
+        }
+        if (out.pos > 0 && output(ctx, decoder->out, out.pos) != 0) {
+            return -1;
+        }
+        decoder->stream_end = (ret == 0);
+        if (!decoder->stream_end && out.pos == 0) {
+            break;  /* Truncated */
+        }
+    }
+#else
+    (void)output;
+    (void)ctx;
+#endif
+
+    /* zlib and brotli flush as far as their input allows on each write */
+    return decoder->stream_end ? 0 : -1;
+}
+
+/**
+ * Destroy a decoder and return its buffers to the pool
+ */
+void httpmorph_decoder_destroy(httpmorph_decoder_t *decoder) {
+    if (!decoder) {
+        return;
+    }
+
+    if ((decoder->encoding == HTTPMORPH_ENCODING_GZIP ||
+         decoder->encoding == HTTPMORPH_ENCODING_DEFLATE) && decoder->started) {
+        inflateEnd(&decoder->zs);
+    }
+#ifdef HAVE_BROTLI
+    if (decoder->br) {
+        BrotliDecoderDestroyInstance(decoder->br);
+    }
+#endif
+#ifdef HAVE_ZSTD
+    if (decoder->zstd) {
+        ZSTD_freeDStream(decoder->zstd);
+    }
+#endif
+
+    decoder_buffer_put(decoder->pool, decoder->out, decoder->out_actual);
+    decoder_buffer_put(decoder->pool, decoder->in, decoder->in_actual);
+    free(decoder);
+}
+
+/**
+ * Growing output buffer for decoding a fully buffered body
+ */
+typedef struct {
+    httpmorph_buffer_pool_t *pool;
+    uint8_t *buf;
+    size_t len;
+    size_t capacity;
+    size_t actual_size;
+} decode_target_t;
+
+/* Helper: Decoder output that appends to a decode_target_t */
+static int decode_target_append(void *ctx, const uint8_t *data, size_t len) {
+    decode_target_t *target = (decode_target_t *)ctx;
+
+    if (len > target->capacity - target->len) {
+        if (target->capacity > SIZE_MAX / 2 || len > SIZE_MAX / 2 - target->len) {
+            return -1;
+        }
+        size_t new_capacity = target->capacity * 2;
+        if (new_capacity < target->len + len) {
+            new_capacity = target->len + len;
+        }
+
+        size_t new_actual = 0;
+        uint8_t *new_buf = decoder_buffer_get(target->pool, new_capacity, &new_actual);
+        if (!new_buf) {
+            return -1;
         }
+        memcpy(new_buf, target->buf, target->len);
+        decoder_buffer_put(target->pool, target->buf, target->actual_size);
+
+        target->buf = new_buf;
+        target->capacity = new_capacity;
+        target->actual_size = new_actual;
+    }
+
+    memcpy(target->buf + target->len, data, len);
+    target->len += len;
+    return 0;
+}
+
+/**
+ * Internal helper to decode a fully buffered body in place
+ */
+static int decompress_body(httpmorph_response_t *response, httpmorph_encoding_t encoding) {
+    if (!response || !response->body || response->body_len == 0) {
+        return -1;
+    }
+
+    httpmorph_buffer_pool_t *pool = (httpmorph_buffer_pool_t*)response->_buffer_pool;
+    httpmorph_decoder_t *decoder = decoder_create(encoding, pool);
+    if (!decoder) {
+        return encoding == HTTPMORPH_ENCODING_UNKNOWN ? 0 : -1;
+    }
+
+    /* Start from a 4x estimate; growth is geometric after that */
+    decode_target_t target = { pool, NULL, 0, 0, 0 };
+    target.capacity = response->body_len < SIZE_MAX / 4 ? response->body_len * 4 : response->body_len;
+    if (target.capacity < 16384) target.capacity = 16384;
+    target.buf = decoder_buffer_get(pool, target.capacity, &target.actual_size);
+
+    if (!target.buf ||
+        httpmorph_decoder_write(decoder, response->body, response->body_len,
+                                decode_target_append, &target) != 0 ||
+        httpmorph_decoder_finish(decoder, decode_target_append, &target) != 0) {
+        httpmorph_decoder_destroy(decoder);
+        decoder_buffer_put(pool, target.buf, target.actual_size);
+        return -1;
     }
+    httpmorph_decoder_destroy(decoder);
+
+    /* Replace compressed body with decompressed */
+    /* Return old buffer to pool if available, otherwise free */
+    decoder_buffer_put(pool, response->body, response->_body_actual_size);
 
-    response->body = decompressed;
-    response->body_len = decompressed_size;
-    response->body_capacity = decompressed_capacity;
-    response->_body_actual_size = decompressed_actual_size;  /* Update actual size (from pool or malloc) */
+    response->body = target.buf;
+    response->body_len = target.len;
+    response->body_capacity = target.capacity;
+    response->_body_actual_size = target.actual_size;  /* Update actual size (from pool or malloc) */
 
     return 0;
 }
@@ -155,26 +508,15 @@ int httpmorph_decompress_gzip(httpmorph_response_t *response) {
         return 0;  /* Not gzipped, nothing to do */
     }
 
-    /* Use inflateInit2 with windowBits=15+16 for gzip */
-    return decompress_zlib(response, 15 + 16);
+    return decompress_body(response, HTTPMORPH_ENCODING_GZIP);
 }
 
 /**
  * Decompress deflate-compressed response body
  */
 int httpmorph_decompress_deflate(httpmorph_response_t *response) {
-    if (!response || !response->body || response->body_len == 0) {
-        return -1;
-    }
-
-    /* Try raw deflate first (windowBits=-15) */
-    int ret = decompress_zlib(response, -15);
-    if (ret != 0) {
-        /* Try zlib-wrapped deflate (windowBits=15) */
-        ret = decompress_zlib(response, 15);
-    }
-
-    return ret;
+    /* Detects zlib-wrapped vs raw deflate from the first bytes */
+    return decompress_body(response, HTTPMORPH_ENCODING_DEFLATE);
 }
 
 /**
@@ -185,27 +527,18 @@ int httpmorph_auto_decompress(httpmorph_response_t *response) {
         return -1;
     }
 
-    /* Get Content-Encoding header */
-    const char *encoding = httpmorph_response_get_header(response, "Content-Encoding");
-    if (!encoding) {
-        return 0;  /* No encoding, nothing to do */
-    }
+    httpmorph_encoding_t encoding = httpmorph_encoding_from_header(
+        httpmorph_response_get_header(response, "Content-Encoding"));
 
-    /* Handle gzip */
-    if (strcasecmp(encoding, "gzip") == 0) {
-        return httpmorph_decompress_gzip(response);
+    /* Identity, or unknown encoding - leave as-is */
+    if (encoding == HTTPMORPH_ENCODING_IDENTITY || encoding == HTTPMORPH_ENCODING_UNKNOWN) {
+        return 0;
     }
-
-    /* Handle deflate */
-    if (strcasecmp(encoding, "deflate") == 0) {
-        return httpmorph_decompress_deflate(response);
+    if (encoding == HTTPMORPH_ENCODING_GZIP) {
+        return httpmorph_decompress_gzip(response);
     }
-
-    /* Handle identity (no compression) */
-    if (strcasecmp(encoding, "identity") == 0) {
+    if (!response->body || response->body_len == 0) {
         return 0;
     }
-
-    /* Unknown encoding - leave as-is */
-    return 0;
+    return decompress_body(response, encoding);
 }
@@ -1,19 +1,23 @@
 /**
  * connection_pool.c - HTTP connection pooling implementation
  *
- * Implements connection reuse for HTTP keep-alive.
+ * Implements connection reuse for HTTP keep-alive. Connections are indexed
+ * by host key in a fixed hash table; each host keeps a LIFO stack of idle
+ * connections so acquire and release are O(1) regardless of origin count.
  */
 
 #include "connection_pool.h"
 #include "internal/network.h"
 #include "internal/tls.h"
 #include "internal/client.h"
+#include "trace.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #ifdef HAVE_NGHTTP2
     #include <nghttp2/nghttp2.h>
+    #include <openssl/x509v3.h>
     #include "http2_session_manager.h"
 #endif
 
@@ -27,10 +31,148 @@
     #include <sys/socket.h>
     #include <fcntl.h>
     #include <errno.h>
+    #include <poll.h>
     #include <pthread.h>
 #endif
 
 #include <openssl/ssl.h>
+#include <openssl/evp.h>
+
+/* Atomic counters (pool-wide limits are checked without a global lock) */
+#ifdef _WIN32
+    #define POOL_ATOMIC_INC(p)  InterlockedIncrement((volatile LONG*)(p))
+    #define POOL_ATOMIC_DEC(p)  InterlockedDecrement((volatile LONG*)(p))
+    #define POOL_ATOMIC_LOAD(p) InterlockedCompareExchange((volatile LONG*)(p), 0, 0)
+    #define POOL_ATOMIC_ADD(p, n) InterlockedExchangeAdd((volatile LONG*)(p), (LONG)(n))
+#else
+    #define POOL_ATOMIC_INC(p)  __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define POOL_ATOMIC_DEC(p)  __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define POOL_ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define POOL_ATOMIC_ADD(p, n) __atomic_add_fetch((p), (n), __ATOMIC_ACQ_REL)
+#endif
+
+/* Background maintenance state (pthread calls map to windows_compat.h on Windows) */
+typedef struct pool_maintenance {
+    httpmorph_pool_t *pool;
+    httpmorph_client_t *client;
+    int interval_ms;
+    bool stop;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} pool_maintenance_t;
+
+/* Host that needs refilling, collected under the bucket lock */
+typedef struct pool_refill {
+    char *hostname;
+    uint16_t port;
+    bool use_tls;
+    int deficit;
+} pool_refill_t;
+
+#ifdef HAVE_NGHTTP2
+/* Cross-origin reuse state of an HTTP/2 connection */
+typedef struct pool_coalesce {
+    struct sockaddr_storage peer;    /* Address the connection is established to */
+    socklen_t peer_len;
+    uint16_t port;
+    bool verified;                   /* Peer certificate was verified */
+
+    pthread_mutex_t mutex;           /* Guards the lists (ORIGIN frames arrive on the reactor) */
+    bool has_origin_set;             /* Server sent ORIGIN; only listed hosts may coalesce */
+    char **origins;                  /* Hosts listed by ORIGIN frames (on this port) */
+    size_t origin_count;
+    char **misdirected;              /* Hosts the server answered with 421 */
+    size_t misdirected_count;
+} pool_coalesce_t;
+#endif
+
+/* === Host Index === */
+
+/**
+ * FNV-1a hash of a host key
+ */
+static uint32_t pool_hash_key(const char *key) {
+    uint32_t h = 2166136261u;
+    while (*key) {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static inline size_t pool_bucket_index(uint32_t hash) {
+    return hash & (POOL_HASH_BUCKETS - 1);
+}
+
+static void pool_bucket_lock(httpmorph_pool_t *pool, size_t index) {
+#ifdef _WIN32
+    EnterCriticalSection(&((CRITICAL_SECTION*)pool->bucket_locks)[index]);
+#else
+    pthread_mutex_lock(&((pthread_mutex_t*)pool->bucket_locks)[index]);
+#endif
+}
+
+static void pool_bucket_unlock(httpmorph_pool_t *pool, size_t index) {
+#ifdef _WIN32
+    LeaveCriticalSection(&((CRITICAL_SECTION*)pool->bucket_locks)[index]);
+#else
+    pthread_mutex_unlock(&((pthread_mutex_t*)pool->bucket_locks)[index]);
+#endif
+}
+
+/**
+ * Find host entry (bucket lock must be held)
+ */
+static pool_host_t* pool_find_host(httpmorph_pool_t *pool, const char *host_key, uint32_t hash) {
+    pool_host_t *host = pool->buckets[pool_bucket_index(hash)];
+    while (host) {
+        if (host->hash == hash && strcmp(host->host_key, host_key) == 0) {
+            return host;
+        }
+        host = host->next;
+    }
+    return NULL;
+}
+
+/**
+ * Find or create host entry (bucket lock must be held)
+ * Host entries live until the pool is destroyed
+ */
+static pool_host_t* pool_intern_host(httpmorph_pool_t *pool, const char *host_key, uint32_t hash) {
+    pool_host_t *host = pool_find_host(pool, host_key, hash);
+    if (host) {
+        return host;
+    }
+
+    host = (pool_host_t*)calloc(1, sizeof(pool_host_t));
+    if (!host) {
+        return NULL;
+    }
+    host->host_key = strdup(host_key);
+    if (!host->host_key) {
+        free(host);
+        return NULL;
+    }
+    host->hash = hash;
+    host->pool = pool;
+
+    size_t index = pool_bucket_index(hash);
+    host->next = pool->buckets[index];
+    pool->buckets[index] = host;
+    return host;
+}
+
+/**
+ * Destroy a chain of connections linked through ->next
+ */
+static void pool_destroy_chain(pooled_connection_t *conn) {
+    while (conn) {
+        pooled_connection_t *next = conn->next;
+        pool_connection_destroy(conn);
+        conn = next;
+    }
+}
 
 /* === Pool Management === */
 
@@ -40,37 +182,40 @@ httpmorph_pool_t* pool_create(void) {
         return NULL;
     }
 
-    pool->connections = NULL;
     pool->total_connections = 0;
     pool->active_connections = 0;
     pool->max_connections_per_host = POOL_MAX_CONNECTIONS_PER_HOST;
     pool->max_total_connections = POOL_MAX_TOTAL_CONNECTIONS;
     pool->idle_timeout_seconds = POOL_IDLE_TIMEOUT_SECONDS;
 
-    /* Initialize mutex for thread safety */
+    /* Initialize one lock per bucket */
 #ifdef _WIN32
-    CRITICAL_SECTION *cs = (CRITICAL_SECTION*)malloc(sizeof(CRITICAL_SECTION));
-    if (cs) {
-        InitializeCriticalSection(cs);
-        pool->mutex = cs;
-    } else {
+    CRITICAL_SECTION *locks = (CRITICAL_SECTION*)calloc(POOL_HASH_BUCKETS, sizeof(CRITICAL_SECTION));
+    if (!locks) {
         free(pool);
         return NULL;
     }
+    for (int i = 0; i < POOL_HASH_BUCKETS; i++) {
+        InitializeCriticalSection(&locks[i]);
+    }
 #else
-    pthread_mutex_t *mutex = (pthread_mutex_t*)malloc(sizeof(pthread_mutex_t));
-    if (mutex) {
-        if (pthread_mutex_init(mutex, NULL) != 0) {
-            free(mutex);
+    pthread_mutex_t *locks = (pthread_mutex_t*)calloc(POOL_HASH_BUCKETS, sizeof(pthread_mutex_t));
+    if (!locks) {
+        free(pool);
+        return NULL;
+    }
+    for (int i = 0; i < POOL_HASH_BUCKETS; i++) {
+        if (pthread_mutex_init(&locks[i], NULL) != 0) {
+            while (--i >= 0) {
+                pthread_mutex_destroy(&locks[i]);
+            }
+            free(locks);
             free(pool);
             return NULL;
         }
-        pool->mutex = mutex;
-    } else {
-        free(pool);
-        return NULL;
     }
 #endif
+    pool->bucket_locks = locks;
 
     return pool;
 }
@@ -80,97 +225,110 @@ void pool_destroy(httpmorph_pool_t *pool) {
         return;
     }
 
-    /* Lock mutex before destroying to prevent concurrent access */
-    void *mutex_ptr = pool->mutex;
-#ifdef _WIN32
-    CRITICAL_SECTION *cs = (CRITICAL_SECTION*)mutex_ptr;
-    if (cs) {
-        EnterCriticalSection(cs);
-    }
-#else
-    pthread_mutex_t *mutex = (pthread_mutex_t*)mutex_ptr;
-    if (mutex) {
-        pthread_mutex_lock(mutex);
-    }
-#endif
-
-    /* Close and free all connections while holding lock
-     * BUT only if they're not still in use (ref_count == 0)
-     * If ref_count > 0, the connection is still being used by another thread
-     * and we should NOT destroy it to avoid use-after-free bugs */
-    pooled_connection_t *conn = pool->connections;
-    while (conn) {
-        pooled_connection_t *next = conn->next;
+    /* Join the maintenance thread before tearing down the index */
+    pool_stop_maintenance(pool);
+
+    for (size_t b = 0; b < POOL_HASH_BUCKETS; b++) {
+        pool_bucket_lock(pool, b);
+
+        pool_host_t *host = pool->buckets[b];
+        while (host) {
+            pool_host_t *next_host = host->next;
+
+            /* Close and free idle connections, BUT only if they're not still
+             * in use (ref_count == 0). If ref_count > 0, another thread is
+             * using it and destroying it would be a use-after-free */
+            pooled_connection_t *conn = host->idle;
+            while (conn) {
+                pooled_connection_t *next = conn->next;
+                if (conn->ref_count == 0) {
+                    pool_connection_destroy(conn);
+                } else {
+                    /* Leak it rather than crash - the OS will clean up on exit */
+                    conn->host = NULL;
+                }
+                conn = next;
+            }
 
-        /* Only destroy if not in use */
-        if (conn->ref_count == 0) {
-            pool_connection_destroy(conn);
+            free(host->hostname);
+            free(host->host_key);
+            free(host);
+            host = next_host;
         }
-        /* If ref_count > 0, leak it rather than crash - the OS will clean up on exit */
+        pool->buckets[b] = NULL;
 
-        conn = next;
+        pool_bucket_unlock(pool, b);
     }
-    pool->connections = NULL;
 
-    /* Unlock before destroying mutex */
 #ifdef _WIN32
-    if (cs) {
-        LeaveCriticalSection(cs);
-        DeleteCriticalSection(cs);
-        free(cs);
+    CRITICAL_SECTION *locks = (CRITICAL_SECTION*)pool->bucket_locks;
+    for (int i = 0; i < POOL_HASH_BUCKETS; i++) {
+        DeleteCriticalSection(&locks[i]);
     }
 #else
-    if (mutex) {
-        pthread_mutex_unlock(mutex);
-        pthread_mutex_destroy(mutex);
-        free(mutex);
+    pthread_mutex_t *locks = (pthread_mutex_t*)pool->bucket_locks;
+    for (int i = 0; i < POOL_HASH_BUCKETS; i++) {
+        pthread_mutex_destroy(&locks[i]);
     }
 #endif
+    free(locks);
 
-    pool->mutex = NULL;
+    pool->bucket_locks = NULL;
     free(pool);
 }
 
-void pool_cleanup_idle(httpmorph_pool_t *pool) {
+void pool_get_stats(httpmorph_pool_t *pool, pool_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
     if (!pool) {
         return;
     }
+    stats->idle = POOL_ATOMIC_LOAD(&pool->total_connections);
+    stats->active = POOL_ATOMIC_LOAD(&pool->active_connections);
+    stats->reaped = POOL_ATOMIC_LOAD(&pool->reaped_connections);
+    stats->refilled = POOL_ATOMIC_LOAD(&pool->refilled_connections);
+    stats->coalesced = POOL_ATOMIC_LOAD(&pool->coalesced_connections);
+}
 
-    /* Lock pool for thread safety */
-#ifdef _WIN32
-    CRITICAL_SECTION *cs = (CRITICAL_SECTION*)pool->mutex;
-    if (cs) EnterCriticalSection(cs);
-#else
-    pthread_mutex_t *mutex = (pthread_mutex_t*)pool->mutex;
-    if (mutex) pthread_mutex_lock(mutex);
-#endif
+void pool_cleanup_idle(httpmorph_pool_t *pool) {
+    if (!pool) {
+        return;
+    }
 
     time_t now = time(NULL);
-    pooled_connection_t **curr = &pool->connections;
 
-    while (*curr) {
-        pooled_connection_t *conn = *curr;
+    for (size_t b = 0; b < POOL_HASH_BUCKETS; b++) {
+        pooled_connection_t *expired = NULL;
 
-        /* Check if connection is idle for too long */
-        if (now - conn->last_used > pool->idle_timeout_seconds) {
-            /* Remove from list */
-            *curr = conn->next;
-            pool->total_connections--;
+        pool_bucket_lock(pool, b);
 
-            /* Close and free */
-            pool_connection_destroy(conn);
-        } else {
-            /* Move to next */
-            curr = &conn->next;
+        for (pool_host_t *host = pool->buckets[b]; host; host = host->next) {
+            /* Stack is ordered newest first, so everything below the first
+             * expired connection has been idle even longer */
+            pooled_connection_t **curr = &host->idle;
+            while (*curr && now - (*curr)->last_used <= pool->idle_timeout_seconds) {
+                curr = &(*curr)->next;
+            }
+            if (!*curr) {
+                continue;
+            }
+
+            pooled_connection_t *tail = *curr;
+            *curr = NULL;
+            while (tail) {
+                pooled_connection_t *next = tail->next;
+                tail->next = expired;
+                expired = tail;
+                host->idle_count--;
+                POOL_ATOMIC_DEC(&pool->total_connections);
+                tail = next;
+            }
         }
-    }
 
-    /* Unlock pool */
-#ifdef _WIN32
-    if (cs) LeaveCriticalSection(cs);
-#else
-    if (mutex) pthread_mutex_unlock(mutex);
-#endif
+        pool_bucket_unlock(pool, b);
+
+        /* Close outside the lock (SSL_free may be slow) */
+        pool_destroy_chain(expired);
+    }
 }
 
 /* === Connection Operations === */
@@ -182,70 +340,62 @@ pooled_connection_t* pool_get_connection(httpmorph_pool_t *pool,
         return NULL;
     }
 
-    /* Lock pool for thread safety */
-#ifdef _WIN32
-    CRITICAL_SECTION *cs = (CRITICAL_SECTION*)pool->mutex;
-    if (cs) EnterCriticalSection(cs);
-#else
-    pthread_mutex_t *mutex = (pthread_mutex_t*)pool->mutex;
-    if (mutex) pthread_mutex_lock(mutex);
-#endif
-
     /* Build host key */
     char host_key[POOL_MAX_HOST_KEY_LEN];
     pool_build_host_key(host, port, host_key);
+    return pool_get_connection_by_key(pool, host_key);
+}
 
-    /* Search for matching connection */
-    pooled_connection_t **curr = &pool->connections;
-    pooled_connection_t *result = NULL;
+pooled_connection_t* pool_get_connection_by_key(httpmorph_pool_t *pool,
+                                               const char *host_key) {
+    if (!pool || !host_key) {
+        return NULL;
+    }
 
-    while (*curr) {
-        pooled_connection_t *conn = *curr;
-
-        if (strcmp(conn->host_key, host_key) == 0) {
-            /* Found matching host - validate it */
-            if (pool_connection_validate(conn)) {
-                /* HTTP/2 connections can be shared (multiplexing) */
-                if (conn->is_http2 && conn->ref_count > 0) {
-                    /* Connection already in use - increment ref_count and share it */
-                    conn->ref_count++;
-                    conn->last_used = time(NULL);
-                    result = conn;
-                    break;
-                }
+    uint32_t hash = pool_hash_key(host_key);
+    size_t index = pool_bucket_index(hash);
 
-                /* For HTTP/1.1 or first use of HTTP/2: remove from pool */
-                *curr = conn->next;
-                pool->total_connections--;
-                pool->active_connections++;
+    pooled_connection_t *result = NULL;
+    pooled_connection_t *dead = NULL;
 
-                /* Update last used time and increment reference count */
-                conn->last_used = time(NULL);
-                conn->ref_count = 1;  /* First reference */
-                conn->next = NULL;
+    pool_bucket_lock(pool, index);
 
-                result = conn;
-                break;
-            } else {
-                /* Connection is dead - remove and destroy it */
-                *curr = conn->next;
-                pool->total_connections--;
-                pool_connection_destroy(conn);
-                /* Continue searching */
-            }
-        } else {
-            /* Move to next */
-            curr = &conn->next;
+    time_t now = time(NULL);
+    pool_host_t *entry = pool_find_host(pool, host_key, hash);
+    while (entry && entry->idle) {
+        /* Pop most recently used connection (warmest socket/TLS state) */
+        pooled_connection_t *conn = entry->idle;
+        entry->idle = conn->next;
+        entry->idle_count--;
+        POOL_ATOMIC_DEC(&pool->total_connections);
+        conn->next = NULL;
+
+        /* Only probe connections idle long enough for the peer to have
+         * closed them; a just-returned socket is trusted */
+        bool usable = pool_connection_validate(conn);
+        if (usable && now - conn->last_used >= POOL_PROBE_IDLE_SECONDS) {
+            usable = pool_connection_probe(conn);
         }
+
+        if (usable) {
+            /* Update last used time and take the first reference */
+            conn->last_used = now;
+            conn->ref_count = 1;
+            conn->state = POOL_CONN_ACTIVE;
+            POOL_ATOMIC_INC(&pool->active_connections);
+            result = conn;
+            break;
+        }
+
+        /* Connection is dead - destroy it after unlocking */
+        conn->next = dead;
+        dead = conn;
     }
 
-    /* Unlock pool */
-#ifdef _WIN32
-    if (cs) LeaveCriticalSection(cs);
-#else
-    if (mutex) pthread_mutex_unlock(mutex);
-#endif
+    pool_bucket_unlock(pool, index);
 
+    HTTPMORPH_PROBE2(pool__get, host_key, result != NULL);
+    pool_destroy_chain(dead);
     return result;
 }
 
@@ -254,82 +404,63 @@ bool pool_put_connection(httpmorph_pool_t *pool, pooled_connection_t *conn) {
         return false;
     }
 
-    /* Lock pool for thread safety */
-#ifdef _WIN32
-    CRITICAL_SECTION *cs = (CRITICAL_SECTION*)pool->mutex;
-    if (cs) EnterCriticalSection(cs);
-#else
-    pthread_mutex_t *mutex = (pthread_mutex_t*)pool->mutex;
-    if (mutex) pthread_mutex_lock(mutex);
-#endif
-
     /* Skip validation on put - we'll validate on get instead.
      * This saves 4 fcntl() system calls per request. */
 
-    bool result = false;
-
     /* Decrement reference count */
+    bool was_active = conn->state == POOL_CONN_ACTIVE;
     if (conn->ref_count > 0) {
         conn->ref_count--;
     }
 
-    /* HTTP/2 connections with remaining references stay in pool (shared) */
+    /* HTTP/2 connections with remaining references stay out (shared) */
     if (conn->is_http2 && conn->ref_count > 0) {
-        /* Connection still in use by other requests - keep it shared */
-        result = true;
-        goto unlock_and_return;
+        HTTPMORPH_PROBE2(pool__put, conn->host_key, 1);
+        return true;
     }
 
-    /* HTTP/1.1 connections or HTTP/2 with no more references: return to pool */
-
-    /* Check if pool is full */
-    if (pool->total_connections >= pool->max_total_connections) {
-        /* Pool is full - close connection (outside lock) */
-        goto unlock_and_destroy;
+    if (was_active) {
+        POOL_ATOMIC_DEC(&pool->active_connections);
     }
 
-    /* Check per-host limit */
-    int host_conn_count = pool_count_connections_for_host(pool, conn->host_key);
-    if (host_conn_count >= pool->max_connections_per_host) {
-        /* Too many connections for this host (outside lock) */
-        goto unlock_and_destroy;
+    /* Reserve a slot against the global limit */
+    if (POOL_ATOMIC_INC(&pool->total_connections) > pool->max_total_connections) {
+        POOL_ATOMIC_DEC(&pool->total_connections);
+        HTTPMORPH_PROBE2(pool__put, conn->host_key, 0);
+        pool_connection_destroy(conn);
+        return false;
     }
 
-    /* Add to pool */
-    conn->last_used = time(NULL);
-    conn->next = pool->connections;
-    pool->connections = conn;
-    pool->total_connections++;
+    size_t index = pool_bucket_index(conn->host_hash);
+    pool_bucket_lock(pool, index);
 
-    if (pool->active_connections > 0) {
-        pool->active_connections--;
+    /* Reuse the cached host entry when the connection came from this pool */
+    pool_host_t *entry = conn->host;
+    if (!entry || entry->pool != pool) {
+        entry = pool_intern_host(pool, conn->host_key, conn->host_hash);
     }
 
-    result = true;
-
-unlock_and_return:
-    /* Unlock pool and return (connection stays in pool) */
-#ifdef _WIN32
-    if (cs) LeaveCriticalSection(cs);
-#else
-    if (mutex) pthread_mutex_unlock(mutex);
-#endif
-    return result;
-
-unlock_and_destroy:
-    /* Unlock pool */
-#ifdef _WIN32
-    if (cs) LeaveCriticalSection(cs);
-#else
-    if (mutex) pthread_mutex_unlock(mutex);
-#endif
-
-    /* Destroy connection if not pooled (outside of lock) */
-    if (!result) {
+    /* Check per-host limit */
+    if (!entry || entry->idle_count >= pool->max_connections_per_host) {
+        pool_bucket_unlock(pool, index);
+        POOL_ATOMIC_DEC(&pool->total_connections);
+        HTTPMORPH_PROBE2(pool__put, conn->host_key, 0);
+        /* Destroy connection if not pooled (outside of lock) */
         pool_connection_destroy(conn);
+        return false;
     }
 
-    return result;
+    /* Push onto idle stack */
+    conn->host = entry;
+    conn->state = POOL_CONN_IDLE;
+    conn->last_used = time(NULL);
+    conn->next = entry->idle;
+    entry->idle = conn;
+    entry->idle_count++;
+
+    pool_bucket_unlock(pool, index);
+    HTTPMORPH_PROBE2(pool__put, conn->host_key, 1);
+    return true;
 }
 
 pooled_connection_t* pool_connection_create(const char *host,
@@ -341,6 +472,20 @@ pooled_connection_t* pool_connection_create(const char *host,
         return NULL;
     }
 
+    /* Build host key */
+    char host_key[POOL_MAX_HOST_KEY_LEN];
+    pool_build_host_key(host, port, host_key);
+    return pool_connection_create_with_key(host_key, sockfd, ssl, is_http2);
+}
+
+pooled_connection_t* pool_connection_create_with_key(const char *host_key,
+                                                    int sockfd,
+                                                    SSL *ssl,
+                                                    bool is_http2) {
+    if (!host_key || sockfd < 0) {
+        return NULL;
+    }
+
     /* Ensure socket is in blocking mode for HTTP/1.1 compatibility
      * (HTTP/2 connections are already non-blocking) */
     if (!is_http2) {
@@ -355,13 +500,16 @@ pooled_connection_t* pool_connection_create(const char *host,
 #endif
     }
 
-    pooled_connection_t *conn = (pooled_connection_t*)calloc(1, sizeof(pooled_connection_t));
+    /* One allocation: the structure with its key after it; calloc leaves
+     * the TLS info, proxy flag and HTTP/2 pointers unset */
+    size_t key_len = strlen(host_key);
+    pooled_connection_t *conn = (pooled_connection_t*)calloc(1, sizeof(pooled_connection_t) + key_len + 1);
     if (!conn) {
         return NULL;
     }
 
-    /* Build host key */
-    pool_build_host_key(host, port, conn->host_key);
+    memcpy(conn->host_key, host_key, key_len + 1);
+    conn->host_hash = pool_hash_key(host_key);
 
     /* Initialize connection */
     conn->sockfd = sockfd;
@@ -372,24 +520,6 @@ pooled_connection_t* pool_connection_create(const char *host,
     conn->state = POOL_CONN_IDLE;
     conn->ref_count = 0;  /* No references yet */
     conn->last_used = time(NULL);
-    conn->next = NULL;
-
-    /* Initialize proxy info fields */
-    conn->is_proxy = false;
-    conn->proxy_url = NULL;
-    conn->target_host = NULL;
-    conn->target_port = 0;
-
-    /* Initialize TLS info fields */
-    conn->ja3_fingerprint = NULL;
-    conn->tls_version = NULL;
-    conn->tls_cipher = NULL;
-
-#ifdef HAVE_NGHTTP2
-    conn->http2_session = NULL;
-    conn->http2_stream_data = NULL;
-    conn->http2_session_manager = NULL;
-#endif
 
     return conn;
 }
@@ -415,31 +545,27 @@ void pool_connection_destroy(pooled_connection_t *conn) {
         conn->http2_session = NULL;
     }
     /* Note: http2_stream_data is managed separately and freed when session ends */
-#endif
 
-    /* Free proxy info */
-    if (conn->proxy_url) {
-        free(conn->proxy_url);
-        conn->proxy_url = NULL;
-    }
-    if (conn->target_host) {
-        free(conn->target_host);
-        conn->target_host = NULL;
+    if (conn->coalesce) {
+        pool_coalesce_t *co = (pool_coalesce_t *)conn->coalesce;
+        for (size_t i = 0; i < co->origin_count; i++) {
+            free(co->origins[i]);
+        }
+        for (size_t i = 0; i < co->misdirected_count; i++) {
+            free(co->misdirected[i]);
+        }
+        free(co->origins);
+        free(co->misdirected);
+        pthread_mutex_destroy(&co->mutex);
+        free(co);
+        conn->coalesce = NULL;
     }
+#endif
 
-    /* Free TLS info */
-    if (conn->ja3_fingerprint) {
-        free(conn->ja3_fingerprint);
-        conn->ja3_fingerprint = NULL;
-    }
-    if (conn->tls_version) {
-        free(conn->tls_version);
-        conn->tls_version = NULL;
-    }
-    if (conn->tls_cipher) {
-        free(conn->tls_cipher);
-        conn->tls_cipher = NULL;
-    }
+    /* TLS info points at static strings */
+    conn->ja3_fingerprint = NULL;
+    conn->tls_version = NULL;
+    conn->tls_cipher = NULL;
 
     /* Close SSL */
     if (conn->ssl) {
@@ -463,6 +589,14 @@ bool pool_connection_validate(pooled_connection_t *conn) {
         return false;
     }
 
+#ifdef HAVE_NGHTTP2
+    /* The reactor notices when a multiplexed connection goes away */
+    if (conn->http2_session_manager &&
+        !http2_session_manager_is_usable((http2_session_manager_t *)conn->http2_session_manager)) {
+        return false;
+    }
+#endif
+
     /* For SSL connections, just check shutdown state */
     if (conn->ssl) {
         int shutdown_state = SSL_get_shutdown(conn->ssl);
@@ -480,6 +614,496 @@ bool pool_connection_validate(pooled_connection_t *conn) {
     return true;
 }
 
+bool pool_connection_probe(pooled_connection_t *conn) {
+    if (!pool_connection_validate(conn)) {
+        return false;
+    }
+
+#ifdef _WIN32
+    fd_set read_fds;
+    struct timeval tv = {0, 0};
+    FD_ZERO(&read_fds);
+    FD_SET((SOCKET)conn->sockfd, &read_fds);
+    int ready = select(0, &read_fds, NULL, NULL, &tv);
+#else
+    struct pollfd pfd;
+    pfd.fd = conn->sockfd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int ready = poll(&pfd, 1, 0);
+    if (ready > 0 && (pfd.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+        conn->is_valid = false;
+        return false;
+    }
+#endif
+
+    if (ready == 0) {
+        return true;  /* Quiet socket - still open */
+    }
+    if (ready < 0) {
+        conn->is_valid = false;
+        return false;
+    }
+
+    /* Readable while idle: EOF or error means the peer closed it */
+    char byte;
+    int n = (int)recv(conn->sockfd, &byte, 1, MSG_PEEK);
+    if (n <= 0) {
+        conn->is_valid = false;
+        return false;
+    }
+
+    /* Pending bytes on an idle TLS connection are usually a post-handshake
+     * NewSessionTicket that the next SSL_read consumes. Plaintext HTTP/1.1
+     * must be quiet between responses, so stray data means desync. */
+    if (!conn->ssl) {
+        conn->is_valid = false;
+        return false;
+    }
+
+    return true;
+}
+
+#ifdef HAVE_NGHTTP2
+/* === HTTP/2 Connection Coalescing === */
+
+/**
+ * Append a host name to a coalescing list (co->mutex must be held)
+ */
+static void pool_coalesce_list_add(char ***list, size_t *count, const char *name, size_t len) {
+    if (*count >= POOL_COALESCE_MAX_NAMES) {
+        return;
+    }
+    for (size_t i = 0; i < *count; i++) {
+        if (strlen((*list)[i]) == len && strncasecmp((*list)[i], name, len) == 0) {
+            return;
+        }
+    }
+
+    char **grown = (char **)realloc(*list, (*count + 1) * sizeof(char *));
+    if (!grown) {
+        return;
+    }
+    *list = grown;
+
+    char *copy = (char *)malloc(len + 1);
+    if (!copy) {
+        return;
+    }
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+    grown[(*count)++] = copy;
+}
+
+/**
+ * Check a coalescing list for a host name (co->mutex must be held)
+ */
+static bool pool_coalesce_list_has(char **list, size_t count, const char *name) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcasecmp(list[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Compare the IP addresses of two socket addresses (ports ignored)
+ */
+static bool pool_addr_equal(const struct sockaddr *a, const struct sockaddr *b) {
+    if (a->sa_family != b->sa_family) {
+        return false;
+    }
+    if (a->sa_family == AF_INET) {
+        return memcmp(&((const struct sockaddr_in *)a)->sin_addr,
+                      &((const struct sockaddr_in *)b)->sin_addr, sizeof(struct in_addr)) == 0;
+    }
+    if (a->sa_family == AF_INET6) {
+        return memcmp(&((const struct sockaddr_in6 *)a)->sin6_addr,
+                      &((const struct sockaddr_in6 *)b)->sin6_addr, sizeof(struct in6_addr)) == 0;
+    }
+    return false;
+}
+
+/**
+ * Check whether a connection may serve another host
+ * Called with the connection's bucket lock held
+ */
+static bool pool_connection_can_coalesce(pooled_connection_t *conn, const char *host, int port,
+                                         const struct addrinfo *addrs, bool verify_ssl) {
+    pool_coalesce_t *co = (pool_coalesce_t *)conn->coalesce;
+    if (!co || !conn->ssl || co->port != port || (verify_ssl && !co->verified)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&co->mutex);
+    bool refused = pool_coalesce_list_has(co->misdirected, co->misdirected_count, host);
+    bool listed = co->has_origin_set && pool_coalesce_list_has(co->origins, co->origin_count, host);
+    bool has_origin_set = co->has_origin_set;
+    pthread_mutex_unlock(&co->mutex);
+
+    if (refused || (has_origin_set && !listed)) {
+        return false;
+    }
+
+    /* Hosts the server lists need no DNS match (RFC 8336 section 2.4) */
+    if (!listed) {
+        bool same_peer = false;
+        for (const struct addrinfo *ai = addrs; ai && !same_peer; ai = ai->ai_next) {
+            same_peer = pool_addr_equal(ai->ai_addr, (const struct sockaddr *)&co->peer);
+        }
+        if (!same_peer) {
+            return false;
+        }
+    }
+
+    /* The certificate must be authoritative for the new host */
+    X509 *cert = SSL_get_peer_certificate(conn->ssl);
+    if (!cert) {
+        return false;
+    }
+    bool covered = X509_check_host(cert, host, strlen(host), 0, NULL) == 1;
+    X509_free(cert);
+
+    return covered && pool_connection_validate(conn);
+}
+
+int pool_connection_enable_coalescing(pooled_connection_t *conn, bool verified) {
+    if (!conn || !conn->is_http2 || !conn->ssl || conn->coalesce) {
+        return -1;
+    }
+
+    pool_coalesce_t *co = (pool_coalesce_t *)calloc(1, sizeof(pool_coalesce_t));
+    if (!co) {
+        return -1;
+    }
+
+    co->peer_len = sizeof(co->peer);
+    if (getpeername(conn->sockfd, (struct sockaddr *)&co->peer, &co->peer_len) != 0) {
+        free(co);
+        return -1;
+    }
+
+    const char *colon = strrchr(conn->host_key, ':');
+    co->port = colon ? (uint16_t)atoi(colon + 1) : 443;
+    co->verified = verified;
+    pthread_mutex_init(&co->mutex, NULL);
+
+    conn->coalesce = co;
+    return 0;
+}
+
+void pool_connection_add_origin(pooled_connection_t *conn, const char *origin, size_t len) {
+    if (!conn || !conn->coalesce || !origin) {
+        return;
+    }
+    pool_coalesce_t *co = (pool_coalesce_t *)conn->coalesce;
+
+    /* ASCII serialization: "https://host[:port]" */
+    static const char scheme[] = "https://";
+    const size_t scheme_len = sizeof(scheme) - 1;
+    bool https = len > scheme_len && strncasecmp(origin, scheme, scheme_len) == 0;
+
+    const char *name = origin + scheme_len;
+    size_t name_len = 0;
+    int origin_port = 443;
+    if (https) {
+        size_t rest = len - scheme_len;
+        while (name_len < rest && name[name_len] != ':' && name[name_len] != '/') {
+            name_len++;
+        }
+        if (name_len < rest && name[name_len] == ':') {
+            origin_port = 0;
+            for (size_t i = name_len + 1; i < rest && name[i] >= '0' && name[i] <= '9'; i++) {
+                origin_port = origin_port * 10 + (name[i] - '0');
+            }
+        }
+    }
+
+    pthread_mutex_lock(&co->mutex);
+    /* Even an ORIGIN frame naming nothing usable defines the origin set */
+    co->has_origin_set = true;
+    if (https && name_len > 0 && origin_port == co->port) {
+        pool_coalesce_list_add(&co->origins, &co->origin_count, name, name_len);
+    }
+    pthread_mutex_unlock(&co->mutex);
+}
+
+void pool_connection_mark_misdirected(pooled_connection_t *conn, const char *host) {
+    if (!conn || !conn->coalesce || !host) {
+        return;
+    }
+    pool_coalesce_t *co = (pool_coalesce_t *)conn->coalesce;
+
+    pthread_mutex_lock(&co->mutex);
+    pool_coalesce_list_add(&co->misdirected, &co->misdirected_count, host, strlen(host));
+    pthread_mutex_unlock(&co->mutex);
+}
+
+bool pool_connection_is_coalesced(const pooled_connection_t *conn, const char *host, int port) {
+    /* Tunnels are keyed by proxy and never coalesced */
+    if (!conn || !host || conn->is_proxy) {
+        return false;
+    }
+
+    char host_key[POOL_MAX_HOST_KEY_LEN];
+    pool_build_host_key(host, port, host_key);
+    return strcmp(conn->host_key, host_key) != 0;
+}
+
+pooled_connection_t* pool_get_coalesced_connection(httpmorph_pool_t *pool,
+                                                   const char *host,
+                                                   int port,
+                                                   bool verify_ssl,
+                                                   uint32_t timeout_ms) {
+    if (!pool || !host || POOL_ATOMIC_LOAD(&pool->total_connections) == 0) {
+        return NULL;
+    }
+
+    int preferred_family = AF_UNSPEC;
+    struct addrinfo *addrs = httpmorph_dns_resolve(host, (uint16_t)port, timeout_ms,
+                                                   &preferred_family, NULL);
+    if (!addrs) {
+        return NULL;
+    }
+
+    pooled_connection_t *result = NULL;
+    time_t now = time(NULL);
+
+    for (size_t b = 0; b < POOL_HASH_BUCKETS && !result; b++) {
+        pool_bucket_lock(pool, b);
+
+        for (pool_host_t *entry = pool->buckets[b]; entry && !result; entry = entry->next) {
+            for (pooled_connection_t **curr = &entry->idle; *curr; curr = &(*curr)->next) {
+                pooled_connection_t *conn = *curr;
+                if (!conn->is_http2 ||
+                    !pool_connection_can_coalesce(conn, host, port, addrs, verify_ssl)) {
+                    continue;
+                }
+
+                /* Check it out exactly as pool_get_connection() would */
+                *curr = conn->next;
+                entry->idle_count--;
+                POOL_ATOMIC_DEC(&pool->total_connections);
+                conn->next = NULL;
+                conn->last_used = now;
+                conn->ref_count = 1;
+                conn->state = POOL_CONN_ACTIVE;
+                POOL_ATOMIC_INC(&pool->active_connections);
+                POOL_ATOMIC_INC(&pool->coalesced_connections);
+                result = conn;
+                break;
+            }
+        }
+
+        pool_bucket_unlock(pool, b);
+    }
+
+    httpmorph_dns_free(addrs);
+    return result;
+}
+#endif /* HAVE_NGHTTP2 */
+
+/* === Background Maintenance === */
+
+void pool_maintain(httpmorph_pool_t *pool, httpmorph_client_t *client) {
+    if (!pool) {
+        return;
+    }
+
+    pool_refill_t *refills = NULL;
+    size_t refill_count = 0;
+    size_t refill_capacity = 0;
+    time_t now = time(NULL);
+
+    for (size_t b = 0; b < POOL_HASH_BUCKETS; b++) {
+        pooled_connection_t *reaped = NULL;
+        int reaped_count = 0;
+
+        pool_bucket_lock(pool, b);
+
+        for (pool_host_t *host = pool->buckets[b]; host; host = host->next) {
+            pooled_connection_t **curr = &host->idle;
+            while (*curr) {
+                pooled_connection_t *conn = *curr;
+                if (now - conn->last_used > pool->idle_timeout_seconds ||
+                    !pool_connection_probe(conn)) {
+                    *curr = conn->next;
+                    conn->next = reaped;
+                    reaped = conn;
+                    reaped_count++;
+                    host->idle_count--;
+                    POOL_ATOMIC_DEC(&pool->total_connections);
+                } else {
+                    curr = &conn->next;
+                }
+            }
+
+            if (client && host->hostname && host->idle_count < host->min_idle) {
+                if (refill_count == refill_capacity) {
+                    size_t new_capacity = refill_capacity ? refill_capacity * 2 : 8;
+                    pool_refill_t *grown = (pool_refill_t*)realloc(refills, new_capacity * sizeof(pool_refill_t));
+                    if (!grown) {
+                        continue;
+                    }
+                    refills = grown;
+                    refill_capacity = new_capacity;
+                }
+                char *hostname = strdup(host->hostname);
+                if (!hostname) {
+                    continue;
+                }
+                refills[refill_count].hostname = hostname;
+                refills[refill_count].port = host->port;
+                refills[refill_count].use_tls = host->use_tls;
+                refills[refill_count].deficit = host->min_idle - host->idle_count;
+                refill_count++;
+            }
+        }
+
+        pool_bucket_unlock(pool, b);
+
+        /* Close outside the lock */
+        pool_destroy_chain(reaped);
+        if (reaped_count > 0) {
+            POOL_ATOMIC_ADD(&pool->reaped_connections, reaped_count);
+        }
+    }
+
+    /* Connect outside all locks; pool_put_connection enforces the limits */
+    for (size_t i = 0; i < refill_count; i++) {
+        int created = pool_prewarm_connections(pool, client, refills[i].hostname,
+                                               refills[i].port, refills[i].use_tls,
+                                               refills[i].deficit);
+        if (created > 0) {
+            POOL_ATOMIC_ADD(&pool->refilled_connections, created);
+        }
+        free(refills[i].hostname);
+    }
+    free(refills);
+}
+
+static void* pool_maintenance_thread(void *arg) {
+    pool_maintenance_t *maint = (pool_maintenance_t*)arg;
+
+    pthread_mutex_lock(&maint->mutex);
+    while (!maint->stop) {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += maint->interval_ms / 1000;
+        deadline.tv_nsec += (long)(maint->interval_ms % 1000) * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec += 1;
+            deadline.tv_nsec -= 1000000000L;
+        }
+
+        /* Sleep until the next pass or until stop is signalled */
+        while (!maint->stop) {
+            if (pthread_cond_timedwait(&maint->cond, &maint->mutex, &deadline) != 0) {
+                break;  /* Timed out */
+            }
+        }
+        if (maint->stop) {
+            break;
+        }
+
+        pthread_mutex_unlock(&maint->mutex);
+        pool_maintain(maint->pool, maint->client);
+        pthread_mutex_lock(&maint->mutex);
+    }
+    pthread_mutex_unlock(&maint->mutex);
+
+    return NULL;
+}
+
+int pool_start_maintenance(httpmorph_pool_t *pool, httpmorph_client_t *client, int interval_ms) {
+    if (!pool || pool->maintenance) {
+        return -1;
+    }
+
+    pool_maintenance_t *maint = (pool_maintenance_t*)calloc(1, sizeof(pool_maintenance_t));
+    if (!maint) {
+        return -1;
+    }
+    maint->pool = pool;
+    maint->client = client;
+    maint->interval_ms = interval_ms > 0 ? interval_ms : POOL_MAINTENANCE_INTERVAL_MS;
+    maint->stop = false;
+
+    if (pthread_mutex_init(&maint->mutex, NULL) != 0) {
+        free(maint);
+        return -1;
+    }
+    if (pthread_cond_init(&maint->cond, NULL) != 0) {
+        pthread_mutex_destroy(&maint->mutex);
+        free(maint);
+        return -1;
+    }
+    if (pthread_create(&maint->thread, NULL, pool_maintenance_thread, maint) != 0) {
+        pthread_cond_destroy(&maint->cond);
+        pthread_mutex_destroy(&maint->mutex);
+        free(maint);
+        return -1;
+    }
+
+    pool->maintenance = maint;
+    return 0;
+}
+
+void pool_stop_maintenance(httpmorph_pool_t *pool) {
+    if (!pool || !pool->maintenance) {
+        return;
+    }
+
+    pool_maintenance_t *maint = (pool_maintenance_t*)pool->maintenance;
+
+    pthread_mutex_lock(&maint->mutex);
+    maint->stop = true;
+    pthread_cond_signal(&maint->cond);
+    pthread_mutex_unlock(&maint->mutex);
+
+    pthread_join(maint->thread, NULL);
+
+    pthread_cond_destroy(&maint->cond);
+    pthread_mutex_destroy(&maint->mutex);
+    free(maint);
+    pool->maintenance = NULL;
+}
+
+int pool_set_min_idle(httpmorph_pool_t *pool, const char *host, int port,
+                      bool use_tls, int min_idle) {
+    if (!pool || !host || port <= 0 || port > 65535 || min_idle < 0) {
+        return -1;
+    }
+    if (min_idle > pool->max_connections_per_host) {
+        min_idle = pool->max_connections_per_host;
+    }
+
+    char host_key[POOL_MAX_HOST_KEY_LEN];
+    pool_build_host_key(host, port, host_key);
+    uint32_t hash = pool_hash_key(host_key);
+    size_t index = pool_bucket_index(hash);
+    int result = -1;
+
+    pool_bucket_lock(pool, index);
+
+    pool_host_t *entry = pool_intern_host(pool, host_key, hash);
+    if (entry) {
+        if (!entry->hostname) {
+            entry->hostname = strdup(host);
+        }
+        if (entry->hostname) {
+            entry->port = (uint16_t)port;
+            entry->use_tls = use_tls;
+            entry->min_idle = min_idle;
+            result = 0;
+        }
+    }
+
+    pool_bucket_unlock(pool, index);
+    return result;
+}
+
 /* === Helper Functions === */
 
 void pool_build_host_key(const char *host, int port, char *key_out) {
@@ -490,19 +1114,63 @@ void pool_build_host_key(const char *host, int port, char *key_out) {
     snprintf(key_out, POOL_MAX_HOST_KEY_LEN, "%s:%d", host, port);
 }
 
+void pool_key_add_variant(char *key, unsigned int variant) {
+    if (!key || !key[0] || variant == 0) {
+        return;
+    }
+
+    size_t len = strlen(key);
+    snprintf(key + len, POOL_MAX_HOST_KEY_LEN - len, "#v%u", variant);
+}
+
+void pool_build_proxy_key(const char *host, int port, const char *proxy_url,
+                          const char *username, const char *password, char *key_out) {
+    if (!proxy_url || !key_out) {
+        return;
+    }
+
+    /* SHA-256 over "url\0user\0pass", so the key can be logged or compared
+     * without exposing credentials and users of one proxy can't collide */
+    unsigned char digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_len = 0;
+    EVP_MD_CTX *mdctx = EVP_MD_CTX_new();
+    if (!mdctx ||
+        EVP_DigestInit_ex(mdctx, EVP_sha256(), NULL) != 1 ||
+        EVP_DigestUpdate(mdctx, proxy_url, strlen(proxy_url) + 1) != 1 ||
+        EVP_DigestUpdate(mdctx, username ? username : "", (username ? strlen(username) : 0) + 1) != 1 ||
+        EVP_DigestUpdate(mdctx, password ? password : "", password ? strlen(password) : 0) != 1 ||
+        EVP_DigestFinal_ex(mdctx, digest, &digest_len) != 1) {
+        EVP_MD_CTX_free(mdctx);
+        key_out[0] = '\0';  /* Empty key: don't pool */
+        return;
+    }
+    EVP_MD_CTX_free(mdctx);
+
+    /* 128 bits of the digest are plenty to tell proxies apart */
+    char hex[33];
+    for (int i = 0; i < 16; i++) {
+        snprintf(hex + i * 2, 3, "%02x", digest[i]);
+    }
+
+    if (host) {
+        snprintf(key_out, POOL_MAX_HOST_KEY_LEN, "%s:%d|%s", host, port, hex);
+    } else {
+        snprintf(key_out, POOL_MAX_HOST_KEY_LEN, "|%s", hex);
+    }
+}
+
 int pool_count_connections_for_host(httpmorph_pool_t *pool, const char *host_key) {
     if (!pool || !host_key) {
         return 0;
     }
 
-    int count = 0;
-    pooled_connection_t *conn = pool->connections;
-    while (conn) {
-        if (strcmp(conn->host_key, host_key) == 0) {
-            count++;
-        }
-        conn = conn->next;
-    }
+    uint32_t hash = pool_hash_key(host_key);
+    size_t index = pool_bucket_index(hash);
+
+    pool_bucket_lock(pool, index);
+    pool_host_t *host = pool_find_host(pool, host_key, hash);
+    int count = host ? host->idle_count : 0;
+    pool_bucket_unlock(pool, index);
 
     return count;
 }
@@ -527,7 +1195,7 @@ int pool_prewarm_connections(httpmorph_pool_t *pool,
     for (int i = 0; i < count; i++) {
         /* Create TCP connection */
         uint64_t connect_time_us = 0;
-        int sockfd = httpmorph_tcp_connect(host, actual_port, client->timeout_ms, &connect_time_us);
+        int sockfd = httpmorph_tcp_connect(host, actual_port, client->timeout_ms, false, &connect_time_us, NULL);
         if (sockfd < 0) {
             continue;  /* Skip failed connections */
         }
@@ -536,7 +1204,7 @@ int pool_prewarm_connections(httpmorph_pool_t *pool,
         if (use_tls) {
             /* Establish TLS */
             uint64_t tls_time = 0;
-            ssl = httpmorph_tls_connect(client->ssl_ctx, sockfd, host,
+            ssl = httpmorph_tls_connect(client->ssl_ctx, client->session_cache, sockfd, host, actual_port,
                                        client->browser_profile,
                                        false, true, &tls_time);  /* http2_enabled = false, verify_cert = true */
             if (!ssl) {
@@ -557,8 +1225,7 @@ int pool_prewarm_connections(httpmorph_pool_t *pool,
         if (pool_put_connection(pool, conn)) {
             created++;
         } else {
-            /* Pool rejected connection - clean up and stop */
-            pool_connection_destroy(conn);
+            /* Pool rejected connection (pool_put_connection already destroyed it) - stop */
             break;
         }
     }
@@ -598,37 +1265,19 @@ int httpmorph_pool_get_connection_fd(httpmorph_pool_t *pool,
     /* Build host key */
     char host_key[POOL_MAX_HOST_KEY_LEN];
     pool_build_host_key(host, port, host_key);
-
-    /* Lock pool for thread safety */
-#ifdef _WIN32
-    CRITICAL_SECTION *cs = (CRITICAL_SECTION*)pool->mutex;
-    if (cs) EnterCriticalSection(cs);
-#else
-    pthread_mutex_t *mutex = (pthread_mutex_t*)pool->mutex;
-    if (mutex) pthread_mutex_lock(mutex);
-#endif
-
-    /* Find an active connection for this host */
-    pooled_connection_t *conn = pool->connections;
+    uint32_t hash = pool_hash_key(host_key);
+    size_t index = pool_bucket_index(hash);
     int fd = -1;
 
-    while (conn) {
-        if (strcmp(conn->host_key, host_key) == 0) {
-            /* Found a connection for this host */
-            if (conn->state == POOL_CONN_ACTIVE && conn->is_valid) {
-                fd = conn->sockfd;
-                break;
-            }
-        }
-        conn = conn->next;
+    pool_bucket_lock(pool, index);
+
+    /* Most recently pooled connection for this host */
+    pool_host_t *entry = pool_find_host(pool, host_key, hash);
+    if (entry && entry->idle && entry->idle->is_valid) {
+        fd = entry->idle->sockfd;
     }
 
-    /* Unlock pool */
-#ifdef _WIN32
-    if (cs) LeaveCriticalSection(cs);
-#else
-    if (mutex) pthread_mutex_unlock(mutex);
-#endif
+    pool_bucket_unlock(pool, index);
 
     return fd;
 }
@@ -9,6 +9,7 @@
 #define HTTPMORPH_CONNECTION_POOL_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <time.h>
 #include <openssl/ssl.h>
 
@@ -20,7 +21,11 @@ typedef struct pooled_connection pooled_connection_t;
 #define POOL_MAX_CONNECTIONS_PER_HOST 6    /* Match browser behavior */
 #define POOL_MAX_TOTAL_CONNECTIONS 100     /* Global limit */
 #define POOL_IDLE_TIMEOUT_SECONDS 30       /* Close after 30s idle */
-#define POOL_MAX_HOST_KEY_LEN 256          /* "hostname:port" max length */
+#define POOL_MAX_HOST_KEY_LEN 256          /* "hostname:port[|proxy]" max length */
+#define POOL_HASH_BUCKETS 64               /* Host index buckets (power of 2), one lock each */
+#define POOL_PROBE_IDLE_SECONDS 2          /* Probe liveness at checkout after this much idle time */
+#define POOL_MAINTENANCE_INTERVAL_MS 1000  /* Default background maintenance period */
+#define POOL_COALESCE_MAX_NAMES 128        /* ORIGIN / 421 host names kept per connection */
 
 /* Connection state (following httpcore's pattern) */
 typedef enum {
@@ -29,57 +34,75 @@ typedef enum {
     POOL_CONN_CLOSED = 2     /* Connection closed/invalid */
 } pool_connection_state_t;
 
+typedef struct pool_host pool_host_t;
+
 /**
  * Pooled connection structure
- * Represents a reusable connection to a specific host:port
+ * Represents a reusable connection to a specific host:port. Fields read on
+ * every checkout, put and idle scan come first and fit one cache line; the
+ * rest is only touched when a connection is created, used for a request or
+ * destroyed. The host key is stored inline after the structure, so each
+ * connection is a single allocation.
  */
 struct pooled_connection {
-    /* Connection identifiers */
-    char host_key[POOL_MAX_HOST_KEY_LEN];  /* "hostname:port" */
-
-    /* Socket and SSL */
-    int sockfd;
+    /* Hot: checkout, put and maintenance scans */
+    pooled_connection_t *next;              /* Idle stack link (per host, most recently used first) */
+    pool_host_t *host;                      /* Host entry once pooled (NULL before) */
     SSL *ssl;                               /* NULL for HTTP connections */
-
-    /* State tracking */
     time_t last_used;                       /* Unix timestamp */
+    uint32_t host_hash;                     /* Hash of host_key */
+    int sockfd;
+    int ref_count;                          /* Reference count for sharing (HTTP/2 multiplexing) */
+    pool_connection_state_t state;          /* Current connection state */
     bool is_http2;                          /* HTTP/2 connection */
     bool is_valid;                          /* Connection still alive */
     bool preface_sent;                      /* HTTP/2 preface already sent on this connection */
-    pool_connection_state_t state;          /* Current connection state */
-    int ref_count;                          /* Reference count for sharing (HTTP/2 multiplexing) */
-
-    /* Proxy connection info */
-    bool is_proxy;                          /* True if connection goes through proxy */
-    char *proxy_url;                        /* Proxy URL (for proxy connections) */
-    char *target_host;                      /* Target host (for HTTPS CONNECT tunnels) */
-    uint16_t target_port;                   /* Target port (for HTTPS CONNECT tunnels) */
+    bool is_proxy;                          /* Goes through a proxy (named in host_key) */
 
-    /* TLS fingerprinting info (for HTTPS connections) */
-    char *ja3_fingerprint;                  /* JA3 fingerprint from initial handshake */
-    char *tls_version;                      /* TLS version string */
-    char *tls_cipher;                       /* TLS cipher suite name */
+    /* Cold: TLS fingerprinting info (static strings, not owned) */
+    const char *ja3_fingerprint;            /* JA3 fingerprint from initial handshake */
+    const char *tls_version;                /* TLS version string */
+    const char *tls_cipher;                 /* TLS cipher suite name */
 
 #ifdef HAVE_NGHTTP2
-    /* HTTP/2 session (only if is_http2 is true) */
+    /* Cold: HTTP/2 session (only if is_http2 is true) */
     void *http2_session;                    /* nghttp2_session* */
     void *http2_stream_data;                /* http2_stream_data_t* - persistent callback data */
     void *http2_session_manager;            /* http2_session_manager_t* - for concurrent multiplexing */
+    void *coalesce;                         /* pool_coalesce_t* - reuse by other origins (NULL if disabled) */
 #endif
 
-    /* Linked list */
-    pooled_connection_t *next;
+    char host_key[];                        /* "hostname:port[|proxy]", allocated with the connection */
+};
+
+/**
+ * Per-host entry
+ * Holds the interned host key and a LIFO stack of idle connections
+ */
+struct pool_host {
+    char *host_key;                         /* Interned "hostname:port" */
+    uint32_t hash;
+    httpmorph_pool_t *pool;                 /* Owning pool */
+    pooled_connection_t *idle;              /* Idle stack (newest on top) */
+    int idle_count;
+    pool_host_t *next;                      /* Bucket chain */
+
+    /* Warm-pool target (maintained by pool_maintain) */
+    char *hostname;                         /* NULL unless a minimum is set */
+    uint16_t port;
+    bool use_tls;
+    int min_idle;
 };
 
 /**
  * Connection pool structure
- * Manages a collection of reusable connections
+ * Hash index from host key to per-host idle stacks, one lock per bucket
  */
 struct httpmorph_pool {
-    /* Connection storage (simple linked list for now) */
-    pooled_connection_t *connections;
+    /* Host index */
+    pool_host_t *buckets[POOL_HASH_BUCKETS];
 
-    /* Statistics */
+    /* Statistics (updated atomically) */
     int total_connections;
     int active_connections;
 
@@ -88,11 +111,17 @@ struct httpmorph_pool {
     int max_total_connections;
     int idle_timeout_seconds;
 
-    /* Thread safety */
+    /* Background maintenance */
+    void *maintenance;           /* pool_maintenance_t* (NULL when not running) */
+    int reaped_connections;      /* Idle or peer-closed connections closed by maintenance */
+    int refilled_connections;    /* Connections opened to meet min_idle */
+    int coalesced_connections;   /* HTTP/2 connections reused by another origin */
+
+    /* Thread safety: one lock per bucket */
 #ifdef _WIN32
-    void *mutex;  /* CRITICAL_SECTION* */
+    void *bucket_locks;  /* CRITICAL_SECTION[POOL_HASH_BUCKETS] */
 #else
-    void *mutex;  /* pthread_mutex_t* */
+    void *bucket_locks;  /* pthread_mutex_t[POOL_HASH_BUCKETS] */
 #endif
 };
 
@@ -114,6 +143,64 @@ void pool_destroy(httpmorph_pool_t *pool);
  */
 void pool_cleanup_idle(httpmorph_pool_t *pool);
 
+/**
+ * Pool occupancy and maintenance counters
+ */
+typedef struct {
+    int idle;                    /* Connections waiting in the pool */
+    int active;                  /* Connections checked out */
+    int reaped;                  /* Closed by maintenance */
+    int refilled;                /* Opened by maintenance */
+    int coalesced;               /* HTTP/2 connections reused by another origin */
+} pool_stats_t;
+
+/**
+ * Read a pool's counters (each is read atomically, not all at once)
+ */
+void pool_get_stats(httpmorph_pool_t *pool, pool_stats_t *stats);
+
+/* Forward declare httpmorph_client_t */
+typedef struct httpmorph_client httpmorph_client_t;
+
+/**
+ * Run one maintenance pass
+ * Closes idle-expired and peer-closed connections, then opens new ones
+ * for hosts below their min_idle target
+ *
+ * @param pool The connection pool
+ * @param client HTTP client for refills (NULL to skip refilling)
+ */
+void pool_maintain(httpmorph_pool_t *pool, httpmorph_client_t *client);
+
+/**
+ * Start a background thread running pool_maintain() periodically
+ *
+ * @param pool The connection pool
+ * @param client HTTP client for refills (must outlive the pool, may be NULL)
+ * @param interval_ms Period in milliseconds (0 for default)
+ * @return 0 on success, -1 on error (or if already running)
+ */
+int pool_start_maintenance(httpmorph_pool_t *pool, httpmorph_client_t *client, int interval_ms);
+
+/**
+ * Stop the background maintenance thread (no-op if not running)
+ */
+void pool_stop_maintenance(httpmorph_pool_t *pool);
+
+/**
+ * Keep at least min_idle idle connections open to a host
+ * Refilled by pool_maintain(); 0 removes the target
+ *
+ * @param pool The connection pool
+ * @param host Hostname
+ * @param port Port number
+ * @param use_tls Whether refill connections use TLS
+ * @param min_idle Target idle count (capped at max_connections_per_host)
+ * @return 0 on success, -1 on error
+ */
+int pool_set_min_idle(httpmorph_pool_t *pool, const char *host, int port,
+                      bool use_tls, int min_idle);
+
 /* === Connection Operations === */
 
 /**
@@ -129,6 +216,17 @@ pooled_connection_t* pool_get_connection(httpmorph_pool_t *pool,
                                         const char *host,
                                         int port);
 
+/**
+ * Get a connection from the pool by a prebuilt key
+ * Used for proxied connections, whose keys come from pool_build_proxy_key()
+ *
+ * @param pool The connection pool
+ * @param host_key Key from pool_build_host_key() or pool_build_proxy_key()
+ * @return Pooled connection or NULL if not found
+ */
+pooled_connection_t* pool_get_connection_by_key(httpmorph_pool_t *pool,
+                                               const char *host_key);
+
 /**
  * Return a connection to the pool for reuse
  * If pool is full or connection is invalid, it will be closed
@@ -156,6 +254,20 @@ pooled_connection_t* pool_connection_create(const char *host,
                                            SSL *ssl,
                                            bool is_http2);
 
+/**
+ * Create a pooled connection wrapper filed under a prebuilt key
+ *
+ * @param host_key Key from pool_build_host_key() or pool_build_proxy_key()
+ * @param sockfd Socket file descriptor
+ * @param ssl SSL connection (or NULL for HTTP)
+ * @param is_http2 Whether this is an HTTP/2 connection
+ * @return New pooled connection (caller must free or pool it)
+ */
+pooled_connection_t* pool_connection_create_with_key(const char *host_key,
+                                                    int sockfd,
+                                                    SSL *ssl,
+                                                    bool is_http2);
+
 /**
  * Close and free a pooled connection
  * Closes socket, frees SSL, frees memory
@@ -171,6 +283,76 @@ void pool_connection_destroy(pooled_connection_t *conn);
  */
 bool pool_connection_validate(pooled_connection_t *conn);
 
+/**
+ * Probe an idle connection for liveness without blocking
+ * Detects peer-closed and errored sockets with a zero-timeout poll + peek
+ *
+ * @param conn Idle connection to probe
+ * @return true if the connection looks usable, false otherwise
+ */
+bool pool_connection_probe(pooled_connection_t *conn);
+
+#ifdef HAVE_NGHTTP2
+/* === HTTP/2 Connection Coalescing === */
+
+/**
+ * Let other origins reuse an HTTP/2 connection (RFC 9113 section 9.1.1)
+ * A host may share the connection when the peer certificate covers it and
+ * it resolves to the connection's peer address, or - once the server has
+ * sent ORIGIN frames (RFC 8336) - when the server lists it
+ *
+ * @param conn New HTTP/2 connection over TLS
+ * @param verified Whether the peer certificate was verified
+ * @return 0 on success, -1 on error
+ */
+int pool_connection_enable_coalescing(pooled_connection_t *conn, bool verified);
+
+/**
+ * Add an origin from an ORIGIN frame (thread-safe)
+ *
+ * @param conn HTTP/2 connection
+ * @param origin ASCII origin, e.g. "https://cdn.example.com"
+ * @param len Origin length
+ */
+void pool_connection_add_origin(pooled_connection_t *conn, const char *origin, size_t len);
+
+/**
+ * Stop coalescing a host onto a connection (after 421 Misdirected Request)
+ *
+ * @param conn HTTP/2 connection
+ * @param host Hostname the server refused
+ */
+void pool_connection_mark_misdirected(pooled_connection_t *conn, const char *host);
+
+/**
+ * Check whether a connection was opened for a different origin
+ *
+ * @param conn Pooled connection
+ * @param host Hostname of the current request
+ * @param port Port of the current request
+ * @return true if the connection is serving host:port through coalescing
+ */
+bool pool_connection_is_coalesced(const pooled_connection_t *conn, const char *host, int port);
+
+/**
+ * Check out another origin's idle HTTP/2 connection that can serve a host
+ * Call after pool_get_connection() misses; resolves host through the DNS
+ * cache, which the fallback connect then reuses
+ *
+ * @param pool The connection pool
+ * @param host Hostname
+ * @param port Port number
+ * @param verify_ssl Whether the request requires a verified certificate
+ * @param timeout_ms Resolver timeout in milliseconds
+ * @return Pooled connection (checked out as by pool_get_connection()) or NULL
+ */
+pooled_connection_t* pool_get_coalesced_connection(httpmorph_pool_t *pool,
+                                                   const char *host,
+                                                   int port,
+                                                   bool verify_ssl,
+                                                   uint32_t timeout_ms);
+#endif
+
 /* === Helper Functions === */
 
 /**
@@ -184,7 +366,35 @@ bool pool_connection_validate(pooled_connection_t *conn);
 void pool_build_host_key(const char *host, int port, char *key_out);
 
 /**
- * Count connections for a specific host
+ * Build a host key for a connection made through a proxy
+ * Format: "hostname:port|<digest>" for CONNECT tunnels and "|<digest>" for
+ * plain HTTP requests forwarded by the proxy, where the digest covers the
+ * proxy URL and credentials so they never appear in the key. Connections
+ * through different proxies or as different proxy users never share a key.
+ *
+ * @param host Target hostname (NULL for forwarded plain HTTP)
+ * @param port Target port
+ * @param proxy_url Proxy URL
+ * @param username Proxy username (NULL if none)
+ * @param password Proxy password (NULL if none)
+ * @param key_out Buffer to write key (must be POOL_MAX_HOST_KEY_LEN bytes)
+ */
+void pool_build_proxy_key(const char *host, int port, const char *proxy_url,
+                          const char *username, const char *password, char *key_out);
+
+/**
+ * Partition a host key by fingerprint variant
+ * Appends "#v<variant>" so connections opened with a rotated fingerprint
+ * are only reused by requests rotated to the same variant. Variant 0 (the
+ * profile itself) and empty keys are left unchanged.
+ *
+ * @param key Key from pool_build_host_key() or pool_build_proxy_key()
+ * @param variant Fingerprint variant
+ */
+void pool_key_add_variant(char *key, unsigned int variant);
+
+/**
+ * Count idle connections for a specific host
  *
  * @param pool The connection pool
  * @param host_key Host key ("hostname:port")
@@ -192,9 +402,6 @@ void pool_build_host_key(const char *host, int port, char *key_out);
  */
 int pool_count_connections_for_host(httpmorph_pool_t *pool, const char *host_key);
 
-/* Forward declare httpmorph_client_t */
-typedef struct httpmorph_client httpmorph_client_t;
-
 /**
  * Pre-warm connections to a host
  * Establishes N connections and adds them to the pool
@@ -3,159 +3,766 @@
  */
 
 #include "internal/cookies.h"
+#include "internal/util.h"
+#include <ctype.h>
+
+/* Initial domain hash buckets (power of two) */
+#define COOKIE_JAR_INITIAL_BUCKETS 64
+
+/* Session cookies sort after every persistent one in the expiry heap */
+#define COOKIE_SESSION_EXPIRY INT64_MAX
+
+/* Cookies sharing a domain and path, in creation order */
+typedef struct cookie_path {
+    char *path;
+    size_t path_len;
+    cookie_t *head;
+    cookie_t *tail;
+    struct cookie_domain *domain;
+    struct cookie_path *next;    /* Next bucket (paths kept longest first) */
+} cookie_path_t;
+
+/* Every cookie stored under one domain (host-only or Domain attribute) */
+typedef struct cookie_domain {
+    char *domain;
+    size_t domain_len;
+    uint32_t hash;
+    cookie_path_t *paths;
+    size_t count;
+    struct cookie_domain *next;  /* Hash chain */
+} cookie_domain_t;
+
+struct cookie_jar {
+    cookie_domain_t **buckets;
+    size_t bucket_count;
+    size_t domain_count;
+    cookie_t **heap;             /* Min-heap on (expiry, seq) */
+    size_t count;
+    size_t heap_capacity;
+    size_t max_cookies;
+    uint64_t next_seq;
+};
+
+/* A slice of the Set-Cookie header */
+typedef struct {
+    const char *data;
+    size_t len;
+} cookie_span_t;
+
+/* Helper: FNV-1a over a lowercase domain */
+static uint32_t cookie_hash(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Helper: Trim spaces and tabs from both ends of a span */
+static cookie_span_t cookie_trim(const char *s, size_t len) {
+    while (len > 0 && (*s == ' ' || *s == '\t')) {
+        s++;
+        len--;
+    }
+    while (len > 0 && (s[len - 1] == ' ' || s[len - 1] == '\t')) {
+        len--;
+    }
+    cookie_span_t span = { s, len };
+    return span;
+}
+
+/* Helper: Copy a span, lowercased */
+static char* cookie_lower_dup(const char *s, size_t len) {
+    char *copy = malloc(len + 1);
+    if (!copy) {
+        return NULL;
+    }
+    for (size_t i = 0; i < len; i++) {
+        copy[i] = (char)tolower((unsigned char)s[i]);
+    }
+    copy[len] = '\0';
+    return copy;
+}
+
+/* Helper: Whether a host is an IP literal (never domain-matched by suffix) */
+static bool cookie_host_is_ip(const char *host, size_t len) {
+    if (memchr(host, ':', len)) {
+        return true;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!isdigit((unsigned char)host[i]) && host[i] != '.') {
+            return false;
+        }
+    }
+    return len > 0;
+}
+
+/* Helper: Expiry key for the heap */
+static int64_t cookie_expiry_key(const cookie_t *c) {
+    return c->expires == 0 ? COOKIE_SESSION_EXPIRY : (int64_t)c->expires;
+}
+
+/* Helper: Whether heap entry a sorts before b */
+static bool cookie_heap_less(const cookie_t *a, const cookie_t *b) {
+    int64_t ka = cookie_expiry_key(a);
+    int64_t kb = cookie_expiry_key(b);
+    return ka < kb || (ka == kb && a->seq < b->seq);
+}
+
+static void cookie_heap_place(cookie_jar_t *jar, size_t i, cookie_t *c) {
+    jar->heap[i] = c;
+    c->heap_index = i;
+}
+
+static void cookie_heap_up(cookie_jar_t *jar, size_t i) {
+    cookie_t *c = jar->heap[i];
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!cookie_heap_less(c, jar->heap[parent])) {
+            break;
+        }
+        cookie_heap_place(jar, i, jar->heap[parent]);
+        i = parent;
+    }
+    cookie_heap_place(jar, i, c);
+}
+
+static void cookie_heap_down(cookie_jar_t *jar, size_t i) {
+    cookie_t *c = jar->heap[i];
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= jar->count) {
+            break;
+        }
+        if (child + 1 < jar->count && cookie_heap_less(jar->heap[child + 1], jar->heap[child])) {
+            child++;
+        }
+        if (!cookie_heap_less(jar->heap[child], c)) {
+            break;
+        }
+        cookie_heap_place(jar, i, jar->heap[child]);
+        i = child;
+    }
+    cookie_heap_place(jar, i, c);
+}
+
+/* Helper: Restore heap order after a cookie's expiry changed */
+static void cookie_heap_fix(cookie_jar_t *jar, size_t i) {
+    if (i > 0 && cookie_heap_less(jar->heap[i], jar->heap[(i - 1) / 2])) {
+        cookie_heap_up(jar, i);
+    } else {
+        cookie_heap_down(jar, i);
+    }
+}
+
+/* Helper: Find a domain node */
+static cookie_domain_t* cookie_domain_find(cookie_jar_t *jar, const char *domain,
+                                           size_t len, uint32_t hash) {
+    cookie_domain_t *d = jar->buckets[hash & (jar->bucket_count - 1)];
+    for (; d; d = d->next) {
+        if (d->hash == hash && d->domain_len == len && memcmp(d->domain, domain, len) == 0) {
+            return d;
+        }
+    }
+    return NULL;
+}
+
+/* Helper: Double the domain hash table */
+static void cookie_jar_grow(cookie_jar_t *jar) {
+    size_t count = jar->bucket_count * 2;
+    cookie_domain_t **buckets = calloc(count, sizeof(cookie_domain_t*));
+    if (!buckets) {
+        return;  /* Keep the old table; chains just get longer */
+    }
+    for (size_t i = 0; i < jar->bucket_count; i++) {
+        cookie_domain_t *d = jar->buckets[i];
+        while (d) {
+            cookie_domain_t *next = d->next;
+            size_t slot = d->hash & (count - 1);
+            d->next = buckets[slot];
+            buckets[slot] = d;
+            d = next;
+        }
+    }
+    free(jar->buckets);
+    jar->buckets = buckets;
+    jar->bucket_count = count;
+}
+
+/* Helper: Find or add a domain node */
+static cookie_domain_t* cookie_domain_get(cookie_jar_t *jar, const char *domain, size_t len) {
+    uint32_t hash = cookie_hash(domain, len);
+    cookie_domain_t *d = cookie_domain_find(jar, domain, len, hash);
+    if (d) {
+        return d;
+    }
+
+    d = calloc(1, sizeof(cookie_domain_t));
+    if (!d) {
+        return NULL;
+    }
+    d->domain = strndup(domain, len);
+    if (!d->domain) {
+        free(d);
+        return NULL;
+    }
+    d->domain_len = len;
+    d->hash = hash;
+
+    if (jar->domain_count >= jar->bucket_count) {
+        cookie_jar_grow(jar);
+    }
+    size_t slot = hash & (jar->bucket_count - 1);
+    d->next = jar->buckets[slot];
+    jar->buckets[slot] = d;
+    jar->domain_count++;
+    return d;
+}
+
+/* Helper: Find or add a path bucket, keeping longer paths first */
+static cookie_path_t* cookie_path_get(cookie_domain_t *d, const char *path, size_t len) {
+    cookie_path_t **link = &d->paths;
+    while (*link && (*link)->path_len >= len) {
+        if ((*link)->path_len == len && memcmp((*link)->path, path, len) == 0) {
+            return *link;
+        }
+        link = &(*link)->next;
+    }
+
+    cookie_path_t *p = calloc(1, sizeof(cookie_path_t));
+    if (!p) {
+        return NULL;
+    }
+    p->path = strndup(path, len);
+    if (!p->path) {
+        free(p);
+        return NULL;
+    }
+    p->path_len = len;
+    p->domain = d;
+    p->next = *link;
+    *link = p;
+    return p;
+}
+
+/* Helper: Unlink a cookie from the index and heap and free it */
+static void cookie_jar_remove(cookie_jar_t *jar, cookie_t *c) {
+    /* Heap: move the last entry into the hole */
+    size_t i = c->heap_index;
+    jar->count--;
+    if (i < jar->count) {
+        cookie_heap_place(jar, i, jar->heap[jar->count]);
+        cookie_heap_fix(jar, i);
+    }
+
+    /* Path bucket */
+    cookie_path_t *p = c->bucket;
+    if (c->prev) c->prev->next = c->next;
+    else p->head = c->next;
+    if (c->next) c->next->prev = c->prev;
+    else p->tail = c->prev;
+    httpmorph_cookie_free(c);
+
+    cookie_domain_t *d = p->domain;
+    d->count--;
+    if (!p->head) {
+        cookie_path_t **link = &d->paths;
+        while (*link != p) {
+            link = &(*link)->next;
+        }
+        *link = p->next;
+        free(p->path);
+        free(p);
+    }
+
+    /* Domain node */
+    if (d->count == 0) {
+        cookie_domain_t **link = &jar->buckets[d->hash & (jar->bucket_count - 1)];
+        while (*link != d) {
+            link = &(*link)->next;
+        }
+        *link = d->next;
+        jar->domain_count--;
+        free(d->domain);
+        free(d);
+    }
+}
+
+/* Helper: Drop cookies that have expired */
+static void cookie_jar_prune(cookie_jar_t *jar, time_t now) {
+    while (jar->count > 0) {
+        cookie_t *top = jar->heap[0];
+        if (top->expires == 0 || top->expires > now) {
+            break;
+        }
+        cookie_jar_remove(jar, top);
+    }
+}
 
 /**
- * Free a cookie structure
+ * Create a cookie jar
  */
-void httpmorph_cookie_free(cookie_t *cookie) {
-    if (!cookie) return;
-    free(cookie->name);
-    free(cookie->value);
-    free(cookie->domain);
-    free(cookie->path);
-    free(cookie);
+cookie_jar_t* cookie_jar_create(size_t max_cookies) {
+    cookie_jar_t *jar = calloc(1, sizeof(cookie_jar_t));
+    if (!jar) {
+        return NULL;
+    }
+    jar->buckets = calloc(COOKIE_JAR_INITIAL_BUCKETS, sizeof(cookie_domain_t*));
+    if (!jar->buckets) {
+        free(jar);
+        return NULL;
+    }
+    jar->bucket_count = COOKIE_JAR_INITIAL_BUCKETS;
+    jar->max_cookies = max_cookies > 0 ? max_cookies : COOKIE_JAR_DEFAULT_MAX;
+    return jar;
 }
 
 /**
- * Parse Set-Cookie header and add to session
+ * Destroy a cookie jar and all its cookies
  */
-void httpmorph_parse_set_cookie(httpmorph_session_t *session,
-                                 const char *header_value,
-                                 const char *request_domain) {
-    if (!session || !header_value || !request_domain) {
+void cookie_jar_destroy(cookie_jar_t *jar) {
+    if (!jar) {
         return;
     }
+    for (size_t i = 0; i < jar->bucket_count; i++) {
+        cookie_domain_t *d = jar->buckets[i];
+        while (d) {
+            cookie_domain_t *next_domain = d->next;
+            cookie_path_t *p = d->paths;
+            while (p) {
+                cookie_path_t *next_path = p->next;
+                cookie_t *c = p->head;
+                while (c) {
+                    cookie_t *next = c->next;
+                    httpmorph_cookie_free(c);
+                    c = next;
+                }
+                free(p->path);
+                free(p);
+                p = next_path;
+            }
+            free(d->domain);
+            free(d);
+            d = next_domain;
+        }
+    }
+    free(jar->buckets);
+    free(jar->heap);
+    free(jar);
+}
 
-    cookie_t *cookie = calloc(1, sizeof(cookie_t));
-    if (!cookie) return;
+/**
+ * Number of cookies in a jar
+ */
+size_t cookie_jar_count(const cookie_jar_t *jar) {
+    return jar ? jar->count : 0;
+}
 
-    /* Parse cookie: name=value; attributes */
-    char *header_copy = strdup(header_value);
-    if (!header_copy) {
-        free(cookie);
-        return;
+/**
+ * Store a cookie from a Set-Cookie header
+ */
+int cookie_jar_set(cookie_jar_t *jar, const char *header_value, const char *host, time_t now) {
+    if (!jar || !header_value || !host) {
+        return -1;
     }
 
-    /* Extract name=value */
-    char *semicolon = strchr(header_copy, ';');
-    if (semicolon) *semicolon = '\0';
+    /* name=value up to the first ';' (RFC 6265 section 5.2) */
+    const char *end = header_value + strlen(header_value);
+    const char *semi = memchr(header_value, ';', (size_t)(end - header_value));
+    const char *pair_end = semi ? semi : end;
+    const char *eq = memchr(header_value, '=', (size_t)(pair_end - header_value));
+    if (!eq) {
+        return -1;
+    }
+    cookie_span_t name = cookie_trim(header_value, (size_t)(eq - header_value));
+    cookie_span_t value = cookie_trim(eq + 1, (size_t)(pair_end - eq - 1));
+    if (name.len == 0) {
+        return -1;
+    }
 
-    char *equals = strchr(header_copy, '=');
-    if (equals) {
-        *equals = '\0';
-        cookie->name = strdup(header_copy);
-        cookie->value = strdup(equals + 1);
-    } else {
-        free(header_copy);
-        free(cookie);
-        return;
+    cookie_span_t domain_attr = { NULL, 0 };
+    cookie_span_t path_attr = { NULL, 0 };
+    bool secure = false, http_only = false;
+    bool have_max_age = false, have_expires = false;
+    int64_t max_age = 0, expires_at = 0;
+
+    const char *attr = semi;
+    while (attr && attr < end) {
+        attr++;
+        const char *attr_end = memchr(attr, ';', (size_t)(end - attr));
+        if (!attr_end) attr_end = end;
+        const char *attr_eq = memchr(attr, '=', (size_t)(attr_end - attr));
+        cookie_span_t key = cookie_trim(attr, (size_t)((attr_eq ? attr_eq : attr_end) - attr));
+        cookie_span_t val = { attr_end, 0 };
+        if (attr_eq) {
+            val = cookie_trim(attr_eq + 1, (size_t)(attr_end - attr_eq - 1));
+        }
+
+        if (key.len == 6 && strncasecmp(key.data, "Domain", 6) == 0) {
+            domain_attr = val;
+        } else if (key.len == 4 && strncasecmp(key.data, "Path", 4) == 0) {
+            path_attr = val;
+        } else if (key.len == 6 && strncasecmp(key.data, "Secure", 6) == 0) {
+            secure = true;
+        } else if (key.len == 8 && strncasecmp(key.data, "HttpOnly", 8) == 0) {
+            http_only = true;
+        } else if (key.len == 7 && strncasecmp(key.data, "Max-Age", 7) == 0) {
+            /* Digits with an optional leading '-'; anything else is ignored */
+            size_t i = (val.len > 0 && val.data[0] == '-') ? 1 : 0;
+            bool valid = val.len > i;
+            int64_t n = 0;
+            for (; valid && i < val.len; i++) {
+                if (!isdigit((unsigned char)val.data[i])) {
+                    valid = false;
+                } else if (n < INT64_MAX / 10 - 10) {
+                    n = n * 10 + (val.data[i] - '0');
+                }
+            }
+            if (valid) {
+                have_max_age = true;
+                max_age = val.data[0] == '-' ? -n : n;
+            }
+        } else if (key.len == 7 && strncasecmp(key.data, "Expires", 7) == 0) {
+            int64_t t = httpmorph_parse_http_date(val.data, val.len);
+            if (t >= 0) {
+                have_expires = true;
+                expires_at = t;
+            }
+        }
+        attr = attr_end;
+    }
+
+    /* Max-Age wins over Expires; non-positive values delete the cookie */
+    bool expired = false;
+    time_t expires = 0;
+    if (have_max_age) {
+        if (max_age <= 0) {
+            expired = true;
+        } else {
+            expires = (int64_t)now > INT64_MAX - max_age ? (time_t)INT64_MAX : now + (time_t)max_age;
+        }
+    } else if (have_expires) {
+        if (expires_at <= (int64_t)now) {
+            expired = true;
+        } else {
+            expires = (time_t)expires_at;
+        }
+    }
+
+    /* Domain: must domain-match the request host (RFC 6265 section 5.3) */
+    size_t host_len = strlen(host);
+    if (host_len > 0 && host[host_len - 1] == '.') {
+        host_len--;
+    }
+    char *host_lc = cookie_lower_dup(host, host_len);
+    if (!host_lc) {
+        return -1;
     }
 
-    /* Set default domain and path */
-    cookie->domain = strdup(request_domain);
-    cookie->path = strdup("/");
-    cookie->expires = 0;  /* Session cookie by default */
-    cookie->secure = false;
-    cookie->http_only = false;
-
-    /* Parse attributes if present */
-    if (semicolon) {
-        char *attr = semicolon + 1;
-        while (attr && *attr) {
-            /* Skip whitespace */
-            while (*attr == ' ') attr++;
-
-            if (strncasecmp(attr, "Domain=", 7) == 0) {
-                attr += 7;
-                char *end = strchr(attr, ';');
-                size_t len = end ? (size_t)(end - attr) : strlen(attr);
-                free(cookie->domain);
-                cookie->domain = strndup(attr, len);
-                attr = end;
-            } else if (strncasecmp(attr, "Path=", 5) == 0) {
-                attr += 5;
-                char *end = strchr(attr, ';');
-                size_t len = end ? (size_t)(end - attr) : strlen(attr);
-                free(cookie->path);
-                cookie->path = strndup(attr, len);
-                attr = end;
-            } else if (strncasecmp(attr, "Secure", 6) == 0) {
-                cookie->secure = true;
-                attr = strchr(attr, ';');
-            } else if (strncasecmp(attr, "HttpOnly", 8) == 0) {
-                cookie->http_only = true;
-                attr = strchr(attr, ';');
-            } else {
-                /* Skip unknown attribute */
-                attr = strchr(attr, ';');
+    const char *domain = host_lc;
+    size_t domain_len = host_len;
+    bool host_only = true;
+    if (domain_attr.len > 0 && domain_attr.data[0] == '.') {
+        domain_attr.data++;
+        domain_attr.len--;
+    }
+    if (domain_attr.len > 0) {
+        bool match = false;
+        if (domain_attr.len == host_len) {
+            match = strncasecmp(domain_attr.data, host_lc, host_len) == 0;
+        } else if (domain_attr.len < host_len && !cookie_host_is_ip(host_lc, host_len)) {
+            /* Suffix at a label boundary, and not a single label like "com" */
+            const char *suffix = host_lc + host_len - domain_attr.len;
+            match = suffix[-1] == '.' &&
+                    strncasecmp(domain_attr.data, suffix, domain_attr.len) == 0 &&
+                    memchr(domain_attr.data, '.', domain_attr.len) != NULL;
+        }
+        if (!match) {
+            free(host_lc);
+            return -1;
+        }
+        domain = host_lc + host_len - domain_attr.len;
+        domain_len = domain_attr.len;
+        host_only = false;
+    }
+
+    /* Path: default "/" unless the attribute is an absolute path */
+    const char *path = "/";
+    size_t path_len = 1;
+    if (path_attr.len > 0 && path_attr.data[0] == '/') {
+        path = path_attr.data;
+        path_len = path_attr.len;
+    }
+
+    cookie_jar_prune(jar, now);
+
+    /* Same name, domain and path replaces (or deletes) the stored cookie */
+    cookie_domain_t *d = cookie_domain_find(jar, domain, domain_len, cookie_hash(domain, domain_len));
+    cookie_t *existing = NULL;
+    if (d) {
+        for (cookie_path_t *p = d->paths; p && !existing; p = p->next) {
+            if (p->path_len != path_len || memcmp(p->path, path, path_len) != 0) {
+                continue;
             }
+            for (cookie_t *c = p->head; c; c = c->next) {
+                if (c->name_len == name.len && memcmp(c->name, name.data, name.len) == 0) {
+                    existing = c;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (expired) {
+        if (existing) {
+            cookie_jar_remove(jar, existing);
+        }
+        free(host_lc);
+        return 0;
+    }
 
-            if (attr) attr++;
+    if (existing) {
+        char *new_value = strndup(value.data, value.len);
+        if (!new_value) {
+            free(host_lc);
+            return -1;
         }
+        free(existing->value);
+        existing->value = new_value;
+        existing->value_len = value.len;
+        existing->expires = expires;
+        existing->secure = secure;
+        existing->http_only = http_only;
+        existing->host_only = host_only;
+        cookie_heap_fix(jar, existing->heap_index);
+        free(host_lc);
+        return 0;
     }
 
-    free(header_copy);
+    if (jar->count == jar->heap_capacity) {
+        size_t capacity = jar->heap_capacity ? jar->heap_capacity * 2 : 16;
+        cookie_t **heap = realloc(jar->heap, capacity * sizeof(cookie_t*));
+        if (!heap) {
+            free(host_lc);
+            return -1;
+        }
+        jar->heap = heap;
+        jar->heap_capacity = capacity;
+    }
 
-    /* Add to session's cookie list */
-    cookie->next = session->cookies;
-    session->cookies = cookie;
-    session->cookie_count++;
+    cookie_t *c = calloc(1, sizeof(cookie_t));
+    if (!c) {
+        free(host_lc);
+        return -1;
+    }
+    c->name = strndup(name.data, name.len);
+    c->value = strndup(value.data, value.len);
+    c->domain = strndup(domain, domain_len);
+    c->path = strndup(path, path_len);
+    if (!c->name || !c->value || !c->domain || !c->path) {
+        httpmorph_cookie_free(c);
+        free(host_lc);
+        return -1;
+    }
+    c->name_len = name.len;
+    c->value_len = value.len;
+    c->expires = expires;
+    c->secure = secure;
+    c->http_only = http_only;
+    c->host_only = host_only;
+    c->seq = jar->next_seq++;
+
+    d = cookie_domain_get(jar, domain, domain_len);
+    cookie_path_t *p = d ? cookie_path_get(d, path, path_len) : NULL;
+    free(host_lc);
+    if (!p) {
+        if (d && !d->paths) {
+            /* Domain node was just added for this cookie */
+            cookie_domain_t **link = &jar->buckets[d->hash & (jar->bucket_count - 1)];
+            while (*link != d) link = &(*link)->next;
+            *link = d->next;
+            jar->domain_count--;
+            free(d->domain);
+            free(d);
+        }
+        httpmorph_cookie_free(c);
+        return -1;
+    }
+
+    c->bucket = p;
+    c->prev = p->tail;
+    if (p->tail) p->tail->next = c;
+    else p->head = c;
+    p->tail = c;
+    d->count++;
+
+    cookie_heap_place(jar, jar->count, c);
+    jar->count++;
+    cookie_heap_up(jar, c->heap_index);
+
+    /* Over the cap: evict whatever expires soonest (oldest session cookie last) */
+    while (jar->count > jar->max_cookies) {
+        cookie_jar_remove(jar, jar->heap[0]);
+    }
+    return 0;
+}
+
+/* Helper: Cookie path matches request path (RFC 6265 section 5.1.4) */
+static bool cookie_path_matches(const cookie_path_t *p, const char *path, size_t path_len) {
+    if (p->path_len > path_len || memcmp(p->path, path, p->path_len) != 0) {
+        return false;
+    }
+    return p->path_len == path_len || p->path[p->path_len - 1] == '/' || path[p->path_len] == '/';
+}
+
+/* Helper: Order for the Cookie header (longer paths first, then oldest) */
+static int cookie_order(const void *a, const void *b) {
+    const cookie_t *ca = *(const cookie_t *const *)a;
+    const cookie_t *cb = *(const cookie_t *const *)b;
+    size_t la = ca->bucket->path_len, lb = cb->bucket->path_len;
+    if (la != lb) {
+        return la > lb ? -1 : 1;
+    }
+    return ca->seq < cb->seq ? -1 : (ca->seq > cb->seq ? 1 : 0);
 }
 
 /**
- * Get cookies for a request as a Cookie header value
+ * Build the Cookie header value for a request
  */
-char* httpmorph_get_cookies_for_request(httpmorph_session_t *session,
-                                         const char *domain,
-                                         const char *path,
-                                         bool is_secure) {
-    if (!session || !domain || !path) return NULL;
-    if (session->cookie_count == 0) return NULL;
-
-    /* Build cookie header value with bounds checking */
-    const size_t buffer_size = 4096;
-    char *cookie_header = malloc(buffer_size);
-    if (!cookie_header) return NULL;
-
-    cookie_header[0] = '\0';
-    size_t used = 0;
-    bool first = true;
-
-    cookie_t *cookie = session->cookies;
-    while (cookie) {
-        /* Check if cookie matches request */
-        bool domain_match = (strcasecmp(cookie->domain, domain) == 0 ||
-                            (cookie->domain[0] == '.' && strstr(domain, cookie->domain + 1) != NULL));
-        bool path_match = (strncmp(cookie->path, path, strlen(cookie->path)) == 0);
-        bool secure_match = (!cookie->secure || is_secure);
-
-        if (domain_match && path_match && secure_match) {
-            /* Calculate space needed: "; " + name + "=" + value */
-            size_t needed = strlen(cookie->name) + 1 + strlen(cookie->value);
-            if (!first) needed += 2;  /* "; " prefix */
-
-            /* Check if we have space (leave room for null terminator) */
-            if (used + needed >= buffer_size - 1) {
-                /* Buffer would overflow - stop adding cookies */
-                break;
+char* cookie_jar_header(cookie_jar_t *jar, const char *host, const char *path,
+                        bool is_secure, time_t now) {
+    if (!jar || !host || !path) {
+        return NULL;
+    }
+    cookie_jar_prune(jar, now);
+    if (jar->count == 0) {
+        return NULL;
+    }
+
+    size_t host_len = strlen(host);
+    if (host_len > 0 && host[host_len - 1] == '.') {
+        host_len--;
+    }
+    char *host_lc = cookie_lower_dup(host, host_len);
+    if (!host_lc) {
+        return NULL;
+    }
+    size_t path_len = strcspn(path, "?#");
+    if (path_len == 0) {
+        path = "/";
+        path_len = 1;
+    }
+
+    cookie_t *stack_matches[32];
+    cookie_t **matches = stack_matches;
+    size_t match_count = 0, match_capacity = 32;
+    size_t total = 0;
+    bool failed = false;
+
+    /* The host itself, then each parent domain (an IP has no parents) */
+    bool is_ip = cookie_host_is_ip(host_lc, host_len);
+    const char *suffix = host_lc;
+    size_t suffix_len = host_len;
+    while (suffix_len > 0 && !failed) {
+        bool exact = suffix == host_lc;
+        cookie_domain_t *d = cookie_domain_find(jar, suffix, suffix_len, cookie_hash(suffix, suffix_len));
+        for (cookie_path_t *p = d ? d->paths : NULL; p && !failed; p = p->next) {
+            if (!cookie_path_matches(p, path, path_len)) {
+                continue;
+            }
+            for (cookie_t *c = p->head; c; c = c->next) {
+                if ((c->host_only && !exact) || (c->secure && !is_secure)) {
+                    continue;
+                }
+                if (match_count == match_capacity) {
+                    size_t capacity = match_capacity * 2;
+                    cookie_t **grown = malloc(capacity * sizeof(cookie_t*));
+                    if (!grown) {
+                        failed = true;
+                        break;
+                    }
+                    memcpy(grown, matches, match_count * sizeof(cookie_t*));
+                    if (matches != stack_matches) free(matches);
+                    matches = grown;
+                    match_capacity = capacity;
+                }
+                matches[match_count++] = c;
+                total += c->name_len + 1 + c->value_len + 2;
             }
+        }
+
+        if (is_ip) {
+            break;
+        }
+        const char *dot = memchr(suffix, '.', suffix_len);
+        if (!dot) {
+            break;
+        }
+        suffix_len -= (size_t)(dot + 1 - suffix);
+        suffix = dot + 1;
+    }
+    free(host_lc);
 
-            /* Safe concatenation with bounds checking */
-            if (!first) {
-                used += snprintf(cookie_header + used, buffer_size - used, "; ");
+    char *header = NULL;
+    if (!failed && match_count > 0) {
+        qsort(matches, match_count, sizeof(cookie_t*), cookie_order);
+        header = malloc(total - 1);  /* Last "; " becomes the terminator */
+    }
+    if (header) {
+        char *out = header;
+        for (size_t i = 0; i < match_count; i++) {
+            const cookie_t *c = matches[i];
+            if (i > 0) {
+                *out++ = ';';
+                *out++ = ' ';
             }
-            used += snprintf(cookie_header + used, buffer_size - used, "%s=%s",
-                           cookie->name, cookie->value);
-            first = false;
+            memcpy(out, c->name, c->name_len);
+            out += c->name_len;
+            *out++ = '=';
+            memcpy(out, c->value, c->value_len);
+            out += c->value_len;
         }
+        *out = '\0';
+    }
 
-        cookie = cookie->next;
+    if (matches != stack_matches) {
+        free(matches);
     }
+    return header;
+}
 
-    if (cookie_header[0] == '\0') {
-        free(cookie_header);
-        return NULL;
+/**
+ * Free a cookie structure
+ */
+void httpmorph_cookie_free(cookie_t *cookie) {
+    if (!cookie) return;
+    free(cookie->name);
+    free(cookie->value);
+    free(cookie->domain);
+    free(cookie->path);
+    free(cookie);
+}
+
+/**
+ * Parse Set-Cookie header and add to session
+ */
+void httpmorph_parse_set_cookie(httpmorph_session_t *session,
+                                 const char *header_value,
+                                 const char *request_domain) {
+    if (!session || !header_value || !request_domain) {
+        return;
     }
+    cookie_jar_set(session->cookie_jar, header_value, request_domain, time(NULL));
+}
 
-    return cookie_header;
+/**
+ * Get cookies for a request as a Cookie header value
+ */
+char* httpmorph_get_cookies_for_request(httpmorph_session_t *session,
+                                         const char *domain,
+                                         const char *path,
+                                         bool is_secure) {
+    if (!session || !domain || !path) return NULL;
+    return cookie_jar_header(session->cookie_jar, domain, path, is_secure, time(NULL));
 }
@@ -12,8 +12,16 @@
 #include "internal/http1.h"
 #include "internal/http2_logic.h"
 #include "internal/response.h"
+#include "internal/request.h"
+#include "internal/session.h"
 #include "connection_pool.h"
+#include "http_cache.h"
+#include "proxy_set.h"
+#include "request_scheduler.h"
+#include "trace.h"
 
+#include <openssl/rand.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -27,18 +35,88 @@
 #endif
 
 /**
- * Execute an HTTP request (main orchestration function)
+ * Mark a new pooled connection as proxied
+ * The proxy is already part of its key, so nothing else is recorded.
  */
-httpmorph_response_t* httpmorph_request_execute(
-    httpmorph_client_t *client,
-    const httpmorph_request_t *request,
-    httpmorph_pool_t *pool) {
+static void core_mark_proxied(pooled_connection_t *conn, const httpmorph_request_t *request) {
+    conn->is_proxy = request->proxy_url != NULL;
+}
 
-    if (!client || !request || !request->url) {
+#ifdef HAVE_NGHTTP2
+/**
+ * Wrap a new HTTP/2 connection so its session survives the request
+ * The connection is pooled afterwards; direct ones may be coalesced by
+ * other origins unless they carry a rotated fingerprint
+ */
+static pooled_connection_t* core_wrap_http2_connection(const char *pool_key, int sockfd, SSL *ssl,
+                                                       const httpmorph_request_t *request,
+                                                       const httpmorph_response_t *response,
+                                                       bool coalesce) {
+    pooled_connection_t *conn = pool_connection_create_with_key(pool_key, sockfd, ssl, true);
+    if (!conn) {
         return NULL;
     }
 
-    httpmorph_response_t *response = httpmorph_response_create(client->buffer_pool);
+    conn->ja3_fingerprint = response->ja3_fingerprint;
+    conn->tls_version = response->tls_version;
+    conn->tls_cipher = response->tls_cipher;
+
+    if (request->proxy_url) {
+        core_mark_proxied(conn, request);
+    } else if (coalesce) {
+        pool_connection_enable_coalescing(conn, request->verify_ssl);
+    }
+    return conn;
+}
+#endif
+
+/**
+ * Check if a direct connection may use TCP Fast Open: the request asks for
+ * it, the browser profile does it too, and plain HTTP only puts a
+ * replayable request in the SYN
+ */
+static bool core_fast_open(const httpmorph_client_t *client, const httpmorph_request_t *request,
+                           bool use_tls) {
+    if (!request->tcp_fast_open || request->proxy_url ||
+        !client->browser_profile || !client->browser_profile->tcp_fast_open) {
+        return false;
+    }
+    return use_tls || httpmorph_request_is_replayable(request);
+}
+
+/**
+ * Pick a fingerprint variant for a request that rotates its fingerprint
+ */
+static unsigned int core_pick_variant(void) {
+    uint8_t byte = 0;
+    if (RAND_bytes(&byte, 1) != 1) {
+        return 0;
+    }
+    return byte % BROWSER_PROFILE_VARIANTS;
+}
+
+/**
+ * Decompress a body that servers gzipped without saying so (caught by the
+ * gzip magic bytes)
+ */
+static void core_decode_unlabelled_gzip(const httpmorph_request_t *request,
+                                        httpmorph_response_t *response) {
+    if (!request->body_callback && response->body_len >= 2 &&
+        response->body[0] == 0x1f && response->body[1] == 0x8b &&
+        !httpmorph_response_get_header(response, "Content-Encoding")) {
+        httpmorph_decompress_gzip(response);
+    }
+}
+
+/**
+ * Execute an HTTP request over the network (main orchestration function)
+ */
+static httpmorph_response_t* core_execute_network(
+    httpmorph_client_t *client,
+    const httpmorph_request_t *request,
+    httpmorph_pool_t *pool) {
+
+    httpmorph_response_t *response = httpmorph_response_create_with_arena(client->buffer_pool, request->_arena);
     if (!response) {
         return NULL;
     }
@@ -46,10 +124,12 @@ httpmorph_response_t* httpmorph_request_execute(
     uint64_t start_time = httpmorph_get_time_us();
     int sockfd = -1;
     SSL *ssl = NULL;
+    char *proxy_host = NULL;
     char *proxy_user = NULL;
     char *proxy_pass = NULL;
     pooled_connection_t *pooled_conn = NULL;  /* Track if we got connection from pool */
     bool use_http2 = false;  /* Track if HTTP/2 is being used */
+    char pool_key[POOL_MAX_HOST_KEY_LEN] = "";  /* Empty: connection is not pooled */
 
     /* Parse URL */
     char *scheme = NULL, *host = NULL, *path = NULL;
@@ -62,152 +142,179 @@ httpmorph_response_t* httpmorph_request_execute(
     }
 
     bool use_tls = (strcmp(scheme, "https") == 0);
+    bool fast_open = core_fast_open(client, request, use_tls);
+
+    /* Browser fingerprint: the client's, or one of its variants when rotating */
+    const browser_profile_t *profile = client->browser_profile;
+    SSL_CTX *ssl_ctx = client->ssl_ctx;
+    unsigned int variant = 0;
+    if (request->rotate_fingerprint && use_tls) {
+        variant = core_pick_variant();
+        if (httpmorph_client_variant(client, variant, &profile, &ssl_ctx) != 0) {
+            response->error = HTTPMORPH_ERROR_TLS;
+            response->error_message = strdup("Failed to create SSL context for fingerprint variant");
+            goto cleanup;
+        }
+    }
 
     /* 1. TCP Connection (direct or via proxy) */
     uint64_t connect_time = 0;
+    uint64_t dns_time = 0;
+    uint16_t proxy_port = 0;
+    bool proxy_use_tls = false;
+    httpmorph_proxy_type_t proxy_type = httpmorph_proxy_type(request->proxy_url);
+    bool socks = proxy_type == HTTPMORPH_PROXY_SOCKS5 || proxy_type == HTTPMORPH_PROXY_SOCKS5H;
 
     if (request->proxy_url) {
-        /* Connect via proxy - try pool first for connection reuse */
-        char *proxy_host = NULL;
-        uint16_t proxy_port = 0;
-        bool proxy_use_tls = false;
-        SSL *proxy_ssl = NULL;
+        /* Parse proxy URL */
+        if (httpmorph_parse_proxy_url(request->proxy_url, &proxy_host, &proxy_port,
+                           &proxy_user, &proxy_pass, &proxy_use_tls) != 0) {
+            response->error = HTTPMORPH_ERROR_INVALID_PARAM;
+            response->error_message = strdup("Invalid proxy URL");
+            goto cleanup;
+        }
 
-        /* Don't use connection pool for proxy connections - they are not pooled
-         * due to SSL_CTX use-after-free issues (see line 532 below).
-         * If we retrieve a connection from pool here, it would be a stale direct
-         * connection which cannot be used for proxy requests. */
+        /* Override with explicit credentials if provided */
+        if (request->proxy_username) {
+            free(proxy_user);
+            proxy_user = strdup(request->proxy_username);
+        }
+        if (request->proxy_password) {
+            free(proxy_pass);
+            proxy_pass = strdup(request->proxy_password);
+        }
 
-        /* If no pooled connection, create new proxy connection */
-        if (sockfd < 0) {
-            /* Parse proxy URL */
-            if (httpmorph_parse_proxy_url(request->proxy_url, &proxy_host, &proxy_port,
-                               &proxy_user, &proxy_pass, &proxy_use_tls) != 0) {
-                response->error = HTTPMORPH_ERROR_INVALID_PARAM;
-                response->error_message = strdup("Invalid proxy URL");
-                goto cleanup;
-            }
+        /* Tunnels (CONNECT and SOCKS5) are pooled per target, proxy and
+         * credentials; plain HTTP forwarded by the proxy only per proxy and
+         * credentials. Connections to a TLS proxy are not pooled (the target
+         * TLS replaces the proxy's) */
+        if (!proxy_use_tls) {
+            pool_build_proxy_key(use_tls || socks ? host : NULL, port, request->proxy_url,
+                                 proxy_user, proxy_pass, pool_key);
+        }
+    } else {
+        pool_build_host_key(host, port, pool_key);
+    }
+    pool_key_add_variant(pool_key, variant);
 
-            /* Override with explicit credentials if provided */
-            if (request->proxy_username) {
-                free(proxy_user);
-                proxy_user = strdup(request->proxy_username);
-            }
-            if (request->proxy_password) {
-                free(proxy_pass);
-                proxy_pass = strdup(request->proxy_password);
-            }
+    /* Try pool first for connection reuse */
+    if (pool && pool_key[0]) {
+        pooled_conn = pool_get_connection_by_key(pool, pool_key);
+#ifdef HAVE_NGHTTP2
+        if (!pooled_conn && use_tls && request->http2_enabled && !request->proxy_url && variant == 0) {
+            /* Another origin's HTTP/2 connection may be authoritative for this host */
+            pooled_conn = pool_get_coalesced_connection(pool, host, port, request->verify_ssl,
+                                                        request->timeout_ms);
+        }
+#endif
+        if (pooled_conn) {
+            /* Reuse existing connection from pool */
+            sockfd = pooled_conn->sockfd;
+            ssl = pooled_conn->ssl;
+            use_http2 = pooled_conn->is_http2;  /* Use same protocol as pooled connection */
 
-            /* Connect to proxy server */
-            sockfd = httpmorph_tcp_connect(proxy_host, proxy_port, request->timeout_ms, &connect_time);
-            if (sockfd < 0) {
-                free(proxy_host);
-                free(proxy_user);
-                free(proxy_pass);
-                proxy_user = NULL;
-                proxy_pass = NULL;
-                response->error = HTTPMORPH_ERROR_NETWORK;
-                response->error_message = strdup("Failed to connect to proxy");
-                goto cleanup;
-            }
+            /* Restore TLS info from pooled connection BEFORE potential destruction */
+            if (sockfd >= 0) {
+                /* Connection reused - no connect/TLS time */
+                connect_time = 0;
+                response->tls_time_us = 0;
 
-            /* If proxy uses TLS, establish TLS connection to proxy */
-            if (proxy_use_tls) {
-                uint64_t proxy_tls_time = 0;
-                proxy_ssl = httpmorph_tls_connect(client->ssl_ctx, sockfd, proxy_host, client->browser_profile,
-                                       false, request->verify_ssl, &proxy_tls_time);
-                if (!proxy_ssl) {
-                    if (sockfd > 2) close(sockfd);
-                    sockfd = -1;
-                    free(proxy_host);
-                    free(proxy_user);
-                    free(proxy_pass);
-                    proxy_user = NULL;
-                    proxy_pass = NULL;
-                    response->error = HTTPMORPH_ERROR_TLS;
-                    response->error_message = strdup("Failed to establish TLS with proxy");
-                    goto cleanup;
-                }
+                /* Fingerprint from the connection's handshake, shared by reference */
+                response->ja3_fingerprint = client->tls_fingerprint
+                    ? (char *)pooled_conn->ja3_fingerprint : NULL;
+                response->tls_version = (char *)pooled_conn->tls_version;
+                response->tls_cipher = (char *)pooled_conn->tls_cipher;
             }
 
-            /* For HTTPS destinations, send CONNECT request to establish tunnel */
-            if (use_tls) {
-                if (httpmorph_proxy_connect(sockfd, proxy_ssl, host, port, proxy_user, proxy_pass,
-                                request->timeout_ms) != 0) {
-                    if (proxy_ssl) SSL_free(proxy_ssl);
-                    if (sockfd > 2) close(sockfd);
+            /* For SSL connections, verify still valid before reuse */
+            if (ssl) {
+                int shutdown_state = SSL_get_shutdown(ssl);
+                if (shutdown_state != 0) {
+                    /* SSL was shut down - destroy and recreate */
+                    pool_connection_destroy(pooled_conn);
+                    pooled_conn = NULL;
                     sockfd = -1;
-                    free(proxy_host);
-                    free(proxy_user);
-                    free(proxy_pass);
-                    proxy_user = NULL;
-                    proxy_pass = NULL;
-                    response->error = HTTPMORPH_ERROR_NETWORK;
-                    response->error_message = strdup("Proxy CONNECT failed");
-                    goto cleanup;
-                }
-                /* After CONNECT succeeds, we have a tunnel - free proxy SSL as we'll establish new TLS to destination */
-                if (proxy_ssl) {
-                    SSL_free(proxy_ssl);
-                    proxy_ssl = NULL;
+                    ssl = NULL;
+                    response->ja3_fingerprint = NULL;
+                    response->tls_version = NULL;
+                    response->tls_cipher = NULL;
                 }
             }
+        }
+    }
 
-            free(proxy_host);
+    /* If no pooled connection, create new one */
+    if (sockfd < 0 && request->proxy_url) {
+        SSL *proxy_ssl = NULL;
+
+        /* Connect to proxy server */
+        sockfd = httpmorph_tcp_connect(proxy_host, proxy_port, request->timeout_ms, false, &connect_time, &dns_time);
+        if (sockfd < 0) {
+            response->error = HTTPMORPH_ERROR_NETWORK;
+            response->error_message = strdup("Failed to connect to proxy");
+            goto cleanup;
         }
-        /* Keep proxy_user and proxy_pass for HTTP proxy requests - will be freed later */
-    } else {
-        /* Direct connection - try pool first for connection reuse */
-        if (pool) {
-            pooled_conn = pool_get_connection(pool, host, port);
-            if (pooled_conn) {
-                /* Reuse existing connection from pool */
-                sockfd = pooled_conn->sockfd;
-                ssl = pooled_conn->ssl;
-                use_http2 = pooled_conn->is_http2;  /* Use same protocol as pooled connection */
-
-                /* Restore TLS info from pooled connection BEFORE potential destruction */
-                if (sockfd >= 0) {
-                    /* Connection reused - no connect/TLS time */
-                    connect_time = 0;
-                    response->tls_time_us = 0;
-
-                    if (pooled_conn->ja3_fingerprint) {
-                        response->ja3_fingerprint = strdup(pooled_conn->ja3_fingerprint);
-                    }
-                }
 
-                /* For SSL connections, verify still valid before reuse */
-                if (ssl) {
-                    int shutdown_state = SSL_get_shutdown(ssl);
-                    if (shutdown_state != 0) {
-                        /* SSL was shut down - destroy and recreate */
-                        pool_connection_destroy(pooled_conn);
-                        pooled_conn = NULL;
-                        sockfd = -1;
-                        ssl = NULL;
-                    }
-                }
-            } else {
+        /* SOCKS5 tunnels carry plain HTTP as well as TLS */
+        if (socks) {
+            if (httpmorph_socks5_connect(sockfd, host, port, proxy_type == HTTPMORPH_PROXY_SOCKS5H,
+                                         proxy_user, proxy_pass, request->timeout_ms) != 0) {
+                if (sockfd > 2) close(sockfd);
+                sockfd = -1;
+                response->error = HTTPMORPH_ERROR_NETWORK;
+                response->error_message = strdup("SOCKS5 proxy handshake failed");
+                goto cleanup;
             }
         }
 
-        /* If no pooled connection, create new one */
-        if (sockfd < 0) {
-            sockfd = httpmorph_tcp_connect(host, port, request->timeout_ms, &connect_time);
-            if (sockfd < 0) {
+        /* If proxy uses TLS, establish TLS connection to proxy */
+        if (proxy_use_tls) {
+            uint64_t proxy_tls_time = 0;
+            proxy_ssl = httpmorph_tls_connect(ssl_ctx, client->session_cache, sockfd, proxy_host, proxy_port, profile,
+                                   false, request->verify_ssl, &proxy_tls_time);
+            if (!proxy_ssl) {
+                if (sockfd > 2) close(sockfd);
+                sockfd = -1;
+                response->error = HTTPMORPH_ERROR_TLS;
+                response->error_message = strdup("Failed to establish TLS with proxy");
+                goto cleanup;
+            }
+        }
+
+        /* For HTTPS destinations, send CONNECT request to establish tunnel */
+        if (use_tls && !socks) {
+            if (httpmorph_proxy_connect(sockfd, proxy_ssl, host, port, proxy_user, proxy_pass,
+                            request->timeout_ms) != 0) {
+                if (proxy_ssl) SSL_free(proxy_ssl);
+                if (sockfd > 2) close(sockfd);
+                sockfd = -1;
                 response->error = HTTPMORPH_ERROR_NETWORK;
-                response->error_message = strdup("Failed to connect");
+                response->error_message = strdup("Proxy CONNECT failed");
                 goto cleanup;
             }
         }
+        /* We have a tunnel (or sent nothing yet) - free proxy SSL as we'll establish new TLS to destination */
+        if (proxy_ssl) {
+            SSL_free(proxy_ssl);
+            proxy_ssl = NULL;
+        }
+        /* Keep proxy_user and proxy_pass for HTTP proxy requests - will be freed later */
+    } else if (sockfd < 0) {
+        sockfd = httpmorph_tcp_connect(host, port, request->timeout_ms, fast_open, &connect_time, &dns_time);
+        if (sockfd < 0) {
+            response->error = HTTPMORPH_ERROR_NETWORK;
+            response->error_message = strdup("Failed to connect");
+            goto cleanup;
+        }
     }
     response->connect_time_us = connect_time;
+    response->dns_time_us = dns_time;
+    response->connection_reused = pooled_conn != NULL;
 
     /* 2. TLS Handshake (if HTTPS and not reused) */
     if (use_tls && !ssl) {
         uint64_t tls_time = 0;
-        ssl = httpmorph_tls_connect(client->ssl_ctx, sockfd, host, client->browser_profile,
+        ssl = httpmorph_tls_connect(ssl_ctx, client->session_cache, sockfd, host, port, profile,
                          request->http2_enabled, request->verify_ssl, &tls_time);
         if (!ssl) {
             response->error = HTTPMORPH_ERROR_TLS;
@@ -215,9 +322,11 @@ httpmorph_response_t* httpmorph_request_execute(
             goto cleanup;
         }
         response->tls_time_us = tls_time;
+        response->tls_resumed = SSL_session_reused(ssl) == 1;
 
-        /* Calculate JA3 fingerprint (only for new connections) */
-        response->ja3_fingerprint = httpmorph_calculate_ja3(ssl, client->browser_profile);
+        /* JA3 fingerprint (only for new connections; cached per profile and version) */
+        response->ja3_fingerprint = client->tls_fingerprint
+            ? (char *)httpmorph_tls_ja3(ssl, profile) : NULL;
 
         /* Check negotiated ALPN protocol */
         const unsigned char *alpn_data = NULL;
@@ -250,13 +359,16 @@ httpmorph_response_t* httpmorph_request_execute(
         }
     }
 
-    /* Extract TLS info for all HTTPS connections (new and reused) */
-    if (use_tls && ssl) {
+    /* TLS info for connections that didn't bring it from the pool (static strings) */
+    if (use_tls && ssl && !response->tls_version) {
         const SSL_CIPHER *cipher = SSL_get_current_cipher(ssl);
         if (cipher) {
-            response->tls_cipher = strdup(SSL_CIPHER_get_name(cipher));
+            response->tls_cipher = (char *)SSL_CIPHER_get_name(cipher);
+        }
+        response->tls_version = (char *)SSL_get_version(ssl);
+        if (!response->ja3_fingerprint && client->tls_fingerprint) {
+            response->ja3_fingerprint = (char *)httpmorph_tls_ja3(ssl, profile);
         }
-        response->tls_version = strdup(SSL_get_version(ssl));
     }
 
 #ifdef HAVE_NGHTTP2
@@ -264,6 +376,7 @@ httpmorph_response_t* httpmorph_request_execute(
     if (use_http2) {
         uint64_t first_byte_time = httpmorph_get_time_us();
         int http2_result;
+        bool reused_conn = pooled_conn != NULL;
 
         /* Use pooled version for session reuse if connection came from pool */
         if (pooled_conn && pooled_conn->is_http2) {
@@ -274,10 +387,41 @@ httpmorph_response_t* httpmorph_request_execute(
                 /* Fall back to sequential pooled version */
                 http2_result = httpmorph_http2_request_pooled(pooled_conn, request, host, path, response);
             }
+        } else if (!pooled_conn && pool && pool_key[0] &&
+                   (pooled_conn = core_wrap_http2_connection(pool_key, sockfd, ssl,
+                                                             request, response, variant == 0)) != NULL) {
+            /* New connection: keep its session so it can be pooled */
+            http2_result = httpmorph_http2_request_pooled(pooled_conn, request, host, path, response);
         } else {
             http2_result = httpmorph_http2_request(ssl, request, host, path, response);
         }
 
+        /* Retry on a new connection when a reused one was stale (nothing received)
+         * or, having been coalesced, answered 421 Misdirected Request */
+        bool stale = http2_result != 0 && reused_conn && response->status_code == 0 &&
+                     !request->body_source &&
+                     httpmorph_get_time_us() - start_time < (uint64_t)request->timeout_ms * 1000;
+        bool misdirected = http2_result == 0 && reused_conn && response->status_code == 421 &&
+                           !request->body_callback && !request->body_source &&
+                           pool_connection_is_coalesced(pooled_conn, host, port);
+        if (stale || misdirected) {
+            if (misdirected) {
+                /* The connection still serves its own origins */
+                pool_connection_mark_misdirected(pooled_conn, host);
+                pool_put_connection(pool, pooled_conn);
+            } else {
+                pool_connection_destroy(pooled_conn);
+            }
+            free(scheme);
+            free(host);
+            free(path);
+            free(proxy_host);
+            free(proxy_user);
+            free(proxy_pass);
+            httpmorph_response_destroy(response);
+            return core_execute_network(client, request, pool);
+        }
+
         if (http2_result != 0) {
             response->error = HTTPMORPH_ERROR_NETWORK;
             response->error_message = strdup("HTTP/2 request failed");
@@ -289,10 +433,14 @@ httpmorph_response_t* httpmorph_request_execute(
 #endif
 
     /* 3. Send HTTP/1.x Request */
-    bool using_proxy = (request->proxy_url != NULL);
+    bool using_proxy = (request->proxy_url != NULL && !socks);  /* Absolute-form through HTTP proxies */
     if (httpmorph_send_http_request(ssl, sockfd, request, host, path, scheme, port, using_proxy, proxy_user, proxy_pass) != 0) {
-        /* If send failed on a pooled connection, retry with fresh connection */
-        if (pooled_conn) {
+        /* If send failed on a pooled connection, retry with fresh connection
+         * (a streamed body can't be read again) */
+        if (pooled_conn && !request->body_source && request->proxy_url) {
+            /* Stale tunnel: start over through the proxy */
+            goto retry_stale;
+        } else if (pooled_conn && !request->body_source) {
             /* Destroy the stale pooled connection */
             pool_connection_destroy(pooled_conn);
             pooled_conn = NULL;
@@ -300,18 +448,20 @@ httpmorph_response_t* httpmorph_request_execute(
             ssl = NULL;
 
             /* Create new connection */
-            sockfd = httpmorph_tcp_connect(host, port, request->timeout_ms, &connect_time);
+            sockfd = httpmorph_tcp_connect(host, port, request->timeout_ms, fast_open, &connect_time, &dns_time);
             if (sockfd < 0) {
                 response->error = HTTPMORPH_ERROR_NETWORK;
                 response->error_message = strdup("Failed to connect after retry");
                 goto cleanup;
             }
             response->connect_time_us = connect_time;
+            response->dns_time_us = dns_time;
+            response->connection_reused = false;
 
             /* New TLS handshake if needed */
             if (use_tls) {
                 uint64_t tls_time = 0;
-                ssl = httpmorph_tls_connect(client->ssl_ctx, sockfd, host, client->browser_profile,
+                ssl = httpmorph_tls_connect(ssl_ctx, client->session_cache, sockfd, host, port, profile,
                                 request->http2_enabled, request->verify_ssl, &tls_time);
                 if (!ssl) {
                     response->error = HTTPMORPH_ERROR_TLS;
@@ -319,6 +469,7 @@ httpmorph_response_t* httpmorph_request_execute(
                     goto cleanup;
                 }
                 response->tls_time_us = tls_time;
+                response->tls_resumed = SSL_session_reused(ssl) == 1;
             }
 
             /* Retry sending request with fresh connection */
@@ -338,10 +489,12 @@ httpmorph_response_t* httpmorph_request_execute(
     /* 4. Receive HTTP/1.x Response */
     uint64_t first_byte_time = 0;
     bool connection_will_close = false;
-    int recv_result = httpmorph_recv_http_response(ssl, sockfd, response, &first_byte_time, &connection_will_close, request->method);
+    int recv_result = httpmorph_recv_http_response(ssl, sockfd, response, &first_byte_time, &connection_will_close, request, NULL);
 
     /* If pooled connection failed, retry with new connection */
-    if (recv_result != 0 && pooled_conn) {
+    if (recv_result != 0 && pooled_conn && !request->body_source && request->proxy_url) {
+        goto retry_stale;
+    } else if (recv_result != 0 && pooled_conn && !request->body_source) {
 
         /* Destroy the failed pooled connection */
         pool_connection_destroy(pooled_conn);
@@ -350,18 +503,20 @@ httpmorph_response_t* httpmorph_request_execute(
         ssl = NULL;
 
         /* Create new connection */
-        sockfd = httpmorph_tcp_connect(host, port, request->timeout_ms, &connect_time);
+        sockfd = httpmorph_tcp_connect(host, port, request->timeout_ms, fast_open, &connect_time, &dns_time);
         if (sockfd < 0) {
             response->error = HTTPMORPH_ERROR_NETWORK;
             response->error_message = strdup("Failed to connect");
             goto cleanup;
         }
         response->connect_time_us = connect_time;
+        response->dns_time_us = dns_time;
+        response->connection_reused = false;
 
         /* New TLS handshake */
         if (use_tls) {
             uint64_t tls_time = 0;
-            ssl = httpmorph_tls_connect(client->ssl_ctx, sockfd, host, client->browser_profile,
+            ssl = httpmorph_tls_connect(ssl_ctx, client->session_cache, sockfd, host, port, profile,
                              request->http2_enabled, request->verify_ssl, &tls_time);
             if (!ssl) {
                 response->error = HTTPMORPH_ERROR_TLS;
@@ -369,14 +524,11 @@ httpmorph_response_t* httpmorph_request_execute(
                 goto cleanup;
             }
             response->tls_time_us = tls_time;
+            response->tls_resumed = SSL_session_reused(ssl) == 1;
         }
 
         /* Reset response completely for retry */
-        for (size_t i = 0; i < response->header_count; i++) {
-            free(response->headers[i].key);
-            free(response->headers[i].value);
-        }
-        response->header_count = 0;
+        httpmorph_response_clear_headers(response);
         response->body_len = 0;
         response->status_code = 0;
 
@@ -388,7 +540,7 @@ httpmorph_response_t* httpmorph_request_execute(
         }
 
         /* Retry receiving response */
-        recv_result = httpmorph_recv_http_response(ssl, sockfd, response, &first_byte_time, &connection_will_close, request->method);
+        recv_result = httpmorph_recv_http_response(ssl, sockfd, response, &first_byte_time, &connection_will_close, request, NULL);
     }
 
     if (recv_result == 0) {
@@ -398,6 +550,8 @@ httpmorph_response_t* httpmorph_request_execute(
         response->error = recv_result;
         if (recv_result == HTTPMORPH_ERROR_TIMEOUT) {
             response->error_message = strdup("Request timed out");
+        } else if (recv_result == HTTPMORPH_ERROR_PARSE) {
+            response->error_message = strdup("Malformed or oversized response headers");
         } else {
             response->error_message = strdup("Failed to receive response");
         }
@@ -409,30 +563,16 @@ httpmorph_response_t* httpmorph_request_execute(
 http2_done:
 #endif
 
-    /* 5. Decompress gzip if Content-Encoding: gzip or body starts with gzip magic bytes */
+    /* 5. Bodies are decoded per Content-Encoding as they are received */
     {
-        const char *content_encoding = httpmorph_response_get_header(response, "Content-Encoding");
-        bool should_decompress = false;
-
-    if (content_encoding && strstr(content_encoding, "gzip")) {
-        should_decompress = true;
-    }
-
-    /* Also check for gzip magic bytes (0x1f 0x8b) */
-    if (!should_decompress && response->body_len >= 2 &&
-        response->body[0] == 0x1f && response->body[1] == 0x8b) {
-        should_decompress = true;
-    }
-
-    if (should_decompress) {
-        httpmorph_decompress_gzip(response);
-    }
+    core_decode_unlabelled_gzip(request, response);
 
         /* 6. Check if total time exceeded timeout (only if no error yet) */
+        /* Streamed transfers may legitimately outlast it; reads are bounded per call */
         if (response->error == HTTPMORPH_OK || response->error == 0) {
             uint64_t elapsed_us = httpmorph_get_time_us() - start_time;
             uint64_t timeout_us = (uint64_t)request->timeout_ms * 1000;
-            if (elapsed_us > timeout_us) {
+            if (elapsed_us > timeout_us && !request->body_callback) {
                 response->error = HTTPMORPH_ERROR_TIMEOUT;
                 response->error_message = strdup("Request timed out");
             } else {
@@ -470,48 +610,21 @@ cleanup:
         if (!conn_to_pool) {
             /* New connection - create wrapper */
             bool use_http2 = (response->http_version == HTTPMORPH_VERSION_2_0);
-            /* Don't pool HTTP/2 connections - HTTP/2 pooling has reliability issues */
-            /* Don't pool proxy connections - they can cause SSL_CTX use-after-free issues */
-            if (use_http2 || request->proxy_url) {
+            /* HTTP/2 connections are wrapped (and pooled) before the request;
+             * one that couldn't be has no session to pool */
+            if (use_http2 || !pool_key[0]) {
                 conn_to_pool = NULL;
             } else {
-                conn_to_pool = pool_connection_create(host, port, sockfd, ssl, use_http2);
+                conn_to_pool = pool_connection_create_with_key(pool_key, sockfd, ssl, use_http2);
                 /* Store TLS info in pooled connection for future reuse with error checking */
                 if (conn_to_pool && ssl) {
-                    bool alloc_failed = false;
-
-                    if (response->ja3_fingerprint) {
-                        conn_to_pool->ja3_fingerprint = strdup(response->ja3_fingerprint);
-                        if (!conn_to_pool->ja3_fingerprint) alloc_failed = true;
-                    }
-                    if (response->tls_version && !alloc_failed) {
-                        conn_to_pool->tls_version = strdup(response->tls_version);
-                        if (!conn_to_pool->tls_version) alloc_failed = true;
-                    }
-                    if (response->tls_cipher && !alloc_failed) {
-                        conn_to_pool->tls_cipher = strdup(response->tls_cipher);
-                        if (!conn_to_pool->tls_cipher) alloc_failed = true;
-                    }
-
-                    /* If any allocation failed, destroy connection instead of pooling */
-                    if (alloc_failed) {
-                        pool_connection_destroy(conn_to_pool);
-                        conn_to_pool = NULL;
-                    }
+                    conn_to_pool->ja3_fingerprint = response->ja3_fingerprint;
+                    conn_to_pool->tls_version = response->tls_version;
+                    conn_to_pool->tls_cipher = response->tls_cipher;
                 }
                 /* Store proxy info for proxy connections */
-                if (conn_to_pool && request->proxy_url) {
-                    conn_to_pool->is_proxy = true;
-                    /* Free old values if already set (connection reuse) */
-                    if (conn_to_pool->proxy_url) {
-                        free(conn_to_pool->proxy_url);
-                    }
-                    if (conn_to_pool->target_host) {
-                        free(conn_to_pool->target_host);
-                    }
-                    conn_to_pool->proxy_url = strdup(request->proxy_url);
-                    conn_to_pool->target_host = strdup(host);
-                    conn_to_pool->target_port = port;
+                if (conn_to_pool) {
+                    core_mark_proxied(conn_to_pool, request);
                 }
             }
         }
@@ -551,15 +664,626 @@ cleanup:
     free(scheme);
     free(host);
     free(path);
+    free(proxy_host);
+    free(proxy_user);
+    free(proxy_pass);
+
+    response->total_time_us = httpmorph_get_time_us() - start_time;
+
+    return response;
+
+retry_stale:
+    /* A reused tunnel failed before anything was received: the retry goes
+     * back through the proxy (and the pool, which drops stale tunnels) */
+    pool_connection_destroy(pooled_conn);
+    free(scheme);
+    free(host);
+    free(path);
+    free(proxy_host);
     free(proxy_user);
     free(proxy_pass);
+    httpmorph_response_destroy(response);
+    return core_execute_network(client, request, pool);
+}
 
-    /* Automatically decompress response body if compressed */
-    if (response->error == HTTPMORPH_OK) {
-        httpmorph_auto_decompress(response);
+/**
+ * Execute a request over the network, through the client's proxy set when
+ * it has one and the request names no proxy of its own
+ */
+static httpmorph_response_t* core_execute_routed(
+    httpmorph_client_t *client,
+    const httpmorph_request_t *request,
+    httpmorph_pool_t *pool) {
+
+    if (!client->proxy_set || request->proxy_url) {
+        return core_execute_network(client, request, pool);
     }
 
-    response->total_time_us = httpmorph_get_time_us() - start_time;
+    proxy_set_pick_t pick;
+    if (proxy_set_pick(client->proxy_set, request->url, &pick) != 0) {
+        /* An empty set must not silently fall back to a direct connection */
+        httpmorph_response_t *response = httpmorph_response_create_with_arena(client->buffer_pool,
+                                                                              request->_arena);
+        if (response) {
+            response->error = HTTPMORPH_ERROR_NETWORK;
+            response->error_message = httpmorph_response_strdup(response, "No proxy available");
+        }
+        return response;
+    }
 
+    httpmorph_request_t routed = *request;
+    routed.proxy_url = (char *)pick.url;
+    routed.proxy_username = (char *)pick.username;
+    routed.proxy_password = (char *)pick.password;
+
+    httpmorph_response_t *response = core_execute_network(client, &routed, pool);
+    proxy_set_report(client->proxy_set, &pick, response);
     return response;
 }
+
+/**
+ * Execute a request through the client's HTTP cache
+ * Fresh hits skip the network; stale entries are revalidated and a 304 is
+ * answered with the stored response.
+ */
+static httpmorph_response_t* core_execute_cached(
+    httpmorph_client_t *client,
+    const httpmorph_request_t *request,
+    httpmorph_pool_t *pool) {
+
+    httpmorph_cache_t *cache = client->http_cache;
+    http_cache_entry_t *entry = NULL;
+    http_cache_result_t lookup = http_cache_lookup(cache, request, &entry);
+
+    if (lookup == HTTP_CACHE_FRESH || lookup == HTTP_CACHE_GATEWAY_TIMEOUT) {
+        uint64_t start_time = httpmorph_get_time_us();
+        httpmorph_response_t *response = httpmorph_response_create_with_arena(client->buffer_pool,
+                                                                              request->_arena);
+        if (response) {
+            if (lookup == HTTP_CACHE_GATEWAY_TIMEOUT) {
+                /* only-if-cached with nothing to serve (RFC 9111 section 5.2.1.7) */
+                response->status_code = 504;
+                response->http_version = HTTPMORPH_VERSION_1_1;
+                response->cache_status = HTTPMORPH_CACHE_MISS;
+                response->body_len = 0;
+            } else if (http_cache_serve(entry, response) == 0) {
+                response->cache_status = HTTPMORPH_CACHE_HIT;
+            } else {
+                response->error = HTTPMORPH_ERROR_MEMORY;
+                response->error_message = httpmorph_response_strdup(response, "Failed to serve cached response");
+            }
+            response->total_time_us = httpmorph_get_time_us() - start_time;
+        }
+        http_cache_entry_release(cache, entry);
+        return response;
+    }
+
+    /* Validators go on the request for this attempt only */
+    size_t conditionals = 0;
+    if (lookup == HTTP_CACHE_STALE) {
+        conditionals = http_cache_add_conditionals(entry, (httpmorph_request_t *)request);
+    }
+
+    int64_t request_time = (int64_t)time(NULL);
+    httpmorph_response_t *response = core_execute_routed(client, request, pool);
+    int64_t response_time = (int64_t)time(NULL);
+    httpmorph_request_pop_headers((httpmorph_request_t *)request, conditionals);
+
+    if (!response || response->error != HTTPMORPH_OK) {
+        http_cache_entry_release(cache, entry);
+        return response;
+    }
+
+    if (lookup == HTTP_CACHE_STALE && response->status_code == 304) {
+        http_cache_entry_t *fresh = http_cache_freshen(cache, entry, response,
+                                                       request_time, response_time);
+        if (http_cache_serve(fresh ? fresh : entry, response) == 0) {
+            response->cache_status = HTTPMORPH_CACHE_REVALIDATED;
+        } else {
+            response->error = HTTPMORPH_ERROR_MEMORY;
+            response->error_message = httpmorph_response_strdup(response, "Failed to serve cached response");
+        }
+        http_cache_entry_release(cache, fresh);
+    } else if (lookup != HTTP_CACHE_BYPASS) {
+        response->cache_status = HTTPMORPH_CACHE_MISS;
+        http_cache_store(cache, request, response, request_time, response_time);
+    } else if (request->method != HTTPMORPH_GET && request->method != HTTPMORPH_HEAD &&
+               request->method != HTTPMORPH_OPTIONS &&
+               response->status_code >= 200 && response->status_code < 400) {
+        /* A successful unsafe request invalidates what is stored for its URL */
+        http_cache_invalidate(cache, request->url);
+    }
+
+    http_cache_entry_release(cache, entry);
+    return response;
+}
+
+/**
+ * Remember the alternative services a response advertises
+ */
+static void core_record_alt_svc(httpmorph_client_t *client, const char *url,
+                                const httpmorph_response_t *response) {
+    if (!response || response->error != HTTPMORPH_OK) {
+        return;
+    }
+    const char *values[ALT_SVC_MAX_ALTERNATIVES];
+    size_t count = httpmorph_response_get_header_values(response, "Alt-Svc", values,
+                                                        ALT_SVC_MAX_ALTERNATIVES);
+    if (count > 0) {
+        if (count > ALT_SVC_MAX_ALTERNATIVES) {
+            count = ALT_SVC_MAX_ALTERNATIVES;
+        }
+        alt_svc_cache_update(client->alt_svc, url, values, count,
+                             httpmorph_get_time_us() / 1000000);
+    }
+}
+
+/**
+ * Execute one hop of a request, sending and storing the session's cookies
+ */
+static httpmorph_response_t* core_execute_hop(
+    httpmorph_client_t *client,
+    const httpmorph_request_t *request,
+    httpmorph_pool_t *pool,
+    httpmorph_session_t *session) {
+
+    uint64_t request_id = trace_next_request_id();
+    HTTPMORPH_PROBE2(request__start, request_id, request->url);
+
+    /* Cookies go on the request for this hop only */
+    size_t cookies = httpmorph_session_attach_cookies(session, (httpmorph_request_t *)request);
+
+    httpmorph_response_t *response = client->http_cache
+        ? core_execute_cached(client, request, pool)
+        : core_execute_routed(client, request, pool);
+
+    httpmorph_request_pop_headers((httpmorph_request_t *)request, cookies);
+    httpmorph_session_store_cookies(session, request->url, response);
+    core_record_alt_svc(client, request->url, response);
+    metrics_record(client->metrics, request->url, response);
+    trace_request(request_id, request, response);
+    return response;
+}
+
+/**
+ * Get where a response redirects to (NULL if it isn't a redirect)
+ */
+static const char* core_redirect_location(const httpmorph_response_t *response) {
+    switch (response->status_code) {
+        case 301: case 302: case 303: case 307: case 308:
+            return httpmorph_response_get_header(response, "Location");
+        default:
+            return NULL;
+    }
+}
+
+/**
+ * Follow the redirects a request's first response leads to
+ * @param start_time When the request started (all hops share its timeout)
+ */
+static httpmorph_response_t* core_follow_redirects(
+    httpmorph_client_t *client,
+    const httpmorph_request_t *request,
+    httpmorph_response_t *response,
+    httpmorph_pool_t *pool,
+    httpmorph_session_t *session,
+    uint64_t start_time) {
+
+    const httpmorph_request_t *current = request;
+    httpmorph_request_t *owned = NULL;
+    uint32_t hops = 0;
+    const char *location;
+
+    while (response && response->error == HTTPMORPH_OK &&
+           (location = core_redirect_location(response)) != NULL) {
+        if (hops >= request->max_redirects) {
+            char message[64];
+            snprintf(message, sizeof(message), "Exceeded %u redirects", request->max_redirects);
+            response->error = HTTPMORPH_ERROR_TOO_MANY_REDIRECTS;
+            response->error_message = httpmorph_response_strdup(response, message);
+            break;
+        }
+
+        char *url = httpmorph_resolve_url(current->url, location);
+        httpmorph_request_t *next = url ? httpmorph_request_redirect(current, response->status_code, url) : NULL;
+        free(url);
+        if (!next) {
+            /* Can't be replayed (e.g. a streamed body): the redirect is the answer */
+            break;
+        }
+
+        /* All hops share the request's timeout */
+        if (request->timeout_ms > 0) {
+            uint64_t elapsed_ms = (httpmorph_get_time_us() - start_time) / 1000;
+            if (elapsed_ms >= request->timeout_ms) {
+                httpmorph_request_destroy(next);
+                response->error = HTTPMORPH_ERROR_TIMEOUT;
+                response->error_message = httpmorph_response_strdup(response, "Timed out following redirects");
+                break;
+            }
+            next->timeout_ms = request->timeout_ms - (uint32_t)elapsed_ms;
+        }
+
+        httpmorph_response_t *next_response = core_execute_hop(client, next, pool, session);
+        if (!next_response) {
+            httpmorph_request_destroy(next);
+            break;
+        }
+
+        next_response->redirect_from = response;
+        next_response->redirect_count = ++hops;
+        next_response->url = httpmorph_response_strdup(next_response, next->url);
+        response = next_response;
+
+        httpmorph_request_destroy(owned);
+        owned = next;
+        current = next;
+    }
+
+    httpmorph_request_destroy(owned);
+    return response;
+}
+
+/**
+ * Execute an HTTP request
+ */
+httpmorph_response_t* httpmorph_request_execute(
+    httpmorph_client_t *client,
+    const httpmorph_request_t *request,
+    httpmorph_pool_t *pool) {
+
+    return httpmorph_request_execute_in_session(client, request, pool, NULL);
+}
+
+/**
+ * Execute an HTTP request, following redirects when asked to
+ * Each hop runs through the same pool, so a same-origin hop reuses the
+ * connection the previous one returned and a hop to another origin can
+ * share an HTTP/2 connection coalesced for it. The final response carries
+ * the chain of responses that led to it.
+ */
+httpmorph_response_t* httpmorph_request_execute_in_session(
+    httpmorph_client_t *client,
+    const httpmorph_request_t *request,
+    httpmorph_pool_t *pool,
+    httpmorph_session_t *session) {
+
+    if (!client || !request || !request->url) {
+        return NULL;
+    }
+
+    uint64_t start_time = httpmorph_get_time_us();
+    httpmorph_response_t *response = core_execute_hop(client, request, pool, session);
+    if (!request->follow_redirects || request->body_callback) {
+        /* A streamed body has already gone to the caller */
+        return response;
+    }
+
+    return core_follow_redirects(client, request, response, pool, session, start_time);
+}
+
+/* Longest wait for the session tickets that follow a TLS 1.3 handshake */
+#define CORE_TICKET_WAIT_MAX_US 500000
+
+/**
+ * Read in the session tickets a TLS 1.3 server sends after the handshake
+ * They follow about a round trip later, so the wait is bounded by how
+ * long the handshake took. Nothing else can be waiting on a new
+ * connection, so whatever arrives is a ticket (or an early close).
+ */
+static void core_read_session_tickets(int sockfd, SSL *ssl, uint64_t tls_time_us) {
+    if (SSL_version(ssl) != TLS1_3_VERSION) {
+        return;  /* TLS 1.2 tickets come within the handshake */
+    }
+
+    uint64_t wait_us = tls_time_us < CORE_TICKET_WAIT_MAX_US ? tls_time_us : CORE_TICKET_WAIT_MAX_US;
+    fd_set read_fds;
+    struct timeval tv;
+    FD_ZERO(&read_fds);
+    FD_SET(sockfd, &read_fds);
+    tv.tv_sec = (long)(wait_us / 1000000);
+    tv.tv_usec = (long)(wait_us % 1000000);
+    if (select(SELECT_NFDS(sockfd), &read_fds, NULL, NULL, &tv) <= 0) {
+        return;
+    }
+
+    /* Processes the records without consuming application data; the socket
+     * is made non-blocking so the peek can't wait for data that isn't coming */
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(sockfd, FIONBIO, &mode);
+#else
+    int flags = fcntl(sockfd, F_GETFL, 0);
+    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+#endif
+    char byte;
+    SSL_peek(ssl, &byte, 1);
+    ERR_clear_error();
+#ifdef _WIN32
+    mode = 0;
+    ioctlsocket(sockfd, FIONBIO, &mode);
+#else
+    fcntl(sockfd, F_SETFL, flags);
+#endif
+}
+
+/**
+ * Open one connection to an origin and pool it
+ */
+int httpmorph_preconnect_origin(httpmorph_client_t *client, httpmorph_pool_t *pool,
+                                const char *host, uint16_t port, bool use_tls,
+                                bool http2_enabled, bool verify_ssl, uint32_t timeout_ms,
+                                httpmorph_preconnect_result_t *result) {
+    if (!client || !pool || !host || !result) {
+        return -1;
+    }
+
+    uint64_t connect_time = 0;
+    uint64_t dns_time = 0;
+    int sockfd = httpmorph_tcp_connect(host, port, timeout_ms ? timeout_ms : client->timeout_ms,
+                                       false, &connect_time, &dns_time);
+    if (sockfd < 0) {
+        result->error = HTTPMORPH_ERROR_NETWORK;
+        return -1;
+    }
+    result->dns_time_us = dns_time;
+    result->connect_time_us = connect_time;
+
+    SSL *ssl = NULL;
+    bool use_http2 = false;
+    if (use_tls) {
+        uint64_t tls_time = 0;
+        ssl = httpmorph_tls_connect(client->ssl_ctx, client->session_cache, sockfd, host, port,
+                                    client->browser_profile, http2_enabled, verify_ssl, &tls_time);
+        if (!ssl) {
+            if (sockfd > 2) close(sockfd);
+            result->error = HTTPMORPH_ERROR_TLS;
+            return -1;
+        }
+        result->tls_time_us = tls_time;
+        result->tls_resumed = SSL_session_reused(ssl) == 1;
+
+        const unsigned char *alpn_data = NULL;
+        unsigned int alpn_len = 0;
+        SSL_get0_alpn_selected(ssl, &alpn_data, &alpn_len);
+        use_http2 = alpn_len == 2 && memcmp(alpn_data, "h2", 2) == 0;
+
+        core_read_session_tickets(sockfd, ssl, tls_time);
+    }
+
+#ifndef HAVE_NGHTTP2
+    if (use_http2) {
+        /* Can't speak what was negotiated */
+        SSL_free(ssl);
+        if (sockfd > 2) close(sockfd);
+        result->error = HTTPMORPH_ERROR_PROTOCOL;
+        return -1;
+    }
+#endif
+
+    if (use_http2) {
+        /* Non-blocking, as HTTP/2 connections from requests are */
+#ifdef _WIN32
+        u_long mode = 1;
+        ioctlsocket(sockfd, FIONBIO, &mode);
+#else
+        int flags = fcntl(sockfd, F_GETFL, 0);
+        fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+#endif
+    }
+
+    char pool_key[POOL_MAX_HOST_KEY_LEN];
+    pool_build_host_key(host, port, pool_key);
+    pooled_connection_t *conn = pool_connection_create_with_key(pool_key, sockfd, ssl, use_http2);
+    if (!conn) {
+        if (ssl) SSL_free(ssl);
+        if (sockfd > 2) close(sockfd);
+        result->error = HTTPMORPH_ERROR_MEMORY;
+        return -1;
+    }
+
+    /* TLS info for the responses that reuse it (static strings) */
+    if (ssl) {
+        const SSL_CIPHER *cipher = SSL_get_current_cipher(ssl);
+        conn->tls_cipher = cipher ? SSL_CIPHER_get_name(cipher) : NULL;
+        conn->tls_version = SSL_get_version(ssl);
+        conn->ja3_fingerprint = client->tls_fingerprint
+            ? httpmorph_tls_ja3(ssl, client->browser_profile) : NULL;
+    }
+
+#ifdef HAVE_NGHTTP2
+    if (use_http2) {
+        pool_connection_enable_coalescing(conn, verify_ssl);
+        if (httpmorph_http2_open_pooled(conn) != 0) {
+            pool_connection_destroy(conn);
+            result->error = HTTPMORPH_ERROR_PROTOCOL;
+            return -1;
+        }
+    }
+#endif
+    result->http2 = use_http2;
+
+    if (!pool_put_connection(pool, conn)) {
+        result->error = HTTPMORPH_ERROR_MEMORY;  /* Pool full (it closed the connection) */
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Get whether a request can go in an HTTP/1.1 pipeline: safe to send
+ * again if the connection fails under it, and nothing routes it elsewhere
+ */
+static bool core_pipelinable(const httpmorph_client_t *client, const httpmorph_request_t *request) {
+    return request->url && httpmorph_request_is_replayable(request) && !request->body_callback &&
+           !request->proxy_url && !request->rotate_fingerprint && !client->http_cache && !client->proxy_set;
+}
+
+/**
+ * Count the requests at the start of an array that can be pipelined together
+ */
+size_t httpmorph_pipeline_run(const httpmorph_client_t *client,
+                              httpmorph_request_t *const *requests, size_t count) {
+    char origin[REQUEST_SCHEDULER_MAX_KEY];
+    char next_origin[REQUEST_SCHEDULER_MAX_KEY];
+    if (!client || count == 0 || !core_pipelinable(client, requests[0])) {
+        return 0;
+    }
+    uint32_t depth = httpmorph_client_pipeline_depth(client, requests[0]->url, origin);
+
+    size_t run = 1;
+    while (run < count && run < depth && core_pipelinable(client, requests[run]) &&
+           request_scheduler_origin_key(requests[run]->url, next_origin, sizeof(next_origin)) &&
+           strcmp(origin, next_origin) == 0) {
+        run++;
+    }
+    return run;
+}
+
+/**
+ * Send requests back to back on a pooled HTTP/1.1 connection to their
+ * origin, then read the responses in order
+ *
+ * Stops at a request that fails to go out, a response that can't be read
+ * and a response that closes the connection.
+ *
+ * @param broken Output: true if the connection stopped short of the last request
+ * @return Responses read (a prefix of responses), 0 if the pool had no
+ *         HTTP/1.1 connection to the origin
+ */
+static size_t core_execute_pipeline(httpmorph_client_t *client,
+                                    httpmorph_request_t *const *requests, size_t count,
+                                    httpmorph_pool_t *pool, httpmorph_response_t **responses,
+                                    bool *broken) {
+    char *scheme = NULL, *host = NULL, *path = NULL;
+    uint16_t port = 0;
+    *broken = false;
+    if (httpmorph_parse_url(requests[0]->url, &scheme, &host, &port, &path) != 0) {
+        free(scheme);
+        free(host);
+        free(path);
+        return 0;
+    }
+    char pool_key[POOL_MAX_HOST_KEY_LEN];
+    pool_build_host_key(host, port, pool_key);
+    free(scheme);
+    free(host);
+    free(path);
+
+    pooled_connection_t *conn = pool_get_connection_by_key(pool, pool_key);
+    if (!conn) {
+        return 0;
+    }
+    if (conn->is_http2) {
+        /* Requests share it through the pool anyway */
+        pool_put_connection(pool, conn);
+        return 0;
+    }
+    if (conn->ssl && SSL_get_shutdown(conn->ssl) != 0) {
+        pool_connection_destroy(conn);
+        return 0;
+    }
+
+    uint64_t start_time = httpmorph_get_time_us();
+    size_t sent = 0;
+    while (sent < count) {
+        const httpmorph_request_t *request = requests[sent];
+        scheme = host = path = NULL;
+        int rc = httpmorph_parse_url(request->url, &scheme, &host, &port, &path);
+        if (rc == 0) {
+            rc = httpmorph_send_http_request(conn->ssl, conn->sockfd, request, host, path, scheme,
+                                             port, false, NULL, NULL);
+        }
+        free(scheme);
+        free(host);
+        free(path);
+        if (rc != 0) {
+            break;
+        }
+        sent++;
+    }
+
+    /* Bytes of the next response can arrive with the end of this one */
+    http1_readahead_t readahead = {0};
+    size_t answered = 0;
+    bool reusable = sent == count;
+    while (answered < sent) {
+        const httpmorph_request_t *request = requests[answered];
+        httpmorph_response_t *response = httpmorph_response_create_with_arena(client->buffer_pool,
+                                                                               request->_arena);
+        if (!response) {
+            reusable = false;
+            break;
+        }
+
+        uint64_t first_byte_time = 0;
+        bool will_close = false;
+        if (httpmorph_recv_http_response(conn->ssl, conn->sockfd, response, &first_byte_time,
+                                         &will_close, request, &readahead) != 0) {
+            httpmorph_response_destroy(response);
+            reusable = false;
+            break;
+        }
+        response->ja3_fingerprint = client->tls_fingerprint ? (char *)conn->ja3_fingerprint : NULL;
+        response->tls_version = (char *)conn->tls_version;
+        response->tls_cipher = (char *)conn->tls_cipher;
+        response->connection_reused = true;
+        response->first_byte_time_us = first_byte_time - start_time;
+        response->total_time_us = httpmorph_get_time_us() - start_time;
+        core_decode_unlabelled_gzip(request, response);
+        core_record_alt_svc(client, request->url, response);
+        metrics_record(client->metrics, request->url, response);
+        trace_request(trace_next_request_id(), request, response);
+        responses[answered++] = response;
+
+        const char *connection = httpmorph_response_get_header(response, "Connection");
+        if (will_close || response->error != HTTPMORPH_OK ||
+            (connection && (strstr(connection, "close") || strstr(connection, "Close")))) {
+            reusable = false;
+            break;
+        }
+    }
+
+    if (reusable && readahead.len == 0) {
+        pool_put_connection(pool, conn);
+    } else {
+        pool_connection_destroy(conn);
+    }
+    http1_readahead_free(&readahead);
+    *broken = answered < count;
+    return answered;
+}
+
+/**
+ * Execute a run of requests from httpmorph_pipeline_run()
+ */
+void httpmorph_request_execute_pipelined(httpmorph_client_t *client,
+                                         httpmorph_request_t *const *requests, size_t count,
+                                         httpmorph_pool_t *pool,
+                                         httpmorph_response_t **responses) {
+    /* The first request sets up the connection the rest are pipelined on;
+     * once a pipeline breaks, the remaining requests go one at a time */
+    bool pipelining = pool != NULL;
+    size_t done = 0;
+    while (done < count) {
+        size_t answered = 0;
+        if (pipelining && count - done > 1) {
+            uint64_t start_time = httpmorph_get_time_us();
+            bool broken = false;
+            answered = core_execute_pipeline(client, requests + done, count - done, pool,
+                                             responses + done, &broken);
+            for (size_t i = done; i < done + answered; i++) {
+                if (requests[i]->follow_redirects) {
+                    responses[i] = core_follow_redirects(client, requests[i], responses[i], pool,
+                                                         NULL, start_time);
+                }
+            }
+            pipelining = !broken;
+        }
+        if (answered == 0) {
+            responses[done] = httpmorph_request_execute(client, requests[done], pool);
+            answered = 1;
+        }
+        done += answered;
+    }
+}
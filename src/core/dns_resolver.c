@@ -0,0 +1,948 @@
+/**
+ * dns_resolver.c - Non-blocking DNS resolution
+ */
+
+#ifndef _WIN32
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "dns_resolver.h"
+#include "internal/internal.h"
+#include "internal/network.h"
+#include "internal/util.h"
+#include <openssl/rand.h>
+
+#ifdef _WIN32
+    #define RESOLVER_POLL(fds, n, ms) WSAPoll(fds, (ULONG)(n), ms)
+    typedef WSAPOLLFD resolver_pollfd_t;
+#else
+    #include <pthread.h>
+    #include <poll.h>
+    #define RESOLVER_POLL(fds, n, ms) poll(fds, (nfds_t)(n), ms)
+    typedef struct pollfd resolver_pollfd_t;
+#endif
+
+/* DNS wire format */
+#define DNS_HEADER_SIZE   12
+#define DNS_MAX_NAME      255
+#define DNS_UDP_PAYLOAD   1232   /* EDNS(0) buffer size (DNS flag day 2020) */
+#define DNS_TYPE_A        1
+#define DNS_TYPE_SOA      6
+#define DNS_TYPE_AAAA     28
+#define DNS_TYPE_OPT      41
+#define DNS_CLASS_IN      1
+#define DNS_FLAG_QR       0x8000
+#define DNS_FLAG_TC       0x0200
+#define DNS_FLAG_RD       0x0100
+#define DNS_RCODE_NXDOMAIN 3
+
+/* dns_parse_reply() results */
+#define DNS_REPLY_OK        0
+#define DNS_REPLY_IGNORED   1    /* Not the reply we're waiting for */
+#define DNS_REPLY_TRUNCATED 2
+#define DNS_REPLY_INVALID  -1
+
+/**
+ * Query shared by every lookup of the same host:port
+ */
+typedef struct dns_query {
+    char *host;
+    uint16_t port;
+    bool done;
+    struct addrinfo *result;         /* Shared list, each waiter takes a reference */
+    int gai_error;
+    int refs;                        /* Waiters + the pending job */
+    httpmorph_dns_lookup_t *waiters;
+    struct dns_query *next;          /* In-flight list */
+    struct dns_query *next_job;      /* Job queue */
+} dns_query_t;
+
+/**
+ * One caller's handle on a query
+ */
+struct httpmorph_dns_lookup {
+    dns_query_t *query;
+    int notify_fd;
+    httpmorph_dns_lookup_t *next;
+};
+
+/**
+ * Name server configuration (copied by the workers for each query)
+ */
+typedef struct {
+    struct sockaddr_storage addrs[DNS_RESOLVER_MAX_SERVERS];
+    socklen_t addr_lens[DNS_RESOLVER_MAX_SERVERS];
+    size_t count;
+    uint32_t timeout_ms;
+} resolver_servers_t;
+
+/* Global resolver state */
+#ifdef _WIN32
+static pthread_mutex_t resolver_mutex;
+static pthread_cond_t resolver_job_cond;
+static pthread_cond_t resolver_done_cond;
+static bool resolver_sync_initialized = false;
+#else
+static pthread_mutex_t resolver_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t resolver_job_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t resolver_done_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+static pthread_t resolver_threads[DNS_RESOLVER_THREADS];
+static int resolver_thread_count = 0;
+static bool resolver_stopping = false;
+static dns_query_t *resolver_inflight = NULL;
+static dns_query_t *resolver_job_head = NULL;
+static dns_query_t *resolver_job_tail = NULL;
+static resolver_servers_t resolver_servers = { .timeout_ms = DNS_RESOLVER_TIMEOUT_MS };
+
+/**
+ * Initialize resolver locks (called on first use)
+ */
+static void resolver_init_sync(void) {
+#ifdef _WIN32
+    if (!resolver_sync_initialized) {
+        pthread_mutex_init(&resolver_mutex, NULL);
+        pthread_cond_init(&resolver_job_cond, NULL);
+        pthread_cond_init(&resolver_done_cond, NULL);
+        resolver_sync_initialized = true;
+    }
+#endif
+}
+
+/* ====================================================================
+ * DNS WIRE PROTOCOL
+ * ==================================================================== */
+
+/* Helper: Write a big-endian 16-bit value */
+static inline void put16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+/* Helper: Read a big-endian 16-bit value */
+static inline uint16_t get16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/* Helper: Read a big-endian 32-bit TTL (values with the top bit set mean 0, RFC 2181) */
+static inline uint32_t get_ttl(const uint8_t *p) {
+    uint32_t v = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    return (v & 0x80000000u) ? 0 : v;
+}
+
+/**
+ * Build a recursive query for one record type
+ * Returns the message length, or -1 if the name can't be encoded
+ */
+static int dns_build_query(uint8_t *buf, size_t cap, const char *name,
+                           uint16_t id, uint16_t qtype) {
+    size_t name_len = strlen(name);
+    if (name_len > 0 && name[name_len - 1] == '.') {
+        name_len--;  /* Already fully qualified */
+    }
+    if (name_len == 0 || name_len > DNS_MAX_NAME - 2 ||
+        cap < DNS_HEADER_SIZE + name_len + 2 + 4 + 11) {
+        return -1;
+    }
+
+    memset(buf, 0, DNS_HEADER_SIZE);
+    put16(buf, id);
+    put16(buf + 2, DNS_FLAG_RD);
+    put16(buf + 4, 1);   /* QDCOUNT */
+    put16(buf + 10, 1);  /* ARCOUNT: EDNS(0) OPT */
+
+    /* QNAME as length-prefixed labels */
+    size_t pos = DNS_HEADER_SIZE;
+    const char *label = name;
+    const char *end = name + name_len;
+    while (label < end) {
+        const char *dot = memchr(label, '.', (size_t)(end - label));
+        size_t label_len = (size_t)((dot ? dot : end) - label);
+        if (label_len == 0 || label_len > 63) {
+            return -1;
+        }
+        buf[pos++] = (uint8_t)label_len;
+        memcpy(buf + pos, label, label_len);
+        pos += label_len;
+        label += label_len + 1;
+    }
+    buf[pos++] = 0;
+
+    put16(buf + pos, qtype);
+    put16(buf + pos + 2, DNS_CLASS_IN);
+    pos += 4;
+
+    /* OPT pseudo-record: root name, type, UDP payload size, TTL 0, no data */
+    buf[pos++] = 0;
+    put16(buf + pos, DNS_TYPE_OPT);
+    put16(buf + pos + 2, DNS_UDP_PAYLOAD);
+    memset(buf + pos + 4, 0, 6);
+    pos += 10;
+
+    return (int)pos;
+}
+
+/**
+ * Skip a (possibly compressed) name
+ */
+static int dns_skip_name(const uint8_t *msg, size_t len, size_t *pos) {
+    while (*pos < len) {
+        uint8_t c = msg[*pos];
+        if (c == 0) {
+            (*pos)++;
+            return 0;
+        }
+        if ((c & 0xC0) == 0xC0) {
+            /* Compression pointer ends the name */
+            if (*pos + 1 >= len) {
+                return -1;
+            }
+            *pos += 2;
+            return 0;
+        }
+        if (c & 0xC0) {
+            return -1;  /* Reserved label type */
+        }
+        *pos += 1 + (size_t)c;
+    }
+    return -1;
+}
+
+/**
+ * Free a chain built by dns_append_address()
+ */
+static void dns_free_chain(struct addrinfo *ai) {
+    while (ai) {
+        struct addrinfo *next = ai->ai_next;
+        free(ai->ai_addr);
+        free(ai);
+        ai = next;
+    }
+}
+
+/**
+ * Append an address record to a result list
+ */
+static int dns_append_address(struct addrinfo ***tail, uint16_t qtype,
+                              const uint8_t *rdata, uint16_t port) {
+    struct addrinfo *ai = calloc(1, sizeof(struct addrinfo));
+    if (!ai) {
+        return -1;
+    }
+
+    if (qtype == DNS_TYPE_A) {
+        struct sockaddr_in *sin = calloc(1, sizeof(struct sockaddr_in));
+        if (!sin) {
+            free(ai);
+            return -1;
+        }
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons(port);
+        memcpy(&sin->sin_addr, rdata, 4);
+        ai->ai_family = AF_INET;
+        ai->ai_addr = (struct sockaddr*)sin;
+        ai->ai_addrlen = sizeof(struct sockaddr_in);
+    } else {
+        struct sockaddr_in6 *sin6 = calloc(1, sizeof(struct sockaddr_in6));
+        if (!sin6) {
+            free(ai);
+            return -1;
+        }
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons(port);
+        memcpy(&sin6->sin6_addr, rdata, 16);
+        ai->ai_family = AF_INET6;
+        ai->ai_addr = (struct sockaddr*)sin6;
+        ai->ai_addrlen = sizeof(struct sockaddr_in6);
+    }
+    ai->ai_socktype = SOCK_STREAM;
+    ai->ai_protocol = IPPROTO_TCP;
+
+    **tail = ai;
+    *tail = &ai->ai_next;
+    return 0;
+}
+
+/**
+ * Parse a reply, appending its address records of type qtype
+ * *ttl is lowered to the smallest answer TTL, *negative_ttl to the SOA
+ * negative TTL (RFC 2308) of an empty answer.
+ */
+static int dns_parse_reply(const uint8_t *msg, size_t len, uint16_t id, uint16_t qtype,
+                           uint16_t port, struct addrinfo ***tail, int *rcode,
+                           uint32_t *ttl, uint32_t *negative_ttl) {
+    if (len < DNS_HEADER_SIZE || get16(msg) != id) {
+        return DNS_REPLY_IGNORED;
+    }
+
+    uint16_t flags = get16(msg + 2);
+    if (!(flags & DNS_FLAG_QR)) {
+        return DNS_REPLY_IGNORED;
+    }
+    if (flags & DNS_FLAG_TC) {
+        return DNS_REPLY_TRUNCATED;
+    }
+    *rcode = flags & 0x000F;
+
+    uint16_t qdcount = get16(msg + 4);
+    uint16_t ancount = get16(msg + 6);
+    uint16_t nscount = get16(msg + 8);
+    size_t pos = DNS_HEADER_SIZE;
+
+    for (uint16_t i = 0; i < qdcount; i++) {
+        if (dns_skip_name(msg, len, &pos) < 0 || pos + 4 > len) {
+            return DNS_REPLY_INVALID;
+        }
+        pos += 4;
+    }
+
+    /* CNAME records come first; the recursive server appends their targets */
+    for (uint16_t i = 0; i < ancount; i++) {
+        if (dns_skip_name(msg, len, &pos) < 0 || pos + 10 > len) {
+            return DNS_REPLY_INVALID;
+        }
+        uint16_t type = get16(msg + pos);
+        uint16_t rclass = get16(msg + pos + 2);
+        uint16_t rdlen = get16(msg + pos + 8);
+        pos += 10;
+        if (pos + rdlen > len) {
+            return DNS_REPLY_INVALID;
+        }
+
+        /* The chain is only valid while every link (CNAMEs too) is */
+        uint32_t rr_ttl = get_ttl(msg + pos - 6);
+        if (rr_ttl < *ttl) {
+            *ttl = rr_ttl;
+        }
+
+        size_t want = (qtype == DNS_TYPE_A) ? 4 : 16;
+        if (type == qtype && rclass == DNS_CLASS_IN && rdlen == want) {
+            if (dns_append_address(tail, qtype, msg + pos, port) < 0) {
+                return DNS_REPLY_INVALID;
+            }
+        }
+        pos += rdlen;
+    }
+
+    /* No answer: the authority SOA says how long that holds */
+    if (ancount == 0) {
+        for (uint16_t i = 0; i < nscount; i++) {
+            if (dns_skip_name(msg, len, &pos) < 0 || pos + 10 > len) {
+                break;
+            }
+            uint16_t type = get16(msg + pos);
+            uint32_t rr_ttl = get_ttl(msg + pos + 4);
+            uint16_t rdlen = get16(msg + pos + 8);
+            pos += 10;
+            if (pos + rdlen > len) {
+                break;
+            }
+
+            size_t rdata = pos;
+            if (type == DNS_TYPE_SOA &&
+                dns_skip_name(msg, pos + rdlen, &rdata) == 0 &&    /* MNAME */
+                dns_skip_name(msg, pos + rdlen, &rdata) == 0 &&    /* RNAME */
+                rdata + 20 <= pos + rdlen) {
+                uint32_t minimum = get_ttl(msg + rdata + 16);
+                uint32_t soa_ttl = rr_ttl < minimum ? rr_ttl : minimum;
+                if (soa_ttl < *negative_ttl) {
+                    *negative_ttl = soa_ttl;
+                }
+                break;
+            }
+            pos += rdlen;
+        }
+    }
+
+    return DNS_REPLY_OK;
+}
+
+/* ====================================================================
+ * RESOLUTION
+ * ==================================================================== */
+
+/**
+ * Resolve through the system resolver
+ */
+static struct addrinfo* resolve_system(const char *host, uint16_t port, int *gai_error,
+                                       int *ttl) {
+    struct addrinfo hints, *result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;     /* Allow IPv4 or IPv6 */
+    hints.ai_socktype = SOCK_STREAM;
+
+    char port_str[6];
+    snprintf(port_str, sizeof(port_str), "%u", port);
+
+    *ttl = -1;  /* getaddrinfo() doesn't report TTLs */
+    int ret = getaddrinfo(host, port_str, &hints, &result);
+    if (ret != 0 || !result) {
+        *gai_error = ret ? ret : EAI_NONAME;
+        return NULL;
+    }
+
+    struct addrinfo *copy = httpmorph_dns_copy(result);
+    freeaddrinfo(result);
+    if (!copy) {
+        *gai_error = EAI_MEMORY;
+    }
+    return copy;
+}
+
+/* Helper: TTL for the cache, -1 if no record carried one */
+static int dns_ttl_seconds(uint32_t ttl) {
+    if (ttl == UINT32_MAX) {
+        return -1;
+    }
+    return ttl > INT32_MAX ? INT32_MAX : (int)ttl;
+}
+
+/**
+ * Resolve by querying the configured name servers directly
+ * A and AAAA go out together; AAAA results are listed first (RFC 8305).
+ * *ttl is the record TTL of the result, or the negative TTL on EAI_NONAME.
+ */
+static struct addrinfo* resolve_servers(const char *host, uint16_t port,
+                                        const resolver_servers_t *servers, int *gai_error,
+                                        int *ttl) {
+    uint8_t query_a[DNS_MAX_NAME + 64];
+    uint8_t query_aaaa[DNS_MAX_NAME + 64];
+    uint8_t reply[DNS_UDP_PAYLOAD];
+    uint16_t ids[2];
+
+    *gai_error = EAI_AGAIN;
+    *ttl = -1;
+
+    for (size_t s = 0; s < servers->count; s++) {
+        RAND_bytes((uint8_t*)ids, sizeof(ids));
+        if (ids[1] == ids[0]) {
+            ids[1] ^= 1;
+        }
+        int len_a = dns_build_query(query_a, sizeof(query_a), host, ids[0], DNS_TYPE_A);
+        int len_aaaa = dns_build_query(query_aaaa, sizeof(query_aaaa), host, ids[1], DNS_TYPE_AAAA);
+        if (len_a < 0 || len_aaaa < 0) {
+            *gai_error = EAI_NONAME;
+            return NULL;
+        }
+
+        const struct sockaddr *server = (const struct sockaddr*)&servers->addrs[s];
+        int fd = (int)socket(server->sa_family, SOCK_DGRAM, 0);
+        if (fd < 0) {
+            continue;
+        }
+        /* Connected UDP: replies from anyone but the server are dropped */
+        if (connect(fd, server, servers->addr_lens[s]) != 0 ||
+            (int)send(fd, (const char*)query_a, (size_t)len_a, 0) != len_a ||
+            (int)send(fd, (const char*)query_aaaa, (size_t)len_aaaa, 0) != len_aaaa) {
+            close(fd);
+            continue;
+        }
+
+        struct addrinfo *v4 = NULL, *v6 = NULL;
+        struct addrinfo **v4_tail = &v4, **v6_tail = &v6;
+        bool got_a = false, got_aaaa = false, truncated = false, failed = false;
+        int rcode_a = 0, rcode_aaaa = 0;
+        uint32_t answer_ttl = UINT32_MAX, negative_ttl = UINT32_MAX;
+
+        uint64_t deadline = httpmorph_get_time_us() + (uint64_t)servers->timeout_ms * 1000;
+        while (!(got_a && got_aaaa) && !truncated && !failed) {
+            uint64_t now = httpmorph_get_time_us();
+            if (now >= deadline) {
+                break;
+            }
+
+            resolver_pollfd_t pfd;
+            pfd.fd = fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+            if (RESOLVER_POLL(&pfd, 1, (int)((deadline - now + 999) / 1000)) <= 0) {
+                break;
+            }
+
+            int n = (int)recv(fd, (char*)reply, sizeof(reply), 0);
+            if (n <= 0) {
+                break;  /* ICMP unreachable, try the next server */
+            }
+
+            int rc = DNS_REPLY_IGNORED;
+            if (!got_a) {
+                rc = dns_parse_reply(reply, (size_t)n, ids[0], DNS_TYPE_A, port, &v4_tail, &rcode_a,
+                                     &answer_ttl, &negative_ttl);
+                got_a = (rc == DNS_REPLY_OK);
+            }
+            if (rc == DNS_REPLY_IGNORED && !got_aaaa) {
+                rc = dns_parse_reply(reply, (size_t)n, ids[1], DNS_TYPE_AAAA, port, &v6_tail, &rcode_aaaa,
+                                     &answer_ttl, &negative_ttl);
+                got_aaaa = (rc == DNS_REPLY_OK);
+            }
+            truncated = (rc == DNS_REPLY_TRUNCATED);
+            failed = (rc == DNS_REPLY_INVALID);
+        }
+        close(fd);
+
+        if (truncated) {
+            /* Too big for UDP - let the system resolver retry over TCP */
+            dns_free_chain(v4);
+            dns_free_chain(v6);
+            return resolve_system(host, port, gai_error, ttl);
+        }
+
+        /* Keep whatever family answered, even if the other one timed out */
+        if (v6 || v4) {
+            *v6_tail = v4;
+            struct addrinfo *chain = v6 ? v6 : v4;
+            struct addrinfo *result = httpmorph_dns_copy(chain);
+            dns_free_chain(chain);
+            *gai_error = result ? 0 : EAI_MEMORY;
+            *ttl = dns_ttl_seconds(answer_ttl);
+            return result;
+        }
+        if (failed) {
+            continue;
+        }
+
+        if (got_a && got_aaaa &&
+            (rcode_a == 0 || rcode_a == DNS_RCODE_NXDOMAIN) &&
+            (rcode_aaaa == 0 || rcode_aaaa == DNS_RCODE_NXDOMAIN)) {
+            /* Definite answer: the name has no addresses */
+            *gai_error = EAI_NONAME;
+            *ttl = dns_ttl_seconds(negative_ttl);
+            return NULL;
+        }
+        /* SERVFAIL, REFUSED or timeout - try the next server */
+    }
+
+    return NULL;
+}
+
+/**
+ * Check for an IP literal (never sent to a name server)
+ */
+static bool is_ip_literal(const char *host) {
+    struct in6_addr addr;
+    return inet_pton(AF_INET, host, &addr) == 1 || inet_pton(AF_INET6, host, &addr) == 1;
+}
+
+/**
+ * Resolve one query
+ */
+static struct addrinfo* resolve_query(const char *host, uint16_t port,
+                                      const resolver_servers_t *servers, int *gai_error,
+                                      int *ttl) {
+    if (servers->count == 0 || is_ip_literal(host) || strcasecmp(host, "localhost") == 0) {
+        return resolve_system(host, port, gai_error, ttl);
+    }
+    return resolve_servers(host, port, servers, gai_error, ttl);
+}
+
+/* ====================================================================
+ * WORKER POOL
+ * ==================================================================== */
+
+/**
+ * Signal a waiter's notify fd
+ */
+static void lookup_notify(int fd) {
+#ifndef _WIN32
+    if (fd < 0) {
+        return;
+    }
+    uint64_t one = 1;
+    ssize_t n;
+    do {
+        n = write(fd, &one, sizeof(one));
+    } while (n < 0 && errno == EINTR);
+    /* EAGAIN means it is already signalled */
+#else
+    (void)fd;
+#endif
+}
+
+/**
+ * Drop a query reference (resolver_mutex held)
+ */
+static void query_unref_locked(dns_query_t *query) {
+    if (--query->refs > 0) {
+        return;
+    }
+    free(query->host);
+    httpmorph_dns_free(query->result);
+    free(query);
+}
+
+/**
+ * Publish a query's result and wake its waiters (resolver_mutex held)
+ */
+static void query_finish_locked(dns_query_t *query, struct addrinfo *result, int gai_error) {
+    query->result = result;
+    query->gai_error = result ? 0 : (gai_error ? gai_error : EAI_FAIL);
+    query->done = true;
+
+    /* New lookups for this name start a fresh query (or hit the cache) */
+    for (dns_query_t **p = &resolver_inflight; *p; p = &(*p)->next) {
+        if (*p == query) {
+            *p = query->next;
+            break;
+        }
+    }
+
+    for (httpmorph_dns_lookup_t *w = query->waiters; w; w = w->next) {
+        lookup_notify(w->notify_fd);
+    }
+    pthread_cond_broadcast(&resolver_done_cond);
+
+    query_unref_locked(query);  /* The job's reference */
+}
+
+/**
+ * Resolver thread: run queued queries until shutdown
+ */
+static void* resolver_thread(void *arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&resolver_mutex);
+    for (;;) {
+        while (!resolver_stopping && !resolver_job_head) {
+            pthread_cond_wait(&resolver_job_cond, &resolver_mutex);
+        }
+        if (resolver_stopping) {
+            break;
+        }
+
+        dns_query_t *query = resolver_job_head;
+        resolver_job_head = query->next_job;
+        if (!resolver_job_head) {
+            resolver_job_tail = NULL;
+        }
+
+        /* Skip the lookup if every waiter has already given up */
+        bool wanted = query->refs > 1;
+        resolver_servers_t servers = resolver_servers;
+        pthread_mutex_unlock(&resolver_mutex);
+
+        struct addrinfo *result = NULL;
+        int gai_error = EAI_AGAIN;
+        if (wanted) {
+            int ttl = -1;
+            result = resolve_query(query->host, query->port, &servers, &gai_error, &ttl);
+            if (result) {
+                httpmorph_dns_cache_put(query->host, query->port, result, ttl);
+            } else if (gai_error == EAI_NONAME) {
+                httpmorph_dns_cache_put_negative(query->host, query->port, gai_error, ttl);
+            }
+        }
+
+        pthread_mutex_lock(&resolver_mutex);
+        query_finish_locked(query, result, gai_error);
+    }
+    pthread_mutex_unlock(&resolver_mutex);
+
+    return NULL;
+}
+
+/**
+ * Start the resolver threads (resolver_mutex held)
+ */
+static int resolver_start_threads_locked(void) {
+    while (resolver_thread_count < DNS_RESOLVER_THREADS) {
+        if (pthread_create(&resolver_threads[resolver_thread_count], NULL,
+                           resolver_thread, NULL) != 0) {
+            break;
+        }
+        resolver_thread_count++;
+    }
+    return resolver_thread_count > 0 ? 0 : -1;
+}
+
+/**
+ * Start resolving host:port
+ */
+httpmorph_dns_lookup_t* httpmorph_resolver_start(const char *host, uint16_t port, int notify_fd) {
+    if (!host) {
+        return NULL;
+    }
+
+    httpmorph_dns_lookup_t *lookup = calloc(1, sizeof(httpmorph_dns_lookup_t));
+    if (!lookup) {
+        return NULL;
+    }
+    lookup->notify_fd = notify_fd;
+
+    resolver_init_sync();
+    pthread_mutex_lock(&resolver_mutex);
+
+    if (resolver_thread_count == 0 && resolver_start_threads_locked() < 0) {
+        pthread_mutex_unlock(&resolver_mutex);
+        free(lookup);
+        return NULL;
+    }
+
+    /* Join a query already in flight for this name */
+    dns_query_t *query = resolver_inflight;
+    while (query && (query->port != port || strcmp(query->host, host) != 0)) {
+        query = query->next;
+    }
+
+    if (!query) {
+        query = calloc(1, sizeof(dns_query_t));
+        if (query) {
+            query->host = strdup(host);
+        }
+        if (!query || !query->host) {
+            pthread_mutex_unlock(&resolver_mutex);
+            free(query);
+            free(lookup);
+            return NULL;
+        }
+        query->port = port;
+        query->refs = 1;  /* The job */
+
+        query->next = resolver_inflight;
+        resolver_inflight = query;
+
+        if (resolver_job_tail) {
+            resolver_job_tail->next_job = query;
+        } else {
+            resolver_job_head = query;
+        }
+        resolver_job_tail = query;
+        pthread_cond_signal(&resolver_job_cond);
+    }
+
+    query->refs++;
+    lookup->query = query;
+    lookup->next = query->waiters;
+    query->waiters = lookup;
+
+    pthread_mutex_unlock(&resolver_mutex);
+    return lookup;
+}
+
+/**
+ * Check whether a lookup has finished
+ */
+bool httpmorph_dns_lookup_done(httpmorph_dns_lookup_t *lookup) {
+    if (!lookup) {
+        return true;
+    }
+    pthread_mutex_lock(&resolver_mutex);
+    bool done = lookup->query->done;
+    pthread_mutex_unlock(&resolver_mutex);
+    return done;
+}
+
+/**
+ * Block until a lookup finishes
+ */
+int httpmorph_dns_lookup_wait(httpmorph_dns_lookup_t *lookup, uint32_t timeout_ms) {
+    if (!lookup) {
+        return 0;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec += 1;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&resolver_mutex);
+    while (!lookup->query->done) {
+        if (timeout_ms == 0) {
+            pthread_cond_wait(&resolver_done_cond, &resolver_mutex);
+        } else if (pthread_cond_timedwait(&resolver_done_cond, &resolver_mutex, &deadline) != 0) {
+            break;  /* Timed out */
+        }
+    }
+    bool done = lookup->query->done;
+    pthread_mutex_unlock(&resolver_mutex);
+
+    return done ? 0 : -1;
+}
+
+/**
+ * Get the result of a finished lookup
+ */
+struct addrinfo* httpmorph_dns_lookup_result(httpmorph_dns_lookup_t *lookup, int *gai_error) {
+    int error = EAI_AGAIN;
+    struct addrinfo *result = NULL;
+
+    if (lookup) {
+        pthread_mutex_lock(&resolver_mutex);
+        dns_query_t *query = lookup->query;
+        if (query->done) {
+            error = query->gai_error;
+            if (query->result) {
+                result = httpmorph_dns_ref(query->result);
+                error = 0;
+            }
+        }
+        pthread_mutex_unlock(&resolver_mutex);
+    }
+
+    if (gai_error) {
+        *gai_error = error;
+    }
+    return result;
+}
+
+/**
+ * Release a lookup handle
+ */
+void httpmorph_dns_lookup_release(httpmorph_dns_lookup_t *lookup) {
+    if (!lookup) {
+        return;
+    }
+
+    pthread_mutex_lock(&resolver_mutex);
+    dns_query_t *query = lookup->query;
+    for (httpmorph_dns_lookup_t **p = &query->waiters; *p; p = &(*p)->next) {
+        if (*p == lookup) {
+            *p = lookup->next;
+            break;
+        }
+    }
+    query_unref_locked(query);
+    pthread_mutex_unlock(&resolver_mutex);
+
+    free(lookup);
+}
+
+/**
+ * Stop the resolver threads
+ */
+void httpmorph_resolver_shutdown(void) {
+    resolver_init_sync();
+    pthread_mutex_lock(&resolver_mutex);
+    if (resolver_thread_count == 0) {
+        pthread_mutex_unlock(&resolver_mutex);
+        return;
+    }
+    resolver_stopping = true;
+    pthread_cond_broadcast(&resolver_job_cond);
+    pthread_mutex_unlock(&resolver_mutex);
+
+    /* Workers finish the query they are running, then exit */
+    for (int i = 0; i < resolver_thread_count; i++) {
+        pthread_join(resolver_threads[i], NULL);
+    }
+
+    pthread_mutex_lock(&resolver_mutex);
+    resolver_thread_count = 0;
+    resolver_stopping = false;
+
+    /* Fail queries nobody got to */
+    while (resolver_job_head) {
+        dns_query_t *query = resolver_job_head;
+        resolver_job_head = query->next_job;
+        query_finish_locked(query, NULL, EAI_AGAIN);
+    }
+    resolver_job_tail = NULL;
+    pthread_mutex_unlock(&resolver_mutex);
+}
+
+/* ====================================================================
+ * CONFIGURATION
+ * ==================================================================== */
+
+/**
+ * Parse "ip", "ip:port", "[ipv6]" or "[ipv6]:port"
+ */
+static int parse_server(const char *token, size_t len, struct sockaddr_storage *addr,
+                        socklen_t *addr_len) {
+    char buf[64];
+    if (len == 0 || len >= sizeof(buf)) {
+        return -1;
+    }
+    memcpy(buf, token, len);
+    buf[len] = '\0';
+
+    char *host = buf;
+    char *port_str = NULL;
+    if (buf[0] == '[') {
+        char *close_bracket = strchr(buf, ']');
+        if (!close_bracket) {
+            return -1;
+        }
+        *close_bracket = '\0';
+        host = buf + 1;
+        if (close_bracket[1] == ':') {
+            port_str = close_bracket + 2;
+        } else if (close_bracket[1] != '\0') {
+            return -1;
+        }
+    } else {
+        char *colon = strchr(buf, ':');
+        if (colon && !strchr(colon + 1, ':')) {
+            /* Exactly one colon: IPv4 with port */
+            *colon = '\0';
+            port_str = colon + 1;
+        }
+    }
+
+    int port = 53;
+    if (port_str) {
+        char *end = NULL;
+        long value = strtol(port_str, &end, 10);
+        if (!end || *end != '\0' || value <= 0 || value > 65535) {
+            return -1;
+        }
+        port = (int)value;
+    }
+
+    memset(addr, 0, sizeof(*addr));
+    struct sockaddr_in *sin = (struct sockaddr_in*)addr;
+    struct sockaddr_in6 *sin6 = (struct sockaddr_in6*)addr;
+    if (inet_pton(AF_INET, host, &sin->sin_addr) == 1) {
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons((uint16_t)port);
+        *addr_len = sizeof(struct sockaddr_in);
+        return 0;
+    }
+    if (inet_pton(AF_INET6, host, &sin6->sin6_addr) == 1) {
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons((uint16_t)port);
+        *addr_len = sizeof(struct sockaddr_in6);
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * Send DNS queries straight to the given name servers
+ */
+int httpmorph_set_dns_servers(const char *servers, uint32_t timeout_ms) {
+    resolver_servers_t config;
+    memset(&config, 0, sizeof(config));
+    config.timeout_ms = timeout_ms ? timeout_ms : DNS_RESOLVER_TIMEOUT_MS;
+
+    const char *p = servers;
+    while (p && *p) {
+        while (*p == ' ' || *p == ',') p++;
+        if (!*p) {
+            break;
+        }
+        const char *end = p;
+        while (*end && *end != ',' && *end != ' ') end++;
+
+        if (config.count >= DNS_RESOLVER_MAX_SERVERS ||
+            parse_server(p, (size_t)(end - p), &config.addrs[config.count],
+                         &config.addr_lens[config.count]) < 0) {
+            return -1;
+        }
+        config.count++;
+        p = end;
+    }
+
+    resolver_init_sync();
+    pthread_mutex_lock(&resolver_mutex);
+    resolver_servers = config;
+    pthread_mutex_unlock(&resolver_mutex);
+
+    /* Answers from the previous resolver shouldn't outlive the switch */
+    dns_cache_clear();
+    return 0;
+}
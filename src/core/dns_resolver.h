@@ -0,0 +1,102 @@
+/**
+ * dns_resolver.h - Non-blocking DNS resolution
+ *
+ * Lookups run on a small pool of resolver threads so a slow name server
+ * never stalls the thread that asked. Concurrent lookups for the same
+ * host:port share one query. When a query finishes, every waiter's notify
+ * fd is signalled - the async manager passes its io_engine wakeup fd, so
+ * completions arrive through io_engine_wait().
+ *
+ * By default queries go through getaddrinfo() (the system resolver sends
+ * A and AAAA together). With httpmorph_set_dns_servers() they go straight
+ * to the configured name servers instead, A and AAAA in parallel over UDP.
+ * Successful results are stored in the shared DNS cache (network.c).
+ */
+
+#ifndef HTTPMORPH_DNS_RESOLVER_H
+#define HTTPMORPH_DNS_RESOLVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/socket.h>
+    #include <netdb.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Resolver threads, started on the first lookup */
+#define DNS_RESOLVER_THREADS 4
+
+/* Configured name servers */
+#define DNS_RESOLVER_MAX_SERVERS 4
+
+/* Per-server timeout when none is configured */
+#define DNS_RESOLVER_TIMEOUT_MS 2000
+
+/**
+ * One caller's interest in a (possibly shared) query
+ */
+typedef struct httpmorph_dns_lookup httpmorph_dns_lookup_t;
+
+/**
+ * Start resolving host:port
+ *
+ * Joins a query already in flight for the same host:port.
+ *
+ * @param host Hostname or IP address
+ * @param port Port number
+ * @param notify_fd Written to (8 bytes) when the query finishes, -1 for none
+ * @return Lookup handle, or NULL on allocation failure
+ */
+httpmorph_dns_lookup_t* httpmorph_resolver_start(const char *host, uint16_t port, int notify_fd);
+
+/**
+ * Check whether a lookup has finished
+ *
+ * @param lookup Lookup handle
+ * @return true once the result (or error) is available
+ */
+bool httpmorph_dns_lookup_done(httpmorph_dns_lookup_t *lookup);
+
+/**
+ * Block until a lookup finishes
+ *
+ * @param lookup Lookup handle
+ * @param timeout_ms Maximum wait (0 waits indefinitely)
+ * @return 0 if finished, -1 on timeout
+ */
+int httpmorph_dns_lookup_wait(httpmorph_dns_lookup_t *lookup, uint32_t timeout_ms);
+
+/**
+ * Get the result of a finished lookup
+ *
+ * @param lookup Lookup handle (finished)
+ * @param gai_error Output: getaddrinfo()-style error on failure (may be NULL)
+ * @return Address list (free with httpmorph_dns_free()), NULL on error
+ */
+struct addrinfo* httpmorph_dns_lookup_result(httpmorph_dns_lookup_t *lookup, int *gai_error);
+
+/**
+ * Release a lookup handle (finished or not)
+ *
+ * @param lookup Lookup handle (may be NULL)
+ */
+void httpmorph_dns_lookup_release(httpmorph_dns_lookup_t *lookup);
+
+/**
+ * Stop the resolver threads (called from httpmorph_cleanup())
+ */
+void httpmorph_resolver_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_DNS_RESOLVER_H */
@@ -0,0 +1,338 @@
+/**
+ * happy_eyeballs.c - RFC 8305 connection racing
+ */
+
+#ifndef _WIN32
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "happy_eyeballs.h"
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #define HE_CLOSE(fd) closesocket(fd)
+    #define HE_LAST_ERROR() WSAGetLastError()
+    #define HE_IN_PROGRESS(err) ((err) == WSAEWOULDBLOCK)
+    #define HE_POLL(fds, n, ms) WSAPoll(fds, (ULONG)(n), ms)
+    typedef WSAPOLLFD he_pollfd_t;
+#else
+    #include <unistd.h>
+    #include <errno.h>
+    #include <fcntl.h>
+    #include <poll.h>
+    #define HE_CLOSE(fd) close(fd)
+    #define HE_LAST_ERROR() errno
+    #define HE_IN_PROGRESS(err) ((err) == EINPROGRESS)
+    #define HE_POLL(fds, n, ms) poll(fds, (nfds_t)(n), ms)
+    typedef struct pollfd he_pollfd_t;
+#endif
+
+/* One address being raced */
+typedef struct {
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+    int family;
+    int socktype;
+    int protocol;
+    int fd;                     /* -1 until started and once finished */
+} he_attempt_t;
+
+/* Connection racer */
+struct happy_eyeballs {
+    he_attempt_t attempts[HAPPY_EYEBALLS_MAX_ATTEMPTS];
+    size_t count;
+    size_t next;                /* Next attempt to start */
+    size_t in_flight;           /* Attempts connecting right now */
+    uint64_t next_start_us;     /* When the next attempt may start */
+    uint64_t attempt_delay_us;
+    int winner;                 /* Attempt index, -1 until connected */
+    int last_error;
+    happy_eyeballs_setup_t setup;
+};
+
+/* Helper: Append an address to the attempt list */
+static void he_add(happy_eyeballs_t *he, const struct addrinfo *ai) {
+    if (he->count >= HAPPY_EYEBALLS_MAX_ATTEMPTS || !ai->ai_addr ||
+        ai->ai_addrlen > sizeof(struct sockaddr_storage)) {
+        return;
+    }
+
+    he_attempt_t *attempt = &he->attempts[he->count++];
+    memcpy(&attempt->addr, ai->ai_addr, ai->ai_addrlen);
+    attempt->addr_len = (socklen_t)ai->ai_addrlen;
+    attempt->family = ai->ai_family;
+    attempt->socktype = ai->ai_socktype ? ai->ai_socktype : SOCK_STREAM;
+    attempt->protocol = ai->ai_protocol;
+    attempt->fd = -1;
+}
+
+/**
+ * Create a racer for a resolved address list
+ */
+happy_eyeballs_t* happy_eyeballs_create(const struct addrinfo *addrs, int preferred_family,
+                                        uint32_t attempt_delay_ms, happy_eyeballs_setup_t setup) {
+    if (!addrs) {
+        return NULL;
+    }
+
+    happy_eyeballs_t *he = calloc(1, sizeof(happy_eyeballs_t));
+    if (!he) {
+        return NULL;
+    }
+
+    he->attempt_delay_us = (uint64_t)(attempt_delay_ms ? attempt_delay_ms
+                                                       : HAPPY_EYEBALLS_ATTEMPT_DELAY_MS) * 1000;
+    he->winner = -1;
+    he->setup = setup;
+
+    /* Without a remembered preference, the resolver's (RFC 6724) order decides */
+    int first_family = preferred_family;
+    bool have_preferred = false;
+    for (const struct addrinfo *ai = addrs; ai; ai = ai->ai_next) {
+        if (ai->ai_family == preferred_family) {
+            have_preferred = true;
+            break;
+        }
+    }
+    if (!have_preferred) {
+        first_family = addrs->ai_family;
+    }
+
+    /* Interleave: one of the first family, one of the others, and so on,
+     * each in resolver order (RFC 8305 section 4) */
+    const struct addrinfo *first = addrs;
+    const struct addrinfo *other = addrs;
+    bool take_first = true;
+    for (;;) {
+        while (first && first->ai_family != first_family) first = first->ai_next;
+        while (other && other->ai_family == first_family) other = other->ai_next;
+        if (!first && !other) {
+            break;
+        }
+
+        if ((take_first && first) || !other) {
+            he_add(he, first);
+            first = first->ai_next;
+        } else {
+            he_add(he, other);
+            other = other->ai_next;
+        }
+        take_first = !take_first;
+    }
+
+    if (he->count == 0) {
+        free(he);
+        return NULL;
+    }
+    return he;
+}
+
+/* Helper: Close a finished attempt */
+static void he_attempt_close(happy_eyeballs_t *he, he_attempt_t *attempt) {
+    if (attempt->fd >= 0) {
+        HE_CLOSE(attempt->fd);
+        attempt->fd = -1;
+        he->in_flight--;
+    }
+}
+
+/* Helper: Start the next attempt; returns CONNECTED, IN_PROGRESS or FAILED */
+static int he_start_next(happy_eyeballs_t *he, uint64_t now_us) {
+    size_t index = he->next++;
+    he_attempt_t *attempt = &he->attempts[index];
+
+    int fd = (int)socket(attempt->family, attempt->socktype, attempt->protocol);
+    if (fd < 0) {
+        he->last_error = HE_LAST_ERROR();
+        return HAPPY_EYEBALLS_FAILED;
+    }
+
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(fd, FIONBIO, &mode);
+#else
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+#endif
+
+    if (he->setup) {
+        he->setup(fd);
+    }
+
+    attempt->fd = fd;
+    he->in_flight++;
+    he->next_start_us = now_us + he->attempt_delay_us;
+
+    if (connect(fd, (struct sockaddr*)&attempt->addr, attempt->addr_len) == 0) {
+        he->winner = (int)index;
+        return HAPPY_EYEBALLS_CONNECTED;
+    }
+
+    int err = HE_LAST_ERROR();
+    if (HE_IN_PROGRESS(err)) {
+        return HAPPY_EYEBALLS_IN_PROGRESS;
+    }
+
+    he->last_error = err;
+    he_attempt_close(he, attempt);
+    return HAPPY_EYEBALLS_FAILED;
+}
+
+/* Helper: Poll the in-flight attempts (poll, not select: fds may exceed FD_SETSIZE) */
+static int he_poll(happy_eyeballs_t *he, he_pollfd_t *fds, size_t *index, int timeout_ms) {
+    int n = 0;
+    for (size_t i = 0; i < he->next; i++) {
+        if (he->attempts[i].fd >= 0) {
+            fds[n].fd = he->attempts[i].fd;
+            fds[n].events = POLLOUT;
+            fds[n].revents = 0;
+            index[n] = i;
+            n++;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+    return HE_POLL(fds, n, timeout_ms) > 0 ? n : 0;
+}
+
+/* Helper: Collect attempts that finished connecting; returns true on a winner */
+static bool he_collect(happy_eyeballs_t *he, uint64_t now_us) {
+    he_pollfd_t fds[HAPPY_EYEBALLS_MAX_ATTEMPTS];
+    size_t index[HAPPY_EYEBALLS_MAX_ATTEMPTS];
+
+    int n = he_poll(he, fds, index, 0);
+    for (int i = 0; i < n; i++) {
+        if (!(fds[i].revents & (POLLOUT | POLLERR | POLLHUP))) {
+            continue;
+        }
+
+        he_attempt_t *attempt = &he->attempts[index[i]];
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (getsockopt(attempt->fd, SOL_SOCKET, SO_ERROR, (char*)&error, &len) == 0 && error == 0) {
+            he->winner = (int)index[i];
+            return true;
+        }
+
+        /* Failed - don't wait out the delay before trying the next address */
+        he->last_error = error;
+        he_attempt_close(he, attempt);
+        he->next_start_us = now_us;
+    }
+    return false;
+}
+
+/**
+ * Advance the race without blocking
+ */
+int happy_eyeballs_step(happy_eyeballs_t *he, uint64_t now_us) {
+    if (!he) {
+        return HAPPY_EYEBALLS_FAILED;
+    }
+    if (he->winner >= 0) {
+        return HAPPY_EYEBALLS_CONNECTED;
+    }
+
+    if (he_collect(he, now_us)) {
+        return HAPPY_EYEBALLS_CONNECTED;
+    }
+
+    /* Start attempts that are due; failures move straight on to the next */
+    while (he->next < he->count && (he->in_flight == 0 || now_us >= he->next_start_us)) {
+        int rc = he_start_next(he, now_us);
+        if (rc != HAPPY_EYEBALLS_FAILED) {
+            return rc;
+        }
+    }
+
+    return he->in_flight > 0 ? HAPPY_EYEBALLS_IN_PROGRESS : HAPPY_EYEBALLS_FAILED;
+}
+
+/**
+ * Block until an attempt finishes, the next attempt is due, or timeout
+ */
+void happy_eyeballs_wait(happy_eyeballs_t *he, uint64_t now_us, uint32_t timeout_ms) {
+    if (!he || he->in_flight == 0) {
+        return;
+    }
+
+    uint64_t wait_us = (uint64_t)timeout_ms * 1000;
+    if (he->next < he->count) {
+        uint64_t until_next = he->next_start_us > now_us ? he->next_start_us - now_us : 0;
+        if (until_next < wait_us) {
+            wait_us = until_next;
+        }
+    }
+
+    he_pollfd_t fds[HAPPY_EYEBALLS_MAX_ATTEMPTS];
+    size_t index[HAPPY_EYEBALLS_MAX_ATTEMPTS];
+    he_poll(he, fds, index, (int)((wait_us + 999) / 1000));
+}
+
+/**
+ * Get when the next attempt is due
+ */
+uint64_t happy_eyeballs_next_attempt_us(const happy_eyeballs_t *he) {
+    if (!he || he->winner >= 0 || he->next >= he->count) {
+        return 0;
+    }
+    return he->next_start_us;
+}
+
+/**
+ * Get the number of attempts
+ */
+size_t happy_eyeballs_attempt_count(const happy_eyeballs_t *he) {
+    return he ? he->count : 0;
+}
+
+/**
+ * Get the socket of an attempt that is still connecting
+ */
+int happy_eyeballs_attempt_fd(const happy_eyeballs_t *he, size_t index) {
+    if (!he || index >= he->count) {
+        return -1;
+    }
+    return he->attempts[index].fd;
+}
+
+/**
+ * Take ownership of the winning socket
+ */
+int happy_eyeballs_take_winner(happy_eyeballs_t *he, int *family) {
+    if (!he || he->winner < 0) {
+        return -1;
+    }
+
+    he_attempt_t *attempt = &he->attempts[he->winner];
+    int fd = attempt->fd;
+    if (family) {
+        *family = attempt->family;
+    }
+
+    attempt->fd = -1;
+    he->in_flight--;
+    return fd;
+}
+
+/**
+ * Get the error of the most recent failed attempt
+ */
+int happy_eyeballs_last_error(const happy_eyeballs_t *he) {
+    return he ? he->last_error : 0;
+}
+
+/**
+ * Destroy a racer, closing every socket that wasn't taken
+ */
+void happy_eyeballs_destroy(happy_eyeballs_t *he) {
+    if (!he) {
+        return;
+    }
+    for (size_t i = 0; i < he->next; i++) {
+        he_attempt_close(he, &he->attempts[i]);
+    }
+    free(he);
+}
@@ -0,0 +1,142 @@
+/**
+ * happy_eyeballs.h - RFC 8305 connection racing
+ *
+ * Races non-blocking TCP connects across all resolved addresses. Address
+ * families are interleaved (preferred family first) and a new attempt is
+ * started every HAPPY_EYEBALLS_ATTEMPT_DELAY_MS, or as soon as one fails,
+ * while earlier attempts keep running. The first attempt to connect wins.
+ *
+ * The racer never blocks in happy_eyeballs_step(); the blocking connect
+ * path waits with happy_eyeballs_wait(), the async engine watches the
+ * attempt sockets itself.
+ */
+
+#ifndef HTTPMORPH_HAPPY_EYEBALLS_H
+#define HTTPMORPH_HAPPY_EYEBALLS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef _WIN32
+    #include <winsock2.h>
+    #include <ws2tcpip.h>
+#else
+    #include <sys/socket.h>
+    #include <netdb.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Connection Attempt Delay (RFC 8305 section 5 recommends 250ms) */
+#define HAPPY_EYEBALLS_ATTEMPT_DELAY_MS 250
+
+/* Maximum number of addresses raced per connect */
+#define HAPPY_EYEBALLS_MAX_ATTEMPTS 16
+
+/* happy_eyeballs_step() results */
+#define HAPPY_EYEBALLS_FAILED      -1
+#define HAPPY_EYEBALLS_IN_PROGRESS  0
+#define HAPPY_EYEBALLS_CONNECTED    1
+
+/**
+ * Connection racer
+ */
+typedef struct happy_eyeballs happy_eyeballs_t;
+
+/**
+ * Applies socket options to a new attempt socket before it connects
+ */
+typedef void (*happy_eyeballs_setup_t)(int sockfd);
+
+/**
+ * Create a racer for a resolved address list
+ *
+ * @param addrs Resolved addresses (copied, may be freed afterwards)
+ * @param preferred_family Family to try first (AF_UNSPEC: resolver order)
+ * @param attempt_delay_ms Delay between attempt starts (0 for default)
+ * @param setup Socket option hook (may be NULL)
+ * @return Racer, or NULL if there are no addresses or on allocation failure
+ */
+happy_eyeballs_t* happy_eyeballs_create(const struct addrinfo *addrs, int preferred_family,
+                                        uint32_t attempt_delay_ms, happy_eyeballs_setup_t setup);
+
+/**
+ * Advance the race without blocking
+ *
+ * Collects finished attempts and starts the next one when it is due.
+ *
+ * @param he Racer
+ * @param now_us Current time (httpmorph_get_time_us() clock)
+ * @return HAPPY_EYEBALLS_CONNECTED, HAPPY_EYEBALLS_IN_PROGRESS or
+ *         HAPPY_EYEBALLS_FAILED (every address failed)
+ */
+int happy_eyeballs_step(happy_eyeballs_t *he, uint64_t now_us);
+
+/**
+ * Block until an attempt finishes, the next attempt is due, or timeout
+ *
+ * @param he Racer
+ * @param now_us Current time
+ * @param timeout_ms Upper bound on the wait
+ */
+void happy_eyeballs_wait(happy_eyeballs_t *he, uint64_t now_us, uint32_t timeout_ms);
+
+/**
+ * Get when the next attempt is due
+ *
+ * @param he Racer
+ * @return Start time of the next attempt, or 0 if all have been started
+ */
+uint64_t happy_eyeballs_next_attempt_us(const happy_eyeballs_t *he);
+
+/**
+ * Get the number of attempts (one per raced address)
+ *
+ * @param he Racer
+ * @return Attempt count
+ */
+size_t happy_eyeballs_attempt_count(const happy_eyeballs_t *he);
+
+/**
+ * Get the socket of an attempt that is still connecting
+ *
+ * @param he Racer
+ * @param index Attempt index (0 .. happy_eyeballs_attempt_count() - 1)
+ * @return Socket, or -1 if the attempt hasn't started or has finished
+ */
+int happy_eyeballs_attempt_fd(const happy_eyeballs_t *he, size_t index);
+
+/**
+ * Take ownership of the winning socket
+ *
+ * The socket stays non-blocking.
+ *
+ * @param he Racer (after HAPPY_EYEBALLS_CONNECTED)
+ * @param family Output: address family of the winner (may be NULL)
+ * @return Connected socket, or -1 if there is no winner
+ */
+int happy_eyeballs_take_winner(happy_eyeballs_t *he, int *family);
+
+/**
+ * Get the error of the most recent failed attempt
+ *
+ * @param he Racer
+ * @return errno / WSA error code, 0 if none
+ */
+int happy_eyeballs_last_error(const happy_eyeballs_t *he);
+
+/**
+ * Destroy a racer, closing every socket that wasn't taken
+ *
+ * @param he Racer (may be NULL)
+ */
+void happy_eyeballs_destroy(happy_eyeballs_t *he);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_HAPPY_EYEBALLS_H */
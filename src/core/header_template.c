@@ -0,0 +1,108 @@
+/**
+ * header_template.c - Precomputed request header blocks
+ */
+
+#include "header_template.h"
+#include "internal/compression.h"
+
+/* Default header lines, exactly as the builder would serialize them */
+#define TPL_UA   "User-Agent: " HTTPMORPH_VERSION_STRING "\r\n"
+#define TPL_AC   "Accept: */*\r\n"
+#define TPL_AE   "Accept-Encoding: " HTTPMORPH_ACCEPT_ENCODING "\r\n"
+#define TPL_CO   "Connection: keep-alive\r\n"
+
+#define TPL(s) { s, sizeof(s) - 1 }
+
+typedef struct {
+    const char *data;
+    size_t len;
+} header_template_block_t;
+
+/* Indexed by HEADER_TEMPLATE_* bits; lines keep the send order */
+static const header_template_block_t default_blocks[16] = {
+    TPL(""),
+    TPL(TPL_UA),
+    TPL(TPL_AC),
+    TPL(TPL_UA TPL_AC),
+    TPL(TPL_AE),
+    TPL(TPL_UA TPL_AE),
+    TPL(TPL_AC TPL_AE),
+    TPL(TPL_UA TPL_AC TPL_AE),
+    TPL(TPL_CO),
+    TPL(TPL_UA TPL_CO),
+    TPL(TPL_AC TPL_CO),
+    TPL(TPL_UA TPL_AC TPL_CO),
+    TPL(TPL_AE TPL_CO),
+    TPL(TPL_UA TPL_AE TPL_CO),
+    TPL(TPL_AC TPL_AE TPL_CO),
+    TPL(TPL_UA TPL_AC TPL_AE TPL_CO),
+};
+
+/**
+ * Find which default headers a request leaves for the library to add
+ */
+unsigned header_template_missing_defaults(const httpmorph_header_t *headers, size_t count) {
+    unsigned missing = HEADER_TEMPLATE_ALL_DEFAULTS;
+    for (size_t i = 0; i < count && missing; i++) {
+        const char *key = headers[i].key;
+        switch (strlen(key)) {
+            case 6:
+                if (strcasecmp(key, "Accept") == 0) missing &= ~HEADER_TEMPLATE_ACCEPT;
+                break;
+            case 10:
+                if (strcasecmp(key, "User-Agent") == 0) missing &= ~HEADER_TEMPLATE_USER_AGENT;
+                else if (strcasecmp(key, "Connection") == 0) missing &= ~HEADER_TEMPLATE_CONNECTION;
+                break;
+            case 15:
+                if (strcasecmp(key, "Accept-Encoding") == 0) missing &= ~HEADER_TEMPLATE_ACCEPT_ENCODING;
+                break;
+            default:
+                break;
+        }
+    }
+    return missing;
+}
+
+/**
+ * Get the serialized default headers for a set of bits
+ */
+const char* header_template_defaults(unsigned missing, size_t *len) {
+    const header_template_block_t *block = &default_blocks[missing & HEADER_TEMPLATE_ALL_DEFAULTS];
+    *len = block->len;
+    return block->data;
+}
+
+#ifdef HAVE_NGHTTP2
+
+/* :method values (same mapping as httpmorph_method_to_string) */
+static const header_template_block_t method_values[] = {
+    [HTTPMORPH_GET] = TPL("GET"),
+    [HTTPMORPH_POST] = TPL("POST"),
+    [HTTPMORPH_PUT] = TPL("PUT"),
+    [HTTPMORPH_DELETE] = TPL("DELETE"),
+    [HTTPMORPH_HEAD] = TPL("HEAD"),
+    [HTTPMORPH_OPTIONS] = TPL("OPTIONS"),
+    [HTTPMORPH_PATCH] = TPL("PATCH"),
+};
+
+#define H2_NV(name, value, value_len) \
+    (nghttp2_nv){(uint8_t *)(name), (uint8_t *)(value), sizeof(name) - 1, (value_len), NGHTTP2_NV_FLAG_NONE}
+
+/**
+ * Fill the HTTP/2 pseudo-headers
+ */
+int header_template_h2_prefix(nghttp2_nv *hdrs, httpmorph_method_t method,
+                              const char *path, const char *host) {
+    const header_template_block_t *m = &method_values[HTTPMORPH_GET];
+    if ((size_t)method < sizeof(method_values) / sizeof(method_values[0])) {
+        m = &method_values[method];
+    }
+
+    hdrs[0] = H2_NV(":method", m->data, m->len);
+    hdrs[1] = H2_NV(":path", path, strlen(path));
+    hdrs[2] = H2_NV(":scheme", "https", 5);
+    hdrs[3] = H2_NV(":authority", host, strlen(host));
+    return HEADER_TEMPLATE_H2_PREFIX;
+}
+
+#endif /* HAVE_NGHTTP2 */
@@ -0,0 +1,64 @@
+/**
+ * header_template.h - Precomputed request header blocks
+ *
+ * The fixed part of every outgoing head is serialized once: the HTTP/1.1
+ * default headers (in each combination a request can leave out) and the
+ * HTTP/2 pseudo-header prefix with its name and value lengths. Requests
+ * splice their own fields around them; the bytes on the wire are the same
+ * as building each header separately.
+ */
+
+#ifndef HTTPMORPH_HEADER_TEMPLATE_H
+#define HTTPMORPH_HEADER_TEMPLATE_H
+
+#include "httpmorph.h"
+#include <stddef.h>
+
+#ifdef HAVE_NGHTTP2
+#include <nghttp2/nghttp2.h>
+#endif
+
+/* HTTP/1.1 default headers, in the order they are sent (bit set = add it) */
+#define HEADER_TEMPLATE_USER_AGENT      0x1u
+#define HEADER_TEMPLATE_ACCEPT          0x2u
+#define HEADER_TEMPLATE_ACCEPT_ENCODING 0x4u
+#define HEADER_TEMPLATE_CONNECTION      0x8u
+#define HEADER_TEMPLATE_ALL_DEFAULTS    0xFu
+
+/* Pseudo-headers at the start of every HTTP/2 request */
+#define HEADER_TEMPLATE_H2_PREFIX 4
+
+/**
+ * Find which default headers a request leaves for the library to add
+ *
+ * @param headers Request headers
+ * @param count Number of headers
+ * @return HEADER_TEMPLATE_* bits for the defaults it doesn't set
+ */
+unsigned header_template_missing_defaults(const httpmorph_header_t *headers, size_t count);
+
+/**
+ * Get the serialized default headers for a set of bits
+ * The User-Agent line carries the library's own agent string.
+ *
+ * @param missing HEADER_TEMPLATE_* bits
+ * @param len Output: block length
+ * @return "Name: value\r\n" lines for those headers (static storage)
+ */
+const char* header_template_defaults(unsigned missing, size_t *len);
+
+#ifdef HAVE_NGHTTP2
+/**
+ * Fill the HTTP/2 pseudo-headers (:method, :path, :scheme, :authority)
+ *
+ * @param hdrs Output array with room for HEADER_TEMPLATE_H2_PREFIX entries
+ * @param method Request method
+ * @param path Request path
+ * @param host Authority
+ * @return Number of entries written (HEADER_TEMPLATE_H2_PREFIX)
+ */
+int header_template_h2_prefix(nghttp2_nv *hdrs, httpmorph_method_t method,
+                              const char *path, const char *host);
+#endif
+
+#endif /* HTTPMORPH_HEADER_TEMPLATE_H */
@@ -0,0 +1,221 @@
+/**
+ * hedge_policy.c - When to hedge slow async requests
+ *
+ * Origins sit in a direct-mapped table keyed by the hash of their
+ * "scheme://host:port"; an origin that lands on an occupied slot takes it
+ * over and starts a fresh history. Each origin keeps a ring of its latest
+ * first-byte times, and its percentile is recomputed once a few new
+ * samples have come in rather than on every request.
+ */
+
+#include "hedge_policy.h"
+#include "request_scheduler.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* New samples before an origin's delay is recomputed */
+#define HEDGE_RECOMPUTE_EVERY 8
+
+typedef struct {
+    uint64_t hash;                   /* 0: slot unused */
+    uint32_t samples[HEDGE_POLICY_SAMPLES];  /* Microseconds, ring */
+    uint32_t count;                  /* Samples held (up to HEDGE_POLICY_SAMPLES) */
+    uint32_t next;                   /* Ring position of the next sample */
+    uint32_t fresh;                  /* Samples since delay_us was computed */
+    uint64_t delay_us;               /* Percentile at the last computation (0: none yet) */
+} hedge_origin_t;
+
+struct hedge_policy {
+    hedge_policy_config_t config;    /* Defaults filled in */
+    hedge_origin_t origins[HEDGE_POLICY_SLOTS];
+
+    double credit;                   /* Unspent budget, in hedges */
+    size_t in_flight;
+    uint64_t planned;
+    uint64_t launched;
+    uint64_t won;
+    uint64_t denied;
+};
+
+/**
+ * Hash the origin of a URL (0 if the URL has none that fits)
+ */
+static uint64_t origin_hash(const char *url) {
+    char key[REQUEST_SCHEDULER_MAX_KEY];
+    if (!url || !request_scheduler_origin_key(url, key, sizeof(key))) {
+        return 0;
+    }
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+/**
+ * Compute the configured percentile of an origin's samples
+ */
+static uint64_t origin_percentile(const hedge_policy_t *policy, const hedge_origin_t *origin) {
+    uint32_t sorted[HEDGE_POLICY_SAMPLES];
+    uint32_t n = origin->count;
+    memcpy(sorted, origin->samples, n * sizeof(uint32_t));
+
+    /* Insertion sort: at most HEDGE_POLICY_SAMPLES values, mostly in order */
+    for (uint32_t i = 1; i < n; i++) {
+        uint32_t value = sorted[i];
+        uint32_t j = i;
+        while (j > 0 && sorted[j - 1] > value) {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = value;
+    }
+
+    uint32_t rank = (uint32_t)(policy->config.percentile / 100.0 * n + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > n) {
+        rank = n;
+    }
+    return sorted[rank - 1];
+}
+
+hedge_policy_t* hedge_policy_create(const hedge_policy_config_t *config) {
+    hedge_policy_t *policy = calloc(1, sizeof(hedge_policy_t));
+    if (!policy) {
+        return NULL;
+    }
+    hedge_policy_configure(policy, config);
+    return policy;
+}
+
+void hedge_policy_destroy(hedge_policy_t *policy) {
+    free(policy);
+}
+
+void hedge_policy_configure(hedge_policy_t *policy, const hedge_policy_config_t *config) {
+    if (!policy) {
+        return;
+    }
+    hedge_policy_config_t settings;
+    if (config) {
+        settings = *config;
+    } else {
+        memset(&settings, 0, sizeof(settings));
+    }
+
+    if (settings.percentile <= 0 || settings.percentile > 100) {
+        settings.percentile = HEDGE_POLICY_DEFAULT_PERCENTILE;
+    }
+    if (settings.min_delay_ms == 0) {
+        settings.min_delay_ms = HEDGE_POLICY_DEFAULT_MIN_DELAY_MS;
+    }
+    if (settings.min_samples == 0) {
+        settings.min_samples = HEDGE_POLICY_DEFAULT_MIN_SAMPLES;
+    }
+    if (settings.min_samples > HEDGE_POLICY_SAMPLES) {
+        settings.min_samples = HEDGE_POLICY_SAMPLES;
+    }
+    if (settings.budget <= 0) {
+        settings.budget = HEDGE_POLICY_DEFAULT_BUDGET;
+    }
+    if (settings.budget > 1) {
+        settings.budget = 1;
+    }
+
+    /* A new percentile applies from the next request on */
+    if (settings.percentile != policy->config.percentile) {
+        for (size_t i = 0; i < HEDGE_POLICY_SLOTS; i++) {
+            policy->origins[i].fresh = HEDGE_RECOMPUTE_EVERY;
+        }
+    }
+    policy->config = settings;
+}
+
+uint64_t hedge_policy_plan(hedge_policy_t *policy, const char *url) {
+    if (!policy) {
+        return 0;
+    }
+    policy->credit += policy->config.budget;
+    if (policy->credit > HEDGE_POLICY_MAX_CREDIT) {
+        policy->credit = HEDGE_POLICY_MAX_CREDIT;
+    }
+
+    uint64_t hash = origin_hash(url);
+    hedge_origin_t *origin = &policy->origins[hash & (HEDGE_POLICY_SLOTS - 1)];
+    if (hash == 0 || origin->hash != hash || origin->count < policy->config.min_samples) {
+        return 0;
+    }
+
+    if (origin->delay_us == 0 || origin->fresh >= HEDGE_RECOMPUTE_EVERY) {
+        origin->delay_us = origin_percentile(policy, origin);
+        origin->fresh = 0;
+    }
+
+    uint64_t min_delay_us = (uint64_t)policy->config.min_delay_ms * 1000;
+    policy->planned++;
+    return origin->delay_us > min_delay_us ? origin->delay_us : min_delay_us;
+}
+
+bool hedge_policy_acquire(hedge_policy_t *policy) {
+    if (!policy) {
+        return false;
+    }
+    if (policy->credit < 1.0 ||
+        (policy->config.max_in_flight && policy->in_flight >= policy->config.max_in_flight)) {
+        policy->denied++;
+        return false;
+    }
+    policy->credit -= 1.0;
+    policy->in_flight++;
+    policy->launched++;
+    return true;
+}
+
+void hedge_policy_release(hedge_policy_t *policy, bool won) {
+    if (!policy) {
+        return;
+    }
+    if (policy->in_flight > 0) {
+        policy->in_flight--;
+    }
+    if (won) {
+        policy->won++;
+    }
+}
+
+void hedge_policy_record(hedge_policy_t *policy, const char *url, uint64_t first_byte_us) {
+    uint64_t hash = origin_hash(url);
+    if (!policy || hash == 0) {
+        return;
+    }
+
+    hedge_origin_t *origin = &policy->origins[hash & (HEDGE_POLICY_SLOTS - 1)];
+    if (origin->hash != hash) {
+        memset(origin, 0, sizeof(*origin));
+        origin->hash = hash;
+    }
+
+    origin->samples[origin->next] = first_byte_us > UINT32_MAX ? UINT32_MAX : (uint32_t)first_byte_us;
+    origin->next = (origin->next + 1) % HEDGE_POLICY_SAMPLES;
+    if (origin->count < HEDGE_POLICY_SAMPLES) {
+        origin->count++;
+    }
+    origin->fresh++;
+}
+
+void hedge_policy_get_stats(const hedge_policy_t *policy, hedge_policy_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!policy) {
+        return;
+    }
+    stats->planned = policy->planned;
+    stats->launched = policy->launched;
+    stats->won = policy->won;
+    stats->denied = policy->denied;
+    stats->in_flight = policy->in_flight;
+}
@@ -0,0 +1,108 @@
+/**
+ * hedge_policy.h - When to hedge slow async requests
+ *
+ * Keeps the time to first response byte of recent requests per origin and
+ * turns it into a hedge delay: a request that has seen no response byte
+ * once the origin's chosen percentile has passed is sent a second time,
+ * and whichever copy answers first wins. Hedges are paid for from a budget
+ * that grows by a fixed fraction of every hedgeable request, so no more
+ * than that share of traffic is ever sent twice. Caller-side locking; the
+ * policy does no I/O and reads no clock of its own.
+ */
+
+#ifndef HTTPMORPH_HEDGE_POLICY_H
+#define HTTPMORPH_HEDGE_POLICY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Defaults for hedge_policy_config_t fields left at 0 */
+#define HEDGE_POLICY_DEFAULT_PERCENTILE  95.0
+#define HEDGE_POLICY_DEFAULT_MIN_DELAY_MS 10
+#define HEDGE_POLICY_DEFAULT_MIN_SAMPLES 20
+#define HEDGE_POLICY_DEFAULT_BUDGET      0.05
+
+/* First-byte samples kept per origin (the delay follows the latest ones) */
+#define HEDGE_POLICY_SAMPLES 64
+
+/* Origins tracked at once (power of 2; colliding origins replace each other) */
+#define HEDGE_POLICY_SLOTS 256
+
+/* Unspent budget saved up for bursts of slow requests, in hedges */
+#define HEDGE_POLICY_MAX_CREDIT 10.0
+
+typedef struct {
+    double percentile;               /* First-byte percentile to wait for (default 95) */
+    uint32_t min_delay_ms;           /* Never hedge sooner (default 10) */
+    uint32_t min_samples;            /* History an origin needs to be hedged (default 20) */
+    double budget;                   /* Hedges per hedgeable request (default 0.05) */
+    uint32_t max_in_flight;          /* Hedges running at once (default unlimited) */
+} hedge_policy_config_t;
+
+typedef struct {
+    uint64_t planned;                /* Requests given a hedge delay */
+    uint64_t launched;               /* Hedges sent */
+    uint64_t won;                    /* Hedges that answered first */
+    uint64_t denied;                 /* Hedges due but refused by the budget */
+    size_t in_flight;                /* Hedges running */
+} hedge_policy_stats_t;
+
+typedef struct hedge_policy hedge_policy_t;
+
+/**
+ * Create a policy
+ * @param config Settings (NULL for defaults)
+ */
+hedge_policy_t* hedge_policy_create(const hedge_policy_config_t *config);
+
+/**
+ * Destroy a policy
+ */
+void hedge_policy_destroy(hedge_policy_t *policy);
+
+/**
+ * Change the settings (history and budget are kept)
+ */
+void hedge_policy_configure(hedge_policy_t *policy, const hedge_policy_config_t *config);
+
+/**
+ * Plan a hedgeable request: accrue budget and get its hedge delay
+ *
+ * @param url Request URL (selects the origin)
+ * @return Microseconds to wait for a first byte before hedging, 0 if the
+ *         origin doesn't have enough history yet
+ */
+uint64_t hedge_policy_plan(hedge_policy_t *policy, const char *url);
+
+/**
+ * Take one hedge from the budget
+ * @return true if the hedge may be sent (release it with hedge_policy_release())
+ */
+bool hedge_policy_acquire(hedge_policy_t *policy);
+
+/**
+ * Account for a finished hedge
+ * @param won true if the hedge answered before the request it duplicated
+ */
+void hedge_policy_release(hedge_policy_t *policy, bool won);
+
+/**
+ * Record how long a request on an origin waited for its first response byte
+ */
+void hedge_policy_record(hedge_policy_t *policy, const char *url, uint64_t first_byte_us);
+
+/**
+ * Get counters
+ */
+void hedge_policy_get_stats(const hedge_policy_t *policy, hedge_policy_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_HEDGE_POLICY_H */
@@ -4,20 +4,31 @@
 
 #include "internal/http1.h"
 #include "internal/util.h"
+#include "internal/request.h"
+#include "internal/network.h"
 #include "internal/response.h"
+#include "internal/compression.h"
 #include "buffer_pool.h"
 #include "request_builder.h"
+#include "header_template.h"
+#include "http1_parser.h"
 #include <string.h>
 #include <stdlib.h>
+#include <limits.h>
 
 #ifdef _WIN32
     #include <winsock2.h>
     #include <ws2tcpip.h>
 #else
     #include <sys/socket.h>
+    #include <sys/uio.h>
     #include <errno.h>
 #endif
 
+/* Response head buffering: read in small steps, growing up to the request's cap */
+#define HTTP1_HEAD_READ_SIZE 4096
+#define HTTP1_HEAD_INITIAL_SIZE BUFFER_SIZE_16KB    /* Only when the response has no body buffer */
+
 /**
  * Helper: Reallocate response body buffer using buffer pool
  *
@@ -68,35 +79,500 @@ static uint8_t* realloc_body_buffer(httpmorph_response_t *response, size_t new_c
     return new_body;
 }
 
-/* Helper: Add response header (used by recv_http_response) */
-static int add_response_header(httpmorph_response_t *response,
-                               const char *key, const char *value) {
-    /* Check if we need to grow the array - use exponential growth */
-    if (response->header_count >= response->header_capacity) {
-        size_t new_capacity = response->header_capacity * 2;
-        httpmorph_header_t *new_headers = realloc(response->headers,
-                                                   new_capacity * sizeof(httpmorph_header_t));
-        if (!new_headers) {
+/**
+ * Helper: Take bytes from the front of a readahead buffer
+ */
+static size_t readahead_take(http1_readahead_t *readahead, uint8_t *buf, size_t len) {
+    size_t n = len < readahead->len ? len : readahead->len;
+    memcpy(buf, readahead->data + readahead->start, n);
+    readahead->start += n;
+    readahead->len -= n;
+    if (readahead->len == 0) {
+        readahead->start = 0;
+    }
+    return n;
+}
+
+/**
+ * Helper: Keep bytes read past a response, ahead of any kept before
+ */
+static bool readahead_keep(http1_readahead_t *readahead, const void *data, size_t len) {
+    if (!readahead || len == 0) {
+        return true;
+    }
+    if (len <= readahead->start) {
+        /* Fits in the space already taken from the front */
+        readahead->start -= len;
+        memcpy(readahead->data + readahead->start, data, len);
+        readahead->len += len;
+        return true;
+    }
+    if (readahead->len + len > readahead->capacity) {
+        size_t capacity = readahead->capacity ? readahead->capacity : HTTP1_HEAD_READ_SIZE;
+        while (capacity < readahead->len + len) {
+            capacity *= 2;
+        }
+        uint8_t *data_new = realloc(readahead->data, capacity);
+        if (!data_new) {
+            return false;
+        }
+        readahead->data = data_new;
+        readahead->capacity = capacity;
+    }
+    memmove(readahead->data + len, readahead->data + readahead->start, readahead->len);
+    memcpy(readahead->data, data, len);
+    readahead->start = 0;
+    readahead->len += len;
+    return true;
+}
+
+void http1_readahead_free(http1_readahead_t *readahead) {
+    if (readahead) {
+        free(readahead->data);
+        memset(readahead, 0, sizeof(*readahead));
+    }
+}
+
+/**
+ * Helper: Read from the connection (TLS or plain), readahead first
+ */
+static int http1_read(SSL *ssl, int sockfd, http1_readahead_t *readahead, uint8_t *buf, size_t len) {
+    if (len > INT_MAX) {
+        len = INT_MAX;
+    }
+    if (readahead && readahead->len > 0) {
+        return (int)readahead_take(readahead, buf, len);
+    }
+    if (ssl) {
+        return SSL_read(ssl, buf, (int)len);
+    }
+    return (int)recv(sockfd, (char*)buf, len, 0);
+}
+
+/**
+ * Body sink: accumulates the body in response->body, or - when the request
+ * has a body callback - hands it over in chunk_size pieces, reusing the
+ * same buffer so memory use does not depend on the response size.
+ * Compressed bodies pass through a decoder on the way in.
+ */
+typedef struct {
+    httpmorph_response_t *response;
+    httpmorph_body_callback_t callback;
+    void *userdata;
+    size_t chunk_size;
+    size_t len;         /* Bytes currently held in response->body */
+    bool aborted;       /* Callback asked to stop, or out of memory */
+    httpmorph_decoder_t *decoder;   /* Content-Encoding decoder (NULL = as received) */
+    size_t encoded_len; /* Bytes fed to the decoder */
+    bool decode_failed; /* Body is not valid for its Content-Encoding */
+    size_t wire_len;    /* Body bytes received, before decoding */
+} body_sink_t;
+
+static void body_sink_init(body_sink_t *sink, httpmorph_response_t *response,
+                           const httpmorph_request_t *request) {
+    memset(sink, 0, sizeof(*sink));
+    sink->response = response;
+
+    if (request && request->body_callback) {
+        sink->callback = request->body_callback;
+        sink->userdata = request->body_callback_userdata;
+        sink->chunk_size = request->body_chunk_size > 0 ?
+                           request->body_chunk_size : HTTPMORPH_DEFAULT_BODY_CHUNK_SIZE;
+
+        if (response->body_capacity < sink->chunk_size &&
+            !realloc_body_buffer(response, sink->chunk_size, 0)) {
+            /* Fall back to smaller chunks in the existing buffer */
+            sink->chunk_size = response->body_capacity;
+        }
+        if (sink->chunk_size == 0 || !response->body) {
+            sink->aborted = true;
+        }
+    }
+}
+
+/* Hand buffered bytes to the callback */
+static bool body_sink_flush(body_sink_t *sink) {
+    if (sink->callback && sink->len > 0 && !sink->aborted) {
+        if (sink->callback(sink->response, sink->response->body, sink->len, sink->userdata) < 0) {
+            sink->aborted = true;
+        }
+        sink->len = 0;
+    }
+    return !sink->aborted;
+}
+
+/* Tell the callback that status and headers are available */
+static void body_sink_head(body_sink_t *sink) {
+    if (sink->callback && !sink->aborted &&
+        sink->callback(sink->response, NULL, 0, sink->userdata) < 0) {
+        sink->aborted = true;
+    }
+}
+
+/**
+ * Get space for up to `want` more body bytes
+ * Grows the buffer when full (buffered mode) or flushes a full chunk
+ * (streaming mode). Returns NULL if no space can be made.
+ */
+static uint8_t* body_sink_out_reserve(body_sink_t *sink, size_t want, size_t *avail) {
+    httpmorph_response_t *response = sink->response;
+
+    if (sink->aborted) {
+        return NULL;
+    }
+
+    if (sink->callback) {
+        if (sink->len >= sink->chunk_size && !body_sink_flush(sink)) {
+            return NULL;
+        }
+        *avail = sink->chunk_size - sink->len;
+    } else {
+        if (sink->len >= response->body_capacity) {
+            /* Use 2x growth strategy; check for integer overflow first */
+            if (want > SIZE_MAX / 2 - sink->len || response->body_capacity > SIZE_MAX / 2) {
+                return NULL;
+            }
+            size_t new_capacity = response->body_capacity * 2;
+            if (new_capacity < sink->len + want) {
+                new_capacity = sink->len + want;
+            }
+            if (!realloc_body_buffer(response, new_capacity, sink->len)) {
+                return NULL;
+            }
+        }
+        *avail = response->body_capacity - sink->len;
+    }
+
+    if (*avail > want) {
+        *avail = want;
+    }
+    return response->body + sink->len;
+}
+
+/* Account for bytes written into the space from body_sink_out_reserve() */
+static void body_sink_out_commit(body_sink_t *sink, size_t n) {
+    sink->len += n;
+    if (sink->callback && sink->len >= sink->chunk_size) {
+        body_sink_flush(sink);
+    }
+}
+
+/* Copy decoded body bytes into the sink */
+static bool body_sink_out_write(body_sink_t *sink, const uint8_t *data, size_t n) {
+    while (n > 0) {
+        size_t avail = 0;
+        uint8_t *dst = body_sink_out_reserve(sink, n, &avail);
+        if (!dst || avail == 0) {
+            return false;
+        }
+        memcpy(dst, data, avail);
+        body_sink_out_commit(sink, avail);
+        data += avail;
+        n -= avail;
+    }
+    return !sink->aborted;
+}
+
+/* Decoder output callback */
+static int body_sink_decoded(void *ctx, const uint8_t *data, size_t len) {
+    return body_sink_out_write((body_sink_t *)ctx, data, len) ? 0 : -1;
+}
+
+/* Set up decoding from the response's Content-Encoding */
+static void body_sink_decode_init(body_sink_t *sink) {
+    httpmorph_response_t *response = sink->response;
+    sink->decoder = httpmorph_decoder_create(
+        httpmorph_response_get_header(response, "Content-Encoding"),
+        (httpmorph_buffer_pool_t*)response->_buffer_pool);
+}
+
+/* Feed received bytes through the decoder */
+static bool body_sink_decode(body_sink_t *sink, const uint8_t *data, size_t n) {
+    if (n == 0) {
+        return !sink->aborted;
+    }
+
+    bool first = sink->encoded_len == 0;
+    sink->encoded_len += n;
+    if (httpmorph_decoder_write(sink->decoder, data, n, body_sink_decoded, sink) == 0) {
+        return !sink->aborted;
+    }
+    if (sink->aborted) {
+        return false;  /* Output side stopped */
+    }
+
+    httpmorph_decoder_destroy(sink->decoder);
+    sink->decoder = NULL;
+    if (first && sink->len == 0) {
+        /* Mislabeled body: nothing decoded yet, so keep it as received */
+        return body_sink_out_write(sink, data, n);
+    }
+    sink->decode_failed = true;
+    sink->aborted = true;
+    return false;
+}
+
+/**
+ * Get space for up to `want` more received body bytes
+ * Compressed bodies are staged in the decoder's input buffer.
+ */
+static uint8_t* body_sink_reserve(body_sink_t *sink, size_t want, size_t *avail) {
+    if (sink->decoder && !sink->aborted) {
+        uint8_t *buf = httpmorph_decoder_input_buffer(sink->decoder, avail);
+        if (!buf) {
+            sink->aborted = true;
+            return NULL;
+        }
+        if (*avail > want) {
+            *avail = want;
+        }
+        return buf;
+    }
+    return body_sink_out_reserve(sink, want, avail);
+}
+
+/* Account for bytes received into the space from body_sink_reserve() */
+static void body_sink_commit(body_sink_t *sink, size_t n) {
+    sink->wire_len += n;
+    if (sink->decoder) {
+        size_t size = 0;
+        body_sink_decode(sink, httpmorph_decoder_input_buffer(sink->decoder, &size), n);
+    } else {
+        body_sink_out_commit(sink, n);
+    }
+}
+
+/* Copy received body bytes into the sink */
+static bool body_sink_write(body_sink_t *sink, const uint8_t *data, size_t n) {
+    sink->wire_len += n;
+    if (sink->decoder) {
+        return body_sink_decode(sink, data, n);
+    }
+    return body_sink_out_write(sink, data, n);
+}
+
+/* Deliver any remaining chunk and set the final body length */
+static void body_sink_finish(body_sink_t *sink) {
+    if (sink->decoder) {
+        /* A truncated stream keeps what decoded, as truncated plain bodies do */
+        if (!sink->aborted && sink->encoded_len > 0) {
+            httpmorph_decoder_finish(sink->decoder, body_sink_decoded, sink);
+        }
+        httpmorph_decoder_destroy(sink->decoder);
+        sink->decoder = NULL;
+    }
+    body_sink_flush(sink);
+    sink->response->body_len = sink->callback ? 0 : sink->len;
+    sink->response->body_wire_len = sink->wire_len;
+}
+
+/* TLS plaintext per record; bodies are written one record at a time */
+#define HTTP1_TLS_RECORD_SIZE 16384
+
+/* Helper: Write a whole buffer over TLS in record-sized pieces */
+static int http1_ssl_write_all(SSL *ssl, const uint8_t *data, size_t len) {
+    while (len > 0) {
+        int chunk = (int)(len < HTTP1_TLS_RECORD_SIZE ? len : HTTP1_TLS_RECORD_SIZE);
+        int sent = SSL_write(ssl, data, chunk);
+        if (sent <= 0) {
+            return -1;
+        }
+        data += sent;
+        len -= (size_t)sent;
+    }
+    return 0;
+}
+
+/* Helper: Send two buffers over a plain socket as one gathered write */
+static int http1_send_gather(int sockfd, const uint8_t *a, size_t a_len,
+                             const uint8_t *b, size_t b_len) {
+#ifdef _WIN32
+    WSABUF bufs[2] = {{(ULONG)a_len, (char *)a}, {(ULONG)b_len, (char *)b}};
+    DWORD idx = 0;
+    while (idx < 2) {
+        if (bufs[idx].len == 0) {
+            idx++;
+            continue;
+        }
+        DWORD sent = 0;
+        if (WSASend(sockfd, bufs + idx, 2 - idx, &sent, 0, NULL, NULL) != 0 || sent == 0) {
+            return -1;
+        }
+        while (idx < 2 && sent >= bufs[idx].len) {
+            sent -= bufs[idx].len;
+            bufs[idx++].len = 0;
+        }
+        if (idx < 2) {
+            bufs[idx].buf += sent;
+            bufs[idx].len -= sent;
+        }
+    }
+#else
+    struct iovec iov[2] = {{(void *)a, a_len}, {(void *)b, b_len}};
+    struct msghdr msg;
+    int idx = 0;
+    while (idx < 2) {
+        if (iov[idx].iov_len == 0) {
+            idx++;
+            continue;
+        }
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov + idx;
+        msg.msg_iovlen = (size_t)(2 - idx);
+#ifdef MSG_NOSIGNAL
+        ssize_t sent = sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+#else
+        ssize_t sent = sendmsg(sockfd, &msg, 0);
+#endif
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent <= 0) {
+            return -1;
+        }
+        size_t n = (size_t)sent;
+        while (idx < 2 && n >= iov[idx].iov_len) {
+            n -= iov[idx].iov_len;
+            iov[idx++].iov_len = 0;
+        }
+        if (idx < 2) {
+            iov[idx].iov_base = (char *)iov[idx].iov_base + n;
+            iov[idx].iov_len -= n;
+        }
+    }
+#endif
+    return 0;
+}
+
+/* Helper: Send head and body over a plain socket (writev, or sendfile for files) */
+static int http1_send_plain(int sockfd, request_builder_t *builder,
+                            const httpmorph_request_t *request) {
+    size_t head_len;
+    const uint8_t *head = (const uint8_t *)request_builder_data(builder, &head_len);
+
+    if (!httpmorph_request_has_body(request)) {
+        return http1_send_gather(sockfd, head, head_len, NULL, 0);
+    }
+    if (!request->body_is_file) {
+        return http1_send_gather(sockfd, head, head_len, request->body, request->body_len);
+    }
+    if (http1_send_gather(sockfd, head, head_len, NULL, 0) != 0) {
+        return -1;
+    }
+    return httpmorph_send_file(sockfd, request->body_fd, request->body_file_offset, request->body_len);
+}
+
+/* Helper: Send head and body over TLS; the first record carries the head
+ * topped up with the start of the body, the rest goes out in full records */
+static int http1_send_tls(SSL *ssl, request_builder_t *builder,
+                          const httpmorph_request_t *request) {
+    size_t head_len;
+    request_builder_data(builder, &head_len);
+    size_t body_len = httpmorph_request_has_body(request) ? request->body_len : 0;
+    size_t fill = head_len < HTTP1_TLS_RECORD_SIZE ? HTTP1_TLS_RECORD_SIZE - head_len : 0;
+    if (fill > body_len) {
+        fill = body_len;
+    }
+
+    uint8_t *chunk = NULL;
+    if (request->body_is_file && body_len > 0) {
+        chunk = malloc(HTTP1_TLS_RECORD_SIZE);
+        if (!chunk) {
             return -1;
         }
+    }
+
+    int result = 0;
+    size_t done = 0;
+    if (fill > 0) {
+        if (chunk) {
+            int64_t got = httpmorph_file_read_at(request->body_fd, chunk, fill, request->body_file_offset);
+            result = (got == (int64_t)fill) ? request_builder_append(builder, (const char *)chunk, fill) : -1;
+        } else {
+            result = request_builder_append(builder, (const char *)request->body, fill);
+        }
+        done = fill;
+    }
+
+    if (result == 0) {
+        const uint8_t *first = (const uint8_t *)request_builder_data(builder, &head_len);
+        result = http1_ssl_write_all(ssl, first, head_len);
+    }
 
-        response->headers = new_headers;
-        response->header_capacity = new_capacity;
+    if (result == 0 && done < body_len) {
+        if (!chunk) {
+            result = http1_ssl_write_all(ssl, request->body + done, body_len - done);
+        }
+        while (chunk && result == 0 && done < body_len) {
+            size_t want = body_len - done < HTTP1_TLS_RECORD_SIZE ? body_len - done : HTTP1_TLS_RECORD_SIZE;
+            int64_t got = httpmorph_file_read_at(request->body_fd, chunk, want,
+                                                 request->body_file_offset + done);
+            if (got <= 0) {
+                result = -1;  /* Read error or file shorter than the body */
+                break;
+            }
+            result = http1_ssl_write_all(ssl, chunk, (size_t)got);
+            done += (size_t)got;
+        }
     }
 
-    /* Add header at current count index */
-    response->headers[response->header_count].key = strdup(key);
-    response->headers[response->header_count].value = strdup(value);
+    free(chunk);
+    return result;
+}
+
+/* Helper: Send head, then a body pulled from its source one record at a time */
+static int http1_send_streamed(SSL *ssl, int sockfd, request_builder_t *builder,
+                               const httpmorph_request_t *request) {
+    size_t head_len;
+    const uint8_t *head = (const uint8_t *)request_builder_data(builder, &head_len);
+    int result = ssl ? http1_ssl_write_all(ssl, head, head_len)
+                     : http1_send_gather(sockfd, head, head_len, NULL, 0);
+    if (result != 0) {
+        return -1;
+    }
 
-    if (!response->headers[response->header_count].key ||
-        !response->headers[response->header_count].value) {
-        free(response->headers[response->header_count].key);
-        free(response->headers[response->header_count].value);
+    uint8_t *chunk = malloc(HTTPMORPH_CHUNK_PREFIX + HTTP1_TLS_RECORD_SIZE + HTTPMORPH_CHUNK_SUFFIX);
+    if (!chunk) {
         return -1;
     }
 
-    response->header_count++;
-    return 0;
+    uint64_t sent = 0;
+    for (;;) {
+        /* Blocking sends are the backpressure; pausing is for async requests */
+        int64_t n = httpmorph_request_read_body(request, chunk + HTTPMORPH_CHUNK_PREFIX,
+                                                HTTP1_TLS_RECORD_SIZE, sent);
+        if (n < 0) {
+            result = -1;
+            break;
+        }
+        if (n == 0) {
+            break;
+        }
+        sent += (uint64_t)n;
+
+        const uint8_t *data = chunk + HTTPMORPH_CHUNK_PREFIX;
+        size_t len = (size_t)n;
+        if (request->body_chunked) {
+            size_t offset = httpmorph_request_frame_chunk(chunk, len);
+            data = chunk + offset;
+            len += HTTPMORPH_CHUNK_PREFIX - offset + HTTPMORPH_CHUNK_SUFFIX;
+        }
+        result = ssl ? http1_ssl_write_all(ssl, data, len)
+                     : http1_send_gather(sockfd, data, len, NULL, 0);
+        if (result != 0) {
+            break;
+        }
+    }
+
+    if (result == 0 && request->body_chunked) {
+        const uint8_t *last = (const uint8_t *)HTTPMORPH_CHUNK_LAST;
+        size_t last_len = sizeof(HTTPMORPH_CHUNK_LAST) - 1;
+        result = ssl ? http1_ssl_write_all(ssl, last, last_len)
+                     : http1_send_gather(sockfd, last, last_len, NULL, 0);
+    }
+
+    free(chunk);
+    return result;
 }
 
 /**
@@ -165,33 +641,16 @@ int httpmorph_send_http_request(SSL *ssl, int sockfd, const httpmorph_request_t
         request_builder_append_header(builder, "Host", 4, host, host_len);
     }
 
-    /* Check which headers are provided */
-    bool has_user_agent = false;
-    bool has_accept = false;
-    bool has_connection = false;
-    bool has_accept_encoding = false;
-
-    for (size_t i = 0; i < request->header_count; i++) {
-        if (strcasecmp(request->headers[i].key, "User-Agent") == 0) has_user_agent = true;
-        if (strcasecmp(request->headers[i].key, "Accept") == 0) has_accept = true;
-        if (strcasecmp(request->headers[i].key, "Connection") == 0) has_connection = true;
-        if (strcasecmp(request->headers[i].key, "Accept-Encoding") == 0) has_accept_encoding = true;
-    }
-
-    /* Add default headers if missing */
-    if (!has_user_agent) {
-        const char *user_agent = request->user_agent ? request->user_agent : HTTPMORPH_VERSION_STRING;
-        request_builder_append_header(builder, "User-Agent", 10, user_agent, strlen(user_agent));
-    }
-    if (!has_accept) {
-        request_builder_append_header(builder, "Accept", 6, "*/*", 3);
-    }
-    if (!has_accept_encoding) {
-        request_builder_append_header(builder, "Accept-Encoding", 15, "gzip, deflate", 13);
-    }
-    if (!has_connection) {
-        request_builder_append_header(builder, "Connection", 10, "keep-alive", 10);
+    /* Add default headers the request doesn't set (precomputed block) */
+    unsigned missing = header_template_missing_defaults(request->headers, request->header_count);
+    if ((missing & HEADER_TEMPLATE_USER_AGENT) && request->user_agent) {
+        request_builder_append_header(builder, "User-Agent", 10, request->user_agent,
+                                      strlen(request->user_agent));
+        missing &= ~HEADER_TEMPLATE_USER_AGENT;
     }
+    size_t defaults_len;
+    const char *defaults = header_template_defaults(missing, &defaults_len);
+    request_builder_append(builder, defaults, defaults_len);
 
     /* Add Proxy-Authorization header for HTTP proxy (not HTTPS/CONNECT) */
     if (use_proxy && !ssl && (proxy_user || proxy_pass)) {
@@ -218,8 +677,10 @@ int httpmorph_send_http_request(SSL *ssl, int sockfd, const httpmorph_request_t
                                       request->headers[i].value, strlen(request->headers[i].value));
     }
 
-    /* Content-Length if body present */
-    if (request->body && request->body_len > 0) {
+    /* Content-Length if body present (a source of unknown length is chunked) */
+    if (request->body_source && request->body_chunked) {
+        request_builder_append_str(builder, "Transfer-Encoding: chunked\r\n");
+    } else if (httpmorph_request_has_body(request)) {
         request_builder_append(builder, "Content-Length: ", 16);
         request_builder_append_uint(builder, request->body_len);
         request_builder_append_str(builder, "\r\n");
@@ -228,64 +689,14 @@ int httpmorph_send_http_request(SSL *ssl, int sockfd, const httpmorph_request_t
     /* End of headers */
     request_builder_append_str(builder, "\r\n");
 
-    /* Get built request */
-    size_t header_len;
-    const char *request_data = request_builder_data(builder, &header_len);
-
-    /* Send request headers */
-    size_t total_sent = 0;
-    int result = 0;
-
-    if (ssl) {
-        while (total_sent < header_len) {
-            int sent = SSL_write(ssl, request_data + total_sent, header_len - total_sent);
-            if (sent <= 0) {
-                result = -1;
-                goto cleanup;
-            }
-            total_sent += sent;
-        }
-
-        /* Send body if present */
-        if (request->body && request->body_len > 0) {
-            total_sent = 0;
-            while (total_sent < request->body_len) {
-                int sent = SSL_write(ssl, request->body + total_sent,
-                                   request->body_len - total_sent);
-                if (sent <= 0) {
-                    result = -1;
-                    goto cleanup;
-                }
-                total_sent += sent;
-            }
-        }
+    /* Head and body go out without copying the body into the builder */
+    int result;
+    if (request->body_source) {
+        result = http1_send_streamed(ssl, sockfd, builder, request);
     } else {
-        while (total_sent < header_len) {
-            ssize_t sent = send(sockfd, request_data + total_sent,
-                               header_len - total_sent, 0);
-            if (sent <= 0) {
-                result = -1;
-                goto cleanup;
-            }
-            total_sent += sent;
-        }
-
-        /* Send body if present */
-        if (request->body && request->body_len > 0) {
-            total_sent = 0;
-            while (total_sent < request->body_len) {
-                ssize_t sent = send(sockfd, request->body + total_sent,
-                                   request->body_len - total_sent, 0);
-                if (sent <= 0) {
-                    result = -1;
-                    goto cleanup;
-                }
-                total_sent += sent;
-            }
-        }
+        result = ssl ? http1_send_tls(ssl, builder, request)
+                     : http1_send_plain(sockfd, builder, request);
     }
-
-cleanup:
     request_builder_destroy(builder);
     return result;
 }
@@ -295,29 +706,54 @@ cleanup:
  */
 int httpmorph_recv_http_response(SSL *ssl, int sockfd, httpmorph_response_t *response,
                                   uint64_t *first_byte_time_us, bool *conn_will_close,
-                                  httpmorph_method_t method) {
-    char buffer[16384];
+                                  const httpmorph_request_t *request,
+                                  http1_readahead_t *readahead) {
     size_t buffer_pos = 0;
-    bool headers_complete = false;
     size_t content_length = 0;
-    bool is_head_request = (method == HTTPMORPH_HEAD);
+    bool is_head_request = (request->method == HTTPMORPH_HEAD);
     bool chunked = false;
     uint64_t first_byte_time = 0;
+    size_t max_header_size = request->max_header_size > 0 ?
+                             request->max_header_size : HTTPMORPH_DEFAULT_MAX_HEADER_SIZE;
+
+    /* The head is read straight into the (pooled) body buffer, which grows
+     * as needed; body bytes that arrive with it are already in place */
+    if (!response->body && !realloc_body_buffer(response, HTTP1_HEAD_INITIAL_SIZE, 0)) {
+        return HTTPMORPH_ERROR_MEMORY;
+    }
+
+    /* Headers are scanned incrementally as they arrive */
+    http1_header_span_t spans[HTTP1_MAX_HEADERS];
+    http1_parser_t parser;
+    http1_parser_init(&parser, spans, HTTP1_MAX_HEADERS);
+    int parse_rc = HTTP1_PARSE_INCOMPLETE;
 
     /* Read response headers - read in chunks, not byte by byte */
-    while (!headers_complete && buffer_pos < sizeof(buffer) - 1) {
-        int n;
-        size_t to_read = sizeof(buffer) - buffer_pos - 1;
-        if (to_read > 4096) to_read = 4096;
+    while (parse_rc == HTTP1_PARSE_INCOMPLETE) {
+        if (buffer_pos >= max_header_size) {
+            return HTTPMORPH_ERROR_PARSE;  /* Head larger than the cap */
+        }
+        if (response->body_capacity - buffer_pos < HTTP1_HEAD_READ_SIZE) {
+            size_t new_capacity = response->body_capacity * 2;
+            if (new_capacity < buffer_pos + HTTP1_HEAD_READ_SIZE) {
+                new_capacity = buffer_pos + HTTP1_HEAD_READ_SIZE;
+            }
+            if (!realloc_body_buffer(response, new_capacity, buffer_pos)) {
+                return HTTPMORPH_ERROR_MEMORY;
+            }
+        }
 
-        if (ssl) {
+        /* Small reads keep the body bytes read along with the head bounded */
+        char *buffer = (char *)response->body;
+        size_t to_read = response->body_capacity - buffer_pos;
+        if (to_read > HTTP1_HEAD_READ_SIZE) to_read = HTTP1_HEAD_READ_SIZE;
+
+        int n;
+        if (readahead && readahead->len > 0) {
+            n = (int)readahead_take(readahead, (uint8_t *)buffer + buffer_pos, to_read);
+        } else if (ssl) {
             n = SSL_read(ssl, buffer + buffer_pos, to_read);
             if (n <= 0) {
-                /* Check if we have any data and end of headers */
-                if (buffer_pos > 0 && strstr(buffer, "\r\n\r\n")) {
-                    headers_complete = true;
-                    break;
-                }
                 /* Check for SSL timeout/errors */
                 int ssl_err = SSL_get_error(ssl, n);
                 if (ssl_err == SSL_ERROR_WANT_READ || ssl_err == SSL_ERROR_WANT_WRITE) {
@@ -328,11 +764,6 @@ int httpmorph_recv_http_response(SSL *ssl, int sockfd, httpmorph_response_t *res
         } else {
             n = recv(sockfd, buffer + buffer_pos, to_read, 0);
             if (n <= 0) {
-                /* Check if we have any data and end of headers */
-                if (buffer_pos > 0 && strstr(buffer, "\r\n\r\n")) {
-                    headers_complete = true;
-                    break;
-                }
                 /* Check errno for timeout */
 #ifdef _WIN32
                 int err = WSAGetLastError();
@@ -351,269 +782,182 @@ int httpmorph_recv_http_response(SSL *ssl, int sockfd, httpmorph_response_t *res
         }
 
         buffer_pos += n;
-        buffer[buffer_pos] = '\0';
 
-        /* Check for end of headers */
-        if (strstr(buffer, "\r\n\r\n")) {
-            headers_complete = true;
+        /* Scans only the bytes just read */
+        parse_rc = http1_parser_feed(&parser, buffer, buffer_pos);
+        if (parse_rc == HTTP1_PARSE_COMPLETE && parser.headers_end > max_header_size) {
+            parse_rc = HTTP1_PARSE_ERROR;
         }
     }
 
     *first_byte_time_us = first_byte_time;
 
-    /* Parse headers */
-    char *headers_end = strstr(buffer, "\r\n\r\n");
-    if (!headers_end) {
-        return -1;
+    if (parse_rc != HTTP1_PARSE_COMPLETE) {
+        return HTTPMORPH_ERROR_PARSE;
     }
 
-    /* Save headers end position before modifying buffer */
-    char *body_start = headers_end + 4;  /* Point to body data after \r\n\r\n */
-    size_t body_in_buffer = buffer_pos - (body_start - buffer);
-
-    char *line_start = buffer;
-    char *line_end;
-    bool first_line = true;
+    char *buffer = (char *)response->body;
+    buffer[parser.status_line_len] = '\0';
+    if (httpmorph_parse_response_line(buffer, response) != 0) {
+        return HTTPMORPH_ERROR_PARSE;
+    }
 
-    /* Parse headers line by line up to headers_end */
-    while (line_start < headers_end && (line_end = strstr(line_start, "\r\n")) != NULL) {
-        *line_end = '\0';
+    for (size_t i = 0; i < parser.header_count; i++) {
+        const http1_header_span_t *span = &spans[i];
+        httpmorph_response_add_header_internal(response, buffer + span->name, span->name_len,
+                                               buffer + span->value, span->value_len);
+    }
 
-        if (first_line) {
-            if (httpmorph_parse_response_line(line_start, response) != 0) {
-                return -1;
-            }
-            first_line = false;
-        } else if (strlen(line_start) > 0) {
-            /* Parse header: key: value */
-            char *colon = strchr(line_start, ':');
-            if (colon) {
-                *colon = '\0';
-                char *key = line_start;
-                char *value = colon + 1;
-
-                /* Skip leading whitespace in value */
-                while (*value == ' ') value++;
-
-                add_response_header(response, key, value);
-
-                /* Check for Content-Length or Transfer-Encoding */
-                if (strcasecmp(key, "Content-Length") == 0) {
-                    content_length = strtoul(value, NULL, 10);
-                } else if (strcasecmp(key, "Transfer-Encoding") == 0 &&
-                          strstr(value, "chunked")) {
-                    chunked = true;
-                }
-            }
+    content_length = (size_t)parser.content_length;
+    chunked = parser.chunked;
+
+    /* HEAD answers, 204, 304 and an explicit zero length have no body */
+    bool no_body = is_head_request || response->status_code == 204 ||
+                   response->status_code == 304 ||
+                   (parser.has_content_length && content_length == 0 && !chunked);
+
+    /* Bytes past this response's end already belong to the next one */
+    size_t body_in_buffer = buffer_pos - parser.headers_end;
+    size_t body_max = no_body ? 0 : (parser.has_content_length && !chunked) ? content_length : SIZE_MAX;
+    if (body_in_buffer > body_max) {
+        if (!readahead_keep(readahead, buffer + parser.headers_end + body_max,
+                            body_in_buffer - body_max)) {
+            return HTTPMORPH_ERROR_MEMORY;
         }
-
-        line_start = line_end + 2;
+        body_in_buffer = body_max;
     }
 
-    /* Read response body */
-    size_t body_received = 0;
-
-    /* Copy any body data already in buffer */
-    if (body_in_buffer > 0) {
-        if (response->body_capacity < body_in_buffer) {
-            /* Use 2x growth strategy instead of exact size */
-            /* Check for integer overflow before doubling */
-            if (body_in_buffer > SIZE_MAX / 2) {
-                /* Would overflow - use what we have */
-                body_in_buffer = response->body_capacity;
-            } else {
-                size_t new_capacity = body_in_buffer * 2;
-                if (!realloc_body_buffer(response, new_capacity, 0)) {
-                    /* Allocation failed, but continue with existing buffer */
-                    body_in_buffer = response->body_capacity;
-                }
-            }
+    /* Body data that arrived with the headers. A plain buffered body keeps it
+     * in place (slid to the front of the body buffer); otherwise it is staged
+     * here, since decoding and streaming reuse the body buffer. */
+    bool body_in_place = !request->body_callback && !chunked &&
+                         !httpmorph_response_get_header(response, "Content-Encoding");
+    uint8_t early_body[HTTP1_HEAD_READ_SIZE];
+    const char *body_start = (const char *)early_body;
+    if (body_in_place) {
+        if (content_length > 0 && body_in_buffer > content_length) {
+            body_in_buffer = content_length;
         }
-        memcpy(response->body, body_start, body_in_buffer);
-        body_received = body_in_buffer;
+        memmove(buffer, buffer + parser.headers_end, body_in_buffer);
+    } else {
+        memcpy(early_body, buffer + parser.headers_end, body_in_buffer);
     }
 
+    /* Read response body (buffered, or streamed to the request's callback) */
+    body_sink_t sink;
+    body_sink_init(&sink, response, request);
+    body_sink_head(&sink);
+
     /* For HEAD requests, never read body even if Content-Length is present */
-    if (is_head_request) {
+    if (no_body) {
         response->body_len = 0;
         if (first_byte_time_us) {
             *first_byte_time_us = first_byte_time;
         }
         return 0;
     }
+    body_sink_decode_init(&sink);
 
-    /* Allocate body buffer and read based on Content-Length if known */
-    if (content_length > 0 && content_length < 100 * 1024 * 1024) {
+    /* Read based on Content-Length if known (huge bodies only when streaming) */
+    if (content_length > 0 && (sink.callback || content_length < 100 * 1024 * 1024)) {
         /* Known content length - pre-allocate exact size */
-        if (response->body_capacity < content_length) {
-            if (!realloc_body_buffer(response, content_length, body_received)) {
-                /* Allocation failed - will read what fits */
+        if (!sink.callback && response->body_capacity < content_length) {
+            if (!realloc_body_buffer(response, content_length, body_in_place ? body_in_buffer : 0)) {
+                /* Allocation failed - will grow as needed */
             }
         }
 
+        size_t body_received = body_in_buffer < content_length ? body_in_buffer : content_length;
+        if (body_in_place) {
+            body_sink_out_commit(&sink, body_received);
+        } else if (!body_sink_write(&sink, (const uint8_t*)body_start, body_received)) {
+            body_received = content_length;  /* Stop reading */
+        }
+
         while (body_received < content_length) {
-            int n;
-            if (ssl) {
-                n = SSL_read(ssl, response->body + body_received,
-                           content_length - body_received);
-            } else {
-                n = recv(sockfd, response->body + body_received,
-                        content_length - body_received, 0);
-            }
+            size_t avail = 0;
+            uint8_t *dst = body_sink_reserve(&sink, content_length - body_received, &avail);
+            if (!dst || avail == 0) break;
 
+            int n = http1_read(ssl, sockfd, readahead, dst, avail);
             if (n <= 0) break;
+            body_sink_commit(&sink, (size_t)n);
             body_received += n;
         }
     } else if (chunked) {
-        /* Chunked transfer encoding - parse chunk sizes and data */
-        /* Format: [size-hex]\r\n[data]\r\n ... 0\r\n\r\n */
-
-        char chunk_buffer[16384];
-        size_t chunk_buffer_pos = 0;
-
-        /* Copy any body data already in buffer to chunk buffer */
-        if (body_in_buffer > 0 && body_in_buffer < sizeof(chunk_buffer)) {
-            memcpy(chunk_buffer, body_start, body_in_buffer);
-            chunk_buffer_pos = body_in_buffer;
-            body_received = 0;  /* Reset, we'll parse chunks properly */
-        }
-
-        bool last_chunk = false;
-        while (!last_chunk) {
-            /* Read chunk size line */
-            char *chunk_size_end = NULL;
-
-            /* Read more data if we don't have a complete chunk size line */
-            while (!chunk_size_end && chunk_buffer_pos < sizeof(chunk_buffer) - 1) {
-                /* Look for \r\n marking end of chunk size */
-                chunk_buffer[chunk_buffer_pos] = '\0';
-                chunk_size_end = strstr(chunk_buffer, "\r\n");
-                if (chunk_size_end) break;
-
-                /* Read more data */
-                int n;
-                if (ssl) {
-                    n = SSL_read(ssl, chunk_buffer + chunk_buffer_pos,
-                               sizeof(chunk_buffer) - chunk_buffer_pos - 1);
-                } else {
-                    n = recv(sockfd, chunk_buffer + chunk_buffer_pos,
-                           sizeof(chunk_buffer) - chunk_buffer_pos - 1, 0);
-                }
-
-                if (n <= 0) {
-                    /* Connection closed or error - treat what we have as complete */
-                    last_chunk = true;
-                    break;
-                }
-                chunk_buffer_pos += n;
+        /* Framing is stripped in place, in whichever buffer each read went
+         * to (body, decoder input or streaming chunk) */
+        http1_chunked_t decoder;
+        http1_chunked_init(&decoder);
+        size_t len = body_in_buffer;
+        size_t rest = 0;
+        int rc = http1_chunked_decode(&decoder, (char *)early_body, &len, &rest);
+        bool kept = rc != HTTP1_CHUNKED_DONE ||
+                    readahead_keep(readahead, (const char *)early_body + len, rest);
+        bool writing = rc != HTTP1_CHUNKED_ERROR && body_sink_write(&sink, early_body, len);
+
+        while (writing && rc == HTTP1_CHUNKED_INCOMPLETE) {
+            size_t avail = 0;
+            uint8_t *dst = body_sink_reserve(&sink, 65536, &avail);
+            if (!dst || avail == 0) break;
+
+            int n = http1_read(ssl, sockfd, readahead, dst, avail);
+            if (n <= 0) break;  /* Truncated: what arrived is kept */
+            len = (size_t)n;
+            rc = http1_chunked_decode(&decoder, (char *)dst, &len, &rest);
+            if (rc == HTTP1_CHUNKED_ERROR) break;
+            /* Bytes past the last chunk are saved before the sink reuses dst */
+            if (rc == HTTP1_CHUNKED_DONE) {
+                kept = readahead_keep(readahead, (const char *)dst + len, rest);
             }
+            body_sink_commit(&sink, len);
+        }
 
-            if (last_chunk && !chunk_size_end) break;
-            if (!chunk_size_end) break;  /* Buffer full without finding size */
-
-            /* Parse chunk size (hex) */
-            size_t chunk_size = strtoul(chunk_buffer, NULL, 16);
-
-            /* Check for last chunk (size 0) */
-            if (chunk_size == 0) {
-                last_chunk = true;
-                /* Read trailing \r\n after 0\r\n */
-                break;
-            }
-
-            /* Move past chunk size line */
-            size_t chunk_size_line_len = (chunk_size_end - chunk_buffer) + 2;  /* Include \r\n */
-            size_t data_in_buffer = chunk_buffer_pos - chunk_size_line_len;
-            memmove(chunk_buffer, chunk_size_end + 2, data_in_buffer);
-            chunk_buffer_pos = data_in_buffer;
-
-            /* Read chunk data */
-            size_t chunk_received = 0;
-            while (chunk_received < chunk_size + 2) {  /* +2 for trailing \r\n */
-                /* Use data from chunk_buffer first */
-                if (chunk_buffer_pos > 0) {
-                    size_t to_copy = chunk_buffer_pos;
-                    if (chunk_received + to_copy > chunk_size + 2) {
-                        to_copy = chunk_size + 2 - chunk_received;
-                    }
-
-                    /* Only copy actual chunk data, not trailing \r\n */
-                    if (chunk_received < chunk_size) {
-                        size_t data_to_copy = to_copy;
-                        if (chunk_received + data_to_copy > chunk_size) {
-                            data_to_copy = chunk_size - chunk_received;
-                        }
-
-                        /* Ensure response body has enough space BEFORE copying */
-                        if (body_received + data_to_copy > response->body_capacity) {
-                            /* Check for integer overflow before doubling */
-                            size_t sum = body_received + data_to_copy;
-                            if (sum > SIZE_MAX / 2) {
-                                /* Would overflow - fail gracefully */
-                                last_chunk = true;
-                                break;
-                            }
-                            size_t new_capacity = sum * 2;
-                            if (!realloc_body_buffer(response, new_capacity, body_received)) {
-                                last_chunk = true;
-                                break;
-                            }
-                        }
-
-                        memcpy(response->body + body_received, chunk_buffer, data_to_copy);
-                        body_received += data_to_copy;
-                    }
-
-                    chunk_received += to_copy;
-                    memmove(chunk_buffer, chunk_buffer + to_copy, chunk_buffer_pos - to_copy);
-                    chunk_buffer_pos -= to_copy;
-                    continue;
-                }
-
-                /* Read more data */
-                int n;
-                if (ssl) {
-                    n = SSL_read(ssl, chunk_buffer, sizeof(chunk_buffer));
-                } else {
-                    n = recv(sockfd, chunk_buffer, sizeof(chunk_buffer), 0);
-                }
-
-                if (n <= 0) {
-                    last_chunk = true;
-                    break;
-                }
-                chunk_buffer_pos = n;
+        /* A connection is only reusable from the exact end of the body */
+        if ((rc != HTTP1_CHUNKED_DONE || !kept) && conn_will_close) {
+            *conn_will_close = true;
+        }
+        if (rc == HTTP1_CHUNKED_ERROR) {
+            response->error = HTTPMORPH_ERROR_PARSE;
+            if (!response->error_message) {
+                response->error_message = strdup("Malformed chunked response body");
             }
         }
     } else {
         /* No content length - read until EOF */
         if (conn_will_close) *conn_will_close = true;
-        while (body_received < response->body_capacity - 1024) {
-            int n;
-            if (ssl) {
-                n = SSL_read(ssl, response->body + body_received,
-                           response->body_capacity - body_received - 1);
-            } else {
-                n = recv(sockfd, response->body + body_received,
-                        response->body_capacity - body_received - 1, 0);
+        if (body_in_place) {
+            body_sink_out_commit(&sink, body_in_buffer);
+        }
+        if (body_in_place || body_sink_write(&sink, (const uint8_t*)body_start, body_in_buffer)) {
+            for (;;) {
+                size_t avail = 0;
+                uint8_t *dst = body_sink_reserve(&sink, 65536, &avail);
+                if (!dst || avail == 0) break;
+
+                int n = http1_read(ssl, sockfd, readahead, dst, avail);
+                if (n <= 0) break;
+                body_sink_commit(&sink, (size_t)n);
             }
+        }
+    }
 
-            if (n <= 0) break;
-            body_received += n;
+    body_sink_finish(&sink);
 
-            /* Expand buffer if needed */
-            if (body_received > response->body_capacity - 2048) {
-                /* Check for integer overflow before doubling */
-                if (response->body_capacity > SIZE_MAX / 2) {
-                    /* Would overflow - stop reading */
-                    break;
-                }
-                size_t new_capacity = response->body_capacity * 2;
-                if (!realloc_body_buffer(response, new_capacity, body_received)) break;
-            }
+    if (sink.decode_failed) {
+        /* Unread body data may remain - never reuse this connection */
+        if (conn_will_close) *conn_will_close = true;
+        response->error = HTTPMORPH_ERROR_PARSE;
+        if (!response->error_message) {
+            response->error_message = strdup("Failed to decode response body");
+        }
+    } else if (sink.aborted && sink.callback) {
+        /* Unread body data may remain - never reuse this connection */
+        if (conn_will_close) *conn_will_close = true;
+        response->error = HTTPMORPH_ERROR_ABORTED;
+        if (!response->error_message) {
+            response->error_message = strdup("Response body transfer aborted");
         }
     }
-
-    response->body_len = body_received;
     return 0;
 }
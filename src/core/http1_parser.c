@@ -0,0 +1,355 @@
+/**
+ * http1_parser.c - Incremental HTTP/1.x response head parser
+ */
+
+#include "http1_parser.h"
+#include <string.h>
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define HTTP1_SCAN_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    #include <arm_neon.h>
+    #define HTTP1_SCAN_NEON 1
+#endif
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+    static inline unsigned http1_ctz32(uint32_t v) {
+        unsigned long i;
+        _BitScanForward(&i, v);
+        return (unsigned)i;
+    }
+    static inline unsigned http1_ctz64(uint64_t v) {
+        unsigned long i;
+        _BitScanForward64(&i, v);
+        return (unsigned)i;
+    }
+#else
+    #define http1_ctz32(v) ((unsigned)__builtin_ctz(v))
+    #define http1_ctz64(v) ((unsigned)__builtin_ctzll(v))
+#endif
+
+/* === Line scanning === */
+
+const char* http1_scan_lf(const char *p, const char *end) {
+#if defined(__AVX2__)
+    const __m256i lf32 = _mm256_set1_epi8('\n');
+    while (end - p >= 32) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)p);
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, lf32));
+        if (mask) {
+            return p + http1_ctz32(mask);
+        }
+        p += 32;
+    }
+#endif
+#if defined(HTTP1_SCAN_SSE2)
+    const __m128i lf16 = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *)p);
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, lf16));
+        if (mask) {
+            return p + http1_ctz32(mask);
+        }
+        p += 16;
+    }
+#elif defined(HTTP1_SCAN_NEON)
+    const uint8x16_t lf16 = vdupq_n_u8('\n');
+    while (end - p >= 16) {
+        uint8x16_t eq = vceqq_u8(vld1q_u8((const uint8_t *)p), lf16);
+        /* Narrow to 4 bits per byte so the match position fits a 64-bit mask */
+        uint8x8_t nibbles = vshrn_n_u16(vreinterpretq_u16_u8(eq), 4);
+        uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(nibbles), 0);
+        if (mask) {
+            return p + (http1_ctz64(mask) >> 2);
+        }
+        p += 16;
+    }
+#endif
+    if (p >= end) {
+        return NULL;
+    }
+    return (const char *)memchr(p, '\n', (size_t)(end - p));
+}
+
+/* === Field helpers === */
+
+/* ASCII case-insensitive compare against a lowercase literal */
+static bool http1_ieq(const char *s, size_t len, const char *lit, size_t lit_len) {
+    if (len != lit_len) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        char c = s[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c + ('a' - 'A'));
+        if (c != lit[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Whether a Transfer-Encoding value lists "chunked" */
+static bool http1_has_chunked(const char *value, size_t len) {
+    for (size_t i = 0; i + 7 <= len; i++) {
+        if (http1_ieq(value + i, 7, "chunked", 7)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* "HTTP/x.y NNN reason" -> NNN */
+static int http1_parse_status(const char *line, size_t len) {
+    if (len < 12 || memcmp(line, "HTTP/", 5) != 0) {
+        return -1;
+    }
+    const char *sp = memchr(line, ' ', len);
+    if (!sp || (size_t)(sp - line) + 4 > len) {
+        return -1;
+    }
+    int code = 0;
+    for (int i = 1; i <= 3; i++) {
+        if (sp[i] < '0' || sp[i] > '9') {
+            return -1;
+        }
+        code = code * 10 + (sp[i] - '0');
+    }
+    return code;
+}
+
+/* Record one header line (without its line end) */
+static int http1_parser_header(http1_parser_t *parser, const char *buf,
+                               size_t start, size_t len) {
+    const char *line = buf + start;
+    const char *colon = memchr(line, ':', len);
+    if (!colon) {
+        return 0;  /* Not a field line (e.g. obsolete folding) - skipped */
+    }
+
+    size_t name_len = (size_t)(colon - line);
+    size_t value = name_len + 1;
+    size_t value_end = len;
+    while (value < value_end && (line[value] == ' ' || line[value] == '\t')) value++;
+    while (value_end > value && (line[value_end - 1] == ' ' || line[value_end - 1] == '\t')) value_end--;
+
+    if (http1_ieq(line, name_len, "content-length", 14)) {
+        uint64_t n = 0;
+        for (size_t i = value; i < value_end && line[i] >= '0' && line[i] <= '9'; i++) {
+            n = n * 10 + (uint64_t)(line[i] - '0');
+        }
+        parser->content_length = n;
+        parser->has_content_length = true;
+    } else if (http1_ieq(line, name_len, "transfer-encoding", 17) &&
+               http1_has_chunked(line + value, value_end - value)) {
+        parser->chunked = true;
+    }
+
+    if (parser->spans) {
+        if (parser->header_count >= parser->span_capacity) {
+            return -1;
+        }
+        http1_header_span_t *span = &parser->spans[parser->header_count];
+        span->name = (uint32_t)start;
+        span->name_len = (uint32_t)name_len;
+        span->value = (uint32_t)(start + value);
+        span->value_len = (uint32_t)(value_end - value);
+    }
+    parser->header_count++;
+    return 0;
+}
+
+/* === Parser === */
+
+void http1_parser_init(http1_parser_t *parser, http1_header_span_t *spans, size_t span_capacity) {
+    memset(parser, 0, sizeof(*parser));
+    parser->spans = spans;
+    parser->span_capacity = spans ? span_capacity : 0;
+    parser->status_code = -1;
+}
+
+int http1_parser_feed(http1_parser_t *parser, const char *buf, size_t len) {
+    if (parser->headers_end > 0) {
+        return HTTP1_PARSE_COMPLETE;
+    }
+    if (len > UINT32_MAX) {
+        return HTTP1_PARSE_ERROR;  /* Spans hold 32-bit offsets */
+    }
+
+    const char *end = buf + len;
+    const char *lf;
+    while (parser->scan_pos < len && (lf = http1_scan_lf(buf + parser->scan_pos, end)) != NULL) {
+        size_t start = parser->line_start;
+        size_t next = (size_t)(lf - buf) + 1;
+        size_t line_len = (size_t)(lf - buf) - start;
+        if (line_len > 0 && buf[start + line_len - 1] == '\r') {
+            line_len--;
+        }
+
+        parser->line_start = next;
+        parser->scan_pos = next;
+
+        if (!parser->status_seen) {
+            parser->status_seen = true;
+            parser->status_line_len = (uint32_t)line_len;
+            parser->status_code = http1_parse_status(buf, line_len);
+            if (parser->status_code < 0) {
+                return HTTP1_PARSE_ERROR;
+            }
+        } else if (line_len == 0) {
+            parser->headers_end = next;
+            return HTTP1_PARSE_COMPLETE;
+        } else if (http1_parser_header(parser, buf, start, line_len) != 0) {
+            return HTTP1_PARSE_ERROR;
+        }
+    }
+
+    /* The unfinished line keeps its start; the next call scans only new bytes */
+    parser->scan_pos = len;
+    return HTTP1_PARSE_INCOMPLETE;
+}
+
+/* === Chunked bodies === */
+
+/* Decoder states */
+enum {
+    HTTP1_CHUNK_SIZE = 0,       /* Hex digits of a size line */
+    HTTP1_CHUNK_EXT,            /* Rest of a size line (extensions, CR) */
+    HTTP1_CHUNK_DATA,           /* Payload */
+    HTTP1_CHUNK_DATA_END,       /* CRLF after the payload */
+    HTTP1_CHUNK_DATA_LF,        /* LF after the payload's CR */
+    HTTP1_CHUNK_TRAILER,        /* Start of a trailer line */
+    HTTP1_CHUNK_TRAILER_FIELD,  /* Rest of a trailer field line */
+    HTTP1_CHUNK_TRAILER_LF,     /* LF ending the blank line */
+    HTTP1_CHUNK_DONE
+};
+
+static int http1_hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+void http1_chunked_init(http1_chunked_t *decoder) {
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+int http1_chunked_decode(http1_chunked_t *decoder, char *buf, size_t *len, size_t *rest) {
+    size_t n = *len;
+    size_t in = 0;
+    size_t out = 0;
+
+    while (in < n && decoder->state != HTTP1_CHUNK_DONE) {
+        switch (decoder->state) {
+            case HTTP1_CHUNK_SIZE: {
+                int digit = http1_hex_digit(buf[in]);
+                if (digit < 0) {
+                    if (decoder->size_digits == 0) {
+                        return HTTP1_CHUNKED_ERROR;
+                    }
+                    decoder->state = HTTP1_CHUNK_EXT;
+                    break;
+                }
+                if (decoder->size_digits >= 16) {
+                    return HTTP1_CHUNKED_ERROR;  /* Larger than 64 bits */
+                }
+                decoder->remaining = (decoder->remaining << 4) | (uint64_t)digit;
+                decoder->size_digits++;
+                in++;
+                break;
+            }
+
+            case HTTP1_CHUNK_EXT: {
+                const char *lf = http1_scan_lf(buf + in, buf + n);
+                if (!lf) {
+                    in = n;
+                    break;
+                }
+                in = (size_t)(lf - buf) + 1;
+                decoder->size_digits = 0;
+                decoder->state = decoder->remaining > 0 ? HTTP1_CHUNK_DATA : HTTP1_CHUNK_TRAILER;
+                break;
+            }
+
+            case HTTP1_CHUNK_DATA: {
+                size_t take = n - in;
+                if ((uint64_t)take > decoder->remaining) {
+                    take = (size_t)decoder->remaining;
+                }
+                if (out != in) {
+                    memmove(buf + out, buf + in, take);
+                }
+                out += take;
+                in += take;
+                decoder->remaining -= take;
+                if (decoder->remaining == 0) {
+                    decoder->state = HTTP1_CHUNK_DATA_END;
+                }
+                break;
+            }
+
+            case HTTP1_CHUNK_DATA_END:
+            case HTTP1_CHUNK_DATA_LF: {
+                char c = buf[in++];
+                if (c == '\r' && decoder->state == HTTP1_CHUNK_DATA_END) {
+                    decoder->state = HTTP1_CHUNK_DATA_LF;
+                } else if (c == '\n') {
+                    decoder->state = HTTP1_CHUNK_SIZE;
+                } else {
+                    return HTTP1_CHUNKED_ERROR;
+                }
+                break;
+            }
+
+            case HTTP1_CHUNK_TRAILER: {
+                char c = buf[in];
+                if (c == '\r') {
+                    in++;
+                    decoder->state = HTTP1_CHUNK_TRAILER_LF;
+                } else if (c == '\n') {
+                    in++;
+                    decoder->state = HTTP1_CHUNK_DONE;
+                } else {
+                    decoder->state = HTTP1_CHUNK_TRAILER_FIELD;
+                }
+                break;
+            }
+
+            case HTTP1_CHUNK_TRAILER_FIELD: {
+                const char *lf = http1_scan_lf(buf + in, buf + n);
+                if (!lf) {
+                    in = n;
+                    break;
+                }
+                in = (size_t)(lf - buf) + 1;
+                decoder->state = HTTP1_CHUNK_TRAILER;
+                break;
+            }
+
+            case HTTP1_CHUNK_TRAILER_LF:
+                if (buf[in++] != '\n') {
+                    return HTTP1_CHUNKED_ERROR;
+                }
+                decoder->state = HTTP1_CHUNK_DONE;
+                break;
+
+            default:
+                return HTTP1_CHUNKED_ERROR;
+        }
+    }
+
+    *len = out;
+    if (decoder->state != HTTP1_CHUNK_DONE) {
+        return HTTP1_CHUNKED_INCOMPLETE;
+    }
+    *rest = n - in;
+    if (out != in) {
+        memmove(buf + out, buf + in, n - in);
+    }
+    return HTTP1_CHUNKED_DONE;
+}
@@ -0,0 +1,136 @@
+/**
+ * http1_parser.h - Incremental HTTP/1.x response head parser and chunked
+ * body decoder
+ *
+ * Feed the whole receive buffer after every read; each call scans only
+ * the bytes added since the previous one, so a head that arrives over
+ * many reads is still scanned once. Line ends are found with SSE2/AVX2
+ * (x86-64) or NEON (arm64) compares. Header names and values are
+ * recorded as offsets into the caller's buffer - nothing is copied.
+ *
+ * The chunked decoder works on each read's bytes where they were read
+ * to, sliding chunk payloads over the framing between them. It stops at
+ * any byte and resumes on the next call, so a size line split across
+ * reads needs no staging buffer.
+ */
+
+#ifndef HTTPMORPH_HTTP1_PARSER_H
+#define HTTPMORPH_HTTP1_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Span array size used by the parsers in http1.c and async_request.c */
+#define HTTP1_MAX_HEADERS 256
+
+/* http1_parser_feed() results */
+#define HTTP1_PARSE_COMPLETE 1     /* Blank line seen; headers_end is set */
+#define HTTP1_PARSE_INCOMPLETE 0   /* Need more data */
+#define HTTP1_PARSE_ERROR (-1)     /* Malformed head or too many headers */
+
+/**
+ * A header's location in the receive buffer
+ */
+typedef struct {
+    uint32_t name;          /* Offset of the field name */
+    uint32_t name_len;
+    uint32_t value;         /* Offset of the value (surrounding whitespace trimmed) */
+    uint32_t value_len;
+} http1_header_span_t;
+
+/**
+ * Parser state (a zeroed parser without spans is ready to use)
+ */
+typedef struct {
+    /* Scan position */
+    size_t line_start;              /* Start of the line being scanned */
+    size_t scan_pos;                /* Where the next line-end search resumes */
+    size_t headers_end;             /* Offset just past the blank line (0 until complete) */
+
+    /* Status line (always at offset 0) */
+    bool status_seen;
+    uint32_t status_line_len;       /* Excluding the line end */
+    int status_code;
+
+    /* Headers */
+    http1_header_span_t *spans;     /* Caller's array, NULL to skip recording */
+    size_t span_capacity;
+    size_t header_count;
+
+    /* Framing, picked up while scanning */
+    bool has_content_length;
+    uint64_t content_length;
+    bool chunked;
+} http1_parser_t;
+
+/**
+ * Reset a parser
+ *
+ * @param parser Parser to reset
+ * @param spans Array receiving header spans (NULL to only track framing)
+ * @param span_capacity Entries in spans
+ */
+void http1_parser_init(http1_parser_t *parser, http1_header_span_t *spans, size_t span_capacity);
+
+/**
+ * Scan newly received bytes
+ *
+ * @param parser Parser state
+ * @param buf Receive buffer (from offset 0; may have moved since the last call)
+ * @param len Bytes in buf
+ * @return HTTP1_PARSE_COMPLETE, HTTP1_PARSE_INCOMPLETE or HTTP1_PARSE_ERROR
+ */
+int http1_parser_feed(http1_parser_t *parser, const char *buf, size_t len);
+
+/* http1_chunked_decode() results */
+#define HTTP1_CHUNKED_DONE 1         /* Last chunk and trailer seen */
+#define HTTP1_CHUNKED_INCOMPLETE 0   /* Need more data */
+#define HTTP1_CHUNKED_ERROR (-1)     /* Malformed framing */
+
+/**
+ * Chunked decoder state (a zeroed decoder is ready to use)
+ */
+typedef struct {
+    uint8_t state;                  /* Position in the framing */
+    uint8_t size_digits;            /* Hex digits of the size line so far */
+    uint64_t remaining;             /* Chunk size, then payload bytes still to come */
+} http1_chunked_t;
+
+/**
+ * Reset a chunked decoder
+ */
+void http1_chunked_init(http1_chunked_t *decoder);
+
+/**
+ * Strip chunk framing from newly received bytes, in place
+ *
+ * Chunk extensions and trailer fields are skipped.
+ *
+ * @param decoder Decoder state
+ * @param buf Bytes received since the previous call
+ * @param len Input: bytes in buf; output: payload bytes now at the start of buf
+ * @param rest Output (HTTP1_CHUNKED_DONE only): bytes following the body,
+ *             moved to buf + *len
+ * @return HTTP1_CHUNKED_DONE, HTTP1_CHUNKED_INCOMPLETE or HTTP1_CHUNKED_ERROR
+ */
+int http1_chunked_decode(http1_chunked_t *decoder, char *buf, size_t *len, size_t *rest);
+
+/**
+ * Find the next line feed (vectorized memchr)
+ *
+ * @param p Start of the search
+ * @param end End of the search
+ * @return Pointer to the '\n', or NULL if there is none before end
+ */
+const char* http1_scan_lf(const char *p, const char *end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_HTTP1_PARSER_H */
@@ -8,8 +8,13 @@
 
 #include "internal/request.h"
 #include "internal/response.h"
+#include "internal/compression.h"
+#include "internal/util.h"
 #include "connection_pool.h"
+#include "buffer_pool.h"
 #include "http2_session_manager.h"
+#include "header_template.h"
+#include "trace.h"
 #include <stdlib.h>
 #include <string.h>
 
@@ -21,6 +26,19 @@
     #include <sys/socket.h>
 #endif
 
+/* Adaptive flow control: grow receive windows from PING-measured BDP */
+#define HTTP2_BDP_PING_OPAQUE ((const uint8_t *)"hmorphBD")  /* 8-byte PING payload */
+#define HTTP2_BDP_MAX_WINDOW (64u * 1024 * 1024)             /* Receive window ceiling */
+
+/* Bandwidth-delay estimate of a session (kept in the session user data) */
+typedef struct {
+    bool ping_outstanding;
+    uint64_t ping_sent_us;
+    size_t sample_bytes;      /* DATA received since the PING went out */
+    uint64_t rtt_us;          /* Smoothed PING round trip */
+    uint32_t window;          /* Raised receive window (0 = still the profile's) */
+} http2_bdp_t;
+
 /* Data structure for collecting HTTP/2 response */
 typedef struct {
     httpmorph_response_t *response;
@@ -29,16 +47,43 @@ typedef struct {
     size_t data_len;
     bool headers_complete;
     bool stream_closed;
+    bool stream_reset;        /* Closed before the response completed */
     SSL *ssl;                 /* SSL connection for send/recv */
 
     /* Request body fields */
     const uint8_t *req_body;  /* Request body to send */
     size_t req_body_len;      /* Total length of request body */
     size_t req_body_sent;     /* Bytes already sent */
+    bool req_body_is_file;    /* Body is read from req_body_fd instead */
+    int req_body_fd;
+    uint64_t req_body_offset; /* File offset of the first body byte */
+    const httpmorph_request_t *req_source;  /* Body pulled from its body_source */
 
     /* Session manager for concurrent multiplexing */
     void *session_manager;    /* http2_session_manager_t* (void* to avoid circular dependency) */
     int32_t stream_id;        /* Stream ID for this request */
+    struct pooled_connection *conn;  /* Pooled connection (session user data only) */
+
+    /* Streaming body (data_buf holds at most one chunk) */
+    httpmorph_body_callback_t body_callback;
+    void *body_userdata;
+    bool head_delivered;
+    bool body_aborted;
+
+    /* Content-Encoding decoding (set up on the first DATA frame) */
+    httpmorph_decoder_t *decoder;
+    bool decoder_checked;
+    bool decode_failed;
+    size_t encoded_len;
+    size_t wire_len;          /* DATA bytes received, before decoding */
+    nghttp2_session *decode_session;  /* Session of the DATA frame being decoded */
+
+    /* Adaptive flow control (opt-in per request) */
+    bool adaptive_window;
+    uint32_t stream_window;   /* Window this stream was raised to */
+    uint64_t flow_rtt_us;     /* Reported in the response */
+    uint32_t flow_window;
+    http2_bdp_t bdp;          /* Session-level estimate (session user data only) */
 } http2_stream_data_t;
 
 /* Helper: Send data over SSL or socket */
@@ -46,21 +91,57 @@ static ssize_t http2_send_callback(nghttp2_session *session, const uint8_t *data
                                     size_t length, int flags, void *user_data) {
     http2_stream_data_t *stream_data = (http2_stream_data_t *)user_data;
     if (stream_data && stream_data->ssl) {
-        return SSL_write(stream_data->ssl, data, length);
+        int n = SSL_write(stream_data->ssl, data, length);
+        if (n <= 0) {
+            /* Non-blocking socket (reactor-driven session): retry when writable */
+            int ssl_err = SSL_get_error(stream_data->ssl, n);
+            if (ssl_err == SSL_ERROR_WANT_WRITE || ssl_err == SSL_ERROR_WANT_READ) {
+                return NGHTTP2_ERR_WOULDBLOCK;
+            }
+            return NGHTTP2_ERR_CALLBACK_FAILURE;
+        }
+        return n;
     }
-    return -1;
+    return NGHTTP2_ERR_CALLBACK_FAILURE;
 }
 
 /* Helper: Data provider callback for sending request body */
 static ssize_t http2_data_source_read_callback(nghttp2_session *session, int32_t stream_id,
                                                  uint8_t *buf, size_t length, uint32_t *data_flags,
                                                  nghttp2_data_source *source, void *user_data) {
-    http2_stream_data_t *stream_data = (http2_stream_data_t *)user_data;
+    /* The stream's own data; the session user data is shared by all streams */
+    http2_stream_data_t *stream_data = (http2_stream_data_t *)source->ptr;
+    if (!stream_data) {
+        stream_data = (http2_stream_data_t *)user_data;
+    }
+
+    /* Streamed body: nghttp2 only asks while the flow-control window is open */
+    if (stream_data->req_source) {
+        int64_t got = httpmorph_request_read_body(stream_data->req_source, buf, length,
+                                                  stream_data->req_body_sent);
+        if (got < 0) {
+            return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;  /* Pausing needs an event loop */
+        }
+        if (got == 0) {
+            *data_flags |= NGHTTP2_DATA_FLAG_EOF;
+        }
+        stream_data->req_body_sent += (size_t)got;
+        return (ssize_t)got;
+    }
 
     size_t remaining = stream_data->req_body_len - stream_data->req_body_sent;
     size_t to_send = remaining < length ? remaining : length;
 
-    if (to_send > 0) {
+    if (to_send > 0 && stream_data->req_body_is_file) {
+        /* Read straight into the frame buffer */
+        int64_t got = httpmorph_file_read_at(stream_data->req_body_fd, buf, to_send,
+                                             stream_data->req_body_offset + stream_data->req_body_sent);
+        if (got <= 0) {
+            return NGHTTP2_ERR_TEMPORAL_CALLBACK_FAILURE;
+        }
+        to_send = (size_t)got;
+        stream_data->req_body_sent += to_send;
+    } else if (to_send > 0) {
         memcpy(buf, stream_data->req_body + stream_data->req_body_sent, to_send);
         stream_data->req_body_sent += to_send;
     }
@@ -111,6 +192,11 @@ static int http2_on_header_callback(nghttp2_session *session,
         return NGHTTP2_ERR_CALLBACK_FAILURE;
     }
 
+    /* Session-level data has no response: the stream was abandoned */
+    if (!stream_data->response) {
+        return 0;
+    }
+
     if (frame->hd.type != NGHTTP2_HEADERS || frame->headers.cat != NGHTTP2_HCAT_RESPONSE) {
         return 0;
     }
@@ -130,19 +216,68 @@ static int http2_on_header_callback(nghttp2_session *session,
     return 0;
 }
 
-/* Helper: Called when DATA frame is received */
-static int http2_on_data_chunk_recv_callback(nghttp2_session *session, uint8_t flags,
-                                               int32_t stream_id, const uint8_t *data,
-                                               size_t len, void *user_data) {
-    /* For session reuse: try to get stream user data first, fallback to session user data */
-    http2_stream_data_t *stream_data = (http2_stream_data_t *)nghttp2_session_get_stream_user_data(session, stream_id);
-    if (!stream_data) {
-        stream_data = (http2_stream_data_t *)user_data;
+/* Helper: Stop a streamed transfer the body callback rejected */
+static void http2_stream_abort(nghttp2_session *session, int32_t stream_id,
+                               http2_stream_data_t *stream_data) {
+    stream_data->body_aborted = true;
+    stream_data->data_len = 0;
+    if (stream_data->stream_closed || !session) {
+        return;  /* Stream already ended */
     }
+    nghttp2_submit_rst_stream(session, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_CANCEL);
 
-    /* Safety check: if stream_data is still NULL, reject callback */
-    if (!stream_data) {
-        return NGHTTP2_ERR_CALLBACK_FAILURE;
+    /* No END_STREAM will follow - release the waiter now */
+    stream_data->stream_closed = true;
+    if (stream_data->session_manager) {
+        http2_session_manager_mark_stream_complete(
+            (http2_session_manager_t*)stream_data->session_manager, stream_id, false);
+    }
+}
+
+/* Helper: Tell the body callback that status and headers are available */
+static void http2_stream_head(nghttp2_session *session, int32_t stream_id,
+                              http2_stream_data_t *stream_data) {
+    if (!stream_data->body_callback || stream_data->head_delivered) {
+        return;
+    }
+    stream_data->head_delivered = true;
+    if (stream_data->body_callback(stream_data->response, NULL, 0, stream_data->body_userdata) < 0) {
+        http2_stream_abort(session, stream_id, stream_data);
+    }
+}
+
+/* Helper: Pass streamed DATA to the body callback in chunk-sized pieces */
+static void http2_stream_body(nghttp2_session *session, int32_t stream_id,
+                              http2_stream_data_t *stream_data,
+                              const uint8_t *data, size_t len) {
+    http2_stream_head(session, stream_id, stream_data);
+
+    while (len > 0 && !stream_data->body_aborted) {
+        size_t space = stream_data->data_capacity - stream_data->data_len;
+        size_t n = len < space ? len : space;
+        memcpy(stream_data->data_buf + stream_data->data_len, data, n);
+        stream_data->data_len += n;
+        data += n;
+        len -= n;
+
+        if (stream_data->data_len == stream_data->data_capacity) {
+            if (stream_data->body_callback(stream_data->response, stream_data->data_buf,
+                                           stream_data->data_len, stream_data->body_userdata) < 0) {
+                http2_stream_abort(session, stream_id, stream_data);
+                return;
+            }
+            stream_data->data_len = 0;
+        }
+    }
+}
+
+/* Helper: Add (decoded) body bytes - streamed, or appended to data_buf */
+static int http2_stream_append(nghttp2_session *session, int32_t stream_id,
+                               http2_stream_data_t *stream_data,
+                               const uint8_t *data, size_t len) {
+    if (stream_data->body_callback) {
+        http2_stream_body(session, stream_id, stream_data, data, len);
+        return 0;
     }
 
     /* Expand buffer if needed */
@@ -168,9 +303,208 @@ static int http2_on_data_chunk_recv_callback(nghttp2_session *session, uint8_t f
     return 0;
 }
 
+/* Helper: Decoder output callback */
+static int http2_stream_decoded(void *ctx, const uint8_t *data, size_t len) {
+    http2_stream_data_t *stream_data = (http2_stream_data_t *)ctx;
+    if (http2_stream_append(stream_data->decode_session, stream_data->stream_id,
+                            stream_data, data, len) != 0 || stream_data->body_aborted) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Helper: Feed DATA through the Content-Encoding decoder */
+static int http2_stream_decode(nghttp2_session *session, int32_t stream_id,
+                               http2_stream_data_t *stream_data,
+                               const uint8_t *data, size_t len) {
+    bool first = stream_data->encoded_len == 0;
+    stream_data->encoded_len += len;
+    stream_data->stream_id = stream_id;
+    stream_data->decode_session = session;
+
+    if (httpmorph_decoder_write(stream_data->decoder, data, len,
+                                http2_stream_decoded, stream_data) == 0 ||
+        stream_data->body_aborted) {
+        return 0;
+    }
+
+    httpmorph_decoder_destroy(stream_data->decoder);
+    stream_data->decoder = NULL;
+    if (first && stream_data->data_len == 0) {
+        /* Mislabeled body: nothing decoded yet, so keep it as received */
+        return http2_stream_append(session, stream_id, stream_data, data, len);
+    }
+
+    stream_data->decode_failed = true;
+    http2_stream_abort(session, stream_id, stream_data);
+    return 0;
+}
+
+/* Helper: Flush the last streamed chunk once the stream has ended */
+static void http2_stream_finish(http2_stream_data_t *stream_data, httpmorph_response_t *response) {
+    response->http2_rtt_us = stream_data->flow_rtt_us;
+    response->http2_window_size = stream_data->flow_window;
+    response->body_wire_len = stream_data->wire_len;
+
+    if (stream_data->decoder) {
+        /* A truncated stream keeps what decoded, as truncated plain bodies do */
+        stream_data->decode_session = NULL;
+        if (!stream_data->body_aborted && stream_data->encoded_len > 0) {
+            httpmorph_decoder_finish(stream_data->decoder, http2_stream_decoded, stream_data);
+        }
+        httpmorph_decoder_destroy(stream_data->decoder);
+        stream_data->decoder = NULL;
+    }
+
+    if (stream_data->decode_failed) {
+        stream_data->data_len = 0;
+        response->error = HTTPMORPH_ERROR_PARSE;
+        if (!response->error_message) {
+            response->error_message = strdup("Failed to decode response body");
+        }
+        return;
+    }
+
+    if (!stream_data->body_callback) {
+        return;
+    }
+
+    if (!stream_data->body_aborted) {
+        if (!stream_data->head_delivered) {
+            stream_data->head_delivered = true;
+            if (stream_data->body_callback(response, NULL, 0, stream_data->body_userdata) < 0) {
+                stream_data->body_aborted = true;
+            }
+        }
+        if (!stream_data->body_aborted && stream_data->data_len > 0 &&
+            stream_data->body_callback(response, stream_data->data_buf,
+                                       stream_data->data_len, stream_data->body_userdata) < 0) {
+            stream_data->body_aborted = true;
+        }
+    }
+    stream_data->data_len = 0;  /* Nothing is kept in response->body */
+
+    if (stream_data->body_aborted) {
+        response->error = HTTPMORPH_ERROR_ABORTED;
+        if (!response->error_message) {
+            response->error_message = strdup("Response body transfer aborted");
+        }
+    }
+}
+
+/* Helper: Called when DATA frame is received */
+/* Helper: Sample the BDP with a PING and open the stream as wide as the connection */
+static void http2_bdp_on_data(nghttp2_session *session, int32_t stream_id,
+                              http2_stream_data_t *stream_data, http2_bdp_t *bdp, size_t len) {
+    if (bdp->ping_outstanding) {
+        bdp->sample_bytes += len;
+    } else if (nghttp2_submit_ping(session, NGHTTP2_FLAG_NONE, HTTP2_BDP_PING_OPAQUE) == 0) {
+        bdp->ping_outstanding = true;
+        bdp->ping_sent_us = httpmorph_get_time_us();
+        bdp->sample_bytes = 0;
+    }
+
+    if (bdp->window > stream_data->stream_window &&
+        nghttp2_session_set_local_window_size(session, NGHTTP2_FLAG_NONE, stream_id,
+                                              (int32_t)bdp->window) == 0) {
+        stream_data->stream_window = bdp->window;
+    }
+
+    stream_data->flow_rtt_us = bdp->rtt_us;
+    stream_data->flow_window = bdp->window ? bdp->window :
+        (uint32_t)nghttp2_session_get_effective_local_window_size(session);
+}
+
+/* Helper: PING ACK - if the peer filled most of the window in one round trip, double it */
+static void http2_bdp_on_ping_ack(nghttp2_session *session, http2_bdp_t *bdp) {
+    if (!bdp->ping_outstanding) {
+        return;
+    }
+    bdp->ping_outstanding = false;
+
+    uint64_t rtt = httpmorph_get_time_us() - bdp->ping_sent_us;
+    bdp->rtt_us = bdp->rtt_us ? (bdp->rtt_us * 7 + rtt) / 8 : rtt;
+
+    uint64_t window = bdp->window ? bdp->window :
+        (uint64_t)nghttp2_session_get_effective_local_window_size(session);
+    if (window >= HTTP2_BDP_MAX_WINDOW || (uint64_t)bdp->sample_bytes * 3 < window * 2) {
+        return;  /* Not window-limited */
+    }
+
+    uint64_t target = (uint64_t)bdp->sample_bytes * 2;
+    if (target < window * 2) target = window * 2;
+    if (target > HTTP2_BDP_MAX_WINDOW) target = HTTP2_BDP_MAX_WINDOW;
+
+    /* Sends a connection WINDOW_UPDATE; SETTINGS stay as the profile sent them */
+    if (nghttp2_session_set_local_window_size(session, NGHTTP2_FLAG_NONE, 0, (int32_t)target) == 0) {
+        bdp->window = (uint32_t)target;
+    }
+}
+
+static int http2_on_data_chunk_recv_callback(nghttp2_session *session, uint8_t flags,
+                                               int32_t stream_id, const uint8_t *data,
+                                               size_t len, void *user_data) {
+    /* For session reuse: try to get stream user data first, fallback to session user data */
+    http2_stream_data_t *stream_data = (http2_stream_data_t *)nghttp2_session_get_stream_user_data(session, stream_id);
+    if (!stream_data) {
+        stream_data = (http2_stream_data_t *)user_data;
+    }
+
+    /* Safety check: if stream_data is still NULL, reject callback */
+    if (!stream_data) {
+        return NGHTTP2_ERR_CALLBACK_FAILURE;
+    }
+
+    if (stream_data->body_aborted || !stream_data->response) {
+        return 0;  /* Stream was reset - drop anything still in flight */
+    }
+
+    stream_data->wire_len += len;
+    if (stream_data->adaptive_window && user_data) {
+        http2_bdp_on_data(session, stream_id, stream_data, &((http2_stream_data_t *)user_data)->bdp, len);
+    }
+
+    /* Headers are complete by the first DATA frame */
+    if (!stream_data->decoder_checked) {
+        stream_data->decoder_checked = true;
+        stream_data->decoder = httpmorph_decoder_create(
+            httpmorph_response_get_header(stream_data->response, "Content-Encoding"),
+            (httpmorph_buffer_pool_t*)stream_data->response->_buffer_pool);
+    }
+    if (stream_data->decoder) {
+        return http2_stream_decode(session, stream_id, stream_data, data, len);
+    }
+
+    return http2_stream_append(session, stream_id, stream_data, data, len);
+}
+
 /* Helper: Called when a frame is received */
 static int http2_on_frame_recv_callback(nghttp2_session *session,
                                          const nghttp2_frame *frame, void *user_data) {
+    /* ORIGIN (RFC 8336): other origins this connection is authoritative for */
+    if (frame->hd.type == NGHTTP2_ORIGIN) {
+        http2_stream_data_t *conn_data = (http2_stream_data_t *)user_data;
+        const nghttp2_ext_origin *origin = (const nghttp2_ext_origin *)frame->ext.payload;
+        if (conn_data && conn_data->conn && origin) {
+            /* An empty frame still defines the origin set */
+            pool_connection_add_origin(conn_data->conn, "", 0);
+            for (size_t i = 0; i < origin->nov; i++) {
+                pool_connection_add_origin(conn_data->conn, (const char *)origin->ov[i].origin,
+                                           origin->ov[i].origin_len);
+            }
+        }
+        return 0;
+    }
+
+    /* Round trip for the adaptive window estimate */
+    if (frame->hd.type == NGHTTP2_PING && (frame->hd.flags & NGHTTP2_FLAG_ACK) &&
+        memcmp(frame->ping.opaque_data, HTTP2_BDP_PING_OPAQUE, 8) == 0) {
+        if (user_data) {
+            http2_bdp_on_ping_ack(session, &((http2_stream_data_t *)user_data)->bdp);
+        }
+        return 0;
+    }
+
     /* For session reuse: try to get stream user data first, fallback to session user data */
     http2_stream_data_t *stream_data = NULL;
     if (frame->hd.stream_id > 0) {
@@ -179,10 +513,14 @@ static int http2_on_frame_recv_callback(nghttp2_session *session,
     if (!stream_data) {
         stream_data = (http2_stream_data_t *)user_data;
     }
+    if (!stream_data || !stream_data->response) {
+        return 0;  /* Connection-level frame, or an abandoned stream */
+    }
 
     if (frame->hd.type == NGHTTP2_HEADERS &&
         frame->headers.cat == NGHTTP2_HCAT_RESPONSE) {
         stream_data->headers_complete = true;
+        http2_stream_head(session, frame->hd.stream_id, stream_data);
     }
 
     /* Check if stream is closed - only check END_STREAM on HEADERS or DATA frames */
@@ -200,6 +538,49 @@ static int http2_on_frame_recv_callback(nghttp2_session *session,
     return 0;
 }
 
+/* Helper: Called when a stream closes (END_STREAM, RST_STREAM or GOAWAY) */
+static int http2_on_stream_close_callback(nghttp2_session *session, int32_t stream_id,
+                                          uint32_t error_code, void *user_data) {
+    (void)user_data;
+    HTTPMORPH_PROBE2(h2__stream__close, stream_id, error_code);
+    http2_stream_data_t *stream_data =
+        (http2_stream_data_t *)nghttp2_session_get_stream_user_data(session, stream_id);
+    if (!stream_data || stream_data->stream_closed) {
+        return 0;
+    }
+
+    /* Closed without END_STREAM from the peer: release the waiter with an error */
+    stream_data->stream_closed = true;
+    stream_data->stream_reset = error_code != NGHTTP2_NO_ERROR || !stream_data->headers_complete;
+    if (stream_data->session_manager) {
+        http2_session_manager_mark_stream_complete(
+            (http2_session_manager_t*)stream_data->session_manager, stream_id,
+            stream_data->stream_reset);
+    }
+    return 0;
+}
+
+/* Helper: Hand a malloc'd body buffer to the response, releasing the
+ * pooled buffer it was created with */
+static void http2_adopt_body(httpmorph_response_t *response, uint8_t *data,
+                             size_t len, size_t capacity) {
+    if (response->body) {
+        if (response->_buffer_pool) {
+            buffer_pool_put((httpmorph_buffer_pool_t*)response->_buffer_pool,
+                          response->body, response->_body_actual_size);
+        } else {
+            free(response->body);
+        }
+    }
+
+    /* Body is no longer pool-owned */
+    response->_buffer_pool = NULL;
+    response->body = data;
+    response->body_len = len;
+    response->body_capacity = capacity;
+    response->_body_actual_size = capacity;
+}
+
 /* Helper: Initialize or reuse HTTP/2 session with stream-specific data */
 static int http2_init_or_reuse_session(nghttp2_session **session_ptr,
                                         nghttp2_session_callbacks *callbacks,
@@ -209,7 +590,15 @@ static int http2_init_or_reuse_session(nghttp2_session **session_ptr,
 
     /* If session doesn't exist, create a new one */
     if (*session_ptr == NULL) {
-        int rv = nghttp2_session_client_new(session_ptr, callbacks, stream_data);
+        /* Receive ORIGIN frames (used for connection coalescing) */
+        nghttp2_option *option;
+        if (nghttp2_option_new(&option) != 0) {
+            return -1;
+        }
+        nghttp2_option_set_builtin_recv_extension_type(option, NGHTTP2_ORIGIN);
+
+        int rv = nghttp2_session_client_new2(session_ptr, callbacks, stream_data, option);
+        nghttp2_option_del(option);
         if (rv != 0) {
             return -1;
         }
@@ -264,14 +653,23 @@ int httpmorph_http2_request(SSL *ssl, const httpmorph_request_t *request,
 
     stream_data.response = response;
     stream_data.ssl = ssl;
-    stream_data.data_capacity = 16384;
+    stream_data.data_capacity = request->body_callback ? request->body_chunk_size : 16384;
+    if (stream_data.data_capacity == 0) stream_data.data_capacity = HTTPMORPH_DEFAULT_BODY_CHUNK_SIZE;
     stream_data.data_buf = malloc(stream_data.data_capacity);
     if (!stream_data.data_buf) return -1;
 
+    stream_data.body_callback = request->body_callback;
+    stream_data.body_userdata = request->body_callback_userdata;
+    stream_data.adaptive_window = request->http2_adaptive_window;
+
     /* Set up request body if present */
     stream_data.req_body = (const uint8_t *)request->body;
     stream_data.req_body_len = request->body_len;
     stream_data.req_body_sent = 0;
+    stream_data.req_body_is_file = request->body_is_file;
+    stream_data.req_body_fd = request->body_fd;
+    stream_data.req_body_offset = request->body_file_offset;
+    stream_data.req_source = request->body_source ? request : NULL;
 
     /* Initialize nghttp2 callbacks */
     nghttp2_session_callbacks_new(&callbacks);
@@ -280,6 +678,7 @@ int httpmorph_http2_request(SSL *ssl, const httpmorph_request_t *request,
     nghttp2_session_callbacks_set_on_header_callback(callbacks, http2_on_header_callback);
     nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, http2_on_data_chunk_recv_callback);
     nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, http2_on_frame_recv_callback);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, http2_on_stream_close_callback);
 
     /* Create HTTP/2 client session (pass &stream_data as user_data) */
     rv = nghttp2_session_client_new(&session, callbacks, &stream_data);
@@ -325,11 +724,7 @@ int httpmorph_http2_request(SSL *ssl, const httpmorph_request_t *request,
     int nhdrs = 0;
 
     /* Add pseudo-headers first */
-    const char *method_str = httpmorph_method_to_string(request->method);
-    hdrs[nhdrs++] = (nghttp2_nv){(uint8_t *)":method", (uint8_t *)method_str, 7, strlen(method_str), NGHTTP2_NV_FLAG_NONE};
-    hdrs[nhdrs++] = (nghttp2_nv){(uint8_t *)":path", (uint8_t *)path, 5, strlen(path), NGHTTP2_NV_FLAG_NONE};
-    hdrs[nhdrs++] = (nghttp2_nv){(uint8_t *)":scheme", (uint8_t *)"https", 7, 5, NGHTTP2_NV_FLAG_NONE};
-    hdrs[nhdrs++] = (nghttp2_nv){(uint8_t *)":authority", (uint8_t *)host, 10, strlen(host), NGHTTP2_NV_FLAG_NONE};
+    nhdrs += header_template_h2_prefix(hdrs, request->method, path, host);
 
     /* Add custom headers */
     for (size_t i = 0; i < request->header_count && nhdrs < 60; i++) {
@@ -349,7 +744,7 @@ int httpmorph_http2_request(SSL *ssl, const httpmorph_request_t *request,
     nghttp2_data_provider data_prd;
     nghttp2_data_provider *data_prd_ptr = NULL;
 
-    if (stream_data.req_body_len > 0) {
+    if (httpmorph_request_has_body(request)) {
         data_prd.source.ptr = NULL;
         data_prd.read_callback = http2_data_source_read_callback;
         data_prd_ptr = &data_prd;
@@ -375,6 +770,7 @@ int httpmorph_http2_request(SSL *ssl, const httpmorph_request_t *request,
         free(stream_data.data_buf);
         return -1;
     }
+    HTTPMORPH_PROBE1(h2__stream__open, stream_id);
 
     /* Send request */
     nghttp2_session_send(session);
@@ -443,25 +839,76 @@ int httpmorph_http2_request(SSL *ssl, const httpmorph_request_t *request,
     /* Check for errors */
     if (rv != 0) {
         nghttp2_session_del(session);
+        httpmorph_decoder_destroy(stream_data.decoder);
         free(stream_data.data_buf);
         return -1;
     }
 
     /* Copy data to response */
+    http2_stream_finish(&stream_data, response);
     if (stream_data.data_len > 0) {
-        response->body = stream_data.data_buf;
-        response->body_len = stream_data.data_len;
-        response->body_capacity = stream_data.data_capacity;
+        http2_adopt_body(response, stream_data.data_buf,
+                         stream_data.data_len, stream_data.data_capacity);
     } else {
         free(stream_data.data_buf);
-        response->body = NULL;
-        response->body_len = 0;
+        http2_adopt_body(response, NULL, 0, 0);
     }
 
     nghttp2_session_del(session);
     return 0;
 }
 
+/* Helper: Give a pooled connection its session and send the preface */
+static int http2_pooled_session_create(struct pooled_connection *conn,
+                                       http2_stream_data_t *stream_data) {
+    nghttp2_session *session = NULL;
+    nghttp2_session_callbacks *callbacks;
+    bool session_created = false;
+
+    /* Initialize nghttp2 callbacks */
+    if (nghttp2_session_callbacks_new(&callbacks) != 0) {
+        return -1;
+    }
+    nghttp2_session_callbacks_set_send_callback(callbacks, http2_send_callback);
+    nghttp2_session_callbacks_set_recv_callback(callbacks, http2_recv_callback);
+    nghttp2_session_callbacks_set_on_header_callback(callbacks, http2_on_header_callback);
+    nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, http2_on_data_chunk_recv_callback);
+    nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, http2_on_frame_recv_callback);
+    nghttp2_session_callbacks_set_on_stream_close_callback(callbacks, http2_on_stream_close_callback);
+
+    /* Create session and send preface */
+    int rv = http2_init_or_reuse_session(&session, callbacks, stream_data, conn->ssl, &session_created);
+    nghttp2_session_callbacks_del(callbacks);
+    if (rv != 0) {
+        return -1;
+    }
+
+    /* Store session in connection for reuse */
+    conn->http2_session = session;
+    conn->preface_sent = true;
+    return 0;
+}
+
+/**
+ * Open the HTTP/2 session of a new pooled connection ahead of its first request
+ */
+int httpmorph_http2_open_pooled(struct pooled_connection *conn) {
+    if (!conn || !conn->ssl || conn->http2_session) {
+        return -1;
+    }
+
+    http2_stream_data_t stream_data = {0};
+    stream_data.ssl = conn->ssl;
+    stream_data.conn = conn;
+    if (http2_pooled_session_create(conn, &stream_data) != 0) {
+        return -1;
+    }
+
+    /* The first request sets its own user data; don't leave ours behind */
+    nghttp2_session_set_user_data((nghttp2_session *)conn->http2_session, NULL);
+    return 0;
+}
+
 /**
  * Perform HTTP/2 request with session reuse
  * Reuses nghttp2_session from pooled connection if available
@@ -475,63 +922,40 @@ int httpmorph_http2_request_pooled(struct pooled_connection *conn,
     }
 
     nghttp2_session *session = (nghttp2_session *)conn->http2_session;
-    nghttp2_session_callbacks *callbacks;
     http2_stream_data_t stream_data = {0};
     int rv;
-    bool session_created = false;
 
     stream_data.response = response;
     stream_data.ssl = conn->ssl;
-    stream_data.data_capacity = 16384;
+    stream_data.conn = conn;
+    stream_data.data_capacity = request->body_callback ? request->body_chunk_size : 16384;
+    if (stream_data.data_capacity == 0) stream_data.data_capacity = HTTPMORPH_DEFAULT_BODY_CHUNK_SIZE;
     stream_data.data_buf = malloc(stream_data.data_capacity);
     if (!stream_data.data_buf) return -1;
 
+    stream_data.body_callback = request->body_callback;
+    stream_data.body_userdata = request->body_callback_userdata;
+    stream_data.adaptive_window = request->http2_adaptive_window;
+
     /* Set up request body if present */
     stream_data.req_body = (const uint8_t *)request->body;
     stream_data.req_body_len = request->body_len;
     stream_data.req_body_sent = 0;
+    stream_data.req_body_is_file = request->body_is_file;
+    stream_data.req_body_fd = request->body_fd;
+    stream_data.req_body_offset = request->body_file_offset;
+    stream_data.req_source = request->body_source ? request : NULL;
 
     /* If no session exists, create one */
     if (session == NULL) {
-        /* Initialize nghttp2 callbacks */
-        nghttp2_session_callbacks_new(&callbacks);
-        nghttp2_session_callbacks_set_send_callback(callbacks, http2_send_callback);
-        nghttp2_session_callbacks_set_recv_callback(callbacks, http2_recv_callback);
-        nghttp2_session_callbacks_set_on_header_callback(callbacks, http2_on_header_callback);
-        nghttp2_session_callbacks_set_on_data_chunk_recv_callback(callbacks, http2_on_data_chunk_recv_callback);
-        nghttp2_session_callbacks_set_on_frame_recv_callback(callbacks, http2_on_frame_recv_callback);
-
-        /* Create session and send preface */
-        rv = http2_init_or_reuse_session(&session, callbacks, &stream_data, conn->ssl, &session_created);
-        nghttp2_session_callbacks_del(callbacks);
-
-        if (rv != 0) {
+        if (http2_pooled_session_create(conn, &stream_data) != 0) {
             free(stream_data.data_buf);
             return -1;
         }
-
-        /* Store session in connection for reuse */
-        conn->http2_session = session;
-        conn->preface_sent = true;
-
-        /* Create and start session manager for concurrent multiplexing */
-        http2_session_manager_t *mgr = http2_session_manager_create(
-            session,
-            callbacks,
-            conn->ssl,
-            conn->sockfd
-        );
-
-        if (mgr) {
-            /* Start I/O thread for concurrent stream handling */
-            if (http2_session_manager_start(mgr) == 0) {
-                conn->http2_session_manager = mgr;
-            } else {
-                /* Failed to start - clean up manager */
-                http2_session_manager_destroy(mgr);
-                conn->http2_session_manager = NULL;
-            }
-        }
+        session = (nghttp2_session *)conn->http2_session;
+    } else {
+        /* Reused session: send/recv callbacks must not see the last caller's stack */
+        nghttp2_session_set_user_data(session, &stream_data);
     }
 
     /* Prepare request headers */
@@ -539,11 +963,7 @@ int httpmorph_http2_request_pooled(struct pooled_connection *conn,
     int nhdrs = 0;
 
     /* Add pseudo-headers first */
-    const char *method_str = httpmorph_method_to_string(request->method);
-    hdrs[nhdrs++] = (nghttp2_nv){(uint8_t *)":method", (uint8_t *)method_str, 7, strlen(method_str), NGHTTP2_NV_FLAG_NONE};
-    hdrs[nhdrs++] = (nghttp2_nv){(uint8_t *)":path", (uint8_t *)path, 5, strlen(path), NGHTTP2_NV_FLAG_NONE};
-    hdrs[nhdrs++] = (nghttp2_nv){(uint8_t *)":scheme", (uint8_t *)"https", 7, 5, NGHTTP2_NV_FLAG_NONE};
-    hdrs[nhdrs++] = (nghttp2_nv){(uint8_t *)":authority", (uint8_t *)host, 10, strlen(host), NGHTTP2_NV_FLAG_NONE};
+    nhdrs += header_template_h2_prefix(hdrs, request->method, path, host);
 
     /* Add custom headers */
     for (size_t i = 0; i < request->header_count && nhdrs < 60; i++) {
@@ -563,8 +983,8 @@ int httpmorph_http2_request_pooled(struct pooled_connection *conn,
     nghttp2_data_provider data_prd;
     nghttp2_data_provider *data_prd_ptr = NULL;
 
-    if (stream_data.req_body_len > 0) {
-        data_prd.source.ptr = NULL;
+    if (httpmorph_request_has_body(request)) {
+        data_prd.source.ptr = &stream_data;
         data_prd.read_callback = http2_data_source_read_callback;
         data_prd_ptr = &data_prd;
     }
@@ -590,6 +1010,7 @@ int httpmorph_http2_request_pooled(struct pooled_connection *conn,
         free(stream_data.data_buf);
         return -1;
     }
+    HTTPMORPH_PROBE1(h2__stream__open, stream_id);
 
     /* Send request */
     nghttp2_session_send(session);
@@ -656,26 +1077,88 @@ int httpmorph_http2_request_pooled(struct pooled_connection *conn,
     }
 
     /* Check for errors */
-    if (rv != 0) {
+    if (rv != 0 || stream_data.stream_reset) {
+        nghttp2_session_set_stream_user_data(session, stream_id, NULL);
+        httpmorph_decoder_destroy(stream_data.decoder);
         free(stream_data.data_buf);
         return -1;
     }
 
     /* Copy data to response */
+    http2_stream_finish(&stream_data, response);
     if (stream_data.data_len > 0) {
-        response->body = stream_data.data_buf;
-        response->body_len = stream_data.data_len;
-        response->body_capacity = stream_data.data_capacity;
+        http2_adopt_body(response, stream_data.data_buf,
+                         stream_data.data_len, stream_data.data_capacity);
     } else {
         free(stream_data.data_buf);
-        response->body = NULL;
-        response->body_len = 0;
+        http2_adopt_body(response, NULL, 0, 0);
+    }
+
+    /* Hand the connection to the shared reactor for concurrent multiplexing */
+    if (!conn->http2_session_manager) {
+        http2_stream_data_t *io_data = calloc(1, sizeof(http2_stream_data_t));
+        if (io_data) {
+            io_data->ssl = conn->ssl;
+            io_data->conn = conn;
+            http2_session_manager_t *mgr = http2_session_manager_create(
+                session, NULL, conn->ssl, conn->sockfd, io_data);
+            if (!mgr) {
+                free(io_data);
+            } else if (http2_session_manager_start(mgr) == 0) {
+                conn->http2_session_manager = mgr;
+            } else {
+                /* Failed to start - keep using the sequential path */
+                http2_session_manager_destroy(mgr);
+            }
+        }
     }
 
     /* Don't delete session - keep it for reuse in the connection pool */
     return 0;
 }
 
+/* Blocks the calling thread until the reactor completes its stream */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    bool done;
+    bool has_error;
+} http2_stream_waiter_t;
+
+/* Helper: Stream completion callback (reactor thread) */
+static void http2_stream_waiter_complete(void *ctx, int32_t stream_id, bool has_error) {
+    http2_stream_waiter_t *waiter = (http2_stream_waiter_t*)ctx;
+    (void)stream_id;
+
+    pthread_mutex_lock(&waiter->mutex);
+    waiter->done = true;
+    waiter->has_error = has_error;
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->mutex);
+}
+
+/* Helper: Wait for the completion callback, up to timeout_ms */
+static int http2_stream_waiter_wait(http2_stream_waiter_t *waiter, uint32_t timeout_ms) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ms / 1000;
+    deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&waiter->mutex);
+    int rv = 0;
+    while (!waiter->done && rv == 0) {
+        rv = pthread_cond_timedwait(&waiter->cond, &waiter->mutex, &deadline);
+    }
+    bool ok = waiter->done && !waiter->has_error;
+    pthread_mutex_unlock(&waiter->mutex);
+
+    return ok ? 0 : -1;
+}
+
 /**
  * Perform HTTP/2 request with concurrent multiplexing
  * Uses session manager to allow multiple concurrent streams on same session
@@ -690,9 +1173,14 @@ int httpmorph_http2_request_concurrent(struct pooled_connection *conn,
 
     http2_session_manager_t *mgr = (http2_session_manager_t*)conn->http2_session_manager;
     http2_stream_data_t *stream_data = NULL;
+    http2_stream_waiter_t waiter = {0};
     int32_t stream_id = -1;
     int rv;
 
+    if (!http2_session_manager_is_usable(mgr)) {
+        return -1;
+    }
+
     /* Allocate stream data */
     stream_data = calloc(1, sizeof(http2_stream_data_t));
     if (!stream_data) {
@@ -701,17 +1189,26 @@ int httpmorph_http2_request_concurrent(struct pooled_connection *conn,
 
     stream_data->response = response;
     stream_data->ssl = conn->ssl;
-    stream_data->data_capacity = 16384;
+    stream_data->data_capacity = request->body_callback ? request->body_chunk_size : 16384;
+    if (stream_data->data_capacity == 0) stream_data->data_capacity = HTTPMORPH_DEFAULT_BODY_CHUNK_SIZE;
     stream_data->data_buf = malloc(stream_data->data_capacity);
     if (!stream_data->data_buf) {
         free(stream_data);
         return -1;
     }
 
+    stream_data->body_callback = request->body_callback;
+    stream_data->body_userdata = request->body_callback_userdata;
+    stream_data->adaptive_window = request->http2_adaptive_window;
+
     /* Set up request body if present */
     stream_data->req_body = (const uint8_t *)request->body;
     stream_data->req_body_len = request->body_len;
     stream_data->req_body_sent = 0;
+    stream_data->req_body_is_file = request->body_is_file;
+    stream_data->req_body_fd = request->body_fd;
+    stream_data->req_body_offset = request->body_file_offset;
+    stream_data->req_source = request->body_source ? request : NULL;
 
     /* Link to session manager for callbacks */
     stream_data->session_manager = mgr;
@@ -721,34 +1218,7 @@ int httpmorph_http2_request_concurrent(struct pooled_connection *conn,
     int hdr_count = 0;
 
     /* Mandatory pseudo-headers for HTTP/2 */
-    const char *method_str = httpmorph_method_to_string(request->method);
-    hdrs[hdr_count].name = (uint8_t *)":method";
-    hdrs[hdr_count].namelen = 7;
-    hdrs[hdr_count].value = (uint8_t *)method_str;
-    hdrs[hdr_count].valuelen = strlen(method_str);
-    hdrs[hdr_count].flags = NGHTTP2_NV_FLAG_NONE;
-    hdr_count++;
-
-    hdrs[hdr_count].name = (uint8_t *)":path";
-    hdrs[hdr_count].namelen = 5;
-    hdrs[hdr_count].value = (uint8_t *)path;
-    hdrs[hdr_count].valuelen = strlen(path);
-    hdrs[hdr_count].flags = NGHTTP2_NV_FLAG_NONE;
-    hdr_count++;
-
-    hdrs[hdr_count].name = (uint8_t *)":scheme";
-    hdrs[hdr_count].namelen = 7;
-    hdrs[hdr_count].value = (uint8_t *)"https";
-    hdrs[hdr_count].valuelen = 5;
-    hdrs[hdr_count].flags = NGHTTP2_NV_FLAG_NONE;
-    hdr_count++;
-
-    hdrs[hdr_count].name = (uint8_t *)":authority";
-    hdrs[hdr_count].namelen = 10;
-    hdrs[hdr_count].value = (uint8_t *)host;
-    hdrs[hdr_count].valuelen = strlen(host);
-    hdrs[hdr_count].flags = NGHTTP2_NV_FLAG_NONE;
-    hdr_count++;
+    hdr_count += header_template_h2_prefix(hdrs, request->method, path, host);
 
     /* Add custom headers */
     for (size_t i = 0; i < request->header_count && hdr_count < 64; i++) {
@@ -763,7 +1233,7 @@ int httpmorph_http2_request_concurrent(struct pooled_connection *conn,
     /* Set up data provider for request body if needed */
     nghttp2_data_provider data_prd;
     nghttp2_data_provider *data_prd_ptr = NULL;
-    if (request->body && request->body_len > 0) {
+    if (httpmorph_request_has_body(request)) {
         data_prd.source.ptr = stream_data;
         data_prd.read_callback = http2_data_source_read_callback;
         data_prd_ptr = &data_prd;
@@ -782,7 +1252,11 @@ int httpmorph_http2_request_concurrent(struct pooled_connection *conn,
         pri_spec_ptr = &pri_spec;
     }
 
-    /* Submit stream to session manager (non-blocking) */
+    pthread_mutex_init(&waiter.mutex, NULL);
+    pthread_cond_init(&waiter.cond, NULL);
+
+    /* Submit stream to session manager (non-blocking; queued at the peer's
+     * stream limit, so hdrs and data_prd stay in scope until it is removed) */
     rv = http2_session_manager_submit_stream(
         mgr,
         stream_data,
@@ -790,38 +1264,43 @@ int httpmorph_http2_request_concurrent(struct pooled_connection *conn,
         hdrs,
         hdr_count,
         data_prd_ptr,
+        http2_stream_waiter_complete,
+        &waiter,
         &stream_id
     );
 
     if (rv != 0) {
+        pthread_cond_destroy(&waiter.cond);
+        pthread_mutex_destroy(&waiter.mutex);
         free(stream_data->data_buf);
         free(stream_data);
         return -1;
     }
 
-    /* Store stream ID for later cleanup */
-    stream_data->stream_id = stream_id;
-
-    /* Wait for stream completion (blocking with timeout) */
+    /* Wait for the reactor to complete the stream (blocking with timeout) */
     uint32_t timeout_ms = request->timeout_ms > 0 ? request->timeout_ms : 30000;
-    rv = http2_session_manager_wait_for_stream(mgr, stream_id, timeout_ms);
+    rv = http2_stream_waiter_wait(&waiter, timeout_ms);
+
+    /* Detach from the session before touching stream_data (resets it on timeout) */
+    http2_session_manager_remove_stream(mgr, stream_data);
+    pthread_cond_destroy(&waiter.cond);
+    pthread_mutex_destroy(&waiter.mutex);
 
     /* Copy response body to response structure */
+    if (rv == 0) {
+        http2_stream_finish(stream_data, response);
+    }
     if (rv == 0 && stream_data->data_len > 0) {
-        response->body = stream_data->data_buf;
-        response->body_len = stream_data->data_len;
-        response->body_capacity = stream_data->data_capacity;
+        http2_adopt_body(response, stream_data->data_buf,
+                         stream_data->data_len, stream_data->data_capacity);
         /* Transfer ownership - don't free data_buf */
     } else {
         /* Error or no body */
+        httpmorph_decoder_destroy(stream_data->decoder);
         free(stream_data->data_buf);
-        response->body = NULL;
-        response->body_len = 0;
+        http2_adopt_body(response, NULL, 0, 0);
     }
 
-    /* Clean up stream tracking */
-    http2_session_manager_remove_stream(mgr, stream_id);
-
     /* Free stream data structure (but not data_buf if transferred to response) */
     free(stream_data);
 
@@ -0,0 +1,493 @@
+/**
+ * http2_reactor.c - Shared event loop for multiplexed HTTP/2 connections
+ */
+
+/* Include internal.h first to get POSIX feature test macros */
+#include "internal/internal.h"
+#include "http2_reactor.h"
+#include "io_engine.h"
+
+#ifdef __linux__
+    #include <sys/eventfd.h>
+#endif
+
+#ifndef _WIN32
+    #include <pthread.h>
+#endif
+
+/**
+ * Connection watched by a reactor
+ */
+struct http2_reactor_handle {
+    struct http2_reactor *reactor;
+    int fd;
+    io_operation_t *op;
+    http2_reactor_ready_t on_ready;
+    void *ctx;
+    bool queued;                 /* On the ready list */
+    bool muted;                  /* Callback asked to stop watching */
+    bool detached;               /* Owner is gone, free after the next dispatch */
+    bool want_write;             /* Current interest (Windows poll) */
+    http2_reactor_handle_t *next;
+    http2_reactor_handle_t *next_ready;
+};
+
+/**
+ * One reactor thread and its event loop
+ */
+typedef struct http2_reactor {
+    pthread_t thread;
+    pthread_mutex_t lock;        /* Held while dispatching, and by attach/detach */
+    bool running;
+    volatile bool stopping;
+    io_engine_t *engine;
+    int wake_fd;
+    int wake_fd_write;
+    io_operation_t *wake_op;
+    bool wake_pending;
+    http2_reactor_handle_t *handles;   /* Attached connections */
+    http2_reactor_handle_t *ready;     /* Reactor thread only */
+    http2_reactor_handle_t *dead;      /* Detached, waiting to be freed */
+} http2_reactor_t;
+
+/* Global reactor state */
+static http2_reactor_t reactors[HTTP2_REACTOR_MAX_THREADS];
+static int reactor_count = 0;
+static unsigned int reactor_next = 0;
+static bool reactors_started = false;
+static bool reactors_stopped = false;
+
+#ifdef _WIN32
+static pthread_mutex_t reactors_mutex;
+static bool reactors_mutex_initialized = false;
+#else
+static pthread_mutex_t reactors_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+/**
+ * Initialize the global lock (called on first use)
+ */
+static void reactors_init_mutex(void) {
+#ifdef _WIN32
+    if (!reactors_mutex_initialized) {
+        pthread_mutex_init(&reactors_mutex, NULL);
+        reactors_mutex_initialized = true;
+    }
+#endif
+}
+
+/**
+ * Create the wakeup fd (eventfd on Linux, pipe elsewhere)
+ */
+static void reactor_wake_create(http2_reactor_t *r) {
+    r->wake_fd = -1;
+    r->wake_fd_write = -1;
+#if defined(__linux__)
+    int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (fd >= 0) {
+        r->wake_fd = fd;
+        r->wake_fd_write = fd;
+    }
+#elif !defined(_WIN32)
+    int fds[2];
+    if (pipe(fds) == 0) {
+        for (int i = 0; i < 2; i++) {
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL, 0) | O_NONBLOCK);
+            fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+        }
+        r->wake_fd = fds[0];
+        r->wake_fd_write = fds[1];
+    }
+#endif
+}
+
+/**
+ * Interrupt the reactor's wait
+ */
+static void reactor_wake(http2_reactor_t *r) {
+#ifndef _WIN32
+    if (r->wake_fd_write < 0) {
+        return;
+    }
+    uint64_t one = 1;
+    ssize_t n;
+    do {
+        n = write(r->wake_fd_write, &one, sizeof(one));
+    } while (n < 0 && errno == EINTR);
+    /* EAGAIN means it is already signalled */
+#else
+    (void)r;  /* The poll timeout bounds the wait */
+#endif
+}
+
+/**
+ * Drain and re-arm the wakeup fd (reactor thread, lock held)
+ */
+static void reactor_wake_clear(http2_reactor_t *r) {
+#ifndef _WIN32
+    uint64_t buf[8];
+    while (read(r->wake_fd, buf, sizeof(buf)) > 0) {
+        /* Drain */
+    }
+    io_engine_submit(r->engine, r->wake_op);  /* One-shot on kqueue */
+#else
+    (void)r;
+#endif
+}
+
+/**
+ * I/O readiness callback for the wakeup fd (runs inside io_engine_wait)
+ */
+static void on_wake_ready(io_operation_t *op) {
+    http2_reactor_t *r = (http2_reactor_t*)op->user_data;
+    r->wake_pending = true;
+}
+
+/**
+ * I/O readiness callback for a connection (runs inside io_engine_wait)
+ */
+static void on_handle_ready(io_operation_t *op) {
+    http2_reactor_handle_t *h = (http2_reactor_handle_t*)op->user_data;
+    if (!h->queued) {
+        h->queued = true;
+        h->next_ready = h->reactor->ready;
+        h->reactor->ready = h;
+    }
+}
+
+/**
+ * Free a handle
+ */
+static void handle_free(http2_reactor_handle_t *h) {
+    io_op_destroy(h->op);
+    free(h);
+}
+
+/**
+ * Run the callbacks of ready connections
+ *
+ * Handles detached during the preceding wait are freed afterwards: the
+ * wait may still have reported them, but no later wait can.
+ */
+static void reactor_dispatch(http2_reactor_t *r) {
+    pthread_mutex_lock(&r->lock);
+
+    while (r->ready) {
+        http2_reactor_handle_t *h = r->ready;
+        r->ready = h->next_ready;
+        h->queued = false;
+
+        if (h->detached || h->muted) {
+            continue;
+        }
+        if (h->on_ready(h->ctx) < 0) {
+            h->muted = true;
+            io_engine_remove(r->engine, h->fd);
+        }
+    }
+
+    while (r->dead) {
+        http2_reactor_handle_t *h = r->dead;
+        r->dead = h->next;
+        handle_free(h);
+    }
+
+    if (r->wake_pending) {
+        r->wake_pending = false;
+        reactor_wake_clear(r);
+    }
+
+    pthread_mutex_unlock(&r->lock);
+}
+
+#ifdef _WIN32
+/**
+ * Wait for readiness with WSAPoll (the IOCP engine doesn't report it)
+ */
+static void reactor_poll(http2_reactor_t *r) {
+    ULONG n = 0;
+
+    pthread_mutex_lock(&r->lock);
+    size_t count = 0;
+    for (http2_reactor_handle_t *h = r->handles; h; h = h->next) {
+        count++;
+    }
+    WSAPOLLFD *fds = count ? malloc(count * sizeof(WSAPOLLFD)) : NULL;
+    http2_reactor_handle_t **polled = count ? malloc(count * sizeof(*polled)) : NULL;
+    if (fds && polled) {
+        for (http2_reactor_handle_t *h = r->handles; h; h = h->next) {
+            if (!h->muted) {
+                fds[n].fd = (SOCKET)h->fd;
+                fds[n].events = h->want_write ? POLLWRNORM : POLLRDNORM;
+                fds[n].revents = 0;
+                polled[n++] = h;
+            }
+        }
+    }
+    pthread_mutex_unlock(&r->lock);
+
+    /* Handles detached meanwhile stay allocated until the next dispatch */
+    if (n == 0) {
+        Sleep(HTTP2_REACTOR_POLL_MS);
+    } else if (WSAPoll(fds, n, HTTP2_REACTOR_POLL_MS) > 0) {
+        for (ULONG i = 0; i < n; i++) {
+            if (fds[i].revents) {
+                on_handle_ready(polled[i]->op);
+            }
+        }
+    }
+    free(fds);
+    free(polled);
+}
+#endif
+
+/**
+ * Reactor thread: wait, dispatch, repeat
+ */
+static void* reactor_thread(void *arg) {
+    http2_reactor_t *r = (http2_reactor_t*)arg;
+
+    while (!r->stopping) {
+#ifdef _WIN32
+        reactor_poll(r);
+#else
+        io_engine_wait(r->engine, HTTP2_REACTOR_WAIT_MS);
+#endif
+        reactor_dispatch(r);
+    }
+    return NULL;
+}
+
+/**
+ * Set up and start one reactor
+ */
+static int reactor_start(http2_reactor_t *r) {
+    memset(r, 0, sizeof(*r));
+    pthread_mutex_init(&r->lock, NULL);
+
+#ifndef _WIN32
+    /* Readiness engines only (Windows polls instead) */
+    r->engine = io_engine_create(0);
+    if (r->engine && (r->engine->engine_fd < 0 ||
+                      (r->engine->type != IO_ENGINE_EPOLL && r->engine->type != IO_ENGINE_KQUEUE))) {
+        io_engine_destroy(r->engine);
+        r->engine = NULL;
+    }
+    if (!r->engine) {
+        return -1;
+    }
+
+    reactor_wake_create(r);
+    if (r->wake_fd < 0) {
+        io_engine_destroy(r->engine);
+        return -1;
+    }
+    r->wake_op = io_op_recv_create(r->wake_fd, NULL, 0, on_wake_ready, r);
+    if (!r->wake_op || io_engine_submit(r->engine, r->wake_op) != 0) {
+        io_op_destroy(r->wake_op);
+        close(r->wake_fd);
+        if (r->wake_fd_write != r->wake_fd) close(r->wake_fd_write);
+        io_engine_destroy(r->engine);
+        return -1;
+    }
+#endif
+
+    if (pthread_create(&r->thread, NULL, reactor_thread, r) != 0) {
+        if (r->wake_op) {
+            io_engine_remove(r->engine, r->wake_fd);
+            io_op_destroy(r->wake_op);
+        }
+#ifndef _WIN32
+        close(r->wake_fd);
+        if (r->wake_fd_write != r->wake_fd) close(r->wake_fd_write);
+#endif
+        io_engine_destroy(r->engine);
+        return -1;
+    }
+
+    r->running = true;
+    return 0;
+}
+
+/**
+ * Get the number of online CPUs
+ */
+static int reactor_cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+/**
+ * Pick a reactor for a new connection, starting them on first use
+ */
+static http2_reactor_t* reactor_pick(void) {
+    reactors_init_mutex();
+    pthread_mutex_lock(&reactors_mutex);
+
+    if (!reactors_started && !reactors_stopped) {
+        reactors_started = true;
+        int wanted = reactor_cpu_count();
+        if (wanted > HTTP2_REACTOR_MAX_THREADS) {
+            wanted = HTTP2_REACTOR_MAX_THREADS;
+        }
+        for (int i = 0; i < wanted; i++) {
+            if (reactor_start(&reactors[reactor_count]) != 0) {
+                break;
+            }
+            reactor_count++;
+        }
+    }
+
+    http2_reactor_t *r = NULL;
+    if (!reactors_stopped && reactor_count > 0) {
+        r = &reactors[reactor_next++ % (unsigned int)reactor_count];
+    }
+
+    pthread_mutex_unlock(&reactors_mutex);
+    return r;
+}
+
+/**
+ * Start watching a connected socket for reads
+ */
+http2_reactor_handle_t* http2_reactor_attach(int sockfd, http2_reactor_ready_t on_ready, void *ctx) {
+    if (sockfd < 0 || !on_ready) {
+        return NULL;
+    }
+
+    http2_reactor_t *r = reactor_pick();
+    if (!r) {
+        return NULL;
+    }
+
+    http2_reactor_handle_t *h = calloc(1, sizeof(http2_reactor_handle_t));
+    if (!h) {
+        return NULL;
+    }
+    h->op = io_op_recv_create(sockfd, NULL, 0, on_handle_ready, h);
+    if (!h->op) {
+        free(h);
+        return NULL;
+    }
+    h->reactor = r;
+    h->fd = sockfd;
+    h->on_ready = on_ready;
+    h->ctx = ctx;
+
+#ifdef _WIN32
+    u_long mode = 1;
+    ioctlsocket(sockfd, FIONBIO, &mode);
+#else
+    int flags = fcntl(sockfd, F_GETFL, 0);
+    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+#endif
+
+    pthread_mutex_lock(&r->lock);
+    h->next = r->handles;
+    r->handles = h;
+    pthread_mutex_unlock(&r->lock);
+
+#ifndef _WIN32
+    if (io_engine_submit(r->engine, h->op) != 0) {
+        http2_reactor_detach(h);
+        return NULL;
+    }
+#endif
+    return h;
+}
+
+/**
+ * Re-arm a connection
+ */
+int http2_reactor_watch(http2_reactor_handle_t *handle, bool want_write) {
+    if (!handle || handle->muted || handle->detached) {
+        return -1;
+    }
+
+    handle->want_write = want_write;
+#ifdef _WIN32
+    return 0;  /* Picked up by the next poll */
+#else
+    handle->op->type = want_write ? IO_OP_SEND : IO_OP_RECV;
+    return io_engine_submit(handle->reactor->engine, handle->op);
+#endif
+}
+
+/**
+ * Stop watching a connection and free its handle
+ */
+void http2_reactor_detach(http2_reactor_handle_t *handle) {
+    if (!handle) {
+        return;
+    }
+
+    http2_reactor_t *r = handle->reactor;
+    pthread_mutex_lock(&r->lock);
+
+    for (http2_reactor_handle_t **p = &r->handles; *p; p = &(*p)->next) {
+        if (*p == handle) {
+            *p = handle->next;
+            break;
+        }
+    }
+    handle->detached = true;
+
+    if (r->running) {
+        io_engine_remove(r->engine, handle->fd);
+        handle->next = r->dead;
+        r->dead = handle;
+    } else {
+        handle_free(handle);
+    }
+
+    pthread_mutex_unlock(&r->lock);
+}
+
+/**
+ * Stop the reactor threads
+ */
+void http2_reactor_shutdown(void) {
+    reactors_init_mutex();
+    pthread_mutex_lock(&reactors_mutex);
+    reactors_stopped = true;
+
+    for (int i = 0; i < reactor_count; i++) {
+        http2_reactor_t *r = &reactors[i];
+        if (!r->running) {
+            continue;
+        }
+
+        r->stopping = true;
+        reactor_wake(r);
+        pthread_join(r->thread, NULL);
+
+        /* Connections still attached are freed by their owners' detach */
+        pthread_mutex_lock(&r->lock);
+        r->running = false;
+        while (r->dead) {
+            http2_reactor_handle_t *h = r->dead;
+            r->dead = h->next;
+            handle_free(h);
+        }
+        if (r->wake_op) {
+            io_engine_remove(r->engine, r->wake_fd);
+            io_op_destroy(r->wake_op);
+            r->wake_op = NULL;
+        }
+#ifndef _WIN32
+        close(r->wake_fd);
+        if (r->wake_fd_write != r->wake_fd) close(r->wake_fd_write);
+#endif
+        io_engine_destroy(r->engine);
+        r->engine = NULL;
+        pthread_mutex_unlock(&r->lock);
+    }
+
+    pthread_mutex_unlock(&reactors_mutex);
+}
@@ -0,0 +1,86 @@
+/**
+ * http2_reactor.h - Shared event loop for multiplexed HTTP/2 connections
+ *
+ * A few reactor threads (one per core, at most HTTP2_REACTOR_MAX_THREADS)
+ * watch every HTTP/2 connection handed to the session manager, instead of
+ * one I/O thread per connection. Each reactor waits in io_engine_wait()
+ * (epoll/kqueue), so idle connections cost no thread and no polling; a
+ * connection's ready callback runs on its reactor thread when the socket
+ * becomes readable (or writable, while output is blocked).
+ *
+ * Windows: the IOCP io_engine has no readiness notifications, so reactors
+ * there poll their sockets with WSAPoll().
+ */
+
+#ifndef HTTPMORPH_HTTP2_REACTOR_H
+#define HTTPMORPH_HTTP2_REACTOR_H
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Upper bound on reactor threads (started on the first attach) */
+#define HTTP2_REACTOR_MAX_THREADS 4
+
+/* Idle wait; only bounds how late shutdown is noticed on Windows */
+#define HTTP2_REACTOR_WAIT_MS 1000
+#define HTTP2_REACTOR_POLL_MS 10    /* Windows: picks up new interest */
+
+/**
+ * A connection watched by a reactor
+ */
+typedef struct http2_reactor_handle http2_reactor_handle_t;
+
+/**
+ * Ready callback, run on the reactor thread
+ *
+ * Must re-arm with http2_reactor_watch() to hear about the socket again.
+ *
+ * @param ctx Context passed to http2_reactor_attach()
+ * @return 0 to keep the connection, -1 to stop watching it for good
+ */
+typedef int (*http2_reactor_ready_t)(void *ctx);
+
+/**
+ * Start watching a connected socket for reads
+ *
+ * The socket is switched to non-blocking mode.
+ *
+ * @param sockfd Connected socket
+ * @param on_ready Ready callback
+ * @param ctx Callback context
+ * @return Handle, or NULL if no reactor could be started
+ */
+http2_reactor_handle_t* http2_reactor_attach(int sockfd, http2_reactor_ready_t on_ready, void *ctx);
+
+/**
+ * Re-arm a connection (thread-safe, serialize with the ready callback)
+ *
+ * @param handle Connection handle
+ * @param want_write Wait for writability (output blocked) instead of reads
+ * @return 0 on success, -1 if the connection is no longer watched
+ */
+int http2_reactor_watch(http2_reactor_handle_t *handle, bool want_write);
+
+/**
+ * Stop watching a connection and free its handle
+ *
+ * Once this returns the ready callback is not running and won't run again.
+ * Must not be called from the ready callback.
+ *
+ * @param handle Connection handle (may be NULL)
+ */
+void http2_reactor_detach(http2_reactor_handle_t *handle);
+
+/**
+ * Stop the reactor threads (called from httpmorph_cleanup())
+ */
+void http2_reactor_shutdown(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_HTTP2_REACTOR_H */
@@ -1,5 +1,9 @@
 /**
  * http2_session_manager.c - HTTP/2 Session Manager Implementation
+ *
+ * Streams past the peer's concurrency limit wait on the same list as open
+ * ones, marked queued; the queue is short, so picking the next stream is a
+ * scan rather than a heap.
  */
 
 /* Include internal.h first to get POSIX feature test macros */
@@ -9,44 +13,43 @@
 #ifdef HAVE_NGHTTP2
 
 #include "internal/http2_logic.h"
+#include "trace.h"
 #include <stdlib.h>
 #include <string.h>
-#include <time.h>
-#include <errno.h>
-
-#ifdef _WIN32
-#include <winsock2.h>
-#else
-#include <unistd.h>
-#include <sys/select.h>
-#endif
 
 /* Helper: Create a pending stream tracker */
 static http2_pending_stream_t* create_pending_stream(
-    int32_t stream_id,
-    void *stream_data
+    void *stream_data,
+    const nghttp2_priority_spec *pri_spec,
+    const nghttp2_nv *hdrs,
+    size_t hdr_count,
+    nghttp2_data_provider *data_prd,
+    http2_stream_complete_cb_t on_complete,
+    void *on_complete_ctx
 ) {
     http2_pending_stream_t *pending = calloc(1, sizeof(http2_pending_stream_t));
     if (!pending) return NULL;
 
-    pending->stream_id = stream_id;
+    pending->stream_id = 0;
     pending->stream_data = stream_data;
+    pending->hdrs = hdrs;
+    pending->hdr_count = hdr_count;
+    pending->data_prd = data_prd;
+    if (pri_spec) {
+        pending->pri_spec = *pri_spec;
+        pending->has_pri_spec = true;
+    }
+    pending->on_complete = on_complete;
+    pending->on_complete_ctx = on_complete_ctx;
     pending->completed = false;
     pending->has_error = false;
     pending->next = NULL;
 
-    pthread_mutex_init(&pending->stream_mutex, NULL);
-    pthread_cond_init(&pending->stream_complete, NULL);
-
     return pending;
 }
 
 /* Helper: Destroy a pending stream */
 static void destroy_pending_stream(http2_pending_stream_t *pending) {
-    if (!pending) return;
-
-    pthread_mutex_destroy(&pending->stream_mutex);
-    pthread_cond_destroy(&pending->stream_complete);
     free(pending);
 }
 
@@ -61,6 +64,121 @@ static void add_pending_stream(
     mgr->active_stream_count++;
 }
 
+/* Helper: Complete a pending stream and notify its owner */
+static void complete_pending_stream(
+    http2_session_manager_t *mgr,
+    http2_pending_stream_t *pending,
+    bool has_error
+) {
+    /* mgr->mutex must be held by caller */
+    if (pending->completed) {
+        return;
+    }
+    pending->completed = true;
+    pending->has_error = has_error;
+    mgr->total_streams_completed++;
+
+    if (pending->queued) {
+        pending->queued = false;
+        mgr->queued_stream_count--;
+    } else if (pending->stream_id > 0) {
+        mgr->open_stream_count--;
+    }
+
+    if (pending->on_complete) {
+        pending->on_complete(pending->on_complete_ctx, pending->stream_id, has_error);
+    }
+}
+
+/* Helper: Mark the connection dead and fail every pending stream */
+static void fail_session(http2_session_manager_t *mgr) {
+    /* mgr->mutex must be held by caller */
+    mgr->closed = true;
+    for (http2_pending_stream_t *curr = mgr->pending_streams; curr; curr = curr->next) {
+        complete_pending_stream(mgr, curr, true);
+    }
+}
+
+/* Helper: Hand a stream's request to nghttp2 */
+static int open_pending_stream(
+    http2_session_manager_t *mgr,
+    http2_pending_stream_t *pending
+) {
+    /* mgr->mutex must be held by caller; nghttp2 copies headers and provider */
+    int32_t stream_id = nghttp2_submit_request(
+        mgr->session,
+        pending->has_pri_spec ? &pending->pri_spec : NULL,
+        pending->hdrs,
+        pending->hdr_count,
+        pending->data_prd,
+        pending->stream_data  /* User data for callbacks */
+    );
+    pending->hdrs = NULL;
+    pending->data_prd = NULL;
+
+    if (stream_id < 0) {
+        return -1;
+    }
+    HTTPMORPH_PROBE1(h2__stream__open, stream_id);
+
+    pending->stream_id = stream_id;
+    mgr->open_stream_count++;
+    mgr->total_streams_submitted++;
+    return 0;
+}
+
+/* Helper: Whether the peer allows another open stream */
+static bool session_has_room(http2_session_manager_t *mgr) {
+    /* mgr->mutex must be held by caller; unlimited until the peer's SETTINGS arrive */
+    uint32_t limit = nghttp2_session_get_remote_settings(
+        mgr->session, NGHTTP2_SETTINGS_MAX_CONCURRENT_STREAMS);
+    return (uint32_t)mgr->open_stream_count < limit;
+}
+
+/* Helper: Whether queued stream a goes before b (higher weight, then older) */
+static bool queued_before(const http2_pending_stream_t *a, const http2_pending_stream_t *b) {
+    int32_t weight_a = a->has_pri_spec ? a->pri_spec.weight : NGHTTP2_DEFAULT_WEIGHT;
+    int32_t weight_b = b->has_pri_spec ? b->pri_spec.weight : NGHTTP2_DEFAULT_WEIGHT;
+    if (weight_a != weight_b) {
+        return weight_a > weight_b;
+    }
+    return a->queue_seq < b->queue_seq;
+}
+
+/* Helper: Open queued streams while the peer's limit allows; returns how many */
+static int dispatch_queued_streams(http2_session_manager_t *mgr) {
+    /* mgr->mutex must be held by caller */
+    int opened = 0;
+    while (!mgr->closed && mgr->queued_stream_count > 0 && session_has_room(mgr)) {
+        http2_pending_stream_t *next = NULL;
+        for (http2_pending_stream_t *curr = mgr->pending_streams; curr; curr = curr->next) {
+            if (curr->queued && (!next || queued_before(curr, next))) {
+                next = curr;
+            }
+        }
+        if (!next) {
+            break;
+        }
+
+        next->queued = false;
+        mgr->queued_stream_count--;
+        if (open_pending_stream(mgr, next) != 0) {
+            complete_pending_stream(mgr, next, true);
+            continue;
+        }
+        opened++;
+    }
+    return opened;
+}
+
+/* Helper: Wait for writability while output is blocked, reads otherwise */
+static void rearm_session(http2_session_manager_t *mgr) {
+    /* mgr->mutex must be held by caller */
+    if (!mgr->closed) {
+        http2_reactor_watch(mgr->reactor, nghttp2_session_want_write(mgr->session) != 0);
+    }
+}
+
 /**
  * Find a pending stream by ID
  */
@@ -71,7 +189,7 @@ http2_pending_stream_t* http2_session_manager_find_stream(
     /* mgr->mutex must be held by caller */
     http2_pending_stream_t *curr = mgr->pending_streams;
     while (curr) {
-        if (curr->stream_id == stream_id) {
+        if (curr->stream_id == stream_id && !curr->queued) {
             return curr;
         }
         curr = curr->next;
@@ -80,76 +198,38 @@ http2_pending_stream_t* http2_session_manager_find_stream(
 }
 
 /**
- * I/O thread main loop
- * Handles send/recv for all streams on this session
+ * Reactor callback: the socket is readable (or writable)
+ * Reads every frame that has arrived, then flushes pending output.
  */
-static void* http2_io_thread_main(void *arg) {
-    http2_session_manager_t *mgr = (http2_session_manager_t*)arg;
-
-    while (!mgr->shutdown_requested) {
-        pthread_mutex_lock(&mgr->mutex);
+static int http2_session_ready(void *ctx) {
+    http2_session_manager_t *mgr = (http2_session_manager_t*)ctx;
 
-        /* Send any pending data */
-        int rv = nghttp2_session_send(mgr->session);
-        if (rv != 0) {
-            /* Send error - might need to shutdown */
-            pthread_mutex_unlock(&mgr->mutex);
-            break;
-        }
+    pthread_mutex_lock(&mgr->mutex);
 
+    if (mgr->closed) {
         pthread_mutex_unlock(&mgr->mutex);
+        return -1;
+    }
 
-        /* Receive data with select for efficiency */
-        fd_set readfds;
-        struct timeval tv;
-
-        FD_ZERO(&readfds);
-        FD_SET(mgr->sockfd, &readfds);
-
-        tv.tv_sec = 0;
-        tv.tv_usec = 10000;  /* 10ms timeout */
-
-        int select_rv = select(mgr->sockfd + 1, &readfds, NULL, NULL, &tv);
-
-        if (select_rv > 0 && FD_ISSET(mgr->sockfd, &readfds)) {
-            pthread_mutex_lock(&mgr->mutex);
-
-            /* Receive data */
-            rv = nghttp2_session_recv(mgr->session);
-
-            if (rv == NGHTTP2_ERR_EOF) {
-                /* Connection closed */
-                pthread_mutex_unlock(&mgr->mutex);
-                break;
-            } else if (rv < 0 && rv != NGHTTP2_ERR_WOULDBLOCK) {
-                /* Receive error */
-                pthread_mutex_unlock(&mgr->mutex);
-                break;
-            }
-
-            pthread_mutex_unlock(&mgr->mutex);
-        }
-
-        /* Small sleep to avoid busy-waiting if no data */
-        if (select_rv == 0) {
-            usleep(1000);  /* 1ms */
-        }
+    /* Non-blocking socket: recv returns once SSL_read would block */
+    int rv = nghttp2_session_recv(mgr->session);
+    if (rv == 0) {
+        /* Streams that finished make room for queued ones */
+        dispatch_queued_streams(mgr);
+        rv = nghttp2_session_send(mgr->session);
     }
 
-    /* Mark all remaining streams as failed */
-    pthread_mutex_lock(&mgr->mutex);
-    http2_pending_stream_t *curr = mgr->pending_streams;
-    while (curr) {
-        pthread_mutex_lock(&curr->stream_mutex);
-        curr->completed = true;
-        curr->has_error = true;
-        pthread_cond_signal(&curr->stream_complete);
-        pthread_mutex_unlock(&curr->stream_mutex);
-        curr = curr->next;
+    if (rv != 0 ||
+        (!nghttp2_session_want_read(mgr->session) && !nghttp2_session_want_write(mgr->session))) {
+        /* EOF, protocol error or GOAWAY fully processed */
+        fail_session(mgr);
+        pthread_mutex_unlock(&mgr->mutex);
+        return -1;
     }
-    pthread_mutex_unlock(&mgr->mutex);
 
-    return NULL;
+    rearm_session(mgr);
+    pthread_mutex_unlock(&mgr->mutex);
+    return 0;
 }
 
 /**
@@ -159,7 +239,8 @@ http2_session_manager_t* http2_session_manager_create(
     nghttp2_session *session,
     nghttp2_session_callbacks *callbacks,
     SSL *ssl,
-    int sockfd
+    int sockfd,
+    void *session_data
 ) {
     if (!session || !ssl) {
         return NULL;
@@ -174,15 +255,25 @@ http2_session_manager_t* http2_session_manager_create(
     mgr->callbacks = callbacks;
     mgr->ssl = ssl;
     mgr->sockfd = sockfd;
+    mgr->session_data = session_data;
+    mgr->reactor = NULL;
+    mgr->closed = false;
     mgr->pending_streams = NULL;
     mgr->active_stream_count = 0;
+    mgr->open_stream_count = 0;
+    mgr->queued_stream_count = 0;
+    mgr->next_queue_seq = 0;
     mgr->total_streams_submitted = 0;
     mgr->total_streams_completed = 0;
-    mgr->io_thread_running = false;
-    mgr->shutdown_requested = false;
+    mgr->total_streams_queued = 0;
 
     pthread_mutex_init(&mgr->mutex, NULL);
 
+    /* Send/recv callbacks must not see a previous caller's stack data */
+    if (session_data) {
+        nghttp2_session_set_user_data(session, session_data);
+    }
+
     return mgr;
 }
 
@@ -192,10 +283,8 @@ http2_session_manager_t* http2_session_manager_create(
 void http2_session_manager_destroy(http2_session_manager_t *mgr) {
     if (!mgr) return;
 
-    /* Stop I/O thread if running */
-    if (mgr->io_thread_running) {
-        http2_session_manager_stop(mgr);
-    }
+    /* Stop reactor callbacks before anything is freed */
+    http2_session_manager_stop(mgr);
 
     /* Clean up pending streams */
     http2_pending_stream_t *curr = mgr->pending_streams;
@@ -206,42 +295,69 @@ void http2_session_manager_destroy(http2_session_manager_t *mgr) {
     }
 
     /* Note: We don't destroy session/callbacks here as they may be owned by pooled_connection */
+    free(mgr->session_data);
 
     pthread_mutex_destroy(&mgr->mutex);
     free(mgr);
 }
 
 /**
- * Start the I/O thread
+ * Hand the connection to the shared reactor
  */
 int http2_session_manager_start(http2_session_manager_t *mgr) {
-    if (!mgr || mgr->io_thread_running) {
+    if (!mgr || mgr->reactor) {
         return -1;
     }
 
-    int rv = pthread_create(&mgr->io_thread, NULL, http2_io_thread_main, mgr);
-    if (rv != 0) {
-        return -1;
-    }
+    /* nghttp2 retries blocked writes from its own buffers */
+    SSL_set_mode(mgr->ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 
-    mgr->io_thread_running = true;
-    return 0;
+    mgr->reactor = http2_reactor_attach(mgr->sockfd, http2_session_ready, mgr);
+    return mgr->reactor ? 0 : -1;
 }
 
 /**
- * Stop the I/O thread
+ * Take the connection back from the reactor
  */
 void http2_session_manager_stop(http2_session_manager_t *mgr) {
-    if (!mgr || !mgr->io_thread_running) {
+    if (!mgr || !mgr->reactor) {
         return;
     }
 
-    mgr->shutdown_requested = true;
+    http2_reactor_detach(mgr->reactor);
+    mgr->reactor = NULL;
 
-    /* Wait for thread to finish */
-    pthread_join(mgr->io_thread, NULL);
+    pthread_mutex_lock(&mgr->mutex);
+    fail_session(mgr);
+    pthread_mutex_unlock(&mgr->mutex);
+}
 
-    mgr->io_thread_running = false;
+/**
+ * Check whether the connection can take new streams
+ */
+bool http2_session_manager_is_usable(http2_session_manager_t *mgr) {
+    if (!mgr) {
+        return false;
+    }
+
+    pthread_mutex_lock(&mgr->mutex);
+    bool usable = mgr->reactor && !mgr->closed;
+    pthread_mutex_unlock(&mgr->mutex);
+    return usable;
+}
+
+/**
+ * Check whether new requests should open another connection
+ */
+bool http2_session_manager_is_saturated(http2_session_manager_t *mgr) {
+    if (!mgr) {
+        return false;
+    }
+
+    pthread_mutex_lock(&mgr->mutex);
+    bool saturated = mgr->queued_stream_count >= HTTP2_SESSION_QUEUE_SPILL;
+    pthread_mutex_unlock(&mgr->mutex);
+    return saturated;
 }
 
 /**
@@ -254,6 +370,8 @@ int http2_session_manager_submit_stream(
     const nghttp2_nv *hdrs,
     size_t hdr_count,
     nghttp2_data_provider *data_prd,
+    http2_stream_complete_cb_t on_complete,
+    void *on_complete_ctx,
     int32_t *stream_id_out
 ) {
     if (!mgr || !stream_data || !hdrs) {
@@ -262,33 +380,44 @@ int http2_session_manager_submit_stream(
 
     pthread_mutex_lock(&mgr->mutex);
 
-    /* Submit stream to nghttp2 with priority spec */
-    int32_t stream_id = nghttp2_submit_request(
-        mgr->session,
-        pri_spec,  /* Priority spec (NULL for default) */
-        hdrs,
-        hdr_count,
-        data_prd,
-        stream_data  /* User data for callbacks */
-    );
-
-    if (stream_id < 0) {
+    if (mgr->closed || !mgr->reactor) {
         pthread_mutex_unlock(&mgr->mutex);
         return -1;
     }
 
     /* Create pending stream tracker */
-    http2_pending_stream_t *pending = create_pending_stream(stream_id, stream_data);
+    http2_pending_stream_t *pending = create_pending_stream(stream_data, pri_spec, hdrs, hdr_count,
+                                                            data_prd, on_complete, on_complete_ctx);
     if (!pending) {
         pthread_mutex_unlock(&mgr->mutex);
         return -1;
     }
 
+    /* Open it now if the peer allows and nothing is waiting ahead of it */
+    if (mgr->queued_stream_count == 0 && session_has_room(mgr)) {
+        if (open_pending_stream(mgr, pending) != 0) {
+            destroy_pending_stream(pending);
+            pthread_mutex_unlock(&mgr->mutex);
+            return -1;
+        }
+    } else {
+        pending->queued = true;
+        pending->queue_seq = mgr->next_queue_seq++;
+        mgr->queued_stream_count++;
+        mgr->total_streams_queued++;
+    }
+
     /* Add to tracking list */
     add_pending_stream(mgr, pending);
-    mgr->total_streams_submitted++;
 
-    *stream_id_out = stream_id;
+    *stream_id_out = pending->stream_id;
+
+    /* Write the request now rather than waking the reactor for it */
+    if (nghttp2_session_send(mgr->session) != 0) {
+        fail_session(mgr);
+    } else {
+        rearm_session(mgr);
+    }
 
     pthread_mutex_unlock(&mgr->mutex);
 
@@ -296,87 +425,57 @@ int http2_session_manager_submit_stream(
 }
 
 /**
- * Wait for a stream to complete
+ * Remove a stream from tracking
  */
-int http2_session_manager_wait_for_stream(
+void http2_session_manager_remove_stream(
     http2_session_manager_t *mgr,
-    int32_t stream_id,
-    uint32_t timeout_ms
+    void *stream_data
 ) {
-    if (!mgr) {
-        return -1;
-    }
+    if (!mgr || !stream_data) return;
 
-    /* Find pending stream */
     pthread_mutex_lock(&mgr->mutex);
-    http2_pending_stream_t *pending = http2_session_manager_find_stream(mgr, stream_id);
-    pthread_mutex_unlock(&mgr->mutex);
 
+    /* Find and remove from list */
+    http2_pending_stream_t **curr = &mgr->pending_streams;
+    while (*curr && (*curr)->stream_data != stream_data) {
+        curr = &(*curr)->next;
+    }
+    http2_pending_stream_t *pending = *curr;
     if (!pending) {
-        return -1;  /* Stream not found */
+        pthread_mutex_unlock(&mgr->mutex);
+        return;
     }
-
-    /* Wait for completion with timeout */
-    pthread_mutex_lock(&pending->stream_mutex);
-
-    if (!pending->completed) {
-        struct timespec timeout;
-        clock_gettime(CLOCK_REALTIME, &timeout);
-        timeout.tv_sec += timeout_ms / 1000;
-        timeout.tv_nsec += (timeout_ms % 1000) * 1000000;
-
-        /* Handle nanosecond overflow */
-        if (timeout.tv_nsec >= 1000000000) {
-            timeout.tv_sec += 1;
-            timeout.tv_nsec -= 1000000000;
-        }
-
-        while (!pending->completed) {
-            int rv = pthread_cond_timedwait(
-                &pending->stream_complete,
-                &pending->stream_mutex,
-                &timeout
-            );
-
-            if (rv == ETIMEDOUT) {
-                pthread_mutex_unlock(&pending->stream_mutex);
-                return -1;  /* Timeout */
-            } else if (rv != 0 && rv != EINTR) {
-                pthread_mutex_unlock(&pending->stream_mutex);
-                return -1;  /* Error */
+    *curr = pending->next;
+    mgr->active_stream_count--;
+
+    bool flush = false;
+    if (!pending->completed && pending->queued) {
+        /* Never opened: nothing to tell the peer */
+        mgr->queued_stream_count--;
+    } else if (!pending->completed) {
+        /* Abandoned early (timeout): detach the caller's data and reset the stream */
+        int32_t stream_id = pending->stream_id;
+        mgr->open_stream_count--;
+        if (nghttp2_session_get_stream_user_data(mgr->session, stream_id)) {
+            nghttp2_session_set_stream_user_data(mgr->session, stream_id, NULL);
+            if (!mgr->closed) {
+                nghttp2_submit_rst_stream(mgr->session, NGHTTP2_FLAG_NONE, stream_id, NGHTTP2_CANCEL);
+                flush = true;
             }
         }
     }
+    destroy_pending_stream(pending);
 
-    int result = pending->has_error ? -1 : 0;
-
-    pthread_mutex_unlock(&pending->stream_mutex);
-
-    return result;
-}
-
-/**
- * Remove a completed stream from tracking
- */
-void http2_session_manager_remove_stream(
-    http2_session_manager_t *mgr,
-    int32_t stream_id
-) {
-    if (!mgr) return;
-
-    pthread_mutex_lock(&mgr->mutex);
-
-    /* Find and remove from list */
-    http2_pending_stream_t **curr = &mgr->pending_streams;
-    while (*curr) {
-        if ((*curr)->stream_id == stream_id) {
-            http2_pending_stream_t *to_remove = *curr;
-            *curr = to_remove->next;
-            mgr->active_stream_count--;
-            destroy_pending_stream(to_remove);
-            break;
+    /* A freed slot goes to the next queued stream */
+    if (dispatch_queued_streams(mgr) > 0) {
+        flush = true;
+    }
+    if (flush) {
+        if (nghttp2_session_send(mgr->session) != 0) {
+            fail_session(mgr);
+        } else {
+            rearm_session(mgr);
         }
-        curr = &(*curr)->next;
     }
 
     pthread_mutex_unlock(&mgr->mutex);
@@ -392,21 +491,11 @@ void http2_session_manager_mark_stream_complete(
 ) {
     if (!mgr) return;
 
-    pthread_mutex_lock(&mgr->mutex);
-
+    /* mgr->mutex is held: this runs inside nghttp2_session_recv() */
     http2_pending_stream_t *pending = http2_session_manager_find_stream(mgr, stream_id);
-
     if (pending) {
-        pthread_mutex_lock(&pending->stream_mutex);
-        pending->completed = true;
-        pending->has_error = has_error;
-        pthread_cond_signal(&pending->stream_complete);
-        pthread_mutex_unlock(&pending->stream_mutex);
-
-        mgr->total_streams_completed++;
+        complete_pending_stream(mgr, pending, has_error);
     }
-
-    pthread_mutex_unlock(&mgr->mutex);
 }
 
 #endif /* HAVE_NGHTTP2 */
@@ -3,6 +3,19 @@
  *
  * Manages concurrent HTTP/2 streams on a single session.
  * Allows multiple threads to submit requests and share one HTTP/2 connection.
+ * The connection is driven by the shared HTTP/2 reactor (http2_reactor.h);
+ * each stream's completion callback runs on the reactor thread.
+ *
+ * No more streams are opened than the peer's SETTINGS_MAX_CONCURRENT_STREAMS
+ * allows; the rest wait in a queue and are opened as streams finish, the
+ * highest priority weight first (submission order among equals). Once the
+ * queue reaches HTTP2_SESSION_QUEUE_SPILL streams the session counts as
+ * saturated and new requests should go to another connection.
+ *
+ * The connection pool hands each HTTP/2 connection to one request at a
+ * time, so a pooled session never queues streams and the pool never
+ * spills. Queueing and saturation apply only to callers that share a
+ * manager directly.
  */
 
 #ifndef HTTPMORPH_HTTP2_SESSION_MANAGER_H
@@ -17,22 +30,46 @@
 #endif
 #include <nghttp2/nghttp2.h>
 #include <openssl/ssl.h>
+#include "http2_reactor.h"
+
+/* Queued streams at which a session is saturated (see is_saturated) */
+#define HTTP2_SESSION_QUEUE_SPILL 4
 
 /* Forward declarations */
 typedef struct http2_session_manager http2_session_manager_t;
 typedef struct http2_pending_stream http2_pending_stream_t;
 
+/**
+ * Stream completion callback
+ * Runs on the reactor thread with the manager locked: it must not call
+ * back into the session manager.
+ *
+ * @param ctx Context passed to http2_session_manager_submit_stream()
+ * @param stream_id Stream that finished
+ * @param has_error Whether the stream (or the connection) failed
+ */
+typedef void (*http2_stream_complete_cb_t)(void *ctx, int32_t stream_id, bool has_error);
+
 /**
  * Pending stream structure
  * Tracks a single stream until completion
  */
 struct http2_pending_stream {
-    int32_t stream_id;
+    int32_t stream_id;            /* 0 while queued */
     void *stream_data;            /* http2_stream_data_t* - avoid circular dependency */
 
-    /* Synchronization for this specific stream */
-    pthread_mutex_t stream_mutex;
-    pthread_cond_t stream_complete;
+    /* Request held back until the peer allows another stream (queued only) */
+    bool queued;
+    const nghttp2_nv *hdrs;       /* Caller's headers */
+    size_t hdr_count;
+    nghttp2_data_provider *data_prd;
+    nghttp2_priority_spec pri_spec;
+    bool has_pri_spec;
+    uint64_t queue_seq;           /* Submission order, breaks weight ties */
+
+    /* Completion notification */
+    http2_stream_complete_cb_t on_complete;
+    void *on_complete_ctx;
     bool completed;
     bool has_error;
 
@@ -52,20 +89,24 @@ struct http2_session_manager {
     /* Connection */
     SSL *ssl;
     int sockfd;
+    void *session_data;              /* Session user data for send/recv (owned) */
 
-    /* I/O thread management */
-    pthread_t io_thread;
+    /* Reactor registration */
+    http2_reactor_handle_t *reactor;
     pthread_mutex_t mutex;           /* Protects session and stream list */
-    bool io_thread_running;
-    bool shutdown_requested;
+    bool closed;                     /* Connection failed or was closed by the peer */
 
     /* Stream tracking */
     http2_pending_stream_t *pending_streams;
-    int active_stream_count;
+    int active_stream_count;         /* Tracked streams (open, queued or done) */
+    int open_stream_count;           /* Submitted to nghttp2 and not yet done */
+    int queued_stream_count;         /* Waiting for the peer's stream limit */
+    uint64_t next_queue_seq;
 
     /* Statistics */
     uint64_t total_streams_submitted;
     uint64_t total_streams_completed;
+    uint64_t total_streams_queued;   /* Streams that had to wait in the queue */
 };
 
 /* === Session Manager Lifecycle === */
@@ -77,26 +118,28 @@ struct http2_session_manager {
  * @param callbacks nghttp2 callbacks (takes ownership)
  * @param ssl SSL connection
  * @param sockfd Socket file descriptor
+ * @param session_data Session user data for the send/recv callbacks (takes ownership, may be NULL)
  * @return New session manager or NULL on error
  */
 http2_session_manager_t* http2_session_manager_create(
     nghttp2_session *session,
     nghttp2_session_callbacks *callbacks,
     SSL *ssl,
-    int sockfd
+    int sockfd,
+    void *session_data
 );
 
 /**
  * Destroy a session manager
- * Stops I/O thread, cleans up resources
+ * Detaches from the reactor, fails streams still pending, cleans up resources
  *
  * @param mgr Session manager to destroy
  */
 void http2_session_manager_destroy(http2_session_manager_t *mgr);
 
 /**
- * Start the I/O thread
- * Must be called before submitting streams
+ * Hand the connection to the shared reactor
+ * Must be called before submitting streams; the socket becomes non-blocking
  *
  * @param mgr Session manager
  * @return 0 on success, -1 on error
@@ -104,18 +147,39 @@ void http2_session_manager_destroy(http2_session_manager_t *mgr);
 int http2_session_manager_start(http2_session_manager_t *mgr);
 
 /**
- * Stop the I/O thread
- * Waits for thread to finish
+ * Take the connection back from the reactor
+ * Once this returns the reactor no longer touches the session
  *
  * @param mgr Session manager
  */
 void http2_session_manager_stop(http2_session_manager_t *mgr);
 
+/**
+ * Check whether the connection can take new streams
+ *
+ * @param mgr Session manager
+ * @return true while the connection is up
+ */
+bool http2_session_manager_is_usable(http2_session_manager_t *mgr);
+
+/**
+ * Check whether enough streams are queued that new requests should open
+ * another connection instead
+ *
+ * @param mgr Session manager
+ * @return true once HTTP2_SESSION_QUEUE_SPILL streams are queued
+ */
+bool http2_session_manager_is_saturated(http2_session_manager_t *mgr);
+
 /* === Stream Operations === */
 
 /**
  * Submit a new HTTP/2 stream
- * Non-blocking operation that queues the stream
+ * Non-blocking: the request is written from the calling thread as far as
+ * the socket allows, the reactor sends the rest and reads the response.
+ * At the peer's stream limit the stream is queued instead and opened when
+ * one finishes; hdrs and data_prd must then stay valid until the stream is
+ * removed.
  *
  * @param mgr Session manager
  * @param stream_data Stream-specific data (takes ownership) - void* to http2_stream_data_t*
@@ -123,7 +187,9 @@ void http2_session_manager_stop(http2_session_manager_t *mgr);
  * @param hdrs Request headers
  * @param hdr_count Number of headers
  * @param data_prd Data provider for request body (can be NULL)
- * @param stream_id_out Output parameter for assigned stream ID
+ * @param on_complete Completion callback (runs on the reactor thread)
+ * @param on_complete_ctx Callback context
+ * @param stream_id_out Output parameter for assigned stream ID (0 if queued)
  * @return 0 on success, -1 on error
  */
 int http2_session_manager_submit_stream(
@@ -133,41 +199,29 @@ int http2_session_manager_submit_stream(
     const nghttp2_nv *hdrs,
     size_t hdr_count,
     nghttp2_data_provider *data_prd,
+    http2_stream_complete_cb_t on_complete,
+    void *on_complete_ctx,
     int32_t *stream_id_out
 );
 
 /**
- * Wait for a stream to complete
- * Blocking operation with timeout
+ * Remove a stream from tracking
+ * A stream that hasn't completed is reset (or dropped from the queue);
+ * afterwards no callback touches its stream data, so the caller may free it.
  *
  * @param mgr Session manager
- * @param stream_id Stream ID to wait for
- * @param timeout_ms Timeout in milliseconds
- * @return 0 on success, -1 on timeout or error
- */
-int http2_session_manager_wait_for_stream(
-    http2_session_manager_t *mgr,
-    int32_t stream_id,
-    uint32_t timeout_ms
-);
-
-/**
- * Remove a completed stream from tracking
- * Frees resources associated with the stream
- *
- * @param mgr Session manager
- * @param stream_id Stream ID to remove
+ * @param stream_data Stream data the stream was submitted with
  */
 void http2_session_manager_remove_stream(
     http2_session_manager_t *mgr,
-    int32_t stream_id
+    void *stream_data
 );
 
 /* === Internal Helpers (used by callbacks) === */
 
 /**
  * Mark a stream as completed
- * Called by nghttp2 callbacks when stream finishes
+ * Called by nghttp2 callbacks when stream finishes (mgr->mutex is held)
  *
  * @param mgr Session manager
  * @param stream_id Stream ID that completed
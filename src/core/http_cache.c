@@ -0,0 +1,1157 @@
+/**
+ * http_cache.c - In-process HTTP response cache (RFC 9111)
+ *
+ * Hash table of stored responses keyed by URL, with an LRU list for
+ * eviction. Variants of one URL (Vary) are separate entries in the same
+ * bucket. Each entry is one allocation holding its URL, headers and Vary
+ * values; bodies are reference counted separately so a freshened entry
+ * and responses still in use can share them.
+ */
+
+#include "internal/response.h"
+#include "internal/util.h"
+#include "http_cache.h"
+
+#ifdef _WIN32
+    #define CACHE_INC(p) InterlockedIncrementSizeT((volatile SIZE_T*)(p))
+    #define CACHE_DEC(p) InterlockedDecrementSizeT((volatile SIZE_T*)(p))
+    #define CACHE_NEXT_ID(p) ((uint64_t)InterlockedIncrement64((volatile LONG64*)(p)))
+#else
+    #include <sys/mman.h>
+    #define CACHE_INC(p) __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define CACHE_DEC(p) __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define CACHE_NEXT_ID(p) __atomic_add_fetch((p), 1, __ATOMIC_RELAXED)
+#endif
+
+/* Stored body, shared by entries and the responses serving it */
+typedef struct http_cache_body {
+    size_t refs;
+    uint8_t *data;
+    size_t len;
+    bool mapped;            /* data is a read-only mapping of an unlinked file */
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} http_cache_body_t;
+
+/* Stored response */
+struct http_cache_entry {
+    char *url;
+    uint32_t hash;
+    uint64_t id;
+
+    uint16_t status_code;
+    httpmorph_version_t http_version;
+    httpmorph_header_t *headers;
+    size_t header_count;
+    httpmorph_header_t *vary;    /* Request header values it was selected by (value NULL = absent) */
+    size_t vary_count;
+    http_cache_body_t *body;
+
+    /* Freshness (seconds) */
+    int64_t response_time;
+    int64_t corrected_initial_age;
+    int64_t lifetime;
+    bool no_cache;               /* Revalidate before every use */
+    bool must_revalidate;        /* Never serve stale */
+    const char *etag;            /* Validators (point into headers) */
+    const char *last_modified;
+
+    size_t memory_charge;
+    size_t disk_charge;
+    size_t refs;                 /* Table plus lookups in flight (under the cache lock) */
+    bool in_table;
+
+    struct http_cache_entry *hash_next;
+    struct http_cache_entry *lru_prev;   /* Towards most recently used */
+    struct http_cache_entry *lru_next;   /* Towards least recently used */
+};
+
+/* Cache structure */
+struct httpmorph_cache {
+    http_cache_entry_t *buckets[HTTP_CACHE_BUCKETS];
+    http_cache_entry_t *lru_head;
+    http_cache_entry_t *lru_tail;
+
+    size_t max_memory;
+    size_t max_disk;
+    size_t spill_threshold;
+    char *spill_dir;
+    uint64_t spill_seq;
+
+    httpmorph_cache_stats_t stats;
+    size_t refs;                 /* Creator plus attached clients */
+
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+};
+
+#ifndef _WIN32
+#define CACHE_LOCK(c)   pthread_mutex_lock(&(c)->mutex)
+#define CACHE_UNLOCK(c) pthread_mutex_unlock(&(c)->mutex)
+#else
+#define CACHE_LOCK(c)   EnterCriticalSection(&(c)->mutex)
+#define CACHE_UNLOCK(c) LeaveCriticalSection(&(c)->mutex)
+#endif
+
+/* Entry ids are process-wide so responses from different caches never collide */
+static uint64_t entry_ids = 0;
+
+/* Cache-Control directives the cache acts on */
+typedef struct {
+    bool no_store;
+    bool no_cache;
+    bool must_revalidate;
+    bool only_if_cached;
+    bool is_private;        /* For one user only: a shared cache mustn't store it */
+    int64_t max_age;        /* -1 when absent */
+    int64_t s_maxage;       /* -1 when absent */
+    int64_t min_fresh;      /* -1 when absent */
+    int64_t max_stale;      /* -1 when absent, INT64_MAX without a value */
+} cache_control_t;
+
+/* Headers that describe the connection rather than the response */
+static const char *const unstored_headers[] = {
+    "Connection", "Keep-Alive", "Proxy-Connection", "Transfer-Encoding", "Upgrade",
+    "TE", "Trailer", "Proxy-Authenticate", "Proxy-Authorization",
+    "Age",          /* Regenerated on every hit */
+    "Set-Cookie",   /* The cache is shared across sessions and their cookie jars */
+};
+
+/* Headers a 304 must not overwrite */
+static const char *const unfreshened_headers[] = {
+    "Content-Length", "Content-Encoding", "Content-Range",
+};
+
+static bool name_in(const char *name, const char *const *list, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (strcasecmp(name, list[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t url_hash(const char *url) {
+    uint32_t hash = 2166136261u;
+    for (const char *p = url; *p; p++) {
+        hash = (hash ^ (uint8_t)*p) * 16777619u;
+    }
+    return hash;
+}
+
+static int64_t now_seconds(void) {
+    return (int64_t)time(NULL);
+}
+
+/* ==================================================================
+ * HEADER PARSING
+ * ================================================================== */
+
+/* Helper: delta-seconds, saturating at 2^31 as RFC 9111 section 1.2.2 asks */
+static int64_t parse_delta(const char *s, size_t len) {
+    if (len == 0) {
+        return -1;
+    }
+    int64_t value = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (s[i] < '0' || s[i] > '9') {
+            return -1;
+        }
+        if (value < 2147483648LL) {
+            value = value * 10 + (s[i] - '0');
+        }
+    }
+    return value > 2147483648LL ? 2147483648LL : value;
+}
+
+/**
+ * Add the directives in one Cache-Control value
+ */
+static void cache_control_parse(cache_control_t *cc, const char *value) {
+    const char *p = value;
+    while (*p) {
+        while (*p == ' ' || *p == '\t' || *p == ',') {
+            p++;
+        }
+        const char *name = p;
+        while (*p && *p != '=' && *p != ',' && *p != ' ' && *p != '\t') {
+            p++;
+        }
+        size_t name_len = (size_t)(p - name);
+        while (*p == ' ' || *p == '\t') {
+            p++;
+        }
+
+        const char *arg = NULL;
+        size_t arg_len = 0;
+        if (*p == '=') {
+            p++;
+            if (*p == '"') {
+                arg = ++p;
+                while (*p && *p != '"') {
+                    p++;
+                }
+                arg_len = (size_t)(p - arg);
+                if (*p == '"') {
+                    p++;
+                }
+            } else {
+                arg = p;
+                while (*p && *p != ',' && *p != ' ' && *p != '\t') {
+                    p++;
+                }
+                arg_len = (size_t)(p - arg);
+            }
+        }
+        while (*p && *p != ',') {
+            p++;
+        }
+
+#define DIRECTIVE(str) (name_len == sizeof(str) - 1 && strncasecmp(name, str, name_len) == 0)
+        if (DIRECTIVE("no-store")) {
+            cc->no_store = true;
+        } else if (DIRECTIVE("no-cache")) {
+            /* The qualified form (no-cache="field") is treated as unqualified */
+            cc->no_cache = true;
+        } else if (DIRECTIVE("must-revalidate") || DIRECTIVE("proxy-revalidate")) {
+            cc->must_revalidate = true;
+        } else if (DIRECTIVE("only-if-cached")) {
+            cc->only_if_cached = true;
+        } else if (DIRECTIVE("private")) {
+            /* The qualified form (private="field") is treated as unqualified */
+            cc->is_private = true;
+        } else if (DIRECTIVE("max-age") || DIRECTIVE("s-maxage")) {
+            int64_t *age = DIRECTIVE("max-age") ? &cc->max_age : &cc->s_maxage;
+            int64_t v = parse_delta(arg, arg_len);
+            if (v >= 0 && (*age < 0 || v < *age)) {
+                *age = v;
+            } else if (v < 0) {
+                *age = 0;           /* Invalid values count as stale */
+            }
+        } else if (DIRECTIVE("min-fresh")) {
+            cc->min_fresh = parse_delta(arg, arg_len);
+        } else if (DIRECTIVE("max-stale")) {
+            cc->max_stale = arg ? parse_delta(arg, arg_len) : INT64_MAX;
+        }
+#undef DIRECTIVE
+    }
+}
+
+static void cache_control_init(cache_control_t *cc) {
+    memset(cc, 0, sizeof(*cc));
+    cc->max_age = -1;
+    cc->s_maxage = -1;
+    cc->min_fresh = -1;
+    cc->max_stale = -1;
+}
+
+/**
+ * Combined value of a request header (", "-joined if repeated)
+ * Returns a new string, or NULL if the request doesn't have it.
+ */
+static char* request_header_joined(const httpmorph_request_t *request, const char *name) {
+    size_t total = 0, found = 0;
+    for (size_t i = 0; i < request->header_count; i++) {
+        if (strcasecmp(request->headers[i].key, name) == 0) {
+            total += strlen(request->headers[i].value) + (found ? 2 : 0);
+            found++;
+        }
+    }
+    if (found == 0) {
+        return NULL;
+    }
+
+    char *joined = malloc(total + 1);
+    if (!joined) {
+        return NULL;
+    }
+    char *out = joined;
+    for (size_t i = 0; i < request->header_count; i++) {
+        if (strcasecmp(request->headers[i].key, name) == 0) {
+            if (out != joined) {
+                memcpy(out, ", ", 2);
+                out += 2;
+            }
+            size_t len = strlen(request->headers[i].value);
+            memcpy(out, request->headers[i].value, len);
+            out += len;
+        }
+    }
+    *out = '\0';
+    return joined;
+}
+
+static bool request_has_header(const httpmorph_request_t *request, const char *name) {
+    for (size_t i = 0; i < request->header_count; i++) {
+        if (strcasecmp(request->headers[i].key, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void request_cache_control(const httpmorph_request_t *request, cache_control_t *cc) {
+    cache_control_init(cc);
+    bool has_cache_control = false;
+    bool pragma_no_cache = false;
+    for (size_t i = 0; i < request->header_count; i++) {
+        if (strcasecmp(request->headers[i].key, "Cache-Control") == 0) {
+            cache_control_parse(cc, request->headers[i].value);
+            has_cache_control = true;
+        } else if (strcasecmp(request->headers[i].key, "Pragma") == 0 &&
+                   strstr(request->headers[i].value, "no-cache")) {
+            pragma_no_cache = true;
+        }
+    }
+    /* Pragma only counts without Cache-Control (RFC 9111 section 5.4) */
+    if (pragma_no_cache && !has_cache_control) {
+        cc->no_cache = true;
+    }
+}
+
+static const char* entry_header(const http_cache_entry_t *entry, const char *name) {
+    for (size_t i = 0; i < entry->header_count; i++) {
+        if (strcasecmp(entry->headers[i].key, name) == 0) {
+            return entry->headers[i].value;
+        }
+    }
+    return NULL;
+}
+
+/* Statuses that may be cached heuristically (RFC 9110 section 15.1) */
+static bool heuristically_cacheable(uint16_t status) {
+    switch (status) {
+        case 200: case 203: case 204: case 300: case 301: case 308:
+        case 404: case 405: case 410: case 414: case 501:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Work out an entry's freshness from its headers (RFC 9111 section 4.2)
+ *
+ * @return Whether the response states its freshness explicitly
+ */
+static bool entry_compute_freshness(http_cache_entry_t *entry, int64_t request_time,
+                                    int64_t response_time) {
+    cache_control_t cc;
+    cache_control_init(&cc);
+    for (size_t i = 0; i < entry->header_count; i++) {
+        if (strcasecmp(entry->headers[i].key, "Cache-Control") == 0) {
+            cache_control_parse(&cc, entry->headers[i].value);
+        }
+    }
+    entry->no_cache = cc.no_cache;
+    entry->must_revalidate = cc.must_revalidate || cc.s_maxage >= 0;  /* s-maxage implies proxy-revalidate */
+    entry->etag = entry_header(entry, "ETag");
+    entry->last_modified = entry_header(entry, "Last-Modified");
+
+    const char *date_str = entry_header(entry, "Date");
+    int64_t date = date_str ? httpmorph_parse_http_date(date_str, strlen(date_str)) : -1;
+    if (date < 0) {
+        date = response_time;
+    }
+
+    bool explicit_freshness = true;
+    const char *expires = entry_header(entry, "Expires");
+    if (cc.s_maxage >= 0) {
+        entry->lifetime = cc.s_maxage;  /* Shared caches go by s-maxage first */
+    } else if (cc.max_age >= 0) {
+        entry->lifetime = cc.max_age;
+    } else if (expires) {
+        /* An invalid Expires means already expired */
+        int64_t t = httpmorph_parse_http_date(expires, strlen(expires));
+        entry->lifetime = t > date ? t - date : 0;
+    } else {
+        explicit_freshness = false;
+        entry->lifetime = 0;
+        int64_t lm = entry->last_modified
+            ? httpmorph_parse_http_date(entry->last_modified, strlen(entry->last_modified)) : -1;
+        if (lm >= 0 && lm < date && heuristically_cacheable(entry->status_code)) {
+            entry->lifetime = (date - lm) / 10;
+            if (entry->lifetime > HTTP_CACHE_MAX_HEURISTIC) {
+                entry->lifetime = HTTP_CACHE_MAX_HEURISTIC;
+            }
+        }
+    }
+
+    const char *age_str = entry_header(entry, "Age");
+    int64_t age_value = age_str ? parse_delta(age_str, strlen(age_str)) : 0;
+    if (age_value < 0) {
+        age_value = 0;
+    }
+    int64_t apparent_age = response_time > date ? response_time - date : 0;
+    int64_t response_delay = response_time > request_time ? response_time - request_time : 0;
+    int64_t corrected_age = age_value + response_delay;
+    entry->corrected_initial_age = apparent_age > corrected_age ? apparent_age : corrected_age;
+    entry->response_time = response_time;
+
+    return explicit_freshness;
+}
+
+static int64_t entry_current_age(const http_cache_entry_t *entry, int64_t now) {
+    int64_t resident = now > entry->response_time ? now - entry->response_time : 0;
+    return entry->corrected_initial_age + resident;
+}
+
+/* ==================================================================
+ * BODIES
+ * ================================================================== */
+
+static void body_release(void *owner) {
+    http_cache_body_t *body = owner;
+    if (!body || CACHE_DEC(&body->refs) != 0) {
+        return;
+    }
+    if (body->mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(body->data);
+        CloseHandle(body->mapping);
+        CloseHandle(body->file);    /* Deletes it (FILE_FLAG_DELETE_ON_CLOSE) */
+#else
+        munmap(body->data, body->len);
+#endif
+    } else {
+        free(body->data);
+    }
+    free(body);
+}
+
+/**
+ * Write a body to an unlinked file in the spill directory and map it
+ */
+static bool body_spill(http_cache_body_t *body, const char *dir, uint64_t seq,
+                       const uint8_t *data, size_t len) {
+    char path[4096];
+#ifdef _WIN32
+    snprintf(path, sizeof(path), "%s\\httpmorph-cache-%lu-%llu.body", dir,
+             (unsigned long)GetCurrentProcessId(), (unsigned long long)seq);
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_NEW,
+                              FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    size_t written = 0;
+    while (written < len) {
+        DWORD chunk = (DWORD)((len - written) > 0x40000000 ? 0x40000000 : (len - written));
+        DWORD n = 0;
+        if (!WriteFile(file, data + written, chunk, &n, NULL) || n == 0) {
+            CloseHandle(file);
+            return false;
+        }
+        written += n;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void *map = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, len) : NULL;
+    if (!map) {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    body->file = file;
+    body->mapping = mapping;
+#else
+    snprintf(path, sizeof(path), "%s/httpmorph-cache-%ld-%llu.body", dir,
+             (long)getpid(), (unsigned long long)seq);
+    int fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    /* The mapping keeps the data; the name is never needed again */
+    unlink(path);
+
+    size_t written = 0;
+    while (written < len) {
+        ssize_t n = write(fd, data + written, len - written);
+        if (n <= 0) {
+            close(fd);
+            return false;
+        }
+        written += (size_t)n;
+    }
+    void *map = mmap(NULL, len, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return false;
+    }
+#endif
+    body->data = map;
+    body->mapped = true;
+    return true;
+}
+
+/**
+ * Copy a response body into the cache (spilled when large enough)
+ */
+static http_cache_body_t* body_create(httpmorph_cache_t *cache, const uint8_t *data, size_t len) {
+    http_cache_body_t *body = calloc(1, sizeof(http_cache_body_t));
+    if (!body) {
+        return NULL;
+    }
+    body->refs = 1;
+    body->len = len;
+    if (len == 0) {
+        return body;
+    }
+
+    if (cache->spill_dir && len >= cache->spill_threshold) {
+        CACHE_LOCK(cache);
+        uint64_t seq = ++cache->spill_seq;
+        CACHE_UNLOCK(cache);
+        if (body_spill(body, cache->spill_dir, seq, data, len)) {
+            return body;
+        }
+        /* Fall back to memory */
+    }
+
+    body->data = malloc(len);
+    if (!body->data) {
+        free(body);
+        return NULL;
+    }
+    memcpy(body->data, data, len);
+    return body;
+}
+
+/* ==================================================================
+ * ENTRIES
+ * ================================================================== */
+
+/**
+ * Build an entry in one allocation
+ *
+ * @param headers Headers to store (unstored ones are skipped)
+ * @param vary Vary names and the request's values for them
+ * @param body Body (the entry takes a reference)
+ */
+static http_cache_entry_t* entry_create(const char *url, uint16_t status, httpmorph_version_t version,
+                                        const httpmorph_header_t *headers, size_t header_count,
+                                        const httpmorph_header_t *vary, size_t vary_count,
+                                        http_cache_body_t *body) {
+    size_t stored = 0;
+    size_t strings = strlen(url) + 1;
+    for (size_t i = 0; i < header_count; i++) {
+        if (headers[i].key &&
+            !name_in(headers[i].key, unstored_headers,
+                     sizeof(unstored_headers) / sizeof(unstored_headers[0]))) {
+            strings += strlen(headers[i].key) + strlen(headers[i].value) + 2;
+            stored++;
+        }
+    }
+    for (size_t i = 0; i < vary_count; i++) {
+        strings += strlen(vary[i].key) + 1 + (vary[i].value ? strlen(vary[i].value) + 1 : 0);
+    }
+
+    size_t size = sizeof(http_cache_entry_t) + (stored + vary_count) * sizeof(httpmorph_header_t) +
+                  strings;
+    http_cache_entry_t *entry = calloc(1, size);
+    if (!entry) {
+        return NULL;
+    }
+    entry->headers = (httpmorph_header_t *)(entry + 1);
+    entry->vary = entry->headers + stored;
+    char *out = (char *)(entry->vary + vary_count);
+
+#define ENTRY_COPY(dst, src) do { \
+        size_t len_ = strlen(src) + 1; \
+        memcpy(out, (src), len_); \
+        (dst) = out; \
+        out += len_; \
+    } while (0)
+
+    ENTRY_COPY(entry->url, url);
+    for (size_t i = 0; i < header_count; i++) {
+        if (headers[i].key &&
+            !name_in(headers[i].key, unstored_headers,
+                     sizeof(unstored_headers) / sizeof(unstored_headers[0]))) {
+            httpmorph_header_t *h = &entry->headers[entry->header_count++];
+            ENTRY_COPY(h->key, headers[i].key);
+            ENTRY_COPY(h->value, headers[i].value);
+        }
+    }
+    for (size_t i = 0; i < vary_count; i++) {
+        httpmorph_header_t *v = &entry->vary[entry->vary_count++];
+        ENTRY_COPY(v->key, vary[i].key);
+        if (vary[i].value) {
+            ENTRY_COPY(v->value, vary[i].value);
+        }
+    }
+#undef ENTRY_COPY
+
+    entry->hash = url_hash(url);
+    entry->id = CACHE_NEXT_ID(&entry_ids);
+    entry->status_code = status;
+    entry->http_version = version;
+    entry->body = body;
+    CACHE_INC(&body->refs);
+    entry->memory_charge = size + (body->mapped ? 0 : body->len);
+    entry->disk_charge = body->mapped ? body->len : 0;
+    entry->refs = 1;
+    return entry;
+}
+
+static void entry_free(http_cache_entry_t *entry) {
+    body_release(entry->body);
+    free(entry);
+}
+
+/**
+ * Whether a request selects an entry's variant
+ */
+static bool entry_matches(const http_cache_entry_t *entry, const httpmorph_request_t *request) {
+    for (size_t i = 0; i < entry->vary_count; i++) {
+        char *value = request_header_joined(request, entry->vary[i].key);
+        bool same = value ? entry->vary[i].value && strcmp(value, entry->vary[i].value) == 0
+                          : entry->vary[i].value == NULL;
+        free(value);
+        if (!same) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool entries_same_variant(const http_cache_entry_t *a, const http_cache_entry_t *b) {
+    if (a->vary_count != b->vary_count) {
+        return false;
+    }
+    for (size_t i = 0; i < a->vary_count; i++) {
+        if (strcasecmp(a->vary[i].key, b->vary[i].key) != 0) {
+            return false;
+        }
+        const char *va = a->vary[i].value, *vb = b->vary[i].value;
+        if (va != vb && (!va || !vb || strcmp(va, vb) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Helper: LRU list maintenance (lock held) */
+static void lru_unlink(httpmorph_cache_t *cache, http_cache_entry_t *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(httpmorph_cache_t *cache, http_cache_entry_t *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    }
+    cache->lru_head = entry;
+    if (!cache->lru_tail) {
+        cache->lru_tail = entry;
+    }
+}
+
+/**
+ * Take an entry out of the table (lock held)
+ * Returns true if that dropped its last reference.
+ */
+static bool table_remove(httpmorph_cache_t *cache, http_cache_entry_t *entry) {
+    http_cache_entry_t **link = &cache->buckets[entry->hash & (HTTP_CACHE_BUCKETS - 1)];
+    while (*link && *link != entry) {
+        link = &(*link)->hash_next;
+    }
+    if (*link) {
+        *link = entry->hash_next;
+    }
+    entry->hash_next = NULL;
+    lru_unlink(cache, entry);
+    entry->in_table = false;
+    cache->stats.entries--;
+    cache->stats.memory_bytes -= entry->memory_charge;
+    cache->stats.disk_bytes -= entry->disk_charge;
+    return --entry->refs == 0;
+}
+
+/* Helper: Free entries unlinked under the lock, once it is released */
+typedef struct {
+    http_cache_entry_t *list;
+} entry_graveyard_t;
+
+static void graveyard_add(entry_graveyard_t *g, http_cache_entry_t *entry) {
+    entry->hash_next = g->list;
+    g->list = entry;
+}
+
+static void graveyard_free(entry_graveyard_t *g) {
+    while (g->list) {
+        http_cache_entry_t *next = g->list->hash_next;
+        entry_free(g->list);
+        g->list = next;
+    }
+}
+
+/**
+ * Insert an entry, replacing its variant and evicting to fit (lock held)
+ */
+static void table_insert(httpmorph_cache_t *cache, http_cache_entry_t *entry,
+                         entry_graveyard_t *graveyard) {
+    http_cache_entry_t **bucket = &cache->buckets[entry->hash & (HTTP_CACHE_BUCKETS - 1)];
+    for (http_cache_entry_t *e = *bucket, *next; e; e = next) {
+        next = e->hash_next;
+        if (e->hash == entry->hash && strcmp(e->url, entry->url) == 0 &&
+            entries_same_variant(e, entry) && table_remove(cache, e)) {
+            graveyard_add(graveyard, e);
+        }
+    }
+
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    lru_push_front(cache, entry);
+    entry->in_table = true;
+    entry->refs++;
+    cache->stats.entries++;
+    cache->stats.memory_bytes += entry->memory_charge;
+    cache->stats.disk_bytes += entry->disk_charge;
+
+    while ((cache->stats.memory_bytes > cache->max_memory ||
+            cache->stats.disk_bytes > cache->max_disk) &&
+           cache->lru_tail && cache->lru_tail != entry) {
+        http_cache_entry_t *victim = cache->lru_tail;
+        cache->stats.evictions++;
+        if (table_remove(cache, victim)) {
+            graveyard_add(graveyard, victim);
+        }
+    }
+}
+
+/* ==================================================================
+ * PUBLIC API
+ * ================================================================== */
+
+/**
+ * Create an HTTP response cache
+ */
+httpmorph_cache_t* httpmorph_cache_create(const httpmorph_cache_config_t *config) {
+    httpmorph_cache_t *cache = calloc(1, sizeof(httpmorph_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->max_memory = config && config->max_memory ? config->max_memory : HTTP_CACHE_DEFAULT_MEMORY;
+    cache->max_disk = config && config->max_disk ? config->max_disk : HTTP_CACHE_DEFAULT_DISK;
+    cache->spill_threshold = config && config->spill_threshold
+        ? config->spill_threshold : HTTP_CACHE_DEFAULT_SPILL_THRESHOLD;
+    if (config && config->spill_dir && config->spill_dir[0]) {
+        cache->spill_dir = strdup(config->spill_dir);
+        if (!cache->spill_dir) {
+            free(cache);
+            return NULL;
+        }
+    }
+    cache->refs = 1;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&cache->mutex);
+#else
+    pthread_mutex_init(&cache->mutex, NULL);
+#endif
+
+    return cache;
+}
+
+/**
+ * Take a reference on a cache
+ */
+void http_cache_retain(httpmorph_cache_t *cache) {
+    if (cache) {
+        CACHE_LOCK(cache);
+        cache->refs++;
+        CACHE_UNLOCK(cache);
+    }
+}
+
+/**
+ * Release a reference; the last one frees the cache
+ */
+void httpmorph_cache_destroy(httpmorph_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+
+    CACHE_LOCK(cache);
+    bool last = --cache->refs == 0;
+    CACHE_UNLOCK(cache);
+    if (!last) {
+        return;
+    }
+
+    httpmorph_cache_clear(cache);
+#ifdef _WIN32
+    DeleteCriticalSection(&cache->mutex);
+#else
+    pthread_mutex_destroy(&cache->mutex);
+#endif
+    free(cache->spill_dir);
+    free(cache);
+}
+
+/**
+ * Drop every stored response (entries in use live until released)
+ */
+void httpmorph_cache_clear(httpmorph_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+
+    entry_graveyard_t graveyard = { NULL };
+    CACHE_LOCK(cache);
+    while (cache->lru_head) {
+        http_cache_entry_t *entry = cache->lru_head;
+        if (table_remove(cache, entry)) {
+            graveyard_add(&graveyard, entry);
+        }
+    }
+    CACHE_UNLOCK(cache);
+    graveyard_free(&graveyard);
+}
+
+/**
+ * Get HTTP cache statistics
+ */
+int httpmorph_cache_get_stats(httpmorph_cache_t *cache, httpmorph_cache_stats_t *stats) {
+    if (!cache || !stats) {
+        return -1;
+    }
+    CACHE_LOCK(cache);
+    *stats = cache->stats;
+    CACHE_UNLOCK(cache);
+    return 0;
+}
+
+/**
+ * Find a stored response for a request (RFC 9111 section 4)
+ */
+http_cache_result_t http_cache_lookup(httpmorph_cache_t *cache, const httpmorph_request_t *request,
+                                      http_cache_entry_t **entry_out) {
+    *entry_out = NULL;
+    if (!cache || request->method != HTTPMORPH_GET || request->body_callback) {
+        return HTTP_CACHE_BYPASS;
+    }
+    /* The caller's own conditionals and ranges go to the origin untouched;
+     * authorized responses are never stored, so never looked up either */
+    if (request_has_header(request, "If-None-Match") ||
+        request_has_header(request, "If-Modified-Since") ||
+        request_has_header(request, "If-Range") ||
+        request_has_header(request, "Range") ||
+        request_has_header(request, "Authorization")) {
+        return HTTP_CACHE_BYPASS;
+    }
+
+    cache_control_t cc;
+    request_cache_control(request, &cc);
+
+    uint32_t hash = url_hash(request->url);
+    http_cache_entry_t *found = NULL;
+
+    CACHE_LOCK(cache);
+    for (http_cache_entry_t *e = cache->buckets[hash & (HTTP_CACHE_BUCKETS - 1)]; e; e = e->hash_next) {
+        if (e->hash == hash && strcmp(e->url, request->url) == 0 && entry_matches(e, request)) {
+            found = e;
+            break;
+        }
+    }
+    if (!found) {
+        cache->stats.misses++;
+        CACHE_UNLOCK(cache);
+        return cc.only_if_cached ? HTTP_CACHE_GATEWAY_TIMEOUT : HTTP_CACHE_MISS;
+    }
+
+    int64_t age = entry_current_age(found, now_seconds());
+    int64_t limit = found->lifetime;
+    if (cc.max_age >= 0 && cc.max_age < limit) {
+        limit = cc.max_age;
+    }
+    if (cc.min_fresh > 0) {
+        age += cc.min_fresh;
+    }
+    bool fresh = age < limit;
+    if (!fresh && cc.max_stale >= 0 && !found->must_revalidate && cc.max_age < 0) {
+        /* The client accepts this much staleness */
+        fresh = cc.max_stale == INT64_MAX || age - found->lifetime <= cc.max_stale;
+    }
+    fresh = fresh && !found->no_cache && !cc.no_cache;
+
+    http_cache_result_t result;
+    if (fresh) {
+        result = HTTP_CACHE_FRESH;
+        cache->stats.hits++;
+    } else if (cc.only_if_cached) {
+        result = HTTP_CACHE_GATEWAY_TIMEOUT;
+        cache->stats.misses++;
+    } else if (found->etag || found->last_modified) {
+        result = HTTP_CACHE_STALE;
+    } else {
+        /* Nothing to validate with; the new response will replace it */
+        result = HTTP_CACHE_MISS;
+        cache->stats.misses++;
+    }
+
+    if (result == HTTP_CACHE_FRESH || result == HTTP_CACHE_STALE) {
+        lru_unlink(cache, found);
+        lru_push_front(cache, found);
+        found->refs++;
+        *entry_out = found;
+    }
+    CACHE_UNLOCK(cache);
+    return result;
+}
+
+/**
+ * Add If-None-Match / If-Modified-Since for an entry's validators
+ */
+size_t http_cache_add_conditionals(const http_cache_entry_t *entry, httpmorph_request_t *request) {
+    size_t added = 0;
+    if (entry->etag && httpmorph_request_add_header(request, "If-None-Match", entry->etag) == 0) {
+        added++;
+    }
+    if (entry->last_modified &&
+        httpmorph_request_add_header(request, "If-Modified-Since", entry->last_modified) == 0) {
+        added++;
+    }
+    return added;
+}
+
+/**
+ * Replace a response's status, headers and body with a stored response
+ */
+int http_cache_serve(const http_cache_entry_t *entry, httpmorph_response_t *response) {
+    httpmorph_response_clear_headers(response);
+    for (size_t i = 0; i < entry->header_count; i++) {
+        const httpmorph_header_t *h = &entry->headers[i];
+        if (httpmorph_response_add_header_internal(response, h->key, strlen(h->key),
+                                                   h->value, strlen(h->value)) != 0) {
+            return -1;
+        }
+    }
+
+    char age[24];
+    int age_len = snprintf(age, sizeof(age), "%lld",
+                           (long long)entry_current_age(entry, now_seconds()));
+    if (httpmorph_response_add_header_internal(response, "Age", 3, age, (size_t)age_len) != 0) {
+        return -1;
+    }
+
+    response->status_code = entry->status_code;
+    response->http_version = entry->http_version;
+    response->cache_entry_id = entry->id;
+    if (entry->body->len > 0) {
+        CACHE_INC(&entry->body->refs);
+        httpmorph_response_set_shared_body(response, entry->body->data, entry->body->len,
+                                           entry->body, body_release);
+    } else {
+        response->body_len = 0;
+    }
+    return 0;
+}
+
+/**
+ * Update a stored response from a 304 (RFC 9111 section 4.3.4)
+ */
+http_cache_entry_t* http_cache_freshen(httpmorph_cache_t *cache, http_cache_entry_t *entry,
+                                       const httpmorph_response_t *not_modified,
+                                       int64_t request_time, int64_t response_time) {
+    /* Stored headers the 304 doesn't replace, then the 304's own */
+    size_t max = entry->header_count + not_modified->header_count;
+    httpmorph_header_t *merged = malloc((max ? max : 1) * sizeof(httpmorph_header_t));
+    if (!merged) {
+        return NULL;
+    }
+    size_t count = 0;
+    for (size_t i = 0; i < entry->header_count; i++) {
+        const char *name = entry->headers[i].key;
+        bool replaced = !name_in(name, unfreshened_headers,
+                                 sizeof(unfreshened_headers) / sizeof(unfreshened_headers[0])) &&
+                        httpmorph_response_get_header(not_modified, name) != NULL;
+        if (!replaced) {
+            merged[count++] = entry->headers[i];
+        }
+    }
+    for (size_t i = 0; i < not_modified->header_count; i++) {
+        if (!name_in(not_modified->headers[i].key, unfreshened_headers,
+                     sizeof(unfreshened_headers) / sizeof(unfreshened_headers[0]))) {
+            merged[count++] = not_modified->headers[i];
+        }
+    }
+
+    http_cache_entry_t *fresh = entry_create(entry->url, entry->status_code, entry->http_version,
+                                             merged, count, entry->vary, entry->vary_count,
+                                             entry->body);
+    free(merged);
+    if (!fresh) {
+        return NULL;
+    }
+    entry_compute_freshness(fresh, request_time, response_time);
+
+    entry_graveyard_t graveyard = { NULL };
+    CACHE_LOCK(cache);
+    cache->stats.revalidations++;
+    table_insert(cache, fresh, &graveyard);    /* The creation reference is the caller's */
+    CACHE_UNLOCK(cache);
+    graveyard_free(&graveyard);
+    return fresh;
+}
+
+/**
+ * Store a response if it is cacheable (RFC 9111 section 3)
+ */
+void http_cache_store(httpmorph_cache_t *cache, const httpmorph_request_t *request,
+                      const httpmorph_response_t *response,
+                      int64_t request_time, int64_t response_time) {
+    if (!cache || request->method != HTTPMORPH_GET || request->body_callback ||
+        response->error != HTTPMORPH_OK || response->status_code < 200 ||
+        response->status_code == 206 || response->status_code == 304 ||
+        request_has_header(request, "Range") || request_has_header(request, "Authorization")) {
+        return;
+    }
+
+    cache_control_t req_cc, resp_cc;
+    request_cache_control(request, &req_cc);
+    if (req_cc.no_store) {
+        return;
+    }
+    cache_control_init(&resp_cc);
+    const char *cc_values[16];
+    size_t cc_count = httpmorph_response_get_header_values(response, "Cache-Control", cc_values, 16);
+    for (size_t i = 0; i < cc_count && i < 16; i++) {
+        cache_control_parse(&resp_cc, cc_values[i]);
+    }
+    /* The cache is shared across clients and sessions */
+    if (resp_cc.no_store || resp_cc.is_private) {
+        return;
+    }
+
+    /* Request header values the response varies on */
+    httpmorph_header_t vary[16];
+    size_t vary_count = 0;
+    bool storable = true;
+    const char *vary_values[8];
+    size_t vary_headers = httpmorph_response_get_header_values(response, "Vary", vary_values, 8);
+    for (size_t i = 0; i < vary_headers && i < 8 && storable; i++) {
+        const char *p = vary_values[i];
+        while (*p && storable) {
+            while (*p == ' ' || *p == '\t' || *p == ',') {
+                p++;
+            }
+            const char *name = p;
+            while (*p && *p != ',' && *p != ' ' && *p != '\t') {
+                p++;
+            }
+            size_t len = (size_t)(p - name);
+            if (len == 0) {
+                continue;
+            }
+            if ((len == 1 && name[0] == '*') || vary_count == 16) {
+                storable = false;
+                break;
+            }
+            char *key = malloc(len + 1);
+            if (!key) {
+                storable = false;
+                break;
+            }
+            memcpy(key, name, len);
+            key[len] = '\0';
+            vary[vary_count].key = key;
+            vary[vary_count].value = request_header_joined(request, key);
+            vary_count++;
+        }
+    }
+    if (vary_headers > 8) {
+        storable = false;
+    }
+
+    http_cache_entry_t *entry = NULL;
+    http_cache_body_t *body = NULL;
+    if (storable) {
+        body = body_create(cache, response->body, response->body_len);
+        if (body) {
+            entry = entry_create(request->url, response->status_code, response->http_version,
+                                 response->headers, response->header_count,
+                                 vary, vary_count, body);
+            body_release(body);    /* The entry holds it now */
+        }
+    }
+    for (size_t i = 0; i < vary_count; i++) {
+        free(vary[i].key);
+        free(vary[i].value);
+    }
+    if (!entry) {
+        return;
+    }
+
+    bool explicit_freshness = entry_compute_freshness(entry, request_time, response_time);
+    bool useful = (explicit_freshness || heuristically_cacheable(entry->status_code)) &&
+                  (entry->lifetime > 0 || entry->etag || entry->last_modified);
+    bool fits = entry->memory_charge <= cache->max_memory && entry->disk_charge <= cache->max_disk;
+    if (!useful || !fits) {
+        entry_free(entry);
+        return;
+    }
+
+    entry_graveyard_t graveyard = { NULL };
+    CACHE_LOCK(cache);
+    cache->stats.stores++;
+    table_insert(cache, entry, &graveyard);
+    entry->refs--;    /* Only the table holds it now */
+    CACHE_UNLOCK(cache);
+    graveyard_free(&graveyard);
+}
+
+/**
+ * Drop every stored response for a URL
+ */
+void http_cache_invalidate(httpmorph_cache_t *cache, const char *url) {
+    if (!cache || !url) {
+        return;
+    }
+
+    uint32_t hash = url_hash(url);
+    entry_graveyard_t graveyard = { NULL };
+    CACHE_LOCK(cache);
+    for (http_cache_entry_t *e = cache->buckets[hash & (HTTP_CACHE_BUCKETS - 1)], *next; e; e = next) {
+        next = e->hash_next;
+        if (e->hash == hash && strcmp(e->url, url) == 0) {
+            cache->stats.invalidations++;
+            if (table_remove(cache, e)) {
+                graveyard_add(&graveyard, e);
+            }
+        }
+    }
+    CACHE_UNLOCK(cache);
+    graveyard_free(&graveyard);
+}
+
+/**
+ * Release an entry returned by a lookup or freshen
+ */
+void http_cache_entry_release(httpmorph_cache_t *cache, http_cache_entry_t *entry) {
+    if (!cache || !entry) {
+        return;
+    }
+    CACHE_LOCK(cache);
+    bool last = --entry->refs == 0;
+    CACHE_UNLOCK(cache);
+    if (last) {
+        entry_free(entry);
+    }
+}
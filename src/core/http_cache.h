@@ -0,0 +1,124 @@
+/**
+ * http_cache.h - In-process HTTP response cache (RFC 9111)
+ *
+ * A shared cache in RFC 9111 terms: any number of clients and sessions
+ * can use it, so responses marked private are not stored and s-maxage
+ * overrides max-age. Responses to GET are stored per URL and per value of
+ * the request headers their Vary names. Freshness comes from
+ * Cache-Control, Expires and, for responses with Last-Modified, the usual
+ * 10% heuristic. Stale responses
+ * with a validator are revalidated with If-None-Match / If-Modified-Since,
+ * and a 304 freshens the stored copy. Entries are evicted LRU to stay
+ * within a memory budget; large bodies can be spilled to unlinked,
+ * memory-mapped files with their own budget.
+ *
+ * Stored entries never change: a hit shares the body by reference and a
+ * freshened response replaces its entry, so responses already served stay
+ * valid until they are destroyed.
+ */
+
+#ifndef HTTPMORPH_HTTP_CACHE_H
+#define HTTPMORPH_HTTP_CACHE_H
+
+#include "httpmorph.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Hash buckets (power of 2) */
+#define HTTP_CACHE_BUCKETS 1024
+
+/* Defaults for httpmorph_cache_config_t fields left at 0 */
+#define HTTP_CACHE_DEFAULT_MEMORY          ((size_t)64 * 1024 * 1024)
+#define HTTP_CACHE_DEFAULT_SPILL_THRESHOLD ((size_t)64 * 1024)
+#define HTTP_CACHE_DEFAULT_DISK            ((size_t)1024 * 1024 * 1024)
+
+/* Upper bound on heuristic freshness (seconds) */
+#define HTTP_CACHE_MAX_HEURISTIC 86400
+
+typedef struct http_cache_entry http_cache_entry_t;
+
+/**
+ * Outcome of a lookup
+ */
+typedef enum {
+    HTTP_CACHE_BYPASS,            /* The request can't be answered from the cache */
+    HTTP_CACHE_MISS,              /* Nothing usable is stored */
+    HTTP_CACHE_FRESH,             /* Serve the entry as is */
+    HTTP_CACHE_STALE,             /* Revalidate the entry before serving it */
+    HTTP_CACHE_GATEWAY_TIMEOUT,   /* only-if-cached and nothing fresh is stored */
+} http_cache_result_t;
+
+/**
+ * Take a reference on a cache (released with httpmorph_cache_destroy())
+ */
+void http_cache_retain(httpmorph_cache_t *cache);
+
+/**
+ * Find a stored response for a request
+ *
+ * @param cache Cache
+ * @param request Request about to be sent
+ * @param entry Output: the entry for HTTP_CACHE_FRESH and HTTP_CACHE_STALE
+ *              (release with http_cache_entry_release())
+ * @return Lookup outcome
+ */
+http_cache_result_t http_cache_lookup(httpmorph_cache_t *cache, const httpmorph_request_t *request,
+                                      http_cache_entry_t **entry);
+
+/**
+ * Add If-None-Match / If-Modified-Since for an entry's validators
+ *
+ * @return Number of headers appended to the request
+ */
+size_t http_cache_add_conditionals(const http_cache_entry_t *entry, httpmorph_request_t *request);
+
+/**
+ * Replace a response's status, headers and body with a stored response
+ * The body is shared with the entry; timing and TLS fields are kept.
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int http_cache_serve(const http_cache_entry_t *entry, httpmorph_response_t *response);
+
+/**
+ * Update a stored response from the 304 that revalidated it
+ *
+ * @param cache Cache
+ * @param entry Stale entry the request was made conditional on
+ * @param not_modified The 304 response
+ * @param request_time When the request was sent (seconds since the epoch)
+ * @param response_time When the response arrived
+ * @return Freshened entry (release with http_cache_entry_release()), or
+ *         NULL if it couldn't be built
+ */
+http_cache_entry_t* http_cache_freshen(httpmorph_cache_t *cache, http_cache_entry_t *entry,
+                                       const httpmorph_response_t *not_modified,
+                                       int64_t request_time, int64_t response_time);
+
+/**
+ * Store a response if it is cacheable (replacing the variant it matches)
+ */
+void http_cache_store(httpmorph_cache_t *cache, const httpmorph_request_t *request,
+                      const httpmorph_response_t *response,
+                      int64_t request_time, int64_t response_time);
+
+/**
+ * Drop every stored response for a URL (after an unsafe request to it)
+ */
+void http_cache_invalidate(httpmorph_cache_t *cache, const char *url);
+
+/**
+ * Release an entry returned by a lookup or freshen
+ */
+void http_cache_entry_release(httpmorph_cache_t *cache, http_cache_entry_t *entry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_HTTP_CACHE_H */
@@ -10,4 +10,37 @@
 /* Client functions are defined in the public API (httpmorph.h) */
 /* This header is for internal client-related utilities if needed */
 
+/**
+ * Switch a client to another browser profile
+ * Picks up the shared SSL context configured for that profile.
+ *
+ * @param client Client
+ * @param profile Browser profile
+ * @return 0 on success, -1 on error
+ */
+int httpmorph_client_set_browser_profile(httpmorph_client_t *client,
+                                         const browser_profile_t *profile);
+
+/**
+ * Get one of the client profile's fingerprint variants and its SSL context
+ * Variant contexts are acquired from the shared cache on first use and
+ * kept until the profile or CA file changes. Variant 0 is the client's own.
+ *
+ * @param index Variant number (taken modulo BROWSER_PROFILE_VARIANTS)
+ * @param profile Output: the variant profile
+ * @param ssl_ctx Output: its SSL context (owned by the client)
+ * @return 0 on success, -1 on error
+ */
+int httpmorph_client_variant(httpmorph_client_t *client, unsigned int index,
+                             const browser_profile_t **profile, SSL_CTX **ssl_ctx);
+
+/**
+ * Get how many requests may be pipelined to a URL's origin
+ *
+ * @param origin Output: the origin key (REQUEST_SCHEDULER_MAX_KEY bytes)
+ * @return Depth allowed by httpmorph_client_allow_pipelining(), 0 if none
+ */
+uint32_t httpmorph_client_pipeline_depth(const httpmorph_client_t *client, const char *url,
+                                         char *origin);
+
 #endif /* CLIENT_H */
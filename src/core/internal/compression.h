@@ -7,6 +7,104 @@
 
 #include "internal.h"
 
+/* Accept-Encoding sent by default - only codings this build can decode */
+#if defined(HAVE_BROTLI) && defined(HAVE_ZSTD)
+    #define HTTPMORPH_ACCEPT_ENCODING "gzip, deflate, br, zstd"
+#elif defined(HAVE_BROTLI)
+    #define HTTPMORPH_ACCEPT_ENCODING "gzip, deflate, br"
+#elif defined(HAVE_ZSTD)
+    #define HTTPMORPH_ACCEPT_ENCODING "gzip, deflate, zstd"
+#else
+    #define HTTPMORPH_ACCEPT_ENCODING "gzip, deflate"
+#endif
+
+/**
+ * Content codings
+ */
+typedef enum {
+    HTTPMORPH_ENCODING_IDENTITY = 0,
+    HTTPMORPH_ENCODING_GZIP,
+    HTTPMORPH_ENCODING_DEFLATE,
+    HTTPMORPH_ENCODING_BROTLI,
+    HTTPMORPH_ENCODING_ZSTD,
+    HTTPMORPH_ENCODING_UNKNOWN
+} httpmorph_encoding_t;
+
+/**
+ * Incremental body decoder
+ * Inflates a compressed body chunk by chunk into a fixed scratch buffer
+ */
+typedef struct httpmorph_decoder httpmorph_decoder_t;
+
+/**
+ * Receives decoded output
+ *
+ * @return 0 to continue, non-zero to stop decoding
+ */
+typedef int (*httpmorph_decoder_output_t)(void *ctx, const uint8_t *data, size_t len);
+
+/**
+ * Map a Content-Encoding header value to a coding
+ *
+ * @param value Header value (NULL means identity)
+ * @return Coding, HTTPMORPH_ENCODING_UNKNOWN for unsupported values or lists
+ */
+httpmorph_encoding_t httpmorph_encoding_from_header(const char *value);
+
+/**
+ * Create a decoder for a Content-Encoding header value
+ *
+ * @param content_encoding Header value (may be NULL)
+ * @param buffer_pool Pool for scratch buffers (may be NULL)
+ * @return Decoder, or NULL if the body should be passed through as-is
+ *         (identity, unknown or not compiled in) or on allocation failure
+ */
+httpmorph_decoder_t* httpmorph_decoder_create(const char *content_encoding,
+                                              httpmorph_buffer_pool_t *buffer_pool);
+
+/**
+ * Get the decoder's input staging buffer
+ *
+ * Callers that read from the network may receive straight into it and
+ * then pass it to httpmorph_decoder_write().
+ *
+ * @param decoder Decoder
+ * @param size Output: buffer size
+ * @return Staging buffer
+ */
+uint8_t* httpmorph_decoder_input_buffer(httpmorph_decoder_t *decoder, size_t *size);
+
+/**
+ * Decode a chunk of compressed input
+ *
+ * @param decoder Decoder
+ * @param data Compressed bytes
+ * @param len Number of bytes
+ * @param output Called for every piece of decoded output
+ * @param ctx Passed to output
+ * @return 0 on success, -1 on corrupt input or if output asked to stop
+ */
+int httpmorph_decoder_write(httpmorph_decoder_t *decoder, const uint8_t *data, size_t len,
+                            httpmorph_decoder_output_t output, void *ctx);
+
+/**
+ * Check that the compressed stream ended cleanly
+ *
+ * @param decoder Decoder
+ * @param output Called for any remaining decoded output
+ * @param ctx Passed to output
+ * @return 0 on success, -1 if the stream was truncated
+ */
+int httpmorph_decoder_finish(httpmorph_decoder_t *decoder,
+                             httpmorph_decoder_output_t output, void *ctx);
+
+/**
+ * Destroy a decoder and return its buffers to the pool
+ *
+ * @param decoder Decoder (may be NULL)
+ */
+void httpmorph_decoder_destroy(httpmorph_decoder_t *decoder);
+
 /**
  * Decompress gzip-compressed response body
  *
@@ -25,7 +123,7 @@ int httpmorph_decompress_deflate(httpmorph_response_t *response);
 
 /**
  * Automatically decompress response body based on Content-Encoding header
- * Supports gzip, deflate, and identity encodings
+ * Supports gzip, deflate, br, zstd (when compiled in) and identity encodings
  *
  * @param response Response to decompress
  * @return 0 on success, -1 on error
@@ -1,5 +1,11 @@
 /**
  * cookies.h - Cookie management
+ *
+ * Cookies live in a jar indexed by domain: a hash table of domains, each
+ * holding path buckets (longest path first) of cookies in creation order.
+ * A request looks up its host and each parent domain, so matching costs
+ * depend on the cookies for that host only. An expiry-ordered heap drops
+ * expired cookies and picks eviction victims when the jar is full.
  */
 
 #ifndef COOKIES_H
@@ -7,6 +13,53 @@
 
 #include "internal.h"
 
+/* Default cap on cookies per jar (RFC 6265 section 6.1 minimum) */
+#define COOKIE_JAR_DEFAULT_MAX 3000
+
+/**
+ * Create a cookie jar
+ *
+ * @param max_cookies Cookies kept before the soonest-expiring is evicted
+ * @return Jar or NULL on error
+ */
+cookie_jar_t* cookie_jar_create(size_t max_cookies);
+
+/**
+ * Destroy a cookie jar and all its cookies
+ */
+void cookie_jar_destroy(cookie_jar_t *jar);
+
+/**
+ * Number of cookies in a jar
+ */
+size_t cookie_jar_count(const cookie_jar_t *jar);
+
+/**
+ * Store a cookie from a Set-Cookie header
+ * A cookie with the same name, domain and path is replaced; one that is
+ * already expired removes it.
+ *
+ * @param jar Cookie jar
+ * @param header_value Set-Cookie header value
+ * @param host Host of the request the response came from
+ * @param now Current time (seconds since the epoch)
+ * @return 0 if stored or removed, -1 if rejected
+ */
+int cookie_jar_set(cookie_jar_t *jar, const char *header_value, const char *host, time_t now);
+
+/**
+ * Build the Cookie header value for a request
+ *
+ * @param jar Cookie jar
+ * @param host Request host
+ * @param path Request path
+ * @param is_secure Whether the request uses HTTPS
+ * @param now Current time (seconds since the epoch)
+ * @return Header value (caller must free) or NULL if no cookie matches
+ */
+char* cookie_jar_header(cookie_jar_t *jar, const char *host, const char *path,
+                        bool is_secure, time_t now);
+
 /**
  * Free a cookie structure
  */
@@ -19,8 +19,9 @@
  * 2. TCP connection (direct or via proxy)
  * 3. TLS handshake (if HTTPS)
  * 4. HTTP/2 or HTTP/1.1 request/response
- * 5. Gzip decompression
+ * 5. Content decoding (gzip magic fallback)
  * 6. Connection pooling
+ * 7. Redirects, when the request follows them
  *
  * @param client HTTP client with SSL context and configuration
  * @param request Request to execute
@@ -32,4 +33,60 @@ httpmorph_response_t* httpmorph_request_execute(
     const httpmorph_request_t *request,
     httpmorph_pool_t *pool);
 
+/**
+ * Execute an HTTP request on behalf of a session
+ *
+ * Like httpmorph_request_execute(), with every hop sending the session's
+ * cookies and storing the ones its response sets.
+ *
+ * @param session Session whose cookie jar to use (NULL for none)
+ */
+httpmorph_response_t* httpmorph_request_execute_in_session(
+    httpmorph_client_t *client,
+    const httpmorph_request_t *request,
+    httpmorph_pool_t *pool,
+    httpmorph_session_t *session);
+
+/**
+ * Count the requests at the start of an array that can be pipelined together
+ *
+ * They are safe to send again (GET, HEAD or OPTIONS without a body), go
+ * to one origin the client allows pipelining to, don't exceed its depth,
+ * and nothing (proxy, cache, body callback) takes them off that path.
+ *
+ * @return Requests in the run (0 or 1: run them one at a time)
+ */
+size_t httpmorph_pipeline_run(const httpmorph_client_t *client,
+                              httpmorph_request_t *const *requests, size_t count);
+
+/**
+ * Execute a run of requests from httpmorph_pipeline_run()
+ *
+ * They are pipelined on a pooled HTTP/1.1 connection to their origin;
+ * the first request opens one when the pool has none. Requests a pipeline
+ * doesn't answer (an error, the connection closing) run one at a time.
+ *
+ * @param responses Output: a response per request, as from httpmorph_request_execute()
+ */
+void httpmorph_request_execute_pipelined(httpmorph_client_t *client,
+                                         httpmorph_request_t *const *requests, size_t count,
+                                         httpmorph_pool_t *pool,
+                                         httpmorph_response_t **responses);
+
+/**
+ * Open one connection to an origin and pool it, as a request would
+ *
+ * Direct connection, TLS with the client's profile and session cache
+ * (session tickets the server sends right after the handshake are read
+ * in), and for HTTP/2 an open session. Fills the error, protocol and
+ * timing fields of result (connections is left alone).
+ *
+ * @param pool Pool that receives the connection
+ * @return 0 if the connection was pooled, -1 otherwise
+ */
+int httpmorph_preconnect_origin(httpmorph_client_t *client, httpmorph_pool_t *pool,
+                                const char *host, uint16_t port, bool use_tls,
+                                bool http2_enabled, bool verify_ssl, uint32_t timeout_ms,
+                                httpmorph_preconnect_result_t *result);
+
 #endif /* CORE_H */
@@ -30,6 +30,24 @@ int httpmorph_send_http_request(SSL *ssl, int sockfd, const httpmorph_request_t
                                  uint16_t port, bool use_proxy, const char *proxy_user,
                                  const char *proxy_pass);
 
+/**
+ * Bytes read from a connection past the end of a response
+ *
+ * With pipelining they are the start of the next response, which reads
+ * them before anything else. A zeroed struct is empty.
+ */
+typedef struct {
+    uint8_t *data;
+    size_t start;       /* Offset of the first unread byte */
+    size_t len;         /* Unread bytes */
+    size_t capacity;
+} http1_readahead_t;
+
+/**
+ * Free a readahead buffer (leaves it empty)
+ */
+void http1_readahead_free(http1_readahead_t *readahead);
+
 /**
  * Receive HTTP/1.1 response from a connection
  *
@@ -38,11 +56,14 @@ int httpmorph_send_http_request(SSL *ssl, int sockfd, const httpmorph_request_t
  * @param response Response object to populate
  * @param first_byte_time_us Output: time of first byte received (microseconds)
  * @param conn_will_close Output: whether connection should be closed
- * @param method HTTP method used in request (needed for HEAD handling)
+ * @param request Request being answered (method for HEAD handling, body callback)
+ * @param readahead Bytes read first, and where bytes past the response are
+ *                  kept (NULL: they are dropped)
  * @return 0 on success, error code on failure
  */
 int httpmorph_recv_http_response(SSL *ssl, int sockfd, httpmorph_response_t *response,
                                   uint64_t *first_byte_time_us, bool *conn_will_close,
-                                  httpmorph_method_t method);
+                                  const httpmorph_request_t *request,
+                                  http1_readahead_t *readahead);
 
 #endif /* HTTP1_H */
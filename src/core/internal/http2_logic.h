@@ -43,6 +43,16 @@ int httpmorph_http2_request_pooled(struct pooled_connection *conn,
                                    const char *host, const char *path,
                                    httpmorph_response_t *response);
 
+/**
+ * Open the HTTP/2 session of a new pooled connection
+ * Sends the preface, SETTINGS and WINDOW_UPDATE now, so the connection's
+ * first request (httpmorph_http2_request_pooled()) goes out without them.
+ *
+ * @param conn Pooled HTTP/2 connection without a session yet
+ * @return 0 on success, -1 on error
+ */
+int httpmorph_http2_open_pooled(struct pooled_connection *conn);
+
 /**
  * Perform HTTP/2 request with concurrent multiplexing
  * Uses session manager to allow multiple concurrent streams on same session
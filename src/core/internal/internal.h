@@ -52,6 +52,7 @@
     #include <netdb.h>
     #include <arpa/inet.h>
     #include <netinet/tcp.h>
+    #include <pthread.h>
 #endif
 
 /* BoringSSL/OpenSSL includes */
@@ -75,6 +76,10 @@
 #include "../../tls/browser_profiles.h"
 #include "../io_engine.h"
 #include "../connection_pool.h"
+#include "../tls_session_cache.h"
+#include "../alt_svc.h"
+#include "../arena.h"
+#include "../metrics.h"
 
 /* ==================================================================
  * INTERNAL STRUCTURES
@@ -83,6 +88,14 @@
 /* Forward declare buffer pool */
 typedef struct httpmorph_buffer_pool httpmorph_buffer_pool_t;
 
+/**
+ * An origin allowed HTTP/1.1 pipelining
+ */
+typedef struct {
+    char *origin;                          /* "scheme://host:port" */
+    uint32_t depth;                        /* Requests sent at once */
+} pipeline_origin_t;
+
 /**
  * HTTP client structure
  */
@@ -91,14 +104,27 @@ struct httpmorph_client {
     io_engine_t *io_engine;
     httpmorph_pool_t *pool;
     httpmorph_buffer_pool_t *buffer_pool;  /* Buffer pool for response bodies */
+    tls_session_cache_t *session_cache;    /* TLS session resumption cache */
+    alt_svc_cache_t *alt_svc;              /* Alternative services origins advertised */
+    char *ca_file;                         /* Extra CA bundle (NULL: system store) */
+    httpmorph_arena_pool_t *arena_pool;    /* Per-request arenas (NULL = disabled) */
+    httpmorph_cache_t *http_cache;         /* Shared HTTP response cache (NULL = none) */
+    httpmorph_proxy_set_t *proxy_set;      /* Shared proxy rotation (NULL = none) */
+    metrics_t *metrics;                    /* Request metrics */
 
     /* Configuration */
     uint32_t timeout_ms;
     bool follow_redirects;
     uint32_t max_redirects;
+    bool early_data;
+    bool tcp_fast_open;
+    pipeline_origin_t *pipeline_origins;   /* Allowed to pipeline (unordered) */
+    size_t pipeline_origin_count;
 
     /* Browser fingerprint */
     const browser_profile_t *browser_profile;
+    bool tls_fingerprint;                  /* Report JA3 on responses */
+    SSL_CTX *variant_ctx[BROWSER_PROFILE_VARIANTS];  /* Rotation contexts, acquired on first use ([0] unused) */
 };
 
 /**
@@ -107,14 +133,23 @@ struct httpmorph_client {
 typedef struct cookie {
     char *name;
     char *value;
-    char *domain;
+    char *domain;    /* Lowercase, no leading dot */
     char *path;
     time_t expires;  /* 0 = session cookie */
     bool secure;
     bool http_only;
+    bool host_only;  /* No Domain attribute: exact host match only */
+    size_t name_len;
+    size_t value_len;
+    uint64_t seq;    /* Creation order (kept when a cookie is replaced) */
+    size_t heap_index;              /* Position in the jar's expiry heap */
+    struct cookie_path *bucket;     /* Path bucket holding this cookie */
+    struct cookie *prev;
     struct cookie *next;
 } cookie_t;
 
+typedef struct cookie_jar cookie_jar_t;
+
 /**
  * Session structure
  */
@@ -128,9 +163,9 @@ struct httpmorph_session {
     /* Connection pool for this session */
     httpmorph_pool_t *pool;
 
-    /* Cookie jar */
-    cookie_t *cookies;
-    size_t cookie_count;
+    /* Cookie jar (requests on one session may run concurrently) */
+    cookie_jar_t *cookie_jar;
+    pthread_mutex_t cookie_mutex;
 
     /* HTTP/2 session */
 #ifdef HAVE_NGHTTP2
@@ -13,11 +13,117 @@
  * @param host Hostname or IP address
  * @param port Port number
  * @param timeout_ms Connection timeout in milliseconds
- * @param connect_time Output: connection time in microseconds
+ * @param fast_open Use TCP Fast Open (the first write rides in the SYN)
+ * @param connect_time Output: connection time in microseconds (DNS included)
+ * @param dns_time Output: DNS resolution time in microseconds (may be NULL)
  * @return socket file descriptor on success, -1 on error
  */
 int httpmorph_tcp_connect(const char *host, uint16_t port, uint32_t timeout_ms,
-                          uint64_t *connect_time);
+                          bool fast_open, uint64_t *connect_time, uint64_t *dns_time);
+
+/**
+ * Ask for TCP Fast Open on a socket before it connects (Linux; no-op elsewhere)
+ *
+ * Without a cookie for the server the kernel does a normal handshake and
+ * requests one for next time.
+ *
+ * @param sockfd Socket not yet connected
+ */
+void httpmorph_socket_enable_fast_open(int sockfd);
+
+/**
+ * Resolve a host through the DNS cache and the resolver threads
+ *
+ * @param host Hostname or IP address
+ * @param port Port number
+ * @param timeout_ms Maximum wait for the resolver (0 waits indefinitely)
+ * @param preferred_family Output: family that connected first last time (AF_UNSPEC if unknown)
+ * @param gai_error Output: getaddrinfo() error on failure (may be NULL)
+ * @return Address list (free with httpmorph_dns_free()), NULL on error
+ */
+struct addrinfo* httpmorph_dns_resolve(const char *host, uint16_t port, uint32_t timeout_ms,
+                                       int *preferred_family, int *gai_error);
+
+/**
+ * Look up a host in the DNS cache only (never blocks)
+ *
+ * A negative hit (the name is known not to resolve) returns NULL with
+ * *gai_error set; a plain miss returns NULL with *gai_error = 0.
+ *
+ * @param host Hostname or IP address
+ * @param port Port number
+ * @param preferred_family Output: family that connected first last time (AF_UNSPEC if unknown)
+ * @param gai_error Output: cached getaddrinfo() error for a negative hit (may be NULL)
+ * @return Shared address list (free with httpmorph_dns_free()), NULL on a miss
+ */
+struct addrinfo* httpmorph_dns_cache_get(const char *host, uint16_t port,
+                                         int *preferred_family, int *gai_error);
+
+/**
+ * Store a resolved address list in the DNS cache
+ *
+ * @param host Hostname or IP address
+ * @param port Port number
+ * @param addrs Shared address list from httpmorph_dns_copy() (referenced, not copied)
+ * @param ttl_seconds Record TTL (-1 if unknown, 0 to skip caching)
+ */
+void httpmorph_dns_cache_put(const char *host, uint16_t port, const struct addrinfo *addrs,
+                             int ttl_seconds);
+
+/**
+ * Remember that a host does not resolve (negative caching)
+ *
+ * @param host Hostname or IP address
+ * @param port Port number
+ * @param gai_error getaddrinfo()-style error to report on hits
+ * @param ttl_seconds Negative TTL, e.g. the SOA minimum (-1 for the default)
+ */
+void httpmorph_dns_cache_put_negative(const char *host, uint16_t port, int gai_error,
+                                      int ttl_seconds);
+
+/**
+ * Freeze an address chain into an immutable, shared list
+ *
+ * @param addrs Address chain (e.g. from getaddrinfo(); not modified)
+ * @return Shared list (free with httpmorph_dns_free()), NULL on allocation failure
+ */
+struct addrinfo* httpmorph_dns_copy(const struct addrinfo *addrs);
+
+/**
+ * Take another reference to a shared address list
+ *
+ * @param addrs Shared list (may be NULL)
+ * @return addrs
+ */
+struct addrinfo* httpmorph_dns_ref(struct addrinfo *addrs);
+
+/**
+ * Release a shared address list returned by httpmorph_dns_*()
+ *
+ * @param addrs Shared list (may be NULL)
+ */
+void httpmorph_dns_free(struct addrinfo *addrs);
+
+/**
+ * Remember the address family that won a connection race
+ *
+ * @param host Hostname or IP address
+ * @param port Port number
+ * @param family Winning address family
+ */
+void httpmorph_dns_set_preferred_family(const char *host, uint16_t port, int family);
+
+/**
+ * Send part of a file over a plain (blocking) socket
+ * Uses sendfile() where the platform has it, read-and-send otherwise.
+ *
+ * @param sockfd Connected socket
+ * @param fd File to send from
+ * @param offset Starting byte offset in the file
+ * @param len Bytes to send
+ * @return 0 once all bytes are sent, -1 on error or early end of file
+ */
+int httpmorph_send_file(int sockfd, int fd, uint64_t offset, size_t len);
 
 /**
  * Cleanup expired DNS cache entries
@@ -15,4 +15,78 @@
  */
 const char* httpmorph_method_to_string(httpmorph_method_t method);
 
+/**
+ * Remove the last count headers (added for one attempt, e.g. validators)
+ *
+ * @param request Request to update
+ * @param count Headers to remove
+ */
+void httpmorph_request_pop_headers(httpmorph_request_t *request, size_t count);
+
+/**
+ * Build the request for the next hop of a redirect
+ *
+ * The copy lives on the heap (no arena). 303, and 301/302 after a POST,
+ * turn the request into a GET without a body; Authorization, Cookie and
+ * Host headers are dropped when the hop leaves the origin.
+ *
+ * @param request Request that was redirected
+ * @param status Redirect status code
+ * @param url Absolute URL of the next hop
+ * @return New request, NULL if it can't be repeated (streamed body) or on
+ *         allocation failure
+ */
+httpmorph_request_t* httpmorph_request_redirect(const httpmorph_request_t *request,
+                                                uint16_t status, const char *url);
+
+/* Room framing needs around chunk data (size line before, CRLF after) */
+#define HTTPMORPH_CHUNK_PREFIX 18
+#define HTTPMORPH_CHUNK_SUFFIX 2
+
+/* Last chunk of a chunked body (no trailers) */
+#define HTTPMORPH_CHUNK_LAST "0\r\n\r\n"
+
+/**
+ * Whether a request has a body to send (in memory, from a file or a source)
+ */
+static inline bool httpmorph_request_has_body(const httpmorph_request_t *request) {
+    if (request->body_source) {
+        return true;
+    }
+    return request->body_len > 0 && (request->body || request->body_is_file);
+}
+
+/**
+ * Whether a request may go out before the connection is confirmed (TLS
+ * early data, TCP Fast Open data), where the network can replay it:
+ * safe methods without a body only
+ */
+static inline bool httpmorph_request_is_replayable(const httpmorph_request_t *request) {
+    if (request->method != HTTPMORPH_GET && request->method != HTTPMORPH_HEAD &&
+        request->method != HTTPMORPH_OPTIONS) {
+        return false;
+    }
+    return !httpmorph_request_has_body(request);
+}
+
+/**
+ * Pull the next piece of a streamed body (request->body_source set)
+ * Reads stop at the declared length; a source that ends early fails.
+ *
+ * @param sent Body bytes pulled so far
+ * @return Bytes read, 0 at the end of the body, -1 on error or
+ *         HTTPMORPH_BODY_SOURCE_PAUSE
+ */
+int64_t httpmorph_request_read_body(const httpmorph_request_t *request, uint8_t *buf,
+                                    size_t len, uint64_t sent);
+
+/**
+ * Frame data as one chunk in place
+ * The len data bytes sit at buf + HTTPMORPH_CHUNK_PREFIX with
+ * HTTPMORPH_CHUNK_SUFFIX bytes free after them.
+ *
+ * @return Offset in buf where the framed chunk starts (it ends after the suffix)
+ */
+size_t httpmorph_request_frame_chunk(uint8_t *buf, size_t len);
+
 #endif /* REQUEST_H */
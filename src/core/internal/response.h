@@ -15,6 +15,25 @@
  */
 httpmorph_response_t* httpmorph_response_create(httpmorph_buffer_pool_t *buffer_pool);
 
+/**
+ * Create a new response whose headers and strings share a request's arena
+ *
+ * @param buffer_pool Buffer pool for body allocation (can be NULL for no pooling)
+ * @param arena Request arena to reference (NULL for a plain heap response)
+ * @return Newly allocated response or NULL on error
+ */
+httpmorph_response_t* httpmorph_response_create_with_arena(httpmorph_buffer_pool_t *buffer_pool,
+                                                           httpmorph_arena_t *arena);
+
+/**
+ * Copy a string for a response field (TLS info, error message)
+ * The copy lives in the response's arena if it has one; free it with the
+ * response either way.
+ *
+ * @return Copy or NULL on error
+ */
+char* httpmorph_response_strdup(httpmorph_response_t *response, const char *str);
+
 /**
  * Parse HTTP response status line
  *
@@ -38,4 +57,24 @@ int httpmorph_response_add_header_internal(httpmorph_response_t *response,
                                             const char *name, size_t namelen,
                                             const char *value, size_t valuelen);
 
+/**
+ * Remove every header, keeping the allocated storage
+ *
+ * @param response Response to clear
+ */
+void httpmorph_response_clear_headers(httpmorph_response_t *response);
+
+/**
+ * Point a response at a body it doesn't own, dropping its own buffer
+ * The body is read-only; release(owner) runs when the response is destroyed.
+ *
+ * @param response Response to update
+ * @param body Body bytes
+ * @param len Body length
+ * @param owner Reference held by the response (transferred)
+ * @param release Drops the reference
+ */
+void httpmorph_response_set_shared_body(httpmorph_response_t *response, const uint8_t *body,
+                                        size_t len, void *owner, void (*release)(void *owner));
+
 #endif /* RESPONSE_H */
@@ -8,6 +8,19 @@
 #include "internal.h"
 
 /* Session functions are defined in the public API (httpmorph.h) */
-/* This header is for internal session-related utilities if needed */
+
+/**
+ * Add the session's cookies for a request's URL to the request
+ * @return Number of headers added (remove them with httpmorph_request_pop_headers())
+ */
+size_t httpmorph_session_attach_cookies(httpmorph_session_t *session,
+                                        httpmorph_request_t *request);
+
+/**
+ * Store the cookies a response sets, scoped to the URL it answered
+ */
+void httpmorph_session_store_cookies(httpmorph_session_t *session,
+                                     const char *url,
+                                     const httpmorph_response_t *response);
 
 #endif /* SESSION_H */
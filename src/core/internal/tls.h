@@ -39,15 +39,18 @@ int httpmorph_set_ssl_verification(SSL_CTX *ctx, bool verify);
  * Establish TLS connection on existing socket
  *
  * @param ctx SSL context
+ * @param session_cache Client's session cache (NULL for none)
  * @param sockfd Socket file descriptor
  * @param hostname Hostname for SNI
+ * @param port Target port (session cache key)
  * @param browser_profile Browser profile for fingerprinting
  * @param http2_enabled Whether HTTP/2 is enabled
  * @param verify_cert Whether to verify server certificate
  * @param tls_time Output: TLS handshake time in microseconds
  * @return SSL* on success, NULL on error
  */
-SSL* httpmorph_tls_connect(SSL_CTX *ctx, int sockfd, const char *hostname,
+SSL* httpmorph_tls_connect(SSL_CTX *ctx, tls_session_cache_t *session_cache,
+                            int sockfd, const char *hostname, uint16_t port,
                             const browser_profile_t *browser_profile,
                             bool http2_enabled, bool verify_cert, uint64_t *tls_time);
 
@@ -60,6 +63,16 @@ SSL* httpmorph_tls_connect(SSL_CTX *ctx, int sockfd, const char *hostname,
  */
 char* httpmorph_calculate_ja3(SSL *ssl, const browser_profile_t *profile);
 
+/**
+ * Get the JA3 fingerprint of a connection, computing it once per
+ * (profile, negotiated version) for the life of the process
+ *
+ * @param ssl SSL connection after the handshake
+ * @param profile Browser profile used
+ * @return Shared fingerprint string (never freed) or NULL on error
+ */
+const char* httpmorph_tls_ja3(SSL *ssl, const browser_profile_t *profile);
+
 #ifdef _WIN32
 /**
  * Load CA certificates from Windows Certificate Store into SSL_CTX
@@ -20,4 +20,14 @@
 int httpmorph_parse_url(const char *url, char **scheme, char **host,
                          uint16_t *port, char **path);
 
+/**
+ * Resolve a reference (e.g. a Location header) against a base URL
+ * (RFC 3986 section 5.2); fragments are dropped
+ *
+ * @param base Absolute URL the reference is relative to
+ * @param reference Absolute or relative reference
+ * @return Absolute URL - caller must free; NULL on error
+ */
+char* httpmorph_resolve_url(const char *base, const char *reference);
+
 #endif /* URL_H */
@@ -18,4 +18,21 @@ uint64_t httpmorph_get_time_us(void);
  */
 char* httpmorph_base64_encode(const char *input, size_t length);
 
+/**
+ * Read from a file at an offset without moving its file position
+ *
+ * @return Bytes read (0 at end of file), -1 on error
+ */
+int64_t httpmorph_file_read_at(int fd, void *buf, size_t len, uint64_t offset);
+
+/**
+ * Parse an HTTP or cookie date (IMF-fixdate, RFC 850, asctime and the
+ * looser forms RFC 6265 accepts)
+ *
+ * @param value Date string
+ * @param len Length of value
+ * @return Seconds since the epoch (UTC), or -1 if it isn't a valid date
+ */
+int64_t httpmorph_parse_http_date(const char *value, size_t len);
+
 #endif /* UTIL_H */
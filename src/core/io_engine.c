@@ -44,6 +44,8 @@
 
 #ifdef HAVE_IO_URING
 #include <liburing.h>
+#include <poll.h>
+#include "buffer_pool.h"
 #endif
 
 /* Default queue depth for io_uring */
@@ -152,8 +154,8 @@ static io_engine_t* io_engine_create_iocp(void) {
         return NULL;
     }
 
-    /* Start the IOCP completion dispatcher thread */
-    if (iocp_dispatcher_start(engine) != 0) {
+    /* Start the IOCP completion dispatcher threads (one per CPU, capped) */
+    if (iocp_dispatcher_start(engine, 0) != 0) {
         DEBUG_PRINT("[io_engine] Failed to start IOCP dispatcher\n");
         CloseHandle((HANDLE)engine->iocp_handle);
         free(engine);
@@ -161,7 +163,7 @@ static io_engine_t* io_engine_create_iocp(void) {
     }
 
     engine->engine_fd = -1;  /* IOCP doesn't use traditional fd */
-    DEBUG_PRINT("[io_engine] IOCP engine created with dispatcher thread\n");
+    DEBUG_PRINT("[io_engine] IOCP engine created with dispatcher threads\n");
     return engine;
 #else
     /* Not supported on non-Windows */
@@ -170,16 +172,119 @@ static io_engine_t* io_engine_create_iocp(void) {
 }
 
 #ifdef HAVE_IO_URING
+/*
+ * io_uring backend
+ *
+ * Each fd has a receive and a send side, each with at most one operation
+ * in flight. A CQE's user data carries (fd, generation, side); replacing
+ * or removing an operation bumps the generation, so completions for a
+ * cancelled operation are dropped instead of reaching freed memory.
+ * SQEs are queued by io_engine_submit() and flushed together by the next
+ * io_engine_wait().
+ */
+
+/* Buffer group id of the multishot receive ring */
+#define URING_BUF_GROUP 0
+
+/* SQPOLL thread idle time before it sleeps */
+#define URING_SQ_THREAD_IDLE_MS 1000
+
+#define URING_DATA(fd, gen, dir) \
+    (((uint64_t)(uint32_t)(fd) << 32) | (((uint64_t)(gen) & 0x7fffffffu) << 1) | (uint64_t)(dir))
+#define URING_DATA_IGNORE UINT64_MAX   /* Cancel requests */
+
+typedef struct io_uring_fd_slot {
+    io_operation_t *op[2];      /* [0] receive side, [1] send side */
+    uint32_t gen[2];
+    bool active[2];             /* A CQE is still due for op[dir] */
+    bool registered;            /* fd is in the fixed file table */
+} io_uring_fd_slot_t;
+
+/* Receive side or send side */
+static int uring_dir(const io_operation_t *op) {
+    return (op->type == IO_OP_RECV || op->type == IO_OP_RECV_MULTISHOT ||
+            op->type == IO_OP_ACCEPT) ? 0 : 1;
+}
+
+/* Slot for fd, growing the table (ring_lock held) */
+static io_uring_fd_slot_t* uring_slot(io_engine_t *engine, int fd) {
+    if ((size_t)fd >= engine->fd_slot_count) {
+        size_t count = engine->fd_slot_count ? engine->fd_slot_count : 64;
+        while (count <= (size_t)fd) {
+            count *= 2;
+        }
+        io_uring_fd_slot_t *slots = realloc(engine->fd_slots, count * sizeof(io_uring_fd_slot_t));
+        if (!slots) {
+            return NULL;
+        }
+        memset(slots + engine->fd_slot_count, 0,
+               (count - engine->fd_slot_count) * sizeof(io_uring_fd_slot_t));
+        engine->fd_slots = slots;
+        engine->fd_slot_count = count;
+    }
+    return &engine->fd_slots[fd];
+}
+
+/* Next free SQE, flushing a full queue (ring_lock held) */
+static struct io_uring_sqe* uring_get_sqe(io_engine_t *engine) {
+    struct io_uring_sqe *sqe = io_uring_get_sqe(engine->ring);
+    if (!sqe) {
+        io_uring_submit(engine->ring);
+        sqe = io_uring_get_sqe(engine->ring);
+    }
+    return sqe;
+}
+
+/* Drop the operation on one side of fd, cancelling it if in flight (ring_lock held) */
+static void uring_cancel(io_engine_t *engine, int fd, io_uring_fd_slot_t *slot, int dir) {
+    if (slot->active[dir]) {
+        struct io_uring_sqe *sqe = uring_get_sqe(engine);
+        if (sqe) {
+            io_uring_prep_cancel64(sqe, URING_DATA(fd, slot->gen[dir], dir), 0);
+            io_uring_sqe_set_data64(sqe, URING_DATA_IGNORE);
+        }
+        slot->active[dir] = false;
+    }
+    slot->op[dir] = NULL;
+    slot->gen[dir]++;
+}
+
+/* Use the registered file for fd when there is one (ring_lock held) */
+static void uring_use_fixed_file(io_engine_t *engine, struct io_uring_sqe *sqe, int fd,
+                                 io_uring_fd_slot_t *slot) {
+    if (!engine->fixed_files || fd >= IO_ENGINE_FIXED_FILES) {
+        return;
+    }
+    if (!slot->registered) {
+        slot->registered = io_uring_register_files_update(engine->ring, (unsigned)fd, &fd, 1) == 1;
+    }
+    if (slot->registered) {
+        sqe->flags |= IOSQE_FIXED_FILE;  /* Fixed table index == fd */
+    }
+}
+
+/* Give a ring buffer back to the kernel */
+static void uring_recycle_buffer(io_engine_t *engine, uint16_t bid) {
+    if (!engine->buf_ring || bid >= engine->ring_buffer_count) {
+        return;
+    }
+    io_uring_buf_ring_add(engine->buf_ring, engine->ring_buffers[bid],
+                          (unsigned)engine->ring_buffer_size, bid,
+                          io_uring_buf_ring_mask(engine->ring_buffer_count), 0);
+    io_uring_buf_ring_advance(engine->buf_ring, 1);
+}
+
 /**
  * Create io_uring-based engine
  */
-static io_engine_t* io_engine_create_uring(uint32_t queue_depth) {
+static io_engine_t* io_engine_create_uring(uint32_t queue_depth, uint32_t options) {
     io_engine_t *engine = calloc(1, sizeof(io_engine_t));
     if (!engine) {
         return NULL;
     }
 
     engine->type = IO_ENGINE_URING;
+    engine->engine_fd = -1;  /* Owned by the ring */
     engine->queue_depth = queue_depth;
 
     /* Allocate io_uring structure */
@@ -192,35 +297,275 @@ static io_engine_t* io_engine_create_uring(uint32_t queue_depth) {
     /* Initialize io_uring with optimizations */
     struct io_uring_params params;
     memset(&params, 0, sizeof(params));
+    if (options & IO_ENGINE_OPT_SQPOLL) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = URING_SQ_THREAD_IDLE_MS;
+    }
 
     int ret = io_uring_queue_init_params(queue_depth, engine->ring, &params);
+    if (ret < 0 && (options & IO_ENGINE_OPT_SQPOLL)) {
+        /* SQPOLL needs privileges on older kernels - run without it */
+        memset(&params, 0, sizeof(params));
+        ret = io_uring_queue_init_params(queue_depth, engine->ring, &params);
+    }
     if (ret < 0) {
         free(engine->ring);
         free(engine);
         return NULL;
     }
+    engine->sqpoll = (params.flags & IORING_SETUP_SQPOLL) != 0;
+
+    if (options & IO_ENGINE_OPT_FIXED_FILES) {
+        engine->fixed_files = io_uring_register_files_sparse(engine->ring, IO_ENGINE_FIXED_FILES) == 0;
+    }
+
+    if (options & IO_ENGINE_OPT_ZERO_COPY) {
+        struct io_uring_probe *probe = io_uring_get_probe_ring(engine->ring);
+        if (probe) {
+            engine->zero_copy = io_uring_opcode_supported(probe, IORING_OP_SEND_ZC);
+            io_uring_free_probe(probe);
+        }
+    }
+
+    /* Recursive: completion callbacks may submit follow-up operations */
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&engine->ring_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
 
     return engine;
 }
+
+/**
+ * Submit an I/O operation - io_uring implementation
+ */
+static int io_engine_submit_uring(io_engine_t *engine, io_operation_t *op) {
+    if (op->fd < 0) {
+        return -1;
+    }
+
+    bool readiness = (op->buf == NULL && op->type != IO_OP_RECV_MULTISHOT);
+    switch (op->type) {
+        case IO_OP_RECV:
+        case IO_OP_SEND:
+        case IO_OP_CONNECT:
+            break;
+        case IO_OP_RECV_MULTISHOT:
+            if (!engine->buf_ring) {
+                return -1;
+            }
+            break;
+        default:
+            return -1;
+    }
+
+    pthread_mutex_lock(&engine->ring_lock);
+
+    io_uring_fd_slot_t *slot = uring_slot(engine, op->fd);
+    if (!slot) {
+        pthread_mutex_unlock(&engine->ring_lock);
+        return -1;
+    }
+
+    /* Replace this side's operation; a readiness wait switching sides
+     * (epoll MOD semantics) drops the old side as well */
+    int dir = uring_dir(op);
+    uring_cancel(engine, op->fd, slot, dir);
+    if (readiness && slot->op[!dir] == op) {
+        uring_cancel(engine, op->fd, slot, !dir);
+    }
+
+    struct io_uring_sqe *sqe = uring_get_sqe(engine);
+    if (!sqe) {
+        pthread_mutex_unlock(&engine->ring_lock);
+        return -1;
+    }
+
+    if (readiness) {
+        io_uring_prep_poll_add(sqe, op->fd, dir ? POLLOUT : POLLIN);
+    } else if (op->type == IO_OP_RECV) {
+        io_uring_prep_recv(sqe, op->fd, op->buf, op->len, 0);
+    } else if (op->type == IO_OP_RECV_MULTISHOT) {
+        io_uring_prep_recv_multishot(sqe, op->fd, NULL, 0, 0);
+        sqe->flags |= IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_BUF_GROUP;
+    } else if (engine->zero_copy && op->len >= IO_ENGINE_ZC_MIN_SEND) {
+        io_uring_prep_send_zc(sqe, op->fd, op->buf, op->len, MSG_NOSIGNAL, 0);
+    } else {
+        io_uring_prep_send(sqe, op->fd, op->buf, op->len, MSG_NOSIGNAL);
+    }
+    uring_use_fixed_file(engine, sqe, op->fd, slot);
+    io_uring_sqe_set_data64(sqe, URING_DATA(op->fd, slot->gen[dir], dir));
+
+    slot->op[dir] = op;
+    slot->active[dir] = true;
+    engine->ops_submitted++;
+
+    pthread_mutex_unlock(&engine->ring_lock);
+    return 0;
+}
+
+/**
+ * Stop watching a file descriptor - io_uring implementation
+ */
+static int io_engine_remove_uring(io_engine_t *engine, int fd) {
+    pthread_mutex_lock(&engine->ring_lock);
+    if ((size_t)fd < engine->fd_slot_count) {
+        io_uring_fd_slot_t *slot = &engine->fd_slots[fd];
+        uring_cancel(engine, fd, slot, 0);
+        uring_cancel(engine, fd, slot, 1);
+        if (slot->registered) {
+            int none = -1;
+            io_uring_register_files_update(engine->ring, (unsigned)fd, &none, 1);
+            slot->registered = false;
+        }
+    }
+    pthread_mutex_unlock(&engine->ring_lock);
+    return 0;
+}
+
+/* Deliver one CQE; returns 1 if a callback ran (ring_lock held) */
+static int uring_dispatch(io_engine_t *engine, struct io_uring_cqe *cqe) {
+    uint64_t data = io_uring_cqe_get_data64(cqe);
+    bool has_buffer = (cqe->flags & IORING_CQE_F_BUFFER) != 0;
+    uint16_t bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+    if (data == URING_DATA_IGNORE) {
+        return 0;
+    }
+
+    int fd = (int)(data >> 32);
+    uint32_t gen = (uint32_t)(data >> 1) & 0x7fffffffu;
+    int dir = (int)(data & 1);
+    io_uring_fd_slot_t *slot = (size_t)fd < engine->fd_slot_count ? &engine->fd_slots[fd] : NULL;
+    io_operation_t *op = slot ? slot->op[dir] : NULL;
+
+    if (!op || !slot->active[dir] || (slot->gen[dir] & 0x7fffffffu) != gen) {
+        /* Completion of a cancelled or replaced operation */
+        if (has_buffer) {
+            uring_recycle_buffer(engine, bid);
+        }
+        return 0;
+    }
+
+    bool more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+    bool notif = (cqe->flags & IORING_CQE_F_NOTIF) != 0;
+
+    if (op->type == IO_OP_SEND && more && !notif) {
+        /* SEND_ZC result; the callback waits for the buffer release notification */
+        op->result = cqe->res;
+        return 0;
+    }
+
+    if (!more) {
+        slot->active[dir] = false;
+    }
+
+    if (notif) {
+        engine->zero_copy_sends++;  /* op->result was set by the first CQE */
+    } else if (op->buf == NULL && op->type != IO_OP_RECV_MULTISHOT) {
+        /* Readiness: res is the poll mask */
+        op->result = (cqe->res < 0 || (cqe->res & (POLLERR | POLLHUP))) ? -1 : 0;
+    } else {
+        op->result = cqe->res;
+    }
+
+    if (op->result < 0) {
+        engine->ops_failed++;
+    } else {
+        engine->ops_completed++;
+    }
+
+    io_op_type_t type = op->type;
+    if (type == IO_OP_RECV_MULTISHOT) {
+        op->buf = has_buffer ? engine->ring_buffers[bid] : NULL;
+        op->buffer_id = bid;
+        if (has_buffer) {
+            engine->ring_buffer_recvs++;
+        }
+    }
+
+    /* The callback may resubmit, remove or free op */
+    if (op->callback) {
+        op->callback(op);
+    }
+
+    if (type == IO_OP_RECV_MULTISHOT && has_buffer) {
+        uring_recycle_buffer(engine, bid);
+    }
+    return 1;
+}
+
+/**
+ * Wait for I/O completions - io_uring implementation
+ */
+static int uring_wait_events(io_engine_t *engine, uint32_t timeout_ms) {
+    struct io_uring_cqe *cqe = NULL;
+    int ret;
+
+    /* Flush everything queued since the last wait in one system call */
+    pthread_mutex_lock(&engine->ring_lock);
+    io_uring_submit(engine->ring);
+    pthread_mutex_unlock(&engine->ring_lock);
+
+    if (timeout_ms == 0) {
+        ret = io_uring_peek_cqe(engine->ring, &cqe);
+    } else if (timeout_ms == UINT32_MAX) {
+        ret = io_uring_wait_cqe(engine->ring, &cqe);
+    } else {
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000LL;
+        ret = io_uring_wait_cqe_timeout(engine->ring, &cqe, &ts);
+    }
+    if (ret < 0 && ret != -ETIME && ret != -EAGAIN && ret != -EINTR) {
+        return -1;
+    }
+
+    int n = 0;
+    unsigned head;
+    unsigned seen = 0;
+
+    pthread_mutex_lock(&engine->ring_lock);
+    io_uring_for_each_cqe(engine->ring, head, cqe) {
+        seen++;
+        n += uring_dispatch(engine, cqe);
+    }
+    io_uring_cq_advance(engine->ring, seen);
+    pthread_mutex_unlock(&engine->ring_lock);
+
+    return n;
+}
 #endif
 
 /**
  * Create a new I/O engine
  */
 io_engine_t* io_engine_create(uint32_t queue_depth) {
+    return io_engine_create_ex(queue_depth, 0);
+}
+
+/**
+ * Create a new I/O engine with options
+ */
+io_engine_t* io_engine_create_ex(uint32_t queue_depth, uint32_t options) {
     if (queue_depth == 0) {
         queue_depth = DEFAULT_QUEUE_DEPTH;
     }
 
-    /* Try io_uring first on Linux */
+    /* io_uring on request: readiness-only users (reactor) stay on epoll */
 #ifdef HAVE_IO_URING
-    if (io_engine_has_uring()) {
-        io_engine_t *engine = io_engine_create_uring(queue_depth);
+    if ((options & IO_ENGINE_OPT_URING) && io_engine_has_uring()) {
+        io_engine_t *engine = io_engine_create_uring(queue_depth, options);
         if (engine) {
-            DEBUG_PRINT("[io_engine] Using io_uring (queue_depth=%u)\n", queue_depth);
+            DEBUG_PRINT("[io_engine] Using io_uring (queue_depth=%u, sqpoll=%d, zero_copy=%d)\n",
+                        queue_depth, engine->sqpoll, engine->zero_copy);
             return engine;
         }
     }
+#else
+    (void)options;
 #endif
 
     /* Try IOCP on Windows */
@@ -264,15 +609,31 @@ void io_engine_destroy(io_engine_t *engine) {
 
 #ifdef HAVE_IO_URING
     if (engine->type == IO_ENGINE_URING && engine->ring) {
+        if (engine->buf_ring) {
+            io_uring_free_buf_ring(engine->ring, engine->buf_ring,
+                                   engine->ring_buffer_count, URING_BUF_GROUP);
+        }
         io_uring_queue_exit(engine->ring);
         free(engine->ring);
         engine->ring = NULL;
+
+        for (uint32_t i = 0; i < engine->ring_buffer_count; i++) {
+            if (engine->ring_buffer_pool) {
+                buffer_pool_put((httpmorph_buffer_pool_t*)engine->ring_buffer_pool,
+                                engine->ring_buffers[i], engine->ring_buffer_alloc);
+            } else {
+                free(engine->ring_buffers[i]);
+            }
+        }
+        free(engine->ring_buffers);
+        free(engine->fd_slots);
+        pthread_mutex_destroy(&engine->ring_lock);
     }
 #endif
 
 #ifdef _WIN32
     if (engine->type == IO_ENGINE_IOCP && engine->iocp_handle) {
-        /* Stop the dispatcher thread first */
+        /* Stop the dispatcher threads first */
         iocp_dispatcher_stop(engine);
 
         /* Then close the IOCP handle */
@@ -386,6 +747,10 @@ int io_engine_submit(io_engine_t *engine, io_operation_t *op) {
     }
 
     switch (engine->type) {
+#ifdef HAVE_IO_URING
+        case IO_ENGINE_URING:
+            return io_engine_submit_uring(engine, op);
+#endif
 #ifdef __linux__
         case IO_ENGINE_EPOLL:
             return io_engine_submit_epoll(engine, op);
@@ -421,6 +786,44 @@ int io_engine_submit_batch(io_engine_t *engine, io_operation_t **ops, size_t cou
     return submitted;
 }
 
+/**
+ * Stop watching a file descriptor
+ */
+int io_engine_remove(io_engine_t *engine, int fd) {
+    if (!engine || fd < 0) {
+        return -1;
+    }
+
+    switch (engine->type) {
+#ifdef HAVE_IO_URING
+        case IO_ENGINE_URING:
+            return io_engine_remove_uring(engine, fd);
+#endif
+#ifdef __linux__
+        case IO_ENGINE_EPOLL: {
+            struct epoll_event ev = {0};  /* Non-NULL for kernels < 2.6.9 */
+            if (epoll_ctl(engine->engine_fd, EPOLL_CTL_DEL, fd, &ev) < 0 && errno != ENOENT) {
+                return -1;
+            }
+            return 0;
+        }
+#endif
+#ifdef __APPLE__
+        case IO_ENGINE_KQUEUE: {
+            /* One-shot filters may already be gone - ignore ENOENT */
+            struct kevent kev[2];
+            EV_SET(&kev[0], fd, EVFILT_READ, EV_DELETE, 0, 0, NULL);
+            EV_SET(&kev[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, NULL);
+            kevent(engine->engine_fd, &kev[0], 1, NULL, 0, NULL);
+            kevent(engine->engine_fd, &kev[1], 1, NULL, 0, NULL);
+            return 0;
+        }
+#endif
+        default:
+            return 0;  /* Nothing registered */
+    }
+}
+
 /**
  * Wait for I/O completions - epoll implementation
  */
@@ -509,18 +912,15 @@ static int kqueue_wait_events(io_engine_t *engine, uint32_t timeout_ms) {
 
 /**
  * Wait for I/O completions - IOCP implementation
- * Add sleep to allow I/O operations (including SSL handshakes) to progress
+ * Requests still step on every poll (TLS sockets aren't on the port), but
+ * the wait ends as soon as the dispatcher has handled a batch rather than
+ * always sleeping out the interval.
  */
 #ifdef _WIN32
 static int iocp_wait_events(io_engine_t *engine, uint32_t timeout_ms) {
-    (void)engine;  /* Unused */
-
-    /* Sleep to allow I/O operations to complete */
-    /* SSL operations especially need time for system-level I/O */
-    DWORD sleep_ms = (timeout_ms > 0 && timeout_ms < 50) ? timeout_ms : 50;
-    Sleep(sleep_ms);
-
-    return 0;  /* No specific events - requests will be stepped on next poll */
+    /* Cap the wait so SSL operations (plain socket I/O) keep progressing */
+    DWORD wait_ms = (timeout_ms > 0 && timeout_ms < 50) ? timeout_ms : 50;
+    return iocp_dispatcher_wait(engine, wait_ms);
 }
 #endif
 
@@ -533,6 +933,10 @@ int io_engine_wait(io_engine_t *engine, uint32_t timeout_ms) {
     }
 
     switch (engine->type) {
+#ifdef HAVE_IO_URING
+        case IO_ENGINE_URING:
+            return uring_wait_events(engine, timeout_ms);
+#endif
 #ifdef __linux__
         case IO_ENGINE_EPOLL:
             return epoll_wait_events(engine, timeout_ms);
@@ -563,6 +967,92 @@ int io_engine_process_completions(io_engine_t *engine) {
     return 0;
 }
 
+/**
+ * Give the engine a ring of receive buffers
+ */
+int io_engine_setup_buffer_ring(io_engine_t *engine, void *buffer_pool,
+                                uint32_t count, size_t size) {
+#ifdef HAVE_IO_URING
+    if (!engine || engine->type != IO_ENGINE_URING || engine->buf_ring ||
+        count == 0 || count > 32768 || (count & (count - 1)) != 0 ||
+        size == 0 || size > UINT32_MAX) {
+        return -1;
+    }
+
+    httpmorph_buffer_pool_t *pool = (httpmorph_buffer_pool_t*)buffer_pool;
+    void **buffers = calloc(count, sizeof(void*));
+    if (!buffers) {
+        return -1;
+    }
+
+    size_t alloc = size;
+    uint32_t got = 0;
+    for (; got < count; got++) {
+        buffers[got] = pool ? buffer_pool_get(pool, size, &alloc) : malloc(size);
+        if (!buffers[got]) {
+            break;
+        }
+    }
+
+    int ret = 0;
+    struct io_uring_buf_ring *br = NULL;
+    if (got == count) {
+        pthread_mutex_lock(&engine->ring_lock);
+        br = io_uring_setup_buf_ring(engine->ring, count, URING_BUF_GROUP, 0, &ret);
+        pthread_mutex_unlock(&engine->ring_lock);
+    }
+    if (!br) {
+        for (uint32_t i = 0; i < got; i++) {
+            if (pool) {
+                buffer_pool_put(pool, buffers[i], alloc);
+            } else {
+                free(buffers[i]);
+            }
+        }
+        free(buffers);
+        return -1;
+    }
+
+    int mask = io_uring_buf_ring_mask(count);
+    for (uint32_t i = 0; i < count; i++) {
+        io_uring_buf_ring_add(br, buffers[i], (unsigned)size, (unsigned short)i, mask, (int)i);
+    }
+    io_uring_buf_ring_advance(br, (int)count);
+
+    engine->buf_ring = br;
+    engine->ring_buffers = buffers;
+    engine->ring_buffer_count = count;
+    engine->ring_buffer_size = size;
+    engine->ring_buffer_alloc = alloc;
+    engine->ring_buffer_pool = pool;
+    return 0;
+#else
+    (void)engine;
+    (void)buffer_pool;
+    (void)count;
+    (void)size;
+    return -1;
+#endif
+}
+
+/**
+ * Get engine statistics
+ */
+void io_engine_get_stats(const io_engine_t *engine, io_engine_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!engine) {
+        return;
+    }
+    stats->ops_submitted = engine->ops_submitted;
+    stats->ops_completed = engine->ops_completed;
+    stats->ops_failed = engine->ops_failed;
+    stats->zero_copy_sends = engine->zero_copy_sends;
+    stats->ring_buffer_recvs = engine->ring_buffer_recvs;
+}
+
 /**
  * Create a non-blocking socket
  */
@@ -668,6 +1158,20 @@ io_operation_t* io_op_recv_create(
     return op;
 }
 
+io_operation_t* io_op_recv_multishot_create(
+    int sockfd,
+    void (*callback)(io_operation_t *op),
+    void *user_data)
+{
+    io_operation_t *op = io_op_create(IO_OP_RECV_MULTISHOT);
+    if (op) {
+        op->fd = sockfd;
+        op->callback = callback;
+        op->user_data = user_data;
+    }
+    return op;
+}
+
 io_operation_t* io_op_send_create(
     int sockfd,
     const void *buf,
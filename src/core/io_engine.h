@@ -23,6 +23,10 @@
     #include <sys/socket.h>
 #endif
 
+#ifdef HAVE_IO_URING
+    #include <pthread.h>
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -35,7 +39,12 @@ typedef enum {
     IO_ENGINE_IOCP,     /* IOCP (Windows) */
 } io_engine_type_t;
 
-/* I/O operation types */
+/* I/O operation types
+ *
+ * RECV/SEND/CONNECT with buf == NULL wait for readiness; the callback runs
+ * once the fd is readable/writable. On io_uring, RECV/SEND with a buffer
+ * do the transfer and report the byte count (or -errno) in result.
+ */
 typedef enum {
     IO_OP_ACCEPT,
     IO_OP_CONNECT,
@@ -43,8 +52,21 @@ typedef enum {
     IO_OP_SEND,
     IO_OP_CLOSE,
     IO_OP_TIMEOUT,
+    IO_OP_RECV_MULTISHOT,   /* io_uring: recv into ring buffers until cancelled */
 } io_op_type_t;
 
+/* io_engine_create_ex() options */
+#define IO_ENGINE_OPT_URING        0x01  /* Use io_uring when available */
+#define IO_ENGINE_OPT_SQPOLL       0x02  /* Kernel thread polls the submission queue */
+#define IO_ENGINE_OPT_ZERO_COPY    0x04  /* Large sends use IORING_OP_SEND_ZC */
+#define IO_ENGINE_OPT_FIXED_FILES  0x08  /* Register socket fds with the ring */
+
+/* Sends at least this large go zero-copy (smaller ones are cheaper to copy) */
+#define IO_ENGINE_ZC_MIN_SEND (16 * 1024)
+
+/* Registered file table size (fds at or above it stay unregistered) */
+#define IO_ENGINE_FIXED_FILES 4096
+
 /* I/O operation structure */
 typedef struct io_operation {
     io_op_type_t type;
@@ -57,6 +79,10 @@ typedef struct io_operation {
     /* Result */
     int result;
 
+    /* IO_OP_RECV_MULTISHOT: ring buffer holding this completion's data
+     * (buf/result), valid only during the callback */
+    uint16_t buffer_id;
+
     /* User data */
     void *user_data;
 
@@ -72,23 +98,46 @@ typedef struct io_engine {
     /* io_uring specific */
 #ifdef HAVE_IO_URING
     struct io_uring *ring;
+    struct io_uring_buf_ring *buf_ring;     /* Provided buffers for multishot recv */
+    void **ring_buffers;                    /* Buffer addresses, by buffer id */
+    uint32_t ring_buffer_count;
+    size_t ring_buffer_size;                /* Length handed to the kernel */
+    size_t ring_buffer_alloc;               /* Allocated size (for buffer_pool_put) */
+    void *ring_buffer_pool;                 /* httpmorph_buffer_pool_t the buffers came from */
+    struct io_uring_fd_slot *fd_slots;      /* Per-fd operations, indexed by fd */
+    size_t fd_slot_count;
+    bool fixed_files;
+    pthread_mutex_t ring_lock;              /* Submission queue and fd slots */
 #endif
 
     /* IOCP specific (Windows) */
 #ifdef _WIN32
     void *iocp_handle;  /* HANDLE for completion port */
+    void *iocp_dispatcher;  /* Completion dispatcher threads (iocp_dispatcher.c) */
 #endif
 
     /* Statistics */
     uint64_t ops_submitted;
     uint64_t ops_completed;
     uint64_t ops_failed;
+    uint64_t zero_copy_sends;
+    uint64_t ring_buffer_recvs;
 
     /* Configuration */
     uint32_t queue_depth;  /* io_uring queue depth */
     bool zero_copy;        /* Enable zero-copy operations */
+    bool sqpoll;           /* io_uring submission queue polling */
 } io_engine_t;
 
+/* Engine statistics */
+typedef struct {
+    uint64_t ops_submitted;
+    uint64_t ops_completed;
+    uint64_t ops_failed;
+    uint64_t zero_copy_sends;       /* Sends completed with IORING_OP_SEND_ZC */
+    uint64_t ring_buffer_recvs;     /* Multishot receives into ring buffers */
+} io_engine_stats_t;
+
 /* API */
 
 /**
@@ -97,6 +146,18 @@ typedef struct io_engine {
  */
 io_engine_t* io_engine_create(uint32_t queue_depth);
 
+/**
+ * Create a new I/O engine with options
+ * Without IO_ENGINE_OPT_URING (or when io_uring is unavailable) this
+ * behaves like io_engine_create(). The io_uring engine is not safe for
+ * concurrent io_engine_wait() callers and its callbacks must not call
+ * back into the engine.
+ *
+ * @param queue_depth Submission queue size (0 for default)
+ * @param options IO_ENGINE_OPT_* flags
+ */
+io_engine_t* io_engine_create_ex(uint32_t queue_depth, uint32_t options);
+
 /**
  * Destroy an I/O engine
  */
@@ -118,6 +179,13 @@ int io_engine_submit_batch(
     size_t count
 );
 
+/**
+ * Stop watching a file descriptor
+ * Must be called before the operation registered for fd is freed
+ * while the fd is still open. Returns 0 on success, -1 on error.
+ */
+int io_engine_remove(io_engine_t *engine, int fd);
+
 /**
  * Wait for I/O completions
  * Returns number of operations completed, -1 on error
@@ -135,6 +203,23 @@ int io_engine_wait(
  */
 int io_engine_process_completions(io_engine_t *engine);
 
+/**
+ * Give the engine a ring of receive buffers for IO_OP_RECV_MULTISHOT
+ * Buffers come from buffer_pool (an httpmorph_buffer_pool_t, NULL for
+ * malloc) and go back to it when the engine is destroyed.
+ * Returns 0 on success, -1 on error (or on engines other than io_uring)
+ *
+ * @param count Number of buffers (power of two, at most 32768)
+ * @param size Size of each buffer
+ */
+int io_engine_setup_buffer_ring(io_engine_t *engine, void *buffer_pool,
+                                uint32_t count, size_t size);
+
+/**
+ * Get engine statistics
+ */
+void io_engine_get_stats(const io_engine_t *engine, io_engine_stats_t *stats);
+
 /**
  * Get engine type name
  */
@@ -164,6 +249,17 @@ io_operation_t* io_op_recv_create(
     void *user_data
 );
 
+/**
+ * Create a multishot receive operation (io_uring with a buffer ring)
+ * The callback runs once per received chunk; a final call with
+ * result <= 0 means the operation ended and must be resubmitted.
+ */
+io_operation_t* io_op_recv_multishot_create(
+    int sockfd,
+    void (*callback)(io_operation_t *op),
+    void *user_data
+);
+
 /**
  * Create a send operation
  */
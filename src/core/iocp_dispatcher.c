@@ -7,9 +7,13 @@
 #include "iocp_dispatcher.h"
 #include "io_engine.h"
 #include "async_request.h"
+#include <winsock2.h>
 #include <windows.h>
+#include <ntsecapi.h>
+#include <malloc.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 
 /* Debug output control */
@@ -23,177 +27,255 @@
 #define IOCP_SHUTDOWN_KEY ((ULONG_PTR)-1)
 
 /**
- * Dispatcher state
+ * Dispatcher state (one per engine)
  */
 typedef struct {
     io_engine_t *engine;
-    HANDLE thread;
-    DWORD thread_id;
-    volatile bool running;
-    volatile bool shutdown_requested;
+    HANDLE threads[IOCP_DISPATCHER_MAX_THREADS];
+    uint32_t thread_count;
+    HANDLE wake_event;              /* Auto-reset, set after each batch */
+    volatile LONG64 batches;
+    volatile LONG64 completions;
 } iocp_dispatcher_state_t;
 
-/* Global dispatcher state (one per engine) */
-static iocp_dispatcher_state_t *dispatcher_state = NULL;
+/**
+ * Cached OVERLAPPED: the list link overlays the structure while it is cached
+ */
+typedef union {
+    SLIST_ENTRY entry;
+    OVERLAPPED overlapped;
+} iocp_overlapped_node_t;
+
+/* Zero-initialized, which is what InitializeSListHead() would leave */
+static SLIST_HEADER overlapped_cache;
+
+/**
+ * Dispatch one dequeued completion to its request
+ */
+static void dispatch_completion(OVERLAPPED_ENTRY *entry) {
+    /* completion_key is the async_request_t pointer */
+    async_request_t *request = (async_request_t*)entry->lpCompletionKey;
+
+    if (request == NULL || entry->lpOverlapped == NULL) {
+        DEBUG_PRINT("[iocp_dispatcher] WARNING: completion without a request\n");
+        return;
+    }
+
+    /* Internal holds the operation's NTSTATUS */
+    DWORD error = 0;
+    if (entry->lpOverlapped->Internal != 0) {
+        error = LsaNtStatusToWinError((NTSTATUS)entry->lpOverlapped->Internal);
+    }
+    DWORD bytes_transferred = entry->dwNumberOfBytesTransferred;
+
+    DEBUG_PRINT("[iocp_dispatcher] Completion: request=%p, bytes=%lu, error=%lu, overlapped=%p\n",
+           request, bytes_transferred, error, entry->lpOverlapped);
+
+    /* Store completion info in request */
+    request->iocp_last_error = error;
+    request->iocp_bytes_transferred = bytes_transferred;
+    request->iocp_operation_pending = false;
+
+    /* Signal the request that operation completed */
+    if (request->iocp_completion_event) {
+        SetEvent((HANDLE)request->iocp_completion_event);
+    }
+
+    /* Call completion callback if registered */
+    if (request->iocp_completion_callback) {
+        request->iocp_completion_callback(request, bytes_transferred, error);
+    }
+}
 
 /**
  * Dispatcher thread main function
  */
 static DWORD WINAPI iocp_dispatcher_thread(LPVOID param) {
     iocp_dispatcher_state_t *state = (iocp_dispatcher_state_t*)param;
-    io_engine_t *engine = state->engine;
+    HANDLE port = (HANDLE)state->engine->iocp_handle;
+    OVERLAPPED_ENTRY entries[IOCP_DISPATCHER_BATCH];
 
     DEBUG_PRINT("[iocp_dispatcher] Thread started (tid=%lu)\n", GetCurrentThreadId());
 
-    while (!state->shutdown_requested) {
-        DWORD bytes_transferred = 0;
-        ULONG_PTR completion_key = 0;
-        OVERLAPPED *overlapped = NULL;
-
-        /* Block waiting for completion (INFINITE timeout) */
-        BOOL result = GetQueuedCompletionStatus(
-            (HANDLE)engine->iocp_handle,
-            &bytes_transferred,
-            &completion_key,
-            &overlapped,
-            INFINITE  /* Block until completion */
-        );
-
-        /* Check for shutdown signal */
-        if (completion_key == IOCP_SHUTDOWN_KEY) {
-            DEBUG_PRINT("[iocp_dispatcher] Shutdown signal received\n");
-            break;
-        }
-
-        /* Get error if operation failed */
-        DWORD error = 0;
-        if (!result && overlapped != NULL) {
-            error = GetLastError();
-        } else if (!result) {
-            /* GetQueuedCompletionStatus itself failed */
-            error = GetLastError();
-            DEBUG_PRINT("[iocp_dispatcher] GetQueuedCompletionStatus failed: %lu\n", error);
+    for (;;) {
+        ULONG count = 0;
+
+        /* Block until at least one completion, then take all that are queued */
+        if (!GetQueuedCompletionStatusEx(port, entries, IOCP_DISPATCHER_BATCH,
+                                         &count, INFINITE, FALSE)) {
+            DWORD error = GetLastError();
+            DEBUG_PRINT("[iocp_dispatcher] GetQueuedCompletionStatusEx failed: %lu\n", error);
+            if (error == ERROR_ABANDONED_WAIT_0 || error == ERROR_INVALID_HANDLE) {
+                break;  /* Port closed underneath us */
+            }
             continue;
         }
 
-        /* completion_key is the async_request_t pointer */
-        async_request_t *request = (async_request_t*)completion_key;
-
-        if (request == NULL) {
-            DEBUG_PRINT("[iocp_dispatcher] WARNING: NULL request for completion\n");
-            continue;
+        ULONG shutdowns = 0;
+        for (ULONG i = 0; i < count; i++) {
+            /* Check for shutdown signal (one per thread; finish the batch first) */
+            if (entries[i].lpCompletionKey == IOCP_SHUTDOWN_KEY) {
+                shutdowns++;
+                continue;
+            }
+            dispatch_completion(&entries[i]);
         }
 
-        DEBUG_PRINT("[iocp_dispatcher] Completion: request=%p, bytes=%lu, error=%lu, overlapped=%p\n",
-               request, bytes_transferred, error, overlapped);
+        InterlockedIncrement64(&state->batches);
+        InterlockedAdd64(&state->completions, (LONG64)(count - shutdowns));
+        InterlockedAdd64((volatile LONG64*)&state->engine->ops_completed, (LONG64)(count - shutdowns));
 
-        /* Store completion info in request */
-        request->iocp_last_error = error;
-        request->iocp_bytes_transferred = bytes_transferred;
-        request->iocp_operation_pending = false;
+        /* Wake the event loop once for the whole batch */
+        SetEvent(state->wake_event);
 
-        /* Signal the request that operation completed */
-        if (request->iocp_completion_event) {
-            SetEvent((HANDLE)request->iocp_completion_event);
-        }
-
-        /* Call completion callback if registered */
-        if (request->iocp_completion_callback) {
-            request->iocp_completion_callback(request, bytes_transferred, error);
+        if (shutdowns > 0) {
+            /* Hand signals meant for other threads back to the port */
+            for (ULONG i = 1; i < shutdowns; i++) {
+                PostQueuedCompletionStatus(port, 0, IOCP_SHUTDOWN_KEY, NULL);
+            }
+            DEBUG_PRINT("[iocp_dispatcher] Shutdown signal received\n");
+            break;
         }
     }
 
     DEBUG_PRINT("[iocp_dispatcher] Thread exiting\n");
-    state->running = false;
     return 0;
 }
 
 /**
- * Start the IOCP dispatcher thread
+ * Number of dispatcher threads to run by default
+ */
+static uint32_t default_thread_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    uint32_t n = (uint32_t)info.dwNumberOfProcessors;
+    if (n < 1) {
+        n = 1;
+    }
+    return n < IOCP_DISPATCHER_MAX_THREADS ? n : IOCP_DISPATCHER_MAX_THREADS;
+}
+
+/**
+ * Start the IOCP dispatcher threads
  */
-int iocp_dispatcher_start(io_engine_t *engine) {
+int iocp_dispatcher_start(io_engine_t *engine, uint32_t threads) {
     if (engine == NULL || engine->iocp_handle == NULL) {
         return -1;
     }
 
     /* Check if already running */
-    if (dispatcher_state != NULL && dispatcher_state->running) {
+    if (engine->iocp_dispatcher != NULL) {
         DEBUG_PRINT("[iocp_dispatcher] Already running\n");
         return 0;
     }
 
-    /* Allocate state */
-    if (dispatcher_state == NULL) {
-        dispatcher_state = (iocp_dispatcher_state_t*)calloc(1, sizeof(iocp_dispatcher_state_t));
-        if (dispatcher_state == NULL) {
-            return -1;
-        }
+    if (threads == 0) {
+        threads = default_thread_count();
+    } else if (threads > IOCP_DISPATCHER_MAX_THREADS) {
+        threads = IOCP_DISPATCHER_MAX_THREADS;
     }
 
-    dispatcher_state->engine = engine;
-    dispatcher_state->running = false;
-    dispatcher_state->shutdown_requested = false;
-
-    /* Create dispatcher thread */
-    dispatcher_state->thread = CreateThread(
-        NULL,                          /* Security attributes */
-        0,                             /* Stack size (default) */
-        iocp_dispatcher_thread,        /* Thread function */
-        dispatcher_state,              /* Parameter */
-        0,                             /* Creation flags */
-        &dispatcher_state->thread_id   /* Thread ID */
-    );
+    iocp_dispatcher_state_t *state = (iocp_dispatcher_state_t*)calloc(1, sizeof(iocp_dispatcher_state_t));
+    if (state == NULL) {
+        return -1;
+    }
+    state->engine = engine;
 
-    if (dispatcher_state->thread == NULL) {
-        DEBUG_PRINT("[iocp_dispatcher] Failed to create thread: %lu\n", GetLastError());
-        free(dispatcher_state);
-        dispatcher_state = NULL;
+    state->wake_event = CreateEvent(NULL, FALSE, FALSE, NULL);
+    if (state->wake_event == NULL) {
+        free(state);
         return -1;
     }
 
-    dispatcher_state->running = true;
-    DEBUG_PRINT("[iocp_dispatcher] Started successfully (tid=%lu)\n", dispatcher_state->thread_id);
+    /* Published before the threads start: they read the engine, not the field */
+    engine->iocp_dispatcher = state;
+
+    for (uint32_t i = 0; i < threads; i++) {
+        state->threads[i] = CreateThread(NULL, 0, iocp_dispatcher_thread, state, 0, NULL);
+        if (state->threads[i] == NULL) {
+            DEBUG_PRINT("[iocp_dispatcher] Failed to create thread: %lu\n", GetLastError());
+            break;
+        }
+        state->thread_count++;
+    }
+
+    if (state->thread_count == 0) {
+        engine->iocp_dispatcher = NULL;
+        CloseHandle(state->wake_event);
+        free(state);
+        return -1;
+    }
 
+    DEBUG_PRINT("[iocp_dispatcher] Started %u thread(s)\n", state->thread_count);
     return 0;
 }
 
 /**
- * Stop the IOCP dispatcher thread
+ * Stop the IOCP dispatcher threads
  */
 void iocp_dispatcher_stop(io_engine_t *engine) {
-    if (dispatcher_state == NULL || !dispatcher_state->running) {
+    if (engine == NULL || engine->iocp_dispatcher == NULL) {
         return;
     }
+    iocp_dispatcher_state_t *state = (iocp_dispatcher_state_t*)engine->iocp_dispatcher;
 
     DEBUG_PRINT("[iocp_dispatcher] Stopping...\n");
 
-    /* Request shutdown */
-    dispatcher_state->shutdown_requested = true;
-
-    /* Post shutdown completion to wake up thread */
-    PostQueuedCompletionStatus(
-        (HANDLE)engine->iocp_handle,
-        0,
-        IOCP_SHUTDOWN_KEY,
-        NULL
-    );
+    /* One shutdown packet per thread; each thread exits after the first it sees */
+    for (uint32_t i = 0; i < state->thread_count; i++) {
+        PostQueuedCompletionStatus((HANDLE)engine->iocp_handle, 0, IOCP_SHUTDOWN_KEY, NULL);
+    }
 
-    /* Wait for thread to exit (max 5 seconds) */
-    DWORD wait_result = WaitForSingleObject(dispatcher_state->thread, 5000);
+    /* Wait for threads to exit (max 5 seconds) */
+    DWORD wait_result = WaitForMultipleObjects(state->thread_count, state->threads, TRUE, 5000);
 
-    if (wait_result == WAIT_TIMEOUT) {
-        DEBUG_PRINT("[iocp_dispatcher] WARNING: Thread did not exit cleanly, terminating\n");
-        TerminateThread(dispatcher_state->thread, 1);
+    for (uint32_t i = 0; i < state->thread_count; i++) {
+        if (wait_result == WAIT_TIMEOUT &&
+            WaitForSingleObject(state->threads[i], 0) == WAIT_TIMEOUT) {
+            DEBUG_PRINT("[iocp_dispatcher] WARNING: Thread did not exit cleanly, terminating\n");
+            TerminateThread(state->threads[i], 1);
+        }
+        CloseHandle(state->threads[i]);
     }
 
     /* Cleanup */
-    CloseHandle(dispatcher_state->thread);
-    free(dispatcher_state);
-    dispatcher_state = NULL;
+    CloseHandle(state->wake_event);
+    engine->iocp_dispatcher = NULL;
+    free(state);
 
     DEBUG_PRINT("[iocp_dispatcher] Stopped\n");
 }
 
+/**
+ * Wait for the next batch of completions
+ */
+int iocp_dispatcher_wait(io_engine_t *engine, uint32_t timeout_ms) {
+    iocp_dispatcher_state_t *state = engine ? (iocp_dispatcher_state_t*)engine->iocp_dispatcher : NULL;
+    if (state == NULL) {
+        Sleep(timeout_ms);
+        return 0;
+    }
+    return WaitForSingleObject(state->wake_event, timeout_ms) == WAIT_OBJECT_0 ? 1 : 0;
+}
+
+/**
+ * Read the dispatcher statistics
+ */
+void iocp_dispatcher_get_stats(io_engine_t *engine, iocp_dispatcher_stats_t *stats) {
+    if (stats == NULL) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+
+    iocp_dispatcher_state_t *state = engine ? (iocp_dispatcher_state_t*)engine->iocp_dispatcher : NULL;
+    if (state == NULL) {
+        return;
+    }
+    stats->threads = state->thread_count;
+    stats->batches = (uint64_t)InterlockedCompareExchange64(&state->batches, 0, 0);
+    stats->completions = (uint64_t)InterlockedCompareExchange64(&state->completions, 0, 0);
+}
+
 /**
  * Register completion callback for a request
  */
@@ -217,8 +299,7 @@ void iocp_dispatcher_unregister_callback(async_request_t *request) {
  * Check if dispatcher is running
  */
 bool iocp_dispatcher_is_running(io_engine_t *engine) {
-    (void)engine; /* Unused */
-    return dispatcher_state != NULL && dispatcher_state->running;
+    return engine != NULL && engine->iocp_dispatcher != NULL;
 }
 
 /**
@@ -241,4 +322,88 @@ int iocp_dispatcher_post_completion(io_engine_t *engine,
     return result ? 0 : -1;
 }
 
+/**
+ * Get a zeroed OVERLAPPED
+ */
+void* iocp_overlapped_get(void) {
+    iocp_overlapped_node_t *node = (iocp_overlapped_node_t*)InterlockedPopEntrySList(&overlapped_cache);
+    if (node == NULL) {
+        /* List entries must be aligned for the interlocked list operations */
+        node = (iocp_overlapped_node_t*)_aligned_malloc(sizeof(iocp_overlapped_node_t),
+                                                        MEMORY_ALLOCATION_ALIGNMENT);
+        if (node == NULL) {
+            return NULL;
+        }
+    }
+    /* For IOCP, hEvent stays NULL - completions go to the port */
+    memset(node, 0, sizeof(*node));
+    return &node->overlapped;
+}
+
+/**
+ * Release an OVERLAPPED
+ */
+void iocp_overlapped_put(void *overlapped) {
+    if (overlapped == NULL) {
+        return;
+    }
+    iocp_overlapped_node_t *node = (iocp_overlapped_node_t*)overlapped;
+
+    /* The depth is approximate under contention, which is fine for a cap */
+    if (QueryDepthSList(&overlapped_cache) >= IOCP_OVERLAPPED_CACHE) {
+        _aligned_free(node);
+        return;
+    }
+    InterlockedPushEntrySList(&overlapped_cache, &node->entry);
+}
+
+/**
+ * Whether every TCP provider hands out IFS handles
+ * A layered (non-IFS) provider may still queue a packet for an inline
+ * success, so skipping is only enabled when none is installed.
+ */
+static bool tcp_providers_are_ifs(void) {
+    static volatile LONG checked = 0;   /* 0 = unknown, 1 = yes, 2 = no */
+    LONG result = InterlockedCompareExchange(&checked, 0, 0);
+    if (result != 0) {
+        return result == 1;
+    }
+
+    INT protocols[] = { IPPROTO_TCP, 0 };
+    DWORD size = 0;
+    result = 2;
+    if (WSAEnumProtocolsW(protocols, NULL, &size) == SOCKET_ERROR &&
+        WSAGetLastError() == WSAENOBUFS) {
+        WSAPROTOCOL_INFOW *info = (WSAPROTOCOL_INFOW*)malloc(size);
+        if (info) {
+            int count = WSAEnumProtocolsW(protocols, info, &size);
+            if (count > 0) {
+                result = 1;
+                for (int i = 0; i < count; i++) {
+                    if (!(info[i].dwServiceFlags1 & XP1_IFS_HANDLES)) {
+                        result = 2;
+                        break;
+                    }
+                }
+            }
+            free(info);
+        }
+    }
+
+    InterlockedExchange(&checked, result);
+    return result == 1;
+}
+
+/**
+ * Skip completion packets for operations that succeed immediately
+ */
+bool iocp_skip_completion_on_success(int sockfd) {
+    if (!tcp_providers_are_ifs()) {
+        return false;
+    }
+    return SetFileCompletionNotificationModes((HANDLE)(SOCKET)sockfd,
+                                              FILE_SKIP_COMPLETION_PORT_ON_SUCCESS |
+                                              FILE_SKIP_SET_EVENT_ON_HANDLE) != 0;
+}
+
 #endif /* _WIN32 */
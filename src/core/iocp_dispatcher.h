@@ -2,8 +2,10 @@
  * IOCP Completion Dispatcher for Windows Async I/O
  *
  * Provides centralized completion handling for Windows IOCP operations.
- * Runs a dedicated thread that blocks on GetQueuedCompletionStatus and
- * dispatches completions to the appropriate async_request.
+ * Each engine runs a small pool of threads that dequeue completions in
+ * batches with GetQueuedCompletionStatusEx and dispatch them to the
+ * appropriate async_request, then wake the engine's event loop once per
+ * batch. OVERLAPPED structures come from a lock-free process-wide cache.
  */
 
 #ifndef IOCP_DISPATCHER_H
@@ -14,6 +16,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+/* Completions dequeued per GetQueuedCompletionStatusEx call */
+#define IOCP_DISPATCHER_BATCH 64
+
+/* Dispatcher threads per engine (at most; fewer on machines with fewer CPUs) */
+#define IOCP_DISPATCHER_MAX_THREADS 4
+
+/* OVERLAPPED structures kept for reuse after release */
+#define IOCP_OVERLAPPED_CACHE 256
+
 /* Forward declarations */
 typedef struct io_engine io_engine_t;
 typedef struct async_request async_request_t;
@@ -31,20 +42,47 @@ typedef void (*iocp_completion_callback_t)(async_request_t *request,
                                            uint32_t error);
 
 /**
- * Initialize and start the IOCP dispatcher thread
+ * Dispatcher statistics
+ */
+typedef struct {
+    uint32_t threads;        /* Dispatcher threads running */
+    uint64_t batches;        /* GetQueuedCompletionStatusEx calls that returned completions */
+    uint64_t completions;    /* Completions dispatched */
+} iocp_dispatcher_stats_t;
+
+/**
+ * Initialize and start the IOCP dispatcher threads
  *
  * @param engine The I/O engine with IOCP handle
+ * @param threads Number of threads, or 0 for one per CPU up to IOCP_DISPATCHER_MAX_THREADS
  * @return 0 on success, -1 on failure
  */
-int iocp_dispatcher_start(io_engine_t *engine);
+int iocp_dispatcher_start(io_engine_t *engine, uint32_t threads);
 
 /**
- * Stop the IOCP dispatcher thread and cleanup
+ * Stop the IOCP dispatcher threads and cleanup
  *
  * @param engine The I/O engine
  */
 void iocp_dispatcher_stop(io_engine_t *engine);
 
+/**
+ * Wait until a batch of completions has been dispatched
+ *
+ * @param engine The I/O engine
+ * @param timeout_ms Maximum time to wait
+ * @return 1 if completions were dispatched, 0 on timeout
+ */
+int iocp_dispatcher_wait(io_engine_t *engine, uint32_t timeout_ms);
+
+/**
+ * Read the dispatcher statistics
+ *
+ * @param engine The I/O engine
+ * @param stats Output statistics (zeroed if the dispatcher is not running)
+ */
+void iocp_dispatcher_get_stats(io_engine_t *engine, iocp_dispatcher_stats_t *stats);
+
 /**
  * Register a completion callback for a request
  * Called when initiating an async operation
@@ -67,7 +105,7 @@ void iocp_dispatcher_unregister_callback(async_request_t *request);
  * Check if dispatcher is running
  *
  * @param engine The I/O engine
- * @return true if dispatcher thread is running
+ * @return true if dispatcher threads are running
  */
 bool iocp_dispatcher_is_running(io_engine_t *engine);
 
@@ -84,5 +122,32 @@ int iocp_dispatcher_post_completion(io_engine_t *engine,
                                     uintptr_t completion_key,
                                     uint32_t bytes_transferred);
 
+/**
+ * Get a zeroed OVERLAPPED structure (from the cache when possible)
+ * Thread-safe.
+ *
+ * @return OVERLAPPED*, or NULL on allocation failure
+ */
+void* iocp_overlapped_get(void);
+
+/**
+ * Release an OVERLAPPED structure once no operation uses it
+ * Thread-safe. NULL is ignored.
+ *
+ * @param overlapped Structure from iocp_overlapped_get()
+ */
+void iocp_overlapped_put(void *overlapped);
+
+/**
+ * Stop posting completion packets for operations that succeed immediately
+ * Sets FILE_SKIP_COMPLETION_PORT_ON_SUCCESS on a socket associated with
+ * the port, so an inline success can't leave a stale packet behind to
+ * signal the next operation early. Not every socket provider supports it.
+ *
+ * @param sockfd Socket associated with the completion port
+ * @return true if immediate successes will no longer be queued
+ */
+bool iocp_skip_completion_on_success(int sockfd);
+
 #endif /* _WIN32 */
 #endif /* IOCP_DISPATCHER_H */
@@ -0,0 +1,263 @@
+/**
+ * ktls.c - Kernel TLS receive offload
+ *
+ * TLS 1.3 keys come from the server traffic secret (RFC 8446 section 7.3),
+ * TLS 1.2 keys from the key block (RFC 5246 section 6.3); either way the
+ * kernel also needs the number of the next record it will see, which is
+ * the SSL object's read sequence at the switch.
+ */
+
+#include "ktls.h"
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <openssl/ssl.h>
+
+#if defined(__linux__) && defined(OPENSSL_IS_BORINGSSL)
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <linux/tls.h>
+#include <openssl/evp.h>
+#include <openssl/hkdf.h>
+#include <openssl/mem.h>
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+/* C wrapper for bssl::SSL_get_traffic_secrets (boringssl_wrapper.cc) */
+extern int httpmorph_get_read_traffic_secret(const SSL *ssl, const uint8_t **secret, size_t *len);
+
+/* TLS record content types and handshake message types */
+#define RECORD_ALERT            21
+#define RECORD_HANDSHAKE        22
+#define RECORD_APPLICATION_DATA 23
+#define HANDSHAKE_NEW_SESSION_TICKET 4
+
+/* Largest key and IV of the offloaded suites */
+#define KTLS_MAX_KEY 32
+#define KTLS_MAX_IV  12
+
+typedef union {
+    struct tls_crypto_info info;
+    struct tls12_crypto_info_aes_gcm_128 aes_gcm_128;
+    struct tls12_crypto_info_aes_gcm_256 aes_gcm_256;
+    struct tls12_crypto_info_chacha20_poly1305 chacha20_poly1305;
+} ktls_crypto_info_t;
+
+/**
+ * HKDF-Expand-Label with an empty context (RFC 8446 section 7.1)
+ */
+static bool expand_label(const EVP_MD *md, const uint8_t *secret, size_t secret_len,
+                         const char *label, uint8_t *out, size_t out_len) {
+    uint8_t info[2 + 1 + 6 + 16 + 1];
+    size_t label_len = strlen(label);
+    size_t n = 0;
+    info[n++] = (uint8_t)(out_len >> 8);
+    info[n++] = (uint8_t)out_len;
+    info[n++] = (uint8_t)(6 + label_len);
+    memcpy(info + n, "tls13 ", 6);
+    n += 6;
+    memcpy(info + n, label, label_len);
+    n += label_len;
+    info[n++] = 0;
+    return HKDF_expand(out, out_len, md, secret, secret_len, info, n) == 1;
+}
+
+/**
+ * Get the server's write key and IV for the current epoch
+ */
+static bool server_keys(SSL *ssl, uint16_t suite, size_t key_len, size_t iv_len,
+                        uint8_t *key, uint8_t *iv) {
+    if (SSL_version(ssl) == TLS1_3_VERSION) {
+        const uint8_t *secret = NULL;
+        size_t secret_len = 0;
+        if (!httpmorph_get_read_traffic_secret(ssl, &secret, &secret_len)) {
+            return false;
+        }
+        const EVP_MD *md = suite == 0x1302 ? EVP_sha384() : EVP_sha256();
+        return expand_label(md, secret, secret_len, "key", key, key_len) &&
+               expand_label(md, secret, secret_len, "iv", iv, KTLS_MAX_IV);
+    }
+
+    /* AEAD suites have no MAC keys: client key, server key, client IV, server IV */
+    uint8_t block[2 * (KTLS_MAX_KEY + KTLS_MAX_IV)];
+    size_t block_len = SSL_get_key_block_len(ssl);
+    if (block_len != 2 * (key_len + iv_len) ||
+        !SSL_generate_key_block(ssl, block, block_len)) {
+        return false;
+    }
+    memcpy(key, block + key_len, key_len);
+    memcpy(iv, block + 2 * key_len + iv_len, iv_len);
+    OPENSSL_cleanse(block, sizeof(block));
+    return true;
+}
+
+/**
+ * Fill in the kernel's view of the server's direction
+ * @return Size of the filled structure, 0 if the suite can't be offloaded
+ */
+static size_t crypto_info_build(SSL *ssl, ktls_crypto_info_t *ci) {
+    const SSL_CIPHER *cipher = SSL_get_current_cipher(ssl);
+    if (!cipher) {
+        return 0;
+    }
+    uint16_t suite = SSL_CIPHER_get_protocol_id(cipher);
+    bool tls13 = SSL_version(ssl) == TLS1_3_VERSION;
+    if (!tls13 && SSL_version(ssl) != TLS1_2_VERSION) {
+        return 0;
+    }
+
+    uint16_t type;
+    size_t key_len;
+    switch (suite) {
+        case 0x1301: case 0xC02B: case 0xC02F:  /* AES_128_GCM */
+            type = TLS_CIPHER_AES_GCM_128;
+            key_len = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+            break;
+        case 0x1302: case 0xC02C: case 0xC030:  /* AES_256_GCM */
+            type = TLS_CIPHER_AES_GCM_256;
+            key_len = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+            break;
+        case 0x1303: case 0xCCA8: case 0xCCA9:  /* CHACHA20_POLY1305 */
+            type = TLS_CIPHER_CHACHA20_POLY1305;
+            key_len = TLS_CIPHER_CHACHA20_POLY1305_KEY_SIZE;
+            break;
+        default:
+            return 0;
+    }
+    /* TLS 1.2 GCM derives only the 4-byte salt; the rest of the nonce is sent */
+    size_t iv_len = (!tls13 && type != TLS_CIPHER_CHACHA20_POLY1305) ? 4 : KTLS_MAX_IV;
+
+    uint8_t key[KTLS_MAX_KEY];
+    uint8_t iv[KTLS_MAX_IV];
+    if (!server_keys(ssl, suite, key_len, iv_len, key, iv)) {
+        return 0;
+    }
+
+    uint8_t seq[8];
+    uint64_t next = SSL_get_read_sequence(ssl);
+    for (int i = 7; i >= 0; i--) {
+        seq[i] = (uint8_t)next;
+        next >>= 8;
+    }
+
+    size_t size;
+    memset(ci, 0, sizeof(*ci));
+    ci->info.version = tls13 ? TLS_1_3_VERSION : TLS_1_2_VERSION;
+    ci->info.cipher_type = type;
+    if (type == TLS_CIPHER_CHACHA20_POLY1305) {
+        memcpy(ci->chacha20_poly1305.key, key, key_len);
+        memcpy(ci->chacha20_poly1305.iv, iv, KTLS_MAX_IV);
+        memcpy(ci->chacha20_poly1305.rec_seq, seq, sizeof(seq));
+        size = sizeof(ci->chacha20_poly1305);
+    } else {
+        /* GCM: 4-byte salt, then the rest of the nonce (TLS 1.2: per record) */
+        struct tls12_crypto_info_aes_gcm_128 *gcm128 = &ci->aes_gcm_128;
+        struct tls12_crypto_info_aes_gcm_256 *gcm256 = &ci->aes_gcm_256;
+        const uint8_t *explicit_iv = tls13 ? iv + 4 : seq;
+        if (type == TLS_CIPHER_AES_GCM_128) {
+            memcpy(gcm128->key, key, key_len);
+            memcpy(gcm128->salt, iv, 4);
+            memcpy(gcm128->iv, explicit_iv, 8);
+            memcpy(gcm128->rec_seq, seq, sizeof(seq));
+            size = sizeof(*gcm128);
+        } else {
+            memcpy(gcm256->key, key, key_len);
+            memcpy(gcm256->salt, iv, 4);
+            memcpy(gcm256->iv, explicit_iv, 8);
+            memcpy(gcm256->rec_seq, seq, sizeof(seq));
+            size = sizeof(*gcm256);
+        }
+    }
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(iv, sizeof(iv));
+    return size;
+}
+
+int ktls_enable_rx(SSL *ssl, int sockfd) {
+    /* Bytes already taken off the socket would never reach the kernel */
+    if (!ssl || sockfd < 0 || SSL_has_pending(ssl)) {
+        return -1;
+    }
+
+    ktls_crypto_info_t ci;
+    size_t size = crypto_info_build(ssl, &ci);
+    if (size == 0) {
+        return -1;
+    }
+
+    /* Without TLS_RX the socket keeps behaving as plain TCP, so a failure
+     * after the ULP is attached still leaves SSL_read() working */
+    int rc = -1;
+    if (setsockopt(sockfd, IPPROTO_TCP, TCP_ULP, "tls", sizeof("tls")) == 0 &&
+        setsockopt(sockfd, SOL_TLS, TLS_RX, &ci, (socklen_t)size) == 0) {
+        rc = 0;
+    }
+    OPENSSL_cleanse(&ci, sizeof(ci));
+    return rc;
+}
+
+int ktls_recv(int sockfd, void *buf, size_t len) {
+    if (len > INT32_MAX) {
+        len = INT32_MAX;
+    }
+
+    for (;;) {
+        char control[CMSG_SPACE(sizeof(unsigned char))];
+        struct iovec iov = { buf, len };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        ssize_t n = recvmsg(sockfd, &msg, 0);
+        if (n <= 0) {
+            return (int)n;
+        }
+
+        /* Every record comes with its type; application data is the usual case */
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        if (!cmsg || cmsg->cmsg_level != SOL_TLS || cmsg->cmsg_type != TLS_GET_RECORD_TYPE) {
+            return (int)n;
+        }
+        unsigned char type = *CMSG_DATA(cmsg);
+        const uint8_t *record = buf;
+        if (type == RECORD_APPLICATION_DATA) {
+            return (int)n;
+        }
+        if (type == RECORD_HANDSHAKE && record[0] == HANDSHAKE_NEW_SESSION_TICKET) {
+            continue;  /* A late ticket: the connection isn't resumed from anyway */
+        }
+        if (type == RECORD_ALERT && n >= 2 && record[1] == 0) {
+            return 0;  /* close_notify */
+        }
+        errno = type == RECORD_ALERT ? ECONNRESET : EPROTO;
+        return -1;
+    }
+}
+
+#else
+
+int ktls_enable_rx(SSL *ssl, int sockfd) {
+    (void)ssl;
+    (void)sockfd;
+    return -1;
+}
+
+int ktls_recv(int sockfd, void *buf, size_t len) {
+    (void)sockfd;
+    (void)buf;
+    (void)len;
+    errno = ENOTSUP;
+    return -1;
+}
+
+#endif
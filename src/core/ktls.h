@@ -0,0 +1,63 @@
+/**
+ * ktls.h - Kernel TLS receive offload
+ *
+ * Once a handshake is done, the keys for the server's direction can be
+ * handed to the Linux kernel (TCP_ULP "tls"), which then decrypts records
+ * itself: plain recv() returns plaintext, one copy less than SSL_read()
+ * into our own buffers. Only AES-GCM and ChaCha20-Poly1305 suites are
+ * offloaded. Requests still send through the SSL object, which keeps the
+ * write direction; the read side of the SSL object is stale afterwards,
+ * so an offloaded connection is never reused.
+ *
+ * Everything here reports failure elsewhere (other platforms, or builds
+ * without BoringSSL), and callers keep using SSL_read().
+ */
+
+#ifndef HTTPMORPH_KTLS_H
+#define HTTPMORPH_KTLS_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Forward declarations (avoid including OpenSSL headers here)
+ */
+typedef struct ssl_st SSL;
+
+/* Body bytes still to come before offloading pays for its two setsockopt()s */
+#define KTLS_MIN_BODY (128 * 1024)
+
+/**
+ * Hand the server's direction of a connection to the kernel
+ *
+ * Must be called between records: fails without changing anything if the
+ * SSL object holds bytes it has read but not returned, if the suite can't
+ * be offloaded, or if the kernel lacks TLS support.
+ *
+ * @param ssl Connection after a completed handshake
+ * @param sockfd Its socket
+ * @return 0 on success (read with ktls_recv() from now on), -1 otherwise
+ */
+int ktls_enable_rx(SSL *ssl, int sockfd);
+
+/**
+ * Read plaintext from an offloaded socket
+ *
+ * Session tickets arriving mid-stream are skipped; a close_notify alert
+ * reads as end of stream. Other alerts and a KeyUpdate, which the kernel
+ * can't follow, fail with ECONNRESET or EPROTO.
+ *
+ * @return Bytes read, 0 at end of stream, -1 with errno set (EAGAIN when
+ *         nothing is ready on a non-blocking socket)
+ */
+int ktls_recv(int sockfd, void *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_KTLS_H */
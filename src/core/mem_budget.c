@@ -0,0 +1,182 @@
+/**
+ * mem_budget.c - Byte budget for buffered responses
+ *
+ * Charges go through a compare-and-swap on the bytes in use, so the limit
+ * is never passed except by the overdraft holder. The overdraft is a
+ * single owner pointer: a refused owner claims it when it's free and
+ * keeps it until mem_budget_finish(), so at most one request is ever
+ * charged past the limit and that request can always finish.
+ */
+
+#include "mem_budget.h"
+#include <stdlib.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define BUDGET_LOAD(p)      ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0))
+    #define BUDGET_STORE(p, v)  InterlockedExchange64((volatile LONG64*)(p), (LONG64)(v))
+    #define BUDGET_ADD(p, n)    ((uint64_t)InterlockedExchangeAdd64((volatile LONG64*)(p), (LONG64)(n)) + (n))
+    #define BUDGET_SUB(p, n)    InterlockedExchangeAdd64((volatile LONG64*)(p), -(LONG64)(n))
+    #define BUDGET_CAS(p, expected, desired) \
+        (InterlockedCompareExchange64((volatile LONG64*)(p), (LONG64)(desired), \
+                                      (LONG64)(expected)) == (LONG64)(expected))
+    #define BUDGET_LOAD_PTR(p)  InterlockedCompareExchangePointer((PVOID volatile*)(p), NULL, NULL)
+    #define BUDGET_CAS_PTR(p, expected, desired) \
+        (InterlockedCompareExchangePointer((PVOID volatile*)(p), (PVOID)(desired), \
+                                           (PVOID)(expected)) == (PVOID)(expected))
+    #define BUDGET_INC_U32(p)   ((uint32_t)InterlockedIncrement((volatile LONG*)(p)))
+    #define BUDGET_DEC_U32(p)   ((uint32_t)InterlockedDecrement((volatile LONG*)(p)))
+#else
+    #define BUDGET_LOAD(p)      __atomic_load_n((p), __ATOMIC_RELAXED)
+    #define BUDGET_STORE(p, v)  __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+    #define BUDGET_ADD(p, n)    __atomic_add_fetch((p), (n), __ATOMIC_RELAXED)
+    #define BUDGET_SUB(p, n)    __atomic_sub_fetch((p), (n), __ATOMIC_RELAXED)
+    #define BUDGET_CAS(p, expected, desired) \
+        __atomic_compare_exchange_n((p), &(expected), (desired), false, \
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+    #define BUDGET_LOAD_PTR(p)  __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define BUDGET_CAS_PTR(p, expected, desired) \
+        __atomic_compare_exchange_n((p), &(expected), (desired), false, \
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+    #define BUDGET_INC_U32(p)   __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define BUDGET_DEC_U32(p)   __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+#endif
+
+struct mem_budget {
+    uint64_t limit;
+    uint64_t in_use;
+    uint64_t peak;
+    uint64_t stalls;
+    const void *overdraft;           /* Owner allowed past the limit (NULL: none) */
+    uint32_t refs;
+};
+
+/**
+ * Create a budget holding one reference
+ */
+mem_budget_t* mem_budget_create(uint64_t limit) {
+    mem_budget_t *budget = calloc(1, sizeof(mem_budget_t));
+    if (!budget) {
+        return NULL;
+    }
+    budget->limit = limit;
+    budget->refs = 1;
+    return budget;
+}
+
+/**
+ * Take a reference
+ */
+void mem_budget_ref(mem_budget_t *budget) {
+    if (budget) {
+        BUDGET_INC_U32(&budget->refs);
+    }
+}
+
+/**
+ * Drop a reference; the last one frees the budget
+ */
+void mem_budget_unref(mem_budget_t *budget) {
+    if (budget && BUDGET_DEC_U32(&budget->refs) == 0) {
+        free(budget);
+    }
+}
+
+/**
+ * Change the limit
+ */
+void mem_budget_set_limit(mem_budget_t *budget, uint64_t limit) {
+    if (budget) {
+        BUDGET_STORE(&budget->limit, limit);
+    }
+}
+
+/* Helper: Raise the peak to at least `used` */
+static void budget_note_peak(mem_budget_t *budget, uint64_t used) {
+    uint64_t peak = BUDGET_LOAD(&budget->peak);
+    while (used > peak && !BUDGET_CAS(&budget->peak, peak, used)) {
+#ifdef _WIN32
+        peak = BUDGET_LOAD(&budget->peak);
+#endif
+    }
+}
+
+/**
+ * Charge bytes if the limit allows
+ */
+bool mem_budget_try_charge(mem_budget_t *budget, uint64_t bytes, const void *owner, bool *stalled) {
+    if (!budget) {
+        return true;
+    }
+
+    uint64_t limit = BUDGET_LOAD(&budget->limit);
+    uint64_t used = BUDGET_LOAD(&budget->in_use);
+    bool charged = false;
+    while (limit == 0 || used + bytes <= limit) {
+        if (BUDGET_CAS(&budget->in_use, used, used + bytes)) {
+            used += bytes;
+            charged = true;
+            break;
+        }
+#ifdef _WIN32
+        used = BUDGET_LOAD(&budget->in_use);
+#endif
+    }
+
+    /* Past the limit only with the overdraft */
+    const void *free_overdraft = NULL;
+    if (!charged && (BUDGET_LOAD_PTR(&budget->overdraft) == owner ||
+                     BUDGET_CAS_PTR(&budget->overdraft, free_overdraft, owner))) {
+        used = BUDGET_ADD(&budget->in_use, bytes);
+        charged = true;
+    }
+
+    if (!charged) {
+        if (stalled && !*stalled) {
+            BUDGET_ADD(&budget->stalls, 1);
+            *stalled = true;
+        }
+        return false;
+    }
+    if (stalled) {
+        *stalled = false;
+    }
+    budget_note_peak(budget, used);
+    return true;
+}
+
+/**
+ * Give back bytes charged earlier
+ */
+void mem_budget_release(mem_budget_t *budget, uint64_t bytes) {
+    if (budget && bytes > 0) {
+        BUDGET_SUB(&budget->in_use, bytes);
+    }
+}
+
+/**
+ * Give up the overdraft, if the owner holds it
+ */
+void mem_budget_finish(mem_budget_t *budget, const void *owner) {
+    const void *held = owner;
+    if (budget && BUDGET_LOAD_PTR(&budget->overdraft) == owner) {
+        BUDGET_CAS_PTR(&budget->overdraft, held, NULL);
+    }
+}
+
+/**
+ * Get counters
+ */
+void mem_budget_get_stats(mem_budget_t *budget, mem_budget_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    if (!budget) {
+        stats->limit = stats->in_use = stats->peak = stats->stalls = 0;
+        return;
+    }
+    stats->limit = BUDGET_LOAD(&budget->limit);
+    stats->in_use = BUDGET_LOAD(&budget->in_use);
+    stats->peak = BUDGET_LOAD(&budget->peak);
+    stats->stalls = BUDGET_LOAD(&budget->stalls);
+}
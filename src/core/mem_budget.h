@@ -0,0 +1,85 @@
+/**
+ * mem_budget.h - Byte budget for buffered responses
+ *
+ * Requests charge the buffers they read responses into against a shared
+ * limit before growing them, and give the bytes back when the buffers are
+ * freed. A request whose charge is refused stops reading its socket until
+ * the budget has room again, so TCP flow control holds the server back
+ * instead of the process running out of memory. So that some request can
+ * always finish, one at a time may overdraw the limit. Lock-free; requests
+ * keep a reference, so a budget outlives the manager that created it.
+ */
+
+#ifndef HTTPMORPH_MEM_BUDGET_H
+#define HTTPMORPH_MEM_BUDGET_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint64_t limit;                  /* Bytes (0: unlimited) */
+    uint64_t in_use;                 /* Bytes charged now */
+    uint64_t peak;                   /* Most bytes charged at once */
+    uint64_t stalls;                 /* Times a request paused its reads for room */
+} mem_budget_stats_t;
+
+typedef struct mem_budget mem_budget_t;
+
+/**
+ * Create a budget holding one reference
+ * @param limit Bytes (0: unlimited, only counted)
+ */
+mem_budget_t* mem_budget_create(uint64_t limit);
+
+/**
+ * Take a reference
+ */
+void mem_budget_ref(mem_budget_t *budget);
+
+/**
+ * Drop a reference; the last one frees the budget
+ */
+void mem_budget_unref(mem_budget_t *budget);
+
+/**
+ * Change the limit (charges already made stand)
+ */
+void mem_budget_set_limit(mem_budget_t *budget, uint64_t limit);
+
+/**
+ * Charge bytes if the limit allows
+ * Over the limit the charge still succeeds for the one owner holding the
+ * overdraft, which the first refused owner takes while nobody holds it.
+ *
+ * @param owner Whoever charges (a request)
+ * @param stalled The owner's stall flag: set when refused, cleared on
+ *        success, so a wait counts as one stall however often it retries
+ * @return true if charged
+ */
+bool mem_budget_try_charge(mem_budget_t *budget, uint64_t bytes, const void *owner, bool *stalled);
+
+/**
+ * Give back bytes charged earlier
+ */
+void mem_budget_release(mem_budget_t *budget, uint64_t bytes);
+
+/**
+ * Give up the overdraft, if the owner holds it (the owner is done reading)
+ */
+void mem_budget_finish(mem_budget_t *budget, const void *owner);
+
+/**
+ * Get counters
+ */
+void mem_budget_get_stats(mem_budget_t *budget, mem_budget_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_MEM_BUDGET_H */
@@ -0,0 +1,358 @@
+/**
+ * metrics.c - Request metrics for clients and async managers
+ *
+ * Origins are kept in the order they were first seen and found through an
+ * open-addressing index keyed by the hash of their "scheme://host:port".
+ * Index entries are published once and never move, so lookups run without
+ * the lock; it is only taken to add an origin. Histograms are log-linear,
+ * as in HdrHistogram: values below METRICS_SUB_BUCKETS get a bucket each,
+ * and every power of two above is split into METRICS_SUB_BUCKETS equal
+ * buckets.
+ */
+
+#include "metrics.h"
+#include "request_scheduler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define METRICS_LOCK(m)   EnterCriticalSection(&(m)->mutex)
+    #define METRICS_UNLOCK(m) LeaveCriticalSection(&(m)->mutex)
+    #define METRICS_ADD(p, n) InterlockedExchangeAdd64((volatile LONG64*)(p), (LONG64)(n))
+    #define METRICS_LOAD(p)   ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0))
+    #define METRICS_STORE(p, v) InterlockedExchange64((volatile LONG64*)(p), (LONG64)(v))
+    #define METRICS_CAS(p, expected, desired) \
+        (InterlockedCompareExchange64((volatile LONG64*)(p), (LONG64)(desired), \
+                                      (LONG64)(expected)) == (LONG64)(expected))
+    #define METRICS_LOAD_U32(p)     ((uint32_t)InterlockedCompareExchange((volatile LONG*)(p), 0, 0))
+    #define METRICS_STORE_U32(p, v) InterlockedExchange((volatile LONG*)(p), (LONG)(v))
+#else
+    #include <pthread.h>
+    #define METRICS_LOCK(m)   pthread_mutex_lock(&(m)->mutex)
+    #define METRICS_UNLOCK(m) pthread_mutex_unlock(&(m)->mutex)
+    #define METRICS_ADD(p, n) __atomic_fetch_add((p), (n), __ATOMIC_RELAXED)
+    #define METRICS_LOAD(p)   __atomic_load_n((p), __ATOMIC_RELAXED)
+    #define METRICS_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+    #define METRICS_CAS(p, expected, desired) \
+        __atomic_compare_exchange_n((p), &(expected), (desired), false, \
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+    #define METRICS_LOAD_U32(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define METRICS_STORE_U32(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+/* Origin index slots (power of 2, twice METRICS_MAX_ORIGINS so probes stay short) */
+#define METRICS_INDEX_SLOTS (METRICS_MAX_ORIGINS * 2)
+
+typedef struct {
+    char key[REQUEST_SCHEDULER_MAX_KEY];
+    uint64_t hash;
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t max_us;
+    uint64_t total_us;
+    uint64_t queue_us;
+    uint64_t dns_us;
+    uint64_t connect_us;
+    uint64_t tls_us;
+    uint64_t first_byte_us;
+    uint64_t buckets[METRICS_BUCKETS];   /* Total times */
+} metrics_origin_t;
+
+struct metrics {
+    uint64_t requests;
+    uint64_t errors;
+    uint64_t connections_opened;
+    uint64_t connections_reused;
+    uint64_t tls_handshakes;
+    uint64_t tls_resumed;
+    uint64_t http2_streams;
+    uint64_t body_wire_bytes;
+    uint64_t body_bytes;
+
+    metrics_origin_t *origins[METRICS_MAX_ORIGINS];  /* First-seen order */
+    uint32_t origin_count;                           /* Published origins */
+    uint32_t index[METRICS_INDEX_SLOTS];             /* Origin position + 1, 0 = empty */
+
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;                           /* Adding origins */
+#endif
+};
+
+/**
+ * Get the histogram bucket of a value
+ */
+static size_t metrics_bucket(uint64_t us) {
+    if (us < METRICS_SUB_BUCKETS) {
+        return (size_t)us;
+    }
+    size_t shift = 0;
+    while ((us >> shift) >= 2 * METRICS_SUB_BUCKETS) {
+        shift++;
+    }
+    size_t bucket = shift * METRICS_SUB_BUCKETS + (size_t)(us >> shift);
+    return bucket < METRICS_BUCKETS ? bucket : METRICS_BUCKETS - 1;
+}
+
+/**
+ * Get the largest value that lands in a bucket
+ */
+static uint64_t metrics_bucket_high(size_t bucket) {
+    if (bucket < METRICS_SUB_BUCKETS) {
+        return bucket;
+    }
+    size_t shift = bucket / METRICS_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t)(bucket % METRICS_SUB_BUCKETS + METRICS_SUB_BUCKETS) << shift;
+    return low + ((uint64_t)1 << shift) - 1;
+}
+
+static uint64_t metrics_hash(const char *key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Probe the index for an origin
+ * @param slot Output: where the probe stopped (the origin's slot or an empty one)
+ */
+static metrics_origin_t* metrics_probe(metrics_t *metrics, const char *key, uint64_t hash,
+                                       size_t *slot) {
+    for (size_t i = 0; i < METRICS_INDEX_SLOTS; i++) {
+        size_t s = (size_t)(hash + i) & (METRICS_INDEX_SLOTS - 1);
+        uint32_t position = METRICS_LOAD_U32(&metrics->index[s]);
+        if (position == 0) {
+            *slot = s;
+            return NULL;
+        }
+        metrics_origin_t *origin = metrics->origins[position - 1];
+        if (origin->hash == hash && strcmp(origin->key, key) == 0) {
+            *slot = s;
+            return origin;
+        }
+    }
+    *slot = METRICS_INDEX_SLOTS;
+    return NULL;
+}
+
+/**
+ * Find the origin of a URL, adding it if there is room
+ */
+static metrics_origin_t* metrics_origin(metrics_t *metrics, const char *url) {
+    char key[REQUEST_SCHEDULER_MAX_KEY];
+    if (!url || !request_scheduler_origin_key(url, key, sizeof(key))) {
+        return NULL;
+    }
+    uint64_t hash = metrics_hash(key);
+
+    size_t slot;
+    metrics_origin_t *origin = metrics_probe(metrics, key, hash, &slot);
+    if (origin || METRICS_LOAD_U32(&metrics->origin_count) >= METRICS_MAX_ORIGINS) {
+        return origin;
+    }
+
+    METRICS_LOCK(metrics);
+    origin = metrics_probe(metrics, key, hash, &slot);
+    uint32_t count = metrics->origin_count;
+    if (!origin && slot < METRICS_INDEX_SLOTS && count < METRICS_MAX_ORIGINS &&
+        (origin = calloc(1, sizeof(metrics_origin_t))) != NULL) {
+        memcpy(origin->key, key, sizeof(key));
+        origin->hash = hash;
+        metrics->origins[count] = origin;
+        METRICS_STORE_U32(&metrics->origin_count, count + 1);
+        METRICS_STORE_U32(&metrics->index[slot], count + 1);
+    }
+    METRICS_UNLOCK(metrics);
+    return origin;
+}
+
+metrics_t* metrics_create(void) {
+    metrics_t *metrics = calloc(1, sizeof(metrics_t));
+    if (!metrics) {
+        return NULL;
+    }
+#ifdef _WIN32
+    InitializeCriticalSection(&metrics->mutex);
+#else
+    pthread_mutex_init(&metrics->mutex, NULL);
+#endif
+    return metrics;
+}
+
+void metrics_destroy(metrics_t *metrics) {
+    if (!metrics) {
+        return;
+    }
+    for (uint32_t i = 0; i < metrics->origin_count; i++) {
+        free(metrics->origins[i]);
+    }
+#ifdef _WIN32
+    DeleteCriticalSection(&metrics->mutex);
+#else
+    pthread_mutex_destroy(&metrics->mutex);
+#endif
+    free(metrics);
+}
+
+void metrics_record(metrics_t *metrics, const char *url, const httpmorph_response_t *response) {
+    if (!metrics) {
+        return;
+    }
+
+    bool failed = !response || response->error != HTTPMORPH_OK;
+    METRICS_ADD(&metrics->requests, 1);
+    if (failed) {
+        METRICS_ADD(&metrics->errors, 1);
+    }
+    if (!response) {
+        return;
+    }
+
+    /* Cached responses neither open nor reuse a connection */
+    if (response->connection_reused) {
+        METRICS_ADD(&metrics->connections_reused, 1);
+    } else if (response->connect_time_us > 0) {
+        METRICS_ADD(&metrics->connections_opened, 1);
+    }
+    if (response->tls_time_us > 0) {
+        METRICS_ADD(&metrics->tls_handshakes, 1);
+        if (response->tls_resumed) {
+            METRICS_ADD(&metrics->tls_resumed, 1);
+        }
+    }
+    if (response->http_version == HTTPMORPH_VERSION_2_0) {
+        METRICS_ADD(&metrics->http2_streams, 1);
+    }
+    METRICS_ADD(&metrics->body_wire_bytes, response->body_wire_len);
+    METRICS_ADD(&metrics->body_bytes, response->body_len);
+
+    metrics_origin_t *origin = metrics_origin(metrics, url);
+    if (!origin) {
+        return;
+    }
+    uint64_t total = response->total_time_us;
+    METRICS_ADD(&origin->requests, 1);
+    if (failed) {
+        METRICS_ADD(&origin->errors, 1);
+    }
+    METRICS_ADD(&origin->total_us, total);
+    METRICS_ADD(&origin->queue_us, response->queue_time_us);
+    METRICS_ADD(&origin->dns_us, response->dns_time_us);
+    METRICS_ADD(&origin->connect_us, response->connect_time_us);
+    METRICS_ADD(&origin->tls_us, response->tls_time_us);
+    METRICS_ADD(&origin->first_byte_us, response->first_byte_time_us);
+    METRICS_ADD(&origin->buckets[metrics_bucket(total)], 1);
+
+    uint64_t max = METRICS_LOAD(&origin->max_us);
+    while (total > max && !METRICS_CAS(&origin->max_us, max, total)) {
+        max = METRICS_LOAD(&origin->max_us);
+    }
+}
+
+void metrics_get(metrics_t *metrics, httpmorph_metrics_t *out) {
+    memset(out, 0, sizeof(*out));
+    if (!metrics) {
+        return;
+    }
+    out->requests = METRICS_LOAD(&metrics->requests);
+    out->errors = METRICS_LOAD(&metrics->errors);
+    out->connections_opened = METRICS_LOAD(&metrics->connections_opened);
+    out->connections_reused = METRICS_LOAD(&metrics->connections_reused);
+    out->tls_handshakes = METRICS_LOAD(&metrics->tls_handshakes);
+    out->tls_resumed = METRICS_LOAD(&metrics->tls_resumed);
+    out->http2_streams = METRICS_LOAD(&metrics->http2_streams);
+    out->body_wire_bytes = METRICS_LOAD(&metrics->body_wire_bytes);
+    out->body_bytes = METRICS_LOAD(&metrics->body_bytes);
+}
+
+/**
+ * Fill in an origin's percentiles from a copy of its histogram
+ */
+static void metrics_percentiles(const uint64_t *buckets, httpmorph_origin_metrics_t *out) {
+    static const double quantiles[4] = { 0.5, 0.9, 0.99, 0.999 };
+    uint64_t *targets[4] = { &out->p50_us, &out->p90_us, &out->p99_us, &out->p999_us };
+
+    uint64_t count = 0;
+    for (size_t b = 0; b < METRICS_BUCKETS; b++) {
+        count += buckets[b];
+    }
+    if (count == 0) {
+        return;
+    }
+
+    size_t q = 0;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < METRICS_BUCKETS && q < 4; b++) {
+        seen += buckets[b];
+        while (q < 4 && (double)seen >= quantiles[q] * (double)count) {
+            uint64_t value = metrics_bucket_high(b);
+            *targets[q++] = value < out->max_us ? value : out->max_us;
+        }
+    }
+}
+
+int metrics_get_origins(metrics_t *metrics, httpmorph_origin_metrics_t *out, int max_origins) {
+    if (!metrics) {
+        return 0;
+    }
+
+    int count = (int)METRICS_LOAD_U32(&metrics->origin_count);
+    uint64_t buckets[METRICS_BUCKETS];
+    for (int i = 0; out && i < count && i < max_origins; i++) {
+        const metrics_origin_t *origin = metrics->origins[i];
+        httpmorph_origin_metrics_t *o = &out[i];
+        memset(o, 0, sizeof(*o));
+        snprintf(o->origin, sizeof(o->origin), "%s", origin->key);
+        o->requests = METRICS_LOAD(&origin->requests);
+        o->errors = METRICS_LOAD(&origin->errors);
+        o->max_us = METRICS_LOAD(&origin->max_us);
+        o->total_us = METRICS_LOAD(&origin->total_us);
+        o->queue_us = METRICS_LOAD(&origin->queue_us);
+        o->dns_us = METRICS_LOAD(&origin->dns_us);
+        o->connect_us = METRICS_LOAD(&origin->connect_us);
+        o->tls_us = METRICS_LOAD(&origin->tls_us);
+        o->first_byte_us = METRICS_LOAD(&origin->first_byte_us);
+        for (size_t b = 0; b < METRICS_BUCKETS; b++) {
+            buckets[b] = METRICS_LOAD(&origin->buckets[b]);
+        }
+        metrics_percentiles(buckets, o);
+    }
+    return count;
+}
+
+void metrics_reset(metrics_t *metrics) {
+    if (!metrics) {
+        return;
+    }
+    METRICS_STORE(&metrics->requests, 0);
+    METRICS_STORE(&metrics->errors, 0);
+    METRICS_STORE(&metrics->connections_opened, 0);
+    METRICS_STORE(&metrics->connections_reused, 0);
+    METRICS_STORE(&metrics->tls_handshakes, 0);
+    METRICS_STORE(&metrics->tls_resumed, 0);
+    METRICS_STORE(&metrics->http2_streams, 0);
+    METRICS_STORE(&metrics->body_wire_bytes, 0);
+    METRICS_STORE(&metrics->body_bytes, 0);
+
+    uint32_t count = METRICS_LOAD_U32(&metrics->origin_count);
+    for (uint32_t i = 0; i < count; i++) {
+        metrics_origin_t *origin = metrics->origins[i];
+        METRICS_STORE(&origin->requests, 0);
+        METRICS_STORE(&origin->errors, 0);
+        METRICS_STORE(&origin->max_us, 0);
+        METRICS_STORE(&origin->total_us, 0);
+        METRICS_STORE(&origin->queue_us, 0);
+        METRICS_STORE(&origin->dns_us, 0);
+        METRICS_STORE(&origin->connect_us, 0);
+        METRICS_STORE(&origin->tls_us, 0);
+        METRICS_STORE(&origin->first_byte_us, 0);
+        for (size_t b = 0; b < METRICS_BUCKETS; b++) {
+            METRICS_STORE(&origin->buckets[b], 0);
+        }
+    }
+}
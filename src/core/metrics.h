@@ -0,0 +1,72 @@
+/**
+ * metrics.h - Request metrics for clients and async managers
+ *
+ * Counts what finished requests did (connections opened or reused, TLS
+ * handshakes and resumptions, HTTP/2 streams, body bytes before and after
+ * decoding) and keeps a latency histogram per origin, from the timings on
+ * each response. Recording is lock-free - a few atomic increments - so it
+ * stays on; only the first request to a new origin takes a lock.
+ */
+
+#ifndef HTTPMORPH_METRICS_H
+#define HTTPMORPH_METRICS_H
+
+#include "httpmorph.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Origins tracked (the first ones seen; later ones count in the totals only) */
+#define METRICS_MAX_ORIGINS HTTPMORPH_MAX_METRICS_ORIGINS
+
+/* Linear sub-buckets per power of two of microseconds (relative error 1/32) */
+#define METRICS_SUB_BUCKETS 32
+
+/* Histogram size: totals up to 2^32 us (about 71 minutes), larger ones in the last bucket */
+#define METRICS_BUCKETS (METRICS_SUB_BUCKETS * 28)
+
+typedef struct metrics metrics_t;
+
+/**
+ * Create an empty set of metrics
+ */
+metrics_t* metrics_create(void);
+
+/**
+ * Destroy metrics
+ */
+void metrics_destroy(metrics_t *metrics);
+
+/**
+ * Record a finished request
+ * Thread-safe.
+ * @param url URL the request went to (names its origin)
+ * @param response Its response, or NULL if none could be created
+ */
+void metrics_record(metrics_t *metrics, const char *url, const httpmorph_response_t *response);
+
+/**
+ * Read the counters (pool fields are left at 0 for the caller)
+ */
+void metrics_get(metrics_t *metrics, httpmorph_metrics_t *out);
+
+/**
+ * Read the metrics of each origin, in the order they were first seen
+ * @return Number of origins (may exceed max_origins)
+ */
+int metrics_get_origins(metrics_t *metrics, httpmorph_origin_metrics_t *out, int max_origins);
+
+/**
+ * Zero all counters and histograms (origins stay tracked)
+ */
+void metrics_reset(metrics_t *metrics);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_METRICS_H */
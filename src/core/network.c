@@ -4,17 +4,64 @@
 
 #include "internal/network.h"
 #include "internal/util.h"
+#include "happy_eyeballs.h"
+#include "dns_resolver.h"
+#include "shared_cache.h"
+#include "trace.h"
+#include <stddef.h>
 
 #ifndef _WIN32
 #include <pthread.h>
 #endif
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#elif defined(__APPLE__)
+#include <sys/uio.h>
+#endif
+
+/* Chunk size when a file has to be read and sent by hand */
+#define SEND_FILE_CHUNK (64 * 1024)
 
 /* ====================================================================
  * DNS CACHING
  * ==================================================================== */
 
-#define DNS_CACHE_TTL_SECONDS 300  /* 5 minutes */
-#define DNS_CACHE_MAX_ENTRIES 128
+#define DNS_CACHE_TTL_SECONDS 300          /* When the record TTL is unknown */
+#define DNS_CACHE_MAX_TTL_SECONDS 86400    /* Cap on server-supplied TTLs */
+#define DNS_CACHE_NEGATIVE_TTL_SECONDS 30  /* NXDOMAIN without an SOA minimum */
+#define DNS_CACHE_SHARDS 16
+#define DNS_CACHE_BUCKETS 64               /* Per shard, power of two */
+#define DNS_CACHE_MAX_ENTRIES 1024         /* Split evenly across shards */
+#define DNS_CACHE_SHARD_ENTRIES (DNS_CACHE_MAX_ENTRIES / DNS_CACHE_SHARDS)
+
+#ifdef _WIN32
+    #define DNS_REF_INC(p) InterlockedIncrement((volatile LONG*)(p))
+    #define DNS_REF_DEC(p) InterlockedDecrement((volatile LONG*)(p))
+#else
+    #define DNS_REF_INC(p) __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define DNS_REF_DEC(p) __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+#endif
+
+/**
+ * One address of a shared list
+ */
+typedef struct {
+    struct addrinfo ai;                /* Must stay first (see dns_addrs_of) */
+    struct sockaddr_storage addr;
+} dns_addr_node_t;
+
+/**
+ * Immutable, reference counted address list
+ *
+ * Every list handed out by httpmorph_dns_* is one of these, so a cache hit
+ * is a reference count bump instead of a deep copy. Lists are never written
+ * after creation; httpmorph_dns_free() drops a reference.
+ */
+typedef struct {
+    long refs;
+    size_t count;
+    dns_addr_node_t nodes[];
+} dns_addrs_t;
 
 /**
  * DNS cache entry structure
@@ -22,230 +69,319 @@
 typedef struct dns_cache_entry {
     char *hostname;
     uint16_t port;
-    struct addrinfo *result;   /* Cached addrinfo result */
+    uint32_t hash;
+    dns_addrs_t *addrs;        /* NULL for a negative entry */
+    int gai_error;             /* Negative entries: the lookup error */
+    int preferred_family;      /* Family that won the last connection race */
     time_t expires;            /* Expiration timestamp */
-    struct dns_cache_entry *next;
+    struct dns_cache_entry *hash_next;
+    struct dns_cache_entry *lru_prev;  /* Most recently used at lru_head */
+    struct dns_cache_entry *lru_next;
 } dns_cache_entry_t;
 
+/**
+ * Cache shard: hash buckets and an LRU list under one lock
+ */
+typedef struct {
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+    dns_cache_entry_t *buckets[DNS_CACHE_BUCKETS];
+    dns_cache_entry_t *lru_head;
+    dns_cache_entry_t *lru_tail;
+    size_t size;
+    httpmorph_dns_cache_stats_t stats;  /* entries unused, see size */
+} dns_cache_shard_t;
+
 /* Global DNS cache */
-static dns_cache_entry_t *dns_cache_head = NULL;
-static size_t dns_cache_size = 0;
+static dns_cache_shard_t dns_cache_shards[DNS_CACHE_SHARDS];
 
 #ifdef _WIN32
-static CRITICAL_SECTION dns_cache_mutex;
 static bool dns_cache_mutex_initialized = false;
 #else
-static pthread_mutex_t dns_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t dns_cache_once = PTHREAD_ONCE_INIT;
+
+static void dns_cache_init_shards(void) {
+    for (int i = 0; i < DNS_CACHE_SHARDS; i++) {
+        pthread_mutex_init(&dns_cache_shards[i].mutex, NULL);
+    }
+}
 #endif
 
 /**
- * Initialize DNS cache mutex (called on first use)
+ * Initialize DNS cache mutexes (called on first use)
  */
 static void dns_cache_init_mutex(void) {
 #ifdef _WIN32
     if (!dns_cache_mutex_initialized) {
-        InitializeCriticalSection(&dns_cache_mutex);
+        for (int i = 0; i < DNS_CACHE_SHARDS; i++) {
+            InitializeCriticalSection(&dns_cache_shards[i].mutex);
+        }
         dns_cache_mutex_initialized = true;
     }
+#else
+    pthread_once(&dns_cache_once, dns_cache_init_shards);
 #endif
 }
 
 /**
- * Lock DNS cache mutex
+ * Lock a DNS cache shard
  */
-static inline void dns_cache_lock(void) {
+static inline void dns_cache_lock(dns_cache_shard_t *shard) {
 #ifdef _WIN32
-    EnterCriticalSection(&dns_cache_mutex);
+    EnterCriticalSection(&shard->mutex);
 #else
-    pthread_mutex_lock(&dns_cache_mutex);
+    pthread_mutex_lock(&shard->mutex);
 #endif
 }
 
 /**
- * Unlock DNS cache mutex
+ * Unlock a DNS cache shard
  */
-static inline void dns_cache_unlock(void) {
+static inline void dns_cache_unlock(dns_cache_shard_t *shard) {
 #ifdef _WIN32
-    LeaveCriticalSection(&dns_cache_mutex);
+    LeaveCriticalSection(&shard->mutex);
 #else
-    pthread_mutex_unlock(&dns_cache_mutex);
+    pthread_mutex_unlock(&shard->mutex);
 #endif
 }
 
 /**
- * Deep copy addrinfo structure (needed for caching)
+ * Hash host:port (FNV-1a, case-insensitive like DNS names)
  */
-static struct addrinfo* addrinfo_deep_copy(const struct addrinfo *src) {
-    if (!src) return NULL;
+static uint32_t dns_cache_hash(const char *hostname, uint16_t port) {
+    uint32_t h = 2166136261u;
+    for (const char *p = hostname; *p; p++) {
+        char c = *p;
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        h = (h ^ (uint8_t)c) * 16777619u;
+    }
+    h = (h ^ (uint8_t)(port >> 8)) * 16777619u;
+    h = (h ^ (uint8_t)port) * 16777619u;
+    return h;
+}
 
-    struct addrinfo *copy = (struct addrinfo*)malloc(sizeof(struct addrinfo));
-    if (!copy) return NULL;
+/* Shard from the low bits, bucket from the next ones */
+#define DNS_CACHE_SHARD(hash)  (&dns_cache_shards[(hash) % DNS_CACHE_SHARDS])
+#define DNS_CACHE_BUCKET(hash) (((hash) / DNS_CACHE_SHARDS) % DNS_CACHE_BUCKETS)
 
-    memcpy(copy, src, sizeof(struct addrinfo));
-    copy->ai_addr = NULL;
-    copy->ai_canonname = NULL;
-    copy->ai_next = NULL;
+/**
+ * Get the shared list a first node belongs to
+ */
+static inline dns_addrs_t* dns_addrs_of(const struct addrinfo *ai) {
+    return (dns_addrs_t*)((char*)ai - offsetof(dns_addrs_t, nodes));
+}
 
-    /* Copy sockaddr */
-    if (src->ai_addr) {
-        copy->ai_addr = (struct sockaddr*)malloc(src->ai_addrlen);
-        if (!copy->ai_addr) {
-            /* Allocation failed - cleanup and return NULL */
-            free(copy);
-            return NULL;
+/**
+ * Freeze an address chain into one shared list
+ */
+static dns_addrs_t* dns_addrs_create(const struct addrinfo *src) {
+    size_t count = 0;
+    for (const struct addrinfo *ai = src; ai; ai = ai->ai_next) {
+        if (ai->ai_addr && ai->ai_addrlen <= sizeof(struct sockaddr_storage)) {
+            count++;
         }
-        memcpy(copy->ai_addr, src->ai_addr, src->ai_addrlen);
     }
+    if (count == 0) return NULL;
 
-    /* Copy canonname */
-    if (src->ai_canonname) {
-        copy->ai_canonname = strdup(src->ai_canonname);
-        if (!copy->ai_canonname) {
-            /* Allocation failed - cleanup and return NULL */
-            free(copy->ai_addr);
-            free(copy);
-            return NULL;
-        }
-    }
+    dns_addrs_t *addrs = (dns_addrs_t*)calloc(1, sizeof(dns_addrs_t) +
+                                              count * sizeof(dns_addr_node_t));
+    if (!addrs) return NULL;
 
-    /* Recursively copy linked list */
-    if (src->ai_next) {
-        copy->ai_next = addrinfo_deep_copy(src->ai_next);
-        if (!copy->ai_next && src->ai_next) {
-            /* Recursive copy failed - cleanup and return NULL */
-            free(copy->ai_canonname);
-            free(copy->ai_addr);
-            free(copy);
-            return NULL;
+    addrs->refs = 1;
+    addrs->count = count;
+
+    size_t i = 0;
+    for (const struct addrinfo *ai = src; ai; ai = ai->ai_next) {
+        if (!ai->ai_addr || ai->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            continue;
         }
+        dns_addr_node_t *node = &addrs->nodes[i];
+        node->ai.ai_flags = ai->ai_flags;
+        node->ai.ai_family = ai->ai_family;
+        node->ai.ai_socktype = ai->ai_socktype;
+        node->ai.ai_protocol = ai->ai_protocol;
+        node->ai.ai_addrlen = ai->ai_addrlen;
+        node->ai.ai_addr = (struct sockaddr*)&node->addr;
+        memcpy(&node->addr, ai->ai_addr, ai->ai_addrlen);
+        node->ai.ai_next = (i + 1 < count) ? &addrs->nodes[i + 1].ai : NULL;
+        i++;
     }
-
-    return copy;
+    return addrs;
 }
 
 /**
- * Free addrinfo deep copy
+ * Drop a reference to a shared list
  */
-static void addrinfo_deep_free(struct addrinfo *ai) {
-    while (ai) {
-        struct addrinfo *next = ai->ai_next;
-        free(ai->ai_addr);
-        free(ai->ai_canonname);
-        free(ai);
-        ai = next;
+static void dns_addrs_unref(dns_addrs_t *addrs) {
+    if (addrs && DNS_REF_DEC(&addrs->refs) == 0) {
+        free(addrs);
     }
 }
 
 /**
- * Lookup hostname in DNS cache
- * Returns cached addrinfo if found and not expired, NULL otherwise
+ * Take a reference to a shared list, returning its first node
  */
-static struct addrinfo* dns_cache_lookup(const char *hostname, uint16_t port) {
-    if (!hostname) return NULL;
+static struct addrinfo* dns_addrs_ref(dns_addrs_t *addrs) {
+    DNS_REF_INC(&addrs->refs);
+    return &addrs->nodes[0].ai;
+}
 
-    dns_cache_init_mutex();
-    dns_cache_lock();
+/**
+ * Unlink and free an entry (shard locked)
+ */
+static void dns_cache_remove(dns_cache_shard_t *shard, dns_cache_entry_t *entry) {
+    dns_cache_entry_t **p = &shard->buckets[DNS_CACHE_BUCKET(entry->hash)];
+    while (*p && *p != entry) {
+        p = &(*p)->hash_next;
+    }
+    if (*p) {
+        *p = entry->hash_next;
+    }
 
-    time_t now = time(NULL);
-    dns_cache_entry_t *entry = dns_cache_head;
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else shard->lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else shard->lru_tail = entry->lru_prev;
+
+    free(entry->hostname);
+    dns_addrs_unref(entry->addrs);
+    free(entry);
+    shard->size--;
+}
 
-    while (entry) {
-        if (entry->port == port &&
-            strcmp(entry->hostname, hostname) == 0) {
+/**
+ * Move an entry to the front of the LRU list (shard locked)
+ */
+static void dns_cache_touch(dns_cache_shard_t *shard, dns_cache_entry_t *entry) {
+    if (shard->lru_head == entry) return;
 
-            /* Check if entry is expired */
-            if (now >= entry->expires) {
-                /* Expired - will be cleaned up later */
-                dns_cache_unlock();
-                return NULL;
-            }
+    entry->lru_prev->lru_next = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else shard->lru_tail = entry->lru_prev;
+
+    entry->lru_prev = NULL;
+    entry->lru_next = shard->lru_head;
+    shard->lru_head->lru_prev = entry;
+    shard->lru_head = entry;
+}
 
-            /* Found valid entry - deep copy and return */
-            struct addrinfo *result = addrinfo_deep_copy(entry->result);
-            dns_cache_unlock();
-            return result;
+/**
+ * Find host:port in a shard (shard locked)
+ */
+static dns_cache_entry_t* dns_cache_find(dns_cache_shard_t *shard, uint32_t hash,
+                                         const char *hostname, uint16_t port) {
+    for (dns_cache_entry_t *entry = shard->buckets[DNS_CACHE_BUCKET(hash)];
+         entry; entry = entry->hash_next) {
+        if (entry->hash == hash && entry->port == port &&
+            strcasecmp(entry->hostname, hostname) == 0) {
+            return entry;
         }
-        entry = entry->next;
     }
-
-    dns_cache_unlock();
     return NULL;
 }
 
 /**
- * Add entry to DNS cache
+ * Lookup hostname in DNS cache
+ * Returns a reference to the cached list if found and not expired, NULL otherwise
  */
-static void dns_cache_add(const char *hostname, uint16_t port,
-                          const struct addrinfo *result) {
-    if (!hostname || !result) return;
+static struct addrinfo* dns_cache_lookup(const char *hostname, uint16_t port,
+                                         int *preferred_family, int *gai_error) {
+    if (!hostname) return NULL;
 
     dns_cache_init_mutex();
-    dns_cache_lock();
-
-    /* Check if cache is full - remove oldest entry if needed */
-    if (dns_cache_size >= DNS_CACHE_MAX_ENTRIES) {
-        /* Simple eviction: remove last entry */
-        dns_cache_entry_t *prev = NULL;
-        dns_cache_entry_t *curr = dns_cache_head;
-        dns_cache_entry_t *last_prev = NULL;
-        dns_cache_entry_t *last = NULL;
-
-        while (curr) {
-            if (!curr->next) {
-                last = curr;
-                last_prev = prev;
-                break;
-            }
-            prev = curr;
-            curr = curr->next;
-        }
+    uint32_t hash = dns_cache_hash(hostname, port);
+    dns_cache_shard_t *shard = DNS_CACHE_SHARD(hash);
+    struct addrinfo *result = NULL;
 
-        if (last) {
-            if (last_prev) {
-                last_prev->next = NULL;
-            } else {
-                dns_cache_head = NULL;
-            }
+    dns_cache_lock(shard);
 
-            free(last->hostname);
-            addrinfo_deep_free(last->result);
-            free(last);
-            dns_cache_size--;
-        }
+    dns_cache_entry_t *entry = dns_cache_find(shard, hash, hostname, port);
+    if (entry && time(NULL) >= entry->expires) {
+        dns_cache_remove(shard, entry);
+        shard->stats.expirations++;
+        entry = NULL;
     }
 
-    /* Create new entry */
-    dns_cache_entry_t *entry = (dns_cache_entry_t*)calloc(1, sizeof(dns_cache_entry_t));
     if (!entry) {
-        dns_cache_unlock();
-        return;
+        shard->stats.misses++;
+    } else if (!entry->addrs) {
+        /* Known not to exist */
+        *gai_error = entry->gai_error;
+        shard->stats.negative_hits++;
+        dns_cache_touch(shard, entry);
+    } else {
+        result = dns_addrs_ref(entry->addrs);
+        *preferred_family = entry->preferred_family;
+        shard->stats.hits++;
+        dns_cache_touch(shard, entry);
     }
 
-    /* Allocate hostname with error checking */
-    entry->hostname = strdup(hostname);
-    if (!entry->hostname) {
-        free(entry);
-        dns_cache_unlock();
-        return;
+    dns_cache_unlock(shard);
+    return result;
+}
+
+/**
+ * Add entry to DNS cache, replacing any existing one
+ */
+static void dns_cache_add(const char *hostname, uint16_t port, dns_addrs_t *addrs,
+                          int gai_error, int ttl_seconds) {
+    if (!hostname) return;
+
+    dns_addrs_t *owned = NULL;
+    if (addrs) {
+        DNS_REF_INC(&addrs->refs);
+        owned = addrs;
     }
 
-    /* Deep copy addrinfo with error checking */
-    entry->result = addrinfo_deep_copy(result);
-    if (!entry->result) {
-        free(entry->hostname);
+    dns_cache_entry_t *entry = (dns_cache_entry_t*)calloc(1, sizeof(dns_cache_entry_t));
+    if (!entry || !(entry->hostname = strdup(hostname))) {
         free(entry);
-        dns_cache_unlock();
+        dns_addrs_unref(owned);
         return;
     }
 
+    dns_cache_init_mutex();
+    uint32_t hash = dns_cache_hash(hostname, port);
+    dns_cache_shard_t *shard = DNS_CACHE_SHARD(hash);
+
     entry->port = port;
-    entry->expires = time(NULL) + DNS_CACHE_TTL_SECONDS;
-    entry->next = dns_cache_head;
+    entry->hash = hash;
+    entry->addrs = owned;
+    entry->gai_error = gai_error;
+    entry->preferred_family = AF_UNSPEC;
+    entry->expires = time(NULL) + ttl_seconds;
+
+    dns_cache_lock(shard);
+
+    /* Re-resolved: keep the race winner, drop the stale addresses */
+    dns_cache_entry_t *old = dns_cache_find(shard, hash, hostname, port);
+    if (old) {
+        if (owned) entry->preferred_family = old->preferred_family;
+        dns_cache_remove(shard, old);
+    }
 
-    dns_cache_head = entry;
-    dns_cache_size++;
+    /* Shard full - evict the least recently used entry */
+    if (shard->size >= DNS_CACHE_SHARD_ENTRIES && shard->lru_tail) {
+        dns_cache_remove(shard, shard->lru_tail);
+        shard->stats.evictions++;
+    }
+
+    size_t bucket = DNS_CACHE_BUCKET(hash);
+    entry->hash_next = shard->buckets[bucket];
+    shard->buckets[bucket] = entry;
+
+    entry->lru_next = shard->lru_head;
+    if (shard->lru_head) shard->lru_head->lru_prev = entry;
+    else shard->lru_tail = entry;
+    shard->lru_head = entry;
+
+    shard->size++;
+    shard->stats.insertions++;
 
-    dns_cache_unlock();
+    dns_cache_unlock(shard);
 }
 
 /**
@@ -253,28 +389,24 @@ static void dns_cache_add(const char *hostname, uint16_t port,
  */
 void dns_cache_cleanup(void) {
     dns_cache_init_mutex();
-    dns_cache_lock();
-
     time_t now = time(NULL);
-    dns_cache_entry_t **curr = &dns_cache_head;
-
-    while (*curr) {
-        dns_cache_entry_t *entry = *curr;
 
-        if (now >= entry->expires) {
-            /* Remove expired entry */
-            *curr = entry->next;
+    for (int i = 0; i < DNS_CACHE_SHARDS; i++) {
+        dns_cache_shard_t *shard = &dns_cache_shards[i];
+        dns_cache_lock(shard);
 
-            free(entry->hostname);
-            addrinfo_deep_free(entry->result);
-            free(entry);
-            dns_cache_size--;
-        } else {
-            curr = &entry->next;
+        dns_cache_entry_t *entry = shard->lru_head;
+        while (entry) {
+            dns_cache_entry_t *next = entry->lru_next;
+            if (now >= entry->expires) {
+                dns_cache_remove(shard, entry);
+                shard->stats.expirations++;
+            }
+            entry = next;
         }
-    }
 
-    dns_cache_unlock();
+        dns_cache_unlock(shard);
+    }
 }
 
 /**
@@ -282,189 +414,358 @@ void dns_cache_cleanup(void) {
  */
 void dns_cache_clear(void) {
     dns_cache_init_mutex();
-    dns_cache_lock();
 
-    while (dns_cache_head) {
-        dns_cache_entry_t *next = dns_cache_head->next;
+    for (int i = 0; i < DNS_CACHE_SHARDS; i++) {
+        dns_cache_shard_t *shard = &dns_cache_shards[i];
+        dns_cache_lock(shard);
+        while (shard->lru_head) {
+            dns_cache_remove(shard, shard->lru_head);
+        }
+        dns_cache_unlock(shard);
+    }
+}
 
-        free(dns_cache_head->hostname);
-        addrinfo_deep_free(dns_cache_head->result);
-        free(dns_cache_head);
+/**
+ * Get DNS cache statistics
+ */
+int httpmorph_dns_get_cache_stats(httpmorph_dns_cache_stats_t *stats) {
+    if (!stats) return -1;
 
-        dns_cache_head = next;
+    dns_cache_init_mutex();
+    memset(stats, 0, sizeof(*stats));
+
+    for (int i = 0; i < DNS_CACHE_SHARDS; i++) {
+        dns_cache_shard_t *shard = &dns_cache_shards[i];
+        dns_cache_lock(shard);
+        stats->hits += shard->stats.hits;
+        stats->misses += shard->stats.misses;
+        stats->negative_hits += shard->stats.negative_hits;
+        stats->insertions += shard->stats.insertions;
+        stats->evictions += shard->stats.evictions;
+        stats->expirations += shard->stats.expirations;
+        stats->entries += shard->size;
+        dns_cache_unlock(shard);
+    }
+    return 0;
+}
+
+/**
+ * Fill in a miss from the cache shared with other processes
+ * Hits are copied into this process's cache, so each is fetched once.
+ */
+static struct addrinfo* dns_shared_lookup(const char *host, uint16_t port, int *gai_error) {
+    shared_cache_addr_t shared[SHARED_CACHE_DNS_ADDRS];
+    size_t count = 0;
+    int ttl = 0;
+    if (!shared_cache_enabled() ||
+        !shared_cache_dns_get(host, port, shared, &count, gai_error, &ttl)) {
+        return NULL;
+    }
+    if (count == 0) {
+        dns_cache_add(host, port, NULL, *gai_error, ttl);
+        return NULL;
     }
 
-    dns_cache_size = 0;
-    dns_cache_unlock();
+    struct addrinfo chain[SHARED_CACHE_DNS_ADDRS];
+    struct sockaddr_storage addrs[SHARED_CACHE_DNS_ADDRS];
+    memset(chain, 0, sizeof(chain));
+    for (size_t i = 0; i < count; i++) {
+        memcpy(&addrs[i], shared[i].addr, shared[i].len);
+        chain[i].ai_family = shared[i].family;
+        chain[i].ai_socktype = shared[i].socktype;
+        chain[i].ai_protocol = shared[i].protocol;
+        chain[i].ai_addrlen = (socklen_t)shared[i].len;
+        chain[i].ai_addr = (struct sockaddr*)&addrs[i];
+        chain[i].ai_next = i + 1 < count ? &chain[i + 1] : NULL;
+    }
+
+    dns_addrs_t *list = dns_addrs_create(chain);
+    if (!list) {
+        return NULL;
+    }
+    dns_cache_add(host, port, list, 0, ttl);
+    return &list->nodes[0].ai;
 }
 
-/* ====================================================================
- * TCP CONNECTION
- * ==================================================================== */
+/**
+ * Offer a result to the cache shared with other processes
+ */
+static void dns_shared_store(const char *host, uint16_t port, const struct addrinfo *addrs,
+                             int gai_error, int ttl_seconds) {
+    if (!shared_cache_enabled()) return;
+
+    shared_cache_addr_t shared[SHARED_CACHE_DNS_ADDRS];
+    size_t count = 0;
+    for (const struct addrinfo *ai = addrs; ai && count < SHARED_CACHE_DNS_ADDRS; ai = ai->ai_next) {
+        if (!ai->ai_addr || ai->ai_addrlen > sizeof(shared[count].addr)) {
+            continue;
+        }
+        shared[count].family = ai->ai_family;
+        shared[count].socktype = ai->ai_socktype;
+        shared[count].protocol = ai->ai_protocol;
+        shared[count].len = (uint32_t)ai->ai_addrlen;
+        memcpy(shared[count].addr, ai->ai_addr, ai->ai_addrlen);
+        count++;
+    }
+    if (addrs && count == 0) return;
+    shared_cache_dns_put(host, port, shared, count, gai_error, ttl_seconds);
+}
 
 /**
- * Establish a TCP connection to a host
+ * Look up host:port in the DNS cache
  */
-int httpmorph_tcp_connect(const char *host, uint16_t port, uint32_t timeout_ms,
-                          uint64_t *connect_time_us) {
-    struct addrinfo hints, *result, *rp;
-    int sockfd = -1;
-    uint64_t start_time = httpmorph_get_time_us();
-    bool need_free_result = false;
+struct addrinfo* httpmorph_dns_cache_get(const char *host, uint16_t port,
+                                         int *preferred_family, int *gai_error) {
+    int pref = AF_UNSPEC, error = 0;
+    struct addrinfo *result = dns_cache_lookup(host, port, &pref, &error);
+    if (!result && !error && host) {
+        result = dns_shared_lookup(host, port, &error);
+    }
+    if (preferred_family) *preferred_family = pref;
+    if (gai_error) *gai_error = error;
+    return result;
+}
 
-    /* Try DNS cache first */
-    result = dns_cache_lookup(host, port);
-    if (result) {
-        need_free_result = true;  /* We own this copy */
-    } else {
-        /* Cache miss - perform DNS lookup */
-        memset(&hints, 0, sizeof(hints));
-        hints.ai_family = AF_UNSPEC;     /* Allow IPv4 or IPv6 */
-        hints.ai_socktype = SOCK_STREAM;
-        hints.ai_flags = 0;
-        hints.ai_protocol = 0;
-
-        /* Convert port to string */
-        char port_str[6];
-        snprintf(port_str, sizeof(port_str), "%u", port);
-
-        /* Resolve hostname */
-        int ret = getaddrinfo(host, port_str, &hints, &result);
-        if (ret != 0) {
-            return -1;
-        }
+/* Helper: Clamp a record TTL, -1 meaning unknown */
+static int dns_cache_ttl(int ttl_seconds, int fallback) {
+    if (ttl_seconds < 0) return fallback;
+    return ttl_seconds > DNS_CACHE_MAX_TTL_SECONDS ? DNS_CACHE_MAX_TTL_SECONDS : ttl_seconds;
+}
 
-        /* Add to cache for future use */
-        dns_cache_add(host, port, result);
-        need_free_result = false;  /* Will use freeaddrinfo() */
+/**
+ * Store a resolved address list in the DNS cache
+ */
+void httpmorph_dns_cache_put(const char *host, uint16_t port, const struct addrinfo *addrs,
+                             int ttl_seconds) {
+    int ttl = dns_cache_ttl(ttl_seconds, DNS_CACHE_TTL_SECONDS);
+    if (!addrs || ttl == 0) return;
+    dns_cache_add(host, port, dns_addrs_of(addrs), 0, ttl);
+    dns_shared_store(host, port, addrs, 0, ttl);
+}
+
+/**
+ * Remember that host:port does not resolve
+ */
+void httpmorph_dns_cache_put_negative(const char *host, uint16_t port, int gai_error,
+                                      int ttl_seconds) {
+    int ttl = dns_cache_ttl(ttl_seconds, DNS_CACHE_NEGATIVE_TTL_SECONDS);
+    if (gai_error == 0 || ttl == 0) return;
+    dns_cache_add(host, port, NULL, gai_error, ttl);
+    dns_shared_store(host, port, NULL, gai_error, ttl);
+}
+
+/**
+ * Resolve host:port through the DNS cache
+ */
+struct addrinfo* httpmorph_dns_resolve(const char *host, uint16_t port, uint32_t timeout_ms,
+                                       int *preferred_family, int *gai_error) {
+    if (gai_error) *gai_error = 0;
+
+    /* Try DNS cache first (a negative hit fails without asking again) */
+    int cached_error = 0;
+    struct addrinfo *cached = httpmorph_dns_cache_get(host, port, preferred_family, &cached_error);
+    if (cached || cached_error) {
+        if (gai_error) *gai_error = cached_error;
+        return cached;
     }
 
-    /* Try each address until we succeed */
-    int ret;
-    for (rp = result; rp != NULL; rp = rp->ai_next) {
-        sockfd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-        if (sockfd == -1) {
-            continue;
+    /* Cache miss - resolve off-thread so the wait is bounded by the timeout */
+    httpmorph_dns_lookup_t *lookup = httpmorph_resolver_start(host, port, -1);
+    if (lookup) {
+        struct addrinfo *result = NULL;
+        int error = EAI_AGAIN;
+        if (httpmorph_dns_lookup_wait(lookup, timeout_ms) == 0) {
+            result = httpmorph_dns_lookup_result(lookup, &error);
         }
+        httpmorph_dns_lookup_release(lookup);
+        if (!result && gai_error) *gai_error = error;
+        return result;
+    }
 
-        /* Enable TCP_NODELAY (disable Nagle's algorithm for lower latency) */
-        int nodelay = 1;
-        setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&nodelay, sizeof(nodelay));
+    /* No resolver threads - resolve inline */
+    struct addrinfo hints, *result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;     /* Allow IPv4 or IPv6 */
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = 0;
+    hints.ai_protocol = 0;
+
+    /* Convert port to string */
+    char port_str[6];
+    snprintf(port_str, sizeof(port_str), "%u", port);
+
+    /* Resolve hostname (getaddrinfo doesn't report TTLs) */
+    int ret = getaddrinfo(host, port_str, &hints, &result);
+    if (ret != 0 || !result) {
+        if (ret == EAI_NONAME) {
+            httpmorph_dns_cache_put_negative(host, port, ret, -1);
+        }
+        if (gai_error) *gai_error = ret;
+        return NULL;
+    }
 
-        /* Enable SO_REUSEADDR for faster socket reuse */
-        int reuse = 1;
-        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (char*)&reuse, sizeof(reuse));
+    /* Add to cache for future use; the caller shares the cached list */
+    struct addrinfo *shared = httpmorph_dns_copy(result);
+    freeaddrinfo(result);
+    if (!shared) {
+        if (gai_error) *gai_error = EAI_MEMORY;
+        return NULL;
+    }
+    httpmorph_dns_cache_put(host, port, shared, -1);
+    return shared;
+}
 
-        /* Enable SO_KEEPALIVE for connection health monitoring */
-        int keepalive = 1;
-        setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, (char*)&keepalive, sizeof(keepalive));
+/**
+ * Freeze an address chain into a shared list (free with httpmorph_dns_free())
+ */
+struct addrinfo* httpmorph_dns_copy(const struct addrinfo *addrs) {
+    dns_addrs_t *shared = dns_addrs_create(addrs);
+    return shared ? &shared->nodes[0].ai : NULL;
+}
 
-        /* Optimize send/receive buffer sizes (64KB each for better throughput) */
-        int bufsize = 65536;
-        setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, (char*)&bufsize, sizeof(bufsize));
-        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, (char*)&bufsize, sizeof(bufsize));
+/**
+ * Take another reference to a shared list
+ */
+struct addrinfo* httpmorph_dns_ref(struct addrinfo *addrs) {
+    return addrs ? dns_addrs_ref(dns_addrs_of(addrs)) : NULL;
+}
 
-#ifdef TCP_QUICKACK
-        /* Enable TCP_QUICKACK on Linux for faster ACKs */
-        int quickack = 1;
-        setsockopt(sockfd, IPPROTO_TCP, TCP_QUICKACK, (char*)&quickack, sizeof(quickack));
-#endif
+/**
+ * Release a shared list from httpmorph_dns_resolve()
+ */
+void httpmorph_dns_free(struct addrinfo *addrs) {
+    if (addrs) {
+        dns_addrs_unref(dns_addrs_of(addrs));
+    }
+}
 
-#ifdef SO_REUSEPORT
-        /* Enable SO_REUSEPORT if available (Linux 3.9+, BSD) */
-        int reuseport = 1;
-        setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, (char*)&reuseport, sizeof(reuseport));
-#endif
+/**
+ * Remember which address family connected first for host:port
+ */
+void httpmorph_dns_set_preferred_family(const char *host, uint16_t port, int family) {
+    if (!host) return;
 
-        /* Set socket to non-blocking for timeout support */
-#ifdef _WIN32
-        u_long mode = 1;
-        ioctlsocket(sockfd, FIONBIO, &mode);
-#else
-        int flags = fcntl(sockfd, F_GETFL, 0);
-        fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
-#endif
+    dns_cache_init_mutex();
+    uint32_t hash = dns_cache_hash(host, port);
+    dns_cache_shard_t *shard = DNS_CACHE_SHARD(hash);
 
-        /* Attempt connection */
-        ret = connect(sockfd, rp->ai_addr, rp->ai_addrlen);
-        if (ret == 0) {
-            /* Connected immediately */
-            break;
-        }
+    dns_cache_lock(shard);
+    dns_cache_entry_t *entry = dns_cache_find(shard, hash, host, port);
+    if (entry) {
+        entry->preferred_family = family;
+    }
+    dns_cache_unlock(shard);
+}
 
-#ifndef _WIN32
-        /* On Unix, check for immediate connection failure */
-        if (errno == ECONNREFUSED || errno == ENETUNREACH || errno == EHOSTUNREACH ||
-            errno == ETIMEDOUT || errno == ECONNRESET) {
-            /* Connection failed immediately - don't wait, try next address */
-            if (sockfd > 2) close(sockfd);
-            sockfd = -1;
-            continue;
-        }
-#endif
+/* ====================================================================
+ * TCP CONNECTION
+ * ==================================================================== */
 
-#ifdef _WIN32
-        if (WSAGetLastError() == WSAEWOULDBLOCK) {
-#else
-        if (errno == EINPROGRESS) {
-#endif
-            /* Connection in progress - wait with select using polling approach */
-            uint64_t poll_start = httpmorph_get_time_us();
-            uint64_t poll_timeout_us = (uint64_t)timeout_ms * 1000;
-            int connected = 0;
+/**
+ * Socket options for each connection attempt
+ */
+static void tcp_socket_setup(int sockfd) {
+    /* Enable TCP_NODELAY (disable Nagle's algorithm for lower latency) */
+    int nodelay = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, (char*)&nodelay, sizeof(nodelay));
 
-            while (httpmorph_get_time_us() - poll_start < poll_timeout_us) {
-                fd_set write_fds, except_fds;
-                struct timeval tv;
+    /* Enable SO_REUSEADDR for faster socket reuse */
+    int reuse = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, (char*)&reuse, sizeof(reuse));
 
-                FD_ZERO(&write_fds);
-                FD_ZERO(&except_fds);
-                FD_SET(sockfd, &write_fds);
-                FD_SET(sockfd, &except_fds);
+    /* Enable SO_KEEPALIVE for connection health monitoring */
+    int keepalive = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, (char*)&keepalive, sizeof(keepalive));
 
-                /* Poll every 100ms to detect errors quickly */
-                tv.tv_sec = 0;
-                tv.tv_usec = 100000;  /* 100ms */
+    /* Optimize send/receive buffer sizes (64KB each for better throughput) */
+    int bufsize = 65536;
+    setsockopt(sockfd, SOL_SOCKET, SO_SNDBUF, (char*)&bufsize, sizeof(bufsize));
+    setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, (char*)&bufsize, sizeof(bufsize));
 
-                ret = select(SELECT_NFDS(sockfd), NULL, &write_fds, &except_fds, &tv);
+#ifdef TCP_QUICKACK
+    /* Enable TCP_QUICKACK on Linux for faster ACKs */
+    int quickack = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_QUICKACK, (char*)&quickack, sizeof(quickack));
+#endif
 
-                /* Check socket error after each poll */
-                int error = 0;
-                socklen_t len = sizeof(error);
-#ifdef _WIN32
-                if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, (char*)&error, (int*)&len) == 0) {
+#ifdef SO_REUSEPORT
+    /* Enable SO_REUSEPORT if available (Linux 3.9+, BSD) */
+    int reuseport = 1;
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, (char*)&reuseport, sizeof(reuseport));
+#endif
+}
+
+/**
+ * Ask for TCP Fast Open on a socket that hasn't connected yet
+ */
+void httpmorph_socket_enable_fast_open(int sockfd) {
+#ifdef TCP_FASTOPEN_CONNECT
+    /* connect() returns at once when the kernel holds a cookie for the
+     * server; the SYN then leaves with the first write */
+    int tfo = 1;
+    setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, (char*)&tfo, sizeof(tfo));
 #else
-                if (getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len) == 0) {
+    (void)sockfd;
 #endif
-                    if (error == 0 && ret > 0 && (FD_ISSET(sockfd, &write_fds) || FD_ISSET(sockfd, &except_fds))) {
-                        /* Connection succeeded */
-                        connected = 1;
-                        break;
-                    } else if (error != 0) {
-                        /* Connection failed - don't wait, try next address */
-                        break;
-                    }
-                }
-            }
+}
 
-            if (connected) {
-                break;  /* Successfully connected */
-            }
-            /* Connection failed or timed out - try next address */
-        }
+/**
+ * Socket options for each connection attempt, with TCP Fast Open
+ */
+static void tcp_socket_setup_fast_open(int sockfd) {
+    tcp_socket_setup(sockfd);
+    httpmorph_socket_enable_fast_open(sockfd);
+}
+
+/**
+ * Establish a TCP connection to a host
+ * Races all resolved addresses (Happy Eyeballs); timeout_ms bounds the race.
+ */
+int httpmorph_tcp_connect(const char *host, uint16_t port, uint32_t timeout_ms,
+                          bool fast_open, uint64_t *connect_time_us, uint64_t *dns_time_us) {
+    int sockfd = -1;
+    uint64_t start_time = httpmorph_get_time_us();
+    HTTPMORPH_PROBE2(connect__start, host, port);
+
+    int preferred_family = AF_UNSPEC;
+    struct addrinfo *result = httpmorph_dns_resolve(host, port, timeout_ms, &preferred_family, NULL);
+    HTTPMORPH_PROBE4(dns__done, host, port, result != NULL, httpmorph_get_time_us() - start_time);
+    if (!result) {
+        HTTPMORPH_PROBE4(connect__done, host, port, -1, httpmorph_get_time_us() - start_time);
+        return -1;
+    }
+    if (dns_time_us) {
+        *dns_time_us = httpmorph_get_time_us() - start_time;
+    }
 
-        /* Connection failed, try next address */
-        if (sockfd > 2) close(sockfd);
-        sockfd = -1;
+    happy_eyeballs_t *he = happy_eyeballs_create(result, preferred_family, 0,
+                                                 fast_open ? tcp_socket_setup_fast_open : tcp_socket_setup);
+    httpmorph_dns_free(result);
+    if (!he) {
+        HTTPMORPH_PROBE4(connect__done, host, port, -1, httpmorph_get_time_us() - start_time);
+        return -1;
     }
 
-    /* Free result using appropriate method */
-    if (need_free_result) {
-        addrinfo_deep_free(result);
-    } else {
-        freeaddrinfo(result);
+    uint64_t deadline = start_time + (uint64_t)timeout_ms * 1000;
+    int state;
+    for (;;) {
+        uint64_t now = httpmorph_get_time_us();
+        state = happy_eyeballs_step(he, now);
+        if (state != HAPPY_EYEBALLS_IN_PROGRESS || now >= deadline) {
+            break;
+        }
+        happy_eyeballs_wait(he, now, (uint32_t)((deadline - now + 999) / 1000));
     }
 
+    if (state == HAPPY_EYEBALLS_CONNECTED) {
+        int family = AF_UNSPEC;
+        sockfd = happy_eyeballs_take_winner(he, &family);
+        if (family != preferred_family) {
+            httpmorph_dns_set_preferred_family(host, port, family);
+        }
+    }
+    happy_eyeballs_destroy(he);
+
     if (sockfd != -1) {
         /* Set socket to blocking mode for HTTP/1.1 compatibility
          * (HTTP/2 will set it back to non-blocking later if negotiated) */
@@ -503,22 +804,6 @@ int httpmorph_tcp_connect(const char *host, uint16_t port, uint32_t timeout_ms,
         int keepcnt = 3;
         setsockopt(sockfd, IPPROTO_TCP, TCP_KEEPCNT, &keepcnt, sizeof(keepcnt));
         #endif
-
-        #ifdef __APPLE__
-        /* Enable TCP Fast Open on macOS for reduced latency */
-        #ifdef TCP_FASTOPEN
-        int tfo = 1;
-        setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN, &tfo, sizeof(tfo));
-        #endif
-        #endif
-
-        #ifdef __linux__
-        /* Enable TCP Fast Open on Linux */
-        #ifdef TCP_FASTOPEN_CONNECT
-        int tfo = 1;
-        setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &tfo, sizeof(tfo));
-        #endif
-        #endif
 #endif
 
         /* Set receive timeout to prevent indefinite blocking */
@@ -535,5 +820,78 @@ int httpmorph_tcp_connect(const char *host, uint16_t port, uint32_t timeout_ms,
         *connect_time_us = httpmorph_get_time_us() - start_time;
     }
 
+    HTTPMORPH_PROBE4(connect__done, host, port, sockfd, httpmorph_get_time_us() - start_time);
     return sockfd;
 }
+
+/* ====================================================================
+ * FILE BODIES
+ * ==================================================================== */
+
+/**
+ * Send part of a file over a plain (blocking) socket
+ */
+int httpmorph_send_file(int sockfd, int fd, uint64_t offset, size_t len) {
+#if defined(__linux__)
+    while (len > 0) {
+        off_t off = (off_t)offset;
+        ssize_t sent = sendfile(sockfd, fd, &off, len);
+        if (sent < 0 && errno == EINTR) {
+            continue;
+        }
+        if (sent < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            break;  /* File type sendfile() can't handle: copy the rest by hand */
+        }
+        if (sent <= 0) {
+            return -1;  /* Error or end of file before len bytes */
+        }
+        offset += (uint64_t)sent;
+        len -= (size_t)sent;
+    }
+#elif defined(__APPLE__)
+    while (len > 0) {
+        off_t chunk = (off_t)(len > SEND_FILE_CHUNK * 16 ? SEND_FILE_CHUNK * 16 : len);
+        int rc = sendfile(fd, sockfd, (off_t)offset, &chunk, NULL, 0);
+        offset += (uint64_t)chunk;  /* Set even when interrupted */
+        len -= (size_t)chunk;
+        if (rc == 0 && chunk == 0) {
+            return -1;  /* End of file before len bytes */
+        }
+        if (rc < 0 && errno != EINTR && errno != EAGAIN) {
+            if (errno == ENOTSUP || errno == ENOTSOCK || errno == EOPNOTSUPP) {
+                break;
+            }
+            return -1;
+        }
+    }
+#endif
+    if (len == 0) {
+        return 0;
+    }
+
+    char *buf = malloc(SEND_FILE_CHUNK);
+    if (!buf) {
+        return -1;
+    }
+    int result = 0;
+    while (len > 0 && result == 0) {
+        int64_t got = httpmorph_file_read_at(fd, buf, len < SEND_FILE_CHUNK ? len : SEND_FILE_CHUNK, offset);
+        if (got <= 0) {
+            result = -1;
+            break;
+        }
+        size_t pos = 0;
+        while (pos < (size_t)got) {
+            ssize_t sent = send(sockfd, buf + pos, (int)((size_t)got - pos), 0);
+            if (sent <= 0) {
+                result = -1;
+                break;
+            }
+            pos += (size_t)sent;
+        }
+        offset += (uint64_t)got;
+        len -= (size_t)got;
+    }
+    free(buf);
+    return result;
+}
@@ -0,0 +1,198 @@
+/**
+ * preconnect.c - Open connections ahead of requests
+ *
+ * Each connection to open is a job; a few worker threads (at most
+ * HTTPMORPH_PRECONNECT_MAX_THREADS) take jobs until none are left, every
+ * one going through httpmorph_preconnect_origin() so the connection is
+ * exactly what a request would have opened. Each origin's first
+ * connection comes first in the job list. As in batches, when HTTP/2 may
+ * be negotiated an origin's other connections wait for its first one and
+ * are skipped if that one got HTTP/2; they then also resume its TLS
+ * session instead of each doing a full handshake.
+ */
+
+#include "internal/core.h"
+#include "internal/session.h"
+#include "internal/url.h"
+#include "internal/util.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* An origin being preconnected */
+typedef struct {
+    char *host;
+    uint16_t port;
+    bool use_tls;
+    bool valid;                 /* URL parsed */
+    bool first_done;            /* First connection finished (its outcome is in result) */
+    bool first_opened;
+    httpmorph_preconnect_result_t *result;
+    uint64_t start_us;
+} preconnect_origin_t;
+
+typedef struct {
+    httpmorph_client_t *client;
+    httpmorph_pool_t *pool;
+    preconnect_origin_t *origins;
+    size_t count;
+    int per_host;
+    bool http2;
+    bool verify_ssl;
+    uint32_t timeout_ms;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;        /* Signals finished first connections */
+    size_t next_job;            /* Jobs 0..count-1 are first connections */
+} preconnect_t;
+
+/* Helper: Whether an origin's extra connections wait for its first (mutex held) */
+static bool preconnect_waits(const preconnect_t *pc, const preconnect_origin_t *origin) {
+    return pc->http2 && origin->use_tls;
+}
+
+/* Worker: open connections until every job is taken */
+static void* preconnect_worker(void *arg) {
+    preconnect_t *pc = (preconnect_t*)arg;
+    size_t jobs = pc->count * (size_t)pc->per_host;
+
+    pthread_mutex_lock(&pc->mutex);
+    while (pc->next_job < jobs) {
+        size_t job = pc->next_job++;
+        preconnect_origin_t *origin = &pc->origins[job % pc->count];
+        bool first = job < pc->count;
+        if (!origin->valid) {
+            continue;
+        }
+
+        if (!first) {
+            if (preconnect_waits(pc, origin)) {
+                while (!origin->first_done) {
+                    pthread_cond_wait(&pc->cond, &pc->mutex);
+                }
+            }
+            /* One HTTP/2 connection serves everything; a failed origin stays failed */
+            if (origin->result->http2 || (origin->first_done && !origin->first_opened)) {
+                continue;
+            }
+        }
+        pthread_mutex_unlock(&pc->mutex);
+
+        httpmorph_preconnect_result_t outcome;
+        memset(&outcome, 0, sizeof(outcome));
+        int rc = httpmorph_preconnect_origin(pc->client, pc->pool, origin->host, origin->port,
+                                             origin->use_tls, pc->http2, pc->verify_ssl,
+                                             pc->timeout_ms, &outcome);
+
+        pthread_mutex_lock(&pc->mutex);
+        httpmorph_preconnect_result_t *result = origin->result;
+        if (rc == 0) {
+            if (result->connections == 0) {
+                /* Timings and protocol of the first connection opened */
+                *result = outcome;
+                result->connections = 0;
+            }
+            result->connections++;
+            result->error = HTTPMORPH_OK;
+            result->tls_resumed = result->tls_resumed || outcome.tls_resumed;
+        } else if (result->connections == 0) {
+            result->error = outcome.error;
+        }
+        result->total_time_us = httpmorph_get_time_us() - origin->start_us;
+        if (first) {
+            origin->first_done = true;
+            origin->first_opened = rc == 0;
+            pthread_cond_broadcast(&pc->cond);
+        }
+    }
+    pthread_mutex_unlock(&pc->mutex);
+    return NULL;
+}
+
+/**
+ * Open connections to origins before any request needs them
+ */
+int httpmorph_session_preconnect(httpmorph_session_t *session,
+                                 const char *const *urls, size_t count,
+                                 int per_host, bool http2, bool verify_ssl,
+                                 uint32_t timeout_ms,
+                                 httpmorph_preconnect_result_t *results) {
+    if (!session || !session->pool || (!urls && count > 0) || (!results && count > 0)) {
+        return -1;
+    }
+    if (count == 0) {
+        return 0;
+    }
+    if (per_host < 1) {
+        per_host = 1;
+    }
+
+    preconnect_t pc;
+    memset(&pc, 0, sizeof(pc));
+    pc.client = session->client;
+    pc.pool = session->pool;
+    pc.count = count;
+    pc.per_host = per_host;
+    pc.http2 = http2;
+    pc.verify_ssl = verify_ssl;
+    pc.timeout_ms = timeout_ms;
+    pc.origins = calloc(count, sizeof(preconnect_origin_t));
+    if (!pc.origins) {
+        return -1;
+    }
+
+    uint64_t start_us = httpmorph_get_time_us();
+    for (size_t i = 0; i < count; i++) {
+        preconnect_origin_t *origin = &pc.origins[i];
+        memset(&results[i], 0, sizeof(results[i]));
+        origin->result = &results[i];
+        origin->start_us = start_us;
+
+        char *scheme = NULL, *path = NULL;
+        if (urls[i] && httpmorph_parse_url(urls[i], &scheme, &origin->host, &origin->port, &path) == 0 &&
+            scheme && (strcmp(scheme, "https") == 0 || strcmp(scheme, "http") == 0)) {
+            origin->use_tls = strcmp(scheme, "https") == 0;
+            origin->valid = true;
+            results[i].error = HTTPMORPH_ERROR_NETWORK;  /* Until a connection opens */
+        } else {
+            results[i].error = HTTPMORPH_ERROR_PARSE;
+        }
+        free(scheme);
+        free(path);
+    }
+
+    pthread_mutex_init(&pc.mutex, NULL);
+    pthread_cond_init(&pc.cond, NULL);
+
+    /* A thread only ever waits for a first connection another thread is
+     * already opening, so any number of threads gets through the jobs */
+    size_t jobs = count * (size_t)per_host;
+    size_t thread_count = jobs < HTTPMORPH_PRECONNECT_MAX_THREADS ? jobs : HTTPMORPH_PRECONNECT_MAX_THREADS;
+    pthread_t threads[HTTPMORPH_PRECONNECT_MAX_THREADS];
+    size_t started = 0;
+    for (size_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&threads[started], NULL, preconnect_worker, &pc) != 0) {
+            break;
+        }
+        started++;
+    }
+    if (started == 0) {
+        preconnect_worker(&pc);  /* No threads: do it here, one at a time */
+    }
+    for (size_t i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    int opened = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (results[i].connections > 0) {
+            opened++;
+        }
+        free(pc.origins[i].host);
+    }
+
+    pthread_cond_destroy(&pc.cond);
+    pthread_mutex_destroy(&pc.mutex);
+    free(pc.origins);
+    return opened;
+}
@@ -1,10 +1,39 @@
 /**
- * proxy.c - HTTP proxy handling
+ * proxy.c - HTTP and SOCKS5 proxy handling
  */
 
 #include "internal/proxy.h"
+#include "internal/network.h"
 #include "internal/util.h"
 
+/* SOCKS5 handshake stages */
+enum {
+    SOCKS5_STAGE_GREETING,      /* Offered auth methods, reading the choice */
+    SOCKS5_STAGE_AUTH,          /* Sent username/password, reading the verdict */
+    SOCKS5_STAGE_CONNECT,       /* Sent CONNECT, reading the reply */
+    SOCKS5_STAGE_DONE,
+    SOCKS5_STAGE_FAILED,
+};
+
+/**
+ * Get the kind of proxy a URL names from its scheme
+ */
+httpmorph_proxy_type_t httpmorph_proxy_type(const char *proxy_url) {
+    if (!proxy_url) {
+        return HTTPMORPH_PROXY_HTTP;
+    }
+    if (strncasecmp(proxy_url, "socks5h://", 10) == 0) {
+        return HTTPMORPH_PROXY_SOCKS5H;
+    }
+    if (strncasecmp(proxy_url, "socks5://", 9) == 0) {
+        return HTTPMORPH_PROXY_SOCKS5;
+    }
+    if (strncasecmp(proxy_url, "https://", 8) == 0) {
+        return HTTPMORPH_PROXY_HTTPS;
+    }
+    return HTTPMORPH_PROXY_HTTP;
+}
+
 /**
  * Parse a proxy URL
  */
@@ -20,16 +49,23 @@ int httpmorph_parse_proxy_url(const char *proxy_url, char **host, uint16_t *port
     if (password) *password = NULL;
     if (use_tls) *use_tls = false;
 
-    /* Parse proxy URL format: [http://][username:password@]host:port */
+    /* Parse proxy URL format: [scheme://][username:password@]host:port */
     const char *start = proxy_url;
+    uint16_t default_port = 8080;
 
-    /* Skip http:// or https:// and detect if proxy uses TLS */
+    /* Skip the scheme and detect if proxy uses TLS */
     if (strncmp(start, "http://", 7) == 0) {
         start += 7;
         if (use_tls) *use_tls = false;
     } else if (strncmp(start, "https://", 8) == 0) {
         start += 8;
         if (use_tls) *use_tls = true;
+    } else if (httpmorph_proxy_type(start) == HTTPMORPH_PROXY_SOCKS5H) {
+        start += 10;
+        default_port = 1080;
+    } else if (httpmorph_proxy_type(start) == HTTPMORPH_PROXY_SOCKS5) {
+        start += 9;
+        default_port = 1080;
     }
 
     /* Check for username:password@ */
@@ -55,7 +91,7 @@ int httpmorph_parse_proxy_url(const char *proxy_url, char **host, uint16_t *port
         *port = (uint16_t)atoi(colon + 1);
     } else {
         *host = strdup(start);
-        *port = 8080;  /* Default proxy port */
+        *port = default_port;
     }
 
     return (*host != NULL) ? 0 : -1;
@@ -129,3 +165,251 @@ int httpmorph_proxy_connect(int sockfd, SSL *proxy_ssl, const char *target_host,
 
     return -1;  /* Proxy connection failed */
 }
+
+/* === SOCKS5 === */
+
+static void socks5_fail(httpmorph_socks5_t *s, const char *error) {
+    s->stage = SOCKS5_STAGE_FAILED;
+    s->error = error;
+}
+
+static void socks5_expect(httpmorph_socks5_t *s, size_t want) {
+    s->out_sent = 0;
+    s->in_len = 0;
+    s->in_want = want;
+}
+
+/**
+ * Queue the CONNECT request for the target
+ */
+static void socks5_queue_connect(httpmorph_socks5_t *s) {
+    uint8_t *p = s->out;
+    *p++ = 0x05;    /* Version */
+    *p++ = 0x01;    /* CONNECT */
+    *p++ = 0x00;    /* Reserved */
+
+    if (s->addr.ss_family == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)&s->addr;
+        *p++ = 0x01;
+        memcpy(p, &sin->sin_addr, 4);
+        p += 4;
+    } else if (s->addr.ss_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)&s->addr;
+        *p++ = 0x04;
+        memcpy(p, &sin6->sin6_addr, 16);
+        p += 16;
+    } else {
+        size_t host_len = strlen(s->host);
+        *p++ = 0x03;
+        *p++ = (uint8_t)host_len;
+        memcpy(p, s->host, host_len);
+        p += host_len;
+    }
+
+    *p++ = (uint8_t)(s->port >> 8);
+    *p++ = (uint8_t)(s->port & 0xff);
+
+    s->out_len = (size_t)(p - s->out);
+    s->stage = SOCKS5_STAGE_CONNECT;
+    /* Version, reply, reserved, address type and the first address byte */
+    socks5_expect(s, 5);
+}
+
+static const char* socks5_reply_error(uint8_t reply) {
+    switch (reply) {
+        case 0x01: return "SOCKS5 general server failure";
+        case 0x02: return "SOCKS5 connection not allowed by ruleset";
+        case 0x03: return "SOCKS5 network unreachable";
+        case 0x04: return "SOCKS5 host unreachable";
+        case 0x05: return "SOCKS5 connection refused";
+        case 0x06: return "SOCKS5 TTL expired";
+        case 0x07: return "SOCKS5 command not supported";
+        case 0x08: return "SOCKS5 address type not supported";
+        default:   return "SOCKS5 CONNECT failed";
+    }
+}
+
+int httpmorph_socks5_init(httpmorph_socks5_t *s, const char *host, uint16_t port,
+                          const struct sockaddr *addr, const char *username,
+                          const char *password) {
+    if (!s || !host) {
+        return -1;
+    }
+    memset(s, 0, sizeof(*s));
+
+    bool auth = username && password;
+    if (strlen(host) > 255 || (auth && (strlen(username) > 255 || strlen(password) > 255))) {
+        return -1;
+    }
+
+    s->host = host;
+    s->port = port;
+    if (addr && (addr->sa_family == AF_INET || addr->sa_family == AF_INET6)) {
+        memcpy(&s->addr, addr, addr->sa_family == AF_INET ? sizeof(struct sockaddr_in)
+                                                          : sizeof(struct sockaddr_in6));
+    }
+    s->username = auth ? username : NULL;
+    s->password = auth ? password : NULL;
+
+    /* Greeting: offer username/password only when we have credentials */
+    s->out[0] = 0x05;
+    if (auth) {
+        s->out[1] = 0x02;
+        s->out[2] = 0x00;   /* No authentication */
+        s->out[3] = 0x02;   /* Username/password */
+        s->out_len = 4;
+    } else {
+        s->out[1] = 0x01;
+        s->out[2] = 0x00;
+        s->out_len = 3;
+    }
+    s->stage = SOCKS5_STAGE_GREETING;
+    socks5_expect(s, 2);
+    return 0;
+}
+
+const uint8_t* httpmorph_socks5_output(const httpmorph_socks5_t *s, size_t *len) {
+    bool sending = s->stage < SOCKS5_STAGE_DONE && s->out_sent < s->out_len;
+    *len = sending ? s->out_len - s->out_sent : 0;
+    return s->out + s->out_sent;
+}
+
+void httpmorph_socks5_sent(httpmorph_socks5_t *s, size_t n) {
+    s->out_sent += n;
+}
+
+uint8_t* httpmorph_socks5_input(httpmorph_socks5_t *s, size_t *len) {
+    bool reading = s->stage < SOCKS5_STAGE_DONE && s->out_sent >= s->out_len;
+    *len = reading ? s->in_want - s->in_len : 0;
+    return s->in + s->in_len;
+}
+
+int httpmorph_socks5_received(httpmorph_socks5_t *s, size_t n) {
+    if (s->stage >= SOCKS5_STAGE_DONE) {
+        return s->stage == SOCKS5_STAGE_DONE ? 1 : -1;
+    }
+
+    s->in_len += n;
+    if (s->in_len < s->in_want) {
+        return 0;
+    }
+
+    switch (s->stage) {
+        case SOCKS5_STAGE_GREETING:
+            if (s->in[0] != 0x05) {
+                socks5_fail(s, "Not a SOCKS5 proxy");
+            } else if (s->in[1] == 0x00) {
+                socks5_queue_connect(s);
+            } else if (s->in[1] == 0x02 && s->username) {
+                size_t user_len = strlen(s->username);
+                size_t pass_len = strlen(s->password);
+                uint8_t *p = s->out;
+                *p++ = 0x01;    /* Subnegotiation version */
+                *p++ = (uint8_t)user_len;
+                memcpy(p, s->username, user_len);
+                p += user_len;
+                *p++ = (uint8_t)pass_len;
+                memcpy(p, s->password, pass_len);
+                p += pass_len;
+                s->out_len = (size_t)(p - s->out);
+                s->stage = SOCKS5_STAGE_AUTH;
+                socks5_expect(s, 2);
+            } else {
+                socks5_fail(s, "SOCKS5 proxy accepts none of our authentication methods");
+            }
+            break;
+
+        case SOCKS5_STAGE_AUTH:
+            if (s->in[1] != 0x00) {
+                socks5_fail(s, "SOCKS5 authentication failed");
+            } else {
+                socks5_queue_connect(s);
+            }
+            break;
+
+        case SOCKS5_STAGE_CONNECT:
+            if (s->in_want == 5) {
+                if (s->in[0] != 0x05) {
+                    socks5_fail(s, "Malformed SOCKS5 reply");
+                    break;
+                }
+                if (s->in[1] != 0x00) {
+                    socks5_fail(s, socks5_reply_error(s->in[1]));
+                    break;
+                }
+                /* Bound address length depends on its type */
+                switch (s->in[3]) {
+                    case 0x01: s->in_want = 4 + 4 + 2; break;
+                    case 0x04: s->in_want = 4 + 16 + 2; break;
+                    case 0x03: s->in_want = 4 + 1 + (size_t)s->in[4] + 2; break;
+                    default:
+                        socks5_fail(s, "Malformed SOCKS5 reply");
+                        break;
+                }
+            } else {
+                s->stage = SOCKS5_STAGE_DONE;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (s->stage == SOCKS5_STAGE_DONE) {
+        return 1;
+    }
+    return s->stage == SOCKS5_STAGE_FAILED ? -1 : 0;
+}
+
+/**
+ * Establish a SOCKS5 tunnel on a blocking socket connected to the proxy
+ */
+int httpmorph_socks5_connect(int sockfd, const char *target_host, uint16_t target_port,
+                             bool remote_dns, const char *proxy_username,
+                             const char *proxy_password, uint32_t timeout_ms) {
+    httpmorph_socks5_t s;
+    int rc;
+
+    if (remote_dns) {
+        rc = httpmorph_socks5_init(&s, target_host, target_port, NULL,
+                                   proxy_username, proxy_password);
+    } else {
+        /* socks5:// - the proxy is given an address we resolved */
+        int family = AF_UNSPEC;
+        struct addrinfo *addrs = httpmorph_dns_resolve(target_host, target_port, timeout_ms,
+                                                       &family, NULL);
+        if (!addrs) {
+            return -1;
+        }
+        rc = httpmorph_socks5_init(&s, target_host, target_port, addrs->ai_addr,
+                                   proxy_username, proxy_password);
+        httpmorph_dns_free(addrs);
+    }
+    if (rc != 0) {
+        return -1;
+    }
+
+    for (;;) {
+        size_t len = 0;
+        const uint8_t *out = httpmorph_socks5_output(&s, &len);
+        if (len > 0) {
+            ssize_t sent = send(sockfd, (const char *)out, len, 0);
+            if (sent <= 0) {
+                return -1;
+            }
+            httpmorph_socks5_sent(&s, (size_t)sent);
+            continue;
+        }
+
+        uint8_t *in = httpmorph_socks5_input(&s, &len);
+        ssize_t received = recv(sockfd, (char *)in, len, 0);
+        if (received <= 0) {
+            return -1;
+        }
+
+        rc = httpmorph_socks5_received(&s, (size_t)received);
+        if (rc != 0) {
+            return rc > 0 ? 0 : -1;
+        }
+    }
+}
@@ -0,0 +1,495 @@
+/**
+ * proxy_set.c - Proxy rotation with health scoring
+ *
+ * Members live in an array under one lock; picks are O(members) weighted
+ * draws. Each member is reference counted so a request can keep using a
+ * proxy that is removed while it is in flight. Sticky assignments are a
+ * direct-mapped table of host hash -> member; a collision only costs the
+ * host its assignment.
+ */
+
+#include "internal/internal.h"
+#include "internal/util.h"
+#include "proxy_set.h"
+
+/* One proxy */
+struct proxy_set_member {
+    char *url;
+    char *username;
+    char *password;
+    uint32_t id;                 /* Unique within the set (sticky slots refer to it) */
+    size_t refs;                 /* Set plus picks in flight (under the set lock) */
+
+    /* Health */
+    double latency_us;           /* EWMA of connect + TLS time (0 = unmeasured) */
+    double error_rate;           /* EWMA of failures, 0..1 */
+    uint32_t consecutive_failures;
+    uint32_t eject_streak;       /* Ejections since the last success */
+    uint64_t ejected_until_us;   /* 0 = in rotation */
+
+    uint64_t requests;
+    uint64_t failures;
+    uint64_t ejections;
+};
+
+typedef struct {
+    uint64_t host_hash;
+    uint32_t member_id;          /* 0 = empty */
+    uint32_t index;              /* Where the member was (checked against its id) */
+} proxy_set_sticky_t;
+
+/* Proxy set structure */
+struct httpmorph_proxy_set {
+    proxy_set_member_t **members;
+    size_t count;
+    size_t capacity;
+    uint32_t next_id;
+
+    uint32_t eject_failures;
+    uint32_t eject_ms;
+    proxy_set_sticky_t *sticky;  /* NULL unless sticky_hosts */
+
+    uint64_t rng;                /* xorshift64 state for weighted draws */
+    size_t refs;                 /* Creator plus attached clients */
+
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+};
+
+#ifndef _WIN32
+#define SET_LOCK(s)   pthread_mutex_lock(&(s)->mutex)
+#define SET_UNLOCK(s) pthread_mutex_unlock(&(s)->mutex)
+#else
+#define SET_LOCK(s)   EnterCriticalSection(&(s)->mutex)
+#define SET_UNLOCK(s) LeaveCriticalSection(&(s)->mutex)
+#endif
+
+/* ====================================================================
+ * Helpers
+ * ================================================================== */
+
+static void member_free(proxy_set_member_t *member) {
+    free(member->url);
+    free(member->username);
+    free(member->password);
+    free(member);
+}
+
+static char* strdup_or_null(const char *s, bool *failed) {
+    if (!s) {
+        return NULL;
+    }
+    char *copy = strdup(s);
+    if (!copy) {
+        *failed = true;
+    }
+    return copy;
+}
+
+static double set_random(httpmorph_proxy_set_t *set) {
+    uint64_t x = set->rng;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    set->rng = x;
+    return (double)(x >> 11) * (1.0 / 9007199254740992.0);  /* [0, 1) */
+}
+
+/**
+ * Hash the authority of a URL ("scheme://host:port/..." -> "host:port")
+ */
+static uint64_t host_hash(const char *url) {
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+
+    uint64_t hash = 14695981039346656037ULL;
+    for (; *p && *p != '/' && *p != '?' && *p != '#'; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 'A' && c <= 'Z') {
+            c = (unsigned char)(c - 'A' + 'a');
+        }
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool member_ejected(const proxy_set_member_t *member, uint64_t now) {
+    return member->ejected_until_us > now;
+}
+
+static bool set_find(const httpmorph_proxy_set_t *set, const char *url, size_t *index) {
+    for (size_t i = 0; i < set->count; i++) {
+        if (strcmp(set->members[i]->url, url) == 0) {
+            *index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Weighted draw among the proxies in rotation (set lock held)
+ * With every proxy ejected, the one due back first is used.
+ */
+static size_t set_draw(httpmorph_proxy_set_t *set, uint64_t now) {
+    /* Unmeasured proxies are assumed average so they get tried */
+    double latency_sum = 0;
+    size_t measured = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        if (set->members[i]->latency_us > 0) {
+            latency_sum += set->members[i]->latency_us;
+            measured++;
+        }
+    }
+    double baseline = measured ? latency_sum / (double)measured : 1.0;
+
+    double total = 0;
+    size_t soonest = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        const proxy_set_member_t *m = set->members[i];
+        if (member_ejected(m, now)) {
+            if (m->ejected_until_us < set->members[soonest]->ejected_until_us) {
+                soonest = i;
+            }
+            continue;
+        }
+        double latency = m->latency_us > 0 ? m->latency_us : baseline;
+        total += 1.0 / (latency * (1.0 + PROXY_SET_ERROR_PENALTY * m->error_rate));
+    }
+    if (total <= 0) {
+        return soonest;
+    }
+
+    double target = set_random(set) * total;
+    size_t last = soonest;
+    for (size_t i = 0; i < set->count; i++) {
+        const proxy_set_member_t *m = set->members[i];
+        if (member_ejected(m, now)) {
+            continue;
+        }
+        double latency = m->latency_us > 0 ? m->latency_us : baseline;
+        target -= 1.0 / (latency * (1.0 + PROXY_SET_ERROR_PENALTY * m->error_rate));
+        last = i;
+        if (target < 0) {
+            break;
+        }
+    }
+    return last;
+}
+
+/* ====================================================================
+ * Public API
+ * ================================================================== */
+
+/**
+ * Create a proxy set
+ */
+httpmorph_proxy_set_t* httpmorph_proxy_set_create(const httpmorph_proxy_set_config_t *config) {
+    httpmorph_proxy_set_t *set = calloc(1, sizeof(httpmorph_proxy_set_t));
+    if (!set) {
+        return NULL;
+    }
+
+    set->eject_failures = config && config->eject_failures
+        ? config->eject_failures : PROXY_SET_DEFAULT_EJECT_FAILURES;
+    set->eject_ms = config && config->eject_ms ? config->eject_ms : PROXY_SET_DEFAULT_EJECT_MS;
+    if (config && config->sticky_hosts) {
+        set->sticky = calloc(PROXY_SET_STICKY_SLOTS, sizeof(proxy_set_sticky_t));
+        if (!set->sticky) {
+            free(set);
+            return NULL;
+        }
+    }
+
+    set->rng = httpmorph_get_time_us() ^ (uint64_t)(uintptr_t)set;
+    if (set->rng == 0) {
+        set->rng = 0x9e3779b97f4a7c15ULL;
+    }
+    set->refs = 1;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&set->mutex);
+#else
+    pthread_mutex_init(&set->mutex, NULL);
+#endif
+
+    return set;
+}
+
+/**
+ * Take a reference on a proxy set
+ */
+void proxy_set_retain(httpmorph_proxy_set_t *set) {
+    if (set) {
+        SET_LOCK(set);
+        set->refs++;
+        SET_UNLOCK(set);
+    }
+}
+
+/**
+ * Release a reference; the last one frees the set
+ */
+void httpmorph_proxy_set_destroy(httpmorph_proxy_set_t *set) {
+    if (!set) {
+        return;
+    }
+
+    SET_LOCK(set);
+    bool last = --set->refs == 0;
+    SET_UNLOCK(set);
+    if (!last) {
+        return;
+    }
+
+    /* No client holds the set, so no pick is in flight */
+    for (size_t i = 0; i < set->count; i++) {
+        member_free(set->members[i]);
+    }
+#ifdef _WIN32
+    DeleteCriticalSection(&set->mutex);
+#else
+    pthread_mutex_destroy(&set->mutex);
+#endif
+    free(set->members);
+    free(set->sticky);
+    free(set);
+}
+
+/**
+ * Add a proxy (or replace the credentials of one already in the set)
+ */
+int httpmorph_proxy_set_add(httpmorph_proxy_set_t *set, const char *proxy_url,
+                            const char *username, const char *password) {
+    if (!set || !proxy_url || !proxy_url[0]) {
+        return -1;
+    }
+
+    bool failed = false;
+    proxy_set_member_t *member = calloc(1, sizeof(proxy_set_member_t));
+    if (!member) {
+        return -1;
+    }
+    member->url = strdup_or_null(proxy_url, &failed);
+    member->username = strdup_or_null(username, &failed);
+    member->password = strdup_or_null(password, &failed);
+    member->refs = 1;
+    if (failed) {
+        member_free(member);
+        return -1;
+    }
+
+    proxy_set_member_t *replaced = NULL;
+    size_t existing;
+    SET_LOCK(set);
+    if (set_find(set, proxy_url, &existing)) {
+        /* Same proxy, new credentials: keep its health, drop its assignments */
+        replaced = set->members[existing];
+        member->latency_us = replaced->latency_us;
+        member->error_rate = replaced->error_rate;
+        member->consecutive_failures = replaced->consecutive_failures;
+        member->eject_streak = replaced->eject_streak;
+        member->ejected_until_us = replaced->ejected_until_us;
+        member->requests = replaced->requests;
+        member->failures = replaced->failures;
+        member->ejections = replaced->ejections;
+        member->id = ++set->next_id;
+        set->members[existing] = member;
+        replaced = --replaced->refs == 0 ? replaced : NULL;
+    } else {
+        if (set->count == set->capacity) {
+            size_t capacity = set->capacity ? set->capacity * 2 : 16;
+            proxy_set_member_t **members = realloc(set->members, capacity * sizeof(*members));
+            if (!members) {
+                SET_UNLOCK(set);
+                member_free(member);
+                return -1;
+            }
+            set->members = members;
+            set->capacity = capacity;
+        }
+        member->id = ++set->next_id;
+        set->members[set->count++] = member;
+    }
+    SET_UNLOCK(set);
+
+    if (replaced) {
+        member_free(replaced);
+    }
+    return 0;
+}
+
+/**
+ * Remove a proxy (requests using it finish normally)
+ */
+int httpmorph_proxy_set_remove(httpmorph_proxy_set_t *set, const char *proxy_url) {
+    if (!set || !proxy_url) {
+        return -1;
+    }
+
+    proxy_set_member_t *removed = NULL;
+    size_t index;
+    SET_LOCK(set);
+    if (!set_find(set, proxy_url, &index)) {
+        SET_UNLOCK(set);
+        return -1;
+    }
+    proxy_set_member_t *member = set->members[index];
+    set->members[index] = set->members[--set->count];
+    if (--member->refs == 0) {
+        removed = member;
+    }
+    SET_UNLOCK(set);
+
+    if (removed) {
+        member_free(removed);
+    }
+    return 0;
+}
+
+/**
+ * Get the number of proxies in a set
+ */
+size_t httpmorph_proxy_set_count(httpmorph_proxy_set_t *set) {
+    if (!set) {
+        return 0;
+    }
+    SET_LOCK(set);
+    size_t count = set->count;
+    SET_UNLOCK(set);
+    return count;
+}
+
+/**
+ * Get one proxy's health
+ */
+int httpmorph_proxy_set_get_stats(httpmorph_proxy_set_t *set, const char *proxy_url,
+                                  httpmorph_proxy_stats_t *stats) {
+    if (!set || !proxy_url || !stats) {
+        return -1;
+    }
+
+    uint64_t now = httpmorph_get_time_us();
+    size_t index;
+    SET_LOCK(set);
+    if (!set_find(set, proxy_url, &index)) {
+        SET_UNLOCK(set);
+        return -1;
+    }
+    const proxy_set_member_t *m = set->members[index];
+    stats->requests = m->requests;
+    stats->failures = m->failures;
+    stats->ejections = m->ejections;
+    stats->latency_us = m->latency_us;
+    stats->error_rate = m->error_rate;
+    stats->ejected = member_ejected(m, now);
+    stats->ejected_ms_left = stats->ejected ? (uint32_t)((m->ejected_until_us - now + 999) / 1000) : 0;
+    SET_UNLOCK(set);
+    return 0;
+}
+
+/* ====================================================================
+ * Request routing
+ * ================================================================== */
+
+/**
+ * Choose a proxy for a request
+ */
+int proxy_set_pick(httpmorph_proxy_set_t *set, const char *url, proxy_set_pick_t *pick) {
+    memset(pick, 0, sizeof(*pick));
+
+    uint64_t now = httpmorph_get_time_us();
+    uint64_t hash = set->sticky ? host_hash(url) : 0;
+
+    SET_LOCK(set);
+    if (set->count == 0) {
+        SET_UNLOCK(set);
+        return -1;
+    }
+
+    proxy_set_member_t *member = NULL;
+    proxy_set_sticky_t *slot = NULL;
+    if (set->sticky) {
+        slot = &set->sticky[hash & (PROXY_SET_STICKY_SLOTS - 1)];
+        if (slot->member_id && slot->host_hash == hash && slot->index < set->count &&
+            set->members[slot->index]->id == slot->member_id &&
+            !member_ejected(set->members[slot->index], now)) {
+            member = set->members[slot->index];
+        }
+    }
+
+    if (!member) {
+        size_t index = set_draw(set, now);
+        member = set->members[index];
+        if (slot) {
+            slot->host_hash = hash;
+            slot->member_id = member->id;
+            slot->index = (uint32_t)index;
+        }
+    }
+
+    member->refs++;
+    SET_UNLOCK(set);
+
+    pick->member = member;
+    pick->url = member->url;
+    pick->username = member->username;
+    pick->password = member->password;
+    return 0;
+}
+
+/**
+ * Feed a request's outcome back and release the pick
+ */
+void proxy_set_report(httpmorph_proxy_set_t *set, proxy_set_pick_t *pick,
+                      const httpmorph_response_t *response) {
+    proxy_set_member_t *m = pick->member;
+    if (!m) {
+        return;
+    }
+
+    /* Failures the proxy is answerable for: no response from the origin at
+     * all, or the proxy refusing us */
+    bool failed = !response || response->error != HTTPMORPH_OK || response->status_code == 407;
+    uint64_t now = httpmorph_get_time_us();
+
+    SET_LOCK(set);
+    m->requests++;
+    if (failed) {
+        m->failures++;
+        m->error_rate += PROXY_SET_ERROR_ALPHA * (1.0 - m->error_rate);
+        if (++m->consecutive_failures >= set->eject_failures && !member_ejected(m, now)) {
+            uint64_t factor = 1;
+            for (uint32_t i = 0; i < m->eject_streak && factor < PROXY_SET_MAX_EJECT_FACTOR; i++) {
+                factor *= 2;
+            }
+            m->ejected_until_us = now + (uint64_t)set->eject_ms * factor * 1000;
+            m->ejections++;
+            m->eject_streak++;
+            /* Back in rotation, one more failure ejects it again */
+            m->consecutive_failures = set->eject_failures - 1;
+        }
+    } else {
+        m->error_rate *= 1.0 - PROXY_SET_ERROR_ALPHA;
+        m->consecutive_failures = 0;
+        m->eject_streak = 0;
+
+        /* Only new connections say anything about the proxy's latency */
+        if (response->connect_time_us > 0) {
+            double sample = (double)(response->connect_time_us + response->tls_time_us);
+            m->latency_us = m->latency_us > 0
+                ? m->latency_us + PROXY_SET_LATENCY_ALPHA * (sample - m->latency_us)
+                : sample;
+        }
+    }
+    bool last = --m->refs == 0;
+    SET_UNLOCK(set);
+
+    if (last) {
+        member_free(m);
+    }
+    pick->member = NULL;
+}
@@ -0,0 +1,85 @@
+/**
+ * proxy_set.h - Proxy rotation with health scoring
+ *
+ * A set of proxies a client or session routes its requests through. Each
+ * request without its own proxy picks one at random, weighted towards low
+ * latency (EWMA of connect + TLS time on new connections) and a low error
+ * rate (EWMA of failures). Proxies that fail repeatedly are ejected for a
+ * while, longer each time they fail again after coming back. Optionally a
+ * host keeps its proxy for as long as that proxy stays healthy.
+ */
+
+#ifndef HTTPMORPH_PROXY_SET_H
+#define HTTPMORPH_PROXY_SET_H
+
+#include "httpmorph.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Defaults for httpmorph_proxy_set_config_t fields left at 0 */
+#define PROXY_SET_DEFAULT_EJECT_FAILURES 3
+#define PROXY_SET_DEFAULT_EJECT_MS       30000
+
+/* Repeated ejections double up to this many times the first one */
+#define PROXY_SET_MAX_EJECT_FACTOR 32
+
+/* EWMA weights of a new sample */
+#define PROXY_SET_LATENCY_ALPHA 0.2
+#define PROXY_SET_ERROR_ALPHA   0.1
+
+/* Selection weight is 1 / (latency * (1 + penalty * error_rate)) */
+#define PROXY_SET_ERROR_PENALTY 8.0
+
+/* Host -> proxy slots for sticky assignment (power of 2) */
+#define PROXY_SET_STICKY_SLOTS 4096
+
+typedef struct proxy_set_member proxy_set_member_t;
+
+/**
+ * Proxy chosen for one request
+ * The strings stay valid until the pick is reported, even if the proxy is
+ * removed from the set meanwhile.
+ */
+typedef struct {
+    proxy_set_member_t *member;
+    const char *url;
+    const char *username;     /* NULL when the proxy has no credentials */
+    const char *password;
+} proxy_set_pick_t;
+
+/**
+ * Take a reference on a proxy set (released with httpmorph_proxy_set_destroy())
+ */
+void proxy_set_retain(httpmorph_proxy_set_t *set);
+
+/**
+ * Choose a proxy for a request
+ *
+ * @param set Proxy set
+ * @param url Request URL (its host selects the sticky assignment)
+ * @param pick Output: chosen proxy (report it with proxy_set_report())
+ * @return 0 on success, -1 if the set is empty
+ */
+int proxy_set_pick(httpmorph_proxy_set_t *set, const char *url, proxy_set_pick_t *pick);
+
+/**
+ * Feed a request's outcome back to the proxy that carried it and release
+ * the pick
+ *
+ * @param set Proxy set
+ * @param pick Pick from proxy_set_pick()
+ * @param response Response (NULL if none could be created)
+ */
+void proxy_set_report(httpmorph_proxy_set_t *set, proxy_set_pick_t *pick,
+                      const httpmorph_response_t *response);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_PROXY_SET_H */
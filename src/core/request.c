@@ -3,7 +3,13 @@
  */
 
 #include "internal/request.h"
+#include "internal/url.h"
 #include "string_intern.h"
+#include <limits.h>
+
+#ifdef _WIN32
+    #include <io.h>
+#endif
 
 /* Initial header capacity */
 #define INITIAL_HEADER_CAPACITY 16
@@ -24,22 +30,32 @@ const char* httpmorph_method_to_string(httpmorph_method_t method) {
     }
 }
 
-/**
- * Create a new request
- */
-httpmorph_request_t* httpmorph_request_create(httpmorph_method_t method,
-                                              const char *url) {
-    if (!url) {
-        return NULL;
+/* Helper: Copy a string into the request's arena, or the heap without one */
+static char* request_strdup(httpmorph_request_t *request, const char *str) {
+    return request->_arena ? arena_strdup(request->_arena, str) : strdup(str);
+}
+
+/* Helper: Free request memory unless its arena owns it */
+static void request_free(httpmorph_request_t *request, void *ptr) {
+    if (!arena_owns(request->_arena, ptr)) {
+        free(ptr);
     }
+}
 
-    httpmorph_request_t *request = calloc(1, sizeof(httpmorph_request_t));
+/* Helper: Set up a request, allocating from arena if given (takes its reference) */
+static httpmorph_request_t* request_create_in(httpmorph_method_t method, const char *url,
+                                              httpmorph_arena_t *arena) {
+    httpmorph_request_t *request = arena ? arena_alloc(arena, sizeof(httpmorph_request_t))
+                                         : malloc(sizeof(httpmorph_request_t));
     if (!request) {
+        arena_release(arena);
         return NULL;
     }
+    memset(request, 0, sizeof(httpmorph_request_t));
+    request->_arena = arena;
 
     request->method = method;
-    request->url = strdup(url);
+    request->url = request_strdup(request, url);
     request->timeout_ms = 30000;  /* Default 30 seconds */
     request->http_version = HTTPMORPH_VERSION_1_1;
 
@@ -47,6 +63,7 @@ httpmorph_request_t* httpmorph_request_create(httpmorph_method_t method,
     request->http2_stream_dependency = 0;      /* No dependency */
     request->http2_priority_weight = 16;       /* Default weight (middle priority) */
     request->http2_priority_exclusive = false; /* Non-exclusive */
+    request->http2_adaptive_window = false;    /* Profile's static windows */
 
     /* TLS configuration defaults */
     request->verify_ssl = true;        /* Verify SSL certificates by default */
@@ -54,15 +71,49 @@ httpmorph_request_t* httpmorph_request_create(httpmorph_method_t method,
     request->min_tls_version = 0;      /* Use library default (TLS 1.2+) */
     request->max_tls_version = 0;      /* Use library default (TLS 1.3) */
 
+    request->max_header_size = HTTPMORPH_DEFAULT_MAX_HEADER_SIZE;
+    request->max_redirects = 10;
+
     /* Pre-allocate headers array for better cache locality */
     request->header_capacity = INITIAL_HEADER_CAPACITY;
-    request->headers = (httpmorph_header_t*)malloc(request->header_capacity * sizeof(httpmorph_header_t));
-    if (!request->headers) {
-        free(request->url);
-        free(request);
+    size_t headers_size = request->header_capacity * sizeof(httpmorph_header_t);
+    request->headers = arena ? arena_alloc(arena, headers_size) : malloc(headers_size);
+    if (!request->url || !request->headers) {
+        httpmorph_request_destroy(request);
+        return NULL;
+    }
+
+    return request;
+}
+
+/**
+ * Create a new request
+ */
+httpmorph_request_t* httpmorph_request_create(httpmorph_method_t method,
+                                              const char *url) {
+    if (!url) {
         return NULL;
     }
+    return request_create_in(method, url, NULL);
+}
 
+/**
+ * Create a new request for a client
+ */
+httpmorph_request_t* httpmorph_request_create_for_client(httpmorph_client_t *client,
+                                                         httpmorph_method_t method,
+                                                         const char *url) {
+    if (!url) {
+        return NULL;
+    }
+    httpmorph_arena_t *arena = client ? arena_pool_acquire(client->arena_pool) : NULL;
+    httpmorph_request_t *request = request_create_in(method, url, arena);  /* No arena: plain heap request */
+    if (request && client) {
+        request->follow_redirects = client->follow_redirects;
+        request->max_redirects = client->max_redirects;
+        request->early_data = client->early_data;
+        request->tcp_fast_open = client->tcp_fast_open;
+    }
     return request;
 }
 
@@ -74,12 +125,23 @@ void httpmorph_request_destroy(httpmorph_request_t *request) {
         return;
     }
 
-    free(request->url);
-    free(request->host);
-    free(request->browser_version);
-    free(request->proxy_url);
-    free(request->ja3_string);
-    free(request->user_agent);
+    /* Fields other modules fill (e.g. host) may be heap memory even with an arena */
+    request_free(request, request->url);
+    request_free(request, request->host);
+    request_free(request, request->browser_version);
+    request_free(request, request->proxy_url);
+    request_free(request, request->proxy_username);
+    request_free(request, request->proxy_password);
+    request_free(request, request->ja3_string);
+    request_free(request, request->user_agent);
+    request_free(request, request->body);
+
+    httpmorph_arena_t *arena = request->_arena;
+    if (arena) {
+        /* Headers, their array and the request itself live in the arena */
+        arena_release(arena);
+        return;
+    }
 
     /* Free headers */
     for (size_t i = 0; i < request->header_count; i++) {
@@ -92,9 +154,6 @@ void httpmorph_request_destroy(httpmorph_request_t *request) {
     /* Free the headers array */
     free(request->headers);
 
-    /* Free body */
-    free(request->body);
-
     free(request);
 }
 
@@ -115,8 +174,17 @@ int httpmorph_request_add_header(httpmorph_request_t *request,
             return -1;
         }
         size_t new_capacity = request->header_capacity * 2;
-        httpmorph_header_t *new_headers = (httpmorph_header_t*)realloc(request->headers,
-                                                                        new_capacity * sizeof(httpmorph_header_t));
+        httpmorph_header_t *new_headers;
+        if (request->_arena) {
+            /* The old array stays in the arena until it is reset */
+            new_headers = arena_alloc(request->_arena, new_capacity * sizeof(httpmorph_header_t));
+            if (new_headers) {
+                memcpy(new_headers, request->headers, request->header_count * sizeof(httpmorph_header_t));
+            }
+        } else {
+            new_headers = (httpmorph_header_t*)realloc(request->headers,
+                                                       new_capacity * sizeof(httpmorph_header_t));
+        }
         if (!new_headers) {
             return -1;
         }
@@ -133,17 +201,17 @@ int httpmorph_request_add_header(httpmorph_request_t *request,
         request->headers[request->header_count].key = (char*)interned_key;
     } else {
         /* Not a common header, allocate normally */
-        request->headers[request->header_count].key = strdup(key);
+        request->headers[request->header_count].key = request_strdup(request, key);
         if (!request->headers[request->header_count].key) {
             return -1;
         }
     }
 
     /* Always allocate value (values are unique) */
-    request->headers[request->header_count].value = strdup(value);
+    request->headers[request->header_count].value = request_strdup(request, value);
     if (!request->headers[request->header_count].value) {
         if (!interned_key) {
-            free(request->headers[request->header_count].key);
+            request_free(request, request->headers[request->header_count].key);
         }
         return -1;
     }
@@ -152,6 +220,22 @@ int httpmorph_request_add_header(httpmorph_request_t *request,
     return 0;
 }
 
+/**
+ * Remove the last count headers
+ */
+void httpmorph_request_pop_headers(httpmorph_request_t *request, size_t count) {
+    if (!request) {
+        return;
+    }
+    while (count-- > 0 && request->header_count > 0) {
+        httpmorph_header_t *header = &request->headers[--request->header_count];
+        if (!string_intern_is_interned(header->key)) {
+            request_free(request, header->key);
+        }
+        request_free(request, header->value);
+    }
+}
+
 /**
  * Set request body
  */
@@ -162,11 +246,14 @@ int httpmorph_request_set_body(httpmorph_request_t *request,
     }
 
     /* Free existing body */
-    free(request->body);
+    request_free(request, request->body);
+    request->body_is_file = false;
+    request->body_source = NULL;
 
     /* Allocate new body */
-    request->body = malloc(body_len);
+    request->body = request->_arena ? arena_alloc(request->_arena, body_len) : malloc(body_len);
     if (!request->body) {
+        request->body_len = 0;
         return -1;
     }
 
@@ -176,6 +263,102 @@ int httpmorph_request_set_body(httpmorph_request_t *request,
     return 0;
 }
 
+/**
+ * Send part of a file as the request body
+ */
+int httpmorph_request_set_body_file(httpmorph_request_t *request,
+                                    int fd, uint64_t offset, size_t length) {
+    if (!request || fd < 0) {
+        return -1;
+    }
+
+    request_free(request, request->body);
+    request->body = NULL;
+    request->body_source = NULL;
+    request->body_is_file = true;
+    request->body_fd = fd;
+    request->body_file_offset = offset;
+    request->body_len = length;
+    return 0;
+}
+
+/**
+ * Stream the request body from a callback
+ */
+int httpmorph_request_set_body_source(httpmorph_request_t *request,
+                                      httpmorph_body_source_t source,
+                                      void *userdata, int64_t length) {
+    if (!request || !source || (length < 0 && length != HTTPMORPH_BODY_LENGTH_UNKNOWN)) {
+        return -1;
+    }
+
+    request_free(request, request->body);
+    request->body = NULL;
+    request->body_is_file = false;
+    request->body_source = source;
+    request->body_source_userdata = userdata;
+    request->body_chunked = length == HTTPMORPH_BODY_LENGTH_UNKNOWN;
+    request->body_len = request->body_chunked ? 0 : (size_t)length;
+    return 0;
+}
+
+/**
+ * Body source reading a file descriptor until EOF
+ */
+int64_t httpmorph_body_source_fd(uint8_t *buf, size_t len, void *userdata) {
+    int fd = (int)(intptr_t)userdata;
+    if (len > INT_MAX) {
+        len = INT_MAX;
+    }
+    for (;;) {
+#ifdef _WIN32
+        int n = _read(fd, buf, (unsigned int)len);
+#else
+        ssize_t n = read(fd, buf, len);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+#endif
+        return n < 0 ? -1 : (int64_t)n;
+    }
+}
+
+/**
+ * Pull the next piece of a streamed body
+ */
+int64_t httpmorph_request_read_body(const httpmorph_request_t *request, uint8_t *buf,
+                                    size_t len, uint64_t sent) {
+    if (!request->body_chunked) {
+        if (sent >= request->body_len) {
+            return 0;
+        }
+        if (len > request->body_len - sent) {
+            len = (size_t)(request->body_len - sent);
+        }
+    }
+
+    int64_t n = request->body_source(buf, len, request->body_source_userdata);
+    if (n == HTTPMORPH_BODY_SOURCE_PAUSE) {
+        return n;
+    }
+    if (n < 0 || (uint64_t)n > len || (n == 0 && !request->body_chunked)) {
+        return -1;  /* Failed, overran the buffer or ended before Content-Length */
+    }
+    return n;
+}
+
+/**
+ * Frame data as one chunk in place
+ */
+size_t httpmorph_request_frame_chunk(uint8_t *buf, size_t len) {
+    char size_line[HTTPMORPH_CHUNK_PREFIX + 1];
+    int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+    size_t offset = HTTPMORPH_CHUNK_PREFIX - (size_t)n;
+    memcpy(buf + offset, size_line, (size_t)n);
+    memcpy(buf + HTTPMORPH_CHUNK_PREFIX + len, "\r\n", 2);
+    return offset;
+}
+
 /**
  * Set request timeout in milliseconds
  */
@@ -186,6 +369,20 @@ void httpmorph_request_set_timeout(httpmorph_request_t *request,
     }
 }
 
+/**
+ * Set per-phase timeouts
+ */
+void httpmorph_request_set_phase_timeouts(httpmorph_request_t *request,
+                                          uint32_t connect_timeout_ms,
+                                          uint32_t tls_timeout_ms,
+                                          uint32_t first_byte_timeout_ms) {
+    if (request) {
+        request->connect_timeout_ms = connect_timeout_ms;
+        request->tls_timeout_ms = tls_timeout_ms;
+        request->first_byte_timeout_ms = first_byte_timeout_ms;
+    }
+}
+
 /**
  * Set proxy configuration
  */
@@ -196,26 +393,26 @@ void httpmorph_request_set_proxy(httpmorph_request_t *request,
     if (!request) return;
 
     if (request->proxy_url) {
-        free(request->proxy_url);
+        request_free(request, request->proxy_url);
         request->proxy_url = NULL;
     }
     if (request->proxy_username) {
-        free(request->proxy_username);
+        request_free(request, request->proxy_username);
         request->proxy_username = NULL;
     }
     if (request->proxy_password) {
-        free(request->proxy_password);
+        request_free(request, request->proxy_password);
         request->proxy_password = NULL;
     }
 
     if (proxy_url) {
-        request->proxy_url = strdup(proxy_url);
+        request->proxy_url = request_strdup(request, proxy_url);
     }
     if (username) {
-        request->proxy_username = strdup(username);
+        request->proxy_username = request_strdup(request, username);
     }
     if (password) {
-        request->proxy_password = strdup(password);
+        request->proxy_password = request_strdup(request, password);
     }
 }
 
@@ -253,6 +450,18 @@ void httpmorph_request_set_http2_priority(httpmorph_request_t *request,
     request->http2_priority_exclusive = exclusive;
 }
 
+/**
+ * Enable adaptive HTTP/2 flow-control windows
+ *
+ * @param request Request to configure
+ * @param enabled Whether to grow windows from BDP estimates
+ */
+void httpmorph_request_set_http2_adaptive_window(httpmorph_request_t *request, bool enabled) {
+    if (request) {
+        request->http2_adaptive_window = enabled;
+    }
+}
+
 /**
  * Set SSL verification mode for request
  *
@@ -280,3 +489,192 @@ void httpmorph_request_set_tls_version(httpmorph_request_t *request,
         request->max_tls_version = max_version;
     }
 }
+
+/**
+ * Stream the response body to a callback
+ *
+ * @param request Request to configure
+ * @param callback Body callback (NULL to buffer the body)
+ * @param userdata Passed through to the callback
+ * @param chunk_size Maximum bytes per callback (0 for default)
+ */
+void httpmorph_request_set_body_callback(httpmorph_request_t *request,
+                                         httpmorph_body_callback_t callback,
+                                         void *userdata,
+                                         size_t chunk_size) {
+    if (request) {
+        request->body_callback = callback;
+        request->body_callback_userdata = userdata;
+        request->body_chunk_size = chunk_size > 0 ? chunk_size : HTTPMORPH_DEFAULT_BODY_CHUNK_SIZE;
+    }
+}
+
+/**
+ * Set the HTTP/1.x response head size cap
+ */
+void httpmorph_request_set_max_header_size(httpmorph_request_t *request, size_t max_size) {
+    if (request) {
+        request->max_header_size = max_size > 0 ? max_size : HTTPMORPH_DEFAULT_MAX_HEADER_SIZE;
+    }
+}
+
+/**
+ * Follow redirects for one request
+ */
+void httpmorph_request_set_redirects(httpmorph_request_t *request, bool follow,
+                                     uint32_t max_redirects) {
+    if (request) {
+        request->follow_redirects = follow;
+        request->max_redirects = max_redirects;
+    }
+}
+
+/**
+ * Save round trips to origins seen before
+ */
+void httpmorph_request_set_zero_rtt(httpmorph_request_t *request, bool early_data,
+                                    bool tcp_fast_open) {
+    if (request) {
+        request->early_data = early_data;
+        request->tcp_fast_open = tcp_fast_open;
+    }
+}
+
+/**
+ * Rotate the TLS fingerprint per connection
+ */
+void httpmorph_request_set_rotate_fingerprint(httpmorph_request_t *request, bool rotate) {
+    if (request) {
+        request->rotate_fingerprint = rotate;
+    }
+}
+
+/**
+ * Offload decryption of a large HTTPS body to the kernel
+ */
+void httpmorph_request_set_ktls(httpmorph_request_t *request, bool enabled) {
+    if (request) {
+        request->ktls = enabled;
+    }
+}
+
+/* Helper: Check if two URLs share scheme, host and port */
+static bool request_same_origin(const char *a, const char *b) {
+    char *scheme_a = NULL, *host_a = NULL, *path_a = NULL;
+    char *scheme_b = NULL, *host_b = NULL, *path_b = NULL;
+    uint16_t port_a = 0, port_b = 0;
+    bool same = false;
+
+    if (httpmorph_parse_url(a, &scheme_a, &host_a, &port_a, &path_a) == 0) {
+        if (httpmorph_parse_url(b, &scheme_b, &host_b, &port_b, &path_b) == 0) {
+            same = port_a == port_b && strcasecmp(scheme_a, scheme_b) == 0 &&
+                   strcasecmp(host_a, host_b) == 0;
+            free(scheme_b);
+            free(host_b);
+            free(path_b);
+        }
+        free(scheme_a);
+        free(host_a);
+        free(path_a);
+    }
+    return same;
+}
+
+/* Helper: Copy an optional string */
+static int request_copy_string(httpmorph_request_t *request, char **field, const char *str) {
+    if (!str) {
+        return 0;
+    }
+    *field = request_strdup(request, str);
+    return *field ? 0 : -1;
+}
+
+/**
+ * Build the request for the next hop of a redirect
+ */
+httpmorph_request_t* httpmorph_request_redirect(const httpmorph_request_t *request,
+                                                uint16_t status, const char *url) {
+    if (!request || !url) {
+        return NULL;
+    }
+
+    /* 303 always, and 301/302 for a POST (as browsers do), switch to GET
+     * without a body; 307 and 308 repeat the request as it was */
+    httpmorph_method_t method = request->method;
+    bool keep_body = true;
+    if ((status == 303 && method != HTTPMORPH_HEAD) ||
+        ((status == 301 || status == 302) && method == HTTPMORPH_POST)) {
+        method = HTTPMORPH_GET;
+        keep_body = false;
+    }
+    if (keep_body && request->body_source) {
+        return NULL;  /* A streamed body can't be sent again */
+    }
+
+    httpmorph_request_t *next = request_create_in(method, url, NULL);
+    if (!next) {
+        return NULL;
+    }
+
+    next->timeout_ms = request->timeout_ms;
+    next->connect_timeout_ms = request->connect_timeout_ms;
+    next->tls_timeout_ms = request->tls_timeout_ms;
+    next->first_byte_timeout_ms = request->first_byte_timeout_ms;
+    next->http_version = request->http_version;
+    next->browser_type = request->browser_type;
+    next->rotate_fingerprint = request->rotate_fingerprint;
+    next->http2_enabled = request->http2_enabled;
+    next->http2_stream_dependency = request->http2_stream_dependency;
+    next->http2_priority_weight = request->http2_priority_weight;
+    next->http2_priority_exclusive = request->http2_priority_exclusive;
+    next->http2_adaptive_window = request->http2_adaptive_window;
+    next->verify_ssl = request->verify_ssl;
+    next->min_tls_version = request->min_tls_version;
+    next->max_tls_version = request->max_tls_version;
+    next->max_header_size = request->max_header_size;
+    next->follow_redirects = request->follow_redirects;
+    next->max_redirects = request->max_redirects;
+    next->early_data = request->early_data;
+    next->tcp_fast_open = request->tcp_fast_open;
+    next->ktls = request->ktls;
+
+    if (request_copy_string(next, &next->browser_version, request->browser_version) < 0 ||
+        request_copy_string(next, &next->proxy_url, request->proxy_url) < 0 ||
+        request_copy_string(next, &next->proxy_username, request->proxy_username) < 0 ||
+        request_copy_string(next, &next->proxy_password, request->proxy_password) < 0 ||
+        request_copy_string(next, &next->ja3_string, request->ja3_string) < 0 ||
+        request_copy_string(next, &next->user_agent, request->user_agent) < 0) {
+        httpmorph_request_destroy(next);
+        return NULL;
+    }
+
+    if (keep_body && request->body_is_file) {
+        httpmorph_request_set_body_file(next, request->body_fd, request->body_file_offset,
+                                        request->body_len);
+    } else if (keep_body && request->body && request->body_len > 0 &&
+               httpmorph_request_set_body(next, request->body, request->body_len) < 0) {
+        httpmorph_request_destroy(next);
+        return NULL;
+    }
+
+    /* Credentials stay with their origin; body headers with the body */
+    bool same_origin = request_same_origin(request->url, url);
+    for (size_t i = 0; i < request->header_count; i++) {
+        const char *key = request->headers[i].key;
+        if (!same_origin && (strcasecmp(key, "Authorization") == 0 ||
+                             strcasecmp(key, "Cookie") == 0 ||
+                             strcasecmp(key, "Host") == 0)) {
+            continue;
+        }
+        if (!keep_body && (strncasecmp(key, "Content-", 8) == 0 ||
+                           strcasecmp(key, "Transfer-Encoding") == 0)) {
+            continue;
+        }
+        if (httpmorph_request_add_header(next, key, request->headers[i].value) < 0) {
+            httpmorph_request_destroy(next);
+            return NULL;
+        }
+    }
+
+    return next;
+}
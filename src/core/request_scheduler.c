@@ -0,0 +1,620 @@
+/**
+ * request_scheduler.c - Per-origin admission for async requests
+ *
+ * Origins live in a chained hash table keyed by "scheme://host:port".
+ * Each priority class has a ring of the origins with requests queued in
+ * that class; admission walks the ring from where it last stopped and
+ * takes one request per origin per turn. Idle origins without limits of
+ * their own are swept once the table doubles.
+ */
+
+#include "request_scheduler.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define SCHED_INITIAL_BUCKETS 64
+#define SCHED_MIN_SWEEP 1024
+
+typedef struct scheduler_item {
+    uint64_t id;
+    struct scheduler_item *next;
+} scheduler_item_t;
+
+struct request_scheduler_origin {
+    char *key;
+    uint64_t hash;
+    struct request_scheduler_origin *hash_next;
+
+    /* Own limits (0 = scheduler default) */
+    bool configured;
+    uint32_t max_concurrent;
+    double rate;
+    uint32_t burst;
+
+    /* Token bucket (only used with a rate) */
+    double tokens;
+    uint64_t refill_us;
+    bool bucket_started;
+
+    size_t in_flight;
+    size_t queued;
+    scheduler_item_t *head[REQUEST_PRIORITIES];
+    scheduler_item_t *tail[REQUEST_PRIORITIES];
+
+    /* Links in the per-class rings of origins with queued requests */
+    struct request_scheduler_origin *ring_next[REQUEST_PRIORITIES];
+    struct request_scheduler_origin *ring_prev[REQUEST_PRIORITIES];
+    bool in_ring[REQUEST_PRIORITIES];
+};
+
+struct request_scheduler {
+    request_scheduler_config_t defaults;
+
+    request_scheduler_origin_t **buckets;
+    size_t bucket_count;             /* Power of 2 */
+    size_t origin_count;
+    size_t sweep_at;
+
+    request_scheduler_origin_t *ring[REQUEST_PRIORITIES];  /* Next origin to serve */
+    size_t ring_len[REQUEST_PRIORITIES];
+
+    size_t queued;
+    size_t in_flight;
+    uint64_t admitted;
+    uint64_t deferred;
+};
+
+/* ====================================================================
+ * Origins
+ * ================================================================== */
+
+/**
+ * Build the origin key of a URL: lowercase "scheme://host:port" without
+ * userinfo, the port filled in from the scheme when absent
+ * Returns false if the key doesn't fit
+ */
+bool request_scheduler_origin_key(const char *url, char *key, size_t size) {
+    const char *sep = strstr(url, "://");
+    const char *scheme = sep ? url : "http";
+    size_t scheme_len = sep ? (size_t)(sep - url) : 4;
+    const char *authority = sep ? sep + 3 : url;
+
+    size_t authority_len = strcspn(authority, "/?#");
+    const char *at = memchr(authority, '@', authority_len);
+    while (at) {
+        authority_len -= (size_t)(at + 1 - authority);
+        authority = at + 1;
+        at = memchr(authority, '@', authority_len);
+    }
+
+    /* A port follows the last ':' unless that is inside an IPv6 literal */
+    bool has_port = false;
+    for (size_t i = authority_len; i-- > 0;) {
+        if (authority[i] == ':') {
+            has_port = true;
+            break;
+        }
+        if (authority[i] == ']') {
+            break;
+        }
+    }
+
+    const char *port = "";
+    if (!has_port) {
+        port = (scheme_len == 5 && strncmp(scheme, "https", 5) == 0) ||
+               (scheme_len == 3 && strncmp(scheme, "wss", 3) == 0) ? ":443" : ":80";
+    }
+
+    size_t len = scheme_len + 3 + authority_len + strlen(port);
+    if (len >= size) {
+        return false;
+    }
+    memcpy(key, scheme, scheme_len);
+    memcpy(key + scheme_len, "://", 3);
+    memcpy(key + scheme_len + 3, authority, authority_len);
+    strcpy(key + scheme_len + 3 + authority_len, port);
+    for (size_t i = 0; i < len; i++) {
+        if (key[i] >= 'A' && key[i] <= 'Z') {
+            key[i] = (char)(key[i] - 'A' + 'a');
+        }
+    }
+    return true;
+}
+
+static uint64_t key_hash(const char *key) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char *p = (const unsigned char *)key; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+static uint32_t origin_max_concurrent(const request_scheduler_t *sched,
+                                      const request_scheduler_origin_t *origin) {
+    if (origin->max_concurrent) {
+        return origin->max_concurrent;
+    }
+    return sched->defaults.max_per_origin ? sched->defaults.max_per_origin
+                                          : REQUEST_SCHEDULER_DEFAULT_PER_ORIGIN;
+}
+
+static double origin_rate(const request_scheduler_t *sched, const request_scheduler_origin_t *origin) {
+    return origin->rate > 0 ? origin->rate : sched->defaults.rate;
+}
+
+static double origin_burst(const request_scheduler_t *sched, const request_scheduler_origin_t *origin,
+                           double rate) {
+    uint32_t burst = origin->burst ? origin->burst : sched->defaults.burst;
+    if (burst) {
+        return (double)burst;
+    }
+    if (rate <= 1.0) {
+        return 1.0;
+    }
+    double whole = (double)(uint64_t)rate;
+    return whole < rate ? whole + 1.0 : whole;
+}
+
+/**
+ * Add the tokens earned since the last refill
+ */
+static void origin_refill(const request_scheduler_t *sched, request_scheduler_origin_t *origin,
+                          double rate, uint64_t now_us) {
+    double burst = origin_burst(sched, origin, rate);
+    if (!origin->bucket_started) {
+        origin->bucket_started = true;
+        origin->tokens = burst;
+    } else if (now_us > origin->refill_us) {
+        origin->tokens += (double)(now_us - origin->refill_us) * rate / 1e6;
+    }
+    if (origin->tokens > burst) {
+        origin->tokens = burst;
+    }
+    if (now_us > origin->refill_us) {
+        origin->refill_us = now_us;
+    }
+}
+
+/**
+ * Check whether one more of the origin's requests may start now
+ */
+static bool origin_can_start(const request_scheduler_t *sched, request_scheduler_origin_t *origin,
+                             uint64_t now_us) {
+    if (sched->defaults.max_total && sched->in_flight >= sched->defaults.max_total) {
+        return false;
+    }
+    if (origin->in_flight >= origin_max_concurrent(sched, origin)) {
+        return false;
+    }
+    double rate = origin_rate(sched, origin);
+    if (rate > 0) {
+        origin_refill(sched, origin, rate, now_us);
+        if (origin->tokens < 1.0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void origin_start(request_scheduler_t *sched, request_scheduler_origin_t *origin) {
+    origin->in_flight++;
+    sched->in_flight++;
+    sched->admitted++;
+    if (origin_rate(sched, origin) > 0) {
+        origin->tokens -= 1.0;
+    }
+}
+
+static bool origin_idle(const request_scheduler_t *sched, request_scheduler_origin_t *origin,
+                        uint64_t now_us) {
+    if (origin->configured || origin->in_flight || origin->queued) {
+        return false;
+    }
+    double rate = origin_rate(sched, origin);
+    if (rate > 0 && origin->bucket_started) {
+        origin_refill(sched, origin, rate, now_us);
+        return origin->tokens >= origin_burst(sched, origin, rate);
+    }
+    return true;
+}
+
+static void origin_free(request_scheduler_origin_t *origin) {
+    for (int p = 0; p < REQUEST_PRIORITIES; p++) {
+        scheduler_item_t *item = origin->head[p];
+        while (item) {
+            scheduler_item_t *next = item->next;
+            free(item);
+            item = next;
+        }
+    }
+    free(origin->key);
+    free(origin);
+}
+
+/**
+ * Drop idle origins without limits of their own (a full bucket and
+ * nothing in flight is the same as a fresh origin)
+ */
+static void sched_sweep(request_scheduler_t *sched, uint64_t now_us) {
+    for (size_t b = 0; b < sched->bucket_count; b++) {
+        request_scheduler_origin_t **link = &sched->buckets[b];
+        while (*link) {
+            request_scheduler_origin_t *origin = *link;
+            if (origin_idle(sched, origin, now_us)) {
+                *link = origin->hash_next;
+                origin_free(origin);
+                sched->origin_count--;
+            } else {
+                link = &origin->hash_next;
+            }
+        }
+    }
+    sched->sweep_at = sched->origin_count * 2 > SCHED_MIN_SWEEP ? sched->origin_count * 2 : SCHED_MIN_SWEEP;
+}
+
+static bool sched_grow(request_scheduler_t *sched) {
+    size_t count = sched->bucket_count * 2;
+    request_scheduler_origin_t **buckets = calloc(count, sizeof(*buckets));
+    if (!buckets) {
+        return false;
+    }
+    for (size_t b = 0; b < sched->bucket_count; b++) {
+        request_scheduler_origin_t *origin = sched->buckets[b];
+        while (origin) {
+            request_scheduler_origin_t *next = origin->hash_next;
+            size_t slot = origin->hash & (count - 1);
+            origin->hash_next = buckets[slot];
+            buckets[slot] = origin;
+            origin = next;
+        }
+    }
+    free(sched->buckets);
+    sched->buckets = buckets;
+    sched->bucket_count = count;
+    return true;
+}
+
+/**
+ * Find the origin of a URL, creating it if needed
+ */
+static request_scheduler_origin_t* sched_origin(request_scheduler_t *sched, const char *url,
+                                                uint64_t now_us) {
+    char key[REQUEST_SCHEDULER_MAX_KEY];
+    if (!url || !request_scheduler_origin_key(url, key, sizeof(key))) {
+        return NULL;
+    }
+
+    uint64_t hash = key_hash(key);
+    for (request_scheduler_origin_t *origin = sched->buckets[hash & (sched->bucket_count - 1)];
+         origin; origin = origin->hash_next) {
+        if (origin->hash == hash && strcmp(origin->key, key) == 0) {
+            return origin;
+        }
+    }
+
+    if (sched->origin_count >= sched->sweep_at) {
+        sched_sweep(sched, now_us);
+    }
+    if (sched->origin_count >= sched->bucket_count && !sched_grow(sched)) {
+        return NULL;
+    }
+
+    request_scheduler_origin_t *origin = calloc(1, sizeof(*origin));
+    if (!origin) {
+        return NULL;
+    }
+    origin->key = strdup(key);
+    if (!origin->key) {
+        free(origin);
+        return NULL;
+    }
+    origin->hash = hash;
+    size_t slot = hash & (sched->bucket_count - 1);
+    origin->hash_next = sched->buckets[slot];
+    sched->buckets[slot] = origin;
+    sched->origin_count++;
+    return origin;
+}
+
+/* ====================================================================
+ * Rings
+ * ================================================================== */
+
+static void ring_insert(request_scheduler_t *sched, request_scheduler_origin_t *origin, int p) {
+    request_scheduler_origin_t *cursor = sched->ring[p];
+    if (!cursor) {
+        origin->ring_next[p] = origin;
+        origin->ring_prev[p] = origin;
+        sched->ring[p] = origin;
+    } else {
+        /* Just behind the cursor: served after everyone already waiting */
+        origin->ring_next[p] = cursor;
+        origin->ring_prev[p] = cursor->ring_prev[p];
+        cursor->ring_prev[p]->ring_next[p] = origin;
+        cursor->ring_prev[p] = origin;
+    }
+    origin->in_ring[p] = true;
+    sched->ring_len[p]++;
+}
+
+static void ring_remove(request_scheduler_t *sched, request_scheduler_origin_t *origin, int p) {
+    if (origin->ring_next[p] == origin) {
+        sched->ring[p] = NULL;
+    } else {
+        origin->ring_prev[p]->ring_next[p] = origin->ring_next[p];
+        origin->ring_next[p]->ring_prev[p] = origin->ring_prev[p];
+        if (sched->ring[p] == origin) {
+            sched->ring[p] = origin->ring_next[p];
+        }
+    }
+    origin->ring_next[p] = NULL;
+    origin->ring_prev[p] = NULL;
+    origin->in_ring[p] = false;
+    sched->ring_len[p]--;
+}
+
+/* ====================================================================
+ * API
+ * ================================================================== */
+
+/**
+ * Create a scheduler
+ */
+request_scheduler_t* request_scheduler_create(const request_scheduler_config_t *config) {
+    request_scheduler_t *sched = calloc(1, sizeof(request_scheduler_t));
+    if (!sched) {
+        return NULL;
+    }
+    sched->buckets = calloc(SCHED_INITIAL_BUCKETS, sizeof(*sched->buckets));
+    if (!sched->buckets) {
+        free(sched);
+        return NULL;
+    }
+    sched->bucket_count = SCHED_INITIAL_BUCKETS;
+    sched->sweep_at = SCHED_MIN_SWEEP;
+    request_scheduler_configure(sched, config);
+    return sched;
+}
+
+/**
+ * Destroy a scheduler
+ */
+void request_scheduler_destroy(request_scheduler_t *sched) {
+    if (!sched) {
+        return;
+    }
+    for (size_t b = 0; b < sched->bucket_count; b++) {
+        request_scheduler_origin_t *origin = sched->buckets[b];
+        while (origin) {
+            request_scheduler_origin_t *next = origin->hash_next;
+            origin_free(origin);
+            origin = next;
+        }
+    }
+    free(sched->buckets);
+    free(sched);
+}
+
+/**
+ * Change the default limits
+ */
+void request_scheduler_configure(request_scheduler_t *sched, const request_scheduler_config_t *config) {
+    if (!sched) {
+        return;
+    }
+    if (config) {
+        sched->defaults = *config;
+        if (sched->defaults.rate < 0) {
+            sched->defaults.rate = 0;
+        }
+    } else {
+        memset(&sched->defaults, 0, sizeof(sched->defaults));
+    }
+}
+
+/**
+ * Give one origin its own limits
+ */
+int request_scheduler_set_origin(request_scheduler_t *sched, const char *url,
+                                 uint32_t max_concurrent, double rate, uint32_t burst) {
+    if (!sched) {
+        return -1;
+    }
+    request_scheduler_origin_t *origin = sched_origin(sched, url, 0);
+    if (!origin) {
+        return -1;
+    }
+    origin->configured = max_concurrent || rate > 0 || burst;
+    origin->max_concurrent = max_concurrent;
+    origin->rate = rate > 0 ? rate : 0;
+    origin->burst = burst;
+    return 0;
+}
+
+/**
+ * Submit a request
+ */
+int request_scheduler_submit(request_scheduler_t *sched, const char *url, int priority,
+                             uint64_t id, uint64_t now_us, request_scheduler_origin_t **origin_out) {
+    if (!sched || !origin_out) {
+        return -1;
+    }
+    request_scheduler_origin_t *origin = sched_origin(sched, url, now_us);
+    if (!origin) {
+        return -1;
+    }
+    *origin_out = origin;
+
+    if (priority < 0) {
+        priority = 0;
+    } else if (priority >= REQUEST_PRIORITIES) {
+        priority = REQUEST_PRIORITIES - 1;
+    }
+
+    /* Start right away unless the origin has requests of this class or
+     * above waiting (they would be overtaken) */
+    bool ahead = false;
+    for (int p = 0; p <= priority; p++) {
+        ahead = ahead || origin->head[p] != NULL;
+    }
+    if (!ahead && origin_can_start(sched, origin, now_us)) {
+        origin_start(sched, origin);
+        return 1;
+    }
+
+    scheduler_item_t *item = malloc(sizeof(scheduler_item_t));
+    if (!item) {
+        return -1;
+    }
+    item->id = id;
+    item->next = NULL;
+    if (origin->tail[priority]) {
+        origin->tail[priority]->next = item;
+    } else {
+        origin->head[priority] = item;
+    }
+    origin->tail[priority] = item;
+    origin->queued++;
+    sched->queued++;
+    sched->deferred++;
+
+    if (!origin->in_ring[priority]) {
+        ring_insert(sched, origin, priority);
+    }
+    return 0;
+}
+
+/**
+ * Account for a finished request
+ */
+void request_scheduler_finish(request_scheduler_t *sched, request_scheduler_origin_t *origin,
+                              uint64_t id) {
+    if (!sched || !origin) {
+        return;
+    }
+
+    for (int p = 0; p < REQUEST_PRIORITIES; p++) {
+        scheduler_item_t *prev = NULL;
+        for (scheduler_item_t *item = origin->head[p]; item; prev = item, item = item->next) {
+            if (item->id != id) {
+                continue;
+            }
+            if (prev) {
+                prev->next = item->next;
+            } else {
+                origin->head[p] = item->next;
+            }
+            if (origin->tail[p] == item) {
+                origin->tail[p] = prev;
+            }
+            free(item);
+            origin->queued--;
+            sched->queued--;
+            if (!origin->head[p]) {
+                ring_remove(sched, origin, p);
+            }
+            return;
+        }
+    }
+
+    /* Not queued: it was admitted */
+    if (origin->in_flight > 0) {
+        origin->in_flight--;
+        sched->in_flight--;
+    }
+}
+
+/**
+ * Admit queued requests that may start now
+ */
+size_t request_scheduler_next(request_scheduler_t *sched, uint64_t now_us,
+                              uint64_t *out, size_t max) {
+    size_t n = 0;
+    if (!sched) {
+        return 0;
+    }
+
+    for (int p = 0; p < REQUEST_PRIORITIES && n < max; p++) {
+        /* Stop once every origin in the ring was passed over in a row */
+        size_t passed = 0;
+        while (n < max && sched->ring[p] && passed < sched->ring_len[p]) {
+            if (sched->defaults.max_total && sched->in_flight >= sched->defaults.max_total) {
+                return n;
+            }
+
+            request_scheduler_origin_t *origin = sched->ring[p];
+            if (!origin_can_start(sched, origin, now_us)) {
+                sched->ring[p] = origin->ring_next[p];
+                passed++;
+                continue;
+            }
+
+            scheduler_item_t *item = origin->head[p];
+            origin->head[p] = item->next;
+            if (!origin->head[p]) {
+                origin->tail[p] = NULL;
+            }
+            out[n++] = item->id;
+            free(item);
+            origin->queued--;
+            sched->queued--;
+            origin_start(sched, origin);
+
+            /* Next origin's turn */
+            if (!origin->head[p]) {
+                ring_remove(sched, origin, p);
+            } else {
+                sched->ring[p] = origin->ring_next[p];
+            }
+            passed = 0;
+        }
+    }
+    return n;
+}
+
+/**
+ * Get when a request waiting on a rate limit can start
+ */
+uint64_t request_scheduler_next_due_us(request_scheduler_t *sched, uint64_t now_us) {
+    uint64_t due = 0;
+    if (!sched || sched->queued == 0) {
+        return 0;
+    }
+
+    for (int p = 0; p < REQUEST_PRIORITIES; p++) {
+        request_scheduler_origin_t *origin = sched->ring[p];
+        for (size_t i = 0; origin && i < sched->ring_len[p]; i++, origin = origin->ring_next[p]) {
+            double rate = origin_rate(sched, origin);
+            if (rate <= 0 || origin->in_flight >= origin_max_concurrent(sched, origin)) {
+                continue;  /* Unblocked by a finishing request instead */
+            }
+            origin_refill(sched, origin, rate, now_us);
+            uint64_t at = now_us;
+            if (origin->tokens < 1.0) {
+                at += (uint64_t)((1.0 - origin->tokens) * 1e6 / rate) + 1;
+            }
+            if (due == 0 || at < due) {
+                due = at;
+            }
+        }
+    }
+    return due;
+}
+
+/**
+ * Get counters
+ */
+void request_scheduler_get_stats(const request_scheduler_t *sched, request_scheduler_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!sched) {
+        return;
+    }
+    stats->queued = sched->queued;
+    stats->in_flight = sched->in_flight;
+    stats->origins = sched->origin_count;
+    stats->admitted = sched->admitted;
+    stats->deferred = sched->deferred;
+}
@@ -0,0 +1,136 @@
+/**
+ * request_scheduler.h - Per-origin admission for async requests
+ *
+ * Decides when a submitted request may start. Each origin (scheme, host
+ * and port) has a cap on requests in flight and an optional token bucket
+ * (rate per second, burst); a global cap bounds all origins together.
+ * Requests that can't start wait in one FIFO per priority class. Higher
+ * classes are served first, and within a class origins take turns one
+ * request at a time, so a deep queue for one host doesn't starve the
+ * others. Caller-side locking; the scheduler does no I/O and reads no
+ * clock of its own.
+ */
+
+#ifndef HTTPMORPH_REQUEST_SCHEDULER_H
+#define HTTPMORPH_REQUEST_SCHEDULER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Priority classes (lower runs first) */
+#define REQUEST_PRIORITY_HIGH   0
+#define REQUEST_PRIORITY_NORMAL 1
+#define REQUEST_PRIORITY_LOW    2
+#define REQUEST_PRIORITIES      3
+
+/* Default requests in flight per origin (matches the sync pool's per-host cap) */
+#define REQUEST_SCHEDULER_DEFAULT_PER_ORIGIN 6
+
+/* Longest origin key ("scheme://host:port") */
+#define REQUEST_SCHEDULER_MAX_KEY 288
+
+/**
+ * Limits (0 fields take the defaults)
+ */
+typedef struct {
+    uint32_t max_per_origin;         /* Requests in flight per origin (default 6) */
+    uint32_t max_total;              /* Requests in flight overall (default unlimited) */
+    double rate;                     /* Requests started per second per origin (default unlimited) */
+    uint32_t burst;                  /* Token bucket size (default max(1, rate)) */
+} request_scheduler_config_t;
+
+typedef struct {
+    size_t queued;                   /* Waiting to start */
+    size_t in_flight;                /* Admitted and not finished */
+    size_t origins;                  /* Origins tracked */
+    uint64_t admitted;               /* Started, immediately or after waiting */
+    uint64_t deferred;               /* Had to wait before starting */
+} request_scheduler_stats_t;
+
+typedef struct request_scheduler request_scheduler_t;
+typedef struct request_scheduler_origin request_scheduler_origin_t;
+
+/**
+ * Create a scheduler
+ * @param config Limits (NULL for defaults)
+ */
+request_scheduler_t* request_scheduler_create(const request_scheduler_config_t *config);
+
+/**
+ * Destroy a scheduler (queued requests are dropped)
+ */
+void request_scheduler_destroy(request_scheduler_t *sched);
+
+/**
+ * Change the defaults; origins with their own limits keep them
+ */
+void request_scheduler_configure(request_scheduler_t *sched, const request_scheduler_config_t *config);
+
+/**
+ * Give one origin its own limits (0 fields take the scheduler defaults)
+ *
+ * @param url Any URL on the origin
+ * @return 0 on success, -1 on failure
+ */
+int request_scheduler_set_origin(request_scheduler_t *sched, const char *url,
+                                 uint32_t max_concurrent, double rate, uint32_t burst);
+
+/**
+ * Submit a request
+ *
+ * @param url Request URL (selects the origin)
+ * @param priority REQUEST_PRIORITY_* (out of range is clamped)
+ * @param id Caller's request ID, handed back by request_scheduler_next()
+ * @param now_us Current time
+ * @param origin Output: origin to pass to request_scheduler_finish()
+ * @return 1 if the request may start now, 0 if it was queued, -1 on failure
+ */
+int request_scheduler_submit(request_scheduler_t *sched, const char *url, int priority,
+                             uint64_t id, uint64_t now_us, request_scheduler_origin_t **origin);
+
+/**
+ * Account for a finished request, queued or admitted
+ * A queued request is dropped from its queue; an admitted one frees its
+ * place in flight.
+ */
+void request_scheduler_finish(request_scheduler_t *sched, request_scheduler_origin_t *origin,
+                              uint64_t id);
+
+/**
+ * Admit queued requests that may start now
+ *
+ * @param out Output: IDs of the admitted requests
+ * @param max Size of out
+ * @return Number written to out
+ */
+size_t request_scheduler_next(request_scheduler_t *sched, uint64_t now_us,
+                              uint64_t *out, size_t max);
+
+/**
+ * Get when a queued request waiting only for its rate limit can start
+ * @return Time in microseconds, 0 if none is waiting on a rate limit
+ */
+uint64_t request_scheduler_next_due_us(request_scheduler_t *sched, uint64_t now_us);
+
+/**
+ * Build the origin key of a URL: lowercase "scheme://host:port" without
+ * userinfo, the port filled in from the scheme when absent
+ * @return false if the key doesn't fit in size
+ */
+bool request_scheduler_origin_key(const char *url, char *key, size_t size);
+
+/**
+ * Get counters
+ */
+void request_scheduler_get_stats(const request_scheduler_t *sched, request_scheduler_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_REQUEST_SCHEDULER_H */
@@ -9,20 +9,201 @@
 /* Initial header capacity */
 #define INITIAL_HEADER_CAPACITY 32
 
+/* Initial header arena size (grown by doubling) */
+#define INITIAL_HEADER_ARENA 2048
+
+/* Per-header index data, parallel to response->headers */
+struct httpmorph_header_link {
+    uint32_t hash;      /* Case-insensitive name hash */
+    uint32_t next;      /* Next header with the same name (index + 1, 0 = none) */
+    uint32_t last;      /* On the first of a name: its last header (index + 1) */
+};
+
+/* Helper: Grow response storage; arena memory is copied (the old copy stays
+ * until the arena is reset), heap memory is reallocated */
+static void* response_grow(httpmorph_response_t *response, void *ptr,
+                           size_t old_size, size_t new_size) {
+    if (!response->_arena) {
+        return realloc(ptr, new_size);
+    }
+    void *grown = arena_alloc(response->_arena, new_size);
+    if (grown && old_size > 0) {
+        memcpy(grown, ptr, old_size);
+    }
+    return grown;
+}
+
+/* Helper: Free response memory unless its arena owns it */
+static void response_free(httpmorph_response_t *response, void *ptr) {
+    if (!arena_owns(response->_arena, ptr)) {
+        free(ptr);
+    }
+}
+
+/* Case-insensitive FNV-1a over a header name */
+static uint32_t header_name_hash(const char *name, size_t len) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c + ('a' - 'A'));
+        hash = (hash ^ (uint8_t)c) * 16777619u;
+    }
+    return hash;
+}
+
+/* Header name equality (name compared by length, case-insensitively) */
+static bool header_name_eq(const char *key, const char *name, size_t len) {
+    return strncasecmp(key, name, len) == 0 && key[len] == '\0';
+}
+
+/* Find the first header with a name; returns index + 1, 0 if absent */
+static uint32_t header_index_find(const httpmorph_response_t *response, uint32_t hash,
+                                  const char *name, size_t len) {
+    if (!response->_header_index) {
+        return 0;
+    }
+    size_t mask = response->_header_index_cap - 1;
+    for (size_t pos = hash & mask;; pos = (pos + 1) & mask) {
+        uint32_t entry = response->_header_index[pos];
+        if (entry == 0) {
+            return 0;
+        }
+        if (response->_header_links[entry - 1].hash == hash &&
+            header_name_eq(response->headers[entry - 1].key, name, len)) {
+            return entry;
+        }
+    }
+}
+
+/* Insert a name's first header into the index (room guaranteed) */
+static void header_index_insert(httpmorph_response_t *response, uint32_t entry) {
+    size_t mask = response->_header_index_cap - 1;
+    size_t pos = response->_header_links[entry - 1].hash & mask;
+    while (response->_header_index[pos] != 0) {
+        pos = (pos + 1) & mask;
+    }
+    response->_header_index[pos] = entry;
+}
+
+/* Keep the index at most half full; rebuilds from the chain heads */
+static int header_index_reserve(httpmorph_response_t *response, size_t names) {
+    if (response->_header_index && names * 2 <= response->_header_index_cap) {
+        return 0;
+    }
+
+    size_t cap = response->_header_index_cap ? response->_header_index_cap * 2 : INITIAL_HEADER_CAPACITY * 2;
+    while (names * 2 > cap) {
+        cap *= 2;
+    }
+    uint32_t *index = response_grow(response, NULL, 0, cap * sizeof(uint32_t));
+    if (!index) {
+        return -1;
+    }
+    memset(index, 0, cap * sizeof(uint32_t));
+    response_free(response, response->_header_index);
+    response->_header_index = index;
+    response->_header_index_cap = cap;
+
+    for (size_t i = 0; i < response->header_count; i++) {
+        if (response->_header_links[i].last != 0) {  /* Only chain heads have a tail */
+            header_index_insert(response, (uint32_t)(i + 1));
+        }
+    }
+    return 0;
+}
+
+/* Make room for `bytes` more in the arena; pointers into it are rebased if it moves */
+static int header_arena_reserve(httpmorph_response_t *response, size_t bytes) {
+    size_t need = response->_header_arena_len + bytes;
+    if (need < bytes) {
+        return -1;
+    }
+    if (need > response->_header_arena_cap) {
+        size_t cap = response->_header_arena_cap ? response->_header_arena_cap : INITIAL_HEADER_ARENA;
+        while (cap < need) {
+            if (cap > SIZE_MAX / 2) {
+                return -1;
+            }
+            cap *= 2;
+        }
+
+        uintptr_t old_base = (uintptr_t)response->_header_arena;
+        uintptr_t old_end = old_base + response->_header_arena_len;
+        char *arena = response_grow(response, response->_header_arena,
+                                    response->_header_arena_len, cap);
+        if (!arena) {
+            return -1;
+        }
+        if ((uintptr_t)arena != old_base && old_base != 0) {
+            for (size_t i = 0; i < response->header_count; i++) {
+                httpmorph_header_t *h = &response->headers[i];
+                if ((uintptr_t)h->key >= old_base && (uintptr_t)h->key < old_end) {
+                    h->key = arena + ((uintptr_t)h->key - old_base);
+                }
+                h->value = arena + ((uintptr_t)h->value - old_base);
+            }
+        }
+        response->_header_arena = arena;
+        response->_header_arena_cap = cap;
+    }
+    return 0;
+}
+
+/* Append a string to the arena (room reserved by the caller) */
+static char* header_arena_copy(httpmorph_response_t *response, const char *str, size_t len) {
+    char *dst = response->_header_arena + response->_header_arena_len;
+    memcpy(dst, str, len);
+    dst[len] = '\0';
+    response->_header_arena_len += len + 1;
+    return dst;
+}
+
+/* Helper: Return the body buffer to the pool (or free it), or drop a shared body */
+static void response_release_body(httpmorph_response_t *response) {
+    if (response->_body_release) {
+        response->_body_release(response->_body_owner);
+    } else if (response->body) {
+        if (response->_buffer_pool) {
+            buffer_pool_put((httpmorph_buffer_pool_t*)response->_buffer_pool,
+                          response->body, response->_body_actual_size);
+        } else {
+            free(response->body);
+        }
+    }
+    response->body = NULL;
+    response->_body_owner = NULL;
+    response->_body_release = NULL;
+}
+
 /**
  * Create a new response structure
  */
 httpmorph_response_t* httpmorph_response_create(httpmorph_buffer_pool_t *buffer_pool) {
-    httpmorph_response_t *resp = calloc(1, sizeof(httpmorph_response_t));
+    return httpmorph_response_create_with_arena(buffer_pool, NULL);
+}
+
+/**
+ * Create a new response backed by a request's arena
+ */
+httpmorph_response_t* httpmorph_response_create_with_arena(httpmorph_buffer_pool_t *buffer_pool,
+                                                           httpmorph_arena_t *arena) {
+    httpmorph_response_t *resp = arena ? arena_alloc(arena, sizeof(httpmorph_response_t))
+                                       : malloc(sizeof(httpmorph_response_t));
     if (!resp) {
         return NULL;
     }
+    memset(resp, 0, sizeof(httpmorph_response_t));
+    if (arena) {
+        arena_retain(arena);
+        resp->_arena = arena;
+    }
 
     /* Pre-allocate headers array for better cache locality */
     resp->header_capacity = INITIAL_HEADER_CAPACITY;
-    resp->headers = (httpmorph_header_t*)malloc(resp->header_capacity * sizeof(httpmorph_header_t));
+    resp->headers = (httpmorph_header_t*)response_grow(resp, NULL, 0,
+                                                       resp->header_capacity * sizeof(httpmorph_header_t));
     if (!resp->headers) {
-        free(resp);
+        httpmorph_response_destroy(resp);
         return NULL;
     }
 
@@ -39,14 +220,23 @@ httpmorph_response_t* httpmorph_response_create(httpmorph_buffer_pool_t *buffer_
     }
 
     if (!resp->body) {
-        free(resp->headers);
-        free(resp);
+        httpmorph_response_destroy(resp);
         return NULL;
     }
 
     return resp;
 }
 
+/**
+ * Copy a string for a response field (into its arena if it has one)
+ */
+char* httpmorph_response_strdup(httpmorph_response_t *response, const char *str) {
+    if (!str) {
+        return NULL;
+    }
+    return response->_arena ? arena_strdup(response->_arena, str) : strdup(str);
+}
+
 /**
  * Destroy a response
  */
@@ -55,36 +245,66 @@ void httpmorph_response_destroy(httpmorph_response_t *response) {
         return;
     }
 
-    /* Free headers */
-    for (size_t i = 0; i < response->header_count; i++) {
-        /* Only free key if it's not an interned string */
-        if (!string_intern_is_interned(response->headers[i].key)) {
-            free(response->headers[i].key);
-        }
-        free(response->headers[i].value);
-    }
-    /* Free the headers array */
-    free(response->headers);
+    /* Free headers (names and values live in the header arena) */
+    response_free(response, response->headers);
+    response_free(response, response->_header_arena);
+    response_free(response, response->_header_links);
+    response_free(response, response->_header_index);
 
-    /* Return body buffer to pool if available, otherwise free */
-    if (response->body) {
-        if (response->_buffer_pool) {
-            buffer_pool_put((httpmorph_buffer_pool_t*)response->_buffer_pool,
-                          response->body, response->_body_actual_size);
-        } else {
-            free(response->body);
-        }
-    }
+    response_release_body(response);
 
     /* Free TLS info */
-    free(response->tls_version);
-    free(response->tls_cipher);
-    free(response->ja3_fingerprint);
+    /* tls_version, tls_cipher and ja3_fingerprint are static strings */
 
     /* Free error message */
-    free(response->error_message);
+    response_free(response, response->error_message);
+    response_free(response, response->url);
+
+    /* Earlier hops of a redirect chain, without recursing */
+    httpmorph_response_t *hop = response->redirect_from;
+    response->redirect_from = NULL;
+    while (hop) {
+        httpmorph_response_t *from = hop->redirect_from;
+        hop->redirect_from = NULL;
+        httpmorph_response_destroy(hop);
+        hop = from;
+    }
 
-    free(response);
+    /* An arena-backed response lives in the arena itself */
+    if (response->_arena) {
+        arena_release(response->_arena);
+    } else {
+        free(response);
+    }
+}
+
+/**
+ * Move a response's body into a response of its own
+ */
+httpmorph_response_t* httpmorph_response_detach_body(httpmorph_response_t *response) {
+    if (!response || !response->body) {
+        return NULL;
+    }
+
+    /* Outside any arena: it outlives the request */
+    httpmorph_response_t *detached = calloc(1, sizeof(httpmorph_response_t));
+    if (!detached) {
+        return NULL;
+    }
+    detached->body = response->body;
+    detached->body_len = response->body_len;
+    detached->body_capacity = response->body_capacity;
+    detached->_buffer_pool = response->_buffer_pool;
+    detached->_body_actual_size = response->_body_actual_size;
+    detached->_body_owner = response->_body_owner;
+    detached->_body_release = response->_body_release;
+
+    response->body = NULL;
+    response->body_len = 0;
+    response->body_capacity = 0;
+    response->_body_owner = NULL;
+    response->_body_release = NULL;
+    return detached;
 }
 
 /**
@@ -117,51 +337,107 @@ int httpmorph_response_add_header_internal(httpmorph_response_t *response,
     if (namelen > 0 && name[0] == ':') {
         return 0;
     }
+    if (response->header_count >= UINT32_MAX - 1) {
+        return -1;
+    }
 
     /* Check if we need to grow the array - use exponential growth */
-    if (response->header_count >= response->header_capacity) {
-        /* Check for integer overflow before doubling */
-        if (response->header_capacity > SIZE_MAX / 2 / sizeof(httpmorph_header_t)) {
-            /* Would overflow - reject new header */
-            return -1;
+    if (response->header_count >= response->header_capacity || !response->_header_links) {
+        size_t new_capacity = response->header_capacity;
+        if (response->header_count >= new_capacity) {
+            /* Check for integer overflow before doubling */
+            if (new_capacity > SIZE_MAX / 2 / sizeof(httpmorph_header_t)) {
+                /* Would overflow - reject new header */
+                return -1;
+            }
+            new_capacity *= 2;
+            httpmorph_header_t *new_headers = (httpmorph_header_t*)response_grow(
+                response, response->headers,
+                response->header_count * sizeof(httpmorph_header_t),
+                new_capacity * sizeof(httpmorph_header_t));
+            if (!new_headers) {
+                return -1;
+            }
+            response->headers = new_headers;
+            response->header_capacity = new_capacity;
         }
-        size_t new_capacity = response->header_capacity * 2;
-        httpmorph_header_t *new_headers = (httpmorph_header_t*)realloc(response->headers,
-                                                                        new_capacity * sizeof(httpmorph_header_t));
-        if (!new_headers) {
+
+        struct httpmorph_header_link *links = response_grow(
+            response, response->_header_links,
+            response->_header_links ? response->header_count * sizeof(*links) : 0,
+            new_capacity * sizeof(*links));
+        if (!links) {
             return -1;
         }
+        response->_header_links = links;
+    }
 
-        response->headers = new_headers;
-        response->header_capacity = new_capacity;
+    uint32_t hash = header_name_hash(name, namelen);
+    uint32_t first = header_index_find(response, hash, name, namelen);
+    if (!first && header_index_reserve(response, response->header_count + 1) < 0) {
+        return -1;
     }
 
-    /* Try to intern the header name first (reduces memory usage) */
+    /* Common names are interned; the rest share one arena with the values */
     const char *interned_key = string_intern_get(name, namelen);
-    if (interned_key) {
-        /* Use interned string (no allocation needed) */
-        response->headers[response->header_count].key = (char*)interned_key;
-    } else {
-        /* Not a common header, allocate normally */
-        response->headers[response->header_count].key = strndup(name, namelen);
-        if (!response->headers[response->header_count].key) {
-            return -1;
-        }
+    if (valuelen > SIZE_MAX / 2 || namelen > SIZE_MAX / 2 ||
+        header_arena_reserve(response, (interned_key ? 0 : namelen + 1) + valuelen + 1) < 0) {
+        return -1;
     }
 
-    /* Always allocate value (values are unique) */
-    response->headers[response->header_count].value = strndup(value, valuelen);
-    if (!response->headers[response->header_count].value) {
-        if (!interned_key) {
-            free(response->headers[response->header_count].key);
-        }
-        return -1;
+    httpmorph_header_t *header = &response->headers[response->header_count];
+    header->key = interned_key ? (char*)interned_key : header_arena_copy(response, name, namelen);
+    header->value = header_arena_copy(response, value, valuelen);
+
+    uint32_t entry = (uint32_t)(response->header_count + 1);
+    struct httpmorph_header_link *link = &response->_header_links[entry - 1];
+    link->hash = hash;
+    link->next = 0;
+    if (first) {
+        /* Repeated name: append to its chain */
+        struct httpmorph_header_link *head = &response->_header_links[first - 1];
+        response->_header_links[head->last - 1].next = entry;
+        head->last = entry;
+        link->last = 0;
+    } else {
+        link->last = entry;
     }
 
     response->header_count++;
+    if (!first) {
+        header_index_insert(response, entry);
+    }
     return 0;
 }
 
+/**
+ * Remove every header (e.g. before a retried request's response is parsed)
+ */
+void httpmorph_response_clear_headers(httpmorph_response_t *response) {
+    if (!response) {
+        return;
+    }
+    response->header_count = 0;
+    response->_header_arena_len = 0;
+    if (response->_header_index) {
+        memset(response->_header_index, 0, response->_header_index_cap * sizeof(uint32_t));
+    }
+}
+
+/**
+ * Point a response at a body it doesn't own
+ */
+void httpmorph_response_set_shared_body(httpmorph_response_t *response, const uint8_t *body,
+                                        size_t len, void *owner, void (*release)(void *owner)) {
+    response_release_body(response);
+    response->body = (uint8_t *)body;
+    response->body_len = len;
+    response->body_capacity = len;
+    response->_body_actual_size = 0;
+    response->_body_owner = owner;
+    response->_body_release = release;
+}
+
 /**
  * Get response header value by key
  */
@@ -171,11 +447,31 @@ const char* httpmorph_response_get_header(const httpmorph_response_t *response,
         return NULL;
     }
 
-    for (size_t i = 0; i < response->header_count; i++) {
-        if (strcasecmp(response->headers[i].key, key) == 0) {
-            return response->headers[i].value;
-        }
+    size_t len = strlen(key);
+    uint32_t entry = header_index_find(response, header_name_hash(key, len), key, len);
+    return entry ? response->headers[entry - 1].value : NULL;
+}
+
+/**
+ * Get every value of a repeated response header
+ */
+size_t httpmorph_response_get_header_values(const httpmorph_response_t *response,
+                                            const char *key,
+                                            const char **values,
+                                            size_t max) {
+    if (!response || !key) {
+        return 0;
     }
 
-    return NULL;
+    size_t len = strlen(key);
+    size_t count = 0;
+    uint32_t entry = header_index_find(response, header_name_hash(key, len), key, len);
+    while (entry) {
+        if (values && count < max) {
+            values[count] = response->headers[entry - 1].value;
+        }
+        count++;
+        entry = response->_header_links[entry - 1].next;
+    }
+    return count;
 }
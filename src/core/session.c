@@ -7,6 +7,7 @@
 #include "internal/cookies.h"
 #include "internal/url.h"
 #include "internal/tls.h"
+#include "internal/core.h"
 
 #ifndef _WIN32
 #include <pthread.h>
@@ -14,14 +15,6 @@
 #include <windows.h>
 #endif
 
-/* External SSL_CTX configuration mutex from client.c */
-#ifndef _WIN32
-extern pthread_mutex_t ssl_ctx_config_mutex;
-#else
-extern CRITICAL_SECTION ssl_ctx_config_mutex;
-extern bool ssl_ctx_mutex_initialized;
-#endif
-
 /**
  * Create a new session
  */
@@ -55,32 +48,20 @@ httpmorph_session_t* httpmorph_session_create(httpmorph_browser_t browser_type)
         session->browser_profile = browser_profile_by_type(browser_str);
     }
 
-    if (session->browser_profile) {
-        session->client->browser_profile = session->browser_profile;
-
-        /* Protect SSL_CTX configuration with mutex */
-#ifndef _WIN32
-        pthread_mutex_lock(&ssl_ctx_config_mutex);
-#else
-        if (ssl_ctx_mutex_initialized) {
-            EnterCriticalSection(&ssl_ctx_config_mutex);
-        }
-#endif
-
-        httpmorph_configure_ssl_ctx(session->client->ssl_ctx, session->browser_profile);
-
-#ifndef _WIN32
-        pthread_mutex_unlock(&ssl_ctx_config_mutex);
-#else
-        if (ssl_ctx_mutex_initialized) {
-            LeaveCriticalSection(&ssl_ctx_config_mutex);
-        }
-#endif
+    if (session->browser_profile &&
+        httpmorph_client_set_browser_profile(session->client, session->browser_profile) != 0) {
+        httpmorph_client_destroy(session->client);
+        free(session);
+        return NULL;
     }
 
     /* Initialize cookie jar */
-    session->cookies = NULL;
-    session->cookie_count = 0;
+    pthread_mutex_init(&session->cookie_mutex, NULL);
+    session->cookie_jar = cookie_jar_create(COOKIE_JAR_DEFAULT_MAX);
+    if (!session->cookie_jar) {
+        httpmorph_session_destroy(session);
+        return NULL;
+    }
 
     /* Initialize connection pool for keep-alive */
     session->pool = pool_create();
@@ -110,66 +91,96 @@ void httpmorph_session_destroy(httpmorph_session_t *session) {
     }
 
     /* Free cookies */
-    cookie_t *cookie = session->cookies;
-    while (cookie) {
-        cookie_t *next = cookie->next;
-        httpmorph_cookie_free(cookie);
-        cookie = next;
-    }
+    cookie_jar_destroy(session->cookie_jar);
+    pthread_mutex_destroy(&session->cookie_mutex);
 
     free(session);
 }
 
 /**
- * Execute request with session (handles cookies automatically)
+ * Add the session's cookies for a request's URL to the request
  */
-httpmorph_response_t* httpmorph_session_request(httpmorph_session_t *session,
-                                                const httpmorph_request_t *request) {
-    if (!session || !request) {
-        return NULL;
+size_t httpmorph_session_attach_cookies(httpmorph_session_t *session,
+                                        httpmorph_request_t *request) {
+    if (!session || !request || !request->url) {
+        return 0;
     }
 
     /* Parse URL to extract host for cookie domain */
     char *scheme = NULL, *host = NULL, *path = NULL;
     uint16_t port = 0;
-    int parse_result = httpmorph_parse_url(request->url, &scheme, &host, &port, &path);
-    if (parse_result != 0 || !host) {
-        /* If we can't parse URL, still execute request but cookies won't work */
-        host = strdup("unknown");
+    if (httpmorph_parse_url(request->url, &scheme, &host, &port, &path) != 0 || !host) {
+        free(scheme);
+        free(host);
+        free(path);
+        return 0;
     }
 
-    /* Add cookies from jar to request */
+    pthread_mutex_lock(&session->cookie_mutex);
     char *cookie_header = httpmorph_get_cookies_for_request(session, host,
                                                    path ? path : "/",
                                                    request->use_tls);
+    pthread_mutex_unlock(&session->cookie_mutex);
 
-    /* Create a mutable copy of the request to add cookie header */
-    httpmorph_request_t *req_with_cookies = (httpmorph_request_t*)request;
-
+    size_t added = 0;
     if (cookie_header) {
-        /* Add Cookie header to request */
-        httpmorph_request_add_header(req_with_cookies, "Cookie", cookie_header);
+        if (httpmorph_request_add_header(request, "Cookie", cookie_header) == 0) {
+            added = 1;
+        }
         free(cookie_header);
     }
 
-    /* Execute the request with connection pooling */
-    httpmorph_response_t *response = httpmorph_request_execute(session->client, req_with_cookies, session->pool);
-
-    /* Parse Set-Cookie headers from response */
-    if (response) {
-        for (size_t i = 0; i < response->header_count; i++) {
-            if (strcasecmp(response->headers[i].key, "Set-Cookie") == 0) {
-                httpmorph_parse_set_cookie(session, response->headers[i].value, host);
-            }
+    free(scheme);
+    free(host);
+    free(path);
+    return added;
+}
+
+/**
+ * Store the cookies a response sets
+ */
+void httpmorph_session_store_cookies(httpmorph_session_t *session,
+                                     const char *url,
+                                     const httpmorph_response_t *response) {
+    if (!session || !response) {
+        return;
+    }
+
+    char *scheme = NULL, *host = NULL, *path = NULL;
+    uint16_t port = 0;
+    if (!url || httpmorph_parse_url(url, &scheme, &host, &port, &path) != 0 || !host) {
+        /* If we can't parse URL, cookies are still kept, scoped to nothing */
+        free(host);
+        host = strdup("unknown");
+    }
+
+    pthread_mutex_lock(&session->cookie_mutex);
+    for (size_t i = 0; i < response->header_count; i++) {
+        if (strcasecmp(response->headers[i].key, "Set-Cookie") == 0) {
+            httpmorph_parse_set_cookie(session, response->headers[i].value, host);
         }
     }
+    pthread_mutex_unlock(&session->cookie_mutex);
 
-    /* Cleanup parsed URL components */
     free(scheme);
     free(host);
     free(path);
+}
+
+/**
+ * Execute request within session
+ * Every hop of a followed redirect sends and stores cookies through the
+ * session's jar.
+ */
+httpmorph_response_t* httpmorph_session_request(httpmorph_session_t *session,
+                                                const httpmorph_request_t *request) {
+    if (!session || !request) {
+        return NULL;
+    }
 
-    return response;
+    /* Execute the request with connection pooling */
+    return httpmorph_request_execute_in_session(session->client, request,
+                                                session->pool, session);
 }
 
 /**
@@ -179,5 +190,106 @@ size_t httpmorph_session_cookie_count(httpmorph_session_t *session) {
     if (!session) {
         return 0;
     }
-    return session->cookie_count;
+    pthread_mutex_lock(&session->cookie_mutex);
+    size_t count = cookie_jar_count(session->cookie_jar);
+    pthread_mutex_unlock(&session->cookie_mutex);
+    return count;
+}
+
+/**
+ * Get TLS session resumption statistics for session
+ */
+int httpmorph_session_get_tls_session_stats(httpmorph_session_t *session,
+                                            httpmorph_tls_session_stats_t *stats) {
+    if (!session) {
+        return -1;
+    }
+    return httpmorph_client_get_tls_session_stats(session->client, stats);
+}
+
+/**
+ * Get request metrics for a session
+ */
+int httpmorph_session_get_metrics(httpmorph_session_t *session, httpmorph_metrics_t *metrics) {
+    if (!session || httpmorph_client_get_metrics(session->client, metrics) != 0) {
+        return -1;
+    }
+
+    pool_stats_t pool_stats;
+    pool_get_stats(session->pool, &pool_stats);
+    metrics->pool_idle = pool_stats.idle;
+    metrics->pool_active = pool_stats.active;
+    return 0;
+}
+
+/**
+ * Get a session's request metrics per origin
+ */
+int httpmorph_session_get_origin_metrics(httpmorph_session_t *session,
+                                         httpmorph_origin_metrics_t *origins,
+                                         int max_origins) {
+    if (!session) {
+        return -1;
+    }
+    return httpmorph_client_get_origin_metrics(session->client, origins, max_origins);
+}
+
+/**
+ * Zero a session's request metrics
+ */
+void httpmorph_session_reset_metrics(httpmorph_session_t *session) {
+    if (session) {
+        httpmorph_client_reset_metrics(session->client);
+    }
+}
+
+/**
+ * Find an alternative service an origin advertised to a session
+ */
+int httpmorph_session_get_alt_svc(httpmorph_session_t *session, const char *url,
+                                  const char *protocol, char *host, size_t host_size,
+                                  uint16_t *port) {
+    if (!session) {
+        return -1;
+    }
+    return httpmorph_client_get_alt_svc(session->client, url, protocol, host, host_size, port);
+}
+
+/**
+ * Answer a session's GET requests from a cache when possible
+ */
+void httpmorph_session_set_cache(httpmorph_session_t *session, httpmorph_cache_t *cache) {
+    if (session) {
+        httpmorph_client_set_cache(session->client, cache);
+    }
+}
+
+/**
+ * Route the session's requests without their own proxy through a proxy set
+ */
+void httpmorph_session_set_proxy_set(httpmorph_session_t *session, httpmorph_proxy_set_t *set) {
+    if (session) {
+        httpmorph_client_set_proxy_set(session->client, set);
+    }
+}
+
+/**
+ * Start background maintenance of the session's connection pool
+ */
+int httpmorph_session_start_pool_maintenance(httpmorph_session_t *session, uint32_t interval_ms) {
+    if (!session || !session->pool) {
+        return -1;
+    }
+    return pool_start_maintenance(session->pool, session->client, (int)interval_ms);
+}
+
+/**
+ * Keep a minimum number of idle connections open to a host
+ */
+int httpmorph_session_set_min_idle(httpmorph_session_t *session, const char *host,
+                                   uint16_t port, bool use_tls, int min_idle) {
+    if (!session || !session->pool) {
+        return -1;
+    }
+    return pool_set_min_idle(session->pool, host, port, use_tls, min_idle);
 }
@@ -0,0 +1,560 @@
+/**
+ * shared_cache.c - DNS and TLS session cache shared between processes
+ *
+ * File layout: a header, then the DNS slots, then the TLS slots. A key
+ * hashes to a set of SHARED_CACHE_WAYS neighbouring slots; stores replace
+ * the key's own slot, else an empty or expired one, else the one closest
+ * to expiring (DNS) or the oldest (TLS).
+ *
+ * Each slot's lock word is 0 or the time a writer took it; its sequence
+ * is odd while the writer copies data in. Readers never take the lock.
+ * The header is laid out under a lock word of the same kind, so a file
+ * whose creator died halfway is taken over rather than left unusable.
+ */
+
+#ifndef _WIN32
+    #define _POSIX_C_SOURCE 200809L
+    #define _DEFAULT_SOURCE
+#endif
+
+#include "shared_cache.h"
+#include "httpmorph.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define SHM_LOAD(p)         ((uint64_t)InterlockedCompareExchange64((volatile LONG64*)(p), 0, 0))
+    #define SHM_STORE(p, v)     InterlockedExchange64((volatile LONG64*)(p), (LONG64)(v))
+    #define SHM_ADD(p, n)       ((uint64_t)InterlockedExchangeAdd64((volatile LONG64*)(p), (LONG64)(n)) + (n))
+    #define SHM_CAS(p, expected, desired) \
+        (InterlockedCompareExchange64((volatile LONG64*)(p), (LONG64)(desired), \
+                                      (LONG64)(expected)) == (LONG64)(expected))
+    #define SHM_CAS32(p, expected, desired) \
+        (InterlockedCompareExchange((volatile LONG*)(p), (LONG)(desired), \
+                                    (LONG)(expected)) == (LONG)(expected))
+    #define SHM_LOAD32(p)       ((uint32_t)InterlockedCompareExchange((volatile LONG*)(p), 0, 0))
+    #define SHM_STORE32(p, v)   InterlockedExchange((volatile LONG*)(p), (LONG)(v))
+    #define SHM_LOAD_PTR(p)     InterlockedCompareExchangePointer((PVOID volatile*)(p), NULL, NULL)
+    #define SHM_STORE_PTR(p, v) InterlockedExchangePointer((PVOID volatile*)(p), (PVOID)(v))
+    #define SHM_FENCE_ACQUIRE() MemoryBarrier()
+    #define SHM_FENCE_RELEASE() MemoryBarrier()
+    #define strncasecmp _strnicmp
+#else
+    #include <fcntl.h>
+    #include <strings.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define SHM_LOAD(p)         __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define SHM_STORE(p, v)     __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define SHM_ADD(p, n)       __atomic_add_fetch((p), (n), __ATOMIC_RELAXED)
+    #define SHM_CAS(p, expected, desired) \
+        __atomic_compare_exchange_n((p), &(expected), (desired), false, \
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+    #define SHM_CAS32(p, expected, desired) SHM_CAS(p, expected, desired)
+    #define SHM_LOAD32(p)       __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define SHM_STORE32(p, v)   __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define SHM_LOAD_PTR(p)     __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define SHM_STORE_PTR(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+    #define SHM_FENCE_ACQUIRE() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+    #define SHM_FENCE_RELEASE() __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+#define SHARED_CACHE_MAGIC          0x6d6f7270684d4354ULL  /* "TCMhprom" */
+#define SHARED_CACHE_VERSION        2
+#define SHARED_CACHE_STALE_LOCK_SECONDS 5  /* Lock held this long: its writer died */
+#define SHARED_CACHE_READ_RETRIES   8
+
+/* Header state */
+#define SHARED_STATE_FRESH          0      /* Zero-filled new file */
+#define SHARED_STATE_INITIALIZING   1
+#define SHARED_STATE_READY          2
+
+typedef struct {
+    uint64_t lock;                /* 0, or the time a writer took the slot */
+    uint64_t seq;                 /* Odd while the slot is being written */
+} slot_sync_t;
+
+typedef struct {
+    uint32_t hash;                /* 0: empty */
+    uint16_t port;
+    uint16_t count;
+    int32_t gai_error;
+    int32_t reserved;
+    int64_t expires;
+    char host[SHARED_CACHE_HOST_MAX];
+    shared_cache_addr_t addrs[SHARED_CACHE_DNS_ADDRS];
+} dns_record_t;
+
+typedef struct {
+    slot_sync_t sync;
+    dns_record_t record;
+} dns_slot_t;
+
+typedef struct {
+    uint32_t hash;                /* 0: empty */
+    uint32_t single_use;
+    uint32_t len;
+    uint32_t reserved;
+    int64_t expires;
+    uint64_t stored;              /* Store order, newest highest */
+    char key[SHARED_CACHE_KEY_MAX];
+} tls_record_t;
+
+typedef struct {
+    slot_sync_t sync;
+    tls_record_t record;
+    uint8_t der[SHARED_CACHE_SESSION_MAX];
+} tls_slot_t;
+
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t state;
+    uint64_t init_lock;           /* 0, or the time a process began laying out the header */
+    uint64_t dns_slots;
+    uint64_t tls_slots;
+    uint64_t dns_slot_size;       /* Layout check between builds */
+    uint64_t tls_slot_size;
+    uint64_t tls_clock;           /* Source of tls_record_t.stored */
+    uint64_t dns_hits, dns_misses, dns_stores;
+    uint64_t tls_hits, tls_misses, tls_stores;
+    uint64_t busy;
+} shared_header_t;
+
+/* Slots start on a cache line */
+#define SHARED_HEADER_SIZE ((sizeof(shared_header_t) + 63) & ~(size_t)63)
+
+static shared_header_t *shared_header = NULL;  /* Published once mapped and checked */
+static uint32_t shared_opening = 0;
+
+static dns_slot_t* dns_slots(shared_header_t *header) {
+    return (dns_slot_t*)((char*)header + SHARED_HEADER_SIZE);
+}
+
+static tls_slot_t* tls_slots(shared_header_t *header) {
+    return (tls_slot_t*)((char*)dns_slots(header) + header->dns_slots * sizeof(dns_slot_t));
+}
+
+static int64_t shared_now(void) {
+    return (int64_t)time(NULL);
+}
+
+/* Helper: FNV-1a of host:port, case-insensitive like DNS names (never 0) */
+static uint32_t dns_hash(const char *host, uint16_t port) {
+    uint32_t h = 2166136261u;
+    for (const char *p = host; *p; p++) {
+        char c = *p;
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        h = (h ^ (uint8_t)c) * 16777619u;
+    }
+    h = (h ^ (uint8_t)(port >> 8)) * 16777619u;
+    h = (h ^ (uint8_t)port) * 16777619u;
+    return h ? h : 1;
+}
+
+/* Helper: FNV-1a of a session key (never 0) */
+static uint32_t key_hash(const char *key) {
+    uint32_t h = 2166136261u;
+    while (*key) {
+        h = (h ^ (uint8_t)*key++) * 16777619u;
+    }
+    return h ? h : 1;
+}
+
+/* Helper: Copy a record out consistently; returns false if writers kept interfering */
+static bool slot_read(slot_sync_t *sync, void *dst, const void *src, size_t len, uint64_t *seq_out) {
+    for (int attempt = 0; attempt < SHARED_CACHE_READ_RETRIES; attempt++) {
+        uint64_t before = SHM_LOAD(&sync->seq);
+        if (before & 1) {
+            continue;
+        }
+        memcpy(dst, src, len);
+        SHM_FENCE_ACQUIRE();
+        if (SHM_LOAD(&sync->seq) == before) {
+            if (seq_out) *seq_out = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Helper: Take a slot for writing without waiting */
+static bool slot_lock(slot_sync_t *sync) {
+    uint64_t now = (uint64_t)shared_now();
+    uint64_t held = 0;
+    if (!SHM_CAS(&sync->lock, held, now)) {
+#ifdef _WIN32
+        held = SHM_LOAD(&sync->lock);
+#endif
+        /* Only a writer that died holds a slot for seconds */
+        if (held == 0 || now < held + SHARED_CACHE_STALE_LOCK_SECONDS ||
+            !SHM_CAS(&sync->lock, held, now)) {
+            return false;
+        }
+    }
+
+    /* Odd (already so if the dead writer got that far) before any data changes */
+    uint64_t seq = SHM_LOAD(&sync->seq);
+    SHM_STORE(&sync->seq, seq | 1);
+    SHM_FENCE_RELEASE();
+    return true;
+}
+
+/* Helper: Publish the slot's new data and let other writers in */
+static void slot_unlock(slot_sync_t *sync) {
+    uint64_t seq = SHM_LOAD(&sync->seq);
+    SHM_STORE(&sync->seq, seq + 1);
+    SHM_STORE(&sync->lock, 0);
+}
+
+/**
+ * Check whether a shared cache is open in this process
+ */
+bool shared_cache_enabled(void) {
+    return SHM_LOAD_PTR(&shared_header) != NULL;
+}
+
+/**
+ * Look up host:port
+ */
+bool shared_cache_dns_get(const char *host, uint16_t port, shared_cache_addr_t *addrs,
+                          size_t *count, int *gai_error, int *ttl_seconds) {
+    shared_header_t *header = SHM_LOAD_PTR(&shared_header);
+    if (!header || !host || strlen(host) >= SHARED_CACHE_HOST_MAX) {
+        return false;
+    }
+
+    uint32_t hash = dns_hash(host, port);
+    dns_slot_t *set = dns_slots(header) + (hash % (header->dns_slots / SHARED_CACHE_WAYS)) * SHARED_CACHE_WAYS;
+    int64_t now = shared_now();
+
+    for (int way = 0; way < SHARED_CACHE_WAYS; way++) {
+        dns_record_t record;
+        if (!slot_read(&set[way].sync, &record, &set[way].record, sizeof(record), NULL)) {
+            continue;
+        }
+        record.host[SHARED_CACHE_HOST_MAX - 1] = '\0';
+        if (record.hash != hash || record.port != port || record.expires <= now ||
+            strncasecmp(record.host, host, SHARED_CACHE_HOST_MAX) != 0) {
+            continue;
+        }
+
+        size_t n = record.count < SHARED_CACHE_DNS_ADDRS ? record.count : SHARED_CACHE_DNS_ADDRS;
+        memcpy(addrs, record.addrs, n * sizeof(shared_cache_addr_t));
+        *count = n;
+        *gai_error = n == 0 ? record.gai_error : 0;
+        *ttl_seconds = (int)(record.expires - now);
+        SHM_ADD(&header->dns_hits, 1);
+        return true;
+    }
+
+    SHM_ADD(&header->dns_misses, 1);
+    return false;
+}
+
+/**
+ * Store addresses for host:port
+ */
+void shared_cache_dns_put(const char *host, uint16_t port, const shared_cache_addr_t *addrs,
+                          size_t count, int gai_error, int ttl_seconds) {
+    shared_header_t *header = SHM_LOAD_PTR(&shared_header);
+    if (!header || !host || strlen(host) >= SHARED_CACHE_HOST_MAX || ttl_seconds <= 0 ||
+        (count == 0 && gai_error == 0)) {
+        return;
+    }
+    if (count > SHARED_CACHE_DNS_ADDRS) {
+        count = SHARED_CACHE_DNS_ADDRS;
+    }
+
+    uint32_t hash = dns_hash(host, port);
+    dns_slot_t *set = dns_slots(header) + (hash % (header->dns_slots / SHARED_CACHE_WAYS)) * SHARED_CACHE_WAYS;
+    int64_t now = shared_now();
+
+    /* A racy peek is enough to pick a victim (the write itself is locked):
+     * the key's own slot, else the earliest expiry, which empty slots win */
+    dns_slot_t *victim = NULL;
+    for (int way = 0; way < SHARED_CACHE_WAYS; way++) {
+        dns_record_t *record = &set[way].record;
+        if (record->hash == hash && record->port == port) {
+            victim = &set[way];
+            break;
+        }
+        if (!victim || record->expires < victim->record.expires) {
+            victim = &set[way];
+        }
+    }
+
+    if (!slot_lock(&victim->sync)) {
+        SHM_ADD(&header->busy, 1);
+        return;
+    }
+    dns_record_t *record = &victim->record;
+    record->hash = hash;
+    record->port = port;
+    record->count = (uint16_t)count;
+    record->gai_error = gai_error;
+    record->expires = now + ttl_seconds;
+    strncpy(record->host, host, SHARED_CACHE_HOST_MAX - 1);
+    record->host[SHARED_CACHE_HOST_MAX - 1] = '\0';
+    if (count > 0) {
+        memcpy(record->addrs, addrs, count * sizeof(shared_cache_addr_t));
+    }
+    slot_unlock(&victim->sync);
+    SHM_ADD(&header->dns_stores, 1);
+}
+
+/**
+ * Fetch the newest session stored under a key
+ */
+size_t shared_cache_tls_take(const char *key, uint8_t *der, size_t capacity) {
+    shared_header_t *header = SHM_LOAD_PTR(&shared_header);
+    if (!header || !key || strlen(key) >= SHARED_CACHE_KEY_MAX) {
+        return 0;
+    }
+
+    uint32_t hash = key_hash(key);
+    tls_slot_t *set = tls_slots(header) + (hash % (header->tls_slots / SHARED_CACHE_WAYS)) * SHARED_CACHE_WAYS;
+    int64_t now = shared_now();
+
+    /* Newest usable session for the key */
+    tls_slot_t *best = NULL;
+    tls_record_t best_record;
+    uint64_t best_seq = 0;
+    for (int way = 0; way < SHARED_CACHE_WAYS; way++) {
+        tls_record_t record;
+        uint64_t seq;
+        if (!slot_read(&set[way].sync, &record, &set[way].record, sizeof(record), &seq)) {
+            continue;
+        }
+        record.key[SHARED_CACHE_KEY_MAX - 1] = '\0';
+        if (record.hash != hash || record.expires <= now || record.len == 0 ||
+            record.len > capacity || strcmp(record.key, key) != 0) {
+            continue;
+        }
+        if (!best || record.stored > best_record.stored) {
+            best = &set[way];
+            best_record = record;
+            best_seq = seq;
+        }
+    }
+
+    size_t len = 0;
+    if (best && best_record.single_use) {
+        /* Taken out under the lock, provided nobody rewrote it meanwhile */
+        if (slot_lock(&best->sync)) {
+            if ((SHM_LOAD(&best->sync.seq) & ~(uint64_t)1) == best_seq) {
+                memcpy(der, best->der, best_record.len);
+                len = best_record.len;
+                best->record.hash = 0;
+                best->record.expires = 0;
+            }
+            slot_unlock(&best->sync);
+        }
+    } else if (best) {
+        memcpy(der, best->der, best_record.len);
+        SHM_FENCE_ACQUIRE();
+        if (SHM_LOAD(&best->sync.seq) == best_seq) {
+            len = best_record.len;
+        }
+    }
+
+    SHM_ADD(len > 0 ? &header->tls_hits : &header->tls_misses, 1);
+    return len;
+}
+
+/**
+ * Store a session in DER form under a key
+ */
+bool shared_cache_tls_put(const char *key, const uint8_t *der, size_t len,
+                          bool single_use, int64_t expires) {
+    shared_header_t *header = SHM_LOAD_PTR(&shared_header);
+    int64_t now = shared_now();
+    if (!header || !key || strlen(key) >= SHARED_CACHE_KEY_MAX || !der || len == 0 ||
+        len > SHARED_CACHE_SESSION_MAX || expires <= now) {
+        return false;
+    }
+
+    uint32_t hash = key_hash(key);
+    tls_slot_t *set = tls_slots(header) + (hash % (header->tls_slots / SHARED_CACHE_WAYS)) * SHARED_CACHE_WAYS;
+
+    /* Reusable sessions replace the key's; otherwise a free or expired
+     * slot (age 0), else the oldest */
+    tls_slot_t *victim = NULL;
+    uint64_t victim_age = 0;
+    for (int way = 0; way < SHARED_CACHE_WAYS; way++) {
+        tls_record_t *record = &set[way].record;
+        if (!single_use && record->hash == hash && !record->single_use) {
+            victim = &set[way];
+            break;
+        }
+        uint64_t age = (record->hash == 0 || record->expires <= now) ? 0 : record->stored;
+        if (!victim || age < victim_age) {
+            victim = &set[way];
+            victim_age = age;
+        }
+    }
+
+    if (!slot_lock(&victim->sync)) {
+        SHM_ADD(&header->busy, 1);
+        return false;
+    }
+    tls_record_t *record = &victim->record;
+    record->hash = hash;
+    record->single_use = single_use ? 1 : 0;
+    record->len = (uint32_t)len;
+    record->expires = expires;
+    record->stored = SHM_ADD(&header->tls_clock, 1);
+    strncpy(record->key, key, SHARED_CACHE_KEY_MAX - 1);
+    record->key[SHARED_CACHE_KEY_MAX - 1] = '\0';
+    memcpy(victim->der, der, len);
+    slot_unlock(&victim->sync);
+    SHM_ADD(&header->tls_stores, 1);
+    return true;
+}
+
+/* Helper: Map the file read-write and shared, growing it to size */
+static void* shared_map(const char *path, size_t size) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                              NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+    /* A mapping larger than the file extends it with zeros */
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE,
+                                        (DWORD)((uint64_t)size >> 32), (DWORD)size, NULL);
+    CloseHandle(file);
+    if (!mapping) {
+        return NULL;
+    }
+    void *base = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+    CloseHandle(mapping);
+    return base;
+#else
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return NULL;
+    }
+    /* Another process sized it differently: the header check catches that */
+    struct stat st;
+    if (fstat(fd, &st) != 0 || ((size_t)st.st_size < size && ftruncate(fd, (off_t)size) != 0)) {
+        close(fd);
+        return NULL;
+    }
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return base == MAP_FAILED ? NULL : base;
+#endif
+}
+
+static void shared_unmap(void *base, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnmapViewOfFile(base);
+#else
+    munmap(base, size);
+#endif
+}
+
+static void shared_sleep_ms(unsigned int ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+/**
+ * Share DNS results and TLS sessions with other processes through a file
+ */
+int httpmorph_shared_cache_open(const char *path, size_t dns_entries, size_t tls_entries) {
+    if (!path || !*path) {
+        return -1;
+    }
+
+    /* One shared cache per process, for good: readers take no reference, so
+     * the mapping can never be swapped or taken away */
+    uint32_t closed = 0;
+    if (!SHM_CAS32(&shared_opening, closed, 1)) {
+        return -1;
+    }
+
+    if (dns_entries == 0) dns_entries = SHARED_CACHE_DEFAULT_DNS_ENTRIES;
+    if (tls_entries == 0) tls_entries = SHARED_CACHE_DEFAULT_TLS_ENTRIES;
+    dns_entries = (dns_entries + SHARED_CACHE_WAYS - 1) / SHARED_CACHE_WAYS * SHARED_CACHE_WAYS;
+    tls_entries = (tls_entries + SHARED_CACHE_WAYS - 1) / SHARED_CACHE_WAYS * SHARED_CACHE_WAYS;
+    size_t size = SHARED_HEADER_SIZE + dns_entries * sizeof(dns_slot_t) +
+                  tls_entries * sizeof(tls_slot_t);
+
+    shared_header_t *header = shared_map(path, size);
+    if (!header) {
+        SHM_STORE32(&shared_opening, 0);
+        return -1;
+    }
+
+    /* The first process to take the init lock lays out the header. One that
+     * died doing so is taken over once its lock is stale. */
+    int64_t give_up = shared_now() + SHARED_CACHE_STALE_LOCK_SECONDS + 1;
+    while (SHM_LOAD32(&header->state) != SHARED_STATE_READY && shared_now() <= give_up) {
+        uint64_t now = (uint64_t)shared_now();
+        uint64_t held = 0;
+        bool owner = SHM_CAS(&header->init_lock, held, now);
+        if (!owner) {
+#ifdef _WIN32
+            held = SHM_LOAD(&header->init_lock);
+#endif
+            owner = held != 0 && now >= held + SHARED_CACHE_STALE_LOCK_SECONDS &&
+                    SHM_CAS(&header->init_lock, held, now);
+        }
+        if (!owner) {
+            shared_sleep_ms(1);
+            continue;
+        }
+        if (SHM_LOAD32(&header->state) != SHARED_STATE_READY) {
+            SHM_STORE32(&header->state, SHARED_STATE_INITIALIZING);
+            header->magic = SHARED_CACHE_MAGIC;
+            header->version = SHARED_CACHE_VERSION;
+            header->dns_slots = dns_entries;
+            header->tls_slots = tls_entries;
+            header->dns_slot_size = sizeof(dns_slot_t);
+            header->tls_slot_size = sizeof(tls_slot_t);
+            SHM_STORE32(&header->state, SHARED_STATE_READY);
+        }
+    }
+
+    if (SHM_LOAD32(&header->state) != SHARED_STATE_READY ||
+        header->magic != SHARED_CACHE_MAGIC || header->version != SHARED_CACHE_VERSION ||
+        header->dns_slots != dns_entries || header->tls_slots != tls_entries ||
+        header->dns_slot_size != sizeof(dns_slot_t) || header->tls_slot_size != sizeof(tls_slot_t)) {
+        shared_unmap(header, size);
+        SHM_STORE32(&shared_opening, 0);
+        return -1;
+    }
+
+    SHM_STORE_PTR(&shared_header, header);
+    return 0;
+}
+
+/**
+ * Get shared cache statistics
+ */
+int httpmorph_shared_cache_get_stats(httpmorph_shared_cache_stats_t *stats) {
+    shared_header_t *header = SHM_LOAD_PTR(&shared_header);
+    if (!stats || !header) {
+        return -1;
+    }
+
+    stats->dns_hits = SHM_LOAD(&header->dns_hits);
+    stats->dns_misses = SHM_LOAD(&header->dns_misses);
+    stats->dns_stores = SHM_LOAD(&header->dns_stores);
+    stats->tls_hits = SHM_LOAD(&header->tls_hits);
+    stats->tls_misses = SHM_LOAD(&header->tls_misses);
+    stats->tls_stores = SHM_LOAD(&header->tls_stores);
+    stats->busy = SHM_LOAD(&header->busy);
+    stats->dns_entries = (size_t)header->dns_slots;
+    stats->tls_entries = (size_t)header->tls_slots;
+    return 0;
+}
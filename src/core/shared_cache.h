@@ -0,0 +1,101 @@
+/**
+ * shared_cache.h - DNS and TLS session cache shared between processes
+ *
+ * An optional second level behind the per-process DNS cache (network.c)
+ * and TLS session caches (tls_session_cache.c), for deployments running
+ * many worker processes on one host. It lives in a file mapped by every
+ * process that opens it, so workers see each other's lookups and tickets,
+ * a restarted worker starts warm, and forked children inherit the mapping.
+ *
+ * The store is a fixed set-associative table sized when the file is
+ * created. Slots hold no pointers, only plain data, and each has a
+ * seqlock: readers copy a slot and retry if a writer was inside, writers
+ * take the slot with a compare-and-swap and skip it when another process
+ * holds it. Nothing ever blocks, so a worker killed mid-write loses at
+ * most the slot it was writing; its lock is broken after a few seconds.
+ */
+
+#ifndef HTTPMORPH_SHARED_CACHE_H
+#define HTTPMORPH_SHARED_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Default slots per table when httpmorph_shared_cache_open() is given 0 */
+#define SHARED_CACHE_DEFAULT_DNS_ENTRIES  1024
+#define SHARED_CACHE_DEFAULT_TLS_ENTRIES  1024
+
+/* Slots a key may land in */
+#define SHARED_CACHE_WAYS                 4
+
+/* Longest entries shared (longer ones stay process-local) */
+#define SHARED_CACHE_HOST_MAX             256
+#define SHARED_CACHE_KEY_MAX              320
+#define SHARED_CACHE_DNS_ADDRS            8
+#define SHARED_CACHE_SESSION_MAX          2048
+
+/**
+ * One resolved address, as plain data
+ */
+typedef struct {
+    int32_t family;
+    int32_t socktype;
+    int32_t protocol;
+    uint32_t len;                 /* Bytes of addr in use */
+    uint8_t addr[28];             /* sockaddr_in or sockaddr_in6 */
+} shared_cache_addr_t;
+
+/**
+ * Check whether a shared cache is open in this process
+ */
+bool shared_cache_enabled(void);
+
+/**
+ * Look up host:port
+ *
+ * @param addrs Output: up to SHARED_CACHE_DNS_ADDRS addresses
+ * @param count Output: addresses filled (0 for a negative entry)
+ * @param gai_error Output: the lookup error of a negative entry, else 0
+ * @param ttl_seconds Output: seconds the entry has left
+ * @return true on a hit
+ */
+bool shared_cache_dns_get(const char *host, uint16_t port, shared_cache_addr_t *addrs,
+                          size_t *count, int *gai_error, int *ttl_seconds);
+
+/**
+ * Store addresses for host:port (count 0 with a gai_error: does not resolve)
+ */
+void shared_cache_dns_put(const char *host, uint16_t port, const shared_cache_addr_t *addrs,
+                          size_t count, int gai_error, int ttl_seconds);
+
+/**
+ * Fetch the newest session stored under a key
+ * A single-use session is removed, so exactly one process gets it.
+ *
+ * @param der Output: the session in DER form
+ * @param capacity Size of der
+ * @return Bytes written to der, 0 on a miss
+ */
+size_t shared_cache_tls_take(const char *key, uint8_t *der, size_t capacity);
+
+/**
+ * Store a session in DER form under a key
+ * A reusable session replaces the key's previous one; single-use sessions
+ * (TLS 1.3 tickets) are kept side by side.
+ *
+ * @param expires Unix time the session stops being usable
+ * @return true if stored
+ */
+bool shared_cache_tls_put(const char *key, const uint8_t *der, size_t len,
+                          bool single_use, int64_t expires);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_SHARED_CACHE_H */
@@ -0,0 +1,289 @@
+/**
+ * ssl_ctx_cache.c - Process-wide cache of configured SSL contexts
+ *
+ * Both lists stay short (one entry per profile and CA file in use), so
+ * they are searched linearly under one lock. Building a context happens
+ * under the lock too; it is rare and keeps two threads from parsing the
+ * same bundle.
+ */
+
+#include "ssl_ctx_cache.h"
+#include "internal/tls.h"
+#include "tls_session_cache.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define strdup _strdup
+#else
+    #include <pthread.h>
+#endif
+
+/* Upper bound on cached session lifetime (seconds) */
+#define SSL_CTX_SESSION_TIMEOUT 300
+
+/* Cached context */
+typedef struct ssl_ctx_entry {
+    const browser_profile_t *profile;
+    bool verify;
+    uint16_t min_version;
+    uint16_t max_version;
+    char *ca_file;
+    SSL_CTX *ctx;
+    struct ssl_ctx_entry *next;
+} ssl_ctx_entry_t;
+
+/* Parsed trust store (system roots plus an optional CA file) */
+typedef struct trust_store {
+    char *ca_file;
+    X509_STORE *store;
+    struct trust_store *next;
+} trust_store_t;
+
+static ssl_ctx_entry_t *cache_entries = NULL;
+static trust_store_t *cache_stores = NULL;
+static ssl_ctx_cache_stats_t cache_stats;
+
+#ifndef _WIN32
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define CTX_CACHE_LOCK()   pthread_mutex_lock(&cache_mutex)
+#define CTX_CACHE_UNLOCK() pthread_mutex_unlock(&cache_mutex)
+#else
+static CRITICAL_SECTION cache_mutex;
+static INIT_ONCE cache_mutex_once = INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK cache_mutex_init(PINIT_ONCE InitOnce, PVOID Parameter, PVOID *Context) {
+    (void)InitOnce; (void)Parameter; (void)Context;
+    InitializeCriticalSection(&cache_mutex);
+    return TRUE;
+}
+
+static void cache_lock(void) {
+    InitOnceExecuteOnce(&cache_mutex_once, cache_mutex_init, NULL, NULL);
+    EnterCriticalSection(&cache_mutex);
+}
+#define CTX_CACHE_LOCK()   cache_lock()
+#define CTX_CACHE_UNLOCK() LeaveCriticalSection(&cache_mutex)
+#endif
+
+static bool same_ca_file(const char *a, const char *b) {
+    return a == b || (a && b && strcmp(a, b) == 0);
+}
+
+/**
+ * Get the trust store for a CA file, parsing it on first use (lock held)
+ */
+static X509_STORE* trust_store_get(const char *ca_file) {
+    for (trust_store_t *t = cache_stores; t; t = t->next) {
+        if (same_ca_file(t->ca_file, ca_file)) {
+            return t->store;
+        }
+    }
+
+    /* Load through a scratch context so the platform loaders are reused */
+    SSL_CTX *scratch = SSL_CTX_new(TLS_client_method());
+    if (!scratch) {
+        return NULL;
+    }
+#ifdef _WIN32
+    httpmorph_load_windows_ca_certs(scratch);
+#else
+    SSL_CTX_set_default_verify_paths(scratch);
+#endif
+    if (ca_file && SSL_CTX_load_verify_locations(scratch, ca_file, NULL) != 1) {
+        SSL_CTX_free(scratch);
+        return NULL;
+    }
+
+    trust_store_t *t = calloc(1, sizeof(trust_store_t));
+    if (t && ca_file) {
+        t->ca_file = strdup(ca_file);
+    }
+    if (!t || (ca_file && !t->ca_file)) {
+        free(t);
+        SSL_CTX_free(scratch);
+        return NULL;
+    }
+    t->store = SSL_CTX_get_cert_store(scratch);
+    X509_STORE_up_ref(t->store);
+    SSL_CTX_free(scratch);
+
+    t->next = cache_stores;
+    cache_stores = t;
+    cache_stats.stores++;
+    return t->store;
+}
+
+/**
+ * Build a fully configured context (lock held)
+ */
+static SSL_CTX* ssl_ctx_build(const ssl_ctx_key_t *key, X509_STORE *store) {
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx) {
+        return NULL;
+    }
+
+    X509_STORE_up_ref(store);
+    SSL_CTX_set_cert_store(ctx, store);
+    SSL_CTX_set_verify(ctx, key->verify ? SSL_VERIFY_PEER : SSL_VERIFY_NONE, NULL);
+
+    /* Sessions go to the cache each connection is tagged with */
+    if (tls_session_cache_install(ctx) != 0) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    SSL_CTX_set_timeout(ctx, SSL_CTX_SESSION_TIMEOUT);
+
+    /* Enable session ticket support for TLS 1.3 and better TLS 1.2 resumption */
+#ifdef SSL_OP_NO_TICKET
+    SSL_CTX_clear_options(ctx, SSL_OP_NO_TICKET);
+#endif
+
+    if (key->profile) {
+        httpmorph_configure_ssl_ctx(ctx, key->profile);
+    }
+    if ((key->min_version || key->max_version) &&
+        httpmorph_set_tls_version_range(ctx, key->min_version, key->max_version) != 0) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+/**
+ * Get the shared context for a key
+ */
+SSL_CTX* ssl_ctx_cache_acquire(const ssl_ctx_key_t *key) {
+    if (!key) {
+        return NULL;
+    }
+
+    CTX_CACHE_LOCK();
+
+    for (ssl_ctx_entry_t *e = cache_entries; e; e = e->next) {
+        if (e->profile == key->profile && e->verify == key->verify &&
+            e->min_version == key->min_version && e->max_version == key->max_version &&
+            same_ca_file(e->ca_file, key->ca_file)) {
+            SSL_CTX_up_ref(e->ctx);
+            cache_stats.hits++;
+            CTX_CACHE_UNLOCK();
+            return e->ctx;
+        }
+    }
+    cache_stats.misses++;
+
+    X509_STORE *store = trust_store_get(key->ca_file);
+    SSL_CTX *ctx = store ? ssl_ctx_build(key, store) : NULL;
+    ssl_ctx_entry_t *e = ctx ? calloc(1, sizeof(ssl_ctx_entry_t)) : NULL;
+    if (e && key->ca_file) {
+        e->ca_file = strdup(key->ca_file);
+    }
+    if (!e || (key->ca_file && !e->ca_file)) {
+        free(e);
+        SSL_CTX_free(ctx);
+        CTX_CACHE_UNLOCK();
+        return NULL;
+    }
+
+    e->profile = key->profile;
+    e->verify = key->verify;
+    e->min_version = key->min_version;
+    e->max_version = key->max_version;
+    e->ctx = ctx;
+    e->next = cache_entries;
+    cache_entries = e;
+    cache_stats.contexts++;
+
+    /* One reference for the cache, one for the caller */
+    SSL_CTX_up_ref(ctx);
+    CTX_CACHE_UNLOCK();
+    return ctx;
+}
+
+/**
+ * Describe a cached context's version range and CA file
+ * The CA file goes in as a 64-bit FNV-1a hash of its path (0: none).
+ */
+bool ssl_ctx_cache_identity(const SSL_CTX *ctx, char *out, size_t size) {
+    if (!ctx || !out) {
+        return false;
+    }
+
+    bool found = false;
+    uint16_t min_version = 0;
+    uint16_t max_version = 0;
+    uint64_t ca_hash = 0;
+
+    CTX_CACHE_LOCK();
+    for (ssl_ctx_entry_t *e = cache_entries; e; e = e->next) {
+        if (e->ctx == ctx) {
+            found = true;
+            min_version = e->min_version;
+            max_version = e->max_version;
+            if (e->ca_file) {
+                ca_hash = 14695981039346656037ULL;
+                for (const char *p = e->ca_file; *p; p++) {
+                    ca_hash = (ca_hash ^ (uint8_t)*p) * 1099511628211ULL;
+                }
+            }
+            break;
+        }
+    }
+    CTX_CACHE_UNLOCK();
+
+    if (!found) {
+        return false;
+    }
+    int n = snprintf(out, size, "%04x-%04x|%016llx", (unsigned)min_version, (unsigned)max_version,
+                     (unsigned long long)ca_hash);
+    return n > 0 && (size_t)n < size;
+}
+
+/**
+ * Drop a reference taken with ssl_ctx_cache_acquire
+ */
+void ssl_ctx_cache_release(SSL_CTX *ctx) {
+    if (ctx) {
+        SSL_CTX_free(ctx);
+    }
+}
+
+/**
+ * Drop the cache's own references
+ */
+void ssl_ctx_cache_clear(void) {
+    CTX_CACHE_LOCK();
+    ssl_ctx_entry_t *entries = cache_entries;
+    trust_store_t *stores = cache_stores;
+    cache_entries = NULL;
+    cache_stores = NULL;
+    cache_stats.contexts = 0;
+    cache_stats.stores = 0;
+    CTX_CACHE_UNLOCK();
+
+    while (entries) {
+        ssl_ctx_entry_t *next = entries->next;
+        SSL_CTX_free(entries->ctx);
+        free(entries->ca_file);
+        free(entries);
+        entries = next;
+    }
+    while (stores) {
+        trust_store_t *next = stores->next;
+        X509_STORE_free(stores->store);
+        free(stores->ca_file);
+        free(stores);
+        stores = next;
+    }
+}
+
+/**
+ * Get cache statistics
+ */
+void ssl_ctx_cache_stats(ssl_ctx_cache_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+    CTX_CACHE_LOCK();
+    *stats = cache_stats;
+    CTX_CACHE_UNLOCK();
+}
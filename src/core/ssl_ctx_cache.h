@@ -0,0 +1,90 @@
+/**
+ * ssl_ctx_cache.h - Process-wide cache of configured SSL contexts
+ *
+ * Every client, session and async manager used to build its own SSL_CTX
+ * and parse the CA bundle into it. Contexts are now built once per
+ * (browser profile, verification mode, TLS version range, CA file) and
+ * shared; all of them use one parsed X509_STORE per CA file. A context is
+ * fully configured before it is published and never changed afterwards,
+ * so connections may use it from any thread. Per-connection settings
+ * (verification, ALPN, SNI, session cache) stay on each SSL.
+ */
+
+#ifndef HTTPMORPH_SSL_CTX_CACHE_H
+#define HTTPMORPH_SSL_CTX_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "../tls/browser_profiles.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Forward declarations (avoid including OpenSSL headers here)
+ */
+typedef struct ssl_ctx_st SSL_CTX;
+
+/**
+ * What makes two contexts interchangeable
+ */
+typedef struct {
+    const browser_profile_t *profile;  /* NULL: library defaults, no fingerprint */
+    bool verify;                       /* Default verification mode */
+    uint16_t min_version;              /* 0 for default */
+    uint16_t max_version;              /* 0 for default */
+    const char *ca_file;               /* Extra CA bundle (NULL: system store only) */
+} ssl_ctx_key_t;
+
+/**
+ * Cache statistics
+ */
+typedef struct {
+    uint64_t hits;          /* Acquires served by an existing context */
+    uint64_t misses;        /* Acquires that built a context */
+    size_t contexts;        /* Contexts cached now */
+    size_t stores;          /* Trust stores parsed and cached now */
+} ssl_ctx_cache_stats_t;
+
+/**
+ * Get the shared context for a key, building it on first use
+ *
+ * @param key Context configuration
+ * @return New reference (release with ssl_ctx_cache_release) or NULL on error
+ */
+SSL_CTX* ssl_ctx_cache_acquire(const ssl_ctx_key_t *key);
+
+/**
+ * Drop a reference taken with ssl_ctx_cache_acquire
+ */
+void ssl_ctx_cache_release(SSL_CTX *ctx);
+
+/**
+ * Describe what a cached context was built with beyond its profile and
+ * verification mode (TLS version range and CA file), for keys that must
+ * tell contexts apart outside this process
+ *
+ * @param out Output: a short printable string
+ * @param size Size of out
+ * @return true if written, false if ctx isn't in the cache
+ */
+bool ssl_ctx_cache_identity(const SSL_CTX *ctx, char *out, size_t size);
+
+/**
+ * Drop the cache's own references to contexts and trust stores
+ * Contexts still held by clients stay valid until they are released.
+ */
+void ssl_ctx_cache_clear(void);
+
+/**
+ * Get cache statistics
+ */
+void ssl_ctx_cache_stats(ssl_ctx_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_SSL_CTX_CACHE_H */
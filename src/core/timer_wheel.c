@@ -0,0 +1,179 @@
+/**
+ * timer_wheel.c - Hierarchical timer wheel
+ */
+
+#include "timer_wheel.h"
+#include <string.h>
+
+#define TIMER_WHEEL_MASK ((uint64_t)TIMER_WHEEL_SLOTS - 1)
+
+/* Span of all levels together; later timers are parked at its end */
+#define TIMER_WHEEL_SPAN ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS))
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+    static inline unsigned timer_wheel_ctz64(uint64_t v) {
+        unsigned long i;
+        _BitScanForward64(&i, v);
+        return (unsigned)i;
+    }
+#else
+    #define timer_wheel_ctz64(v) ((unsigned)__builtin_ctzll(v))
+#endif
+
+/* Link a timer into the slot its expiry maps to from wheel->now_ms
+ * Expiries before `earliest` go to its slot: the next tick when arming
+ * (now_ms's slot has been scanned), now_ms itself when cascading (its slot
+ * is scanned right after) */
+static void timer_wheel_insert(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint64_t earliest) {
+    uint64_t expires = timer->expires_ms;
+    if (expires < earliest) {
+        expires = earliest;           /* Overdue */
+    }
+    uint64_t delta = expires - wheel->now_ms;
+    if (delta >= TIMER_WHEEL_SPAN) {
+        expires = wheel->now_ms + TIMER_WHEEL_SPAN - 1;  /* Re-placed when cascaded */
+        delta = TIMER_WHEEL_SPAN - 1;
+    }
+
+    unsigned level = 0;
+    while (level + 1 < TIMER_WHEEL_LEVELS &&
+           delta >= ((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    unsigned slot = (unsigned)((expires >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_MASK);
+
+    timer->level = (uint8_t)level;
+    timer->slot = (uint8_t)slot;
+    timer->prev = NULL;
+    timer->next = wheel->slots[level][slot];
+    if (timer->next) {
+        timer->next->prev = timer;
+    }
+    wheel->slots[level][slot] = timer;
+    wheel->occupied[level] |= (uint64_t)1 << slot;
+}
+
+/* Unlink a timer from its slot */
+static void timer_wheel_unlink(timer_wheel_t *wheel, timer_wheel_timer_t *timer) {
+    if (timer->prev) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel->slots[timer->level][timer->slot] = timer->next;
+        if (!timer->next) {
+            wheel->occupied[timer->level] &= ~((uint64_t)1 << timer->slot);
+        }
+    }
+    if (timer->next) {
+        timer->next->prev = timer->prev;
+    }
+    timer->next = NULL;
+    timer->prev = NULL;
+}
+
+/* Move one slot's timers down a level (they now expire within its span)
+ * Runs on the slot's first tick before level 0 is scanned, so a timer due
+ * on that very tick still fires on it */
+static void timer_wheel_cascade(timer_wheel_t *wheel, unsigned level, unsigned slot) {
+    timer_wheel_timer_t *timer = wheel->slots[level][slot];
+    wheel->slots[level][slot] = NULL;
+    wheel->occupied[level] &= ~((uint64_t)1 << slot);
+
+    while (timer) {
+        timer_wheel_timer_t *next = timer->next;
+        timer_wheel_insert(wheel, timer, wheel->now_ms);
+        timer = next;
+    }
+}
+
+void timer_wheel_init(timer_wheel_t *wheel, uint64_t now_ms) {
+    memset(wheel, 0, sizeof(*wheel));
+    wheel->now_ms = now_ms;
+}
+
+void timer_wheel_arm(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint64_t expires_ms) {
+    if (timer->armed) {
+        timer_wheel_unlink(wheel, timer);
+    } else {
+        timer->armed = true;
+        wheel->count++;
+    }
+    timer->expires_ms = expires_ms;
+    timer_wheel_insert(wheel, timer, wheel->now_ms + 1);
+}
+
+void timer_wheel_cancel(timer_wheel_t *wheel, timer_wheel_timer_t *timer) {
+    if (!timer->armed) {
+        return;
+    }
+    timer_wheel_unlink(wheel, timer);
+    timer->armed = false;
+    wheel->count--;
+}
+
+size_t timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_ms,
+                           timer_wheel_expire_cb cb, void *ctx) {
+    size_t fired = 0;
+
+    while (wheel->now_ms < now_ms) {
+        if (wheel->count == 0) {
+            wheel->now_ms = now_ms;
+            break;
+        }
+
+        /* Nothing due at level 0: jump to the next cascade point */
+        uint64_t tick = wheel->now_ms + 1;
+        if (wheel->occupied[0] == 0) {
+            uint64_t boundary = (wheel->now_ms | TIMER_WHEEL_MASK) + 1;
+            tick = boundary < now_ms ? boundary : now_ms;
+        }
+        wheel->now_ms = tick;
+
+        /* Each level is cascaded when every level below it wraps */
+        for (unsigned level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if ((tick & (((uint64_t)1 << (TIMER_WHEEL_SLOT_BITS * level)) - 1)) != 0) {
+                break;
+            }
+            timer_wheel_cascade(wheel, level,
+                                (unsigned)((tick >> (TIMER_WHEEL_SLOT_BITS * level)) & TIMER_WHEEL_MASK));
+        }
+
+        unsigned slot = (unsigned)(tick & TIMER_WHEEL_MASK);
+        timer_wheel_timer_t *timer;
+        while ((timer = wheel->slots[0][slot]) != NULL) {
+            timer_wheel_unlink(wheel, timer);
+            timer->armed = false;
+            wheel->count--;
+            fired++;
+            cb(timer, ctx);
+        }
+    }
+
+    return fired;
+}
+
+uint64_t timer_wheel_next_expiry(const timer_wheel_t *wheel) {
+    if (wheel->count == 0) {
+        return TIMER_WHEEL_NONE;
+    }
+
+    uint64_t next = TIMER_WHEEL_NONE;
+    for (unsigned level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        uint64_t bits = wheel->occupied[level];
+        if (!bits) {
+            continue;
+        }
+
+        /* Slots after the current one come first; the current one is a full turn away */
+        unsigned shift = TIMER_WHEEL_SLOT_BITS * level;
+        uint64_t block = wheel->now_ms >> shift;
+        unsigned start = (unsigned)((block + 1) & TIMER_WHEEL_MASK);
+        uint64_t rotated = start ? (bits >> start) | (bits << (TIMER_WHEEL_SLOTS - start)) : bits;
+        uint64_t at = (block + 1 + timer_wheel_ctz64(rotated)) << shift;
+
+        if (at < next) {
+            next = at;
+        }
+    }
+    return next;
+}
@@ -0,0 +1,98 @@
+/**
+ * timer_wheel.h - Hierarchical timer wheel
+ *
+ * Millisecond timers in five levels of 64 slots (level n slots span
+ * 64^n ms, about 12 days altogether; later timers wait in the top level).
+ * Timers are intrusive list nodes, so arming and cancelling are O(1) and
+ * allocate nothing. A timer fires on the first timer_wheel_advance() at
+ * or after its expiry; caller-side locking.
+ */
+
+#ifndef HTTPMORPH_TIMER_WHEEL_H
+#define HTTPMORPH_TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TIMER_WHEEL_LEVELS 5
+#define TIMER_WHEEL_SLOT_BITS 6
+#define TIMER_WHEEL_SLOTS (1u << TIMER_WHEEL_SLOT_BITS)
+
+/* timer_wheel_next_expiry() result when no timer is armed */
+#define TIMER_WHEEL_NONE UINT64_MAX
+
+/**
+ * A timer (embed it in the object it times; zeroed is disarmed)
+ */
+typedef struct timer_wheel_timer {
+    struct timer_wheel_timer *next;
+    struct timer_wheel_timer *prev;
+    uint64_t expires_ms;
+    void *data;                     /* Caller's pointer, untouched by the wheel */
+    uint8_t level;
+    uint8_t slot;
+    bool armed;
+} timer_wheel_timer_t;
+
+/**
+ * Wheel state (a zeroed wheel is empty, positioned at time 0)
+ */
+typedef struct {
+    uint64_t now_ms;                /* Time the wheel has advanced to */
+    timer_wheel_timer_t *slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];
+    uint64_t occupied[TIMER_WHEEL_LEVELS];  /* Bit per non-empty slot */
+    size_t count;                   /* Armed timers */
+} timer_wheel_t;
+
+/* Called for each expired timer; it is already disarmed and may be re-armed */
+typedef void (*timer_wheel_expire_cb)(timer_wheel_timer_t *timer, void *ctx);
+
+/**
+ * Reset a wheel
+ *
+ * @param wheel Wheel to reset
+ * @param now_ms Current time
+ */
+void timer_wheel_init(timer_wheel_t *wheel, uint64_t now_ms);
+
+/**
+ * Arm (or move) a timer
+ *
+ * @param wheel Wheel
+ * @param timer Timer to arm
+ * @param expires_ms Absolute expiry (past values fire on the next advance)
+ */
+void timer_wheel_arm(timer_wheel_t *wheel, timer_wheel_timer_t *timer, uint64_t expires_ms);
+
+/**
+ * Disarm a timer (no-op if it isn't armed)
+ */
+void timer_wheel_cancel(timer_wheel_t *wheel, timer_wheel_timer_t *timer);
+
+/**
+ * Advance to now_ms, firing every timer that expired on the way
+ *
+ * @return Number of timers fired
+ */
+size_t timer_wheel_advance(timer_wheel_t *wheel, uint64_t now_ms,
+                           timer_wheel_expire_cb cb, void *ctx);
+
+/**
+ * Earliest time the next advance can fire a timer
+ * Exact for timers due within 64 ms; otherwise the point where their
+ * level is next cascaded (never later than the expiry).
+ *
+ * @return Absolute time in ms, or TIMER_WHEEL_NONE if nothing is armed
+ */
+uint64_t timer_wheel_next_expiry(const timer_wheel_t *wheel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_TIMER_WHEEL_H */
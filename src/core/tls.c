@@ -4,6 +4,18 @@
 
 #include "internal/tls.h"
 #include "internal/util.h"
+#include "tls_session_cache.h"
+#include "trace.h"
+#include <openssl/pool.h>
+#include <zlib.h>
+
+#ifdef HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
 
 /* C wrapper for BoringSSL C++ function (defined in boringssl_wrapper.cc) */
 extern void httpmorph_set_aes_hw_override(SSL_CTX *ctx, int override_value);
@@ -52,13 +64,105 @@ static inline int SSL_CTX_set_max_proto_version(SSL_CTX *ctx, int version) {
     SSL_CTX_set_ecdh_auto(ctx, 1)
 #endif
 
-/* Stub certificate decompression function for compress_certificate extension */
-static int cert_decompress_stub(SSL *ssl, CRYPTO_BUFFER **out,
-                                 size_t uncompressed_len,
-                                 const uint8_t *in, size_t in_len) {
-    /* We only need to advertise support, not actually decompress */
+/* compress_certificate algorithm IDs (RFC 8879) */
+#define CERT_COMPRESSION_ZLIB    0x0001
+#define CERT_COMPRESSION_BROTLI  0x0002
+#define CERT_COMPRESSION_ZSTD    0x0003
+
+/* Certificate decompression callbacks for the compress_certificate extension.
+ * Each decodes into a CRYPTO_BUFFER of exactly the length the server
+ * announced; BoringSSL has already bounded uncompressed_len. */
+static int cert_decompress_zlib(SSL *ssl, CRYPTO_BUFFER **out,
+                                size_t uncompressed_len,
+                                const uint8_t *in, size_t in_len) {
+    (void)ssl;
+    uint8_t *data = NULL;
+    CRYPTO_BUFFER *buf = CRYPTO_BUFFER_alloc(&data, uncompressed_len);
+    if (!buf) {
+        return 0;
+    }
+
+    uLongf out_len = (uLongf)uncompressed_len;
+    if (uncompress(data, &out_len, in, (uLong)in_len) != Z_OK ||
+        out_len != uncompressed_len) {
+        CRYPTO_BUFFER_free(buf);
+        return 0;
+    }
+
+    *out = buf;
+    return 1;
+}
+
+#ifdef HAVE_BROTLI
+static int cert_decompress_brotli(SSL *ssl, CRYPTO_BUFFER **out,
+                                  size_t uncompressed_len,
+                                  const uint8_t *in, size_t in_len) {
+    (void)ssl;
+    uint8_t *data = NULL;
+    CRYPTO_BUFFER *buf = CRYPTO_BUFFER_alloc(&data, uncompressed_len);
+    if (!buf) {
+        return 0;
+    }
+
+    size_t out_len = uncompressed_len;
+    if (BrotliDecoderDecompress(in_len, in, &out_len, data) != BROTLI_DECODER_RESULT_SUCCESS ||
+        out_len != uncompressed_len) {
+        CRYPTO_BUFFER_free(buf);
+        return 0;
+    }
+
+    *out = buf;
+    return 1;
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static int cert_decompress_zstd(SSL *ssl, CRYPTO_BUFFER **out,
+                                size_t uncompressed_len,
+                                const uint8_t *in, size_t in_len) {
+    (void)ssl;
+    uint8_t *data = NULL;
+    CRYPTO_BUFFER *buf = CRYPTO_BUFFER_alloc(&data, uncompressed_len);
+    if (!buf) {
+        return 0;
+    }
+
+    size_t out_len = ZSTD_decompress(data, uncompressed_len, in, in_len);
+    if (ZSTD_isError(out_len) || out_len != uncompressed_len) {
+        CRYPTO_BUFFER_free(buf);
+        return 0;
+    }
+
+    *out = buf;
+    return 1;
+}
+#endif
+
+/* Fallback for algorithms a profile advertises but this build can't decode:
+ * keeps the ClientHello identical, the handshake fails if the server uses it */
+static int cert_decompress_unavailable(SSL *ssl, CRYPTO_BUFFER **out,
+                                       size_t uncompressed_len,
+                                       const uint8_t *in, size_t in_len) {
     (void)ssl; (void)out; (void)uncompressed_len; (void)in; (void)in_len;
-    return 0;  /* Return 0 to indicate we can't decompress, but extension is supported */
+    return 0;
+}
+
+/* Get the decompression callback for a compress_certificate algorithm */
+static ssl_cert_decompression_func_t cert_decompress_func(uint16_t alg_id) {
+    switch (alg_id) {
+        case CERT_COMPRESSION_ZLIB:
+            return cert_decompress_zlib;
+#ifdef HAVE_BROTLI
+        case CERT_COMPRESSION_BROTLI:
+            return cert_decompress_brotli;
+#endif
+#ifdef HAVE_ZSTD
+        case CERT_COMPRESSION_ZSTD:
+            return cert_decompress_zstd;
+#endif
+        default:
+            return cert_decompress_unavailable;
+    }
 }
 
 /**
@@ -77,11 +181,13 @@ int httpmorph_configure_ssl_ctx(SSL_CTX *ctx, const browser_profile_t *profile)
     SSL_CTX_set_max_proto_version(ctx, TLS1_2_VERSION);
 #endif
 
-    /* Enable certificate compression (Chrome 142 supports brotli, zlib)
-     * This is required for sites that send compressed certificates (e.g., Cloudflare)
-     * Passing NULL uses BoringSSL's built-in compression/decompression */
-    SSL_CTX_add_cert_compression_alg(ctx, TLSEXT_cert_compression_brotli, NULL, NULL);
-    SSL_CTX_add_cert_compression_alg(ctx, TLSEXT_cert_compression_zlib, NULL, NULL);
+    /* Enable compress_certificate extension (0x001b) with the profile's
+     * algorithms, in ClientHello order. We never send certificates, so only
+     * decompression is registered. */
+    for (int i = 0; i < profile->cert_compression_alg_count; i++) {
+        uint16_t alg_id = profile->cert_compression_algs[i];
+        SSL_CTX_add_cert_compression_alg(ctx, alg_id, NULL, cert_decompress_func(alg_id));
+    }
 
     /* Force AES hardware preference to match Chrome's cipher order (AES-GCM before ChaCha20)
      * This prevents BoringSSL from reordering ciphers based on ARM vs Intel CPU capabilities */
@@ -229,11 +335,6 @@ int httpmorph_configure_ssl_ctx(SSL_CTX *ctx, const browser_profile_t *profile)
             profile->signature_algorithm_count);
     }
 
-    /* Enable compress_certificate extension (0x001b) with brotli */
-    /* BoringSSL alg_id 0x0002 = brotli compression */
-    /* Provide decompress stub to advertise support */
-    SSL_CTX_add_cert_compression_alg(ctx, 0x0002, NULL, cert_decompress_stub);
-
     /* Note: application_settings (0x44cd/ALPS) and encrypted_client_hello
      * (0xfe0d/ECH) require per-connection setup. They will be enabled
      * per-SSL object in httpmorph_tls_connect(). */
@@ -244,7 +345,8 @@ int httpmorph_configure_ssl_ctx(SSL_CTX *ctx, const browser_profile_t *profile)
 /**
  * Establish TLS connection on existing socket
  */
-SSL* httpmorph_tls_connect(SSL_CTX *ctx, int sockfd, const char *hostname,
+SSL* httpmorph_tls_connect(SSL_CTX *ctx, tls_session_cache_t *session_cache,
+                            int sockfd, const char *hostname, uint16_t port,
                             const browser_profile_t *browser_profile,
                             bool http2_enabled, bool verify_cert, uint64_t *tls_time_us) {
     uint64_t start_time = httpmorph_get_time_us();
@@ -308,6 +410,11 @@ SSL* httpmorph_tls_connect(SSL_CTX *ctx, int sockfd, const char *hostname,
     /* Set SNI hostname */
     SSL_set_tlsext_host_name(ssl, hostname);
 
+    /* Offer a cached session for this origin if the client has a cache */
+    tls_session_cache_prepare(session_cache, ssl, hostname, port,
+                              browser_profile ? browser_profile->name : NULL,
+                              verify_cert);
+
     /* Attach to socket */
     if (SSL_set_fd(ssl, sockfd) != 1) {
         SSL_free(ssl);
@@ -320,6 +427,7 @@ SSL* httpmorph_tls_connect(SSL_CTX *ctx, int sockfd, const char *hostname,
     uint64_t handshake_timeout_us = 30000000;  /* 30 seconds */
     uint64_t deadline = start_time + handshake_timeout_us;
 
+    HTTPMORPH_PROBE2(tls__start, hostname, port);
     while (1) {
         ret = SSL_connect(ssl);
         if (ret == 1) {
@@ -334,6 +442,7 @@ SSL* httpmorph_tls_connect(SSL_CTX *ctx, int sockfd, const char *hostname,
             /* Check timeout */
             uint64_t now = httpmorph_get_time_us();
             if (now >= deadline) {
+                HTTPMORPH_PROBE4(tls__done, hostname, port, 0, now - start_time);
                 SSL_free(ssl);
                 return NULL;  /* Timeout */
             }
@@ -357,6 +466,7 @@ SSL* httpmorph_tls_connect(SSL_CTX *ctx, int sockfd, const char *hostname,
 
             int select_ret = select(SELECT_NFDS(sockfd), &read_fds, &write_fds, NULL, &tv);
             if (select_ret <= 0) {
+                HTTPMORPH_PROBE4(tls__done, hostname, port, 0, httpmorph_get_time_us() - start_time);
                 SSL_free(ssl);
                 return NULL;  /* Timeout or error */
             }
@@ -375,11 +485,15 @@ SSL* httpmorph_tls_connect(SSL_CTX *ctx, int sockfd, const char *hostname,
         } else {
             fprintf(stderr, "TLS handshake failed with SSL error code: %d\n", ssl_err);
         }
+        HTTPMORPH_PROBE4(tls__done, hostname, port, 0, httpmorph_get_time_us() - start_time);
         SSL_free(ssl);
         return NULL;
     }
 
+    tls_session_cache_handshake_done(ssl);
+
     *tls_time_us = httpmorph_get_time_us() - start_time;
+    HTTPMORPH_PROBE4(tls__done, hostname, port, 1, *tls_time_us);
     return ssl;
 }
 
@@ -505,6 +619,89 @@ char* httpmorph_calculate_ja3(SSL *ssl, const browser_profile_t *profile) {
     return ja3_hash;
 }
 
+/* JA3 only depends on the profile and negotiated version (and the cipher
+ * when there is no profile), so each combination is computed once. Entries
+ * are published on a lock-free list and never freed. */
+typedef struct ja3_cache_entry {
+    const browser_profile_t *profile;
+    int version;
+    uint16_t cipher_id;
+    char *ja3;
+    struct ja3_cache_entry *next;
+} ja3_cache_entry_t;
+
+static ja3_cache_entry_t *ja3_cache = NULL;
+
+#ifdef _WIN32
+    #define JA3_LOAD(p) InterlockedCompareExchangePointer((PVOID volatile *)(p), NULL, NULL)
+    #define JA3_CAS(p, expected, desired) \
+        (InterlockedCompareExchangePointer((PVOID volatile *)(p), (desired), (expected)) == (expected))
+#else
+    #define JA3_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define JA3_CAS(p, expected, desired) \
+        __atomic_compare_exchange_n((p), &(expected), (desired), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#endif
+
+static const char* ja3_cache_find(ja3_cache_entry_t *e, const browser_profile_t *profile,
+                                  int version, uint16_t cipher_id) {
+    for (; e; e = e->next) {
+        if (e->profile == profile && e->version == version && e->cipher_id == cipher_id) {
+            return e->ja3;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Get the JA3 fingerprint of a connection (computed once per combination)
+ */
+const char* httpmorph_tls_ja3(SSL *ssl, const browser_profile_t *profile) {
+    if (!ssl) {
+        return NULL;
+    }
+
+    int version = SSL_version(ssl);
+    uint16_t cipher_id = 0;
+    if (!profile || profile->cipher_suite_count == 0) {
+        const SSL_CIPHER *cipher = SSL_get_current_cipher(ssl);
+        cipher_id = cipher ? (uint16_t)(SSL_CIPHER_get_id(cipher) & 0xFFFF) : 0;
+    }
+
+    ja3_cache_entry_t *head = JA3_LOAD(&ja3_cache);
+    const char *found = ja3_cache_find(head, profile, version, cipher_id);
+    if (found) {
+        return found;
+    }
+
+    ja3_cache_entry_t *entry = malloc(sizeof(ja3_cache_entry_t));
+    if (!entry) {
+        return NULL;
+    }
+    entry->ja3 = httpmorph_calculate_ja3(ssl, profile);
+    if (!entry->ja3) {
+        free(entry);
+        return NULL;
+    }
+    entry->profile = profile;
+    entry->version = version;
+    entry->cipher_id = cipher_id;
+
+    for (;;) {
+        entry->next = head;
+        if (JA3_CAS(&ja3_cache, head, entry)) {
+            return entry->ja3;
+        }
+        /* Another thread published first; it may have added this combination */
+        head = JA3_LOAD(&ja3_cache);
+        found = ja3_cache_find(head, profile, version, cipher_id);
+        if (found) {
+            free(entry->ja3);
+            free(entry);
+            return found;
+        }
+    }
+}
+
 /**
  * Configure SSL context TLS version range
  */
@@ -0,0 +1,593 @@
+/**
+ * tls_session_cache.c - Client-side TLS session resumption cache
+ *
+ * Hash table of origins with an LRU list for eviction. Each origin keeps up
+ * to TLS_SESSION_CACHE_SESSIONS_PER_KEY sessions, newest first. With a
+ * shared cache open (shared_cache.h) new sessions are also offered to
+ * other processes, and a miss here is tried there.
+ */
+
+#include "tls_session_cache.h"
+#include "shared_cache.h"
+#include "ssl_ctx_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <openssl/ssl.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define strdup _strdup
+#else
+    #include <pthread.h>
+#endif
+
+/* Cached origin */
+typedef struct tls_session_entry {
+    char *key;
+    uint32_t hash;
+    SSL_SESSION *sessions[TLS_SESSION_CACHE_SESSIONS_PER_KEY];  /* Newest first */
+    int session_count;
+
+    struct tls_session_entry *hash_next;  /* Bucket chain */
+    struct tls_session_entry *lru_prev;   /* Towards most recently used */
+    struct tls_session_entry *lru_next;   /* Towards least recently used */
+} tls_session_entry_t;
+
+/* Session cache structure */
+struct tls_session_cache {
+    tls_session_entry_t *buckets[TLS_SESSION_CACHE_BUCKETS];
+    tls_session_entry_t *lru_head;  /* Most recently used */
+    tls_session_entry_t *lru_tail;  /* Least recently used */
+    size_t entry_count;
+    size_t max_entries;
+
+    /* Statistics */
+    tls_session_cache_stats_t stats;
+
+    /* Owner plus every SSL tagged with this cache */
+    size_t refs;
+    bool closed;               /* Owner released it; new sessions are dropped */
+
+    /* Thread safety */
+#ifdef _WIN32
+    CRITICAL_SECTION mutex;
+#else
+    pthread_mutex_t mutex;
+#endif
+};
+
+/* Cache and key a connection stores its sessions under */
+typedef struct {
+    tls_session_cache_t *cache;
+    const char *shared_key;    /* Key in the shared cache (NULL: not shared) */
+    char key[];
+} tls_session_tag_t;
+
+/* ex_data index of the tag on each SSL */
+static int ssl_ex_index = -1;
+
+#ifndef _WIN32
+static pthread_once_t ex_index_once = PTHREAD_ONCE_INIT;
+#define CACHE_LOCK(c)   pthread_mutex_lock(&(c)->mutex)
+#define CACHE_UNLOCK(c) pthread_mutex_unlock(&(c)->mutex)
+#else
+static INIT_ONCE ex_index_once = INIT_ONCE_STATIC_INIT;
+#define CACHE_LOCK(c)   EnterCriticalSection(&(c)->mutex)
+#define CACHE_UNLOCK(c) LeaveCriticalSection(&(c)->mutex)
+#endif
+
+static void cache_free(tls_session_cache_t *cache);
+
+/**
+ * Drop a reference; the last one frees the cache
+ */
+static void cache_unref(tls_session_cache_t *cache) {
+    CACHE_LOCK(cache);
+    bool last = --cache->refs == 0;
+    CACHE_UNLOCK(cache);
+    if (last) {
+        cache_free(cache);
+    }
+}
+
+/**
+ * Free the tag attached to an SSL object
+ */
+static void ssl_tag_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad,
+                         int index, long argl, void *argp) {
+    (void)parent; (void)ad; (void)index; (void)argl; (void)argp;
+    tls_session_tag_t *tag = ptr;
+    if (tag) {
+        cache_unref(tag->cache);
+        free(tag);
+    }
+}
+
+#ifndef _WIN32
+static void ex_index_init(void) {
+#else
+static BOOL CALLBACK ex_index_init(PINIT_ONCE InitOnce, PVOID Parameter, PVOID *Context) {
+    (void)InitOnce; (void)Parameter; (void)Context;
+#endif
+    ssl_ex_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, ssl_tag_free);
+#ifdef _WIN32
+    return TRUE;
+#endif
+}
+
+static bool ex_indices_ready(void) {
+#ifndef _WIN32
+    pthread_once(&ex_index_once, ex_index_init);
+#else
+    InitOnceExecuteOnce(&ex_index_once, ex_index_init, NULL, NULL);
+#endif
+    return ssl_ex_index >= 0;
+}
+
+/**
+ * FNV-1a hash of the cache key
+ */
+static uint32_t key_hash(const char *key) {
+    uint32_t h = 2166136261u;
+    while (*key) {
+        h ^= (uint8_t)*key++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Check whether a session can still be offered
+ */
+static bool session_usable(const SSL_SESSION *session, uint64_t now) {
+    uint64_t expires = (uint64_t)SSL_SESSION_get_time(session) +
+                       (uint64_t)SSL_SESSION_get_timeout(session);
+    return now < expires && SSL_SESSION_is_resumable(session);
+}
+
+/**
+ * TLS 1.3 tickets must not be reused (RFC 8446 Appendix C.4)
+ */
+static bool session_single_use(const SSL_SESSION *session) {
+#ifdef OPENSSL_IS_BORINGSSL
+    return SSL_SESSION_should_be_single_use(session);
+#else
+    return SSL_SESSION_get_protocol_version(session) >= TLS1_3_VERSION;
+#endif
+}
+
+static void lru_unlink(tls_session_cache_t *cache, tls_session_entry_t *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(tls_session_cache_t *cache, tls_session_entry_t *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head) {
+        cache->lru_head->lru_prev = entry;
+    }
+    cache->lru_head = entry;
+    if (!cache->lru_tail) {
+        cache->lru_tail = entry;
+    }
+}
+
+static tls_session_entry_t* entry_find(tls_session_cache_t *cache,
+                                       const char *key, uint32_t hash) {
+    tls_session_entry_t *entry = cache->buckets[hash & (TLS_SESSION_CACHE_BUCKETS - 1)];
+    while (entry) {
+        if (entry->hash == hash && strcmp(entry->key, key) == 0) {
+            return entry;
+        }
+        entry = entry->hash_next;
+    }
+    return NULL;
+}
+
+/**
+ * Unlink an entry from the table and free it (mutex must be held)
+ */
+static void entry_remove(tls_session_cache_t *cache, tls_session_entry_t *entry) {
+    tls_session_entry_t **pp = &cache->buckets[entry->hash & (TLS_SESSION_CACHE_BUCKETS - 1)];
+    while (*pp && *pp != entry) {
+        pp = &(*pp)->hash_next;
+    }
+    if (*pp) {
+        *pp = entry->hash_next;
+    }
+    lru_unlink(cache, entry);
+
+    for (int i = 0; i < entry->session_count; i++) {
+        SSL_SESSION_free(entry->sessions[i]);
+    }
+    free(entry->key);
+    free(entry);
+    cache->entry_count--;
+}
+
+/**
+ * Remove session i from an entry, shifting older sessions up
+ */
+static void entry_drop_session(tls_session_entry_t *entry, int i) {
+    for (int j = i + 1; j < entry->session_count; j++) {
+        entry->sessions[j - 1] = entry->sessions[j];
+    }
+    entry->session_count--;
+}
+
+/**
+ * Store a session under a key, taking ownership of the reference
+ */
+static void cache_store(tls_session_cache_t *cache, const char *key, SSL_SESSION *session) {
+    uint32_t hash = key_hash(key);
+
+    CACHE_LOCK(cache);
+
+    if (cache->closed) {
+        CACHE_UNLOCK(cache);
+        SSL_SESSION_free(session);
+        return;
+    }
+
+    tls_session_entry_t *entry = entry_find(cache, key, hash);
+    if (!entry) {
+        entry = calloc(1, sizeof(tls_session_entry_t));
+        if (entry) {
+            entry->key = strdup(key);
+        }
+        if (!entry || !entry->key) {
+            free(entry);
+            CACHE_UNLOCK(cache);
+            SSL_SESSION_free(session);
+            return;
+        }
+        entry->hash = hash;
+
+        size_t bucket = hash & (TLS_SESSION_CACHE_BUCKETS - 1);
+        entry->hash_next = cache->buckets[bucket];
+        cache->buckets[bucket] = entry;
+        cache->entry_count++;
+    } else {
+        lru_unlink(cache, entry);
+    }
+    lru_push_front(cache, entry);
+
+    /* Push newest session to the front, dropping the oldest when full */
+    if (entry->session_count == TLS_SESSION_CACHE_SESSIONS_PER_KEY) {
+        SSL_SESSION_free(entry->sessions[--entry->session_count]);
+    }
+    for (int i = entry->session_count; i > 0; i--) {
+        entry->sessions[i] = entry->sessions[i - 1];
+    }
+    entry->sessions[0] = session;
+    entry->session_count++;
+    cache->stats.stores++;
+
+    while (cache->entry_count > cache->max_entries && cache->lru_tail) {
+        entry_remove(cache, cache->lru_tail);
+        cache->stats.evictions++;
+    }
+
+    CACHE_UNLOCK(cache);
+}
+
+/**
+ * Fetch the newest usable session for a key
+ * Returns a new reference or NULL
+ */
+static SSL_SESSION* cache_lookup(tls_session_cache_t *cache, const char *key) {
+    uint32_t hash = key_hash(key);
+    uint64_t now = (uint64_t)time(NULL);
+    SSL_SESSION *result = NULL;
+
+    CACHE_LOCK(cache);
+
+    tls_session_entry_t *entry = entry_find(cache, key, hash);
+    if (entry) {
+        /* Drop sessions whose lifetime has ended */
+        for (int i = entry->session_count - 1; i >= 0; i--) {
+            if (!session_usable(entry->sessions[i], now)) {
+                SSL_SESSION_free(entry->sessions[i]);
+                entry_drop_session(entry, i);
+                cache->stats.expirations++;
+            }
+        }
+
+        if (entry->session_count > 0) {
+            result = entry->sessions[0];
+            if (session_single_use(result)) {
+                /* Hand our reference to the caller */
+                entry_drop_session(entry, 0);
+            } else {
+                SSL_SESSION_up_ref(result);
+            }
+        }
+
+        if (entry->session_count == 0) {
+            entry_remove(cache, entry);
+        } else {
+            lru_unlink(cache, entry);
+            lru_push_front(cache, entry);
+        }
+    }
+
+    if (result) {
+        cache->stats.hits++;
+    } else {
+        cache->stats.misses++;
+    }
+
+    CACHE_UNLOCK(cache);
+    return result;
+}
+
+/**
+ * Offer a session to the cache shared with other processes
+ * Returns true if it was stored there
+ */
+static bool shared_store(const char *key, SSL_SESSION *session) {
+    if (!shared_cache_enabled()) {
+        return false;
+    }
+
+    int len = i2d_SSL_SESSION(session, NULL);
+    if (len <= 0 || len > SHARED_CACHE_SESSION_MAX) {
+        return false;
+    }
+    uint8_t der[SHARED_CACHE_SESSION_MAX];
+    uint8_t *p = der;
+    if (i2d_SSL_SESSION(session, &p) != len) {
+        return false;
+    }
+
+    int64_t expires = (int64_t)SSL_SESSION_get_time(session) + (int64_t)SSL_SESSION_get_timeout(session);
+    return shared_cache_tls_put(key, der, (size_t)len, session_single_use(session), expires);
+}
+
+/**
+ * Fetch a session another process stored
+ * Returns a new reference or NULL
+ */
+static SSL_SESSION* shared_lookup(const char *key) {
+    if (!shared_cache_enabled()) {
+        return NULL;
+    }
+
+    uint8_t der[SHARED_CACHE_SESSION_MAX];
+    size_t len = shared_cache_tls_take(key, der, sizeof(der));
+    if (len == 0) {
+        return NULL;
+    }
+    const uint8_t *p = der;
+    SSL_SESSION *session = d2i_SSL_SESSION(NULL, &p, (long)len);
+    if (session && !session_usable(session, (uint64_t)time(NULL))) {
+        SSL_SESSION_free(session);
+        return NULL;
+    }
+    return session;
+}
+
+/**
+ * SSL_CTX new-session callback
+ * Returns 1 when the cache keeps the session reference
+ */
+static int new_session_cb(SSL *ssl, SSL_SESSION *session) {
+    tls_session_tag_t *tag = SSL_get_ex_data(ssl, ssl_ex_index);
+    if (!tag) {
+        return 0;
+    }
+
+    /* A shared single-use ticket stays out of the local cache: only the
+     * one process that takes it from the shared cache may spend it */
+    if (tag->shared_key && shared_store(tag->shared_key, session) && session_single_use(session)) {
+        return 0;
+    }
+
+    cache_store(tag->cache, tag->key, session);
+    return 1;
+}
+
+/**
+ * Create a new session cache
+ */
+tls_session_cache_t* tls_session_cache_create(size_t max_entries) {
+    if (!ex_indices_ready()) {
+        return NULL;
+    }
+
+    tls_session_cache_t *cache = calloc(1, sizeof(tls_session_cache_t));
+    if (!cache) {
+        return NULL;
+    }
+
+    cache->max_entries = max_entries > 0 ? max_entries : TLS_SESSION_CACHE_DEFAULT_ENTRIES;
+    cache->refs = 1;
+
+#ifdef _WIN32
+    InitializeCriticalSection(&cache->mutex);
+#else
+    pthread_mutex_init(&cache->mutex, NULL);
+#endif
+
+    return cache;
+}
+
+/**
+ * Free a cache once nothing references it
+ */
+static void cache_free(tls_session_cache_t *cache) {
+    tls_session_cache_clear(cache);
+
+#ifdef _WIN32
+    DeleteCriticalSection(&cache->mutex);
+#else
+    pthread_mutex_destroy(&cache->mutex);
+#endif
+
+    free(cache);
+}
+
+/**
+ * Destroy a session cache
+ */
+void tls_session_cache_destroy(tls_session_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+
+    /* Connections still tagged with the cache keep the struct alive */
+    CACHE_LOCK(cache);
+    cache->closed = true;
+    CACHE_UNLOCK(cache);
+    tls_session_cache_clear(cache);
+    cache_unref(cache);
+}
+
+/**
+ * Enable session caching on an SSL context
+ */
+int tls_session_cache_install(SSL_CTX *ctx) {
+    if (!ctx || !ex_indices_ready()) {
+        return -1;
+    }
+
+    /* Client-side caching only; the context's internal store is bypassed so
+     * all lookups go through the keyed caches */
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL);
+    SSL_CTX_sess_set_new_cb(ctx, new_session_cb);
+
+    return 0;
+}
+
+/**
+ * Prepare a new connection for resumption
+ */
+bool tls_session_cache_prepare(tls_session_cache_t *cache, SSL *ssl, const char *host,
+                               uint16_t port, const char *profile_name, bool verify_cert) {
+    if (!cache || !ssl || !host || !ex_indices_ready()) {
+        return false;
+    }
+
+    /* Sessions from unverified handshakes must never satisfy a verified
+     * request, since resumption skips certificate validation */
+    char key[320];
+    int n = snprintf(key, sizeof(key), "%s:%u|%s|%c", host, (unsigned)port,
+                     profile_name ? profile_name : "", verify_cert ? 'v' : 'n');
+    if (n < 0 || (size_t)n >= sizeof(key)) {
+        return false;
+    }
+
+    /* Other processes' clients may trust other CAs or allow other TLS
+     * versions under the same profile: the shared key names the context's
+     * CA file and version range too, and contexts built outside the
+     * context cache don't share at all */
+    char shared_key[SHARED_CACHE_KEY_MAX];
+    int shared_n = -1;
+    char identity[64];
+    if (shared_cache_enabled() &&
+        ssl_ctx_cache_identity(SSL_get_SSL_CTX(ssl), identity, sizeof(identity))) {
+        shared_n = snprintf(shared_key, sizeof(shared_key), "%s|%s", key, identity);
+        if (shared_n >= (int)sizeof(shared_key)) {
+            shared_n = -1;
+        }
+    }
+
+    size_t extra = shared_n >= 0 ? (size_t)shared_n + 1 : 0;
+    tls_session_tag_t *tag = malloc(sizeof(tls_session_tag_t) + (size_t)n + 1 + extra);
+    if (!tag) {
+        return false;
+    }
+    tag->cache = cache;
+    memcpy(tag->key, key, (size_t)n + 1);
+    tag->shared_key = NULL;
+    if (shared_n >= 0) {
+        memcpy(tag->key + n + 1, shared_key, extra);
+        tag->shared_key = tag->key + n + 1;
+    }
+
+    CACHE_LOCK(cache);
+    bool open = !cache->closed;
+    if (open) {
+        cache->refs++;
+    }
+    CACHE_UNLOCK(cache);
+    if (!open || SSL_set_ex_data(ssl, ssl_ex_index, tag) != 1) {
+        if (open) {
+            cache_unref(cache);
+        }
+        free(tag);
+        return false;
+    }
+
+    SSL_SESSION *session = cache_lookup(cache, key);
+    if (!session && tag->shared_key) {
+        session = shared_lookup(tag->shared_key);
+    }
+    if (!session) {
+        return false;
+    }
+
+    int ok = SSL_set_session(ssl, session);
+    SSL_SESSION_free(session);
+    return ok == 1;
+}
+
+/**
+ * Record the outcome of a completed handshake
+ */
+void tls_session_cache_handshake_done(SSL *ssl) {
+    if (!ssl || ssl_ex_index < 0 || !SSL_session_reused(ssl)) {
+        return;
+    }
+
+    tls_session_tag_t *tag = SSL_get_ex_data(ssl, ssl_ex_index);
+    if (!tag) {
+        return;
+    }
+    tls_session_cache_t *cache = tag->cache;
+
+    CACHE_LOCK(cache);
+    cache->stats.resumptions++;
+    CACHE_UNLOCK(cache);
+}
+
+/**
+ * Drop all cached sessions
+ */
+void tls_session_cache_clear(tls_session_cache_t *cache) {
+    if (!cache) {
+        return;
+    }
+
+    CACHE_LOCK(cache);
+    while (cache->lru_head) {
+        entry_remove(cache, cache->lru_head);
+    }
+    CACHE_UNLOCK(cache);
+}
+
+/**
+ * Get statistics about cache usage
+ */
+void tls_session_cache_stats(tls_session_cache_t *cache, tls_session_cache_stats_t *stats) {
+    if (!cache || !stats) {
+        return;
+    }
+
+    CACHE_LOCK(cache);
+    *stats = cache->stats;
+    stats->entries = cache->entry_count;
+    CACHE_UNLOCK(cache);
+}
@@ -0,0 +1,132 @@
+/**
+ * tls_session_cache.h - Client-side TLS session resumption cache
+ *
+ * Stores TLS 1.2 sessions and TLS 1.3 tickets per (host, port, browser
+ * profile, verification mode) so repeat connections to the same origin can
+ * resume instead of paying a full handshake. Mirrors the browser behaviour
+ * of keeping the two most recent sessions per origin and using TLS 1.3
+ * tickets only once.
+ *
+ * Caches are not tied to an SSL_CTX: contexts are shared between clients,
+ * so each connection is tagged with the cache of the client that opened it.
+ */
+
+#ifndef HTTPMORPH_TLS_SESSION_CACHE_H
+#define HTTPMORPH_TLS_SESSION_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Forward declarations (avoid including OpenSSL headers here)
+ */
+typedef struct ssl_st SSL;
+typedef struct ssl_ctx_st SSL_CTX;
+
+/* Default maximum number of origins kept in the cache */
+#define TLS_SESSION_CACHE_DEFAULT_ENTRIES  1024
+
+/* Hash buckets (power of 2) */
+#define TLS_SESSION_CACHE_BUCKETS          256
+
+/* Sessions kept per origin (servers usually issue two TLS 1.3 tickets) */
+#define TLS_SESSION_CACHE_SESSIONS_PER_KEY 2
+
+/**
+ * TLS session cache
+ * Thread-safe LRU cache of SSL_SESSION objects
+ */
+typedef struct tls_session_cache tls_session_cache_t;
+
+/**
+ * Cache statistics
+ */
+typedef struct {
+    uint64_t hits;          /* Lookups that offered a cached session */
+    uint64_t misses;        /* Lookups with nothing to offer */
+    uint64_t stores;        /* Sessions received from servers */
+    uint64_t evictions;     /* Origins dropped to respect max_entries */
+    uint64_t expirations;   /* Sessions dropped because their lifetime ended */
+    uint64_t resumptions;   /* Handshakes the server actually resumed */
+    size_t entries;         /* Origins currently cached */
+} tls_session_cache_stats_t;
+
+/**
+ * Create a new session cache
+ *
+ * @param max_entries Maximum number of origins (0 for default)
+ * @return Initialized cache or NULL on error
+ */
+tls_session_cache_t* tls_session_cache_create(size_t max_entries);
+
+/**
+ * Destroy a session cache and release all cached sessions
+ *
+ * Connections still tagged with the cache keep it allocated until they are
+ * freed; sessions they receive afterwards are dropped.
+ *
+ * @param cache Cache to destroy
+ */
+void tls_session_cache_destroy(tls_session_cache_t *cache);
+
+/**
+ * Enable session caching on an SSL context
+ *
+ * Enables client-side session caching on the context and routes new
+ * sessions into the cache their connection was tagged with.
+ *
+ * @param ctx SSL context
+ * @return 0 on success, -1 on error
+ */
+int tls_session_cache_install(SSL_CTX *ctx);
+
+/**
+ * Prepare a new connection for resumption
+ *
+ * Tags the SSL object with the cache and its key and offers the most
+ * recent cached session, if any. Must be called before the handshake
+ * starts. No-op when cache is NULL.
+ *
+ * @param cache Session cache (NULL for none)
+ * @param ssl SSL connection (not yet connected)
+ * @param host Target hostname
+ * @param port Target port
+ * @param profile_name Browser profile name (NULL for none)
+ * @param verify_cert Whether the certificate is verified on this connection
+ * @return true if a session was offered, false otherwise
+ */
+bool tls_session_cache_prepare(tls_session_cache_t *cache, SSL *ssl, const char *host,
+                               uint16_t port, const char *profile_name, bool verify_cert);
+
+/**
+ * Record the outcome of a completed handshake
+ *
+ * @param ssl SSL connection after a successful handshake
+ */
+void tls_session_cache_handshake_done(SSL *ssl);
+
+/**
+ * Drop all cached sessions
+ *
+ * @param cache Session cache
+ */
+void tls_session_cache_clear(tls_session_cache_t *cache);
+
+/**
+ * Get statistics about cache usage
+ *
+ * @param cache Session cache
+ * @param stats Output statistics
+ */
+void tls_session_cache_stats(tls_session_cache_t *cache, tls_session_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_TLS_SESSION_CACHE_H */
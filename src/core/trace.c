@@ -0,0 +1,162 @@
+/**
+ * trace.c - Span tracing
+ *
+ * Requests aren't instrumented span by span: the phase durations on the
+ * response already say how long each phase took, so a finished request's
+ * spans are laid out back to back from those, ending at the current time.
+ * Nothing is recorded while no tracer is set.
+ */
+
+#include "trace.h"
+#include "internal/request.h"
+#include <openssl/rand.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #define TRACE_INC(p) ((uint64_t)InterlockedIncrement64((volatile LONG64*)(p)))
+    #define TRACE_LOAD_PTR(p) InterlockedCompareExchangePointer((PVOID volatile*)(p), NULL, NULL)
+    #define TRACE_STORE_PTR(p, v) InterlockedExchangePointer((PVOID volatile*)(p), (PVOID)(v))
+#else
+    #define TRACE_INC(p) __atomic_add_fetch((p), 1, __ATOMIC_RELAXED)
+    #define TRACE_LOAD_PTR(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+    #define TRACE_STORE_PTR(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+/* Phases laid out under the root span, in order */
+#define TRACE_PHASES 6
+
+static uint64_t next_request_id = 0;
+static httpmorph_span_callback_t tracer = NULL;
+static void *tracer_data = NULL;
+
+/**
+ * Get a new request id
+ */
+uint64_t trace_next_request_id(void) {
+    return TRACE_INC(&next_request_id);
+}
+
+/**
+ * Emit spans for every request to a callback
+ * The callback is published after its user_data, so a request finishing
+ * concurrently sees a matching pair unless both are replaced at once.
+ */
+void httpmorph_set_tracer(httpmorph_span_callback_t callback, void *user_data) {
+    TRACE_STORE_PTR(&tracer, NULL);
+    tracer_data = user_data;
+    TRACE_STORE_PTR(&tracer, callback);
+}
+
+/**
+ * Wall-clock time in nanoseconds since the epoch
+ */
+static uint64_t trace_unix_ns(void) {
+#ifdef _WIN32
+    FILETIME ft;
+    GetSystemTimeAsFileTime(&ft);
+    uint64_t ticks = ((uint64_t)ft.dwHighDateTime << 32) | ft.dwLowDateTime;
+    return (ticks - 116444736000000000ULL) * 100;  /* 100ns ticks since 1601 */
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+ * Report a finished request
+ */
+void trace_request(uint64_t request_id, const httpmorph_request_t *request,
+                   const httpmorph_response_t *response) {
+    HTTPMORPH_PROBE4(request__done, request_id,
+                     response ? (int)response->status_code : 0,
+                     response ? (int)response->error : (int)HTTPMORPH_ERROR_MEMORY,
+                     response ? response->total_time_us : 0);
+
+    httpmorph_span_callback_t callback = TRACE_LOAD_PTR(&tracer);
+    if (!callback || !request) {
+        return;
+    }
+    void *user_data = tracer_data;
+
+    /* Random ids, as W3C Trace Context asks: trace id, then root and phase span ids */
+    uint8_t ids[16 + 8 * (1 + TRACE_PHASES)];
+    if (RAND_bytes(ids, sizeof(ids)) != 1) {
+        return;
+    }
+
+    uint64_t end_ns = trace_unix_ns();
+    uint64_t queue_us = response ? response->queue_time_us : 0;
+    uint64_t total_us = response ? response->total_time_us : 0;
+    uint64_t start_ns = end_ns - (queue_us + total_us) * 1000;
+    if (start_ns > end_ns) {
+        start_ns = end_ns;
+    }
+
+    httpmorph_span_t span;
+    memset(&span, 0, sizeof(span));
+    memcpy(span.trace_id, ids, 16);
+    memcpy(span.span_id, ids + 16, 8);
+    span.name = httpmorph_method_to_string(request->method);
+    span.start_unix_ns = start_ns;
+    span.end_unix_ns = end_ns;
+    span.request_id = request_id;
+    span.method = span.name;
+    span.url = request->url;
+    if (response) {
+        span.status_code = response->error == HTTPMORPH_OK ? response->status_code : 0;
+        span.error = response->error;
+        span.http_version = response->http_version;
+        span.connection_reused = response->connection_reused;
+        span.tls_resumed = response->tls_resumed;
+        span.body_len = response->body_len;
+    } else {
+        span.error = HTTPMORPH_ERROR_MEMORY;
+    }
+    callback(&span, user_data);
+
+    if (!response) {
+        return;
+    }
+
+    /* Phase boundaries, in microseconds from when the request was started.
+     * connect_time_us includes DNS; first_byte_time_us runs from the start. */
+    uint64_t dns = response->dns_time_us;
+    uint64_t connect = response->connect_time_us > dns ? response->connect_time_us : dns;
+    uint64_t tls = connect + response->tls_time_us;
+    uint64_t first_byte = response->first_byte_time_us;
+    uint64_t started_ns = start_ns + queue_us * 1000;
+    static const char *const names[TRACE_PHASES] = {
+        "queue", "dns", "connect", "tls", "wait", "body"
+    };
+    uint64_t bounds[TRACE_PHASES][2] = {
+        { start_ns, started_ns },
+        { started_ns, started_ns + dns * 1000 },
+        { started_ns + dns * 1000, started_ns + connect * 1000 },
+        { started_ns + connect * 1000, started_ns + tls * 1000 },
+        { started_ns + tls * 1000, started_ns + first_byte * 1000 },
+        { started_ns + first_byte * 1000, end_ns },
+    };
+    /* No response bytes (cache hit or failure): nothing to wait for or read */
+    int phases = first_byte ? TRACE_PHASES : TRACE_PHASES - 2;
+
+    httpmorph_span_t phase;
+    memset(&phase, 0, sizeof(phase));
+    memcpy(phase.trace_id, span.trace_id, 16);
+    memcpy(phase.parent_span_id, span.span_id, 8);
+    phase.request_id = request_id;
+
+    for (int i = 0; i < phases; i++) {
+        uint64_t to_ns = bounds[i][1] < end_ns ? bounds[i][1] : end_ns;
+        if (to_ns <= bounds[i][0]) {
+            continue;  /* Skipped phase (reused connection, plain HTTP, ...) */
+        }
+        memcpy(phase.span_id, ids + 16 + 8 * (1 + i), 8);
+        phase.name = names[i];
+        phase.start_unix_ns = bounds[i][0];
+        phase.end_unix_ns = to_ns;
+        callback(&phase, user_data);
+    }
+}
@@ -0,0 +1,70 @@
+/**
+ * trace.h - Static probes and span tracing
+ *
+ * HTTPMORPH_PROBEn() marks a state transition as a USDT probe of the
+ * "httpmorph" provider when built with HAVE_SYS_SDT (systemtap's
+ * <sys/sdt.h>, which DTrace-compatible tools such as bpftrace and perf
+ * read). A probe is a single nop until a tracer attaches; without
+ * HAVE_SYS_SDT it compiles to nothing. Probes:
+ *
+ *   request__start(id, url)                  request begins executing
+ *   request__state(id, from, to)             async state machine transition
+ *   request__done(id, status, error, total_us)
+ *   pool__get(key, hit)                      key = "host:port", hit = connection found
+ *   pool__put(key, kept)                     kept = stored (or shared) for reuse
+ *   connect__start(host, port)
+ *   dns__done(host, port, ok, dns_us)
+ *   connect__done(host, port, fd, connect_us)    fd < 0 on failure
+ *   tls__start(host, port)
+ *   tls__done(host, port, ok, tls_us)
+ *   h2__stream__open(stream_id)
+ *   h2__stream__close(stream_id, error_code)
+ *
+ * Span tracing is separate: the callback set with httpmorph_set_tracer()
+ * gets an OpenTelemetry-style span tree for each finished request, built
+ * from the phase timings on its response.
+ */
+
+#ifndef HTTPMORPH_TRACE_H
+#define HTTPMORPH_TRACE_H
+
+#include "httpmorph.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef HAVE_SYS_SDT
+    #include <sys/sdt.h>
+    #define HTTPMORPH_PROBE1(name, a) DTRACE_PROBE1(httpmorph, name, a)
+    #define HTTPMORPH_PROBE2(name, a, b) DTRACE_PROBE2(httpmorph, name, a, b)
+    #define HTTPMORPH_PROBE3(name, a, b, c) DTRACE_PROBE3(httpmorph, name, a, b, c)
+    #define HTTPMORPH_PROBE4(name, a, b, c, d) DTRACE_PROBE4(httpmorph, name, a, b, c, d)
+#else
+    #define HTTPMORPH_PROBE1(name, a) ((void)0)
+    #define HTTPMORPH_PROBE2(name, a, b) ((void)0)
+    #define HTTPMORPH_PROBE3(name, a, b, c) ((void)0)
+    #define HTTPMORPH_PROBE4(name, a, b, c, d) ((void)0)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Get a new request id (process-wide, starting at 1)
+ * Async requests use their manager's ids instead.
+ */
+uint64_t trace_next_request_id(void);
+
+/**
+ * Report a finished request
+ * Fires the request__done probe and, if a tracer is set, emits its spans.
+ * @param response Its response, or NULL if none could be created
+ */
+void trace_request(uint64_t request_id, const httpmorph_request_t *request,
+                   const httpmorph_response_t *response);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HTTPMORPH_TRACE_H */
@@ -3,6 +3,7 @@
  */
 
 #include "internal/url.h"
+#include <ctype.h>
 
 /**
  * Parse a URL into its components
@@ -65,3 +66,149 @@ int httpmorph_parse_url(const char *url, char **scheme, char **host,
 
     return 0;
 }
+
+/* Helper: Length of a URL's scheme including ':' (0 if it has none) */
+static size_t url_scheme_len(const char *url) {
+    if (!isalpha((unsigned char)url[0])) {
+        return 0;
+    }
+    size_t i = 1;
+    while (isalnum((unsigned char)url[i]) || url[i] == '+' || url[i] == '-' || url[i] == '.') {
+        i++;
+    }
+    return url[i] == ':' ? i + 1 : 0;
+}
+
+/* Helper: Remove "." and ".." segments from a path starting with '/' in
+ * place (RFC 3986 section 5.2.4) */
+static void url_remove_dot_segments(char *path) {
+    char *out = path;
+    const char *in = path;
+
+    while (*in) {
+        const char *segment = in + 1;
+        size_t segment_len = strcspn(segment, "/");
+        bool last = segment[segment_len] == '\0';
+
+        if (segment_len == 1 && segment[0] == '.') {
+            if (last) {
+                *out++ = '/';
+            }
+        } else if (segment_len == 2 && segment[0] == '.' && segment[1] == '.') {
+            while (out > path && *--out != '/') {
+            }
+            if (last) {
+                *out++ = '/';
+            }
+        } else {
+            memmove(out, in, segment_len + 1);
+            out += segment_len + 1;
+        }
+        in = segment + segment_len;
+    }
+    *out = '\0';
+}
+
+/**
+ * Resolve a reference (e.g. a Location header) against a base URL
+ */
+char* httpmorph_resolve_url(const char *base, const char *reference) {
+    if (!base || !reference) {
+        return NULL;
+    }
+
+    /* Fragments are never sent */
+    size_t ref_len = strcspn(reference, "#");
+    size_t base_len = strcspn(base, "#");
+    size_t scheme_len = url_scheme_len(base);
+    if (scheme_len == 0 || strncmp(base + scheme_len, "//", 2) != 0) {
+        return NULL;
+    }
+    const char *authority = base + scheme_len + 2;
+    size_t authority_len = strcspn(authority, "/?#");
+    const char *base_path = authority + authority_len;
+    size_t base_path_len = strcspn(base_path, "?#");
+
+    /* Room for every part plus a separating '/' */
+    size_t cap = base_len + ref_len + 3;
+    char *url = malloc(cap);
+    if (!url) {
+        return NULL;
+    }
+
+    if (url_scheme_len(reference) > 0) {
+        memcpy(url, reference, ref_len);
+        url[ref_len] = '\0';
+        return url;
+    }
+
+    /* Scheme and authority come from the base unless the reference has one */
+    size_t len;
+    const char *rest = reference;
+    size_t rest_len = ref_len;
+    if (strncmp(reference, "//", 2) == 0) {
+        memcpy(url, base, scheme_len);
+        len = scheme_len;
+        size_t ref_authority = 2 + strcspn(reference + 2, "/?#");
+        if (ref_authority > ref_len) {
+            ref_authority = ref_len;
+        }
+        memcpy(url + len, reference, ref_authority);
+        len += ref_authority;
+        rest += ref_authority;
+        rest_len -= ref_authority;
+    } else {
+        len = scheme_len + 2 + authority_len;
+        memcpy(url, base, len);
+    }
+    size_t path_start = len;
+
+    if (rest == reference && rest_len == 0) {
+        /* Same document: the base without its fragment */
+        memcpy(url + len, base_path, base_len - (size_t)(base_path - base));
+        len += base_len - (size_t)(base_path - base);
+    } else if (rest == reference && rest[0] == '?') {
+        memcpy(url + len, base_path, base_path_len);
+        len += base_path_len;
+        memcpy(url + len, rest, rest_len);
+        len += rest_len;
+    } else if (rest[0] == '/' || rest != reference) {
+        memcpy(url + len, rest, rest_len);
+        len += rest_len;
+    } else {
+        /* Relative path: replace the last segment of the base path */
+        const char *slash = NULL;
+        for (size_t i = base_path_len; i-- > 0;) {
+            if (base_path[i] == '/') {
+                slash = base_path + i;
+                break;
+            }
+        }
+        if (slash) {
+            size_t dir_len = (size_t)(slash - base_path) + 1;
+            memcpy(url + len, base_path, dir_len);
+            len += dir_len;
+        } else {
+            url[len++] = '/';
+        }
+        memcpy(url + len, rest, rest_len);
+        len += rest_len;
+    }
+    url[len] = '\0';
+
+    /* A bare authority gets "/"; the path (not the query) is normalized */
+    if (url[path_start] != '/') {
+        memmove(url + path_start + 1, url + path_start, len - path_start + 1);
+        url[path_start] = '/';
+        len++;
+    }
+    size_t path_len = strcspn(url + path_start, "?");
+    char saved = url[path_start + path_len];
+    url[path_start + path_len] = '\0';
+    url_remove_dot_segments(url + path_start);
+    size_t normalized_len = strlen(url + path_start);
+    url[path_start + path_len] = saved;
+    memmove(url + path_start + normalized_len, url + path_start + path_len,
+            len - path_start - path_len + 1);
+    return url;
+}
@@ -3,6 +3,11 @@
  */
 
 #include "internal/util.h"
+#include <ctype.h>
+
+#ifdef _WIN32
+    #include <io.h>  /* _get_osfhandle */
+#endif
 
 /**
  * Get current time in microseconds
@@ -55,3 +60,133 @@ char* httpmorph_base64_encode(const char *input, size_t length) {
     output[output_length] = '\0';
     return output;
 }
+
+/**
+ * Read from a file at an offset without moving its file position
+ */
+int64_t httpmorph_file_read_at(int fd, void *buf, size_t len, uint64_t offset) {
+#ifdef _WIN32
+    HANDLE file = (HANDLE)_get_osfhandle(fd);
+    if (file == INVALID_HANDLE_VALUE) {
+        return -1;
+    }
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD)(offset & 0xFFFFFFFFu);
+    ov.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD got = 0;
+    DWORD want = len > 0x40000000u ? 0x40000000u : (DWORD)len;
+    if (!ReadFile(file, buf, want, &got, &ov)) {
+        return GetLastError() == ERROR_HANDLE_EOF ? 0 : -1;
+    }
+    return (int64_t)got;
+#else
+    ssize_t got;
+    do {
+        got = pread(fd, buf, len, (off_t)offset);
+    } while (got < 0 && errno == EINTR);
+    return (int64_t)got;
+#endif
+}
+
+/* Helper: Days from 1970-01-01 to a civil date (proleptic Gregorian) */
+static int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+/* Helper: Leading digits of a token (at most max); -1 if fewer than min */
+static int date_digits(const char *s, size_t len, size_t min, size_t max, size_t *used) {
+    size_t i = 0;
+    int value = 0;
+    while (i < len && i < max && s[i] >= '0' && s[i] <= '9') {
+        value = value * 10 + (s[i] - '0');
+        i++;
+    }
+    if (i < min) {
+        return -1;
+    }
+    *used = i;
+    return value;
+}
+
+/**
+ * Parse an HTTP or cookie date
+ * Follows the RFC 6265 section 5.1.1 algorithm, which accepts all three
+ * HTTP date formats: tokens are classified as time, day, month or year.
+ */
+int64_t httpmorph_parse_http_date(const char *value, size_t len) {
+    static const char months[] = "janfebmaraprmayjunjulaugsepoctnovdec";
+    int hour = -1, minute = -1, second = -1, day = -1, month = -1, year = -1;
+
+    size_t i = 0;
+    while (i < len) {
+        /* Delimiters are everything but digits, letters and ':' */
+        while (i < len && !isalnum((unsigned char)value[i]) && value[i] != ':') {
+            i++;
+        }
+        size_t start = i;
+        while (i < len && (isalnum((unsigned char)value[i]) || value[i] == ':')) {
+            i++;
+        }
+        const char *tok = value + start;
+        size_t tok_len = i - start;
+        if (tok_len == 0) {
+            continue;
+        }
+
+        size_t used = 0, used2 = 0, used3 = 0;
+        int n;
+        if (hour < 0 && (n = date_digits(tok, tok_len, 1, 2, &used)) >= 0 &&
+            used < tok_len && tok[used] == ':') {
+            int m = date_digits(tok + used + 1, tok_len - used - 1, 1, 2, &used2);
+            size_t at = used + 1 + used2;
+            if (m >= 0 && at < tok_len && tok[at] == ':') {
+                int sec = date_digits(tok + at + 1, tok_len - at - 1, 1, 2, &used3);
+                if (sec >= 0) {
+                    hour = n;
+                    minute = m;
+                    second = sec;
+                    continue;
+                }
+            }
+        }
+        if (day < 0 && (n = date_digits(tok, tok_len, 1, 2, &used)) >= 0 &&
+            (used == tok_len || !isdigit((unsigned char)tok[used]))) {
+            day = n;
+            continue;
+        }
+        if (month < 0 && tok_len >= 3) {
+            for (int mi = 0; mi < 12; mi++) {
+                if (strncasecmp(tok, months + mi * 3, 3) == 0) {
+                    month = mi + 1;
+                    break;
+                }
+            }
+            if (month > 0) {
+                continue;
+            }
+        }
+        if (year < 0 && (n = date_digits(tok, tok_len, 2, 4, &used)) >= 0 &&
+            (used == tok_len || !isdigit((unsigned char)tok[used]))) {
+            year = n;
+        }
+    }
+
+    if (year >= 70 && year <= 99) {
+        year += 1900;
+    } else if (year >= 0 && year <= 69) {
+        year += 2000;
+    }
+    if (hour < 0 || day < 1 || day > 31 || month < 1 || year < 1601 ||
+        hour > 23 || minute > 59 || second > 59) {
+        return -1;
+    }
+
+    return days_from_civil(year, (unsigned)month, (unsigned)day) * 86400 +
+           hour * 3600 + minute * 60 + second;
+}
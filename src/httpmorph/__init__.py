@@ -21,25 +21,33 @@ __license__ = "MIT"
 # Import C implementation (required - no fallback!)
 from httpmorph._client_c import (
     HAS_C_EXTENSION,
+    Cache,
     Client,
     ConnectionError,
     HTTPError,
     PreparedRequest,
+    ProxySet,
     Request,
     RequestException,
     Response,
     Session,
+    StreamingResponse,
     Timeout,
     TooManyRedirects,
     cleanup,
     delete,
+    dns_cache_stats,
     get,
     head,
     init,
+    open_shared_cache,
     options,
     patch,
     post,
     put,
+    set_dns_servers,
+    set_tracer,
+    shared_cache_stats,
     version,
 )
 
@@ -76,7 +84,10 @@ __all__ = [
     # Sync API
     "Client",
     "Session",
+    "Cache",
+    "ProxySet",
     "Response",
+    "StreamingResponse",
     "Request",
     "PreparedRequest",
     "get",
@@ -98,6 +109,11 @@ __all__ = [
     # Utilities
     "init",
     "cleanup",
+    "set_dns_servers",
+    "set_tracer",
+    "dns_cache_stats",
+    "open_shared_cache",
+    "shared_cache_stats",
     "version",
     # Feature flags
     "HAS_HTTP2",
@@ -6,9 +6,21 @@ Uses C-level I/O engine (kqueue/epoll) for non-blocking operations.
 """
 
 import asyncio
+import collections
+import functools
+import json as _json
+import threading
 from datetime import timedelta
 from http.client import responses as http_responses
 
+# Try to import orjson: it parses straight from the body buffer
+try:
+    import orjson
+
+    HAS_ORJSON = True
+except ImportError:
+    HAS_ORJSON = False
+
 # Try to import the async bindings
 try:
     from httpmorph import _async as _async_bindings
@@ -18,6 +30,9 @@ except ImportError:
     _async_bindings = None
     HAS_ASYNC_BINDINGS = False
 
+# Scheduler classes for the priority= request option (lower starts first)
+_PRIORITIES = {"high": 0, "normal": 1, "low": 2}
+
 
 class AsyncResponse:
     """Response object for async requests (similar to sync Response)"""
@@ -25,7 +40,8 @@ class AsyncResponse:
     def __init__(self, response_dict: dict, url: str):
         self.status_code = response_dict["status_code"]
         self.headers = response_dict["headers"]
-        self.body = response_dict["body"]
+        # bytes, or a buffer object holding the C response buffer
+        self._body = response_dict["body"]
         self.url = url
 
         # Store raw http_version enum for lazy formatting
@@ -33,11 +49,18 @@ class AsyncResponse:
         self._http_version = None
 
         # Timing information (in microseconds)
+        self.queue_time_us = response_dict.get("queue_time_us", 0)
+        self.dns_time_us = response_dict.get("dns_time_us", 0)
         self.connect_time_us = response_dict["connect_time_us"]
         self.tls_time_us = response_dict["tls_time_us"]
         self.first_byte_time_us = response_dict["first_byte_time_us"]
         self.total_time_us = response_dict["total_time_us"]
 
+        # Connection information
+        self.connection_reused = response_dict.get("connection_reused", False)
+        self.tls_resumed = response_dict.get("tls_resumed", False)
+        self.body_wire_len = response_dict.get("body_wire_len", 0)
+
         # TLS information
         self.tls_version = response_dict["tls_version"]
         self.tls_cipher = response_dict["tls_cipher"]
@@ -51,6 +74,9 @@ class AsyncResponse:
         self.error = response_dict["error"]
         self.error_message = response_dict["error_message"]
 
+        # Responses of the redirects followed to get here, oldest first
+        self.history = []
+
     def _format_http_version(self, version_enum):
         """Convert HTTP version enum to string"""
         version_map = {
@@ -68,6 +94,26 @@ class AsyncResponse:
             self._http_version = self._format_http_version(self._http_version_enum)
         return self._http_version
 
+    @property
+    def body(self):
+        """Body as bytes (copied out of the C buffer on first access)"""
+        body = self._body
+        if body is not None and not isinstance(body, bytes):
+            body = self._body = bytes(body)
+        return body
+
+    @body.setter
+    def body(self, value):
+        self._body = value
+
+    @property
+    def body_view(self):
+        """Read-only memoryview of the body, without copying it"""
+        body = self._body
+        if body is None:
+            body = self.body or b""
+        return memoryview(body)
+
     @property
     def content(self):
         """Alias for body (requests compatibility)"""
@@ -77,23 +123,30 @@ class AsyncResponse:
     def text(self):
         """Decode body as text (lazy evaluation)"""
         if self._text is None:
+            view = self.body_view
             try:
-                self._text = self.body.decode("utf-8")
-            except (UnicodeDecodeError, AttributeError):
-                self._text = self.body.decode("latin-1", errors="replace") if self.body else ""
+                self._text = str(view, "utf-8")
+            except UnicodeDecodeError:
+                self._text = str(view, "latin-1", errors="replace")
         return self._text
 
     def json(self, **kwargs):
-        """Decode body as JSON (lazy evaluation)"""
+        """Decode body as JSON (lazy evaluation with orjson if available)"""
         if self._json is None:
-            import json
-
-            if not self.body:
+            if not self.body_view:
                 raise ValueError("No JSON content in response")
-            try:
-                self._json = json.loads(self.text)
-            except json.JSONDecodeError as e:
-                raise ValueError(f"Invalid JSON: {e}") from e
+
+            if HAS_ORJSON:
+                # Parses the C buffer in place: no bytes or str copy
+                try:
+                    self._json = orjson.loads(self.body_view)
+                except orjson.JSONDecodeError as e:
+                    raise ValueError(f"Invalid JSON: {e}") from e
+            else:
+                try:
+                    self._json = _json.loads(self.text)
+                except _json.JSONDecodeError as e:
+                    raise ValueError(f"Invalid JSON: {e}") from e
         return self._json
 
     @property
@@ -126,6 +179,327 @@ class AsyncResponse:
         return self
 
 
+# Chunks a streamed body may buffer ahead of the consumer before the
+# engine stops reading from the socket
+_STREAM_QUEUE_DEPTH = 4
+
+
+def _raise_for_error(response_dict):
+    """Map a C error code in a response dict to an exception"""
+    error_code = response_dict.get("error")
+    if not error_code:
+        return
+    error_msg = response_dict.get("error_message") or "Request failed"
+
+    # Map error codes to exceptions (negative values in C)
+    if error_code == -5:  # HTTPMORPH_ERROR_TIMEOUT
+        raise asyncio.TimeoutError(error_msg)
+    elif error_code == -3:  # HTTPMORPH_ERROR_NETWORK
+        from httpmorph._client_c import ConnectionError
+
+        raise ConnectionError(error_msg)
+    elif error_code == -9:  # HTTPMORPH_ERROR_TOO_MANY_REDIRECTS
+        from httpmorph._client_c import TooManyRedirects
+
+        raise TooManyRedirects(error_msg)
+    else:
+        from httpmorph._client_c import RequestException
+
+        raise RequestException(error_msg)
+
+
+class _AsyncBodySink:
+    """Receives a streamed body from the C engine
+
+    on_head()/on_chunk() run on the manager's event thread. Once
+    _STREAM_QUEUE_DEPTH chunks are waiting, the engine is told to pause and
+    the consumer resumes it after draining them.
+    """
+
+    def __init__(self, loop):
+        self._loop = loop
+        self._lock = threading.Lock()
+        self._chunks = collections.deque()
+        self._wakeup = asyncio.Event()
+        self._closed = False
+        self.head = loop.create_future()
+        self.paused = False
+        self.request_id = 0
+        self.exception = None
+
+    def _set_head(self, head):
+        if not self.head.done():
+            self.head.set_result(head)
+
+    def on_head(self, head):
+        self._loop.call_soon_threadsafe(self._set_head, head)
+        return 0
+
+    def on_chunk(self, data):
+        with self._lock:
+            if self._closed:
+                return -1
+            self._chunks.append(data)
+            rc = 0
+            if len(self._chunks) >= _STREAM_QUEUE_DEPTH:
+                self.paused = True
+                rc = _async_bindings.BODY_PAUSE
+        self._loop.call_soon_threadsafe(self._wakeup.set)
+        return rc
+
+    def pop(self, manager):
+        """Take the next buffered chunk (None if empty), resuming the engine when drained"""
+        resume = False
+        with self._lock:
+            data = self._chunks.popleft() if self._chunks else None
+            if self.paused and not self._chunks:
+                self.paused = False
+                resume = True
+            if data is None:
+                self._wakeup.clear()
+        # Outside the lock: the event thread takes it while holding the request
+        if resume:
+            manager.resume_request(self.request_id)
+        return data
+
+    def close(self, manager):
+        """Make the next delivery abort the transfer"""
+        with self._lock:
+            self._closed = True
+            self._chunks.clear()
+            resume = self.paused
+            self.paused = False
+        if resume:
+            manager.resume_request(self.request_id)
+
+
+class _AsyncBodySource:
+    """Streams a request body to the C engine from an (async) iterator
+
+    A task on the event loop pulls chunks ahead of the upload, holding at
+    most _STREAM_QUEUE_DEPTH. read() runs on the manager's event thread and
+    returns None while nothing is buffered, which pauses the request until
+    the task has more.
+    """
+
+    def __init__(self, loop, data):
+        self._loop = loop
+        self._lock = threading.Lock()
+        self._chunks = collections.deque()
+        self._space = asyncio.Event()
+        self._done = False
+        self._paused = False
+        self._manager = None
+        self.request_id = 0
+        self.exception = None
+        self._task = loop.create_task(self._fill(data))
+
+    async def _fill(self, data):
+        try:
+            if hasattr(data, "__aiter__"):
+                async for chunk in data:
+                    await self._put(chunk)
+            else:
+                for chunk in data:
+                    await self._put(chunk)
+        except Exception as e:
+            self.exception = e
+        finally:
+            with self._lock:
+                self._done = True
+            self._resume()
+
+    async def _put(self, chunk):
+        if isinstance(chunk, str):
+            chunk = chunk.encode("utf-8")
+        if not chunk:
+            return
+        while True:
+            with self._lock:
+                if len(self._chunks) < _STREAM_QUEUE_DEPTH:
+                    self._chunks.append(bytes(chunk))
+                    break
+                self._space.clear()
+            await self._space.wait()
+        self._resume()
+
+    def _resume(self):
+        """Wake a paused request (outside the lock, like _AsyncBodySink.pop)"""
+        with self._lock:
+            resume = self._paused and self._manager is not None
+            if resume:
+                self._paused = False
+        if resume:
+            self._manager.resume_request(self.request_id)
+
+    def bind(self, manager, request_id):
+        """Called once the request is submitted; resumes it if data is waiting"""
+        with self._lock:
+            self._manager = manager
+            self.request_id = request_id
+            pending = self._chunks or self._done
+        if pending:
+            self._resume()
+
+    def read(self, n):
+        with self._lock:
+            if self.exception is not None:
+                raise self.exception
+            if not self._chunks:
+                if self._done:
+                    return b""
+                self._paused = True
+                return None
+            chunk = self._chunks.popleft()
+            if len(chunk) > n:
+                self._chunks.appendleft(chunk[n:])
+                chunk = chunk[:n]
+        self._loop.call_soon_threadsafe(self._space.set)
+        return chunk
+
+    def close(self):
+        """Stop pulling chunks once the request has finished"""
+        if not self._task.done():
+            self._task.cancel()
+
+
+class AsyncStreamingResponse(AsyncResponse):
+    """Response returned by AsyncClient.stream(); the body is read on demand"""
+
+    def __init__(self, head: dict, url: str, sink, task, manager):
+        response_dict = {
+            "body": b"",
+            "queue_time_us": 0,
+            "dns_time_us": 0,
+            "connect_time_us": 0,
+            "tls_time_us": 0,
+            "first_byte_time_us": 0,
+            "total_time_us": 0,
+            "connection_reused": False,
+            "tls_resumed": False,
+            "body_wire_len": 0,
+            "tls_version": None,
+            "tls_cipher": None,
+            "ja3_fingerprint": None,
+            "error": 0,
+            "error_message": None,
+        }
+        response_dict.update(head)
+        super().__init__(response_dict, url)
+        self._sink = sink
+        self._task = task
+        self._manager = manager
+        self._consumed = False
+        task.add_done_callback(lambda _: sink._wakeup.set())
+
+    async def aiter_raw(self):
+        """Yield body chunks as received from the connection"""
+        if self._consumed:
+            raise RuntimeError("The content for this response was already consumed")
+        self._consumed = True
+
+        while True:
+            data = self._sink.pop(self._manager)
+            if data is not None:
+                yield data
+                continue
+            if self._task.done():
+                break
+            await self._sink._wakeup.wait()
+
+        self._finish(self._task.result())
+
+    async def aiter_bytes(self, chunk_size=None):
+        """Yield the body in chunks of chunk_size bytes (as received if None)"""
+        if chunk_size is None:
+            async for data in self.aiter_raw():
+                yield data
+            return
+
+        pending = bytearray()
+        async for data in self.aiter_raw():
+            pending += data
+            while len(pending) >= chunk_size:
+                yield bytes(pending[:chunk_size])
+                del pending[:chunk_size]
+        if pending:
+            yield bytes(pending)
+
+    async def aread(self):
+        """Read the rest of the body into memory"""
+        self.body = b"".join([data async for data in self.aiter_raw()])
+        return self.body
+
+    def _finish(self, response_dict):
+        for key in (
+            "queue_time_us",
+            "dns_time_us",
+            "connect_time_us",
+            "tls_time_us",
+            "first_byte_time_us",
+            "total_time_us",
+            "connection_reused",
+            "tls_resumed",
+            "body_wire_len",
+            "tls_version",
+            "tls_cipher",
+            "ja3_fingerprint",
+            "error",
+            "error_message",
+        ):
+            setattr(self, key, response_dict[key])
+        _raise_for_error(response_dict)
+
+    async def aclose(self):
+        """Abort an unread body and wait for the request to finish"""
+        self._consumed = True
+        if self._task.done():
+            return
+        self._sink.close(self._manager)
+        try:
+            await self._task
+        except Exception:
+            pass  # Aborted on purpose
+
+
+class _AsyncStreamContext:
+    """async with client.stream(...) as response"""
+
+    def __init__(self, client, method, url, kwargs):
+        self._client = client
+        self._method = method
+        self._url = url
+        self._kwargs = kwargs
+        self._response = None
+
+    async def __aenter__(self):
+        client = self._client
+        sink = _AsyncBodySink(client._loop)
+        submit = client._submit_kwargs(self._url, self._kwargs)
+        task = client._loop.create_task(
+            client._manager.submit_request(
+                method=self._method,
+                chunk_size=self._kwargs.get("chunk_size") or 0,
+                body_sink=sink,
+                **submit,
+            )
+        )
+
+        await asyncio.wait({task, sink.head}, return_when=asyncio.FIRST_COMPLETED)
+        if not sink.head.done():
+            # Finished or failed before any header arrived
+            _raise_for_error(await task)
+            raise RuntimeError("Request completed without a response head")
+
+        self._response = AsyncStreamingResponse(
+            sink.head.result(), self._url, sink, task, client._manager
+        )
+        return self._response
+
+    async def __aexit__(self, exc_type, exc_val, exc_tb):
+        await self._response.aclose()
+
+
 class AsyncClient:
     """
     HTTP client with true async I/O (no thread pool)
@@ -137,6 +511,7 @@ class AsyncClient:
     - ✅ I/O engine with epoll/kqueue
     - ✅ Async request manager
     - ✅ Python asyncio bindings
+    - ✅ Event-driven completions (C event thread, one fd per client)
     - ⏳ DNS resolution (uses blocking for now)
 
     Usage:
@@ -145,13 +520,62 @@ class AsyncClient:
             print(response.status_code)
     """
 
-    def __init__(self, http2: bool = False, timeout: float = 30.0):
+    def __init__(
+        self,
+        http2: bool = False,
+        timeout: float = 30.0,
+        io_uring: bool = False,
+        sqpoll: bool = False,
+        shards: int = 1,
+        max_per_origin: int = None,
+        max_concurrency: int = None,
+        rate_limit: float = None,
+        rate_burst: int = None,
+        hedge=None,
+        early_data: bool = False,
+        tcp_fast_open: bool = False,
+        ktls: bool = False,
+        memory_budget: int = None,
+    ):
         """
         Initialize AsyncClient
 
         Args:
             http2: Enable HTTP/2 support (not yet implemented)
             timeout: Default timeout in seconds
+            io_uring: Drive sockets with io_uring (Linux; falls back to epoll)
+            sqpoll: With io_uring, let a kernel thread poll the submission queue
+            shards: Event threads driving requests (0 for one per CPU);
+                requests to one host stay on one thread, idle threads take
+                queued requests from busy ones
+            max_per_origin: Requests in flight per origin (scheme, host,
+                port); extra requests wait instead of opening connections
+            max_concurrency: Requests in flight across all origins
+            rate_limit: Requests started per second per origin
+            rate_burst: Requests an idle origin may start at once
+            hedge: Send slow GET, HEAD and OPTIONS requests a second time
+                once their origin's first-byte percentile passes without
+                a response byte; the first copy to answer wins. True for
+                the defaults, or a dict of percentile (95), min_delay_ms
+                (10), min_samples (20), budget (0.05 hedges per request)
+                and max_in_flight (unlimited)
+            early_data: Send GET, HEAD and OPTIONS requests without a body
+                as TLS 1.3 early data to origins with a cached session; a
+                request the server turns down is sent again after the
+                handshake
+            tcp_fast_open: Use TCP Fast Open for direct connections (Linux;
+                takes effect once the kernel holds a cookie for the server)
+            ktls: Let the kernel decrypt HTTPS bodies of 128 KB or more
+                (Linux with the tls module; other suites and kernels keep
+                decrypting in userspace)
+            memory_budget: Bytes all requests together may buffer for
+                responses; a request that would go over stops reading its
+                socket until others finish (one at a time may go over so
+                something always completes). Usage is in metrics()
+
+        Any of the limits (or set_origin_limits()) turns on the request
+        scheduler: waiting requests start as others finish, higher
+        priority= classes first and origins taking turns.
         """
         if not HAS_ASYNC_BINDINGS:
             raise RuntimeError(
@@ -161,13 +585,37 @@ class AsyncClient:
 
         self.http2 = http2
         self.timeout = timeout
+        self._io_options = {"io_uring": io_uring, "sqpoll": sqpoll, "shards": shards}
+        self._scheduler = None
+        if any(v is not None for v in (max_per_origin, max_concurrency, rate_limit, rate_burst)):
+            self._scheduler = {
+                "max_per_origin": max_per_origin or 0,
+                "max_total": max_concurrency or 0,
+                "rate": rate_limit or 0,
+                "burst": rate_burst or 0,
+            }
+        self._hedge = None
+        if hedge:
+            self._hedge = dict(hedge) if isinstance(hedge, dict) else {}
+        self._origin_limits = {}
+        self._zero_rtt = {"early_data": early_data, "tcp_fast_open": tcp_fast_open}
+        self._ktls = ktls
+        self._memory_budget = memory_budget
         self._manager = None
         self._loop = None
 
     async def __aenter__(self):
         """Async context manager entry"""
         # Create manager and set event loop
-        self._manager = _async_bindings.create_async_manager()
+        self._manager = _async_bindings.create_async_manager(**self._io_options)
+        if self._scheduler is not None:
+            self._manager.set_scheduler(**self._scheduler)
+        for origin, limits in self._origin_limits.items():
+            self._manager.set_origin_limits(origin, *limits)
+        if self._hedge is not None:
+            self._manager.set_hedging(**self._hedge)
+        if self._memory_budget:
+            self._manager.set_memory_budget(self._memory_budget)
         self._loop = asyncio.get_running_loop()
         self._manager.set_event_loop(self._loop)
         return self
@@ -176,13 +624,103 @@ class AsyncClient:
         """Async context manager exit"""
         await self.close()
 
+    def io_stats(self):
+        """
+        I/O engine statistics
+
+        Returns:
+            Dict with the engine name ("io_uring", "epoll", ...), the
+            ops_submitted/ops_completed/ops_failed counters, the shard
+            count and the steals between shards
+        """
+        if self._manager is None:
+            raise RuntimeError(
+                "Client not initialized. Use 'async with AsyncClient() as client:' pattern"
+            )
+        return self._manager.io_stats()
+
+    def set_origin_limits(self, origin: str, max_concurrent: int = 0, rate: float = 0,
+                          burst: int = 0):
+        """
+        Give one origin its own limits, turning on the scheduler
+
+        Args:
+            origin: Any URL on the origin (e.g. "https://api.example.com")
+            max_concurrent: Requests in flight (0 for the client default)
+            rate: Requests started per second (0 for the client default)
+            burst: Requests it may start at once after idling
+        """
+        limits = (max_concurrent, rate, burst)
+        self._origin_limits[origin] = limits
+        if self._manager is not None:
+            self._manager.set_origin_limits(origin, *limits)
+
+    def scheduler_stats(self):
+        """
+        Request scheduler counters
+
+        Returns:
+            Dict with queued, in_flight, origins, admitted and deferred
+            (requests that had to wait), or None when no limits are set
+        """
+        if self._manager is None:
+            raise RuntimeError(
+                "Client not initialized. Use 'async with AsyncClient() as client:' pattern"
+            )
+        return self._manager.scheduler_stats()
+
+    def hedge_stats(self):
+        """
+        Hedged request counters
+
+        Returns:
+            Dict with planned (requests given a hedge delay), launched, won
+            (hedges that answered first), denied (refused by the budget)
+            and in_flight, or None when hedging is off
+        """
+        if self._manager is None:
+            raise RuntimeError(
+                "Client not initialized. Use 'async with AsyncClient() as client:' pattern"
+            )
+        return self._manager.hedge_stats()
+
+    def metrics(self):
+        """
+        Snapshot of the client's request metrics
+
+        Returns:
+            Dict with requests, errors, connections_opened,
+            connections_reused, tls_handshakes, tls_resumed, http2_streams,
+            body_wire_bytes, body_bytes, the memory budget figures
+            (memory_limit, memory_in_use, memory_peak, memory_stalls) and
+            per-origin latency percentiles under 'origins', plus the 'io',
+            'scheduler' and 'hedging' stats
+        """
+        if self._manager is None:
+            raise RuntimeError(
+                "Client not initialized. Use 'async with AsyncClient() as client:' pattern"
+            )
+        snapshot = self._manager.metrics()
+        snapshot["io"] = self._manager.io_stats()
+        snapshot["scheduler"] = self._manager.scheduler_stats()
+        snapshot["hedging"] = self._manager.hedge_stats()
+        return snapshot
+
+    def reset_metrics(self):
+        """Zero the request metrics"""
+        if self._manager is not None:
+            self._manager.reset_metrics()
+
     async def get(self, url: str, **kwargs):
         """
         Make async GET request
 
         Args:
             url: URL to request
-            **kwargs: Additional request options (headers, timeout)
+            **kwargs: Additional request options (headers, timeout,
+                connect_timeout, tls_timeout, first_byte_timeout,
+                allow_redirects, max_redirects, early_data, tcp_fast_open,
+                ktls)
 
         Returns:
             AsyncResponse object
@@ -213,27 +751,139 @@ class AsyncClient:
         """Make async OPTIONS request"""
         return await self._request("OPTIONS", url, **kwargs)
 
-    async def _request(self, method: str, url: str, **kwargs):
+    async def preconnect(self, origins, per_host: int = 1, timeout: float = None,
+                         verify: bool = True):
         """
-        Internal async request implementation
+        Open connections to origins ahead of the requests that need them
 
-        This uses the C-level async I/O engine:
-        1. Create C async_request_t via manager
-        2. Get socket FD from async_request_get_fd()
-        3. Register FD with asyncio event loop (add_reader/add_writer)
-        4. Wait for I/O events without blocking
-        5. Step state machine on each event
-        6. Return response when complete
+        All connections are opened concurrently by the async engine (DNS,
+        connect, TLS handshake and its session tickets) and kept for up to
+        30 seconds; a request to the origin then sends on one instead of
+        connecting.
+
+        Args:
+            origins: URLs (only scheme, host and port are used)
+            per_host: Connections to open per origin
+            timeout: Timeout in seconds per connection (default: client timeout)
+            verify: Verify certificates (only requests with the same
+                setting take the connections)
+
+        Returns:
+            {origin: result} where result has ok, error, connections and
+            the first connection's dns_us, connect_us, tls_us and total_us
         """
         if self._manager is None:
             raise RuntimeError(
                 "Client not initialized. Use 'async with AsyncClient() as client:' pattern"
             )
+        origins = list(origins)
+        per_host = max(1, per_host)
+        timeout_ms = int((timeout if timeout is not None else self.timeout) * 1000)
+
+        async def connect(origin):
+            try:
+                return await self._manager.submit_preconnect(origin, timeout_ms, verify)
+            except Exception as e:
+                return e
+
+        attempts = [connect(origin) for origin in origins for _ in range(per_host)]
+        outcomes = await asyncio.gather(*attempts)
+
+        results = {}
+        for i, origin in enumerate(origins):
+            mine = outcomes[i * per_host:(i + 1) * per_host]
+            opened = [o for o in mine if isinstance(o, dict) and not o.get("error")]
+            result = {"ok": bool(opened), "error": None, "connections": len(opened)}
+            if opened:
+                first = opened[0]
+                result.update(
+                    dns_us=first["dns_time_us"],
+                    connect_us=first["connect_time_us"],
+                    tls_us=first["tls_time_us"],
+                    total_us=first["total_time_us"],
+                )
+            else:
+                failure = mine[0]
+                result["error"] = (
+                    failure if isinstance(failure, Exception)
+                    else failure.get("error_message") or failure.get("error")
+                )
+            results[origin] = result
+        return results
+
+    async def request_many(self, requests, concurrency: int = 8, ordered: bool = True):
+        """
+        Make many async requests with at most `concurrency` in flight
+
+        Every request goes to the C async engine at once the limit allows,
+        so the batch shares one event thread and its connections.
+
+        Args:
+            requests: Iterable of (method, url), (method, url, kwargs) or
+                dicts with "method" and "url" plus request kwargs
+            concurrency: Maximum requests in flight
+            ordered: True returns responses in input order; False returns
+                a list of (index, response) in completion order
+
+        Returns:
+            List of AsyncResponse objects (or (index, response) pairs)
+        """
+        limit = asyncio.Semaphore(max(1, concurrency))
+        completed = []
+
+        async def run(index, item):
+            if isinstance(item, dict):
+                kwargs = dict(item)
+                method = kwargs.pop("method", "GET")
+                url = kwargs.pop("url")
+            else:
+                method, url = item[0], item[1]
+                kwargs = dict(item[2]) if len(item) > 2 and item[2] else {}
+            async with limit:
+                response = await self._request(method, url, **kwargs)
+            completed.append((index, response))
+            return response
 
+        responses = await asyncio.gather(*(run(i, item) for i, item in enumerate(requests)))
+        return list(responses) if ordered else completed
+
+    def stream(self, method: str, url: str, **kwargs):
+        """
+        Stream a response body instead of buffering it
+
+        Usage:
+            async with client.stream("GET", url) as response:
+                async for chunk in response.aiter_bytes():
+                    ...
+
+        Args:
+            method: HTTP method
+            url: URL to request
+            **kwargs: Same options as get(), plus chunk_size (max bytes per
+                chunk read from the connection). The timeout covers the whole
+                transfer, including time spent paused for a slow consumer.
+
+        Returns:
+            Async context manager yielding an AsyncStreamingResponse
+        """
+        if self._manager is None:
+            raise RuntimeError(
+                "Client not initialized. Use 'async with AsyncClient() as client:' pattern"
+            )
+        return _AsyncStreamContext(self, method, url, kwargs)
+
+    def _submit_kwargs(self, url: str, kwargs: dict):
+        """Translate request options into AsyncRequestManager.submit_request() arguments"""
         # Get timeout (use default if not specified)
         timeout = kwargs.get("timeout", self.timeout)
         timeout_ms = int(timeout * 1000)
 
+        # Per-phase limits in seconds (None/0 for no limit beyond the total timeout)
+        phase_ms = {}
+        for name in ("connect_timeout", "tls_timeout", "first_byte_timeout"):
+            value = kwargs.get(name)
+            phase_ms[f"{name}_ms"] = int(value * 1000) if value else 0
+
         # Get headers
         headers = kwargs.get("headers", {})
 
@@ -260,37 +910,71 @@ class AsyncClient:
         if body and isinstance(body, str):
             body = body.encode("utf-8")
 
-        # Submit request to manager
-        response_dict = await self._manager.submit_request(
-            method=method,
-            url=url,
-            headers=headers,
-            body=body,
-            timeout_ms=timeout_ms,
-            verify=verify,
-            proxy=proxy,
-            proxy_auth=proxy_auth,
-        )
-
-        # Check for errors
-        if response_dict.get("error") and response_dict["error"] != 0:
-            error_msg = response_dict.get("error_message", "Request failed")
-            error_code = response_dict["error"]
-
-            # Map error codes to exceptions (negative values in C)
-            if error_code == -5:  # HTTPMORPH_ERROR_TIMEOUT
-                raise asyncio.TimeoutError(error_msg)
-            elif error_code == -3:  # HTTPMORPH_ERROR_NETWORK
-                from httpmorph._client_c import ConnectionError
+        # Iterators and async iterators are uploaded as they produce data
+        body_source = None
+        if body is not None and not isinstance(body, (bytes, bytearray, memoryview, dict)):
+            if hasattr(body, "read"):
+                body = iter(functools.partial(body.read, 65536), b"")
+            if hasattr(body, "__aiter__") or hasattr(body, "__iter__"):
+                body_source = _AsyncBodySource(self._loop or asyncio.get_running_loop(), body)
+                body = None
+
+        priority = kwargs.get("priority", "normal")
+        if isinstance(priority, str):
+            priority = _PRIORITIES[priority]
+
+        return {
+            "url": url,
+            "headers": headers,
+            "body": body,
+            "body_source": body_source,
+            "body_length": kwargs.get("body_length"),
+            "timeout_ms": timeout_ms,
+            "verify": verify,
+            "proxy": proxy,
+            "proxy_auth": proxy_auth,
+            "priority": priority,
+            "follow_redirects": bool(kwargs.get("allow_redirects", True)),
+            "max_redirects": kwargs.get("max_redirects", 10),
+            "early_data": bool(kwargs.get("early_data", self._zero_rtt["early_data"])),
+            "tcp_fast_open": bool(kwargs.get("tcp_fast_open", self._zero_rtt["tcp_fast_open"])),
+            "ktls": bool(kwargs.get("ktls", self._ktls)),
+            **phase_ms,
+        }
 
-                raise ConnectionError(error_msg)
-            else:
-                from httpmorph._client_c import RequestException
+    async def _request(self, method: str, url: str, **kwargs):
+        """
+        Internal async request implementation
 
-                raise RequestException(error_msg)
+        This uses the C-level async I/O engine:
+        1. Create C async_request_t via manager
+        2. Get socket FD from async_request_get_fd()
+        3. Register FD with asyncio event loop (add_reader/add_writer)
+        4. Wait for I/O events without blocking
+        5. Step state machine on each event
+        6. Return response when complete
+        """
+        if self._manager is None:
+            raise RuntimeError(
+                "Client not initialized. Use 'async with AsyncClient() as client:' pattern"
+            )
 
-        # Create response object
-        return AsyncResponse(response_dict, url)
+        # Submit request to manager
+        submit = self._submit_kwargs(url, kwargs)
+        response_dict = await self._manager.submit_request(method=method, **submit)
+
+        # Check for errors (an upload iterator's own exception first)
+        body_source = submit["body_source"]
+        if body_source is not None and body_source.exception is not None:
+            raise body_source.exception
+        _raise_for_error(response_dict)
+
+        # Create response object (redirects were followed by the C engine)
+        response = AsyncResponse(response_dict, response_dict.get("url") or url)
+        response.history = [
+            AsyncResponse(hop, hop.get("url") or url) for hop in response_dict.get("history", ())
+        ]
+        return response
 
     async def close(self):
         """Close client and cleanup resources"""
@@ -352,6 +1036,10 @@ Phase B Days 1-3: ✅ COMPLETE
    - Request ID generation
    - Event loop integration
    - Thread-safe operations
+   - Event-driven mode: the manager's event thread steps every request
+     through the I/O engine and queues finished ones; asyncio watches a
+     single eventfd/pipe and resolves futures in batches
+     (falls back to per-request polling on Windows ProactorEventLoop)
 
 Phase B Days 4-5: ⏳ IN PROGRESS
 
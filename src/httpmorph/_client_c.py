@@ -3,9 +3,13 @@ C-based HTTP client implementation using Cython bindings
 """
 
 import base64
+import codecs
+import concurrent.futures
 import io
 import json as _json
 import os
+import queue
+import stat
 import sys
 import threading
 import uuid
@@ -186,18 +190,33 @@ class Response:
     def __init__(self, c_response_dict, url=None):
         self.status_code = c_response_dict["status_code"]
         self.headers = c_response_dict["headers"]
-        self.body = c_response_dict["body"]
+        # bytes, or a buffer object still holding the C response buffer
+        self._body = c_response_dict["body"]
 
         # Store raw http_version enum for lazy formatting
         self._http_version_enum = c_response_dict["http_version"]
         self._http_version = None
 
         # Timing information (in microseconds)
+        self.queue_time_us = c_response_dict.get("queue_time_us", 0)
+        self.dns_time_us = c_response_dict.get("dns_time_us", 0)
         self.connect_time_us = c_response_dict["connect_time_us"]
         self.tls_time_us = c_response_dict["tls_time_us"]
         self.first_byte_time_us = c_response_dict["first_byte_time_us"]
         self.total_time_us = c_response_dict["total_time_us"]
 
+        # Connection information
+        self.connection_reused = c_response_dict.get("connection_reused", False)
+        self.tls_resumed = c_response_dict.get("tls_resumed", False)
+        self.body_wire_len = c_response_dict.get("body_wire_len", 0)
+
+        # HTTP/2 flow control (set when http2_adaptive_window=True)
+        self.http2_rtt_us = c_response_dict.get("http2_rtt_us", 0)
+        self.http2_window_size = c_response_dict.get("http2_window_size", 0)
+
+        # HTTP cache outcome: None, "miss", "hit" or "revalidated"
+        self.cache_status = c_response_dict.get("cache_status")
+
         # TLS information
         self.tls_version = c_response_dict["tls_version"]
         self.tls_cipher = c_response_dict["tls_cipher"]
@@ -231,6 +250,11 @@ class Response:
         }
         return version_map.get(version_enum, "1.1")
 
+    @property
+    def from_cache(self):
+        """True if the response came from the HTTP cache (hit or revalidated)"""
+        return self.cache_status in ("hit", "revalidated")
+
     @property
     def http_version(self):
         """Get HTTP version string (lazy evaluation)"""
@@ -238,6 +262,26 @@ class Response:
             self._http_version = self._format_http_version(self._http_version_enum)
         return self._http_version
 
+    @property
+    def body(self):
+        """Body as bytes (copied out of the C buffer on first access)"""
+        body = self._body
+        if body is not None and not isinstance(body, bytes):
+            body = self._body = bytes(body)
+        return body
+
+    @body.setter
+    def body(self, value):
+        self._body = value
+
+    @property
+    def body_view(self):
+        """Read-only memoryview of the body, without copying it"""
+        body = self._body
+        if body is None:
+            body = self.body or b""
+        return memoryview(body)
+
     @property
     def content(self):
         """Alias for body (requests compatibility)"""
@@ -247,22 +291,23 @@ class Response:
     def text(self):
         """Decode body as text (lazy evaluation)"""
         if self._text is None:
+            view = self.body_view
             try:
-                self._text = self.body.decode("utf-8")
-            except (UnicodeDecodeError, AttributeError):
-                self._text = self.body.decode("latin-1", errors="replace") if self.body else ""
+                self._text = str(view, "utf-8")
+            except UnicodeDecodeError:
+                self._text = str(view, "latin-1", errors="replace")
         return self._text
 
     def json(self, **kwargs):
         """Decode body as JSON (lazy evaluation with orjson if available)"""
         if self._json is None:
-            if not self.body:
+            if not self.body_view:
                 raise ValueError("No JSON content in response")
 
             if HAS_ORJSON:
                 # orjson.loads is 2-3x faster than json.loads
                 try:
-                    self._json = orjson.loads(self.body)
+                    self._json = orjson.loads(self.body_view)
                 except orjson.JSONDecodeError as e:
                     raise ValueError(f"Invalid JSON: {e}") from e
             else:
@@ -361,6 +406,420 @@ class Response:
                 yield line
 
 
+# HTTPMORPH_ERROR_ABORTED: the body consumer stopped the transfer
+_ERROR_ABORTED = -8
+
+# Chunks a streamed body may buffer ahead of the consumer
+_STREAM_QUEUE_DEPTH = 4
+
+
+# Request bodies that are sent from memory as they are
+_BUFFERED_BODY_TYPES = (bytes, bytearray, memoryview, str, dict, list, tuple)
+
+
+class _BodySource:
+    """Streams a request body from an iterator or file-like object
+
+    read(n) is called by the C core as the connection takes more data, on
+    the thread running the request.
+    """
+
+    def __init__(self, data):
+        self._read = data.read if hasattr(data, "read") else None
+        self._iter = None if self._read else iter(data)
+        self._pending = b""
+        self.exception = None
+
+    def read(self, n):
+        if self._read is not None:
+            data = self._read(n)
+            return data.encode("utf-8") if isinstance(data, str) else data
+        while not self._pending:
+            try:
+                chunk = next(self._iter)
+            except StopIteration:
+                return b""
+            self._pending = chunk.encode("utf-8") if isinstance(chunk, str) else chunk
+        data = self._pending[:n]
+        self._pending = self._pending[n:]
+        return data
+
+
+def _stream_body(kwargs):
+    """Turn a file or iterator passed as data into a streamed body
+
+    Regular files are sent by range from their current position (with
+    sendfile on plain HTTP/1.1); other files and iterators are read as the
+    upload goes, chunked unless body_length is given.
+    """
+    data = kwargs.get("data")
+    if data is None or isinstance(data, _BUFFERED_BODY_TYPES):
+        return
+    if not hasattr(data, "read") and not hasattr(data, "__iter__"):
+        return
+    kwargs.pop("data")
+
+    try:
+        fd = data.fileno()
+        st = os.fstat(fd)
+        position = data.tell()
+    except (AttributeError, OSError, ValueError, io.UnsupportedOperation):
+        fd = None
+    if fd is not None and stat.S_ISREG(st.st_mode):
+        # The file object stays in the tuple so it outlives the request
+        kwargs["body_file"] = (fd, position, max(st.st_size - position, 0), data)
+        return
+    kwargs["body_source"] = _BodySource(data)
+
+
+def _check_c_error(result):
+    """Raise the exception matching a C error code in a result dict"""
+    error_code = result.get("error")
+    if not error_code:
+        return
+    error_msg = result.get("error_message") or "Request failed"
+    # HTTPMORPH_ERROR_TIMEOUT = -5, HTTPMORPH_ERROR_NETWORK = -3
+    if error_code == -5:
+        raise Timeout(error_msg)
+    elif error_code == -3:
+        raise ConnectionError(error_msg)
+    raise RequestException(error_msg)
+
+
+class _BodyStream:
+    """Body sink for stream=True
+
+    The C request runs on a worker thread and hands the body over in chunks
+    through a bounded queue; when the consumer falls behind the transfer
+    blocks, so only a few chunks are ever held in memory.
+    """
+
+    _END = object()
+
+    def __init__(self, send, method, url, kwargs):
+        self._chunks = queue.Queue(_STREAM_QUEUE_DEPTH)
+        self._head = None
+        self._head_ready = threading.Event()
+        self._closed = False
+        self._done = False
+        self.result = None
+        self.exception = None
+        self._thread = threading.Thread(
+            target=self._run, args=(send, method, url, kwargs), daemon=True
+        )
+        self._thread.start()
+
+    def _run(self, send, method, url, kwargs):
+        try:
+            self.result = send(method, url, body_sink=self, **kwargs)
+        except BaseException as e:
+            self.exception = e
+        finally:
+            self._head_ready.set()
+            self._put(self._END)
+
+    def _put(self, item):
+        while not self._closed:
+            try:
+                self._chunks.put(item, timeout=0.1)
+                return True
+            except queue.Full:
+                pass
+        return False
+
+    def on_head(self, head):
+        """Called by the C core once the status line and headers are parsed"""
+        self._head = head
+        self._head_ready.set()
+
+    def on_chunk(self, data):
+        """Called by the C core for every body chunk (negative aborts)"""
+        return 0 if self._put(data) else -1
+
+    def wait_head(self):
+        """Block until the head is known and return it as a result dict"""
+        self._head_ready.wait()
+        if self._head is None:
+            # Failed (or finished) before any header arrived
+            self._thread.join()
+            if self.exception is not None:
+                raise self.exception
+            return self.result
+
+        result = {
+            "body": None,
+            "queue_time_us": 0,
+            "dns_time_us": 0,
+            "connect_time_us": 0,
+            "tls_time_us": 0,
+            "first_byte_time_us": 0,
+            "total_time_us": 0,
+            "connection_reused": False,
+            "tls_resumed": False,
+            "body_wire_len": 0,
+            "http2_rtt_us": 0,
+            "http2_window_size": 0,
+            "tls_version": None,
+            "tls_cipher": None,
+            "ja3_fingerprint": None,
+            "error": 0,
+            "error_message": None,
+        }
+        result.update(self._head)
+        return result
+
+    @property
+    def streaming(self):
+        """True once headers arrived and the body is being streamed"""
+        return self._head is not None
+
+    def __iter__(self):
+        """Yield body chunks as they arrive"""
+        while not self._done:
+            data = self._chunks.get()
+            if data is self._END:
+                self._done = True
+                break
+            yield data
+
+    def close(self):
+        """Abort an unfinished transfer and wait for the worker to exit"""
+        self._closed = True
+        while True:
+            try:
+                self._chunks.get_nowait()
+            except queue.Empty:
+                break
+        self._thread.join()
+        self._done = True
+
+
+def _send(send, method, url, stream, kwargs):
+    """Execute one request, returning (result, body_stream)
+
+    With stream=True the call returns as soon as headers arrive and the body
+    is read through the returned _BodyStream.
+    """
+    if not stream:
+        return send(method, url, **kwargs), None
+    body = _BodyStream(send, method, url, kwargs)
+    result = body.wait_head()
+    return result, (body if body.streaming else None)
+
+
+def _make_response(result, body_stream, url):
+    """Wrap a result dict from _send() in the matching response class"""
+    if body_stream is not None:
+        return StreamingResponse(result, body_stream, url=url)
+    return Response(result, url=result.get("url") or url)
+
+
+def _redirect_history(result, url):
+    """Wrap the redirect hops the C core followed, oldest first"""
+    return [Response(hop, url=hop.get("url") or url) for hop in result.get("history", ())]
+
+
+class StreamingResponse(Response):
+    """Response whose body is read from the connection on demand (stream=True)"""
+
+    def __init__(self, c_response_dict, body_stream, url=None):
+        self._stream = body_stream
+        self._consumed = False
+        super().__init__(c_response_dict, url=url)
+
+    @property
+    def body(self):
+        """Read the rest of the body into memory (loads the whole body)"""
+        if self._body is None:
+            self._body = b"".join(self._read())
+        return self._body
+
+    @body.setter
+    def body(self, value):
+        self._body = value
+
+    def _read(self):
+        """Yield raw chunks from the connection (single pass)"""
+        if self._consumed:
+            raise RuntimeError("The content for this response was already consumed")
+        self._consumed = True
+        yield from self._stream
+        self._finish()
+
+    def _finish(self):
+        """Pick up timings and errors from the completed transfer"""
+        stream = self._stream
+        stream.close()
+        if stream.exception is not None:
+            raise stream.exception
+        result = stream.result or {}
+        for key in (
+            "queue_time_us",
+            "dns_time_us",
+            "connect_time_us",
+            "tls_time_us",
+            "first_byte_time_us",
+            "total_time_us",
+            "connection_reused",
+            "tls_resumed",
+            "body_wire_len",
+            "http2_rtt_us",
+            "http2_window_size",
+            "tls_version",
+            "tls_cipher",
+            "ja3_fingerprint",
+            "error",
+            "error_message",
+        ):
+            if key in result:
+                setattr(self, key, result[key])
+        if self.error != _ERROR_ABORTED:
+            _check_c_error(result)
+
+    def iter_content(self, chunk_size=1, decode_unicode=False):
+        """Iterate over the body as it arrives
+
+        chunk_size=None yields chunks as received from the connection.
+        """
+        if self._body is not None:
+            yield from super().iter_content(chunk_size or len(self._body) or 1, decode_unicode)
+            return
+
+        decoder = None
+        if decode_unicode:
+            decoder = codecs.getincrementaldecoder(self.encoding or "utf-8")(errors="replace")
+
+        pending = bytearray()
+        for data in self._read():
+            if chunk_size is None:
+                yield decoder.decode(data) if decoder else data
+                continue
+            pending += data
+            while len(pending) >= chunk_size:
+                chunk = bytes(pending[:chunk_size])
+                del pending[:chunk_size]
+                yield decoder.decode(chunk) if decoder else chunk
+
+        if pending:
+            yield decoder.decode(bytes(pending), final=True) if decoder else bytes(pending)
+        elif decoder:
+            tail = decoder.decode(b"", final=True)
+            if tail:
+                yield tail
+
+    def iter_lines(self, chunk_size=512, decode_unicode=False, delimiter=None):
+        """Iterate over body lines as they arrive"""
+        if self._body is not None:
+            yield from super().iter_lines(chunk_size, decode_unicode, delimiter)
+            return
+
+        pending = None
+        for chunk in self.iter_content(chunk_size, decode_unicode):
+            if pending is not None:
+                chunk = pending + chunk
+            lines = chunk.split(delimiter) if delimiter else chunk.splitlines()
+            # Hold back a trailing partial line until the next chunk
+            if lines and lines[-1] and chunk and lines[-1][-1] == chunk[-1]:
+                pending = lines.pop()
+            else:
+                pending = None
+            for line in lines:
+                if line:
+                    yield line
+
+        if pending:
+            yield pending
+
+    def close(self):
+        """Release the connection, aborting an unread body"""
+        self._consumed = True
+        self._stream.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.close()
+
+    def __del__(self):
+        # Don't join from a finalizer - just unblock the worker
+        stream = getattr(self, "_stream", None)
+        if stream is not None:
+            stream._closed = True
+
+
+class Cache:
+    """In-process HTTP response cache (RFC 9111)
+
+    Attach one cache to any number of clients and sessions with their
+    set_cache(). GET responses are stored according to Cache-Control,
+    Expires and Vary; stale ones are revalidated with If-None-Match /
+    If-Modified-Since. Stored headers and bodies count against max_memory
+    (LRU eviction); with spill_dir, bodies of spill_threshold bytes or more
+    live in memory-mapped files counted against max_disk instead.
+    Responses to requests with Authorization are not stored, nor are
+    Set-Cookie headers (the cache may be shared across sessions).
+    """
+
+    def __init__(self, max_memory=64 * 1024 * 1024, spill_dir=None,
+                 spill_threshold=64 * 1024, max_disk=1024 * 1024 * 1024):
+        if not HAS_C_EXTENSION:
+            raise RuntimeError("C extension not available")
+        self._cache = _httpmorph.Cache(max_memory, spill_dir, spill_threshold, max_disk)
+
+    def clear(self):
+        """Drop every stored response"""
+        self._cache.clear()
+
+    def stats(self):
+        """Get cache statistics
+
+        Returns a dict with hits, misses, revalidations, stores, evictions,
+        invalidations, entries, memory_bytes and disk_bytes.
+        """
+        return self._cache.stats()
+
+
+class ProxySet:
+    """Proxies to rotate requests through, weighted by health
+
+    Attach one set to any number of clients and sessions with their
+    set_proxy_set(); requests that name no proxy of their own then pick one
+    at random, favouring proxies with low connect + TLS latency and few
+    errors. A proxy that fails eject_failures times in a row is left out
+    for eject_for seconds, doubling (up to 32x) each time it fails again
+    after coming back. With sticky_hosts, each host keeps its proxy while
+    that proxy stays in rotation.
+
+    Proxies are URLs (http://, https://, socks5://, socks5h://) or
+    (url, username, password) tuples.
+    """
+
+    def __init__(self, proxies=None, eject_failures=3, eject_for=30.0, sticky_hosts=False):
+        if not HAS_C_EXTENSION:
+            raise RuntimeError("C extension not available")
+        self._set = _httpmorph.ProxySet(proxies, eject_failures, eject_for, sticky_hosts)
+
+    def __len__(self):
+        return len(self._set)
+
+    def add(self, url, username=None, password=None):
+        """Add a proxy (one already in the set keeps its health)"""
+        self._set.add(url, username, password)
+
+    def remove(self, url):
+        """Remove a proxy (raises KeyError if it is not in the set)"""
+        self._set.remove(url)
+
+    def stats(self, url):
+        """Get the health of one proxy
+
+        Returns a dict with requests, failures, ejections, latency (seconds,
+        None until measured), error_rate, ejected and ejected_for (seconds).
+        """
+        return self._set.stats(url)
+
+
 class Client:
     """HTTP client using C implementation"""
 
@@ -392,8 +851,117 @@ class Client:
         """
         return self._client.load_ca_file(ca_file)
 
-    def request(self, method, url, **kwargs):
-        """Execute an HTTP request"""
+    def tls_session_stats(self):
+        """Get TLS session resumption cache statistics
+
+        Returns a dict with hits, misses, stores, evictions, expirations,
+        resumptions and entries.
+        """
+        return self._client.tls_session_stats()
+
+    def alt_svc(self, url, protocol="h3"):
+        """Get the alternative service an origin advertised (Alt-Svc)
+
+        HTTPS responses' Alt-Svc headers are remembered until their max-age
+        passes. Returns a (host, port) tuple, host "" meaning the origin's
+        own, or None if nothing usable is known for the protocol.
+        """
+        return self._client.alt_svc(url, protocol)
+
+    def allow_pipelining(self, url, depth=8):
+        """Pipeline request_many() requests to an origin over HTTP/1.1
+
+        Up to `depth` requests to the origin of `url` are written to one
+        pooled keep-alive connection before the first response is read.
+        Only GET, HEAD and OPTIONS requests without a body are pipelined, and only
+        over HTTP/1.1; depth 0 removes the origin again. Returns True on
+        success.
+        """
+        return self._client.allow_pipelining(url, depth)
+
+    def enable_request_arenas(self, max_cached=64):
+        """Allocate each request and its response from a per-request arena
+
+        Arenas are recycled through a freelist of up to max_cached; 0
+        turns them off again. Returns True on success.
+        """
+        return self._client.enable_request_arenas(max_cached)
+
+    def arena_stats(self):
+        """Get request arena statistics
+
+        Returns a dict with reused, created and cached, or None if arenas
+        are disabled.
+        """
+        return self._client.arena_stats()
+
+    def buffer_pool_stats(self):
+        """Get response buffer pool statistics
+
+        Returns a list with a dict per tier: buffer_size, mmap_backed,
+        hits (buffers reused), magazine_hits, misses (buffers allocated),
+        returns and pooled.
+        """
+        return self._client.buffer_pool_stats()
+
+    def metrics(self):
+        """Get a snapshot of the client's request metrics
+
+        Returns a dict with requests, errors, connections_opened,
+        connections_reused, tls_handshakes, tls_resumed, http2_streams,
+        body_wire_bytes and body_bytes, plus 'origins' (see
+        origin_metrics()), 'tls_sessions', 'buffer_pool', 'arenas' and
+        'dns_cache' from the other stats calls.
+        """
+        snapshot = self._client.metrics() or {}
+        snapshot.pop("pool_idle", None)
+        snapshot.pop("pool_active", None)
+        snapshot["origins"] = self.origin_metrics()
+        snapshot["tls_sessions"] = self.tls_session_stats()
+        snapshot["buffer_pool"] = self.buffer_pool_stats()
+        snapshot["arenas"] = self.arena_stats()
+        snapshot["dns_cache"] = dns_cache_stats()
+        return snapshot
+
+    def origin_metrics(self):
+        """Get request metrics per origin
+
+        Returns a list with a dict per origin, in the order they were first
+        seen: origin, requests, errors, total time percentiles (p50_us,
+        p90_us, p99_us, p999_us, max_us) and the summed phase times total_us,
+        queue_us, dns_us, connect_us, tls_us and first_byte_us.
+        """
+        return self._client.origin_metrics()
+
+    def reset_metrics(self):
+        """Zero the request metrics"""
+        self._client.reset_metrics()
+
+    def set_tls_fingerprint(self, enabled):
+        """Compute JA3 fingerprints for new TLS connections (on by default)
+
+        With fingerprinting off, response.ja3_fingerprint is None.
+        """
+        self._client.set_tls_fingerprint(enabled)
+
+    def set_cache(self, cache):
+        """Answer GET requests from a Cache when possible
+
+        Pass None to detach the current cache. Must not be called while
+        requests are in flight.
+        """
+        self._client.set_cache(cache._cache if cache is not None else None)
+
+    def set_proxy_set(self, proxy_set):
+        """Route requests without a proxy of their own through a ProxySet
+
+        Pass None to detach the current set. Must not be called while
+        requests are in flight.
+        """
+        self._client.set_proxy_set(proxy_set._set if proxy_set is not None else None)
+
+    def _prepare(self, url, kwargs):
+        """Apply client defaults and requests-style kwargs; returns the final URL"""
         # Handle http2 parameter - use client default if not specified
         if "http2" not in kwargs:
             kwargs["http2"] = self.http2
@@ -450,10 +1018,6 @@ class Client:
                     kwargs["headers"] = {}
                 kwargs["headers"]["Cookie"] = cookie_str
 
-        # Handle redirects (default: follow redirects)
-        allow_redirects = kwargs.pop("allow_redirects", True)
-        max_redirects = kwargs.pop("max_redirects", 10)
-
         # Handle timeout tuple (connect_timeout, read_timeout)
         if "timeout" in kwargs:
             timeout = kwargs["timeout"]
@@ -512,8 +1076,28 @@ class Client:
                     kwargs["headers"] = {}
                 kwargs["headers"]["Content-Type"] = f"multipart/form-data; boundary={boundary}"
 
+        return url
+
+    def request(self, method, url, **kwargs):
+        """Execute an HTTP request"""
+        # Handle redirects (default: follow redirects)
+        allow_redirects = kwargs.pop("allow_redirects", True)
+        max_redirects = kwargs.pop("max_redirects", 10)
+
+        # stream=True returns once headers arrive; the body is read on demand
+        stream = kwargs.pop("stream", False)
+
+        url = self._prepare(url, kwargs)
+        _stream_body(kwargs)
+
+        # Unless streaming, the C core follows redirects on pooled connections
+        native_redirects = allow_redirects and not stream
+        if native_redirects:
+            kwargs["follow_redirects"] = True
+            kwargs["max_redirects"] = max_redirects
+
         # Make initial request
-        result = self._client.request(method, url, **kwargs)
+        result, body_stream = _send(self._client.request, method, url, stream, kwargs)
 
         # Check for errors and raise appropriate exceptions
         if result.get("error"):
@@ -527,20 +1111,27 @@ class Client:
             # HTTPMORPH_ERROR_NETWORK = -3
             elif error_code == -3:
                 raise ConnectionError(error_msg)
+            # HTTPMORPH_ERROR_TOO_MANY_REDIRECTS = -9
+            elif error_code == -9:
+                raise TooManyRedirects(error_msg)
             # Other errors
             elif error_code != 0:
                 raise RequestException(error_msg)
 
-        response = Response(result, url=url)
+        response = _make_response(result, body_stream, url)
 
         # Follow redirects if needed
-        if allow_redirects:
+        if native_redirects:
+            response.history = _redirect_history(result, url)
+        elif allow_redirects:
             redirect_count = 0
             history = []
 
             while response.is_redirect and redirect_count < max_redirects:
                 # Save current response to history
                 history.append(response)
+                if body_stream is not None:
+                    response.close()  # Redirect bodies are never read
 
                 # Get redirect location
                 location = response.headers.get("Location") or response.headers.get("location")
@@ -569,9 +1160,11 @@ class Client:
                         kwargs.pop("data")
                     if "json" in kwargs:
                         kwargs.pop("json")
+                    for key in ("body_file", "body_source", "body_length"):
+                        kwargs.pop(key, None)
 
                 # Make redirect request
-                result = self._client.request(method, url, **kwargs)
+                result, body_stream = _send(self._client.request, method, url, stream, kwargs)
 
                 # Check for errors and raise appropriate exceptions
                 if result.get("error"):
@@ -584,7 +1177,7 @@ class Client:
                     elif error_code != 0:
                         raise RequestException(error_msg)
 
-                response = Response(result, url=url)
+                response = _make_response(result, body_stream, url)
 
                 # Parse Set-Cookie headers from redirect response
                 if "Set-Cookie" in response.headers or "set-cookie" in response.headers:
@@ -609,6 +1202,63 @@ class Client:
         """Execute a POST request"""
         return self.request("POST", url, **kwargs)
 
+    def request_many(self, requests, concurrency=8, ordered=True):
+        """Execute many requests from one call
+
+        The whole batch is handed to the C core, which runs up to
+        `concurrency` requests at once over the client's connection pool
+        (HTTPS requests to one origin share an HTTP/2 connection, and
+        origins passed to allow_pipelining() get HTTP/1.1 pipelining).
+        Redirects are not followed and stream=True is not supported.
+
+        Args:
+            requests: Iterable of (method, url), (method, url, kwargs) or
+                dicts with "method" and "url" plus request kwargs
+            concurrency: Maximum requests in flight
+            ordered: True returns a list of responses in input order;
+                False returns a generator of (index, response) in
+                completion order
+
+        Raises:
+            The exception for the first request that failed
+        """
+        batch = []
+        urls = []
+        for item in requests:
+            if isinstance(item, dict):
+                kwargs = dict(item)
+                method = kwargs.pop("method", "GET")
+                url = kwargs.pop("url")
+            else:
+                method, url = item[0], item[1]
+                kwargs = dict(item[2]) if len(item) > 2 and item[2] else {}
+            kwargs.pop("allow_redirects", None)
+            kwargs.pop("max_redirects", None)
+            if kwargs.pop("stream", False):
+                raise ValueError("stream=True is not supported by request_many()")
+            url = self._prepare(url, kwargs)
+            headers = kwargs.pop("headers", None)
+            body = kwargs.pop("body", None)
+            batch.append((method, url, headers, body, kwargs))
+            urls.append(url)
+
+        results = self._client.request_many(batch, concurrency)
+
+        def completed():
+            for index, result in results:
+                if result is None:
+                    raise RequestException(f"Failed to execute request {index}")
+                _check_c_error(result)
+                yield index, Response(result, url=urls[index])
+
+        if not ordered:
+            return completed()
+
+        responses = [None] * len(batch)
+        for index, response in completed():
+            responses[index] = response
+        return responses
+
     def put(self, url, **kwargs):
         """Execute a PUT request"""
         return self.request("PUT", url, **kwargs)
@@ -688,6 +1338,114 @@ class Session:
         """Get dict-like cookie container (requests compatibility)"""
         return self._cookies
 
+    def tls_session_stats(self):
+        """Get TLS session resumption cache statistics
+
+        Returns a dict with hits, misses, stores, evictions, expirations,
+        resumptions and entries, or None if the session is closed.
+        """
+        if self._session is None:
+            return None
+        return self._session.tls_session_stats()
+
+    def metrics(self):
+        """Get a snapshot of the session's request metrics
+
+        Like Client.metrics(), with pool_idle and pool_active giving the
+        connection pool's occupancy. Returns None if the session is closed.
+        """
+        if self._session is None:
+            return None
+        snapshot = self._session.metrics() or {}
+        snapshot["origins"] = self._session.origin_metrics()
+        snapshot["tls_sessions"] = self._session.tls_session_stats()
+        snapshot["dns_cache"] = dns_cache_stats()
+        return snapshot
+
+    def origin_metrics(self):
+        """Get request metrics per origin (see Client.origin_metrics())"""
+        if self._session is None:
+            return None
+        return self._session.origin_metrics()
+
+    def reset_metrics(self):
+        """Zero the request metrics"""
+        if self._session is not None:
+            self._session.reset_metrics()
+
+    def alt_svc(self, url, protocol="h3"):
+        """Get the alternative service an origin advertised (Alt-Svc)
+
+        Returns a (host, port) tuple, host "" meaning the origin's own, or
+        None if nothing usable is known for the protocol.
+        """
+        if self._session is None:
+            return None
+        return self._session.alt_svc(url, protocol)
+
+    def set_cache(self, cache):
+        """Answer GET requests from a Cache when possible (None detaches it)"""
+        if self._session is not None:
+            self._session.set_cache(cache._cache if cache is not None else None)
+
+    def set_proxy_set(self, proxy_set):
+        """Route requests without a proxy of their own through a ProxySet (None detaches it)"""
+        if self._session is not None:
+            self._session.set_proxy_set(proxy_set._set if proxy_set is not None else None)
+
+    def start_pool_maintenance(self, interval=1.0):
+        """Reap stale pooled connections and refill warm pools in the background"""
+        return self._session.start_pool_maintenance(interval)
+
+    def set_min_idle(self, host, port, count, tls=True):
+        """Keep at least `count` idle connections open to host:port"""
+        return self._session.set_min_idle(host, port, count, tls)
+
+    def preconnect(self, origins, per_host=1, http2=None, verify=True, timeout=None, wait=True):
+        """Open connections to origins ahead of the requests that need them
+
+        DNS, connect, TLS and (if negotiated) HTTP/2 setup run in parallel
+        in C; the connections go to the session pool for later requests.
+
+        Args:
+            origins: URLs (only scheme, host and port are used)
+            per_host: Connections to open per origin (HTTP/2 needs one)
+            http2: Offer HTTP/2 (default: the session's http2 setting)
+            verify: Verify certificates
+            timeout: Connect timeout in seconds per connection
+            wait: False to return a concurrent.futures.Future immediately
+
+        Returns:
+            {origin: result} where result has ok, error, connections,
+            http2, tls_resumed, dns_us, connect_us, tls_us and total_us
+            (a Future of that dict when wait is False)
+        """
+        if self._session is None:
+            raise RuntimeError("Session is closed")
+        origins = list(origins)
+        if http2 is None:
+            http2 = self.http2
+
+        def run():
+            results = self._session.preconnect(origins, per_host, http2, verify, timeout)
+            return dict(zip(origins, results))
+
+        if wait:
+            return run()
+
+        future = concurrent.futures.Future()
+
+        def worker():
+            if not future.set_running_or_notify_cancel():
+                return
+            try:
+                future.set_result(run())
+            except BaseException as e:
+                future.set_exception(e)
+
+        threading.Thread(target=worker, daemon=True).start()
+        return future
+
     def request(self, method, url, **kwargs):
         """Execute an HTTP request within this session"""
         # Handle http2 parameter - use session default if not specified
@@ -756,6 +1514,9 @@ class Session:
         allow_redirects = kwargs.pop("allow_redirects", True)
         max_redirects = kwargs.pop("max_redirects", 10)
 
+        # stream=True returns once headers arrive; the body is read on demand
+        stream = kwargs.pop("stream", False)
+
         # Handle timeout tuple (connect_timeout, read_timeout)
         if "timeout" in kwargs:
             timeout = kwargs["timeout"]
@@ -812,9 +1573,17 @@ class Session:
                 headers["Content-Type"] = f"multipart/form-data; boundary={boundary}"
 
         kwargs["headers"] = headers
+        _stream_body(kwargs)
+
+        # Unless streaming, the C core follows redirects on pooled connections
+        # (every hop goes through the session's cookie jar)
+        native_redirects = allow_redirects and not stream
+        if native_redirects:
+            kwargs["follow_redirects"] = True
+            kwargs["max_redirects"] = max_redirects
 
         # Make initial request
-        result = self._session.request(method, url, **kwargs)
+        result, body_stream = _send(self._session.request, method, url, stream, kwargs)
 
         # Check for errors and raise appropriate exceptions
         if result.get("error"):
@@ -826,25 +1595,33 @@ class Session:
             # HTTPMORPH_ERROR_NETWORK = 3
             elif error_code == 3:
                 raise ConnectionError(error_msg)
+            # HTTPMORPH_ERROR_TOO_MANY_REDIRECTS = 9
+            elif error_code == 9:
+                raise TooManyRedirects(error_msg)
             # Other errors
             elif error_code != 0:
                 raise RequestException(error_msg)
 
-        response = Response(result, url=url)
+        response = _make_response(result, body_stream, url)
+        if native_redirects:
+            response.history = _redirect_history(result, url)
 
-        # Parse Set-Cookie headers from response
-        if "Set-Cookie" in response.headers or "set-cookie" in response.headers:
-            set_cookie = response.headers.get("Set-Cookie") or response.headers.get("set-cookie")
-            self._cookies.parse_set_cookie(set_cookie)
+        # Parse Set-Cookie headers from response (and the hops before it)
+        for hop in response.history + [response]:
+            if "Set-Cookie" in hop.headers or "set-cookie" in hop.headers:
+                set_cookie = hop.headers.get("Set-Cookie") or hop.headers.get("set-cookie")
+                self._cookies.parse_set_cookie(set_cookie)
 
         # Follow redirects if needed
-        if allow_redirects:
+        if allow_redirects and not native_redirects:
             redirect_count = 0
             history = []
 
             while response.is_redirect and redirect_count < max_redirects:
                 # Save current response to history
                 history.append(response)
+                if body_stream is not None:
+                    response.close()  # Redirect bodies are never read
 
                 # Get redirect location
                 location = response.headers.get("Location") or response.headers.get("location")
@@ -873,9 +1650,11 @@ class Session:
                         kwargs.pop("data")
                     if "json" in kwargs:
                         kwargs.pop("json")
+                    for key in ("body_file", "body_source", "body_length"):
+                        kwargs.pop(key, None)
 
                 # Make redirect request
-                result = self._session.request(method, url, **kwargs)
+                result, body_stream = _send(self._session.request, method, url, stream, kwargs)
 
                 # Check for errors and raise appropriate exceptions
                 if result.get("error"):
@@ -888,7 +1667,7 @@ class Session:
                     elif error_code != 0:
                         raise RequestException(error_msg)
 
-                response = Response(result, url=url)
+                response = _make_response(result, body_stream, url)
 
                 # Parse Set-Cookie headers from redirect response
                 if "Set-Cookie" in response.headers or "set-cookie" in response.headers:
@@ -1023,6 +1802,100 @@ def cleanup():
             pass
 
 
+def set_dns_servers(servers=None, timeout=None):
+    """Resolve through the given name servers instead of the system resolver
+
+    Args:
+        servers: List of "ip", "ip:port" or "[ipv6]:port" strings (at most 4),
+            or None to go back to the system resolver
+        timeout: Per-server query timeout in seconds (default 2)
+
+    Applies to sync and async clients.
+    """
+    if HAS_C_EXTENSION:
+        _httpmorph.set_dns_servers(servers, timeout)
+    try:
+        from httpmorph import _async
+    except ImportError:
+        return
+    _async.set_dns_servers(servers, timeout)
+
+
+def dns_cache_stats():
+    """Get process-wide DNS cache statistics
+
+    Returns:
+        dict with hits, misses, negative_hits, insertions, evictions,
+        expirations and entries, or None without the C extension
+    """
+    if HAS_C_EXTENSION:
+        return _httpmorph.dns_cache_stats()
+    return None
+
+
+def open_shared_cache(path, dns_entries=0, tls_entries=0):
+    """Share DNS results and TLS sessions with other processes on this host
+
+    Every process that opens the same file sees the lookups and TLS
+    sessions of the others, and a restarted worker starts with them. Put
+    the file on tmpfs (e.g. /dev/shm/httpmorph.cache) and open it in each
+    worker, or once before forking. Table sizes are fixed when the file is
+    created; remove the file to change them. Sync and async clients both
+    use it.
+
+    Args:
+        path: File to map, created if missing
+        dns_entries: DNS slots (0 for 1024)
+        tls_entries: TLS session slots (0 for 1024)
+
+    Returns:
+        True if opened, False if it failed (e.g. the file was created with
+        other sizes) or a shared cache is already open
+    """
+    if not HAS_C_EXTENSION:
+        return False
+    opened = _httpmorph.open_shared_cache(path, dns_entries, tls_entries)
+    try:
+        from httpmorph import _async
+    except ImportError:
+        return opened
+    return _async.open_shared_cache(path, dns_entries, tls_entries) and opened
+
+
+def shared_cache_stats():
+    """Get shared cache statistics, summed over every process using the file
+
+    Returns:
+        dict with dns_hits, dns_misses, dns_stores, tls_hits, tls_misses,
+        tls_stores, busy, dns_entries and tls_entries, or None when no
+        shared cache is open
+    """
+    if HAS_C_EXTENSION:
+        return _httpmorph.shared_cache_stats()
+    return None
+
+
+def set_tracer(tracer):
+    """Call tracer(span) for every span of every request, sync and async
+
+    Each request produces a root span named after its method, carrying
+    http.request.method, url.full, http.response.status_code and
+    httpmorph.request_id attributes, and a child span per phase it went
+    through ("queue", "dns", "connect", "tls", "wait", "body"). Spans are
+    dicts shaped like OpenTelemetry spans: trace_id, span_id,
+    parent_span_id (None for the root), name, start_time_unix_nano,
+    end_time_unix_nano and attributes. The tracer runs on the thread that
+    finished the request and must be quick. Pass None to stop tracing.
+    """
+    if HAS_C_EXTENSION:
+        _httpmorph.set_tracer(tracer)
+    try:
+        from httpmorph import _async
+    except ImportError:
+        return
+    _async.set_tracer(tracer)
+
+
 def version():
     """Get library version"""
     # Read version from package metadata (single source of truth: pyproject.toml)
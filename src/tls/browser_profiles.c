@@ -13,9 +13,11 @@
 
 /* Platform-specific headers */
 #ifdef _WIN32
+    #include <windows.h>
     #define strcasecmp _stricmp
 #else
     #include <strings.h>  /* for strcasecmp */
+    #include <pthread.h>
 #endif
 
 /* Chrome 142 Profile (Current Chrome fingerprint with JA4: t13d1516h2_8daaf6152771_d8a2da3f94cd) */
@@ -58,7 +60,7 @@ const browser_profile_t PROFILE_CHROME_142 = {
         13,     /* 0x000d - signature_algorithms */
         18,     /* 0x0012 - signed_certificate_timestamp */
         23,     /* 0x0017 - extended_master_secret */
-        27,     /* 0x001b - padding */
+        27,     /* 0x001b - compress_certificate */
         35,     /* 0x0023 - session_ticket */
         43,     /* 0x002b - supported_versions */
         45,     /* 0x002d - psk_key_exchange_modes */
@@ -89,6 +91,11 @@ const browser_profile_t PROFILE_CHROME_142 = {
     },
     .signature_algorithm_count = 8,
 
+    .cert_compression_algs = {
+        0x0002,  /* brotli */
+    },
+    .cert_compression_alg_count = 1,
+
     .alpn_protocols = {"h2", "http/1.1"},
     .alpn_protocol_count = 2,
 
@@ -97,6 +104,10 @@ const browser_profile_t PROFILE_CHROME_142 = {
     .grease_extension = 0x0a0a,
     .grease_group = 0x0a0a,
 
+    /* Chrome keeps TLS early data behind a flag and never uses TCP Fast Open */
+    .early_data = false,
+    .tcp_fast_open = false,
+
     .http2 = {
         .settings = {
             {1, 65536},    /* SETTINGS_HEADER_TABLE_SIZE */
@@ -121,6 +132,14 @@ static const browser_profile_t *profiles[] = {
 
 static const int profile_count = sizeof(profiles) / sizeof(profiles[0]);
 
+/* Pre-generated variants 1..BROWSER_PROFILE_VARIANTS-1 of each profile */
+static browser_profile_t variant_sets[sizeof(profiles) / sizeof(profiles[0])][BROWSER_PROFILE_VARIANTS - 1];
+#ifndef _WIN32
+static pthread_once_t variant_sets_once = PTHREAD_ONCE_INIT;
+#else
+static INIT_ONCE variant_sets_once = INIT_ONCE_STATIC_INIT;
+#endif
+
 /**
  * Get profile by name
  * Supports aliases for backward compatibility:
@@ -205,24 +224,21 @@ const char** browser_profile_list(int *count) {
     return names;
 }
 
-/**
- * Generate dynamic profile based on real browser with variations
- */
-browser_profile_t* browser_profile_generate_variant(const browser_profile_t *base) {
-    if (!base) {
-        return NULL;
-    }
-
-    browser_profile_t *variant = malloc(sizeof(browser_profile_t));
-    if (!variant) {
-        return NULL;
+/* Helper: Next random number, from rand() or from a seeded sequence (xorshift32) */
+static int variant_rand(uint32_t *state) {
+    if (!state) {
+        return rand();
     }
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return (int)(x >> 1);
+}
 
-    /* Copy base profile */
-    memcpy(variant, base, sizeof(browser_profile_t));
-
-    /* Add randomization to make each variant slightly different */
-
+/* Helper: Apply a variant's randomization to a copy of its base profile */
+static void variant_randomize(browser_profile_t *variant, uint32_t *state) {
     /* Randomize GREASE values (GRE ASE - Generate Random Extensions And Sustain Extensibility)
      * GREASE values should be different for each connection */
     if (variant->use_grease) {
@@ -235,9 +251,9 @@ browser_profile_t* browser_profile_generate_variant(const browser_profile_t *bas
         int num_grease = sizeof(grease_values) / sizeof(grease_values[0]);
 
         /* Pick random GREASE values */
-        variant->grease_cipher = grease_values[rand() % num_grease];
-        variant->grease_extension = grease_values[rand() % num_grease];
-        variant->grease_group = grease_values[rand() % num_grease];
+        variant->grease_cipher = grease_values[variant_rand(state) % num_grease];
+        variant->grease_extension = grease_values[variant_rand(state) % num_grease];
+        variant->grease_group = grease_values[variant_rand(state) % num_grease];
     }
 
     /* Minor randomization of cipher suite order (swap adjacent non-critical ciphers)
@@ -245,7 +261,7 @@ browser_profile_t* browser_profile_generate_variant(const browser_profile_t *bas
     if (variant->cipher_suite_count > 6) {
         for (int i = 2; i < variant->cipher_suite_count - 2; i++) {
             /* 30% chance to swap with next cipher */
-            if ((rand() % 100) < 30 && i + 1 < variant->cipher_suite_count - 2) {
+            if ((variant_rand(state) % 100) < 30 && i + 1 < variant->cipher_suite_count - 2) {
                 uint16_t temp = variant->cipher_suites[i];
                 variant->cipher_suites[i] = variant->cipher_suites[i + 1];
                 variant->cipher_suites[i + 1] = temp;
@@ -268,7 +284,7 @@ browser_profile_t* browser_profile_generate_variant(const browser_profile_t *bas
             }
 
             /* 25% chance to swap with next non-critical extension */
-            if ((rand() % 100) < 25 && i + 1 < variant->extension_count - 1) {
+            if ((variant_rand(state) % 100) < 25 && i + 1 < variant->extension_count - 1) {
                 uint16_t next_ext = variant->extensions[i + 1];
 
                 /* Check if next is also non-critical */
@@ -289,10 +305,70 @@ browser_profile_t* browser_profile_generate_variant(const browser_profile_t *bas
      * 2. GREASE values are supposed to change per-connection
      * 3. Real browsers show similar variance in fingerprints
      * The precomputed JA3 represents the "base" fingerprint family */
+}
 
+/**
+ * Generate dynamic profile based on real browser with variations
+ */
+browser_profile_t* browser_profile_generate_variant(const browser_profile_t *base) {
+    if (!base) {
+        return NULL;
+    }
+
+    browser_profile_t *variant = malloc(sizeof(browser_profile_t));
+    if (!variant) {
+        return NULL;
+    }
+
+    /* Copy base profile, then make it slightly different */
+    memcpy(variant, base, sizeof(browser_profile_t));
+    variant_randomize(variant, NULL);
     return variant;
 }
 
+/* Helper: Build every profile's variant set (once per process) */
+#ifndef _WIN32
+static void variant_sets_init(void) {
+#else
+static BOOL CALLBACK variant_sets_init(PINIT_ONCE InitOnce, PVOID Parameter, PVOID *Context) {
+    (void)InitOnce; (void)Parameter; (void)Context;
+#endif
+    /* Seeded per process, so processes don't all rotate through the same set */
+    uint32_t seed = (uint32_t)time(NULL) ^ (uint32_t)(uintptr_t)&seed;
+    for (int i = 0; i < profile_count; i++) {
+        for (int v = 0; v < BROWSER_PROFILE_VARIANTS - 1; v++) {
+            uint32_t state = (seed + (uint32_t)(i * BROWSER_PROFILE_VARIANTS + v + 1) * 2654435761u) | 1;
+            memcpy(&variant_sets[i][v], profiles[i], sizeof(browser_profile_t));
+            variant_randomize(&variant_sets[i][v], &state);
+        }
+    }
+#ifdef _WIN32
+    return TRUE;
+#endif
+}
+
+/**
+ * Get one of a profile's pre-generated variants
+ */
+const browser_profile_t* browser_profile_variant(const browser_profile_t *base, unsigned int index) {
+    index %= BROWSER_PROFILE_VARIANTS;
+    if (!base || index == 0) {
+        return base;
+    }
+
+    for (int i = 0; i < profile_count; i++) {
+        if (profiles[i] == base) {
+#ifndef _WIN32
+            pthread_once(&variant_sets_once, variant_sets_init);
+#else
+            InitOnceExecuteOnce(&variant_sets_once, variant_sets_init, NULL, NULL);
+#endif
+            return &variant_sets[i][index - 1];
+        }
+    }
+    return base;
+}
+
 /**
  * Destroy a generated profile
  */
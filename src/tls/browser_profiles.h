@@ -21,6 +21,10 @@ extern "C" {
 #define MAX_SIG_ALGORITHMS 24
 #define MAX_ALPN_PROTOCOLS 8
 #define MAX_HTTP2_SETTINGS 16
+#define MAX_CERT_COMPRESSION_ALGS 4
+
+/* Fingerprint variants kept per profile for rotation (variant 0 is the profile itself) */
+#define BROWSER_PROFILE_VARIANTS 8
 
 /* OS types for user agent generation */
 typedef enum {
@@ -51,6 +55,7 @@ typedef enum {
     TLS_EXT_COMPRESS_CERTIFICATE = 27,
     TLS_EXT_SESSION_TICKET = 35,
     TLS_EXT_PRE_SHARED_KEY = 41,
+    TLS_EXT_EARLY_DATA = 42,
     TLS_EXT_SUPPORTED_VERSIONS = 43,
     TLS_EXT_PSK_KEY_EXCHANGE_MODES = 45,
     TLS_EXT_KEY_SHARE = 51,
@@ -90,6 +95,10 @@ typedef struct {
     uint16_t signature_algorithms[MAX_SIG_ALGORITHMS];
     int signature_algorithm_count;
 
+    /* compress_certificate algorithms in order (RFC 8879: 1 zlib, 2 brotli, 3 zstd) */
+    uint16_t cert_compression_algs[MAX_CERT_COMPRESSION_ALGS];
+    int cert_compression_alg_count;
+
     /* ALPN protocols in order */
     const char *alpn_protocols[MAX_ALPN_PROTOCOLS];
     int alpn_protocol_count;
@@ -100,6 +109,10 @@ typedef struct {
     uint16_t grease_extension;
     uint16_t grease_group;
 
+    /* Zero round trip setup the browser does itself (requests opt in on top) */
+    bool early_data;              /* TLS 1.3 early data over TCP */
+    bool tcp_fast_open;           /* TCP Fast Open */
+
     /* HTTP/2 fingerprint */
     struct {
         uint32_t settings[MAX_HTTP2_SETTINGS][2];  /* [id, value] pairs */
@@ -148,6 +161,19 @@ const char** browser_profile_list(int *count);
  */
 browser_profile_t* browser_profile_generate_variant(const browser_profile_t *base);
 
+/**
+ * Get one of a profile's pre-generated variants
+ * Each predefined profile has BROWSER_PROFILE_VARIANTS variants, built
+ * once per process and never freed, so a variant keeps its address (and
+ * with it its cached SSL context and pooled connections) for the life of
+ * the process. Variant 0, and every variant of a profile that isn't
+ * predefined, is the profile itself.
+ *
+ * @param base Predefined profile
+ * @param index Variant number (taken modulo BROWSER_PROFILE_VARIANTS)
+ */
+const browser_profile_t* browser_profile_variant(const browser_profile_t *base, unsigned int index);
+
 /**
  * Destroy a generated profile
  */
@@ -0,0 +1,463 @@
+"""
+AsyncClient tests for httpmorph
+"""
+
+import asyncio
+import sys
+import time
+
+import pytest
+
+from tests.test_server import MockHTTPServer
+
+try:
+    from httpmorph import AsyncClient, TooManyRedirects
+    from httpmorph._async_client import HAS_ASYNC_BINDINGS
+except ImportError:
+    HAS_ASYNC_BINDINGS = False
+
+pytestmark = pytest.mark.skipif(not HAS_ASYNC_BINDINGS, reason="Async bindings not built")
+
+
+class TestAsyncEventDriven:
+    """Test the event-driven completion path of AsyncRequestManager"""
+
+    @pytest.mark.asyncio
+    @pytest.mark.skipif(sys.platform == "win32", reason="ProactorEventLoop can't watch raw fds")
+    async def test_manager_uses_event_thread(self):
+        """Test manager switches to event-driven mode on selector loops"""
+        async with AsyncClient() as client:
+            assert client._manager.event_driven
+
+    @pytest.mark.asyncio
+    async def test_single_request(self):
+        """Test a single request completes"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                response = await client.get(f"{server.url}/get")
+                assert response.status_code == 200
+                assert b"GET" in response.body
+
+    @pytest.mark.asyncio
+    async def test_concurrent_requests_complete(self):
+        """Test many concurrent requests are all resolved"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                responses = await asyncio.gather(
+                    *[client.get(f"{server.url}/get?i={i}") for i in range(20)]
+                )
+                assert len(responses) == 20
+                assert all(r.status_code == 200 for r in responses)
+                assert client._manager.get_active_count() == 0
+
+    @pytest.mark.asyncio
+    async def test_io_uring_engine(self):
+        """Test requests complete on the io_uring engine (epoll where unavailable)"""
+        with MockHTTPServer() as server:
+            async with AsyncClient(io_uring=True) as client:
+                responses = await asyncio.gather(
+                    *[client.get(f"{server.url}/get?i={i}") for i in range(10)]
+                )
+                assert all(r.status_code == 200 for r in responses)
+                stats = client.io_stats()
+                assert stats["engine"] in ("io_uring", "epoll", "kqueue", "iocp")
+                if stats["engine"] != "iocp":
+                    assert stats["ops_submitted"] > 0
+
+    @pytest.mark.asyncio
+    async def test_sharded_manager(self):
+        """Test requests complete when spread over several event threads"""
+        with MockHTTPServer() as server:
+            async with AsyncClient(shards=4) as client:
+                responses = await asyncio.gather(
+                    *[client.get(f"{server.url}/get?i={i}") for i in range(20)]
+                )
+                assert all(r.status_code == 200 for r in responses)
+                assert client.io_stats()["shards"] == 4
+                assert client._manager.get_active_count() == 0
+
+    @pytest.mark.asyncio
+    async def test_large_request_body(self):
+        """Test a body larger than the send buffer goes out in full"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                payload = b"x" * (256 * 1024)
+                response = await client.post(f"{server.url}/post", data=payload)
+                assert response.status_code == 200
+                assert len(response.json()["data"]) == len(payload)
+
+    @pytest.mark.asyncio
+    async def test_json_from_body_buffer(self):
+        """Test json() parses the body in place and body still reads as bytes"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                response = await client.post(f"{server.url}/post", data=b"payload")
+                assert len(response.body_view) > 0
+                assert response.json()["data"] == "payload"
+                assert isinstance(response.body, bytes)
+                assert bytes(response.body_view) == response.body
+
+    @pytest.mark.asyncio
+    async def test_upload_from_async_generator(self):
+        """Test an async generator body is streamed chunked"""
+
+        async def parts():
+            for i in range(20):
+                await asyncio.sleep(0)
+                yield b"z" * 10000
+
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                response = await client.post(f"{server.url}/post", data=parts())
+                assert response.status_code == 200
+                assert len(response.json()["data"]) == 200000
+
+    @pytest.mark.asyncio
+    async def test_submit_while_uploading(self):
+        """Test requests submitted while body sources are read don't deadlock"""
+
+        async def parts():
+            for i in range(50):
+                await asyncio.sleep(0)
+                yield b"z" * 4000
+
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                uploads = [client.post(f"{server.url}/post", data=parts()) for _ in range(8)]
+                gets = [client.get(f"{server.url}/get") for _ in range(64)]
+                responses = await asyncio.wait_for(asyncio.gather(*uploads, *gets), timeout=60)
+                assert all(r.status_code == 200 for r in responses)
+                assert all(len(r.json()["data"]) == 200000 for r in responses[:8])
+
+    @pytest.mark.asyncio
+    async def test_polling_fallback(self):
+        """Test explicit polling mode still works"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                client._manager.set_event_loop(asyncio.get_running_loop(), event_driven=False)
+                response = await client.get(f"{server.url}/get")
+                assert response.status_code == 200
+
+    @pytest.mark.asyncio
+    async def test_first_byte_timeout(self):
+        """Test a phase timeout fires well before the total timeout"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                start = time.monotonic()
+                with pytest.raises(Exception):
+                    await client.get(f"{server.url}/delay/3", timeout=10, first_byte_timeout=0.3)
+                assert time.monotonic() - start < 2
+
+    @pytest.mark.asyncio
+    async def test_connection_error(self):
+        """Test failures are delivered through the completion queue"""
+        async with AsyncClient() as client:
+            with pytest.raises(Exception):
+                await client.get("http://127.0.0.1:1/", timeout=2)
+
+
+class TestAsyncScheduler:
+    """Test per-origin admission control"""
+
+    @pytest.mark.asyncio
+    async def test_no_scheduler_by_default(self):
+        """Test requests are not held unless limits are set"""
+        async with AsyncClient() as client:
+            assert client.scheduler_stats() is None
+
+    @pytest.mark.asyncio
+    async def test_per_origin_cap(self):
+        """Test requests beyond the per-origin cap wait for a free place"""
+        with MockHTTPServer() as server:
+            async with AsyncClient(max_per_origin=2) as client:
+                start = time.monotonic()
+                responses = await asyncio.gather(
+                    *[client.get(f"{server.url}/delay/1?i={i}") for i in range(4)]
+                )
+                elapsed = time.monotonic() - start
+                assert all(r.status_code == 200 for r in responses)
+                assert elapsed >= 1.8
+                stats = client.scheduler_stats()
+                assert stats["deferred"] == 2
+                assert stats["admitted"] == 4
+                assert stats["queued"] == 0
+                assert stats["in_flight"] == 0
+
+    @pytest.mark.asyncio
+    async def test_rate_limit(self):
+        """Test a token bucket spaces out request starts"""
+        with MockHTTPServer() as server:
+            async with AsyncClient(rate_limit=10, rate_burst=1) as client:
+                start = time.monotonic()
+                responses = await asyncio.gather(
+                    *[client.get(f"{server.url}/get?i={i}") for i in range(5)]
+                )
+                assert all(r.status_code == 200 for r in responses)
+                assert time.monotonic() - start >= 0.35
+
+    @pytest.mark.asyncio
+    async def test_origin_limits_override(self):
+        """Test an origin's own limits apply to it alone"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                client.set_origin_limits(server.url, max_concurrent=1)
+                responses = await asyncio.gather(
+                    *[client.get(f"{server.url}/get?i={i}") for i in range(3)]
+                )
+                assert all(r.status_code == 200 for r in responses)
+                assert client.scheduler_stats()["deferred"] == 2
+
+    @pytest.mark.asyncio
+    async def test_high_priority_starts_first(self):
+        """Test waiting high-priority requests go ahead of earlier low ones"""
+        with MockHTTPServer() as server:
+            async with AsyncClient(max_per_origin=1) as client:
+                order = []
+
+                async def fetch(name, priority):
+                    await client.get(f"{server.url}/get?n={name}", priority=priority)
+                    order.append(name)
+
+                blocker = asyncio.ensure_future(client.get(f"{server.url}/delay/1"))
+                await asyncio.sleep(0.2)
+                tasks = [asyncio.ensure_future(fetch(f"low{i}", "low")) for i in range(3)]
+                await asyncio.sleep(0.05)
+                tasks.append(asyncio.ensure_future(fetch("high", "high")))
+                await asyncio.gather(blocker, *tasks)
+                assert order[0] == "high"
+
+    @pytest.mark.asyncio
+    async def test_queued_request_times_out(self):
+        """Test a request that never gets a place fails with its timeout"""
+        with MockHTTPServer() as server:
+            async with AsyncClient(max_per_origin=1) as client:
+                blocker = asyncio.ensure_future(client.get(f"{server.url}/delay/2"))
+                await asyncio.sleep(0.2)
+                start = time.monotonic()
+                with pytest.raises(Exception):
+                    await client.get(f"{server.url}/get", timeout=0.3)
+                assert time.monotonic() - start < 1.5
+                assert (await blocker).status_code == 200
+                assert client.scheduler_stats()["queued"] == 0
+
+
+class TestAsyncHedging:
+    """Test hedged requests"""
+
+    @pytest.mark.asyncio
+    async def test_no_hedging_by_default(self):
+        """Test requests are sent once unless hedging is on"""
+        async with AsyncClient() as client:
+            assert client.hedge_stats() is None
+
+    @pytest.mark.asyncio
+    async def test_slow_request_is_hedged(self):
+        """Test a request slower than its origin's history gets a duplicate"""
+        hedge = {"min_samples": 5, "min_delay_ms": 1, "budget": 1.0}
+        with MockHTTPServer() as server:
+            async with AsyncClient(hedge=hedge) as client:
+                for i in range(5):
+                    assert (await client.get(f"{server.url}/get?i={i}")).status_code == 200
+                assert client.hedge_stats()["launched"] == 0
+
+                response = await client.get(f"{server.url}/delay/1")
+                assert response.status_code == 200
+                stats = client.hedge_stats()
+                assert stats["launched"] == 1
+                assert stats["in_flight"] == 0
+
+
+class TestAsyncRedirects:
+    """Test redirects followed by the C engine"""
+
+    @pytest.mark.asyncio
+    async def test_redirects_followed(self):
+        """Test a redirect chain ends at the final response with its history"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                response = await client.get(f"{server.url}/redirect/3")
+                assert response.status_code == 200
+                assert response.url == f"{server.url}/get"
+                assert [r.status_code for r in response.history] == [302, 302, 302]
+                assert response.history[0].url == f"{server.url}/redirect/3"
+
+    @pytest.mark.asyncio
+    async def test_redirects_not_followed(self):
+        """Test allow_redirects=False returns the redirect itself"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                response = await client.get(f"{server.url}/redirect/1", allow_redirects=False)
+                assert response.status_code == 302
+                assert response.history == []
+
+    @pytest.mark.asyncio
+    async def test_too_many_redirects(self):
+        """Test a chain longer than max_redirects raises"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                with pytest.raises(TooManyRedirects):
+                    await client.get(f"{server.url}/redirect/5", max_redirects=2)
+
+
+class TestAsyncPreconnect:
+    """Test connections opened ahead of requests"""
+
+    @pytest.mark.asyncio
+    async def test_preconnect_then_request(self):
+        """Test a request after a preconnect sends on the kept connection"""
+        with MockHTTPServer(keep_alive=True) as server:
+            async with AsyncClient() as client:
+                results = await client.preconnect([server.url], per_host=2)
+                assert results[server.url]["ok"] is True
+                assert results[server.url]["connections"] == 2
+
+                response = await client.get(f"{server.url}/get")
+                assert response.status_code == 200
+                assert response.connection_reused is True
+                assert client.metrics()["requests"] == 1
+
+    @pytest.mark.asyncio
+    async def test_preconnect_failure(self):
+        """Test an unreachable origin is reported, not raised"""
+        async with AsyncClient() as client:
+            results = await client.preconnect(["http://127.0.0.1:1"], timeout=2)
+            assert results["http://127.0.0.1:1"]["ok"] is False
+            assert results["http://127.0.0.1:1"]["error"] is not None
+
+
+class TestAsyncMemoryBudget:
+    """Test the response buffer budget"""
+
+    @pytest.mark.asyncio
+    async def test_requests_finish_under_small_budget(self):
+        """Test requests needing more than the budget still all complete"""
+        with MockHTTPServer() as server:
+            async with AsyncClient(memory_budget=64 * 1024) as client:
+                responses = await asyncio.gather(
+                    *[client.get(f"{server.url}/get") for _ in range(4)]
+                )
+                assert all(r.status_code == 200 for r in responses)
+
+                metrics = client.metrics()
+                assert metrics["memory_limit"] == 64 * 1024
+                assert metrics["memory_peak"] > metrics["memory_limit"]
+
+
+class TestAsyncZeroRtt:
+    """Test early data and TCP Fast Open options"""
+
+    @pytest.mark.asyncio
+    async def test_repeat_requests_with_zero_rtt(self):
+        """Test requests still complete with both options on"""
+        with MockHTTPServer() as server:
+            async with AsyncClient(early_data=True, tcp_fast_open=True) as client:
+                for _ in range(3):
+                    response = await client.get(f"{server.url}/get")
+                    assert response.status_code == 200
+
+    @pytest.mark.asyncio
+    async def test_unsafe_request_with_zero_rtt(self):
+        """Test a POST body is sent normally with both options on"""
+        with MockHTTPServer() as server:
+            async with AsyncClient(early_data=True, tcp_fast_open=True) as client:
+                response = await client.post(f"{server.url}/post", data=b"payload")
+                assert response.status_code == 200
+                assert len(response.json()["data"]) == len(b"payload")
+
+
+class TestAsyncKernelTls:
+    """Test the kernel TLS receive option"""
+
+    @pytest.mark.asyncio
+    async def test_large_https_body_with_ktls(self):
+        """Test a body large enough to offload arrives intact (or falls back)"""
+        with MockHTTPServer(ssl_enabled=True) as server:
+            async with AsyncClient(ktls=True) as client:
+                response = await client.get(f"{server.url}/bytes/1048576", verify=False)
+                assert response.status_code == 200
+                assert response.content == b"\x00" * 1048576
+
+    @pytest.mark.asyncio
+    async def test_chunked_response(self):
+        """Test a chunked body larger than the receive buffer is decoded"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                for length in (0, 999, 300000):
+                    response = await client.get(f"{server.url}/chunked/{length}")
+                    assert response.status_code == 200
+                    assert response.content == bytes(i % 251 for i in range(length))
+
+
+class TestAsyncStreaming:
+    """Test AsyncClient.stream()"""
+
+    @pytest.mark.asyncio
+    async def test_stream_aiter_bytes(self):
+        """Test a body larger than the pause threshold streams completely"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                async with client.stream(
+                    "GET", f"{server.url}/bytes/300000", chunk_size=8192
+                ) as response:
+                    assert response.status_code == 200
+                    total = 0
+                    async for chunk in response.aiter_bytes():
+                        assert len(chunk) <= 8192
+                        total += len(chunk)
+                        await asyncio.sleep(0)
+                    assert total == 300000
+
+    @pytest.mark.asyncio
+    async def test_submit_while_streaming(self):
+        """Test requests submitted while sink callbacks run don't deadlock"""
+
+        async def consume(client, url):
+            async with client.stream("GET", url, chunk_size=1024) as response:
+                total = 0
+                async for chunk in response.aiter_bytes():
+                    total += len(chunk)
+                return total
+
+        async def submit_many(client, url):
+            responses = await asyncio.gather(*[client.get(url) for _ in range(64)])
+            return [r.status_code for r in responses]
+
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                streams = [consume(client, f"{server.url}/bytes/200000") for _ in range(8)]
+                results = await asyncio.wait_for(
+                    asyncio.gather(*streams, submit_many(client, f"{server.url}/get")), timeout=60
+                )
+                assert results[:8] == [200000] * 8
+                assert results[8] == [200] * 64
+
+    @pytest.mark.asyncio
+    async def test_stream_close_early(self):
+        """Test leaving the block early aborts the transfer"""
+        with MockHTTPServer() as server:
+            async with AsyncClient() as client:
+                async with client.stream(
+                    "GET", f"{server.url}/bytes/1000000", chunk_size=4096
+                ) as response:
+                    async for _ in response.aiter_bytes():
+                        break
+                response = await client.get(f"{server.url}/get")
+                assert response.status_code == 200
+
+
+class TestAsyncTimerWheel:
+    """Test the timer wheel request deadlines run on"""
+
+    def test_timers_at_level_boundaries_fire_on_time(self):
+        """Test a timer cascaded down on its own tick fires on that tick"""
+        from httpmorph import _async
+
+        expiries = [64, 128, 4096, 8192, 262144, 65, 4097, 300000]
+        assert _async._timer_wheel_fire_times(0, expiries) == expiries
+        assert _async._timer_wheel_fire_times(10, expiries) == expiries
+
+    def test_coarse_advance_fires_at_boundary(self):
+        """Test advancing straight onto a boundary fires the timer due there"""
+        from httpmorph import _async
+
+        assert _async._timer_wheel_fire_times(0, [4096], step_ms=4096) == [4096]
@@ -2,6 +2,12 @@
 Client tests for httpmorph
 """
 
+import asyncio
+import struct
+import subprocess
+import sys
+import time
+
 import pytest
 
 import httpmorph
@@ -87,6 +93,61 @@ class TestClient:
             response = httpmorph.get(f"{server.url}/status/404")
             assert response.status_code == 404
 
+    def test_large_response_headers(self):
+        """Test response heads beyond 16 KB are read whole, up to max_header_size"""
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            response = client.get(f"{server.url}/large-headers/64")
+            assert response.status_code == 200
+            assert response.body == b"OK"
+            assert len(response.headers.get("Set-Cookie", "")) > 1000
+
+            with pytest.raises(httpmorph.RequestException):
+                client.get(f"{server.url}/large-headers/64", max_header_size=16384)
+
+    def test_body_view(self):
+        """Test the body is readable as a memoryview before any bytes copy"""
+        with MockHTTPServer() as server:
+            response = httpmorph.Client(http2=False).get(f"{server.url}/bytes/100000")
+            view = response.body_view
+            assert isinstance(view, memoryview)
+            assert view.readonly
+            assert len(view) == 100000
+            assert response.content == b"\x00" * 100000
+
+    def test_request_many(self):
+        """Test a batch returns every response in input order"""
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            requests = [("GET", f"{server.url}/bytes/{n}") for n in range(1, 21)]
+            requests.append({"method": "GET", "url": f"{server.url}/status/404"})
+            responses = client.request_many(requests, concurrency=4)
+            assert [len(r.content) for r in responses[:20]] == list(range(1, 21))
+            assert responses[20].status_code == 404
+
+            completed = list(client.request_many(requests[:5], ordered=False))
+            assert sorted(index for index, _ in completed) == [0, 1, 2, 3, 4]
+            assert all(len(r.content) == index + 1 for index, r in completed)
+
+    def test_chunked_response(self):
+        """Test chunk extensions and trailers are stripped from a chunked body"""
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            for length in (0, 1, 999, 1000, 54321):
+                response = client.get(f"{server.url}/chunked/{length}")
+                assert response.status_code == 200
+                assert response.content == bytes(i % 251 for i in range(length))
+
+    def test_request_many_pipelined(self):
+        """Test a batch pipelined over one keep-alive connection keeps its order"""
+        with MockHTTPServer(keep_alive=True) as server:
+            client = httpmorph.Client(http2=False)
+            assert client.allow_pipelining(server.url, 8)
+            requests = [("GET", f"{server.url}/bytes/{n}") for n in range(1, 21)]
+            responses = client.request_many(requests, concurrency=1)
+            assert [r.status_code for r in responses] == [200] * 20
+            assert [len(r.content) for r in responses] == list(range(1, 21))
+
     def test_connection_reuse(self):
         """Test that connections are reused"""
         with MockHTTPServer() as server:
@@ -157,6 +218,33 @@ class TestClientWithRealHTTPS:
         assert response.ja3_fingerprint is not None
         assert len(response.ja3_fingerprint) > 0
 
+    def test_ja3_fingerprint_disabled(self, httpbin_host):
+        """Test JA3 fingerprinting can be turned off per client"""
+        client = httpmorph.Client()
+        client.set_tls_fingerprint(False)
+        response = client.get(f"https://{httpbin_host}")
+        assert response.ja3_fingerprint is None
+        assert response.tls_version is not None
+
+    def test_ja3_fingerprint_shared_on_reuse(self, httpbin_host):
+        """Test pooled connections report the handshake's fingerprint"""
+        client = httpmorph.Client()
+        first = client.get(f"https://{httpbin_host}/get")
+        second = client.get(f"https://{httpbin_host}/get")
+        assert first.ja3_fingerprint is not None
+        assert second.ja3_fingerprint == first.ja3_fingerprint
+
+    def test_ja3_fingerprint_rotation(self, httpbin_host):
+        """Test rotated requests reuse connections opened with their variant"""
+        client = httpmorph.Client()
+        responses = [
+            client.get(f"https://{httpbin_host}/get", rotate_fingerprint=True) for _ in range(12)
+        ]
+        assert all(r.status_code == 200 for r in responses)
+        assert all(r.ja3_fingerprint for r in responses)
+        # More requests than variants, so some variant's connection comes back
+        assert any(r.connection_reused for r in responses)
+
     def test_http2_connection(self, httpbin_host):
         """Test HTTP/2 connection
 
@@ -221,5 +309,512 @@ class TestClientHTTP2Flag:
         assert client.http2 is True
 
 
+class TestClientStreaming:
+    """Test stream=True body delivery"""
+
+    def test_stream_iter_content(self):
+        """Test streamed body arrives in caller-sized chunks"""
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            response = client.get(f"{server.url}/stream-bytes/200000", stream=True)
+            assert isinstance(response, httpmorph.StreamingResponse)
+            assert response.status_code == 200
+
+            chunks = list(response.iter_content(chunk_size=4096))
+            assert sum(len(c) for c in chunks) == 200000
+            assert all(len(c) == 4096 for c in chunks[:-1])
+            assert response.total_time_us > 0
+
+    def test_stream_content_length_body(self):
+        """Test reading a streamed Content-Length body through .content"""
+        with MockHTTPServer() as server:
+            response = httpmorph.Client(http2=False).get(f"{server.url}/bytes/50000", stream=True)
+            assert response.content == b"\x00" * 50000
+
+    def test_stream_close_early(self):
+        """Test closing a partly read stream aborts the transfer"""
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            with client.get(f"{server.url}/stream-bytes/2000000", stream=True) as response:
+                first = next(response.iter_content(chunk_size=1024))
+                assert len(first) == 1024
+
+            # Client is still usable afterwards
+            response = client.get(f"{server.url}/get")
+            assert response.status_code == 200
+
+    def test_body_sink_callback(self):
+        """Test the low-level body_sink hook receives head then chunks"""
+        events = []
+
+        class Sink:
+            def on_head(self, head):
+                events.append(("head", head["status_code"]))
+
+            def on_chunk(self, data):
+                assert len(data) <= 1000
+                events.append(("chunk", len(data)))
+
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            result = client._client.request(
+                "GET", f"{server.url}/bytes/10000", body_sink=Sink(), chunk_size=1000
+            )
+            assert result["body"] == b""
+            assert events[0] == ("head", 200)
+            assert sum(n for kind, n in events[1:]) == 10000
+
+    def test_stream_gzip_decoded(self):
+        """Test a gzip body is decoded while it streams"""
+        with MockHTTPServer() as server:
+            response = httpmorph.Client(http2=False).get(f"{server.url}/gzip", stream=True)
+            assert response.headers.get("Content-Encoding") == "gzip"
+            assert response.json() == {"compressed": True, "gzipped": True}
+
+
+class TestClientStreamingUpload:
+    """Test request bodies streamed from iterators and files"""
+
+    def test_upload_from_generator(self):
+        """Test a generator body is sent chunked and arrives intact"""
+
+        def parts():
+            for i in range(50):
+                yield f"part-{i};".encode()
+
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            response = client.post(f"{server.url}/post", data=parts())
+            assert response.status_code == 200
+            assert response.json()["data"] == "".join(f"part-{i};" for i in range(50))
+            assert response.json()["headers"]["Transfer-Encoding"] == "chunked"
+
+    def test_upload_from_file(self, tmp_path):
+        """Test a file body is sent from its current position with Content-Length"""
+        path = tmp_path / "upload.txt"
+        path.write_bytes(b"skip" + b"y" * 300000)
+
+        with MockHTTPServer() as server, open(path, "rb") as f:
+            f.seek(4)
+            response = httpmorph.Session().post(f"{server.url}/post", data=f)
+            assert response.status_code == 200
+            body = response.json()
+            assert body["headers"]["Content-Length"] == "300000"
+            assert body["data"] == "y" * 300000
+
+
+class TestClientDNS:
+    """Test resolving through configured name servers"""
+
+    @staticmethod
+    def _start_dns_server(address):
+        """Answer every A query with address, AAAA queries with no records"""
+        import socket
+        import struct
+        import threading
+
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        sock.bind(("127.0.0.1", 0))
+        queries = []
+
+        def serve():
+            while True:
+                try:
+                    data, peer = sock.recvfrom(2048)
+                except OSError:
+                    return
+                pos = 12
+                while data[pos]:
+                    pos += data[pos] + 1
+                qtype = struct.unpack(">H", data[pos + 1 : pos + 3])[0]
+                queries.append(qtype)
+                question = data[12 : pos + 5]
+                answer = b""
+                if qtype == 1:
+                    record = struct.pack(">HHIH", 1, 1, 60, 4) + socket.inet_aton(address)
+                    answer = b"\xc0\x0c" + record
+                header = data[:2] + struct.pack(">HHHHH", 0x8180, 1, 1 if answer else 0, 0, 0)
+                sock.sendto(header + question + answer, peer)
+
+        threading.Thread(target=serve, daemon=True).start()
+        return sock, queries
+
+    def test_custom_dns_servers(self):
+        """Test a hostname resolves through the configured name server"""
+        sock, queries = self._start_dns_server("127.0.0.1")
+        try:
+            httpmorph.set_dns_servers([f"127.0.0.1:{sock.getsockname()[1]}"], timeout=1)
+            with MockHTTPServer() as server:
+                response = httpmorph.get(f"http://resolver.test:{server.port}/get")
+                assert response.status_code == 200
+            assert sorted(set(queries)) == [1, 28]  # A and AAAA
+        finally:
+            httpmorph.set_dns_servers(None)
+            sock.close()
+
+    def test_custom_dns_servers_async(self):
+        """Test the async client resolves through the configured name server too"""
+        sock, queries = self._start_dns_server("127.0.0.1")
+
+        async def fetch(url):
+            async with httpmorph.AsyncClient() as client:
+                return await client.get(url, timeout=10)
+
+        try:
+            httpmorph.set_dns_servers([f"127.0.0.1:{sock.getsockname()[1]}"], timeout=1)
+            with MockHTTPServer() as server:
+                response = asyncio.run(fetch(f"http://async-resolver.test:{server.port}/get"))
+                assert response.status_code == 200
+            assert 1 in queries
+        finally:
+            httpmorph.set_dns_servers(None)
+            sock.close()
+
+    def test_dns_cache_stats(self):
+        """Test a repeated lookup is answered from the cache"""
+        sock, queries = self._start_dns_server("127.0.0.1")
+        try:
+            httpmorph.set_dns_servers([f"127.0.0.1:{sock.getsockname()[1]}"], timeout=1)
+            client = httpmorph.Client(http2=False)
+            with MockHTTPServer() as server:
+                before = httpmorph.dns_cache_stats()
+                for path in ("/get", "/status/200"):
+                    response = client.get(f"http://cached.test:{server.port}{path}")
+                    assert response.status_code == 200
+                after = httpmorph.dns_cache_stats()
+            assert len(queries) == 2  # One A and one AAAA query for both requests
+            assert after["insertions"] > before["insertions"]
+            assert after["entries"] >= 1
+        finally:
+            httpmorph.set_dns_servers(None)
+            sock.close()
+
+    def test_invalid_dns_servers(self):
+        """Test an unparsable server list is rejected"""
+        with pytest.raises(ValueError):
+            httpmorph.set_dns_servers(["not-an-ip"])
+
+    def test_shared_cache_across_processes(self, tmp_path):
+        """Test a second process resolves from the lookup the first one shared"""
+        sock, queries = self._start_dns_server("127.0.0.1")
+        cache_path = tmp_path / "shared.cache"
+        try:
+            with MockHTTPServer() as server:
+                worker = (
+                    "import httpmorph, sys\n"
+                    f"assert httpmorph.open_shared_cache({str(cache_path)!r}, 64, 64)\n"
+                    f"httpmorph.set_dns_servers(['127.0.0.1:{sock.getsockname()[1]}'], timeout=1)\n"
+                    f"response = httpmorph.get('http://shared.test:{server.port}/get')\n"
+                    "assert response.status_code == 200\n"
+                    "print(httpmorph.shared_cache_stats()['dns_hits'])\n"
+                )
+                outputs = []
+                for _ in range(2):  # The second run stands for a restarted worker
+                    result = subprocess.run([sys.executable, "-c", worker], capture_output=True,
+                                            text=True, timeout=30)
+                    assert result.returncode == 0, result.stderr
+                    outputs.append(int(result.stdout.strip().splitlines()[-1]))
+            assert len(queries) == 2  # Only the first process asked the name server
+            assert outputs[1] > outputs[0]
+        finally:
+            sock.close()
+
+    def test_shared_cache_taken_over_from_dead_creator(self, tmp_path):
+        """Test a file its creator left half laid out is initialised again"""
+        cache_path = tmp_path / "shared.cache"
+        # Header start as a creator leaves it if it dies mid-layout a minute ago:
+        # magic, version, state INITIALIZING, init lock time
+        cache_path.write_bytes(
+            struct.pack("=QIIQ", 0x6D6F7270684D4354, 2, 1, int(time.time()) - 60)
+        )
+        worker = (
+            "import httpmorph\n"
+            f"assert httpmorph.open_shared_cache({str(cache_path)!r}, 64, 64)\n"
+            "print(httpmorph.shared_cache_stats() is not None)\n"
+        )
+        result = subprocess.run([sys.executable, "-c", worker], capture_output=True, text=True,
+                                timeout=30)
+        assert result.returncode == 0, result.stderr
+        assert result.stdout.strip().splitlines()[-1] == "True"
+
+
+class TestClientRequestArenas:
+    """Test per-request arenas"""
+
+    def test_arena_stats_disabled_by_default(self):
+        """Test arenas are opt-in"""
+        client = httpmorph.Client()
+        assert client.arena_stats() is None
+
+    def test_arenas_recycled_across_requests(self):
+        """Test sequential requests reuse one arena"""
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            assert client.enable_request_arenas(8)
+            for _ in range(5):
+                response = client.get(f"{server.url}/headers", headers={"X-Test": "arena"})
+                assert response.status_code == 200
+                assert response.json()["headers"].get("X-Test") == "arena"
+                assert response.headers.get("Content-Type")
+
+            stats = client.arena_stats()
+            assert stats["created"] >= 1
+            assert stats["reused"] >= 1
+            assert stats["created"] + stats["reused"] == 5
+            assert stats["cached"] >= 1
+
+            assert client.enable_request_arenas(0)
+            assert client.arena_stats() is None
+            assert client.get(f"{server.url}/get").status_code == 200
+
+
+class TestClientBufferPoolStats:
+    """Test response buffer pool statistics"""
+
+    def test_buffers_reused_across_requests(self):
+        """Test every response body takes a pooled buffer, later ones reused"""
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            for _ in range(5):
+                assert client.get(f"{server.url}/get").status_code == 200
+
+            tiers = client.buffer_pool_stats()
+            assert tiers
+            assert all(t["buffer_size"] > 0 for t in tiers)
+            assert sum(t["hits"] + t["misses"] for t in tiers) >= 5
+            assert sum(t["hits"] for t in tiers) >= 1
+
+    def test_mmap_tiers_bypass_thread_magazines(self):
+        """Test multi-MB buffers are reused through the depot, not parked per thread"""
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            for _ in range(3):
+                response = client.get(f"{server.url}/bytes/2000000")
+                assert len(response.body) == 2000000
+            del response  # Bodies are zero-copy views of the pooled buffer
+
+            mmap_tiers = [t for t in client.buffer_pool_stats() if t["mmap_backed"]]
+            assert mmap_tiers
+            assert all(t["magazine_hits"] == 0 for t in mmap_tiers)
+            assert sum(t["hits"] for t in mmap_tiers) >= 1
+            assert sum(t["pooled"] for t in mmap_tiers) >= 1
+
+
+class TestClientMetrics:
+    """Test request metrics snapshots"""
+
+    def test_counts_requests_per_origin(self):
+        """Test requests are counted in the totals and under their origin"""
+        with MockHTTPServer() as server:
+            client = httpmorph.Client(http2=False)
+            for _ in range(3):
+                assert client.get(f"{server.url}/get").status_code == 200
+
+            metrics = client.metrics()
+            assert metrics["requests"] == 3
+            assert metrics["errors"] == 0
+            assert metrics["body_bytes"] > 0
+            assert metrics["body_wire_bytes"] >= metrics["body_bytes"]
+            assert "buffer_pool" in metrics and "dns_cache" in metrics
+
+            origins = metrics["origins"]
+            assert len(origins) == 1
+            assert origins[0]["origin"].startswith("http://")
+            assert origins[0]["requests"] == 3
+            assert 0 < origins[0]["p50_us"] <= origins[0]["p99_us"] <= origins[0]["max_us"]
+
+            client.reset_metrics()
+            assert client.metrics()["requests"] == 0
+
+    def test_response_phase_fields(self):
+        """Test responses carry the new phase timings and connection flags"""
+        with MockHTTPServer() as server:
+            response = httpmorph.get(f"{server.url}/get")
+            assert response.queue_time_us == 0
+            assert response.dns_time_us >= 0
+            assert response.tls_resumed is False
+            assert response.body_wire_len >= len(response.body)
+
+    def test_session_reuses_connection(self):
+        """Test a session's second request reports a reused connection"""
+        with MockHTTPServer(keep_alive=True) as server:
+            with httpmorph.Session() as session:
+                first = session.get(f"{server.url}/get")
+                second = session.get(f"{server.url}/get")
+                assert first.connection_reused is False
+                assert second.connection_reused is True
+
+                metrics = session.metrics()
+                assert metrics["requests"] == 2
+                assert metrics["connections_opened"] == 1
+                assert metrics["connections_reused"] == 1
+                assert metrics["pool_idle"] + metrics["pool_active"] >= 1
+
+    def test_session_preconnect(self):
+        """Test a preconnected origin's first request reuses the connection"""
+        with MockHTTPServer(keep_alive=True) as server:
+            with httpmorph.Session() as session:
+                results = session.preconnect([server.url, "ftp://example.invalid/"], per_host=2)
+                opened = results[server.url]
+                assert opened["ok"] is True
+                assert opened["connections"] == 2
+                assert opened["http2"] is False
+                assert opened["total_us"] >= opened["connect_us"]
+                assert results["ftp://example.invalid/"]["ok"] is False
+
+                response = session.get(f"{server.url}/get")
+                assert response.status_code == 200
+                assert response.connection_reused is True
+
+    def test_session_preconnect_without_waiting(self):
+        """Test wait=False returns a future of the results"""
+        with MockHTTPServer(keep_alive=True) as server:
+            with httpmorph.Session() as session:
+                future = session.preconnect([server.url], wait=False)
+                assert future.result(timeout=10)[server.url]["ok"] is True
+
+
+class TestTracing:
+    """Test the span tracer"""
+
+    def test_request_emits_span_tree(self):
+        """Test a request yields a root span with phase spans under it"""
+        spans = []
+        httpmorph.set_tracer(spans.append)
+        try:
+            with MockHTTPServer() as server:
+                url = f"{server.url}/get"
+                assert httpmorph.Client(http2=False).get(url).status_code == 200
+        finally:
+            httpmorph.set_tracer(None)
+
+        roots = [s for s in spans if s["parent_span_id"] is None]
+        assert len(roots) == 1
+        root = roots[0]
+        assert root["name"] == "GET"
+        assert root["attributes"]["url.full"] == url
+        assert root["attributes"]["http.response.status_code"] == 200
+        assert len(root["trace_id"]) == 32 and len(root["span_id"]) == 16
+
+        children = [s for s in spans if s["parent_span_id"] == root["span_id"]]
+        assert "body" in {s["name"] for s in children}
+        for child in children:
+            assert child["trace_id"] == root["trace_id"]
+            assert root["start_time_unix_nano"] <= child["start_time_unix_nano"]
+            assert child["end_time_unix_nano"] <= root["end_time_unix_nano"]
+
+        # No spans once the tracer is removed
+        count = len(spans)
+        with MockHTTPServer() as server:
+            httpmorph.get(f"{server.url}/get")
+        assert len(spans) == count
+
+    @pytest.mark.asyncio
+    async def test_async_requests_traced_while_submitting(self):
+        """Test spans from the event thread don't block concurrent submits"""
+        from httpmorph._async_client import HAS_ASYNC_BINDINGS
+
+        if not HAS_ASYNC_BINDINGS:
+            pytest.skip("Async bindings not built")
+
+        spans = []
+        httpmorph.set_tracer(spans.append)
+        try:
+            with MockHTTPServer() as server:
+                async with httpmorph.AsyncClient() as client:
+                    urls = [f"{server.url}/get?i={i}" for i in range(64)]
+                    urls += [f"{server.url}/redirect/2" for _ in range(16)]
+                    responses = await asyncio.wait_for(
+                        asyncio.gather(*[client.get(url) for url in urls]), timeout=60
+                    )
+        finally:
+            httpmorph.set_tracer(None)
+
+        assert all(r.status_code == 200 for r in responses)
+        roots = [s for s in spans if s["parent_span_id"] is None]
+        assert len(roots) == 64 + 16 * 3  # Every redirect hop is a request of its own
+
+
+class TestHttpCache:
+    """Test the in-process HTTP response cache"""
+
+    def test_fresh_response_served_from_cache(self, http_server):
+        """A response with max-age is answered without the network"""
+        client = httpmorph.Client(http2=False)
+        cache = httpmorph.Cache()
+        client.set_cache(cache)
+
+        first = client.get(f"{http_server.url}/cache/max-age/60")
+        second = client.get(f"{http_server.url}/cache/max-age/60")
+        assert first.cache_status == "miss"
+        assert second.cache_status == "hit"
+        assert second.from_cache
+        assert second.body == first.body
+        assert "Age" in second.headers
+        assert cache.stats()["hits"] == 1
+
+    def test_stale_response_revalidated(self, http_server):
+        """A no-cache response is revalidated with If-None-Match"""
+        client = httpmorph.Client(http2=False)
+        client.set_cache(httpmorph.Cache())
+
+        first = client.get(f"{http_server.url}/cache/etag")
+        second = client.get(f"{http_server.url}/cache/etag")
+        assert second.cache_status == "revalidated"
+        assert second.status_code == 200
+        assert second.body == first.body
+
+    def test_no_store_not_cached(self, http_server):
+        """no-store responses always go to the network"""
+        client = httpmorph.Client(http2=False)
+        client.set_cache(httpmorph.Cache())
+
+        first = client.get(f"{http_server.url}/cache/no-store")
+        second = client.get(f"{http_server.url}/cache/no-store")
+        assert second.cache_status == "miss"
+        assert second.body != first.body
+
+    def test_private_not_cached(self, http_server):
+        """private responses aren't stored: the cache is shared between clients"""
+        cache = httpmorph.Cache()
+        a = httpmorph.Client(http2=False)
+        b = httpmorph.Client(http2=False)
+        a.set_cache(cache)
+        b.set_cache(cache)
+
+        first = a.get(f"{http_server.url}/cache/private")
+        second = b.get(f"{http_server.url}/cache/private")
+        assert second.cache_status == "miss"
+        assert second.body != first.body
+        assert cache.stats()["entries"] == 0
+
+    def test_s_maxage_overrides_max_age(self, http_server):
+        """s-maxage decides freshness over max-age in either direction"""
+        client = httpmorph.Client(http2=False)
+        client.set_cache(httpmorph.Cache())
+
+        client.get(f"{http_server.url}/cache/s-maxage/60")
+        assert client.get(f"{http_server.url}/cache/s-maxage/60").cache_status == "hit"
+
+        first = client.get(f"{http_server.url}/cache/s-maxage/0")
+        second = client.get(f"{http_server.url}/cache/s-maxage/0")
+        assert not second.from_cache
+        assert second.body != first.body
+
+    def test_cache_shared_between_clients(self, http_server, tmp_path):
+        """Clients attached to one cache see each other's (spilled) responses"""
+        cache = httpmorph.Cache(spill_dir=str(tmp_path), spill_threshold=1)
+        a = httpmorph.Client(http2=False)
+        b = httpmorph.Client(http2=False)
+        a.set_cache(cache)
+        b.set_cache(cache)
+
+        first = a.get(f"{http_server.url}/cache/max-age/120")
+        second = b.get(f"{http_server.url}/cache/max-age/120")
+        assert second.from_cache
+        assert second.body == first.body
+        assert cache.stats()["disk_bytes"] > 0
+
+
 if __name__ == "__main__":
     pytest.main([__file__, "-v"])
@@ -4,6 +4,8 @@ HTTP/2 flag tests for httpmorph
 Tests the HTTP/2 flag functionality similar to httpx API
 """
 
+import time
+
 import pytest
 
 import httpmorph
@@ -207,6 +209,35 @@ class TestHTTP2Features:
         assert response.connect_time_us >= 0
         assert response.tls_time_us >= 0
 
+    def test_http2_connection_reused(self, httpbin_host):
+        """Test that HTTP/2 connections are pooled and reused by later requests"""
+        session = httpmorph.Session(browser="chrome", http2=True)
+        first = session.get(f"https://{httpbin_host}/get", timeout=10)
+        second = session.get(f"https://{httpbin_host}/get", timeout=10)
+
+        assert first.http_version == "2.0"
+        assert second.http_version == "2.0"
+        assert second.status_code in [200, 402]  # httpbingo returns 402 for HTTP/2
+        # No new TCP connection or TLS handshake for the second request
+        assert second.connect_time_us == 0
+        assert second.tls_time_us == 0
+
+
+    def test_http2_adaptive_window(self, httpbin_host):
+        """Test opt-in adaptive flow-control windows report their state"""
+        client = httpmorph.Client(http2=True)
+        url = f"https://{httpbin_host}/bytes/65536"
+
+        response = client.get(url, http2_adaptive_window=True, timeout=10)
+        assert response.http_version == "2.0"
+        assert len(response.body) == 65536
+        assert response.http2_window_size > 0
+        assert response.http2_rtt_us >= 0
+
+        # Off by default: the profile's windows are left alone and nothing is reported
+        response = client.get(url, timeout=10)
+        assert response.http2_window_size == 0
+        assert response.http2_rtt_us == 0
 
 class TestHTTP2EdgeCases:
     """Test HTTP/2 edge cases and error handling"""
@@ -253,5 +284,85 @@ class TestHTTP2EdgeCases:
             assert all(r.http_version == "2.0" for r in responses)
 
 
+class TestHTTP2StreamQueue:
+    """Test the session manager's stream queue against a peer with a low stream limit"""
+
+    @staticmethod
+    def _wait_for(probe, condition, timeout=5.0):
+        deadline = time.monotonic() + timeout
+        while not condition():
+            assert time.monotonic() < deadline, "timed out"
+            probe.pump()
+            time.sleep(0.005)
+
+    @pytest.fixture
+    def probe(self):
+        from httpmorph import _httpmorph
+
+        probes = []
+
+        def make(max_streams):
+            probe = _httpmorph._Http2QueueProbe(max_streams)
+            probes.append(probe)
+            self._wait_for(probe, lambda: probe.stats["remote_limit"] == max_streams)
+            return probe
+
+        yield make
+        for probe in probes:
+            probe.close()
+
+    def test_streams_past_limit_are_queued(self, probe):
+        """Only max_streams are opened, the rest wait"""
+        p = probe(2)
+        ids = [p.submit() for _ in range(5)]
+
+        assert ids[:2] == [1, 3]
+        assert ids[2:] == [0, 0, 0]
+        self._wait_for(p, lambda: len(p.opened) == 2)
+        time.sleep(0.05)
+        p.pump()
+        assert p.opened == [1, 3]
+        stats = p.stats
+        assert stats["open"] == 2
+        assert stats["queued"] == 3
+        assert stats["total_queued"] == 3
+
+    def test_queued_streams_open_by_priority(self, probe):
+        """A closing stream lets the heaviest queued stream in, oldest first among equals"""
+        p = probe(1)
+        for weight in (16, 16, 256, 16, 128):
+            p.submit(weight)
+        self._wait_for(p, lambda: len(p.opened) == 1)
+
+        for n in range(1, 5):
+            p.respond(p.opened[-1])
+            self._wait_for(p, lambda: len(p.opened) == n + 1)
+        p.respond(p.opened[-1])
+        self._wait_for(p, lambda: len(p.completed) == 5)
+
+        assert p.completed == [(0, 1), (2, 3), (4, 5), (1, 7), (3, 9)]
+        assert p.stats["queued"] == 0
+
+    def test_saturated_at_spill_threshold(self, probe):
+        """The session counts as saturated once 4 streams are queued"""
+        p = probe(1)
+        p.submit()
+        for _ in range(3):
+            p.submit()
+        assert p.stats["queued"] == 3
+        assert p.stats["saturated"] is False
+
+        p.submit()
+        assert p.stats["queued"] == 4
+        assert p.stats["saturated"] is True
+
+        # Finishing the open stream moves one out of the queue
+        self._wait_for(p, lambda: len(p.opened) == 1)
+        p.respond(1)
+        self._wait_for(p, lambda: len(p.opened) == 2)
+        assert p.stats["queued"] == 3
+        assert p.stats["saturated"] is False
+
+
 if __name__ == "__main__":
     pytest.main([__file__, "-v"])
@@ -5,6 +5,8 @@ Simple HTTP proxy server for testing
 import base64
 import select
 import socket
+import socketserver
+import struct
 import threading
 from http.server import BaseHTTPRequestHandler, HTTPServer
 
@@ -42,6 +44,8 @@ class ProxyHandler(BaseHTTPRequestHandler):
                 self.end_headers()
                 return
 
+        self.server.connect_count += 1
+
         # Parse host and port
         host, port = self.path.split(":")
         port = int(port)
@@ -141,6 +145,7 @@ class MockProxyServer:
     def start(self):
         """Start the proxy server"""
         self.server = HTTPServer(("127.0.0.1", self.port), ProxyHandler)
+        self.server.connect_count = 0
 
         # Attach auth credentials to server
         if self.username:
@@ -168,6 +173,11 @@ class MockProxyServer:
         if self.thread:
             self.thread.join(timeout=1)
 
+    @property
+    def connect_count(self):
+        """Number of CONNECT tunnels established through the proxy"""
+        return self.server.connect_count if self.server else 0
+
     @property
     def url(self):
         """Get proxy URL"""
@@ -179,3 +189,138 @@ class MockProxyServer:
 
     def __exit__(self, exc_type, exc_val, exc_tb):
         self.stop()
+
+
+class Socks5Handler(socketserver.BaseRequestHandler):
+    """SOCKS5 proxy handler (CONNECT only, optional username/password)"""
+
+    def _recv_exact(self, n):
+        data = b""
+        while len(data) < n:
+            chunk = self.request.recv(n - len(data))
+            if not chunk:
+                raise ConnectionError("client closed")
+            data += chunk
+        return data
+
+    def handle(self):
+        server = self.server
+        try:
+            version, nmethods = self._recv_exact(2)
+            methods = self._recv_exact(nmethods)
+            if version != 5:
+                return
+
+            if server.username:
+                if 2 not in methods:
+                    self.request.sendall(b"\x05\xff")
+                    return
+                self.request.sendall(b"\x05\x02")
+                _, ulen = self._recv_exact(2)
+                username = self._recv_exact(ulen).decode()
+                (plen,) = self._recv_exact(1)
+                password = self._recv_exact(plen).decode()
+                if username != server.username or password != server.password:
+                    self.request.sendall(b"\x01\x01")
+                    return
+                self.request.sendall(b"\x01\x00")
+            else:
+                self.request.sendall(b"\x05\x00")
+
+            _, cmd, _, atyp = self._recv_exact(4)
+            if atyp == 1:
+                host = socket.inet_ntoa(self._recv_exact(4))
+            elif atyp == 4:
+                host = socket.inet_ntop(socket.AF_INET6, self._recv_exact(16))
+            else:
+                (length,) = self._recv_exact(1)
+                host = self._recv_exact(length).decode()
+            (port,) = struct.unpack("!H", self._recv_exact(2))
+            server.address_types.append(atyp)
+
+            if cmd != 1:
+                self.request.sendall(b"\x05\x07\x00\x01" + b"\x00" * 6)
+                return
+
+            try:
+                target_sock = socket.create_connection((host, port), timeout=10)
+            except OSError:
+                self.request.sendall(b"\x05\x05\x00\x01" + b"\x00" * 6)
+                return
+
+            server.connect_count += 1
+            bound_host, bound_port = target_sock.getsockname()[:2]
+            self.request.sendall(
+                b"\x05\x00\x00\x01" + socket.inet_aton(bound_host) + struct.pack("!H", bound_port)
+            )
+
+            sockets = [self.request, target_sock]
+            while True:
+                readable, _, exceptional = select.select(sockets, [], sockets, 30)
+                if not readable or exceptional:
+                    break
+                for sock in readable:
+                    data = sock.recv(4096)
+                    if not data:
+                        target_sock.close()
+                        return
+                    other = target_sock if sock is self.request else self.request
+                    other.sendall(data)
+            target_sock.close()
+        except (ConnectionError, OSError, ValueError):
+            pass
+
+
+class MockSocks5Server:
+    """Mock SOCKS5 proxy server for testing"""
+
+    def __init__(self, port=0, username=None, password=None):
+        self.port = port
+        self.username = username
+        self.password = password
+        self.server = None
+        self.thread = None
+
+    def start(self):
+        """Start the proxy server"""
+        socketserver.ThreadingTCPServer.allow_reuse_address = True
+        self.server = socketserver.ThreadingTCPServer(("127.0.0.1", self.port), Socks5Handler)
+        self.server.daemon_threads = True
+        self.server.username = self.username
+        self.server.password = self.password
+        self.server.connect_count = 0
+        self.server.address_types = []
+        self.port = self.server.server_address[1]
+
+        self.thread = threading.Thread(target=self.server.serve_forever)
+        self.thread.daemon = True
+        self.thread.start()
+
+    def stop(self):
+        """Stop the proxy server"""
+        if self.server:
+            self.server.shutdown()
+            self.server.server_close()
+        if self.thread:
+            self.thread.join(timeout=1)
+
+    @property
+    def connect_count(self):
+        """Number of tunnels established through the proxy"""
+        return self.server.connect_count if self.server else 0
+
+    @property
+    def address_types(self):
+        """SOCKS5 address type of each CONNECT (1 IPv4, 3 domain name, 4 IPv6)"""
+        return self.server.address_types if self.server else []
+
+    def url(self, scheme="socks5h"):
+        """Get proxy URL"""
+        return f"{scheme}://127.0.0.1:{self.port}"
+
+    def __enter__(self):
+        self.start()
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.stop()
@@ -17,10 +17,26 @@ from typing import Optional
 class MockHTTPHandler(BaseHTTPRequestHandler):
     """HTTP request handler for testing"""
 
+    # Requests served under /cache/
+    cache_requests = 0
+
     def log_message(self, format, *args):
         """Suppress log messages during tests"""
         pass
 
+    def _read_body(self):
+        """Read the request body (Content-Length or chunked)"""
+        if self.headers.get("Transfer-Encoding", "").lower() != "chunked":
+            return self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        parts = []
+        while True:
+            size = int(self.rfile.readline().split(b";")[0], 16)
+            if size == 0:
+                self.rfile.readline()  # CRLF after the last chunk
+                return b"".join(parts)
+            parts.append(self.rfile.read(size))
+            self.rfile.readline()
+
     def do_GET(self):
         """Handle GET requests"""
         # Strip query parameters for path matching
@@ -305,12 +321,55 @@ class MockHTTPHandler(BaseHTTPRequestHandler):
                 length = int(path_without_query.split("/")[-1])
                 self.send_response(200)
                 self.send_header("Content-Type", "application/octet-stream")
+                self.send_header("Content-Length", str(length))
                 self.end_headers()
                 self.wfile.write(b"\x00" * length)
             except Exception:
                 self.send_response(400)
                 self.end_headers()
 
+        elif path_without_query.startswith("/chunked/"):
+            # Chunked body of the given length, with chunk extensions and a trailer
+            try:
+                length = int(path_without_query.split("/")[-1])
+            except ValueError:
+                self.send_response(400)
+                self.end_headers()
+                return
+            self.send_response(200)
+            self.send_header("Content-Type", "application/octet-stream")
+            self.send_header("Transfer-Encoding", "chunked")
+            self.send_header("Trailer", "X-Checksum")
+            self.end_headers()
+            for i in range(0, length, 1000):
+                chunk = bytes((i + j) % 251 for j in range(min(1000, length - i)))
+                self.wfile.write(b"%x;part=%d\r\n%s\r\n" % (len(chunk), i, chunk))
+            self.wfile.write(b"0\r\nX-Checksum: none\r\n\r\n")
+
+        elif path_without_query == "/alt-svc":
+            # Advertise HTTP/3 on the same port and on another host
+            self.send_response(200)
+            self.send_header("Content-Type", "text/plain")
+            self.send_header("Alt-Svc", f'h3=":{self.server.server_port}"; ma=86400')
+            self.send_header("Alt-Svc", 'h3-29="alt.example.com:8443"')
+            self.end_headers()
+            self.wfile.write(b"OK")
+
+        elif path_without_query.startswith("/large-headers/"):
+            # Return roughly N KB of Set-Cookie headers
+            try:
+                kilobytes = int(path_without_query.split("/")[-1])
+                self.send_response(200)
+                self.send_header("Content-Type", "text/plain")
+                self.send_header("Content-Length", "2")
+                for i in range(kilobytes):
+                    self.send_header("Set-Cookie", f"c{i}={'x' * 1000}")
+                self.end_headers()
+                self.wfile.write(b"OK")
+            except Exception:
+                self.send_response(400)
+                self.end_headers()
+
         elif path_without_query.startswith("/stream-bytes/"):
             # Stream binary data of specified length
             try:
@@ -422,6 +481,40 @@ class MockHTTPHandler(BaseHTTPRequestHandler):
                 # Default to utf-8 for other encodings
                 self.wfile.write(json.dumps(response, ensure_ascii=False).encode("utf-8"))
 
+        elif path_without_query.startswith("/cache/"):
+            # Cacheable responses; the body counts requests that reached the server
+            MockHTTPHandler.cache_requests += 1
+            body = str(MockHTTPHandler.cache_requests).encode()
+            if path_without_query.startswith("/cache/max-age/"):
+                self.send_response(200)
+                self.send_header("Cache-Control", f"max-age={path_without_query.split('/')[-1]}")
+            elif path_without_query.startswith("/cache/s-maxage/"):
+                # max-age says the opposite, so only s-maxage can make it fresh
+                s_maxage = int(path_without_query.split("/")[-1])
+                self.send_response(200)
+                self.send_header(
+                    "Cache-Control", f"max-age={0 if s_maxage else 600}, s-maxage={s_maxage}"
+                )
+            elif path_without_query == "/cache/private":
+                self.send_response(200)
+                self.send_header("Cache-Control", "private, max-age=600")
+            elif path_without_query == "/cache/etag":
+                if self.headers.get("If-None-Match") == '"v1"':
+                    self.send_response(304)
+                    self.send_header("ETag", '"v1"')
+                    self.end_headers()
+                    return
+                self.send_response(200)
+                self.send_header("Cache-Control", "no-cache")
+                self.send_header("ETag", '"v1"')
+            else:
+                self.send_response(200)
+                self.send_header("Cache-Control", "no-store")
+            self.send_header("Content-Type", "text/plain")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
         else:
             self.send_response(404)
             self.send_header("Content-Type", "text/plain")
@@ -430,8 +523,7 @@ class MockHTTPHandler(BaseHTTPRequestHandler):
 
     def do_POST(self):
         """Handle POST requests"""
-        content_length = int(self.headers.get("Content-Length", 0))
-        body = self.rfile.read(content_length)
+        body = self._read_body()
 
         # Strip query parameters for path matching
         path_without_query = self.path.split("?")[0]
@@ -549,8 +641,7 @@ class MockHTTPHandler(BaseHTTPRequestHandler):
 
     def do_PUT(self):
         """Handle PUT requests"""
-        content_length = int(self.headers.get("Content-Length", 0))
-        body = self.rfile.read(content_length)
+        body = self._read_body()
 
         path_without_query = self.path.split("?")[0]
 
@@ -602,8 +693,7 @@ class MockHTTPHandler(BaseHTTPRequestHandler):
 
     def do_PATCH(self):
         """Handle PATCH requests"""
-        content_length = int(self.headers.get("Content-Length", 0))
-        body = self.rfile.read(content_length)
+        body = self._read_body()
 
         path_without_query = self.path.split("?")[0]
 
@@ -644,9 +734,10 @@ class MockHTTPHandler(BaseHTTPRequestHandler):
 class MockHTTPServer:
     """Mock HTTP/HTTPS server for testing"""
 
-    def __init__(self, port: int = 0, ssl_enabled: bool = False):
+    def __init__(self, port: int = 0, ssl_enabled: bool = False, keep_alive: bool = False):
         self.port = port
         self.ssl_enabled = ssl_enabled
+        self.keep_alive = keep_alive
         self.server: Optional[HTTPServer] = None
         self.thread: Optional[threading.Thread] = None
         self.cert_file = None
@@ -654,7 +745,14 @@ class MockHTTPServer:
 
     def start(self):
         """Start the test server"""
-        self.server = HTTPServer(("127.0.0.1", self.port), MockHTTPHandler)
+        handler = MockHTTPHandler
+        if self.keep_alive:
+            # HTTP/1.1 keeps connections open; the timeout lets shutdown() get
+            # past a connection the client left idle in its pool
+            handler = type(
+                "KeepAliveHandler", (MockHTTPHandler,), {"protocol_version": "HTTP/1.1", "timeout": 2}
+            )
+        self.server = HTTPServer(("127.0.0.1", self.port), handler)
 
         if self.ssl_enabled:
             # Create self-signed certificate for testing
@@ -2,6 +2,8 @@
 Session tests for httpmorph
 """
 
+import time
+
 import pytest
 
 import httpmorph
@@ -119,6 +121,20 @@ class TestSession:
             response = session.get(f"{server.url}/headers", headers=headers)
             assert response.status_code in [200, 402]  # httpbingo returns 402 for HTTP/2
 
+    def test_session_concurrent_threads(self):
+        """Test one session driven from several threads at once"""
+        from concurrent.futures import ThreadPoolExecutor
+
+        with MockHTTPServer() as server:
+            session = httpmorph.Session(browser="chrome")
+
+            def fetch(i):
+                return session.get(f"{server.url}/get?n={i}").json()["args"]["n"]
+
+            with ThreadPoolExecutor(max_workers=8) as pool:
+                results = list(pool.map(fetch, range(32)))
+            assert results == [str(i) for i in range(32)]
+
     def test_session_cookie_persistence(self, httpbin_host):
         """Test that session maintains cookies"""
         session = httpmorph.Session(browser="chrome")
@@ -137,6 +153,18 @@ class TestSession:
         # Cookie count should be stable (same cookies)
         assert cookies_after >= cookies_before, "Cookies were lost between requests"
 
+    def test_session_cookie_replaced_not_duplicated(self):
+        """Test that setting a cookie again replaces the stored one"""
+        with MockHTTPServer() as server:
+            session = httpmorph.Session(browser="chrome")
+            session.get(f"{server.url}/cookies/set/token/one", allow_redirects=False)
+            session.get(f"{server.url}/cookies/set/token/two", allow_redirects=False)
+            session.get(f"{server.url}/cookies/set/other/x", allow_redirects=False)
+            assert len(session.cookie_jar) == 2
+
+            response = session.get(f"{server.url}/cookies")
+            assert response.json()["cookies"] == {"token": "two", "other": "x"}
+
     def test_session_context_manager(self, httpbin_host):
         """Test session as context manager"""
         with MockHTTPServer() as server:
@@ -252,5 +280,99 @@ class TestSessionHTTP2Flag:
             assert response.http_version == "2.0"
 
 
+@pytest.mark.ssl
+class TestSessionTLSResumption:
+    """Test TLS session resumption cache"""
+
+    def test_tls_session_stats_initial(self):
+        """Test a fresh session starts with an empty cache"""
+        session = httpmorph.Session(browser="chrome")
+        stats = session.tls_session_stats()
+        assert stats["hits"] == 0
+        assert stats["misses"] == 0
+        assert stats["entries"] == 0
+
+    def test_tls_session_reused_for_same_origin(self):
+        """Test second connection to an origin offers the cached session"""
+        with MockHTTPServer(ssl_enabled=True) as server:
+            session = httpmorph.Session(browser="chrome")
+            response1 = session.get(f"{server.url}/get", verify=False)
+            response2 = session.get(f"{server.url}/get", verify=False)
+            assert response1.status_code == 200
+            assert response2.status_code == 200
+
+            stats = session.tls_session_stats()
+            assert stats["stores"] >= 1
+            assert stats["hits"] >= 1
+            assert stats["entries"] >= 1
+
+    def test_tls_sessions_not_shared_between_sessions(self):
+        """Test each session keeps its own cache"""
+        with MockHTTPServer(ssl_enabled=True) as server:
+            session1 = httpmorph.Session(browser="chrome")
+            session1.get(f"{server.url}/get", verify=False)
+
+            session2 = httpmorph.Session(browser="chrome")
+            session2.get(f"{server.url}/get", verify=False)
+            assert session2.tls_session_stats()["hits"] == 0
+
+    def test_sessions_with_different_profiles_interleaved(self):
+        """Test sessions sharing SSL contexts keep their own profile and cache"""
+        with MockHTTPServer(ssl_enabled=True) as server:
+            sessions = [httpmorph.Session(browser=b) for b in ("chrome", "firefox", "chrome", "safari")]
+            for session in sessions:
+                assert session.get(f"{server.url}/get", verify=False).status_code == 200
+            for session in sessions:
+                assert session.get(f"{server.url}/get", verify=False).status_code == 200
+                assert session.tls_session_stats()["stores"] >= 1
+
+
+@pytest.mark.ssl
+class TestSessionAltSvc:
+    """Test Alt-Svc discovery"""
+
+    def test_alt_svc_remembered(self):
+        """Test an HTTPS response's Alt-Svc header is kept per origin"""
+        with MockHTTPServer(ssl_enabled=True) as server:
+            session = httpmorph.Session(browser="chrome")
+            assert session.alt_svc(f"{server.url}/") is None
+
+            assert session.get(f"{server.url}/alt-svc", verify=False).status_code == 200
+            assert session.alt_svc(f"{server.url}/other") == ("", server.port)
+            assert session.alt_svc(server.url, "h3-29") == ("alt.example.com", 8443)
+            assert session.alt_svc(server.url, "h2") is None
+
+    def test_alt_svc_ignored_over_http(self):
+        """Test plain HTTP origins can't advertise alternatives"""
+        with MockHTTPServer() as server:
+            session = httpmorph.Session(browser="chrome")
+            session.get(f"{server.url}/alt-svc")
+            assert session.alt_svc(server.url) is None
+
+
+class TestSessionPoolMaintenance:
+    """Test background pool maintenance"""
+
+    def test_start_pool_maintenance(self):
+        """Test maintenance thread starts once per session"""
+        session = httpmorph.Session(browser="chrome")
+        assert session.start_pool_maintenance(interval=0.05)
+        assert not session.start_pool_maintenance(interval=0.05)
+        session.close()
+
+    def test_requests_with_maintenance_and_min_idle(self):
+        """Test requests keep working while the pool is refilled in the background"""
+        with MockHTTPServer() as server:
+            session = httpmorph.Session(browser="chrome")
+            assert session.start_pool_maintenance(interval=0.05)
+            assert session.set_min_idle("127.0.0.1", server.port, 2, tls=False)
+
+            time.sleep(0.2)
+            for _ in range(3):
+                response = session.get(f"{server.url}/get")
+                assert response.status_code == 200
+            session.close()
+
+
 if __name__ == "__main__":
     pytest.main([__file__, "-v"])